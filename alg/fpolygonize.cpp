@@ -32,6 +32,7 @@
 #include "gdal_alg_priv.h"
 #include "cpl_conv.h"
 #include "cpl_string.h"
+#include "cpl_multiproc.h"
 #include <vector>
 
 CPL_CVSID("$Id$");
@@ -530,6 +531,13 @@ GPMaskImageData( GDALRasterBandH hMaskBand, GByte* pabyMaskLine, int iY, int nXS
  * <dl>
  * <dt>"8CONNECTED":</dt> May be set to "8" to use 8 connectedness.
  * Otherwise 4 connectedness will be applied to the algorithm
+ * <dt>"NUM_THREADS":</dt> Number of threads (or ALL_CPUS) used to process
+ * the raster by tiles of whole lines, as in GDALPolygonize(). As pixel
+ * values are compared with a tolerance, the value written for a polygon
+ * whose pixels are not all exactly equal is the value of one of its pixels,
+ * which may not be the same one as with a single thread.
+ * <dt>"TILE_HEIGHT":</dt> Number of lines of the tiles when several threads
+ * are used.
  * </dl>
  * @param pfnProgress callback for reporting algorithm progress matching the
  * GDALProgressFunc() semantics.  May be NULL.
@@ -572,6 +580,18 @@ GDALFPolygonize( GDALRasterBandH hSrcBand,
         return CE_Failure;
     }
 
+/* -------------------------------------------------------------------- */
+/*      Use the tiled algorithm if several threads are requested.       */
+/* -------------------------------------------------------------------- */
+    int nThreads = CPLGetNumThreadsFromOption(
+        CSLFetchNameValueDef( papszOptions, "NUM_THREADS", "1" ), 1 );
+
+    if( nThreads > 1 )
+        return GDALPolygonizeTiled( hSrcBand, hMaskBand, hOutLayer,
+                                    iPixValField, nConnectedness, TRUE,
+                                    nThreads, papszOptions,
+                                    pfnProgress, pProgressArg );
+
 /* -------------------------------------------------------------------- */
 /*      Allocate working buffers.                                       */
 /* -------------------------------------------------------------------- */
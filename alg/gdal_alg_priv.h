@@ -159,6 +159,14 @@ public:
 
     void     Clear();
 };
+
+CPLErr GDALPolygonizeTiled( GDALRasterBandH hSrcBand,
+                            GDALRasterBandH hMaskBand,
+                            OGRLayerH hOutLayer, int iPixValField,
+                            int nConnectedness, int bFloat,
+                            int nThreads, char **papszOptions,
+                            GDALProgressFunc pfnProgress,
+                            void * pProgressArg );
 #endif
 
 typedef void* (*GDALTransformDeserializeFunc)( CPLXMLNode *psTree );
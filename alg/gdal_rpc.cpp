@@ -33,6 +33,10 @@
 #include "ogr_spatialref.h"
 #include "cpl_minixml.h"
 
+#if defined(__x86_64) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
 CPL_CVSID("$Id$");
 
 CPL_C_START
@@ -217,6 +221,116 @@ static void RPCTransformPoint( GDALRPCInfo *psRPC,
     *pdfLine = dfResultY * psRPC->dfLINE_SCALE + psRPC->dfLINE_OFF;
 }
 
+/************************************************************************/
+/*                        RPCTransformPoints()                          */
+/*                                                                      */
+/*      Batched version of RPCTransformPoint() for the points whose     */
+/*      panMask flag is set (or all of them if panMask is NULL).  The   */
+/*      SSE2 version evaluates two points at a time with the same       */
+/*      operations, so the results are identical.                       */
+/************************************************************************/
+
+static void RPCTransformPoints( GDALRPCInfo *psRPC, int nPoints,
+                                const double *padfLong, const double *padfLat,
+                                const double *padfHeight, const int *panMask,
+                                double *padfPixel, double *padfLine )
+
+{
+    int i = 0;
+
+#if defined(__x86_64) || defined(_M_X64)
+    const __m128d xmm_long_off = _mm_set1_pd( psRPC->dfLONG_OFF );
+    const __m128d xmm_long_scale = _mm_set1_pd( psRPC->dfLONG_SCALE );
+    const __m128d xmm_lat_off = _mm_set1_pd( psRPC->dfLAT_OFF );
+    const __m128d xmm_lat_scale = _mm_set1_pd( psRPC->dfLAT_SCALE );
+    const __m128d xmm_height_off = _mm_set1_pd( psRPC->dfHEIGHT_OFF );
+    const __m128d xmm_height_scale = _mm_set1_pd( psRPC->dfHEIGHT_SCALE );
+
+    for( ; i + 1 < nPoints; i += 2 )
+    {
+        if( panMask != NULL && (!panMask[i] || !panMask[i+1]) )
+        {
+            int j;
+            for( j = i; j < i + 2; j++ )
+            {
+                if( panMask[j] )
+                    RPCTransformPoint( psRPC, padfLong[j], padfLat[j],
+                                       padfHeight[j],
+                                       padfPixel + j, padfLine + j );
+            }
+            continue;
+        }
+
+        const __m128d L = _mm_div_pd(
+            _mm_sub_pd( _mm_loadu_pd( padfLong + i ), xmm_long_off ),
+            xmm_long_scale );
+        const __m128d P = _mm_div_pd(
+            _mm_sub_pd( _mm_loadu_pd( padfLat + i ), xmm_lat_off ),
+            xmm_lat_scale );
+        const __m128d H = _mm_div_pd(
+            _mm_sub_pd( _mm_loadu_pd( padfHeight + i ), xmm_height_off ),
+            xmm_height_scale );
+        __m128d axmmTerms[20];
+
+        /* Same terms, and same evaluation order, as RPCComputeTerms() */
+        axmmTerms[0] = _mm_set1_pd( 1.0 );
+        axmmTerms[1] = L;
+        axmmTerms[2] = P;
+        axmmTerms[3] = H;
+        axmmTerms[4] = _mm_mul_pd( L, P );
+        axmmTerms[5] = _mm_mul_pd( L, H );
+        axmmTerms[6] = _mm_mul_pd( P, H );
+        axmmTerms[7] = _mm_mul_pd( L, L );
+        axmmTerms[8] = _mm_mul_pd( P, P );
+        axmmTerms[9] = _mm_mul_pd( H, H );
+        axmmTerms[10] = _mm_mul_pd( axmmTerms[4], H );
+        axmmTerms[11] = _mm_mul_pd( axmmTerms[7], L );
+        axmmTerms[12] = _mm_mul_pd( axmmTerms[4], P );
+        axmmTerms[13] = _mm_mul_pd( axmmTerms[5], H );
+        axmmTerms[14] = _mm_mul_pd( axmmTerms[7], P );
+        axmmTerms[15] = _mm_mul_pd( axmmTerms[8], P );
+        axmmTerms[16] = _mm_mul_pd( axmmTerms[6], H );
+        axmmTerms[17] = _mm_mul_pd( axmmTerms[7], H );
+        axmmTerms[18] = _mm_mul_pd( axmmTerms[8], H );
+        axmmTerms[19] = _mm_mul_pd( axmmTerms[9], H );
+
+        __m128d xmm_samp_num = _mm_setzero_pd();
+        __m128d xmm_samp_den = _mm_setzero_pd();
+        __m128d xmm_line_num = _mm_setzero_pd();
+        __m128d xmm_line_den = _mm_setzero_pd();
+        int k;
+
+        for( k = 0; k < 20; k++ )
+        {
+            xmm_samp_num = _mm_add_pd( xmm_samp_num, _mm_mul_pd(
+                axmmTerms[k], _mm_set1_pd( psRPC->adfSAMP_NUM_COEFF[k] ) ) );
+            xmm_samp_den = _mm_add_pd( xmm_samp_den, _mm_mul_pd(
+                axmmTerms[k], _mm_set1_pd( psRPC->adfSAMP_DEN_COEFF[k] ) ) );
+            xmm_line_num = _mm_add_pd( xmm_line_num, _mm_mul_pd(
+                axmmTerms[k], _mm_set1_pd( psRPC->adfLINE_NUM_COEFF[k] ) ) );
+            xmm_line_den = _mm_add_pd( xmm_line_den, _mm_mul_pd(
+                axmmTerms[k], _mm_set1_pd( psRPC->adfLINE_DEN_COEFF[k] ) ) );
+        }
+
+        _mm_storeu_pd( padfPixel + i, _mm_add_pd(
+            _mm_mul_pd( _mm_div_pd( xmm_samp_num, xmm_samp_den ),
+                        _mm_set1_pd( psRPC->dfSAMP_SCALE ) ),
+            _mm_set1_pd( psRPC->dfSAMP_OFF ) ) );
+        _mm_storeu_pd( padfLine + i, _mm_add_pd(
+            _mm_mul_pd( _mm_div_pd( xmm_line_num, xmm_line_den ),
+                        _mm_set1_pd( psRPC->dfLINE_SCALE ) ),
+            _mm_set1_pd( psRPC->dfLINE_OFF ) ) );
+    }
+#endif
+
+    for( ; i < nPoints; i++ )
+    {
+        if( panMask == NULL || panMask[i] )
+            RPCTransformPoint( psRPC, padfLong[i], padfLat[i], padfHeight[i],
+                               padfPixel + i, padfLine + i );
+    }
+}
+
 /************************************************************************/
 /* ==================================================================== */
 /*			     GDALRPCTransformer                         */
@@ -257,8 +371,22 @@ typedef struct {
 
     double      adfGeoTransform[6];
     double      adfReverseGeoTransform[6];
+
+    /* Cache of the DEM, in RPC_DEM_TILE_SIZE square tiles */
+    int         bDEMHasNoData;
+    double      dfDEMNoDataValue;
+    int         nDEMTilesX;
+    int         nDEMTilesY;
+    double    **papadfDEMTiles;
+    GUIntBig   *panDEMTileLastUse;
+    GUIntBig    nDEMTileCounter;
+    int         nDEMMaxTiles;
+    int         nDEMTilesLoaded;
+    int        *panDEMLoadedTiles;
 } GDALRPCTransformInfo;
 
+#define RPC_DEM_TILE_SIZE 256
+
 /************************************************************************/
 /*                     GDALSerializeRPCDEMResample()                    */
 /************************************************************************/
@@ -400,7 +528,9 @@ void* GDALCreateSimilarRPCTransformer( void *hTransformArg, double dfRatioX, dou
  * extract elevation offsets from. In this situation the Z passed into the
  * transformation function is assumed to be height above ground. This option
  * should be used in replacement of RPC_HEIGHT to provide a way of defining
- * a non uniform ground for the target scene (GDAL >= 1.8.0)
+ * a non uniform ground for the target scene (GDAL >= 1.8.0). The DEM is
+ * read by tiles kept in memory, within the limit in megabytes set by the
+ * GDAL_RPC_DEM_CACHE_SIZE configuration option (64 by default).
  *
  * <li> RPC_DEMINTERPOLATION: the DEM interpolation (near, bilinear or cubic)
  * </ul>
@@ -556,81 +686,187 @@ void GDALDestroyRPCTransformer( void *pTransformAlg )
     if(psTransform->poCT)
         OCTDestroyCoordinateTransformation((OGRCoordinateTransformationH)psTransform->poCT);
 
+    if( psTransform->papadfDEMTiles != NULL )
+    {
+        for( int i = 0; i < psTransform->nDEMTilesX * psTransform->nDEMTilesY; i++ )
+            VSIFree( psTransform->papadfDEMTiles[i] );
+    }
+    CPLFree( psTransform->papadfDEMTiles );
+    CPLFree( psTransform->panDEMTileLastUse );
+    CPLFree( psTransform->panDEMLoadedTiles );
+
     CPLFree( pTransformAlg );
 }
 
 /************************************************************************/
-/*                      RPCInverseTransformPoint()                      */
+/*                      RPCInverseTransformPoints()                     */
+/*                                                                      */
+/*      Batched inverse transformation of the points whose panMask      */
+/*      flag is set.  This uses an iterative method from an initial     */
+/*      approximation: all the points still iterating are evaluated     */
+/*      with a single RPCTransformPoints() call.                        */
+/*                                                                      */
+/*      The initial approximation is padfLong/padfLat if bUseSeed is    */
+/*      set.  Otherwise every RPC_INVERSE_SEED_STEP-th point is         */
+/*      computed first from the affine approximation, and the other     */
+/*      points start from the solution of that neighbour, corrected     */
+/*      by the affine approximation of their offset.  They then         */
+/*      typically converge in one or two iterations.                    */
 /************************************************************************/
 
-static void 
-RPCInverseTransformPoint( GDALRPCTransformInfo *psTransform,
-                          double dfPixel, double dfLine, double dfHeight, 
-                          double *pdfLong, double *pdfLat )
+#define RPC_INVERSE_SEED_STEP 16
+
+static void RPCInverseIterate( GDALRPCTransformInfo *psTransform,
+                               int nPoints, const double *padfPixel,
+                               const double *padfLine,
+                               const double *padfHeight,
+                               const int *panMask,
+                               double *padfLong, double *padfLat,
+                               int *panConverged )
 
 {
-    double dfResultX, dfResultY;
-    int    iIter;
     GDALRPCInfo *psRPC = &(psTransform->sRPC);
+    const double *padfGT = psTransform->adfPLToLatLongGeoTransform;
+    int *panActive = (int *) CPLMalloc( sizeof(int) * nPoints );
+    double *padfBackPixel = (double *) CPLMalloc( sizeof(double) * nPoints );
+    double *padfBackLine = (double *) CPLMalloc( sizeof(double) * nPoints );
+    int i, iIter, nActive = 0;
 
-/* -------------------------------------------------------------------- */
-/*      Compute an initial approximation based on linear                */
-/*      interpolation from our reference point.                         */
-/* -------------------------------------------------------------------- */
-    dfResultX = psTransform->adfPLToLatLongGeoTransform[0]
-        + psTransform->adfPLToLatLongGeoTransform[1] * dfPixel
-        + psTransform->adfPLToLatLongGeoTransform[2] * dfLine;
+    for( i = 0; i < nPoints; i++ )
+    {
+        panActive[i] = panMask[i];
+        if( panActive[i] )
+            nActive ++;
+    }
+
+    if( panConverged != NULL )
+        memset( panConverged, 0, sizeof(int) * nPoints );
+
+    for( iIter = 0; iIter < 10 && nActive > 0; iIter++ )
+    {
+        RPCTransformPoints( psRPC, nPoints, padfLong, padfLat, padfHeight,
+                            panActive, padfBackPixel, padfBackLine );
+
+        for( i = 0; i < nPoints; i++ )
+        {
+            if( !panActive[i] )
+                continue;
+
+            double dfPixelDeltaX = padfBackPixel[i] - padfPixel[i];
+            double dfPixelDeltaY = padfBackLine[i] - padfLine[i];
+
+            padfLong[i] = padfLong[i]
+                - dfPixelDeltaX * padfGT[1]
+                - dfPixelDeltaY * padfGT[2];
+            padfLat[i] = padfLat[i]
+                - dfPixelDeltaX * padfGT[4]
+                - dfPixelDeltaY * padfGT[5];
+
+            if( ABS(dfPixelDeltaX) < psTransform->dfPixErrThreshold
+                && ABS(dfPixelDeltaY) < psTransform->dfPixErrThreshold )
+            {
+                panActive[i] = FALSE;
+                nActive --;
+                if( panConverged != NULL )
+                    panConverged[i] = TRUE;
+            }
+        }
+    }
+
+    CPLFree( panActive );
+    CPLFree( padfBackPixel );
+    CPLFree( padfBackLine );
+}
 
-    dfResultY = psTransform->adfPLToLatLongGeoTransform[3]
-        + psTransform->adfPLToLatLongGeoTransform[4] * dfPixel
-        + psTransform->adfPLToLatLongGeoTransform[5] * dfLine;
+static void RPCInverseTransformPoints( GDALRPCTransformInfo *psTransform,
+                                       int nPoints,
+                                       const double *padfPixel,
+                                       const double *padfLine,
+                                       const double *padfHeight,
+                                       const int *panMask, int bUseSeed,
+                                       double *padfLong, double *padfLat )
+
+{
+    const double *padfGT = psTransform->adfPLToLatLongGeoTransform;
+    int i;
+
+    if( bUseSeed )
+    {
+        RPCInverseIterate( psTransform, nPoints, padfPixel, padfLine,
+                           padfHeight, panMask, padfLong, padfLat, NULL );
+        return;
+    }
 
 /* -------------------------------------------------------------------- */
-/*      Now iterate, trying to find a closer LL location that will      */
-/*      back transform to the indicated pixel and line.                 */
+/*      Solve the seed points from the linear approximation from our    */
+/*      reference point.                                                */
 /* -------------------------------------------------------------------- */
-    double dfPixelDeltaX=0.0, dfPixelDeltaY=0.0;
+    int *panSeedMask = (int *) CPLMalloc( sizeof(int) * nPoints );
+    int *panConverged = (int *) CPLMalloc( sizeof(int) * nPoints );
 
-    for( iIter = 0; iIter < 10; iIter++ )
+    for( i = 0; i < nPoints; i++ )
     {
-        double dfBackPixel, dfBackLine;
+        panSeedMask[i] = panMask[i] && (i % RPC_INVERSE_SEED_STEP) == 0;
+        if( !panSeedMask[i] )
+            continue;
+
+        padfLong[i] = padfGT[0]
+            + padfGT[1] * padfPixel[i]
+            + padfGT[2] * padfLine[i];
+        padfLat[i] = padfGT[3]
+            + padfGT[4] * padfPixel[i]
+            + padfGT[5] * padfLine[i];
+    }
 
-        RPCTransformPoint( psRPC, dfResultX, dfResultY, dfHeight, 
-                           &dfBackPixel, &dfBackLine );
+    RPCInverseIterate( psTransform, nPoints, padfPixel, padfLine,
+                       padfHeight, panSeedMask, padfLong, padfLat,
+                       panConverged );
 
-        dfPixelDeltaX = dfBackPixel - dfPixel;
-        dfPixelDeltaY = dfBackLine - dfLine;
+/* -------------------------------------------------------------------- */
+/*      Then the other points from their seed.                          */
+/* -------------------------------------------------------------------- */
+    int iSeed = -1;
+    for( i = 0; i < nPoints; i++ )
+    {
+        if( panSeedMask[i] )
+        {
+            if( panConverged[i] )
+                iSeed = i;
+            panSeedMask[i] = FALSE;
+            continue;
+        }
 
-        dfResultX = dfResultX 
-            - dfPixelDeltaX * psTransform->adfPLToLatLongGeoTransform[1]
-            - dfPixelDeltaY * psTransform->adfPLToLatLongGeoTransform[2];
-        dfResultY = dfResultY 
-            - dfPixelDeltaX * psTransform->adfPLToLatLongGeoTransform[4]
-            - dfPixelDeltaY * psTransform->adfPLToLatLongGeoTransform[5];
+        panSeedMask[i] = panMask[i];
+        if( !panMask[i] )
+            continue;
 
-        if( ABS(dfPixelDeltaX) < psTransform->dfPixErrThreshold
-            && ABS(dfPixelDeltaY) < psTransform->dfPixErrThreshold )
+        if( iSeed >= 0 && i - iSeed < RPC_INVERSE_SEED_STEP )
         {
-            iIter = -1;
-            //CPLDebug( "RPC", "Converged!" );
-            break;
+            const double dfDeltaPixel = padfPixel[i] - padfPixel[iSeed];
+            const double dfDeltaLine = padfLine[i] - padfLine[iSeed];
+
+            padfLong[i] = padfLong[iSeed]
+                + padfGT[1] * dfDeltaPixel + padfGT[2] * dfDeltaLine;
+            padfLat[i] = padfLat[iSeed]
+                + padfGT[4] * dfDeltaPixel + padfGT[5] * dfDeltaLine;
+        }
+        else
+        {
+            padfLong[i] = padfGT[0]
+                + padfGT[1] * padfPixel[i]
+                + padfGT[2] * padfLine[i];
+            padfLat[i] = padfGT[3]
+                + padfGT[4] * padfPixel[i]
+                + padfGT[5] * padfLine[i];
         }
     }
 
-    if( iIter != -1 )
-    {
-#ifdef notdef
-        CPLDebug( "RPC", "Failed Iterations %d: Got: %g,%g  Offset=%g,%g", 
-                  iIter, 
-                  dfResultX, dfResultY,
-                  dfPixelDeltaX, dfPixelDeltaY );
-#endif
-    }
-    
-    *pdfLong = dfResultX;
-    *pdfLat = dfResultY;
-}
+    RPCInverseIterate( psTransform, nPoints, padfPixel, padfLine,
+                       padfHeight, panSeedMask, padfLong, padfLat, NULL );
 
+    CPLFree( panSeedMask );
+    CPLFree( panConverged );
+}
 
 static
 double BiCubicKernel(double dfVal)
@@ -652,79 +888,427 @@ double BiCubicKernel(double dfVal)
 }
 
 /************************************************************************/
-/*                          GDALRPCTransform()                          */
+/*                          GDALRPCOpenDEM()                            */
+/*                                                                      */
+/*      Lazy opening of the optionnal DEM file.                         */
 /************************************************************************/
 
-int GDALRPCTransform( void *pTransformArg, int bDstToSrc, 
-                      int nPointCount, 
-                      double *padfX, double *padfY, double *padfZ,
-                      int *panSuccess )
+static void GDALRPCOpenDEM( GDALRPCTransformInfo *psTransform )
 
 {
-    VALIDATE_POINTER1( pTransformArg, "GDALRPCTransform", 0 );
+    int bIsValid = FALSE;
+    psTransform->bHasTriedOpeningDS = TRUE;
+    psTransform->poDS = (GDALDataset *)
+                            GDALOpen( psTransform->pszDEMPath, GA_ReadOnly );
+    if(psTransform->poDS != NULL && psTransform->poDS->GetRasterCount() >= 1)
+    {
+        const char* pszSpatialRef = psTransform->poDS->GetProjectionRef();
+        if (pszSpatialRef != NULL && pszSpatialRef[0] != '\0')
+        {
+            OGRSpatialReference* poWGSSpaRef =
+                    new OGRSpatialReference(SRS_WKT_WGS84);
+            OGRSpatialReference* poDSSpaRef =
+                    new OGRSpatialReference(pszSpatialRef);
+            if(!poWGSSpaRef->IsSame(poDSSpaRef))
+                psTransform->poCT =OGRCreateCoordinateTransformation(
+                                                poWGSSpaRef, poDSSpaRef );
+            delete poWGSSpaRef;
+            delete poDSSpaRef;
+        }
 
-    GDALRPCTransformInfo *psTransform = (GDALRPCTransformInfo *) pTransformArg;
-    GDALRPCInfo *psRPC = &(psTransform->sRPC);
-    int i;
+        if (psTransform->poDS->GetGeoTransform(
+                            psTransform->adfGeoTransform) == CE_None &&
+            GDALInvGeoTransform( psTransform->adfGeoTransform,
+                                 psTransform->adfReverseGeoTransform ))
+        {
+            bIsValid = TRUE;
+        }
+    }
 
-    if( psTransform->bReversed )
-        bDstToSrc = !bDstToSrc;
+    if (!bIsValid && psTransform->poDS != NULL)
+    {
+        GDALClose(psTransform->poDS);
+        psTransform->poDS = NULL;
+    }
 
-    int bands[1] = {1};
-    int nRasterXSize = 0, nRasterYSize = 0;
+    if( psTransform->poDS == NULL )
+        return;
 
 /* -------------------------------------------------------------------- */
-/*      Lazy opening of the optionnal DEM file.                         */
+/*      Setup the tile cache of the DEM.                                */
 /* -------------------------------------------------------------------- */
-    if(psTransform->pszDEMPath != NULL &&
-       psTransform->bHasTriedOpeningDS == FALSE)
+    psTransform->dfDEMNoDataValue = psTransform->poDS->GetRasterBand(1)->
+        GetNoDataValue( &psTransform->bDEMHasNoData );
+    psTransform->nDEMTilesX =
+        (psTransform->poDS->GetRasterXSize() + RPC_DEM_TILE_SIZE - 1)
+        / RPC_DEM_TILE_SIZE;
+    psTransform->nDEMTilesY =
+        (psTransform->poDS->GetRasterYSize() + RPC_DEM_TILE_SIZE - 1)
+        / RPC_DEM_TILE_SIZE;
+
+    GIntBig nCacheSize = (GIntBig) atoi(
+        CPLGetConfigOption( "GDAL_RPC_DEM_CACHE_SIZE", "64" ) ) * 1024 * 1024;
+    GIntBig nMaxTiles = nCacheSize
+        / (RPC_DEM_TILE_SIZE * RPC_DEM_TILE_SIZE * (int) sizeof(double));
+    psTransform->nDEMMaxTiles = (int) MAX( 4, MIN( nMaxTiles, 1000000 ) );
+
+    psTransform->papadfDEMTiles = (double **) VSICalloc(
+        sizeof(double *), psTransform->nDEMTilesX * psTransform->nDEMTilesY );
+    psTransform->panDEMTileLastUse = (GUIntBig *) VSICalloc(
+        sizeof(GUIntBig), psTransform->nDEMTilesX * psTransform->nDEMTilesY );
+    psTransform->panDEMLoadedTiles = (int *) VSICalloc(
+        sizeof(int), psTransform->nDEMMaxTiles );
+    if( psTransform->papadfDEMTiles == NULL ||
+        psTransform->panDEMTileLastUse == NULL ||
+        psTransform->panDEMLoadedTiles == NULL )
+    {
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "Cannot allocate DEM tile cache" );
+        GDALClose(psTransform->poDS);
+        psTransform->poDS = NULL;
+    }
+}
+
+/************************************************************************/
+/*                         GDALRPCGetDEMTile()                          */
+/*                                                                      */
+/*      Return a tile of the DEM, of RPC_DEM_TILE_SIZE x                */
+/*      RPC_DEM_TILE_SIZE values (less on the right and bottom          */
+/*      borders, but always with a RPC_DEM_TILE_SIZE stride), loading   */
+/*      it and evicting the least recently used tile if needed.         */
+/************************************************************************/
+
+static const double *GDALRPCGetDEMTile( GDALRPCTransformInfo *psTransform,
+                                        int nTileX, int nTileY )
+
+{
+    const int iTile = nTileY * psTransform->nDEMTilesX + nTileX;
+    double *padfTile = psTransform->papadfDEMTiles[iTile];
+
+    psTransform->panDEMTileLastUse[iTile] = ++psTransform->nDEMTileCounter;
+    if( padfTile != NULL )
+        return padfTile;
+
+    int iSlot;
+    if( psTransform->nDEMTilesLoaded < psTransform->nDEMMaxTiles )
+    {
+        padfTile = (double *) VSIMalloc(
+            sizeof(double) * RPC_DEM_TILE_SIZE * RPC_DEM_TILE_SIZE );
+        if( padfTile == NULL )
+        {
+            CPLError( CE_Failure, CPLE_OutOfMemory,
+                      "Cannot allocate DEM tile" );
+            return NULL;
+        }
+        iSlot = psTransform->nDEMTilesLoaded ++;
+    }
+    else
+    {
+        /* Recycle the least recently used tile */
+        int i;
+        iSlot = 0;
+        for( i = 1; i < psTransform->nDEMTilesLoaded; i++ )
+        {
+            if( psTransform->panDEMTileLastUse[
+                    psTransform->panDEMLoadedTiles[i]] <
+                psTransform->panDEMTileLastUse[
+                    psTransform->panDEMLoadedTiles[iSlot]] )
+                iSlot = i;
+        }
+        const int iOldTile = psTransform->panDEMLoadedTiles[iSlot];
+        padfTile = psTransform->papadfDEMTiles[iOldTile];
+        psTransform->papadfDEMTiles[iOldTile] = NULL;
+    }
+
+    const int nXOff = nTileX * RPC_DEM_TILE_SIZE;
+    const int nYOff = nTileY * RPC_DEM_TILE_SIZE;
+    const int nXSize = MIN( RPC_DEM_TILE_SIZE,
+                            psTransform->poDS->GetRasterXSize() - nXOff );
+    const int nYSize = MIN( RPC_DEM_TILE_SIZE,
+                            psTransform->poDS->GetRasterYSize() - nYOff );
+    int bands[1] = {1};
+
+    if( psTransform->poDS->RasterIO( GF_Read, nXOff, nYOff, nXSize, nYSize,
+                                     padfTile, nXSize, nYSize, GDT_Float64,
+                                     1, bands, sizeof(double),
+                                     sizeof(double) * RPC_DEM_TILE_SIZE,
+                                     0 ) != CE_None )
+    {
+        /* Drop the slot */
+        VSIFree( padfTile );
+        psTransform->nDEMTilesLoaded --;
+        psTransform->panDEMLoadedTiles[iSlot] =
+            psTransform->panDEMLoadedTiles[psTransform->nDEMTilesLoaded];
+        return NULL;
+    }
+
+    psTransform->papadfDEMTiles[iTile] = padfTile;
+    psTransform->panDEMLoadedTiles[iSlot] = iTile;
+    return padfTile;
+}
+
+/************************************************************************/
+/*                        GDALRPCGetDEMWindow()                         */
+/*                                                                      */
+/*      Fetch a small window of the DEM, which must be within the       */
+/*      raster, from the tile cache.                                    */
+/************************************************************************/
+
+static int GDALRPCGetDEMWindow( GDALRPCTransformInfo *psTransform,
+                                int nX, int nY, int nWidth, int nHeight,
+                                double *padfOut )
+
+{
+    const int nTileX = nX / RPC_DEM_TILE_SIZE;
+    const int nTileY = nY / RPC_DEM_TILE_SIZE;
+    int i, j;
+
+    if( nTileX == (nX + nWidth - 1) / RPC_DEM_TILE_SIZE &&
+        nTileY == (nY + nHeight - 1) / RPC_DEM_TILE_SIZE )
+    {
+        const double *padfTile =
+            GDALRPCGetDEMTile( psTransform, nTileX, nTileY );
+        if( padfTile == NULL )
+            return FALSE;
+
+        padfTile += (nY - nTileY * RPC_DEM_TILE_SIZE) * RPC_DEM_TILE_SIZE
+                    + (nX - nTileX * RPC_DEM_TILE_SIZE);
+        for( j = 0; j < nHeight; j++ )
+            for( i = 0; i < nWidth; i++ )
+                padfOut[j * nWidth + i] = padfTile[j * RPC_DEM_TILE_SIZE + i];
+        return TRUE;
+    }
+
+    /* The window straddles several tiles */
+    for( j = 0; j < nHeight; j++ )
+    {
+        for( i = 0; i < nWidth; i++ )
+        {
+            const int nPixel = nX + i;
+            const int nLine = nY + j;
+            const double *padfTile =
+                GDALRPCGetDEMTile( psTransform, nPixel / RPC_DEM_TILE_SIZE,
+                                   nLine / RPC_DEM_TILE_SIZE );
+            if( padfTile == NULL )
+                return FALSE;
+
+            padfOut[j * nWidth + i] =
+                padfTile[(nLine % RPC_DEM_TILE_SIZE) * RPC_DEM_TILE_SIZE
+                         + nPixel % RPC_DEM_TILE_SIZE];
+        }
+    }
+    return TRUE;
+}
+
+/************************************************************************/
+/*                        GDALRPCGetDEMHeight()                         */
+/*                                                                      */
+/*      Interpolate the DEM at a location in its pixel/line space.      */
+/************************************************************************/
+
+static int GDALRPCGetDEMHeight( GDALRPCTransformInfo *psTransform,
+                                double dfX, double dfY, double *pdfDEMH )
+
+{
+    const int nRasterXSize = psTransform->poDS->GetRasterXSize();
+    const int nRasterYSize = psTransform->poDS->GetRasterYSize();
+    const int bGotNoDataValue = psTransform->bDEMHasNoData;
+    const double dfNoDataValue = psTransform->dfDEMNoDataValue;
+    int dX = int(dfX);
+    int dY = int(dfY);
+    double dfDeltaX = dfX - dX;
+    double dfDeltaY = dfY - dY;
+
+    if(psTransform->eResampleAlg == DRA_Cubic)
     {
-        int bIsValid = FALSE;
-        psTransform->bHasTriedOpeningDS = TRUE;
-        psTransform->poDS = (GDALDataset *)
-                                GDALOpen( psTransform->pszDEMPath, GA_ReadOnly );
-        if(psTransform->poDS != NULL && psTransform->poDS->GetRasterCount() >= 1)
+        int dXNew = dX - 1;
+        int dYNew = dY - 1;
+        if (!(dXNew >= 0 && dYNew >= 0 && dXNew + 4 <= nRasterXSize && dYNew + 4 <= nRasterYSize))
+            return FALSE;
+
+        //cubic interpolation
+        double adfElevData[16];
+        if( !GDALRPCGetDEMWindow( psTransform, dXNew, dYNew, 4, 4,
+                                  adfElevData ) )
+            return FALSE;
+
+        double dfSumH(0), dfSumWeight(0);
+        for ( int k_i = 0; k_i < 4; k_i++ )
         {
-            const char* pszSpatialRef = psTransform->poDS->GetProjectionRef();
-            if (pszSpatialRef != NULL && pszSpatialRef[0] != '\0')
+            // Loop across the X axis
+            for ( int k_j = 0; k_j < 4; k_j++ )
             {
-                OGRSpatialReference* poWGSSpaRef =
-                        new OGRSpatialReference(SRS_WKT_WGS84);
-                OGRSpatialReference* poDSSpaRef =
-                        new OGRSpatialReference(pszSpatialRef);
-                if(!poWGSSpaRef->IsSame(poDSSpaRef))
-                    psTransform->poCT =OGRCreateCoordinateTransformation(
-                                                    poWGSSpaRef, poDSSpaRef );
-                delete poWGSSpaRef;
-                delete poDSSpaRef;
+                // Calculate the weight for the specified pixel according
+                // to the bicubic b-spline kernel we're using for
+                // interpolation
+                int dKernIndX = k_j - 1;
+                int dKernIndY = k_i - 1;
+                double dfPixelWeight = BiCubicKernel(dKernIndX - dfDeltaX) * BiCubicKernel(dKernIndY - dfDeltaY);
+
+                // Create a sum of all values
+                // adjusted for the pixel's calculated weight
+                double dfElev = adfElevData[k_j + k_i * 4];
+                if( bGotNoDataValue && ARE_REAL_EQUAL(dfNoDataValue, dfElev) )
+                    continue;
+
+                dfSumH += dfElev * dfPixelWeight;
+                dfSumWeight += dfPixelWeight;
             }
+        }
+        if( dfSumWeight == 0.0 )
+            return FALSE;
 
-            if (psTransform->poDS->GetGeoTransform(
-                                psTransform->adfGeoTransform) == CE_None &&
-                GDALInvGeoTransform( psTransform->adfGeoTransform,
-                                     psTransform->adfReverseGeoTransform ))
+        *pdfDEMH = dfSumH / dfSumWeight;
+    }
+    else if(psTransform->eResampleAlg == DRA_Bilinear)
+    {
+        if (!(dX >= 0 && dY >= 0 && dX + 2 <= nRasterXSize && dY + 2 <= nRasterYSize))
+            return FALSE;
+
+        //bilinear interpolation
+        double adfElevData[4];
+        if( !GDALRPCGetDEMWindow( psTransform, dX, dY, 2, 2, adfElevData ) )
+            return FALSE;
+
+        if( bGotNoDataValue )
+        {
+            // TODO: we could perhaps use a valid sample if there's one
+            for(int k_i=0;k_i<4;k_i++)
             {
-                bIsValid = TRUE;
+                if( ARE_REAL_EQUAL(dfNoDataValue, adfElevData[k_i]) )
+                    return FALSE;
             }
         }
+        double dfDeltaX1 = 1.0 - dfDeltaX;                
+        double dfDeltaY1 = 1.0 - dfDeltaY;
+
+        double dfXZ1 = adfElevData[0] * dfDeltaX1 + adfElevData[1] * dfDeltaX;
+        double dfXZ2 = adfElevData[2] * dfDeltaX1 + adfElevData[3] * dfDeltaX;
+        *pdfDEMH = dfXZ1 * dfDeltaY1 + dfXZ2 * dfDeltaY;
+    }
+    else
+    {
+        if (!(dX >= 0 && dY >= 0 && dX < nRasterXSize && dY < nRasterYSize))
+            return FALSE;
+
+        if( !GDALRPCGetDEMWindow( psTransform, dX, dY, 1, 1, pdfDEMH ) ||
+            (bGotNoDataValue && ARE_REAL_EQUAL(dfNoDataValue, *pdfDEMH)) )
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                        GDALRPCGetDEMHeights()                        */
+/*                                                                      */
+/*      Fetch the DEM heights at the long/lat locations whose           */
+/*      panSuccess flag is set, and clear it where it is not possible.  */
+/************************************************************************/
+
+static void GDALRPCGetDEMHeights( GDALRPCTransformInfo *psTransform,
+                                  int nPointCount,
+                                  const double *padfLong,
+                                  const double *padfLat,
+                                  const double *padfZ,
+                                  int bCheck2x2, double *padfDEMH,
+                                  int *panSuccess )
+
+{
+    double *padfX = (double *) CPLMalloc( sizeof(double) * nPointCount );
+    double *padfY = (double *) CPLMalloc( sizeof(double) * nPointCount );
+    int i;
+
+    memcpy( padfX, padfLong, sizeof(double) * nPointCount );
+    memcpy( padfY, padfLat, sizeof(double) * nPointCount );
+
+    //check if dem is not in WGS84 and transform the points
+    if( psTransform->poCT )
+    {
+        double *padfZTmp = (double *) CPLMalloc( sizeof(double) * nPointCount );
+        int *panCTSuccess = (int *) CPLMalloc( sizeof(int) * nPointCount );
+
+        if( padfZ != NULL )
+            memcpy( padfZTmp, padfZ, sizeof(double) * nPointCount );
+        else
+            memset( padfZTmp, 0, sizeof(double) * nPointCount );
 
-        if (!bIsValid && psTransform->poDS != NULL)
+        if( !psTransform->poCT->TransformEx( nPointCount, padfX, padfY,
+                                             padfZTmp, panCTSuccess ) )
+            memset( panCTSuccess, 0, sizeof(int) * nPointCount );
+
+        for( i = 0; i < nPointCount; i++ )
         {
-            GDALClose(psTransform->poDS);
-            psTransform->poDS = NULL;
+            if( !panCTSuccess[i] )
+                panSuccess[i] = FALSE;
         }
+
+        CPLFree( padfZTmp );
+        CPLFree( panCTSuccess );
     }
-    
-    int bGotNoDataValue = FALSE;
-    double dfNoDataValue = 0;
 
-    if (psTransform->poDS)
+    const int nRasterXSize = psTransform->poDS->GetRasterXSize();
+    const int nRasterYSize = psTransform->poDS->GetRasterYSize();
+
+    for( i = 0; i < nPointCount; i++ )
     {
-        nRasterXSize = psTransform->poDS->GetRasterXSize();
-        nRasterYSize = psTransform->poDS->GetRasterYSize();
-        dfNoDataValue = psTransform->poDS->GetRasterBand(1)->GetNoDataValue( &bGotNoDataValue );
+        double dfX, dfY;
+
+        if( !panSuccess[i] )
+            continue;
+
+        GDALApplyGeoTransform( psTransform->adfReverseGeoTransform,
+                               padfX[i], padfY[i], &dfX, &dfY );
+
+        if( bCheck2x2 )
+        {
+            int dX = int(dfX);
+            int dY = int(dfY);
+
+            if (!(dX >= 0 && dY >= 0 &&
+                  dX+2 <= nRasterXSize && dY+2 <= nRasterYSize))
+            {
+                panSuccess[i] = FALSE;
+                continue;
+            }
+        }
+
+        if( !GDALRPCGetDEMHeight( psTransform, dfX, dfY, padfDEMH + i ) )
+            panSuccess[i] = FALSE;
     }
 
+    CPLFree( padfX );
+    CPLFree( padfY );
+}
+
+/************************************************************************/
+/*                          GDALRPCTransform()                          */
+/************************************************************************/
+
+int GDALRPCTransform( void *pTransformArg, int bDstToSrc, 
+                      int nPointCount, 
+                      double *padfX, double *padfY, double *padfZ,
+                      int *panSuccess )
+
+{
+    VALIDATE_POINTER1( pTransformArg, "GDALRPCTransform", 0 );
+
+    GDALRPCTransformInfo *psTransform = (GDALRPCTransformInfo *) pTransformArg;
+    GDALRPCInfo *psRPC = &(psTransform->sRPC);
+    int i;
+
+    if( psTransform->bReversed )
+        bDstToSrc = !bDstToSrc;
+
+    if(psTransform->pszDEMPath != NULL &&
+       psTransform->bHasTriedOpeningDS == FALSE)
+        GDALRPCOpenDEM( psTransform );
+
+    if( nPointCount <= 0 )
+        return TRUE;
+
+    double *padfHeight = (double *) CPLMalloc( sizeof(double) * nPointCount );
+
 /* -------------------------------------------------------------------- */
 /*      The simple case is transforming from lat/long to pixel/line.    */
 /*      Just apply the equations directly.                              */
@@ -732,330 +1316,90 @@ int GDALRPCTransform( void *pTransformArg, int bDstToSrc,
     if( bDstToSrc )
     {
         for( i = 0; i < nPointCount; i++ )
+            panSuccess[i] = TRUE;
+
+        if(psTransform->poDS)
         {
-            if(psTransform->poDS)
-            {
-                double dfX, dfY;
-                //check if dem is not in WGS84 and transform points padfX[i], padfY[i]
-                if(psTransform->poCT)
-                {
-                    double dfXOrig = padfX[i];
-                    double dfYOrig = padfY[i];
-                    double dfZOrig = padfZ[i];
-                    if (!psTransform->poCT->Transform(
-                                                1, &dfXOrig, &dfYOrig, &dfZOrig))
-                    {
-                        panSuccess[i] = FALSE;
-                        continue;
-                    }
-                    GDALApplyGeoTransform( psTransform->adfReverseGeoTransform,
-                                           dfXOrig, dfYOrig, &dfX, &dfY );
-                }
-                else
-                    GDALApplyGeoTransform( psTransform->adfReverseGeoTransform,
-                                           padfX[i], padfY[i], &dfX, &dfY );
-                int dX = int(dfX);
-                int dY = int(dfY);
-
-                if (!(dX >= 0 && dY >= 0 &&
-                      dX+2 <= nRasterXSize && dY+2 <= nRasterYSize))
-                {
-                    panSuccess[i] = FALSE;
-                    continue;
-                }
+            GDALRPCGetDEMHeights( psTransform, nPointCount, padfX, padfY,
+                                  padfZ, TRUE, padfHeight, panSuccess );
 
-                double dfDEMH(0);
-                double dfDeltaX = dfX - dX;
-                double dfDeltaY = dfY - dY;
-                
-                if(psTransform->eResampleAlg == DRA_Cubic)
-                {
-                    int dXNew = dX - 1;
-                    int dYNew = dY - 1;
-                    if (!(dXNew >= 0 && dYNew >= 0 && dXNew + 4 <= nRasterXSize && dYNew + 4 <= nRasterYSize))
-                    {
-                        panSuccess[i] = FALSE;
-                        continue;
-                    }
-                    //cubic interpolation
-                    double adfElevData[16] = {0};
-                    CPLErr eErr = psTransform->poDS->RasterIO(GF_Read, dXNew, dYNew, 4, 4,
-                                                              &adfElevData, 4, 4,
-                                                              GDT_Float64, 1, bands, 0, 0, 0);
-                    if(eErr != CE_None)
-                    {
-                        panSuccess[i] = FALSE;
-                        continue;
-                    }
-
-                    double dfSumH(0), dfSumWeight(0);
-                    for ( int k_i = 0; k_i < 4; k_i++ )
-                    {
-                        // Loop across the X axis
-                        for ( int k_j = 0; k_j < 4; k_j++ )
-                        {
-                            // Calculate the weight for the specified pixel according
-                            // to the bicubic b-spline kernel we're using for
-                            // interpolation
-                            int dKernIndX = k_j - 1;
-                            int dKernIndY = k_i - 1;
-                            double dfPixelWeight = BiCubicKernel(dKernIndX - dfDeltaX) * BiCubicKernel(dKernIndY - dfDeltaY);
-
-                            // Create a sum of all values
-                            // adjusted for the pixel's calculated weight
-                            double dfElev = adfElevData[k_j + k_i * 4];
-                            if( bGotNoDataValue && ARE_REAL_EQUAL(dfNoDataValue, dfElev) )
-                                continue;
-
-                            dfSumH += dfElev * dfPixelWeight;
-                            dfSumWeight += dfPixelWeight;
-                        }
-                    }
-                    if( dfSumWeight == 0.0 )
-                    {
-                        panSuccess[i] = FALSE;
-                        continue;
-                    }
-                    dfDEMH = dfSumH / dfSumWeight;
-                }
-                else if(psTransform->eResampleAlg == DRA_Bilinear)
-                {
-                    if (!(dX >= 0 && dY >= 0 && dX + 2 <= nRasterXSize && dY + 2 <= nRasterYSize))
-                    {
-                        panSuccess[i] = FALSE;
-                        continue;
-                    }
-                    //bilinear interpolation
-                    double adfElevData[4] = {0,0,0,0};
-                    CPLErr eErr = psTransform->poDS->RasterIO(GF_Read, dX, dY, 2, 2,
-                                                              &adfElevData, 2, 2,
-                                                              GDT_Float64, 1, bands, 0, 0, 0);
-                    if(eErr != CE_None)
-                    {
-                        panSuccess[i] = FALSE;
-                        continue;
-                    }
-                    if( bGotNoDataValue )
-                    {
-                        // TODO: we could perhaps use a valid sample if there's one
-                        int bFoundNoDataElev = FALSE;
-                        for(int k_i=0;k_i<4;k_i++)
-                        {
-                            if( ARE_REAL_EQUAL(dfNoDataValue, adfElevData[k_i]) )
-                                bFoundNoDataElev = TRUE;
-                        }
-                        if( bFoundNoDataElev )
-                        {
-                            panSuccess[i] = FALSE;
-                            continue;
-                        }
-                    }
-                    double dfDeltaX1 = 1.0 - dfDeltaX;                
-                    double dfDeltaY1 = 1.0 - dfDeltaY;
-
-                    double dfXZ1 = adfElevData[0] * dfDeltaX1 + adfElevData[1] * dfDeltaX;
-                    double dfXZ2 = adfElevData[2] * dfDeltaX1 + adfElevData[3] * dfDeltaX;
-                    double dfYZ = dfXZ1 * dfDeltaY1 + dfXZ2 * dfDeltaY;
-                    dfDEMH = dfYZ;
-                }
-                else
-                {
-                    if (!(dX >= 0 && dY >= 0 && dX < nRasterXSize && dY < nRasterYSize))
-                    {
-                        panSuccess[i] = FALSE;
-                        continue;
-                    }
-                    CPLErr eErr = psTransform->poDS->RasterIO(GF_Read, dX, dY, 1, 1,
-                                                              &dfDEMH, 1, 1,
-                                                              GDT_Float64, 1, bands, 0, 0, 0);
-                    if(eErr != CE_None ||
-                        (bGotNoDataValue && ARE_REAL_EQUAL(dfNoDataValue, dfDEMH)) )
-                    {
-                        panSuccess[i] = FALSE;
-                        continue;
-                    }              
-                }                
-
-                RPCTransformPoint( psRPC, padfX[i], padfY[i], 
-                                   padfZ[i] + (psTransform->dfHeightOffset + dfDEMH) *
-                                                psTransform->dfHeightScale, 
-                                   padfX + i, padfY + i );
+            for( i = 0; i < nPointCount; i++ )
+            {
+                if( panSuccess[i] )
+                    padfHeight[i] = padfZ[i] +
+                        (psTransform->dfHeightOffset + padfHeight[i]) *
+                        psTransform->dfHeightScale;
             }
-            else
-                RPCTransformPoint( psRPC, padfX[i], padfY[i], 
-                                   padfZ[i] + psTransform->dfHeightOffset *
-                                              psTransform->dfHeightScale, 
-                                   padfX + i, padfY + i );
-            panSuccess[i] = TRUE;
+        }
+        else
+        {
+            for( i = 0; i < nPointCount; i++ )
+                padfHeight[i] = padfZ[i] + psTransform->dfHeightOffset *
+                                           psTransform->dfHeightScale;
         }
 
+        RPCTransformPoints( psRPC, nPointCount, padfX, padfY, padfHeight,
+                            panSuccess, padfX, padfY );
+
+        CPLFree( padfHeight );
         return TRUE;
     }
 
 /* -------------------------------------------------------------------- */
 /*      Compute the inverse (pixel/line/height to lat/long).  This      */
 /*      function uses an iterative method from an initial linear        */
-/*      approximation.                                                  */
+/*      approximation.  With a DEM, the location found at the           */
+/*      reference height gives the DEM height, and is the starting      */
+/*      point of the iteration with that height.                        */
 /* -------------------------------------------------------------------- */
+    double *padfLong = (double *) CPLMalloc( sizeof(double) * nPointCount );
+    double *padfLat = (double *) CPLMalloc( sizeof(double) * nPointCount );
+
     for( i = 0; i < nPointCount; i++ )
     {
-        double dfResultX, dfResultY;
-
-        if(psTransform->poDS)
-        {
-            RPCInverseTransformPoint( psTransform, padfX[i], padfY[i], 
-                      padfZ[i] + psTransform->dfHeightOffset *
-                                 psTransform->dfHeightScale,
-                      &dfResultX, &dfResultY );
-
-            double dfX, dfY;
-            //check if dem is not in WGS84 and transform points padfX[i], padfY[i]
-            if(psTransform->poCT)
-            {
-                double dfZ = 0;
-                if (!psTransform->poCT->Transform(1, &dfResultX, &dfResultY, &dfZ))
-                {
-                    panSuccess[i] = FALSE;
-                    continue;
-                }
-            }
+        panSuccess[i] = TRUE;
+        padfHeight[i] = padfZ[i] + psTransform->dfHeightOffset *
+                                   psTransform->dfHeightScale;
+    }
 
-            GDALApplyGeoTransform( psTransform->adfReverseGeoTransform,
-                                    dfResultX, dfResultY, &dfX, &dfY );
-            int dX = int(dfX);
-            int dY = int(dfY);
+    RPCInverseTransformPoints( psTransform, nPointCount, padfX, padfY,
+                               padfHeight, panSuccess, FALSE,
+                               padfLong, padfLat );
 
-            double dfDEMH(0);
-            double dfDeltaX = dfX - dX;
-            double dfDeltaY = dfY - dY;
+    if(psTransform->poDS)
+    {
+        double *padfDEMH = (double *) CPLMalloc( sizeof(double) * nPointCount );
 
-            if(psTransform->eResampleAlg == DRA_Cubic)
-            {
-                int dXNew = dX - 1;
-                int dYNew = dY - 1;
-                if (!(dXNew >= 0 && dYNew >= 0 && dXNew + 4 <= nRasterXSize && dYNew + 4 <= nRasterYSize))
-                {
-                    panSuccess[i] = FALSE;
-                    continue;
-                }
-                //cubic interpolation
-                double adfElevData[16] = {0};
-                CPLErr eErr = psTransform->poDS->RasterIO(GF_Read, dXNew, dYNew, 4, 4,
-                                                          &adfElevData, 4, 4,
-                                                          GDT_Float64, 1, bands, 0, 0, 0);
-                if(eErr != CE_None)
-                {
-                    panSuccess[i] = FALSE;
-                    continue;
-                }
-
-                double dfSumH(0), dfSumWeight(0);
-                for ( int k_i = 0; k_i < 4; k_i++ )
-                {
-                    // Loop across the X axis
-                    for ( int k_j = 0; k_j < 4; k_j++ )
-                    {
-                        // Calculate the weight for the specified pixel according
-                        // to the bicubic b-spline kernel we're using for
-                        // interpolation
-                        int dKernIndX = k_j - 1;
-                        int dKernIndY = k_i - 1;
-                        double dfPixelWeight = BiCubicKernel(dKernIndX - dfDeltaX) * BiCubicKernel(dKernIndY - dfDeltaY);
-
-                        // Create a sum of all values
-                        // adjusted for the pixel's calculated weight
-                        double dfElev = adfElevData[k_j + k_i * 4];
-                        if( bGotNoDataValue && ARE_REAL_EQUAL(dfNoDataValue, dfElev) )
-                            continue;
-
-                        dfSumH += dfElev * dfPixelWeight;
-                        dfSumWeight += dfPixelWeight;
-                      }
-                }
-                if( dfSumWeight == 0.0 )
-                {
-                    panSuccess[i] = FALSE;
-                    continue;
-                }
-                dfDEMH = dfSumH / dfSumWeight;
-            }
-            else if(psTransform->eResampleAlg == DRA_Bilinear)
-            {
-                if (!(dX >= 0 && dY >= 0 && dX + 2 <= nRasterXSize && dY + 2 <= nRasterYSize))
-                {
-                    panSuccess[i] = FALSE;
-                    continue;
-                }
-                //bilinear interpolation
-                double adfElevData[4] = {0,0,0,0};
-                CPLErr eErr = psTransform->poDS->RasterIO(GF_Read, dX, dY, 2, 2,
-                                                          &adfElevData, 2, 2,
-                                                          GDT_Float64, 1, bands, 0, 0, 0);
-                if(eErr != CE_None)
-                {
-                    panSuccess[i] = FALSE;
-                    continue;
-                }
-                if( bGotNoDataValue )
-                {
-                    // TODO: we could perhaps use a valid sample if there's one
-                    int bFoundNoDataElev = FALSE;
-                    for(int k_i=0;k_i<4;k_i++)
-                    {
-                        if( ARE_REAL_EQUAL(dfNoDataValue, adfElevData[k_i]) )
-                            bFoundNoDataElev = TRUE;
-                    }
-                    if( bFoundNoDataElev )
-                    {
-                        panSuccess[i] = FALSE;
-                        continue;
-                    }
-                }
-                double dfDeltaX1 = 1.0 - dfDeltaX;                
-                double dfDeltaY1 = 1.0 - dfDeltaY;
-
-                double dfXZ1 = adfElevData[0] * dfDeltaX1 + adfElevData[1] * dfDeltaX;
-                double dfXZ2 = adfElevData[2] * dfDeltaX1 + adfElevData[3] * dfDeltaX;
-                double dfYZ = dfXZ1 * dfDeltaY1 + dfXZ2 * dfDeltaY;
-                dfDEMH = dfYZ;
-            }
-            else
-            {
-                if (!(dX >= 0 && dY >= 0 && dX < nRasterXSize && dY < nRasterYSize))
-                {
-                    panSuccess[i] = FALSE;
-                    continue;
-                }
-                CPLErr eErr = psTransform->poDS->RasterIO(GF_Read, dX, dY, 1, 1,
-                                                          &dfDEMH, 1, 1,
-                                                          GDT_Float64, 1, bands, 0, 0, 0);
-                if(eErr != CE_None ||
-                        (bGotNoDataValue && ARE_REAL_EQUAL(dfNoDataValue, dfDEMH)) )
-                {
-                    panSuccess[i] = FALSE;
-                    continue;
-                }           
-            }
+        GDALRPCGetDEMHeights( psTransform, nPointCount, padfLong, padfLat,
+                              NULL, FALSE, padfDEMH, panSuccess );
 
-            RPCInverseTransformPoint( psTransform, padfX[i], padfY[i], 
-                                      padfZ[i] + (psTransform->dfHeightOffset + dfDEMH) *
-                                                  psTransform->dfHeightScale,
-                                      &dfResultX, &dfResultY );
-        }
-        else
+        for( i = 0; i < nPointCount; i++ )
         {
-            RPCInverseTransformPoint( psTransform, padfX[i], padfY[i], 
-                                      padfZ[i] + psTransform->dfHeightOffset *
-                                                 psTransform->dfHeightScale,
-                                      &dfResultX, &dfResultY );
-
+            if( panSuccess[i] )
+                padfHeight[i] = padfZ[i] +
+                    (psTransform->dfHeightOffset + padfDEMH[i]) *
+                    psTransform->dfHeightScale;
         }
-        padfX[i] = dfResultX;
-        padfY[i] = dfResultY;
 
-        panSuccess[i] = TRUE;
+        RPCInverseTransformPoints( psTransform, nPointCount, padfX, padfY,
+                                   padfHeight, panSuccess, TRUE,
+                                   padfLong, padfLat );
+        CPLFree( padfDEMH );
+    }
+
+    for( i = 0; i < nPointCount; i++ )
+    {
+        if( !panSuccess[i] )
+            continue;
+
+        padfX[i] = padfLong[i];
+        padfY[i] = padfLat[i];
     }
 
+    CPLFree( padfLong );
+    CPLFree( padfLat );
+    CPLFree( padfHeight );
+
     return TRUE;
 }
 
@@ -39,6 +39,9 @@
 
 CPL_CVSID("$Id$");
 
+/* Above this number of GCPs, TPS_SOLVER=AUTO uses the local solver */
+#define TPS_DENSE_MAX_POINTS 2000
+
 CPL_C_START
 CPLXMLNode *GDALSerializeTPSTransformer( void *pTransformArg );
 void *GDALDeserializeTPSTransformer( CPLXMLNode *psTree );
@@ -57,6 +60,8 @@ typedef struct
 
     int       nGCPCount;
     GDAL_GCP *pasGCPList;
+
+    char    **papszOptions;
     
     volatile int nRefCount;
     
@@ -88,9 +93,10 @@ void* GDALCreateSimilarTPSTransformer( void *hTransformArg, double dfRatioX, dou
             pasGCPList[i].dfGCPPixel /= dfRatioX;
             pasGCPList[i].dfGCPLine /= dfRatioY;
         }
-        psInfo = (TPSTransformInfo *) GDALCreateTPSTransformer( psInfo->nGCPCount, pasGCPList,
-                                           psInfo->bReversed );
-        GDALDeinitGCPs( psInfo->nGCPCount, pasGCPList );
+        int nGCPCount = psInfo->nGCPCount;
+        psInfo = (TPSTransformInfo *) GDALCreateTPSTransformerInt( nGCPCount, pasGCPList,
+                                           psInfo->bReversed, psInfo->papszOptions );
+        GDALDeinitGCPs( nGCPCount, pasGCPList );
         CPLFree( pasGCPList );
     }
 
@@ -116,6 +122,24 @@ void* GDALCreateSimilarTPSTransformer( void *hTransformArg, double dfRatioX, dou
  * for large numbers of GCPs.  For instance, for reference, it takes on the 
  * order of 10s for 400 GCPs on a 2GHz Athlon processor. 
  *
+ * For large numbers of GCPs, a local solver can be requested instead of
+ * solving a single system.  The GCPs are then covered by overlapping
+ * patches of about 200 GCPs, each with its own spline, blended so that the
+ * transformation remains exact at the GCPs.  This scales to tens of
+ * thousands of GCPs, and the patches are solved in parallel if the
+ * NUM_THREADS transformer option or the GDAL_NUM_THREADS configuration
+ * option is set.  The result differs slightly from the single spline away
+ * from the GCPs.  The following transformer options (as accepted by
+ * GDALCreateGenImgProjTransformer2()) control it:
+ * <ul>
+ * <li> TPS_SOLVER: DENSE (default) to solve a single system, LOCAL to use
+ * patches, or AUTO to use patches beyond 2000 GCPs.
+ * <li> TPS_LOCAL_POINTS: approximate number of GCPs per patch (default 200).
+ * Larger values are more faithful to the global spline, but slower.
+ * <li> TPS_LOCAL_OVERLAP: size of a patch relative to the spacing of the
+ * patches (default 2).  Larger values give smoother transitions.
+ * </ul>
+ *
  * TPS Transformers are serializable. 
  *
  * The GDAL Thin Plate Spline transformer is based on code provided by
@@ -156,6 +180,7 @@ void *GDALCreateTPSTransformerInt( int nGCPCount, const GDAL_GCP *pasGCPList,
 
     psInfo->pasGCPList = GDALDuplicateGCPs( nGCPCount, pasGCPList );
     psInfo->nGCPCount = nGCPCount;
+    psInfo->papszOptions = CSLDuplicate( papszOptions );
 
     psInfo->bReversed = bReversed;
     psInfo->poForward = new VizGeorefSpline2D( 2 );
@@ -200,21 +225,50 @@ void *GDALCreateTPSTransformerInt( int nGCPCount, const GDAL_GCP *pasGCPList,
         const char* pszWarpThreads = CSLFetchNameValue(papszOptions, "NUM_THREADS");
         if (pszWarpThreads == NULL)
             pszWarpThreads = CPLGetConfigOption("GDAL_NUM_THREADS", "1");
-        if (EQUAL(pszWarpThreads, "ALL_CPUS"))
-            nThreads = CPLGetNumCPUs();
-        else
-            nThreads = atoi(pszWarpThreads);
+        nThreads = CPLGetNumThreadsFromOption(pszWarpThreads, 1);
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Use the local solver if requested.                              */
+/* -------------------------------------------------------------------- */
+    const char* pszSolver =
+        CSLFetchNameValueDef( papszOptions, "TPS_SOLVER", "DENSE" );
+    int bLocal;
+    if( EQUAL(pszSolver, "LOCAL") )
+        bLocal = TRUE;
+    else if( EQUAL(pszSolver, "AUTO") )
+        bLocal = nGCPCount > TPS_DENSE_MAX_POINTS;
+    else
+    {
+        if( !EQUAL(pszSolver, "DENSE") )
+            CPLError( CE_Warning, CPLE_NotSupported,
+                      "Unsupported value for TPS_SOLVER: %s", pszSolver );
+        bLocal = FALSE;
+    }
+
+    if( bLocal )
+    {
+        int nLocalPoints = atoi(
+            CSLFetchNameValueDef( papszOptions, "TPS_LOCAL_POINTS", "200" ) );
+        double dfOverlap = CPLAtof(
+            CSLFetchNameValueDef( papszOptions, "TPS_LOCAL_OVERLAP", "2" ) );
+        if( nLocalPoints < 10 )
+            nLocalPoints = 10;
+
+        psInfo->poForward->set_local_solver( nLocalPoints, dfOverlap );
+        psInfo->poReverse->set_local_solver( nLocalPoints, dfOverlap );
     }
 
+    psInfo->poForward->set_num_threads( nThreads );
+    psInfo->poReverse->set_num_threads( nThreads );
+
     if( nThreads > 1 )
     {
         /* Compute direct and reverse transforms in parallel */
-        void* hThread = CPLCreateJoinableThread(GDALTPSComputeForwardInThread, psInfo);
+        CPLJobGroup* psJobGroup = CPLCreateJobGroup();
+        CPLSubmitJob(psJobGroup, GDALTPSComputeForwardInThread, psInfo);
         psInfo->bReverseSolved = psInfo->poReverse->solve() != 0;
-        if( hThread != NULL )
-            CPLJoinThread(hThread);
-        else
-            psInfo->bForwardSolved = psInfo->poForward->solve() != 0;
+        CPLDestroyJobGroup(psJobGroup);
     }
     else
     {
@@ -259,6 +313,7 @@ void GDALDestroyTPSTransformer( void *pTransformArg )
 
         GDALDeinitGCPs( psInfo->nGCPCount, psInfo->pasGCPList );
         CPLFree( psInfo->pasGCPList );
+        CSLDestroy( psInfo->papszOptions );
         
         CPLFree( pTransformArg );
     }
@@ -343,6 +398,23 @@ CPLXMLNode *GDALSerializeTPSTransformer( void *pTransformArg )
         psTree, "Reversed", 
         CPLString().Printf( "%d", psInfo->bReversed ) );
                                  
+/* -------------------------------------------------------------------- */
+/*      Serialize the solver options.                                   */
+/* -------------------------------------------------------------------- */
+    static const char * const apszSolverOptions[] =
+        { "TPS_SOLVER", "TPS_LOCAL_POINTS", "TPS_LOCAL_OVERLAP" };
+    for( int i = 0; i < 3; i++ )
+    {
+        const char *pszValue =
+            CSLFetchNameValue( psInfo->papszOptions, apszSolverOptions[i] );
+        if( pszValue != NULL )
+        {
+            CPLXMLNode *psOption = CPLCreateXMLElementAndValue(
+                psTree, "Option", pszValue );
+            CPLSetXMLValue( psOption, "#key", apszSolverOptions[i] );
+        }
+    }
+
 /* -------------------------------------------------------------------- */
 /*	Attach GCP List. 						*/
 /* -------------------------------------------------------------------- */
@@ -387,10 +459,22 @@ void *GDALDeserializeTPSTransformer( CPLXMLNode *psTree )
 /* -------------------------------------------------------------------- */
     bReversed = atoi(CPLGetXMLValue(psTree,"Reversed","0"));
 
+    char **papszOptions = NULL;
+    for( CPLXMLNode *psIter = psTree->psChild; psIter != NULL;
+         psIter = psIter->psNext )
+    {
+        if( psIter->eType == CXT_Element && EQUAL(psIter->pszValue, "Option") )
+            papszOptions = CSLSetNameValue( papszOptions,
+                                            CPLGetXMLValue(psIter, "key", ""),
+                                            CPLGetXMLValue(psIter, NULL, "") );
+    }
+
 /* -------------------------------------------------------------------- */
 /*      Generate transformation.                                        */
 /* -------------------------------------------------------------------- */
-    pResult = GDALCreateTPSTransformer( nGCPCount, pasGCPList, bReversed );
+    pResult = GDALCreateTPSTransformerInt( nGCPCount, pasGCPList, bReversed,
+                                           papszOptions );
+    CSLDestroy( papszOptions );
     
 /* -------------------------------------------------------------------- */
 /*      Cleanup GCP copy.                                               */
@@ -1507,7 +1507,6 @@ struct _GDALGridJob
     int               (*pfnProgress)(GDALGridJob* psJob);
     GDALDataType        eType;
 
-    void           *hThread;
     volatile int   *pnCounter;
     volatile int   *pbStop;
     void           *hCond;
@@ -1643,8 +1642,10 @@ static void GDALGridJobProcess(void* user_data)
  *
  * Starting with GDAL 1.10, it is possible to set the GDAL_NUM_THREADS
  * configuration option to parallelize the processing. The value to set is
- * the number of worker threads, or ALL_CPUS to use all the cores/CPUs of the
- * computer (default value).
+ * the number of jobs the processing is split in, or ALL_CPUS to use all the
+ * cores/CPUs of the computer (default value). The jobs are executed by the
+ * process-wide thread pool, whose size is set by the GDAL_THREAD_POOL_SIZE
+ * configuration option.
  *
  * Starting with GDAL 1.10, on Intel/AMD i386/x86_64 architectures, some
  * gridding methods will be optimized with SSE instructions (provided GDAL
@@ -1909,14 +1910,8 @@ GDALGridCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
     sExtraParameters.pafY = pafYAligned;
     sExtraParameters.pafZ = pafZAligned;
 
-    const char* pszThreads = CPLGetConfigOption("GDAL_NUM_THREADS", "ALL_CPUS");
-    int nThreads;
-    if (EQUAL(pszThreads, "ALL_CPUS"))
-        nThreads = CPLGetNumCPUs();
-    else
-        nThreads = atoi(pszThreads);
-    if (nThreads > 128)
-        nThreads = 128;
+    int nThreads = CPLGetNumThreadsFromOption(
+        CPLGetConfigOption("GDAL_NUM_THREADS", "ALL_CPUS"), 1);
     if (nThreads >= (int)nYSize / 2)
         nThreads = (int)nYSize / 2;
 
@@ -1948,7 +1943,6 @@ GDALGridCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
     sJob.pbStop = &bStop;
     sJob.hCond = NULL;
     sJob.hCondMutex = NULL;
-    sJob.hThread = NULL;
 
     if( nThreads > 1 )
     {
@@ -1972,29 +1966,39 @@ GDALGridCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
         GDALGridJob* pasJobs = (GDALGridJob*) CPLMalloc(sizeof(GDALGridJob) * nThreads);
         int i;
 
-        CPLDebug("GDAL_GRID", "Using %d threads", nThreads);
+        CPLDebug("GDAL_GRID", "Using %d jobs", nThreads);
 
         sJob.nYStep = nThreads;
         sJob.hCondMutex = CPLCreateMutex(); /* and take implicitely the mutex */
         sJob.pfnProgress = GDALGridProgressMultiThread;
 
 /* -------------------------------------------------------------------- */
-/*      Start threads.                                                  */
+/*      Queue the jobs in the shared thread pool. The mutex must not    */
+/*      be held, as CPLSubmitJob() may run a job synchronously.         */
 /* -------------------------------------------------------------------- */
+        CPLJobGroup* psJobGroup = CPLCreateJobGroup();
+
+        CPLReleaseMutex(sJob.hCondMutex);
         for(i = 0; i < nThreads && !bStop; i++)
         {
             memcpy(&pasJobs[i], &sJob, sizeof(GDALGridJob));
             pasJobs[i].nYStart = i;
-            pasJobs[i].hThread = CPLCreateJoinableThread( GDALGridJobProcess,
-                                                          (void*) &pasJobs[i] );
+            CPLSubmitJob( psJobGroup, GDALGridJobProcess, (void*) &pasJobs[i] );
         }
+        CPLAcquireMutex(sJob.hCondMutex, 1.0);
 
 /* -------------------------------------------------------------------- */
-/*      Report progress.                                                */
+/*      Report progress. Jobs that no pool thread has started yet are   */
+/*      run by this thread rather than idling.                          */
 /* -------------------------------------------------------------------- */
         while(nCounter < (int)nYSize && !bStop)
         {
-            CPLCondWait(sJob.hCond, sJob.hCondMutex);
+            CPLReleaseMutex(sJob.hCondMutex);
+            int bRanJob = CPLRunPendingJob(psJobGroup);
+            CPLAcquireMutex(sJob.hCondMutex, 1.0);
+
+            if( !bRanJob && nCounter < (int)nYSize && !bStop )
+                CPLCondWait(sJob.hCond, sJob.hCondMutex);
 
             int nLocalCounter = nCounter;
             CPLReleaseMutex(sJob.hCondMutex);
@@ -2013,13 +2017,9 @@ GDALGridCreate( GDALGridAlgorithm eAlgorithm, const void *poOptions,
         CPLReleaseMutex(sJob.hCondMutex);
 
 /* -------------------------------------------------------------------- */
-/*      Wait for all threads to complete and finish.                    */
+/*      Wait for all jobs to complete and finish.                       */
 /* -------------------------------------------------------------------- */
-        for(i=0;i<nThreads;i++)
-        {
-            if( pasJobs[i].hThread )
-                CPLJoinThread(pasJobs[i].hThread);
-        }
+        CPLDestroyJobGroup(psJobGroup);
 
         CPLFree(pasJobs);
         CPLDestroyCond(sJob.hCond);
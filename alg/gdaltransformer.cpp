@@ -37,6 +37,12 @@
 #include "gdal_alg_priv.h"
 #include "cpl_list.h"
 #include "cpl_multiproc.h"
+#include <algorithm>
+#include <vector>
+
+#if defined(__x86_64) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 CPL_CVSID("$Id$");
 CPL_C_START
@@ -1152,6 +1158,9 @@ static GDALGenImgProjTransformInfo* GDALCreateGenImgProjTransformerInternal()
  * to georef transformation on the destination dataset.
  * <li> RPC_HEIGHT: A fixed height to be used with RPC calculations.
  * <li> RPC_DEM: The name of a DEM file to be used with RPC calculations.
+ * <li> TPS_SOLVER, TPS_LOCAL_POINTS, TPS_LOCAL_OVERLAP: control how the thin
+ * plate spline is solved for large numbers of GCPs. See
+ * GDALCreateTPSTransformer().
  * <li> INSERT_CENTER_LONG: May be set to FALSE to disable setting up a 
  * CENTER_LONG value on the coordinate system to rewrap things around the
  * center of the image.  
@@ -1708,6 +1717,83 @@ void GDALDestroyGenImgProjTransformer( void *hTransformArg )
     CPLFree( psInfo );
 }
 
+/************************************************************************/
+/*                   GDALApplyGeoTransformToPoints()                    */
+/*                                                                      */
+/*      Apply an affine geotransform to the points whose panSuccess     */
+/*      flag is set.  The SSE2 version processes two points at a time   */
+/*      with the same operation order as the scalar one, so that the    */
+/*      results are identical.                                          */
+/************************************************************************/
+
+static void GDALApplyGeoTransformToPoints( const double *padfGT,
+                                           int nPointCount,
+                                           double *padfX, double *padfY,
+                                           const int *panSuccess )
+
+{
+    int i = 0;
+
+#if defined(__x86_64) || defined(_M_X64)
+    const __m128d xmm_gt0 = _mm_set1_pd( padfGT[0] );
+    const __m128d xmm_gt1 = _mm_set1_pd( padfGT[1] );
+    const __m128d xmm_gt2 = _mm_set1_pd( padfGT[2] );
+    const __m128d xmm_gt3 = _mm_set1_pd( padfGT[3] );
+    const __m128d xmm_gt4 = _mm_set1_pd( padfGT[4] );
+    const __m128d xmm_gt5 = _mm_set1_pd( padfGT[5] );
+
+    for( ; i + 1 < nPointCount; i += 2 )
+    {
+        if( !panSuccess[i] || !panSuccess[i+1] )
+        {
+            /* Leave the pair to the scalar code below */
+            int j;
+            for( j = i; j < i + 2; j++ )
+            {
+                if( !panSuccess[j] )
+                    continue;
+                double dfNewX = padfGT[0]
+                    + padfX[j] * padfGT[1] + padfY[j] * padfGT[2];
+                double dfNewY = padfGT[3]
+                    + padfX[j] * padfGT[4] + padfY[j] * padfGT[5];
+                padfX[j] = dfNewX;
+                padfY[j] = dfNewY;
+            }
+            continue;
+        }
+
+        __m128d xmm_x = _mm_loadu_pd( padfX + i );
+        __m128d xmm_y = _mm_loadu_pd( padfY + i );
+        __m128d xmm_newx = _mm_add_pd(
+            _mm_add_pd( xmm_gt0, _mm_mul_pd( xmm_x, xmm_gt1 ) ),
+            _mm_mul_pd( xmm_y, xmm_gt2 ) );
+        __m128d xmm_newy = _mm_add_pd(
+            _mm_add_pd( xmm_gt3, _mm_mul_pd( xmm_x, xmm_gt4 ) ),
+            _mm_mul_pd( xmm_y, xmm_gt5 ) );
+        _mm_storeu_pd( padfX + i, xmm_newx );
+        _mm_storeu_pd( padfY + i, xmm_newy );
+    }
+#endif
+
+    for( ; i < nPointCount; i++ )
+    {
+        double dfNewX, dfNewY;
+
+        if( !panSuccess[i] )
+            continue;
+
+        dfNewX = padfGT[0]
+            + padfX[i] * padfGT[1]
+            + padfY[i] * padfGT[2];
+        dfNewY = padfGT[3]
+            + padfX[i] * padfGT[4]
+            + padfY[i] * padfGT[5];
+
+        padfX[i] = dfNewX;
+        padfY[i] = dfNewY;
+    }
+}
+
 /************************************************************************/
 /*                      GDALGenImgProjTransform()                       */
 /************************************************************************/
@@ -1791,26 +1877,9 @@ int GDALGenImgProjTransform( void *pTransformArg, int bDstToSrc,
     }
     else 
     {
-        for( i = 0; i < nPointCount; i++ )
-        {
-            double dfNewX, dfNewY;
-            
-            if( padfX[i] == HUGE_VAL || padfY[i] == HUGE_VAL )
-            {
-                panSuccess[i] = FALSE;
-                continue;
-            }
-
-            dfNewX = padfGeoTransform[0]
-                + padfX[i] * padfGeoTransform[1]
-                + padfY[i] * padfGeoTransform[2];
-            dfNewY = padfGeoTransform[3]
-                + padfX[i] * padfGeoTransform[4]
-                + padfY[i] * padfGeoTransform[5];
-            
-            padfX[i] = dfNewX;
-            padfY[i] = dfNewY;
-        }
+        /* panSuccess[] already flags the HUGE_VAL input points */
+        GDALApplyGeoTransformToPoints( padfGeoTransform, nPointCount,
+                                       padfX, padfY, panSuccess );
     }
 
 /* -------------------------------------------------------------------- */
@@ -1874,23 +1943,8 @@ int GDALGenImgProjTransform( void *pTransformArg, int bDstToSrc,
     }
     else
     {
-        for( i = 0; i < nPointCount; i++ )
-        {
-            double dfNewX, dfNewY;
-
-            if( !panSuccess[i] )
-                continue;
-            
-            dfNewX = padfGeoTransform[0]
-                + padfX[i] * padfGeoTransform[1]
-                + padfY[i] * padfGeoTransform[2];
-            dfNewY = padfGeoTransform[3]
-                + padfX[i] * padfGeoTransform[4]
-                + padfY[i] * padfGeoTransform[5];
-            
-            padfX[i] = dfNewX;
-            padfY[i] = dfNewY;
-        }
+        GDALApplyGeoTransformToPoints( padfGeoTransform, nPointCount,
+                                       padfX, padfY, panSuccess );
     }
         
     return TRUE;
@@ -2501,7 +2555,44 @@ GDALDeserializeReprojectionTransformer( CPLXMLNode *psTree )
 /* ==================================================================== */
 /************************************************************************/
 
-typedef struct 
+/* Number of entries of the direct mapped node and cell caches of the */
+/* interpolation grid. Must be a power of two. */
+#define APPROX_GRID_CACHE_BITS  14
+#define APPROX_GRID_CACHE_SIZE  (1 << APPROX_GRID_CACHE_BITS)
+
+#define APPROX_GRID_CELL_UNKNOWN      0
+#define APPROX_GRID_CELL_INTERPOLATE  1
+#define APPROX_GRID_CELL_EXACT        2
+
+typedef struct
+{
+    int     nI;
+    int     nJ;
+    int     bSet;
+    int     bSuccess;
+    double  dfX;
+    double  dfY;
+    double  dfZ;
+} ApproxGridNode;
+
+typedef struct
+{
+    int     nI;
+    int     nJ;
+    int     nState;
+} ApproxGridCell;
+
+/* Shared by the clones of a transformer, so that all the threads of a */
+/* warp benefit from the nodes already computed. */
+typedef struct
+{
+    void           *hMutex;
+    int             nRefCount;
+    ApproxGridNode *pasNodes;
+    ApproxGridCell *pasCells;
+} ApproxGridCache;
+
+typedef struct
 {
     GDALTransformerInfo sTI;
 
@@ -2510,8 +2601,414 @@ typedef struct
     double	      dfMaxError;
 
     int               bOwnSubtransformer;
+
+    int               nGridStep;
+    ApproxGridCache  *psGrid;
 } ApproxTransformInfo;
 
+/************************************************************************/
+/*                        GDALApproxGridCreate()                        */
+/************************************************************************/
+
+static ApproxGridCache *GDALApproxGridCreate()
+
+{
+    ApproxGridCache *psGrid = (ApproxGridCache *)
+        CPLCalloc( 1, sizeof(ApproxGridCache) );
+
+    psGrid->hMutex = CPLCreateMutex();
+    CPLReleaseMutex( psGrid->hMutex );
+    psGrid->nRefCount = 1;
+    psGrid->pasNodes = (ApproxGridNode *)
+        CPLCalloc( APPROX_GRID_CACHE_SIZE, sizeof(ApproxGridNode) );
+    psGrid->pasCells = (ApproxGridCell *)
+        CPLCalloc( APPROX_GRID_CACHE_SIZE, sizeof(ApproxGridCell) );
+
+    return psGrid;
+}
+
+/************************************************************************/
+/*                     GDALApproxGridReference()                        */
+/************************************************************************/
+
+static ApproxGridCache *GDALApproxGridReference( ApproxGridCache *psGrid )
+
+{
+    CPLMutexHolderD( &psGrid->hMutex );
+    psGrid->nRefCount ++;
+    return psGrid;
+}
+
+/************************************************************************/
+/*                      GDALApproxGridRelease()                         */
+/************************************************************************/
+
+static void GDALApproxGridRelease( ApproxGridCache *psGrid )
+
+{
+    int nRefCount;
+
+    {
+        CPLMutexHolderD( &psGrid->hMutex );
+        nRefCount = --psGrid->nRefCount;
+    }
+
+    if( nRefCount == 0 )
+    {
+        CPLDestroyMutex( psGrid->hMutex );
+        CPLFree( psGrid->pasNodes );
+        CPLFree( psGrid->pasCells );
+        CPLFree( psGrid );
+    }
+}
+
+/************************************************************************/
+/*                        GDALApproxGridSlot()                          */
+/************************************************************************/
+
+static CPL_INLINE int GDALApproxGridSlot( int nI, int nJ )
+
+{
+    GUInt32 nHash = (GUInt32) nI * 0x9E3779B1U + (GUInt32) nJ * 0x85EBCA77U;
+    return (int) (nHash >> (32 - APPROX_GRID_CACHE_BITS));
+}
+
+/************************************************************************/
+/*                    GDALApproxGridInterpolate()                       */
+/*                                                                      */
+/*      Bilinear interpolation in cell iCell of a row of nodes          */
+/*      stored as nNodes top nodes followed by nNodes bottom nodes.     */
+/************************************************************************/
+
+static CPL_INLINE double GDALApproxGridInterpolate( const double *padfNodes,
+                                                    int nNodes, int iCell,
+                                                    double dfU, double dfV )
+
+{
+    const double dfTop = padfNodes[iCell]
+        + (padfNodes[iCell+1] - padfNodes[iCell]) * dfU;
+    const double dfBottom = padfNodes[nNodes+iCell]
+        + (padfNodes[nNodes+iCell+1] - padfNodes[nNodes+iCell]) * dfU;
+
+    return dfTop + (dfBottom - dfTop) * dfV;
+}
+
+/************************************************************************/
+/*                    GDALApproxBaseTransformGroups()                   */
+/*                                                                      */
+/*      Transform with the base transformer a batch of points made of   */
+/*      consecutive groups of anGroupCounts[] points, in a single call. */
+/*      If that call fails, each group is transformed again on its own  */
+/*      from the original coordinates, so that a failure in one group   */
+/*      does not fail the others.  The per point success flags set by   */
+/*      the transformer are kept, and the result of the call for the    */
+/*      group of each point is optionally returned in panGroupSuccess.  */
+/*      Returns FALSE if the call failed for any group.                 */
+/************************************************************************/
+
+static int GDALApproxBaseTransformGroups( ApproxTransformInfo *psATInfo,
+                                          int bDstToSrc,
+                                          const std::vector<int> &anGroupCounts,
+                                          double *x, double *y, double *z,
+                                          int *panSuccess,
+                                          int *panGroupSuccess )
+
+{
+    const int nGroups = (int) anGroupCounts.size();
+    int iGroup, nPoints = 0;
+
+    for( iGroup = 0; iGroup < nGroups; iGroup++ )
+        nPoints += anGroupCounts[iGroup];
+
+    if( nPoints == 0 )
+        return TRUE;
+
+    std::vector<double> adfSaveX, adfSaveY, adfSaveZ;
+    if( nGroups > 1 )
+    {
+        adfSaveX.assign( x, x + nPoints );
+        adfSaveY.assign( y, y + nPoints );
+        adfSaveZ.assign( z, z + nPoints );
+    }
+
+    std::fill( panSuccess, panSuccess + nPoints, FALSE );
+    int bSuccess = psATInfo->pfnBaseTransformer( psATInfo->pBaseCBData,
+                                                 bDstToSrc, nPoints,
+                                                 x, y, z, panSuccess );
+
+    if( !bSuccess && nGroups > 1 )
+    {
+        std::copy( adfSaveX.begin(), adfSaveX.end(), x );
+        std::copy( adfSaveY.begin(), adfSaveY.end(), y );
+        std::copy( adfSaveZ.begin(), adfSaveZ.end(), z );
+        std::fill( panSuccess, panSuccess + nPoints, FALSE );
+
+        bSuccess = TRUE;
+        int iStart = 0;
+        for( iGroup = 0; iGroup < nGroups; iGroup++ )
+        {
+            const int nCount = anGroupCounts[iGroup];
+            int bGroupSuccess = TRUE;
+
+            if( nCount > 0 )
+                bGroupSuccess =
+                    psATInfo->pfnBaseTransformer( psATInfo->pBaseCBData,
+                                                  bDstToSrc, nCount,
+                                                  x + iStart, y + iStart,
+                                                  z + iStart,
+                                                  panSuccess + iStart );
+            if( panGroupSuccess != NULL )
+                panGroupSuccess[iGroup] = bGroupSuccess;
+            bSuccess &= bGroupSuccess;
+            iStart += nCount;
+        }
+    }
+    else if( panGroupSuccess != NULL )
+    {
+        std::fill( panGroupSuccess, panGroupSuccess + nGroups, bSuccess );
+    }
+
+    return bSuccess;
+}
+
+static int GDALApproxTransformSegments( ApproxTransformInfo *psATInfo,
+                                        int bDstToSrc,
+                                        const std::vector<int> &anRuns,
+                                        double *x, double *y, double *z,
+                                        int *panSuccess );
+
+/************************************************************************/
+/*                       GDALApproxTransformGrid()                      */
+/*                                                                      */
+/*      Transform a scanline by bilinear interpolation in a grid of     */
+/*      exactly transformed nodes, nGridStep pixels apart.  A cell is   */
+/*      interpolated if its 4 nodes could be transformed and if the     */
+/*      error at its center is within dfMaxError, otherwise its points  */
+/*      are approximated along the scanline as without the grid.        */
+/*                                                                      */
+/*      Returns -1 if the points are not suitable for the grid.         */
+/************************************************************************/
+
+static int GDALApproxTransformGrid( ApproxTransformInfo *psATInfo,
+                                    int nPoints,
+                                    double *x, double *y, double *z,
+                                    int *panSuccess )
+
+{
+    ApproxGridCache *psGrid = psATInfo->psGrid;
+    const double dfStep = psATInfo->nGridStep;
+    int i, k;
+
+    if( !(fabs(y[0]) < 1e9) )
+        return -1;
+
+    const int nJ = (int) floor(y[0] / dfStep);
+    int nIMin = 0, nIMax = 0;
+
+    for( i = 0; i < nPoints; i++ )
+    {
+        if( !(fabs(x[i]) < 1e9) )
+            return -1;
+
+        const int nI = (int) floor(x[i] / dfStep);
+        if( i == 0 || nI < nIMin )
+            nIMin = nI;
+        if( i == 0 || nI > nIMax )
+            nIMax = nI;
+    }
+
+    // Not worth it for sparse points.
+    const int nCells = nIMax - nIMin + 1;
+    if( nCells > nPoints )
+        return -1;
+
+    const int nNodes = nCells + 1;
+    std::vector<double> adfNodeX(2 * nNodes), adfNodeY(2 * nNodes);
+    std::vector<double> adfNodeZ(2 * nNodes);
+    std::vector<int>    anNodeSuccess(2 * nNodes), anNodeRequest(2 * nNodes, -1);
+    std::vector<int>    anCellState(nCells), anCellRequest(nCells, -1);
+    std::vector<double> adfReqX, adfReqY, adfReqZ;
+
+/* -------------------------------------------------------------------- */
+/*      Fetch the nodes and cells from the cache, and list the missing  */
+/*      ones.  Cells need their center to be transformed to estimate    */
+/*      the interpolation error.                                        */
+/* -------------------------------------------------------------------- */
+    {
+        CPLMutexHolderD( &psGrid->hMutex );
+
+        for( k = 0; k < 2 * nNodes; k++ )
+        {
+            const int nI = nIMin + k % nNodes;
+            const int nJNode = nJ + k / nNodes;
+            const ApproxGridNode *psNode =
+                psGrid->pasNodes + GDALApproxGridSlot( nI, nJNode );
+
+            if( psNode->bSet && psNode->nI == nI && psNode->nJ == nJNode )
+            {
+                adfNodeX[k] = psNode->dfX;
+                adfNodeY[k] = psNode->dfY;
+                adfNodeZ[k] = psNode->dfZ;
+                anNodeSuccess[k] = psNode->bSuccess;
+            }
+            else
+            {
+                anNodeRequest[k] = (int) adfReqX.size();
+                adfReqX.push_back( nI * dfStep );
+                adfReqY.push_back( nJNode * dfStep );
+                adfReqZ.push_back( 0.0 );
+            }
+        }
+
+        for( k = 0; k < nCells; k++ )
+        {
+            const int nI = nIMin + k;
+            const ApproxGridCell *psCell =
+                psGrid->pasCells + GDALApproxGridSlot( nI, nJ );
+
+            if( psCell->nState != APPROX_GRID_CELL_UNKNOWN
+                && psCell->nI == nI && psCell->nJ == nJ )
+                anCellState[k] = psCell->nState;
+            else
+            {
+                anCellRequest[k] = (int) adfReqX.size();
+                adfReqX.push_back( (nI + 0.5) * dfStep );
+                adfReqY.push_back( (nJ + 0.5) * dfStep );
+                adfReqZ.push_back( 0.0 );
+            }
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Compute them, and store them in the cache.                      */
+/* -------------------------------------------------------------------- */
+    if( !adfReqX.empty() )
+    {
+        const int nRequests = (int) adfReqX.size();
+        std::vector<int> anReqSuccess(nRequests), anReqCallSuccess(nRequests);
+
+        /* On failure, each node or center is retried on its own */
+        GDALApproxBaseTransformGroups( psATInfo, TRUE,
+                                       std::vector<int>(nRequests, 1),
+                                       &adfReqX[0], &adfReqY[0], &adfReqZ[0],
+                                       &anReqSuccess[0],
+                                       &anReqCallSuccess[0] );
+        for( k = 0; k < nRequests; k++ )
+            anReqSuccess[k] &= anReqCallSuccess[k];
+
+        for( k = 0; k < 2 * nNodes; k++ )
+        {
+            const int iReq = anNodeRequest[k];
+            if( iReq < 0 )
+                continue;
+
+            adfNodeX[k] = adfReqX[iReq];
+            adfNodeY[k] = adfReqY[iReq];
+            adfNodeZ[k] = adfReqZ[iReq];
+            anNodeSuccess[k] = anReqSuccess[iReq];
+        }
+
+        for( k = 0; k < nCells; k++ )
+        {
+            const int iReq = anCellRequest[k];
+            if( iReq < 0 )
+                continue;
+
+            anCellState[k] = APPROX_GRID_CELL_EXACT;
+            if( anReqSuccess[iReq]
+                && anNodeSuccess[k] && anNodeSuccess[k+1]
+                && anNodeSuccess[nNodes+k] && anNodeSuccess[nNodes+k+1] )
+            {
+                const double dfError =
+                    fabs(GDALApproxGridInterpolate( &adfNodeX[0], nNodes, k,
+                                                    0.5, 0.5 )
+                         - adfReqX[iReq])
+                    + fabs(GDALApproxGridInterpolate( &adfNodeY[0], nNodes, k,
+                                                      0.5, 0.5 )
+                           - adfReqY[iReq]);
+
+                if( dfError <= psATInfo->dfMaxError )
+                    anCellState[k] = APPROX_GRID_CELL_INTERPOLATE;
+            }
+        }
+
+        CPLMutexHolderD( &psGrid->hMutex );
+
+        for( k = 0; k < 2 * nNodes; k++ )
+        {
+            if( anNodeRequest[k] < 0 )
+                continue;
+
+            const int nI = nIMin + k % nNodes;
+            const int nJNode = nJ + k / nNodes;
+            ApproxGridNode *psNode =
+                psGrid->pasNodes + GDALApproxGridSlot( nI, nJNode );
+
+            psNode->nI = nI;
+            psNode->nJ = nJNode;
+            psNode->bSet = TRUE;
+            psNode->bSuccess = anNodeSuccess[k];
+            psNode->dfX = adfNodeX[k];
+            psNode->dfY = adfNodeY[k];
+            psNode->dfZ = adfNodeZ[k];
+        }
+
+        for( k = 0; k < nCells; k++ )
+        {
+            if( anCellRequest[k] < 0 )
+                continue;
+
+            ApproxGridCell *psCell =
+                psGrid->pasCells + GDALApproxGridSlot( nIMin + k, nJ );
+
+            psCell->nI = nIMin + k;
+            psCell->nJ = nJ;
+            psCell->nState = anCellState[k];
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Interpolate, and collect the runs of points of the other        */
+/*      cells, which are approximated along the scanline instead.       */
+/* -------------------------------------------------------------------- */
+    const double dfV = (y[0] - nJ * dfStep) / dfStep;
+    std::vector<int> anRuns;
+
+    for( i = 0; i < nPoints; i++ )
+    {
+        const int nI = (int) floor(x[i] / dfStep);
+        const int iCell = nI - nIMin;
+
+        if( anCellState[iCell] != APPROX_GRID_CELL_INTERPOLATE )
+        {
+            if( !anRuns.empty()
+                && anRuns[anRuns.size()-2] + anRuns.back() == i )
+                anRuns.back() ++;
+            else
+            {
+                anRuns.push_back( i );
+                anRuns.push_back( 1 );
+            }
+            continue;
+        }
+
+        const double dfU = (x[i] - nI * dfStep) / dfStep;
+        x[i] = GDALApproxGridInterpolate( &adfNodeX[0], nNodes, iCell,
+                                          dfU, dfV );
+        y[i] = GDALApproxGridInterpolate( &adfNodeY[0], nNodes, iCell,
+                                          dfU, dfV );
+        z[i] = GDALApproxGridInterpolate( &adfNodeZ[0], nNodes, iCell,
+                                          dfU, dfV );
+        panSuccess[i] = TRUE;
+    }
+
+    if( anRuns.empty() )
+        return TRUE;
+
+    return GDALApproxTransformSegments( psATInfo, TRUE, anRuns,
+                                        x, y, z, panSuccess );
+}
+
 /************************************************************************/
 /*                  GDALCreateSimilarApproxTransformer()                */
 /************************************************************************/
@@ -2541,6 +3038,15 @@ void* GDALCreateSimilarApproxTransformer( void *hTransformArg, double dfSrcRatio
     }
     psClonedInfo->bOwnSubtransformer = TRUE;
 
+    /* A clone can share the already computed grid nodes */
+    if( psInfo->psGrid != NULL )
+    {
+        if( dfSrcRatioX == 1.0 && dfSrcRatioY == 1.0 )
+            psClonedInfo->psGrid = GDALApproxGridReference( psInfo->psGrid );
+        else
+            psClonedInfo->psGrid = GDALApproxGridCreate();
+    }
+
     return psClonedInfo;
 }
 
@@ -2603,7 +3109,8 @@ GDALSerializeApproxTransformer( void *pTransformArg )
  * otherwise the inputs points are split into two smaller sets, and the
  * function recursively called till a sufficiently small set of points if found
  * that the linear approximation is OK, or that all the points are exactly
- * computed. 
+ * computed.  All the segments of a given subdivision level are transformed
+ * with a single call to the high precision transformer.
  *
  * This function is very suitable for approximating transformation results
  * from output pixel/line space to input coordinates for warpers that operate
@@ -2611,6 +3118,15 @@ GDALSerializeApproxTransformer( void *pTransformArg )
  * circumstances as little internal validation is done, in order to keep things
  * fast. 
  *
+ * If the GDAL_APPROX_GRID_STEP configuration option is set to a number of
+ * pixels (for instance 32), destination to source transformations of
+ * scanlines are instead interpolated bilinearly in a grid of exactly
+ * transformed nodes spaced by that step.  The nodes are cached by the
+ * transformer (and shared with its clones), so they are computed only once
+ * for all the chunks of a warp.  In grid cells where the interpolation error
+ * at the cell center exceeds dfMaxError, the points are approximated along
+ * the scanline as usual.
+ *
  * @param pfnBaseTransformer the high precision transformer which should be
  * approximated. 
  * @param pBaseTransformArg the callback argument for the high precision 
@@ -2633,6 +3149,11 @@ void *GDALCreateApproxTransformer( GDALTransformerFunc pfnBaseTransformer,
     psATInfo->pBaseCBData = pBaseTransformArg;
     psATInfo->dfMaxError = dfMaxError;
     psATInfo->bOwnSubtransformer = FALSE;
+    psATInfo->nGridStep =
+        atoi(CPLGetConfigOption( "GDAL_APPROX_GRID_STEP", "0" ));
+    psATInfo->psGrid = NULL;
+    if( psATInfo->nGridStep > 0 && dfMaxError > 0.0 )
+        psATInfo->psGrid = GDALApproxGridCreate();
 
     memcpy( psATInfo->sTI.abySignature, GDAL_GTI2_SIGNATURE, strlen(GDAL_GTI2_SIGNATURE) );
     psATInfo->sTI.pszClassName = "GDALApproxTransformer";
@@ -2679,100 +3200,207 @@ void GDALDestroyApproxTransformer( void * pCBData )
     if( psATInfo->bOwnSubtransformer ) 
         GDALDestroyTransformer( psATInfo->pBaseCBData );
 
+    if( psATInfo->psGrid != NULL )
+        GDALApproxGridRelease( psATInfo->psGrid );
+
     CPLFree( pCBData );
 }
 
 /************************************************************************/
-/*                        GDALApproxTransform()                         */
+/*                    GDALApproxTransformSegments()                     */
+/*                                                                      */
+/*      Transform the runs of points listed in anRuns (pairs of first   */
+/*      point and count) by linear interpolation along each run,        */
+/*      subdividing the runs until the error is acceptable.             */
+/*                                                                      */
+/*      The segments are processed one subdivision level at a time,     */
+/*      so that the first, last and middle points of all the segments   */
+/*      of a level are transformed in a single call.  The transformed   */
+/*      end points of a segment are known from its parent, except the   */
+/*      last point of a first half.                                     */
 /************************************************************************/
 
-/**
- * Perform approximate transformation.
- *
- * Actually performs the approximate transformation described in 
- * GDALCreateApproxTransformer().  This function matches the 
- * GDALTransformerFunc() signature.  Details of the arguments are described
- * there. 
- */
- 
-int GDALApproxTransform( void *pCBData, int bDstToSrc, int nPoints, 
-                         double *x, double *y, double *z, int *panSuccess )
+typedef struct
+{
+    int     iStart;
+    int     nCount;
+    int     bFirstKnown;
+    int     bLastKnown;
+    double  adfFirst[3];
+    double  adfLast[3];
+} ApproxSegment;
+
+static int GDALApproxTransformSegments( ApproxTransformInfo *psATInfo,
+                                        int bDstToSrc,
+                                        const std::vector<int> &anRuns,
+                                        double *x, double *y, double *z,
+                                        int *panSuccess )
 
 {
-    ApproxTransformInfo *psATInfo = (ApproxTransformInfo *) pCBData;
-    double x2[3], y2[3], z2[3], dfDeltaX, dfDeltaY, dfError, dfDist, dfDeltaZ;
-    int nMiddle, anSuccess2[3], i, bSuccess;
+    double dfDeltaX, dfDeltaY, dfError, dfDist, dfDeltaZ;
+    int i, k, iSeg;
 
-    nMiddle = (nPoints-1)/2;
+    std::vector<ApproxSegment> asSegments, asNextSegments;
+    std::vector<int>    anExact;  /* pairs of first point and count */
+    std::vector<double> adfReqX, adfReqY, adfReqZ;
+    std::vector<int>    anReqSuccess, anReqIndex;
+    std::vector<int>    anReqCounts, anReqCallSuccess;
 
-/* -------------------------------------------------------------------- */
-/*      Bail if our preconditions are not met, or if error is not       */
-/*      acceptable.                                                     */
-/* -------------------------------------------------------------------- */
-    if( y[0] != y[nPoints-1] || y[0] != y[nMiddle]
-        || x[0] == x[nPoints-1] || x[0] == x[nMiddle]
-        || psATInfo->dfMaxError == 0.0 || nPoints <= 5 )
+    for( iSeg = 0; iSeg < (int) anRuns.size(); iSeg += 2 )
     {
-        return psATInfo->pfnBaseTransformer( psATInfo->pBaseCBData, bDstToSrc,
-                                             nPoints, x, y, z, panSuccess );
+        ApproxSegment sSegment;
+        sSegment.iStart = anRuns[iSeg];
+        sSegment.nCount = anRuns[iSeg+1];
+        sSegment.bFirstKnown = FALSE;
+        sSegment.bLastKnown = FALSE;
+        asSegments.push_back( sSegment );
     }
 
+    while( !asSegments.empty() )
+    {
+        const int nSegments = (int) asSegments.size();
+
+        adfReqX.resize( 0 );
+        adfReqY.resize( 0 );
+        adfReqZ.resize( 0 );
+        anReqIndex.assign( 3 * nSegments, -1 );
+        anReqCounts.assign( nSegments, 0 );
+        asNextSegments.resize( 0 );
+
+/* -------------------------------------------------------------------- */
+/*      Segments that do not meet our preconditions are transformed     */
+/*      exactly.  Otherwise list the points to transform.               */
+/* -------------------------------------------------------------------- */
+        for( iSeg = 0; iSeg < nSegments; iSeg++ )
+        {
+            const ApproxSegment *psSeg = &asSegments[iSeg];
+            const int iFirst = psSeg->iStart;
+            const int iMiddle = iFirst + (psSeg->nCount-1)/2;
+            const int iLast = iFirst + psSeg->nCount - 1;
+
+            if( y[iFirst] != y[iLast] || y[iFirst] != y[iMiddle]
+                || x[iFirst] == x[iLast] || x[iFirst] == x[iMiddle]
+                || psATInfo->dfMaxError == 0.0 || psSeg->nCount <= 5 )
+            {
+                anExact.push_back( iFirst );
+                anExact.push_back( psSeg->nCount );
+                anReqIndex[3*iSeg+1] = -2;
+                continue;
+            }
+
+            const int aiPoints[3] = { iFirst, iMiddle, iLast };
+            for( k = 0; k < 3; k++ )
+            {
+                if( (k == 0 && psSeg->bFirstKnown)
+                    || (k == 2 && psSeg->bLastKnown) )
+                    continue;
+
+                anReqIndex[3*iSeg+k] = (int) adfReqX.size();
+                anReqCounts[iSeg] ++;
+                adfReqX.push_back( x[aiPoints[k]] );
+                adfReqY.push_back( y[aiPoints[k]] );
+                adfReqZ.push_back( z[aiPoints[k]] );
+            }
+        }
+
 /* -------------------------------------------------------------------- */
-/*      Transform first, last and middle point.                         */
+/*      A failed call makes the segment transformed exactly.  On        */
+/*      failure, the points of each segment are retried on their own,   */
+/*      so that the other segments can still be approximated.          */
 /* -------------------------------------------------------------------- */
-    x2[0] = x[0];
-    y2[0] = y[0];
-    z2[0] = z[0];
-    x2[1] = x[nMiddle];
-    y2[1] = y[nMiddle];
-    z2[1] = z[nMiddle];
-    x2[2] = x[nPoints-1];
-    y2[2] = y[nPoints-1];
-    z2[2] = z[nPoints-1];
+        anReqCallSuccess.assign( nSegments, TRUE );
+        if( !adfReqX.empty() )
+        {
+            anReqSuccess.resize( adfReqX.size() );
+            GDALApproxBaseTransformGroups( psATInfo, bDstToSrc, anReqCounts,
+                                           &adfReqX[0], &adfReqY[0],
+                                           &adfReqZ[0], &anReqSuccess[0],
+                                           &anReqCallSuccess[0] );
+        }
 
-    bSuccess = 
-        psATInfo->pfnBaseTransformer( psATInfo->pBaseCBData, bDstToSrc, 3, 
-                                      x2, y2, z2, anSuccess2 );
-    if( !bSuccess || !anSuccess2[0] || !anSuccess2[1] || !anSuccess2[2] )
-        return psATInfo->pfnBaseTransformer( psATInfo->pBaseCBData, bDstToSrc,
-                                             nPoints, x, y, z, panSuccess );
-    
 /* -------------------------------------------------------------------- */
 /*      Is the error at the middle acceptable relative to an            */
 /*      interpolation of the middle position?                           */
 /* -------------------------------------------------------------------- */
-    dfDeltaX = (x2[2] - x2[0]) / (x[nPoints-1] - x[0]);
-    dfDeltaY = (y2[2] - y2[0]) / (x[nPoints-1] - x[0]);
-    dfDeltaZ = (z2[2] - z2[0]) / (x[nPoints-1] - x[0]);
+        for( iSeg = 0; iSeg < nSegments; iSeg++ )
+        {
+            const ApproxSegment *psSeg = &asSegments[iSeg];
+            const int nSegPoints = psSeg->nCount;
+            const int nMiddle = (nSegPoints-1)/2;
+            double *px = x + psSeg->iStart;
+            double *py = y + psSeg->iStart;
+            double *pz = z + psSeg->iStart;
+            double x2[3], y2[3], z2[3];
+            int    bSuccess = anReqCallSuccess[iSeg];
+
+            if( anReqIndex[3*iSeg+1] == -2 )
+                continue;
 
-    dfError = fabs((x2[0] + dfDeltaX * (x[nMiddle] - x[0])) - x2[1])
-        + fabs((y2[0] + dfDeltaY * (x[nMiddle] - x[0])) - y2[1]);
+            for( k = 0; k < 3; k++ )
+            {
+                const int iReq = anReqIndex[3*iSeg+k];
 
-    if( dfError > psATInfo->dfMaxError )
-    {
-#ifdef notdef
-        CPLDebug( "GDAL", "ApproxTransformer - "
-                  "error %g over threshold %g, subdivide %d points.",
-                  dfError, psATInfo->dfMaxError, nPoints );
-#endif
+                if( iReq >= 0 )
+                {
+                    x2[k] = adfReqX[iReq];
+                    y2[k] = adfReqY[iReq];
+                    z2[k] = adfReqZ[iReq];
+                    bSuccess &= anReqSuccess[iReq];
+                }
+                else
+                {
+                    const double *padfKnown =
+                        (k == 0) ? psSeg->adfFirst : psSeg->adfLast;
+                    x2[k] = padfKnown[0];
+                    y2[k] = padfKnown[1];
+                    z2[k] = padfKnown[2];
+                }
+            }
 
-        bSuccess = 
-            GDALApproxTransform( psATInfo, bDstToSrc, nMiddle, 
-                                 x, y, z, panSuccess );
-            
-        if( !bSuccess )
-            return FALSE;
+            if( !bSuccess )
+            {
+                anExact.push_back( psSeg->iStart );
+                anExact.push_back( nSegPoints );
+                continue;
+            }
 
-        bSuccess = 
-            GDALApproxTransform( psATInfo, bDstToSrc, nPoints - nMiddle,
-                                 x+nMiddle, y+nMiddle, z+nMiddle,
-                                 panSuccess+nMiddle );
+            dfDeltaX = (x2[2] - x2[0]) / (px[nSegPoints-1] - px[0]);
+            dfDeltaY = (y2[2] - y2[0]) / (px[nSegPoints-1] - px[0]);
+            dfDeltaZ = (z2[2] - z2[0]) / (px[nSegPoints-1] - px[0]);
 
-        if( !bSuccess )
-            return FALSE;
+            dfError = fabs((x2[0] + dfDeltaX * (px[nMiddle] - px[0])) - x2[1])
+                + fabs((y2[0] + dfDeltaY * (px[nMiddle] - px[0])) - y2[1]);
 
-        return TRUE;
-    }
+            if( dfError > psATInfo->dfMaxError )
+            {
+#ifdef notdef
+                CPLDebug( "GDAL", "ApproxTransformer - "
+                          "error %g over threshold %g, subdivide %d points.",
+                          dfError, psATInfo->dfMaxError, nSegPoints );
+#endif
+                ApproxSegment sHalf;
+
+                sHalf.iStart = psSeg->iStart;
+                sHalf.nCount = nMiddle;
+                sHalf.bFirstKnown = TRUE;
+                sHalf.bLastKnown = FALSE;
+                sHalf.adfFirst[0] = x2[0];
+                sHalf.adfFirst[1] = y2[0];
+                sHalf.adfFirst[2] = z2[0];
+                asNextSegments.push_back( sHalf );
+
+                sHalf.iStart = psSeg->iStart + nMiddle;
+                sHalf.nCount = nSegPoints - nMiddle;
+                sHalf.bLastKnown = TRUE;
+                sHalf.adfFirst[0] = x2[1];
+                sHalf.adfFirst[1] = y2[1];
+                sHalf.adfFirst[2] = z2[1];
+                sHalf.adfLast[0] = x2[2];
+                sHalf.adfLast[1] = y2[2];
+                sHalf.adfLast[2] = z2[2];
+                asNextSegments.push_back( sHalf );
+                continue;
+            }
 
 /* -------------------------------------------------------------------- */
 /*      Error is OK since this is just used to compute output bounds    */
@@ -2781,16 +3409,113 @@ int GDALApproxTransform( void *pCBData, int bDstToSrc, int nPoints,
 /*      should implement iterative searching to find a result within    */
 /*      our error threshold.                                            */
 /* -------------------------------------------------------------------- */
-    for( i = nPoints-1; i >= 0; i-- )
+            for( i = nSegPoints-1; i >= 0; i-- )
+            {
+                dfDist = (px[i] - px[0]);
+                py[i] = y2[0] + dfDeltaY * dfDist;
+                px[i] = x2[0] + dfDeltaX * dfDist;
+                pz[i] = z2[0] + dfDeltaZ * dfDist;
+                panSuccess[psSeg->iStart + i] = TRUE;
+            }
+        }
+
+        asSegments.swap( asNextSegments );
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Transform exactly the segments that could not be approximated.  */
+/* -------------------------------------------------------------------- */
+    if( anExact.empty() )
+        return TRUE;
+
+    if( anExact.size() == 2 )
+        return psATInfo->pfnBaseTransformer( psATInfo->pBaseCBData, bDstToSrc,
+                                             anExact[1],
+                                             x + anExact[0], y + anExact[0],
+                                             z + anExact[0],
+                                             panSuccess + anExact[0] );
+
+    std::vector<double> adfExactX, adfExactY, adfExactZ;
+    std::vector<int>    anExactSuccess, anExactCounts;
+
+    for( iSeg = 0; iSeg < (int) anExact.size(); iSeg += 2 )
+    {
+        adfExactX.insert( adfExactX.end(), x + anExact[iSeg],
+                          x + anExact[iSeg] + anExact[iSeg+1] );
+        adfExactY.insert( adfExactY.end(), y + anExact[iSeg],
+                          y + anExact[iSeg] + anExact[iSeg+1] );
+        adfExactZ.insert( adfExactZ.end(), z + anExact[iSeg],
+                          z + anExact[iSeg] + anExact[iSeg+1] );
+        anExactCounts.push_back( anExact[iSeg+1] );
+    }
+    anExactSuccess.resize( adfExactX.size() );
+
+    /* On failure, each segment is retried on its own, as they would have */
+    /* been transformed without batching. */
+    int bSuccess =
+        GDALApproxBaseTransformGroups( psATInfo, bDstToSrc, anExactCounts,
+                                       &adfExactX[0], &adfExactY[0],
+                                       &adfExactZ[0], &anExactSuccess[0],
+                                       NULL );
+
+    int iExact = 0;
+    for( iSeg = 0; iSeg < (int) anExact.size(); iSeg += 2 )
+    {
+        for( i = anExact[iSeg]; i < anExact[iSeg] + anExact[iSeg+1]; i++ )
+        {
+            x[i] = adfExactX[iExact];
+            y[i] = adfExactY[iExact];
+            z[i] = adfExactZ[iExact];
+            panSuccess[i] = anExactSuccess[iExact];
+            iExact ++;
+        }
+    }
+
+    return bSuccess;
+}
+
+/************************************************************************/
+/*                        GDALApproxTransform()                         */
+/************************************************************************/
+
+/**
+ * Perform approximate transformation.
+ *
+ * Actually performs the approximate transformation described in
+ * GDALCreateApproxTransformer().  This function matches the
+ * GDALTransformerFunc() signature.  Details of the arguments are described
+ * there.
+ */
+
+int GDALApproxTransform( void *pCBData, int bDstToSrc, int nPoints,
+                         double *x, double *y, double *z, int *panSuccess )
+
+{
+    ApproxTransformInfo *psATInfo = (ApproxTransformInfo *) pCBData;
+
+/* -------------------------------------------------------------------- */
+/*      Use the interpolation grid if enabled.                          */
+/* -------------------------------------------------------------------- */
+    if( psATInfo->psGrid != NULL && bDstToSrc && nPoints > 5 )
     {
-        dfDist = (x[i] - x[0]);
-        y[i] = y2[0] + dfDeltaY * dfDist;
-        x[i] = x2[0] + dfDeltaX * dfDist;
-        z[i] = z2[0] + dfDeltaZ * dfDist;
-        panSuccess[i] = TRUE;
+        const int nMiddle = (nPoints-1)/2;
+
+        if( y[0] == y[nPoints-1] && y[0] == y[nMiddle]
+            && z[0] == 0.0 && z[nPoints-1] == 0.0 && z[nMiddle] == 0.0 )
+        {
+            int nRet = GDALApproxTransformGrid( psATInfo, nPoints,
+                                                x, y, z, panSuccess );
+            if( nRet >= 0 )
+                return nRet;
+        }
     }
-    
-    return TRUE;
+
+    std::vector<int> anRuns(2);
+    anRuns[0] = 0;
+    anRuns[1] = nPoints;
+
+    return GDALApproxTransformSegments( psATInfo, bDstToSrc, anRuns,
+                                        x, y, z, panSuccess );
 }
 
 /************************************************************************/
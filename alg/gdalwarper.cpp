@@ -872,6 +872,15 @@ GDALWarpDstAlphaMasker( void *pMaskFuncArg, int nBandCount,
  * - NUM_THREADS: (GDAL >= 1.10) Can be set to a numeric value or ALL_CPUS to
  * set the number of threads to use to parallelize the computation part of the
  * warping. If not set, computation will be done in a single thread.
+ * The work is split in that number of jobs, executed by the process-wide
+ * thread pool whose size is set by the GDAL_THREAD_POOL_SIZE configuration
+ * option (ALL_CPUS by default).
+ *
+ * - PIPELINE_DEPTH: (GDAL >= 2.0) Number of chunks processed at the same time
+ * by GDALWarpOperation::ChunkAndWarpMulti(), 2 by default.  The warp memory
+ * limit is shared between those chunks.  While a chunk is read or written,
+ * the warp kernel runs on the others, so that with NUM_THREADS the thread
+ * pool does not idle at chunk boundaries.
  */
 
 /************************************************************************/
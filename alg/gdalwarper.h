@@ -326,6 +326,7 @@ public:
 /************************************************************************/
 
 typedef struct _GDALWarpChunk GDALWarpChunk;
+typedef struct _GDALWarpChunkJob GDALWarpChunkJob;
 
 class CPL_DLL GDALWarpOperation {
 private:
@@ -355,8 +356,28 @@ private:
 
     void            WipeChunkList();
     CPLErr          CollectChunkList( int nDstXOff, int nDstYOff, 
-                                      int nDstXSize, int nDstYSize );
+                                      int nDstXSize, int nDstYSize,
+                                      double dfMemoryLimit );
     void            ReportTiming( const char * );
+
+    CPLErr          WarpRegionInternal( int nDstXOff, int nDstYOff, 
+                                        int nDstXSize, int nDstYSize,
+                                        int nSrcXOff, int nSrcYOff,
+                                        int nSrcXSize, int nSrcYSize,
+                                        int nSrcXExtraSize, int nSrcYExtraSize,
+                                        double dfProgressBase, double dfProgressScale,
+                                        GDALWarpChunkJob *psJob );
+    CPLErr          WarpRegionToBufferInternal( int nDstXOff, int nDstYOff, 
+                                        int nDstXSize, int nDstYSize, 
+                                        void *pDataBuf, 
+                                        GDALDataType eBufDataType,
+                                        int nSrcXOff, int nSrcYOff,
+                                        int nSrcXSize, int nSrcYSize,
+                                        int nSrcXExtraSize, int nSrcYExtraSize,
+                                        double dfProgressBase, double dfProgressScale,
+                                        GDALWarpChunkJob *psJob );
+
+    static void     ChunkThreadMain( void *pThreadData );
     
 public:
                     GDALWarpOperation();
@@ -117,6 +117,7 @@ static CPLErr GWKNearestShort( GDALWarpKernel *poWK );
 static CPLErr GWKNearestNoMasksFloat( GDALWarpKernel *poWK );
 static CPLErr GWKNearestFloat( GDALWarpKernel *poWK );
 static CPLErr GWKAverageOrMode( GDALWarpKernel * );
+static CPLErr GWKResampleMasks4Sample( GDALWarpKernel * );
 
 /************************************************************************/
 /*                           GWKJobStruct                               */
@@ -126,7 +127,6 @@ typedef struct _GWKJobStruct GWKJobStruct;
 
 struct _GWKJobStruct
 {
-    void           *hThread;
     GDALWarpKernel *poWK;
     int             iYMin;
     int             iYMax;
@@ -192,7 +192,6 @@ static CPLErr GWKGenericMonoThread( GDALWarpKernel *poWK,
     sThreadJob.pbStop = &bStop;
     sThreadJob.hCond = NULL;
     sThreadJob.hCondMutex = NULL;
-    sThreadJob.hThread = NULL;
     sThreadJob.pfnProgress = GWKProgressMonoThread;
     sThreadJob.pTransformerArg = poWK->pTransformerArg;
 
@@ -227,15 +226,9 @@ static CPLErr GWKRun( GDALWarpKernel *poWK,
     }
 
     const char* pszWarpThreads = CSLFetchNameValue(poWK->papszWarpOptions, "NUM_THREADS");
-    int nThreads;
     if (pszWarpThreads == NULL)
         pszWarpThreads = CPLGetConfigOption("GDAL_NUM_THREADS", "1");
-    if (EQUAL(pszWarpThreads, "ALL_CPUS"))
-        nThreads = CPLGetNumCPUs();
-    else
-        nThreads = atoi(pszWarpThreads);
-    if (nThreads > 128)
-        nThreads = 128;
+    int nThreads = CPLGetNumThreadsFromOption(pszWarpThreads, 1);
     if (nThreads >= nDstYSize / 2)
         nThreads = nDstYSize / 2;
 
@@ -294,7 +287,7 @@ static CPLErr GWKRun( GDALWarpKernel *poWK,
             return GWKGenericMonoThread(poWK, pfnFunc);
         }
 
-        CPLDebug("WARP", "Using %d threads", nThreads);
+        CPLDebug("WARP", "Using %d jobs", nThreads);
 
         void* hCondMutex = CPLCreateMutex(); /* and take implicitely the mutex */
 
@@ -302,8 +295,9 @@ static CPLErr GWKRun( GDALWarpKernel *poWK,
         volatile int nCounter = 0;
 
 /* -------------------------------------------------------------------- */
-/*      Lannch worker threads                                           */
+/*      Queue the jobs in the shared thread pool.                       */
 /* -------------------------------------------------------------------- */
+        CPLJobGroup* psJobGroup = CPLCreateJobGroup();
         for(i=0;i<nThreads;i++)
         {
             pasThreadJob[i].poWK = poWK;
@@ -314,16 +308,26 @@ static CPLErr GWKRun( GDALWarpKernel *poWK,
             pasThreadJob[i].hCond = hCond;
             pasThreadJob[i].hCondMutex = hCondMutex;
             pasThreadJob[i].pfnProgress = GWKProgressThread;
-            pasThreadJob[i].hThread = CPLCreateJoinableThread( pfnFunc,
-                                                  (void*) &pasThreadJob[i] );
         }
+        /* Submitting with the mutex taken would block the jobs run */
+        /* synchronously by CPLSubmitJob() in GWKProgressThread() */
+        CPLReleaseMutex(hCondMutex);
+        for(i=0;i<nThreads;i++)
+            CPLSubmitJob( psJobGroup, pfnFunc, (void*) &pasThreadJob[i] );
+        CPLAcquireMutex(hCondMutex, 1000.0);
 
 /* -------------------------------------------------------------------- */
-/*      Report progress.                                                */
+/*      Report progress. Jobs that no pool thread has started yet are   */
+/*      run by this thread rather than idling.                          */
 /* -------------------------------------------------------------------- */
         while(nCounter < nDstYSize)
         {
-            CPLCondWait(hCond, hCondMutex);
+            CPLReleaseMutex(hCondMutex);
+            int bRanJob = CPLRunPendingJob(psJobGroup);
+            CPLAcquireMutex(hCondMutex, 1000.0);
+
+            if( !bRanJob && nCounter < nDstYSize )
+                CPLCondWait(hCond, hCondMutex);
 
             if( !poWK->pfnProgress( poWK->dfProgressBase + poWK->dfProgressScale *
                                     (nCounter / (double) nDstYSize),
@@ -340,13 +344,12 @@ static CPLErr GWKRun( GDALWarpKernel *poWK,
         CPLReleaseMutex(hCondMutex);
 
 /* -------------------------------------------------------------------- */
-/*      Wait for all threads to complete and finish.                    */
+/*      Wait for all jobs to complete and finish.                       */
 /* -------------------------------------------------------------------- */
+        CPLDestroyJobGroup(psJobGroup);
+
         for(i=0;i<nThreads;i++)
-        {
-            CPLJoinThread(pasThreadJob[i].hThread);
             GDALDestroyTransformer(pasThreadJob[i].pTransformerArg);
-        }
 
         CPLFree(pasThreadJob);
         CPLDestroyCond(hCond);
@@ -1015,6 +1018,12 @@ CPLErr GDALWarpKernel::PerformWarp()
         return GWKCubicNoMasksDouble( this );
 #endif
 
+    if( (eWorkingDataType == GDT_Byte || eWorkingDataType == GDT_Int16
+         || eWorkingDataType == GDT_UInt16 || eWorkingDataType == GDT_Float32)
+        && (eResample == GRA_Bilinear || eResample == GRA_Cubic)
+        && bUse4SamplesFormula && nSrcXSize > 1 && nSrcYSize > 1 )
+        return GWKResampleMasks4Sample( this );
+
     if( eResample == GRA_Average )
         return GWKAverageOrMode( this );
 
@@ -3870,6 +3879,794 @@ static void GWKGeneralCaseThread( void* pData)
         GWKResampleDeleteWrkStruct(psWrkStruct);
 }
 
+/* ==================================================================== */
+/*      Bilinear and cubic resampling with masks.                       */
+/*                                                                      */
+/*      GWKResampleMasks4Sample() implements the 4 samples formulas of  */
+/*      GWKBilinearResample4Sample() and GWKCubicResample4Sample() for  */
+/*      Byte, Int16, UInt16 and Float32 data with any combination of    */
+/*      validity and density masks, and produces the same output as     */
+/*      GWKGeneralCase().  The source position, the weights and the     */
+/*      unified validity and density of the kernel samples are          */
+/*      computed once per destination pixel and shared by all bands,    */
+/*      and the source samples are read with their native type.         */
+/*                                                                      */
+/*      Only the pixels whose kernel lies inside the source window are  */
+/*      handled here, the others go through the generic functions.  On  */
+/*      CPUs supporting AVX2, the cubic kernel processes 4 destination  */
+/*      pixels at a time with the same operations, in the same order,   */
+/*      as the scalar code so that the result does not depend on the    */
+/*      instruction set.  (The bilinear kernel has too few operations   */
+/*      per sample fetched to benefit from it.)  The GDAL_WARP_SIMD     */
+/*      configuration option can be set to NONE to disable the AVX2     */
+/*      kernels.                                                        */
+/* ==================================================================== */
+
+#if defined(__x86_64) || defined(_M_X64)
+#if defined(__GNUC__) && !defined(__clang__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define HAVE_AVX2_WARPKERNEL
+#define GWK_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && _MSC_VER >= 1800
+#define HAVE_AVX2_WARPKERNEL
+#define GWK_AVX2_TARGET
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#endif /* defined(__x86_64) || defined(_M_X64) */
+
+typedef struct
+{
+    int     iDstOffset;
+    double  dfDensity;      // Unified density of the nearest source pixel.
+    int     bInterior;      // Whole kernel inside the source window.
+    double  dfSrcX;         // Position relative to the source window.
+    double  dfSrcY;
+    int     iSrcOffset;     // Top left sample of the kernel.
+    double  adfMult[4];     // Bilinear weights: UL, UR, LL, LR.
+    double  dfDeltaX, dfDeltaX2, dfDeltaX3;
+    double  dfDeltaY, dfDeltaY2, dfDeltaY3;
+    double  adfUnified[16]; // Unified density of the samples, 0 if invalid.
+} GWKMaskedPixel;
+
+/************************************************************************/
+/*                       GWKUseAVX2Kernels()                            */
+/************************************************************************/
+
+static int GWKUseAVX2Kernels()
+{
+#ifdef HAVE_AVX2_WARPKERNEL
+    static int bUseAVX2 = -1;
+
+    if( bUseAVX2 < 0 )
+    {
+        int bAVX2;
+#if defined(__GNUC__)
+        __builtin_cpu_init();
+        bAVX2 = __builtin_cpu_supports("avx2");
+#else
+        int anCPUInfo[4];
+
+        /* Check OSXSAVE and AVX, and that the OS saves the YMM registers */
+        __cpuid(anCPUInfo, 1);
+        bAVX2 = (anCPUInfo[2] & (1 << 27)) != 0
+             && (anCPUInfo[2] & (1 << 28)) != 0
+             && (_xgetbv(0) & 6) == 6;
+        if( bAVX2 )
+        {
+            __cpuidex(anCPUInfo, 7, 0);
+            bAVX2 = (anCPUInfo[1] & (1 << 5)) != 0;
+        }
+#endif
+        const char* pszSIMD = CPLGetConfigOption("GDAL_WARP_SIMD", NULL);
+        if( pszSIMD != NULL &&
+            (EQUAL(pszSIMD, "NONE") || EQUAL(pszSIMD, "NO")) )
+            bAVX2 = FALSE;
+
+        CPLDebug( "WARP", "Masked cubic kernels use %s code.",
+                  bAVX2 ? "AVX2" : "scalar" );
+        bUseAVX2 = bAVX2 ? TRUE : FALSE;
+    }
+
+    return bUseAVX2;
+#else
+    return FALSE;
+#endif
+}
+
+/************************************************************************/
+/*                      GWKGetUnifiedDensity()                          */
+/************************************************************************/
+
+static CPL_INLINE double GWKGetUnifiedDensity( const GDALWarpKernel *poWK,
+                                               int iSrcOffset )
+{
+    if( poWK->panUnifiedSrcValid != NULL
+        && !(poWK->panUnifiedSrcValid[iSrcOffset>>5]
+             & (0x01 << (iSrcOffset & 0x1f))) )
+        return 0.0;
+
+    if( poWK->pafUnifiedSrcDensity != NULL )
+        return poWK->pafUnifiedSrcDensity[iSrcOffset];
+
+    return 1.0;
+}
+
+/************************************************************************/
+/*                       GWKGetBandDensity()                            */
+/************************************************************************/
+
+static CPL_INLINE double GWKGetBandDensity( const GUInt32 *panBandValid,
+                                            int iSrcOffset,
+                                            double dfUnifiedDensity )
+{
+    if( panBandValid != NULL
+        && !(panBandValid[iSrcOffset>>5] & (0x01 << (iSrcOffset & 0x1f))) )
+        return 0.0;
+
+    return dfUnifiedDensity;
+}
+
+/************************************************************************/
+/*                     GWKSetupMaskedPixel()                            */
+/*                                                                      */
+/*      Compute the band independent part of the kernel.                */
+/************************************************************************/
+
+template<GDALResampleAlg eResample>
+static void GWKSetupMaskedPixel( const GDALWarpKernel *poWK,
+                                 double dfSrcX, double dfSrcY,
+                                 GWKMaskedPixel *psPixel )
+{
+    const int nSrcXSize = poWK->nSrcXSize;
+    const int nSrcYSize = poWK->nSrcYSize;
+    int iSrcX, iSrcY, i;
+
+    psPixel->dfSrcX = dfSrcX;
+    psPixel->dfSrcY = dfSrcY;
+
+    if( eResample == GRA_Bilinear )
+    {
+        iSrcX = (int) floor(dfSrcX - 0.5);
+        iSrcY = (int) floor(dfSrcY - 0.5);
+        psPixel->bInterior = iSrcX >= 0 && iSrcX + 1 < nSrcXSize
+                          && iSrcY >= 0 && iSrcY + 1 < nSrcYSize;
+    }
+    else
+    {
+        iSrcX = (int) (dfSrcX - 0.5);
+        iSrcY = (int) (dfSrcY - 0.5);
+        psPixel->bInterior = iSrcX - 1 >= 0 && iSrcX + 2 < nSrcXSize
+                          && iSrcY - 1 >= 0 && iSrcY + 2 < nSrcYSize;
+    }
+    if( !psPixel->bInterior )
+        return;
+
+    // Same expressions as GWKBilinearResample4Sample(). For the cubic
+    // case they are used by the fallback on bilinear interpolation
+    // (iSrcX and iSrcY are positive, so truncation and floor() agree).
+    const double dfRatioX = 1.5 - (dfSrcX - iSrcX);
+    const double dfRatioY = 1.5 - (dfSrcY - iSrcY);
+    psPixel->adfMult[0] = dfRatioX * dfRatioY;
+    psPixel->adfMult[1] = (1.0-dfRatioX) * dfRatioY;
+    psPixel->adfMult[2] = dfRatioX * (1.0-dfRatioY);
+    psPixel->adfMult[3] = (1.0-dfRatioX) * (1.0-dfRatioY);
+
+    if( eResample == GRA_Bilinear )
+    {
+        psPixel->iSrcOffset = iSrcX + iSrcY * nSrcXSize;
+        for( i = 0; i < 4; i++ )
+            psPixel->adfUnified[i] = GWKGetUnifiedDensity( poWK,
+                psPixel->iSrcOffset + (i & 1) + (i >> 1) * nSrcXSize );
+    }
+    else
+    {
+        psPixel->dfDeltaX = dfSrcX - 0.5 - iSrcX;
+        psPixel->dfDeltaY = dfSrcY - 0.5 - iSrcY;
+        psPixel->dfDeltaX2 = psPixel->dfDeltaX * psPixel->dfDeltaX;
+        psPixel->dfDeltaY2 = psPixel->dfDeltaY * psPixel->dfDeltaY;
+        psPixel->dfDeltaX3 = psPixel->dfDeltaX2 * psPixel->dfDeltaX;
+        psPixel->dfDeltaY3 = psPixel->dfDeltaY2 * psPixel->dfDeltaY;
+
+        psPixel->iSrcOffset = iSrcX - 1 + (iSrcY - 1) * nSrcXSize;
+        for( i = 0; i < 16; i++ )
+            psPixel->adfUnified[i] = GWKGetUnifiedDensity( poWK,
+                psPixel->iSrcOffset + (i & 3) + (i >> 2) * nSrcXSize );
+    }
+}
+
+/************************************************************************/
+/*                     GWKBilinearMasks4SampleT()                       */
+/*                                                                      */
+/*      Returns the density, and the value in *pdfReal.                 */
+/************************************************************************/
+
+template<class T>
+static CPL_INLINE double GWKBilinearMasks4SampleT( const T *pSrc,
+                                                   const GUInt32 *panBandValid,
+                                                   int nSrcXSize,
+                                                   int iSrcOffset,
+                                                   const double *padfMult,
+                                                   const double *padfUnified,
+                                                   double *pdfReal )
+{
+    double  dfAccumulatorReal = 0.0;
+    double  dfAccumulatorDensity = 0.0;
+    double  dfAccumulatorDivisor = 0.0;
+
+    for( int i = 0; i < 4; i++ )
+    {
+        const int iOffset = iSrcOffset + (i & 1) + (i >> 1) * nSrcXSize;
+        const double dfDensity =
+            GWKGetBandDensity( panBandValid, iOffset, padfUnified[i] );
+
+        if( dfDensity > 0.000000001 )
+        {
+            dfAccumulatorDivisor += padfMult[i];
+
+            dfAccumulatorReal += pSrc[iOffset] * padfMult[i];
+            dfAccumulatorDensity += dfDensity * padfMult[i];
+        }
+    }
+
+    if( dfAccumulatorDivisor == 1.0 )
+    {
+        *pdfReal = dfAccumulatorReal;
+        return dfAccumulatorDensity;
+    }
+    else if( dfAccumulatorDivisor < 0.00001 )
+    {
+        *pdfReal = 0.0;
+        return 0.0;
+    }
+
+    *pdfReal = dfAccumulatorReal / dfAccumulatorDivisor;
+    return dfAccumulatorDensity / dfAccumulatorDivisor;
+}
+
+/************************************************************************/
+/*                  GWKCubicMasksFallbackBilinearT()                    */
+/************************************************************************/
+
+template<class T>
+static double GWKCubicMasksFallbackBilinearT( const T *pSrc,
+                                              const GUInt32 *panBandValid,
+                                              int nSrcXSize,
+                                              const GWKMaskedPixel *psPixel,
+                                              double *pdfReal )
+{
+    const double adfUnified[4] = { psPixel->adfUnified[5],
+                                   psPixel->adfUnified[6],
+                                   psPixel->adfUnified[9],
+                                   psPixel->adfUnified[10] };
+
+    return GWKBilinearMasks4SampleT( pSrc, panBandValid, nSrcXSize,
+                                     psPixel->iSrcOffset + nSrcXSize + 1,
+                                     psPixel->adfMult, adfUnified, pdfReal );
+}
+
+/************************************************************************/
+/*                       GWKCubicMasks4SampleT()                        */
+/************************************************************************/
+
+template<class T>
+static CPL_INLINE double GWKCubicMasks4SampleT( const T *pSrc,
+                                                const GUInt32 *panBandValid,
+                                                int nSrcXSize,
+                                                const GWKMaskedPixel *psPixel,
+                                                double *pdfReal )
+{
+    double  adfValueDens[4], adfValueReal[4];
+
+    for( int i = 0; i < 4; i++ )
+    {
+        const int iRowOffset = psPixel->iSrcOffset + i * nSrcXSize;
+        double  adfDensity[4], adfReal[4];
+        int     bHasValid = FALSE, bHasMissing = FALSE;
+
+        for( int j = 0; j < 4; j++ )
+        {
+            adfDensity[j] = GWKGetBandDensity( panBandValid, iRowOffset + j,
+                                               psPixel->adfUnified[i*4+j] );
+            if( adfDensity[j] > 0.000000001 )
+                bHasValid = TRUE;
+            if( adfDensity[j] < 0.000000001 )
+                bHasMissing = TRUE;
+            adfReal[j] = pSrc[iRowOffset + j];
+        }
+
+        // Same fallback as GWKCubicResample4Sample().
+        if( !bHasValid || bHasMissing )
+            return GWKCubicMasksFallbackBilinearT( pSrc, panBandValid,
+                                                   nSrcXSize, psPixel,
+                                                   pdfReal );
+
+        adfValueDens[i] = CubicConvolution(psPixel->dfDeltaX,
+            psPixel->dfDeltaX2, psPixel->dfDeltaX3,
+            adfDensity[0], adfDensity[1], adfDensity[2], adfDensity[3]);
+        adfValueReal[i] = CubicConvolution(psPixel->dfDeltaX,
+            psPixel->dfDeltaX2, psPixel->dfDeltaX3,
+            adfReal[0], adfReal[1], adfReal[2], adfReal[3]);
+    }
+
+    *pdfReal = CubicConvolution(psPixel->dfDeltaY,
+                                psPixel->dfDeltaY2, psPixel->dfDeltaY3,
+                                adfValueReal[0], adfValueReal[1],
+                                adfValueReal[2], adfValueReal[3]);
+    return CubicConvolution(psPixel->dfDeltaY,
+                            psPixel->dfDeltaY2, psPixel->dfDeltaY3,
+                            adfValueDens[0], adfValueDens[1],
+                            adfValueDens[2], adfValueDens[3]);
+}
+
+/************************************************************************/
+/*                       GWKResampleMaskedPixel()                       */
+/************************************************************************/
+
+template<class T, GDALResampleAlg eResample>
+static CPL_INLINE double GWKResampleMaskedPixel( GDALWarpKernel *poWK,
+                                                 int iBand,
+                                                 const GUInt32 *panBandValid,
+                                                 const GWKMaskedPixel *psPixel,
+                                                 double *pdfReal )
+{
+    const T *pSrc = (const T *) poWK->papabySrcImage[iBand];
+
+    if( !psPixel->bInterior )
+    {
+        double dfDensity = 0.0, dfImag = 0.0;
+
+        if( eResample == GRA_Bilinear )
+            GWKBilinearResample4Sample( poWK, iBand,
+                                        psPixel->dfSrcX, psPixel->dfSrcY,
+                                        &dfDensity, pdfReal, &dfImag );
+        else
+            GWKCubicResample4Sample( poWK, iBand,
+                                     psPixel->dfSrcX, psPixel->dfSrcY,
+                                     &dfDensity, pdfReal, &dfImag );
+        return dfDensity;
+    }
+
+    if( eResample == GRA_Bilinear )
+        return GWKBilinearMasks4SampleT( pSrc, panBandValid, poWK->nSrcXSize,
+                                         psPixel->iSrcOffset,
+                                         psPixel->adfMult,
+                                         psPixel->adfUnified, pdfReal );
+
+    return GWKCubicMasks4SampleT( pSrc, panBandValid, poWK->nSrcXSize,
+                                  psPixel, pdfReal );
+}
+
+/************************************************************************/
+/*                       GWKApplyMaskedPixel()                          */
+/************************************************************************/
+
+static CPL_INLINE void GWKApplyMaskedPixel( GDALWarpKernel *poWK, int iBand,
+                                            const GWKMaskedPixel *psPixel,
+                                            double dfBandDensity,
+                                            double dfValueReal,
+                                            int *pbHasFoundDensity )
+{
+    // If we didn't find any valid inputs skip to next band.
+    if ( dfBandDensity < 0.0000000001 )
+        return;
+
+    *pbHasFoundDensity = TRUE;
+
+    GWKSetPixelValue( poWK, iBand, psPixel->iDstOffset,
+                      dfBandDensity, dfValueReal, 0.0 );
+}
+
+/************************************************************************/
+/*                      GWKResampleMaskedRow()                          */
+/*                                                                      */
+/*      Process one band of the candidate pixels of a scanline.         */
+/************************************************************************/
+
+template<class T, GDALResampleAlg eResample>
+static void GWKResampleMaskedRow( GDALWarpKernel *poWK, int iBand,
+                                  const GWKMaskedPixel *pasPixels,
+                                  int nPixels, int *pabHasFoundDensity )
+{
+    const GUInt32 *panBandValid = poWK->papanBandSrcValid != NULL ?
+        poWK->papanBandSrcValid[iBand] : NULL;
+
+    for( int iPixel = 0; iPixel < nPixels; iPixel++ )
+    {
+        double dfValueReal = 0.0;
+        const double dfBandDensity =
+            GWKResampleMaskedPixel<T, eResample>( poWK, iBand, panBandValid,
+                                                  pasPixels + iPixel,
+                                                  &dfValueReal );
+        GWKApplyMaskedPixel( poWK, iBand, pasPixels + iPixel,
+                             dfBandDensity, dfValueReal,
+                             pabHasFoundDensity + iPixel );
+    }
+}
+
+#ifdef HAVE_AVX2_WARPKERNEL
+
+/************************************************************************/
+/*                    GWKCubicConvolution_AVX2()                        */
+/*                                                                      */
+/*      Same evaluation order as the CubicConvolution() macro.          */
+/************************************************************************/
+
+static GWK_AVX2_TARGET CPL_INLINE
+__m256d GWKCubicConvolution_AVX2( __m256d d1, __m256d d2, __m256d d3,
+                                  __m256d f0, __m256d f1,
+                                  __m256d f2, __m256d f3 )
+{
+    __m256d a = _mm256_mul_pd( d1, _mm256_sub_pd(f2, f0) );
+
+    __m256d b = _mm256_mul_pd( _mm256_set1_pd(2.0), f0 );
+    b = _mm256_sub_pd( b, _mm256_mul_pd(_mm256_set1_pd(5.0), f1) );
+    b = _mm256_add_pd( b, _mm256_mul_pd(_mm256_set1_pd(4.0), f2) );
+    b = _mm256_mul_pd( d2, _mm256_sub_pd(b, f3) );
+
+    __m256d c = _mm256_mul_pd( _mm256_set1_pd(3.0), _mm256_sub_pd(f1, f2) );
+    c = _mm256_sub_pd( _mm256_add_pd(c, f3), f0 );
+    c = _mm256_mul_pd( d3, c );
+
+    return _mm256_add_pd( f1,
+        _mm256_mul_pd( _mm256_set1_pd(0.5),
+                       _mm256_add_pd(_mm256_add_pd(a, b), c) ) );
+}
+
+/************************************************************************/
+/*                    GWKCubicMasks4Pixels_AVX2()                       */
+/*                                                                      */
+/*      Cubic interpolation of 4 interior pixels.  Pixels with a        */
+/*      missing sample fall back on scalar bilinear interpolation.      */
+/************************************************************************/
+
+template<class T>
+static GWK_AVX2_TARGET
+void GWKCubicMasks4Pixels_AVX2( const T *pSrc, const GUInt32 *panBandValid,
+                                int nSrcXSize,
+                                const GWKMaskedPixel *pasPixels,
+                                double *padfDensity, double *padfReal )
+{
+    const __m256d ymm_threshold = _mm256_set1_pd( 0.000000001 );
+    const __m256d ymm_all_ones =
+        _mm256_castsi256_pd( _mm256_set1_epi32(-1) );
+    const __m256d ymm_dx = _mm256_set_pd( pasPixels[3].dfDeltaX,
+        pasPixels[2].dfDeltaX, pasPixels[1].dfDeltaX, pasPixels[0].dfDeltaX );
+    const __m256d ymm_dx2 = _mm256_set_pd( pasPixels[3].dfDeltaX2,
+        pasPixels[2].dfDeltaX2, pasPixels[1].dfDeltaX2, pasPixels[0].dfDeltaX2 );
+    const __m256d ymm_dx3 = _mm256_set_pd( pasPixels[3].dfDeltaX3,
+        pasPixels[2].dfDeltaX3, pasPixels[1].dfDeltaX3, pasPixels[0].dfDeltaX3 );
+    __m256d ymm_fallback = _mm256_setzero_pd();
+    __m256d aymm_dens[4], aymm_real[4];
+    double  adfDensity[4][4], adfValue[4][4];
+    int     i, j, k;
+
+    for( i = 0; i < 4; i++ )
+    {
+        const int nRowShift = i * nSrcXSize;
+
+        for( k = 0; k < 4; k++ )
+        {
+            const int iRowOffset = pasPixels[k].iSrcOffset + nRowShift;
+            for( j = 0; j < 4; j++ )
+            {
+                adfDensity[j][k] = GWKGetBandDensity( panBandValid,
+                    iRowOffset + j, pasPixels[k].adfUnified[i*4+j] );
+                adfValue[j][k] = pSrc[iRowOffset + j];
+            }
+        }
+
+        __m256d ymm_d[4], ymm_f[4];
+        __m256d ymm_valid = _mm256_setzero_pd();
+        __m256d ymm_missing = _mm256_setzero_pd();
+        for( j = 0; j < 4; j++ )
+        {
+            ymm_d[j] = _mm256_loadu_pd( adfDensity[j] );
+            ymm_f[j] = _mm256_loadu_pd( adfValue[j] );
+            ymm_valid = _mm256_or_pd( ymm_valid,
+                _mm256_cmp_pd(ymm_d[j], ymm_threshold, _CMP_GT_OQ) );
+            ymm_missing = _mm256_or_pd( ymm_missing,
+                _mm256_cmp_pd(ymm_d[j], ymm_threshold, _CMP_LT_OQ) );
+        }
+        ymm_fallback = _mm256_or_pd( ymm_fallback, ymm_missing );
+        ymm_fallback = _mm256_or_pd( ymm_fallback,
+            _mm256_andnot_pd(ymm_valid, ymm_all_ones) );
+
+        // All the pixels fall back on bilinear interpolation.
+        if( _mm256_movemask_pd(ymm_fallback) == 0xF )
+            break;
+
+        aymm_dens[i] = GWKCubicConvolution_AVX2( ymm_dx, ymm_dx2, ymm_dx3,
+            ymm_d[0], ymm_d[1], ymm_d[2], ymm_d[3] );
+        aymm_real[i] = GWKCubicConvolution_AVX2( ymm_dx, ymm_dx2, ymm_dx3,
+            ymm_f[0], ymm_f[1], ymm_f[2], ymm_f[3] );
+    }
+
+    const int nFallbackMask = _mm256_movemask_pd( ymm_fallback );
+    if( nFallbackMask != 0xF )
+    {
+        const __m256d ymm_dy = _mm256_set_pd( pasPixels[3].dfDeltaY,
+            pasPixels[2].dfDeltaY, pasPixels[1].dfDeltaY,
+            pasPixels[0].dfDeltaY );
+        const __m256d ymm_dy2 = _mm256_set_pd( pasPixels[3].dfDeltaY2,
+            pasPixels[2].dfDeltaY2, pasPixels[1].dfDeltaY2,
+            pasPixels[0].dfDeltaY2 );
+        const __m256d ymm_dy3 = _mm256_set_pd( pasPixels[3].dfDeltaY3,
+            pasPixels[2].dfDeltaY3, pasPixels[1].dfDeltaY3,
+            pasPixels[0].dfDeltaY3 );
+
+        _mm256_storeu_pd( padfDensity, GWKCubicConvolution_AVX2(
+            ymm_dy, ymm_dy2, ymm_dy3,
+            aymm_dens[0], aymm_dens[1], aymm_dens[2], aymm_dens[3]) );
+        _mm256_storeu_pd( padfReal, GWKCubicConvolution_AVX2(
+            ymm_dy, ymm_dy2, ymm_dy3,
+            aymm_real[0], aymm_real[1], aymm_real[2], aymm_real[3]) );
+    }
+
+    _mm256_zeroupper();
+
+    for( k = 0; k < 4; k++ )
+    {
+        if( nFallbackMask & (1 << k) )
+            padfDensity[k] = GWKCubicMasksFallbackBilinearT( pSrc,
+                panBandValid, nSrcXSize, pasPixels + k, padfReal + k );
+    }
+}
+
+/************************************************************************/
+/*                     GWKCubicMaskedRow_AVX2()                         */
+/************************************************************************/
+
+template<class T>
+static GWK_AVX2_TARGET
+void GWKCubicMaskedRow_AVX2( GDALWarpKernel *poWK, int iBand,
+                             const GWKMaskedPixel *pasPixels,
+                             int nPixels, int *pabHasFoundDensity )
+{
+    const T *pSrc = (const T *) poWK->papabySrcImage[iBand];
+    const GUInt32 *panBandValid = poWK->papanBandSrcValid != NULL ?
+        poWK->papanBandSrcValid[iBand] : NULL;
+    const int nSrcXSize = poWK->nSrcXSize;
+    double  adfDensity[4], adfReal[4];
+    int     iPixel = 0, k;
+
+    while( iPixel < nPixels )
+    {
+        if( iPixel + 4 <= nPixels
+            && pasPixels[iPixel].bInterior
+            && pasPixels[iPixel+1].bInterior
+            && pasPixels[iPixel+2].bInterior
+            && pasPixels[iPixel+3].bInterior )
+        {
+            GWKCubicMasks4Pixels_AVX2( pSrc, panBandValid, nSrcXSize,
+                                       pasPixels + iPixel,
+                                       adfDensity, adfReal );
+
+            for( k = 0; k < 4; k++ )
+                GWKApplyMaskedPixel( poWK, iBand, pasPixels + iPixel + k,
+                                     adfDensity[k], adfReal[k],
+                                     pabHasFoundDensity + iPixel + k );
+            iPixel += 4;
+        }
+        else
+        {
+            adfReal[0] = 0.0;
+            adfDensity[0] =
+                GWKResampleMaskedPixel<T, GRA_Cubic>( poWK, iBand,
+                                                      panBandValid,
+                                                      pasPixels + iPixel,
+                                                      adfReal );
+            GWKApplyMaskedPixel( poWK, iBand, pasPixels + iPixel,
+                                 adfDensity[0], adfReal[0],
+                                 pabHasFoundDensity + iPixel );
+            iPixel ++;
+        }
+    }
+}
+
+#endif /* HAVE_AVX2_WARPKERNEL */
+
+/************************************************************************/
+/*                   GWKResampleMasks4SampleThread()                    */
+/************************************************************************/
+
+template<class T, GDALResampleAlg eResample>
+static void GWKResampleMasks4SampleThread( void* pData )
+
+{
+    GWKJobStruct* psJob = (GWKJobStruct*) pData;
+    GDALWarpKernel *poWK = psJob->poWK;
+    int iYMin = psJob->iYMin;
+    int iYMax = psJob->iYMax;
+
+    int iDstY;
+    int nDstXSize = poWK->nDstXSize;
+    int nSrcXSize = poWK->nSrcXSize, nSrcYSize = poWK->nSrcYSize;
+#ifdef HAVE_AVX2_WARPKERNEL
+    int bUseAVX2 = GWKUseAVX2Kernels();
+#endif
+
+/* -------------------------------------------------------------------- */
+/*      Allocate x,y,z coordinate arrays for transformation ... one     */
+/*      scanlines worth of positions.                                   */
+/* -------------------------------------------------------------------- */
+    double *padfX, *padfY, *padfZ;
+    int    *pabSuccess, *pabHasFoundDensity;
+    GWKMaskedPixel *pasPixels;
+
+    padfX = (double *) CPLMalloc(sizeof(double) * nDstXSize);
+    padfY = (double *) CPLMalloc(sizeof(double) * nDstXSize);
+    padfZ = (double *) CPLMalloc(sizeof(double) * nDstXSize);
+    pabSuccess = (int *) CPLMalloc(sizeof(int) * nDstXSize);
+    pabHasFoundDensity = (int *) CPLMalloc(sizeof(int) * nDstXSize);
+    pasPixels = (GWKMaskedPixel *)
+        CPLMalloc(sizeof(GWKMaskedPixel) * nDstXSize);
+
+/* ==================================================================== */
+/*      Loop over output lines.                                         */
+/* ==================================================================== */
+    for( iDstY = iYMin; iDstY < iYMax; iDstY++ )
+    {
+        int iDstX, iPixel, nPixels = 0;
+
+/* -------------------------------------------------------------------- */
+/*      Setup points to transform to source image space.                */
+/* -------------------------------------------------------------------- */
+        for( iDstX = 0; iDstX < nDstXSize; iDstX++ )
+        {
+            padfX[iDstX] = iDstX + 0.5 + poWK->nDstXOff;
+            padfY[iDstX] = iDstY + 0.5 + poWK->nDstYOff;
+            padfZ[iDstX] = 0.0;
+        }
+
+/* -------------------------------------------------------------------- */
+/*      Transform the points from destination pixel/line coordinates    */
+/*      to source pixel/line coordinates.                               */
+/* -------------------------------------------------------------------- */
+        poWK->pfnTransformer( psJob->pTransformerArg, TRUE, nDstXSize,
+                              padfX, padfY, padfZ, pabSuccess );
+
+/* -------------------------------------------------------------------- */
+/*      Collect the pixels to compute, and their band independent       */
+/*      kernel parameters.  Transparent/invalid source pixels are       */
+/*      skipped as in GWKGeneralCase().                                 */
+/* -------------------------------------------------------------------- */
+        for( iDstX = 0; iDstX < nDstXSize; iDstX++ )
+        {
+            int iSrcOffset;
+            if( !GWKCheckAndComputeSrcOffsets(pabSuccess, iDstX, padfX, padfY,
+                                    poWK, nSrcXSize, nSrcYSize, iSrcOffset) )
+                continue;
+
+            double  dfDensity = 1.0;
+
+            if( poWK->pafUnifiedSrcDensity != NULL )
+            {
+                dfDensity = poWK->pafUnifiedSrcDensity[iSrcOffset];
+                if( dfDensity < 0.00001 )
+                    continue;
+            }
+
+            if( poWK->panUnifiedSrcValid != NULL
+                && !(poWK->panUnifiedSrcValid[iSrcOffset>>5]
+                     & (0x01 << (iSrcOffset & 0x1f))) )
+                continue;
+
+            GWKMaskedPixel *psPixel = pasPixels + nPixels;
+            psPixel->iDstOffset = iDstX + iDstY * nDstXSize;
+            psPixel->dfDensity = dfDensity;
+            GWKSetupMaskedPixel<eResample>( poWK,
+                                            padfX[iDstX]-poWK->nSrcXOff,
+                                            padfY[iDstX]-poWK->nSrcYOff,
+                                            psPixel );
+            pabHasFoundDensity[nPixels] = FALSE;
+            nPixels ++;
+        }
+
+/* -------------------------------------------------------------------- */
+/*      Resample and apply each band.  Destination pixels are           */
+/*      independent, so processing the scanline band by band gives     */
+/*      the same result as the pixel by pixel loop of the general case. */
+/* -------------------------------------------------------------------- */
+        for( int iBand = 0; iBand < poWK->nBands; iBand++ )
+        {
+#ifdef HAVE_AVX2_WARPKERNEL
+            if( eResample == GRA_Cubic && bUseAVX2 )
+                GWKCubicMaskedRow_AVX2<T>( poWK, iBand, pasPixels, nPixels,
+                                           pabHasFoundDensity );
+            else
+#endif
+                GWKResampleMaskedRow<T, eResample>( poWK, iBand,
+                                                    pasPixels, nPixels,
+                                                    pabHasFoundDensity );
+        }
+
+/* -------------------------------------------------------------------- */
+/*      Update destination density/validity masks.                      */
+/* -------------------------------------------------------------------- */
+        for( iPixel = 0; iPixel < nPixels; iPixel++ )
+        {
+            if( !pabHasFoundDensity[iPixel] )
+                continue;
+
+            const int iDstOffset = pasPixels[iPixel].iDstOffset;
+
+            GWKOverlayDensity( poWK, iDstOffset, pasPixels[iPixel].dfDensity );
+
+            if( poWK->panDstValid != NULL )
+            {
+                poWK->panDstValid[iDstOffset>>5] |=
+                    0x01 << (iDstOffset & 0x1f);
+            }
+        }
+
+/* -------------------------------------------------------------------- */
+/*      Report progress to the user, and optionally cancel out.         */
+/* -------------------------------------------------------------------- */
+        if (psJob->pfnProgress(psJob))
+            break;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Cleanup and return.                                             */
+/* -------------------------------------------------------------------- */
+    CPLFree( padfX );
+    CPLFree( padfY );
+    CPLFree( padfZ );
+    CPLFree( pabSuccess );
+    CPLFree( pabHasFoundDensity );
+    CPLFree( pasPixels );
+}
+
+/************************************************************************/
+/*                      GWKResampleMasks4Sample()                       */
+/*                                                                      */
+/*      Bilinear and cubic cases for Byte, Int16, UInt16 and Float32    */
+/*      data that are not handled by the no masks kernels.              */
+/************************************************************************/
+
+static CPLErr GWKResampleMasks4Sample( GDALWarpKernel *poWK )
+{
+    GWKUseAVX2Kernels();
+
+    const int bBilinear = (poWK->eResample == GRA_Bilinear);
+
+    switch( poWK->eWorkingDataType )
+    {
+      case GDT_Byte:
+        if( bBilinear )
+            return GWKRun( poWK, "GWKBilinearMasksByte",
+                GWKResampleMasks4SampleThread<GByte, GRA_Bilinear> );
+        return GWKRun( poWK, "GWKCubicMasksByte",
+            GWKResampleMasks4SampleThread<GByte, GRA_Cubic> );
+
+      case GDT_Int16:
+        if( bBilinear )
+            return GWKRun( poWK, "GWKBilinearMasksInt16",
+                GWKResampleMasks4SampleThread<GInt16, GRA_Bilinear> );
+        return GWKRun( poWK, "GWKCubicMasksInt16",
+            GWKResampleMasks4SampleThread<GInt16, GRA_Cubic> );
+
+      case GDT_UInt16:
+        if( bBilinear )
+            return GWKRun( poWK, "GWKBilinearMasksUInt16",
+                GWKResampleMasks4SampleThread<GUInt16, GRA_Bilinear> );
+        return GWKRun( poWK, "GWKCubicMasksUInt16",
+            GWKResampleMasks4SampleThread<GUInt16, GRA_Cubic> );
+
+      case GDT_Float32:
+        if( bBilinear )
+            return GWKRun( poWK, "GWKBilinearMasksFloat",
+                GWKResampleMasks4SampleThread<float, GRA_Bilinear> );
+        return GWKRun( poWK, "GWKCubicMasksFloat",
+            GWKResampleMasks4SampleThread<float, GRA_Cubic> );
+
+      default:
+        return GWKGeneralCase( poWK );
+    }
+}
+
 /************************************************************************/
 /*                       GWKNearestNoMasksByte()                        */
 /*                                                                      */
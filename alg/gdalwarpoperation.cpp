@@ -29,6 +29,7 @@
  ****************************************************************************/
 
 #include "gdalwarper.h"
+#include "gdal_alg_priv.h"
 #include "cpl_string.h"
 #include "cpl_multiproc.h"
 #include "ogr_api.h"
@@ -665,7 +666,8 @@ CPLErr GDALWarpOperation::ChunkAndWarpImage(
 /*      Collect the list of chunks to operate on.                       */
 /* -------------------------------------------------------------------- */
     WipeChunkList();
-    CollectChunkList( nDstXOff, nDstYOff, nDstXSize, nDstYSize );
+    CollectChunkList( nDstXOff, nDstYOff, nDstXSize, nDstYSize,
+                      psOptions->dfWarpMemoryLimit );
     
     /* Sort chucks from top to bottom, and for equal y, from left to right */
     qsort(pasChunkList, nChunkListCount, sizeof(GDALWarpChunk), OrderWarpChunk); 
@@ -737,65 +739,192 @@ CPLErr GDALChunkAndWarpImage( GDALWarpOperationH hOperation,
 }
 
 /************************************************************************/
-/*                          ChunkThreadMain()                           */
+/* ==================================================================== */
+/*                      Pipelined chunk warping                         */
+/*                                                                      */
+/*      ChunkAndWarpMulti() keeps up to PIPELINE_DEPTH chunks in        */
+/*      flight, each in its own thread.  A chunk goes through three     */
+/*      stages: reading of the source and destination buffers (and      */
+/*      computation of the masks), the warp kernel itself, and          */
+/*      writing of the destination buffer.  The read and write stages   */
+/*      access the datasets and are serialized by the IO mutex.  They   */
+/*      are also entered in a fixed order (reading of the first         */
+/*      PIPELINE_DEPTH chunks, then writing of chunk i followed by      */
+/*      reading of chunk i+PIPELINE_DEPTH), so the datasets see the     */
+/*      same sequence of requests, and the output file is identical,    */
+/*      whatever the thread scheduling.  The warp stages of several     */
+/*      chunks run concurrently, each with its own copy of the          */
+/*      transformer.                                                    */
+/* ==================================================================== */
 /************************************************************************/
 
 typedef struct
+{
+    void             *hIOMutex;
+    int               bSerializeWarp;
+
+    /* Fields below are protected by hMutex, and the progress */
+    /* function is called with it held */
+    void             *hMutex;
+    void             *hCond;
+    int               nNextIOTicket;
+    int               bStop;
+    double            dfProgressDone;
+    GDALProgressFunc  pfnProgress;
+    void             *pProgressArg;
+} GDALWarpPipeline;
+
+struct _GDALWarpChunkJob
 {
     GDALWarpOperation *poOperation;
+    GDALWarpPipeline  *psPipeline;
     GDALWarpChunk     *pasChunkInfo;
+    int                iChunk;
+    int                nReadTicket;      /* position of the IO stages */
+    int                nWriteTicket;     /* in the IO sequence */
+    void              *pTransformerArg;  /* NULL if warp is serialized */
     void              *hThreadHandle;
     CPLErr             eErr;
-    double             dfProgressBase;
     double             dfProgressScale;
-    void              *hIOMutex;
+    double             dfChunkProgress;  /* protected by hMutex */
+    int                bHoldsIOMutex;
+};
 
-    void              *hCondMutex;
-    int                bIOMutexTaken;
-    void              *hCond;
-} ChunkThreadData;
+/************************************************************************/
+/*                         GDALWarpChunkStop()                          */
+/*                                                                      */
+/*      Abort the chunks in flight, and wake up those waiting for       */
+/*      their turn.                                                     */
+/************************************************************************/
 
+static void GDALWarpChunkStop( GDALWarpPipeline *psPipeline )
+{
+    CPLAcquireMutex( psPipeline->hMutex, 1000.0 );
+    psPipeline->bStop = TRUE;
+    CPLCondBroadcast( psPipeline->hCond );
+    CPLReleaseMutex( psPipeline->hMutex );
+}
 
-static void ChunkThreadMain( void *pThreadData )
+/************************************************************************/
+/*                       GDALWarpChunkAcquireIO()                       */
+/*                                                                      */
+/*      Wait for the read (or write) turn of the chunk, and take the    */
+/*      IO mutex.  Returns FALSE if the warp has been stopped.          */
+/************************************************************************/
 
+static int GDALWarpChunkAcquireIO( GDALWarpChunkJob *psJob, int bWrite )
 {
-    volatile ChunkThreadData* psData = (volatile ChunkThreadData*) pThreadData;
+    GDALWarpPipeline *psPipeline = psJob->psPipeline;
+    int nTicket = bWrite ? psJob->nWriteTicket : psJob->nReadTicket;
 
-    GDALWarpChunk *pasChunkInfo = psData->pasChunkInfo;
+    CPLAcquireMutex( psPipeline->hMutex, 1000.0 );
+    while( !psPipeline->bStop && psPipeline->nNextIOTicket != nTicket )
+        CPLCondWait( psPipeline->hCond, psPipeline->hMutex );
+    int bStop = psPipeline->bStop;
+    CPLReleaseMutex( psPipeline->hMutex );
 
-/* -------------------------------------------------------------------- */
-/*      Acquire IO mutex.                                               */
-/* -------------------------------------------------------------------- */
-    if( !CPLAcquireMutex( psData->hIOMutex, 600.0 ) )
+    if( bStop )
+        return FALSE;
+
+    if( !CPLAcquireMutex( psPipeline->hIOMutex, 600.0 ) )
     {
         CPLError( CE_Failure, CPLE_AppDefined,
-                    "Failed to acquire IOMutex in WarpRegion()." );
-        psData->eErr = CE_Failure;
+                  "Failed to acquire IOMutex in WarpRegion()." );
+        return FALSE;
     }
-    else
+    psJob->bHoldsIOMutex = TRUE;
+
+    /* The next stage may now queue on the IO mutex: it will get it */
+    /* once this chunk is done with its stage. */
+    CPLAcquireMutex( psPipeline->hMutex, 1000.0 );
+    psPipeline->nNextIOTicket ++;
+    CPLCondBroadcast( psPipeline->hCond );
+    CPLReleaseMutex( psPipeline->hMutex );
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                       GDALWarpChunkReleaseIO()                       */
+/************************************************************************/
+
+static void GDALWarpChunkReleaseIO( GDALWarpChunkJob *psJob )
+{
+    if( psJob->bHoldsIOMutex )
     {
-        if (psData->hCond != NULL)
-        {
-            CPLAcquireMutex( psData->hCondMutex, 1.0 );
-            psData->bIOMutexTaken = TRUE;
-            CPLCondSignal(psData->hCond);
-            CPLReleaseMutex( psData->hCondMutex );
-        }
+        psJob->bHoldsIOMutex = FALSE;
+        CPLReleaseMutex( psJob->psPipeline->hIOMutex );
+    }
+}
+
+/************************************************************************/
+/*                       GDALWarpChunkProgress()                        */
+/*                                                                      */
+/*      Progress callback of the warp kernel of a chunk.  Sums the      */
+/*      progress of the chunks in flight, so that the reported value    */
+/*      never goes backward.                                            */
+/************************************************************************/
+
+static int CPL_STDCALL GDALWarpChunkProgress( double dfComplete,
+                                              CPL_UNUSED const char *pszMessage,
+                                              void *pProgressArg )
+{
+    GDALWarpChunkJob *psJob = (GDALWarpChunkJob *) pProgressArg;
+    GDALWarpPipeline *psPipeline = psJob->psPipeline;
+    int bContinue;
+
+    CPLAcquireMutex( psPipeline->hMutex, 1000.0 );
+
+    if( dfComplete > psJob->dfChunkProgress )
+    {
+        psPipeline->dfProgressDone += 
+            (dfComplete - psJob->dfChunkProgress) * psJob->dfProgressScale;
+        psJob->dfChunkProgress = dfComplete;
+    }
+
+    bContinue = !psPipeline->bStop &&
+        psPipeline->pfnProgress( psPipeline->dfProgressDone, "",
+                                 psPipeline->pProgressArg );
+    if( !bContinue )
+    {
+        psPipeline->bStop = TRUE;
+        CPLCondBroadcast( psPipeline->hCond );
+    }
+
+    CPLReleaseMutex( psPipeline->hMutex );
+
+    return bContinue;
+}
+
+/************************************************************************/
+/*                          ChunkThreadMain()                           */
+/************************************************************************/
+
+void GDALWarpOperation::ChunkThreadMain( void *pThreadData )
+
+{
+    GDALWarpChunkJob *psJob = (GDALWarpChunkJob *) pThreadData;
+    GDALWarpChunk *pasChunkInfo = psJob->pasChunkInfo;
 
-        psData->eErr = psData->poOperation->WarpRegion(
+    if( !GDALWarpChunkAcquireIO( psJob, FALSE ) )
+    {
+        psJob->eErr = CE_Failure;
+    }
+    else
+    {
+        psJob->eErr = psJob->poOperation->WarpRegionInternal(
                                     pasChunkInfo->dx, pasChunkInfo->dy, 
                                     pasChunkInfo->dsx, pasChunkInfo->dsy,
                                     pasChunkInfo->sx, pasChunkInfo->sy, 
                                     pasChunkInfo->ssx, pasChunkInfo->ssy,
                                     pasChunkInfo->sExtraSx, pasChunkInfo->sExtraSy,
-                                    psData->dfProgressBase,
-                                    psData->dfProgressScale);
-
-    /* -------------------------------------------------------------------- */
-    /*      Release the IO mutex.                                           */
-    /* -------------------------------------------------------------------- */
-        CPLReleaseMutex( psData->hIOMutex );
+                                    0.0, psJob->dfProgressScale, psJob );
     }
+
+    GDALWarpChunkReleaseIO( psJob );
+
+    if( psJob->eErr != CE_None )
+        GDALWarpChunkStop( psJob->psPipeline );
 }
 
 /************************************************************************/
@@ -812,7 +941,13 @@ static void ChunkThreadMain( void *pThreadData )
  *
  * Externally this method operates the same as ChunkAndWarpImage(), but
  * internally this method uses multiple threads to interleave input/output
- * for one region while the processing is being done for another.
+ * for some regions while the processing is being done for others.
+ *
+ * The number of chunks in flight is set by the PIPELINE_DEPTH warp option
+ * (2 by default), and GDALWarpOptions::dfWarpMemoryLimit is shared between
+ * them.  The input/output of the chunks is done in the same order as
+ * with ChunkAndWarpImage(), so the result does not depend on the thread
+ * scheduling.
  *
  * @param nDstXOff X offset to window of destination data to be produced.
  * @param nDstYOff Y offset to window of destination data to be produced.
@@ -826,126 +961,161 @@ CPLErr GDALWarpOperation::ChunkAndWarpMulti(
     int nDstXOff, int nDstYOff,  int nDstXSize, int nDstYSize )
 
 {
-    hIOMutex = CPLCreateMutex();
-    hWarpMutex = CPLCreateMutex();
+    if( hIOMutex == NULL )
+    {
+        hIOMutex = CPLCreateMutex();
+        hWarpMutex = CPLCreateMutex();
 
-    CPLReleaseMutex( hIOMutex );
-    CPLReleaseMutex( hWarpMutex );
+        CPLReleaseMutex( hIOMutex );
+        CPLReleaseMutex( hWarpMutex );
+    }
 
-    void* hCond = CPLCreateCond();
-    void* hCondMutex = CPLCreateMutex();
-    CPLReleaseMutex(hCondMutex);
+/* -------------------------------------------------------------------- */
+/*      How many chunks may be in flight?                               */
+/* -------------------------------------------------------------------- */
+    int nDepth = 2;
+    const char *pszDepth =
+        CSLFetchNameValue( psOptions->papszWarpOptions, "PIPELINE_DEPTH" );
+    if( pszDepth != NULL )
+        nDepth = MAX(2, MIN(128, atoi(pszDepth)));
 
 /* -------------------------------------------------------------------- */
-/*      Collect the list of chunks to operate on.                       */
+/*      Collect the list of chunks to operate on, so that all the       */
+/*      chunks in flight fit in the warp memory limit.                  */
 /* -------------------------------------------------------------------- */
     WipeChunkList();
-    CollectChunkList( nDstXOff, nDstYOff, nDstXSize, nDstYSize );
+    CollectChunkList( nDstXOff, nDstYOff, nDstXSize, nDstYSize,
+                      psOptions->dfWarpMemoryLimit / nDepth );
 
     /* Sort chucks from top to bottom, and for equal y, from left to right */
     qsort(pasChunkList, nChunkListCount, sizeof(GDALWarpChunk), OrderWarpChunk); 
 
+    if( nDepth > nChunkListCount )
+        nDepth = MAX(1, nChunkListCount);
+
 /* -------------------------------------------------------------------- */
-/*      Process them one at a time, updating the progress               */
-/*      information for each region.                                    */
+/*      Setup the pipeline.  Each slot gets its own copy of the         */
+/*      transformer so that the warp stages can run concurrently.       */
+/*      If the transformer cannot be cloned, or if there are chunk      */
+/*      processor callbacks, the warp stages are serialized.            */
 /* -------------------------------------------------------------------- */
-    ChunkThreadData volatile asThreadData[2];
-    memset((void*)&asThreadData, 0, sizeof(asThreadData));
-    asThreadData[0].poOperation = this;
-    asThreadData[0].hIOMutex = hIOMutex;
-    asThreadData[1].poOperation = this;
-    asThreadData[1].hIOMutex = hIOMutex;
+    GDALWarpPipeline sPipeline;
 
-    int iChunk;
-    double dfPixelsProcessed=0.0, dfTotalPixels = nDstXSize*(double)nDstYSize;
+    sPipeline.hIOMutex = hIOMutex;
+    sPipeline.bSerializeWarp =
+        psOptions->pfnPreWarpChunkProcessor != NULL
+        || psOptions->pfnPostWarpChunkProcessor != NULL;
+    sPipeline.hMutex = CPLCreateMutex();
+    CPLReleaseMutex( sPipeline.hMutex );
+    sPipeline.hCond = CPLCreateCond();
+    sPipeline.nNextIOTicket = 0;
+    sPipeline.bStop = FALSE;
+    sPipeline.dfProgressDone = 0.0;
+    sPipeline.pfnProgress = psOptions->pfnProgress;
+    sPipeline.pProgressArg = psOptions->pProgressArg;
 
-    CPLErr eErr = CE_None;
-    for( iChunk = 0; iChunk < nChunkListCount+1; iChunk++ )
+    GDALWarpChunkJob *pasJobs =
+        (GDALWarpChunkJob *) CPLCalloc( sizeof(GDALWarpChunkJob), nDepth );
+    int iSlot;
+
+    for( iSlot = 0; iSlot < nDepth && !sPipeline.bSerializeWarp; iSlot++ )
     {
-        int    iThread = iChunk % 2;
+        pasJobs[iSlot].pTransformerArg =
+            GDALCloneTransformer( psOptions->pTransformerArg );
+        if( pasJobs[iSlot].pTransformerArg == NULL )
+        {
+            CPLDebug( "WARP", "Cannot duplicate transformer function. "
+                      "Warping one chunk at a time." );
+            sPipeline.bSerializeWarp = TRUE;
+        }
+    }
 
-/* -------------------------------------------------------------------- */
-/*      Launch thread for this chunk.                                   */
-/* -------------------------------------------------------------------- */
-        if( iChunk < nChunkListCount )
+    if( sPipeline.bSerializeWarp )
+    {
+        for( iSlot = 0; iSlot < nDepth; iSlot++ )
         {
-            GDALWarpChunk *pasThisChunk = pasChunkList + iChunk;
-            double dfChunkPixels = pasThisChunk->dsx * (double) pasThisChunk->dsy;
+            if( pasJobs[iSlot].pTransformerArg != NULL )
+                GDALDestroyTransformer( pasJobs[iSlot].pTransformerArg );
+            pasJobs[iSlot].pTransformerArg = NULL;
+        }
+    }
 
-            asThreadData[iThread].dfProgressBase = dfPixelsProcessed / dfTotalPixels;
-            asThreadData[iThread].dfProgressScale = dfChunkPixels / dfTotalPixels;
+    CPLDebug( "WARP", "Warping %d chunks with up to %d in flight.",
+              nChunkListCount, nDepth );
 
-            dfPixelsProcessed += dfChunkPixels;
+/* -------------------------------------------------------------------- */
+/*      Launch a thread per chunk, waiting for the chunk that used      */
+/*      the same slot to complete first.                                */
+/* -------------------------------------------------------------------- */
+    int iChunk;
+    double dfTotalPixels = nDstXSize*(double)nDstYSize;
 
-            asThreadData[iThread].pasChunkInfo = pasThisChunk;
+    CPLErr eErr = CE_None;
+    for( iChunk = 0; iChunk < nChunkListCount + nDepth; iChunk++ )
+    {
+        GDALWarpChunkJob *psJob = pasJobs + (iChunk % nDepth);
 
-            if ( iChunk == 0 )
-            {
-                asThreadData[iThread].hCond = hCond;
-                asThreadData[iThread].hCondMutex = hCondMutex;
-            }
-            else
-            {
-                asThreadData[iThread].hCond = NULL;
-                asThreadData[iThread].hCondMutex = NULL;
-            }
-            asThreadData[iThread].bIOMutexTaken = FALSE;
+        if( psJob->hThreadHandle != NULL )
+        {
+            CPLJoinThread( psJob->hThreadHandle );
+            psJob->hThreadHandle = NULL;
 
-            CPLDebug( "GDAL", "Start chunk %d.", iChunk );
-            asThreadData[iThread].hThreadHandle =
-                CPLCreateJoinableThread( ChunkThreadMain, (void*) &asThreadData[iThread] );
-            if( asThreadData[iThread].hThreadHandle == NULL )
-            {
-                CPLError( CE_Failure, CPLE_AppDefined, 
-                          "CPLCreateJoinableThread() failed in ChunkAndWarpMulti()" );
-                eErr = CE_Failure;
-                break;
-            }
+            CPLDebug( "GDAL", "Finished chunk %d.", psJob->iChunk );
 
-            /* Wait that the first thread has acquired the IO mutex before proceeding. */
-            /* (This will ensure that the first thread will run before the second one). */
-            if( iChunk == 0 )
-            {
-                CPLAcquireMutex(hCondMutex, 1.0);
-                while (asThreadData[iThread].bIOMutexTaken == FALSE)
-                    CPLCondWait(hCond, hCondMutex);
-                CPLReleaseMutex(hCondMutex);
-            }
+            if( psJob->eErr != CE_None && eErr == CE_None )
+                eErr = psJob->eErr;
         }
 
-        
-/* -------------------------------------------------------------------- */
-/*      Wait for previous chunks thread to complete.                    */
-/* -------------------------------------------------------------------- */
-        if( iChunk > 0 )
-        {
-            iThread = (iChunk-1) % 2;
-            
-            /* Wait for thread to finish. */
-            CPLJoinThread(asThreadData[iThread].hThreadHandle);
-            asThreadData[iThread].hThreadHandle = NULL;
+        if( iChunk >= nChunkListCount || eErr != CE_None )
+            continue;
 
-            CPLDebug( "GDAL", "Finished chunk %d.", iChunk-1 );
+        GDALWarpChunk *pasThisChunk = pasChunkList + iChunk;
 
-            eErr = asThreadData[iThread].eErr;
+        psJob->poOperation = this;
+        psJob->psPipeline = &sPipeline;
+        psJob->pasChunkInfo = pasThisChunk;
+        psJob->iChunk = iChunk;
 
-            if( eErr != CE_None )
-                break;
+        /* IO sequence: R(0) ... R(nDepth-1), W(0), R(nDepth), W(1), ... */
+        /* ..., W(n-nDepth-1), R(n-1), W(n-nDepth), ..., W(n-1) */
+        if( iChunk < nDepth )
+            psJob->nReadTicket = iChunk;
+        else
+            psJob->nReadTicket = 2 * iChunk - nDepth + 1;
+        if( iChunk < nChunkListCount - nDepth )
+            psJob->nWriteTicket = nDepth + 2 * iChunk;
+        else
+            psJob->nWriteTicket = nChunkListCount + iChunk;
+        psJob->eErr = CE_None;
+        psJob->dfProgressScale =
+            pasThisChunk->dsx * (double) pasThisChunk->dsy / dfTotalPixels;
+        psJob->dfChunkProgress = 0.0;
+        psJob->bHoldsIOMutex = FALSE;
+
+        CPLDebug( "GDAL", "Start chunk %d.", iChunk );
+        psJob->hThreadHandle =
+            CPLCreateJoinableThread( ChunkThreadMain, psJob );
+        if( psJob->hThreadHandle == NULL )
+        {
+            CPLError( CE_Failure, CPLE_AppDefined, 
+                      "CPLCreateJoinableThread() failed in ChunkAndWarpMulti()" );
+            eErr = CE_Failure;
+            GDALWarpChunkStop( &sPipeline );
         }
     }
 
-    /* -------------------------------------------------------------------- */
-    /*      Wait for all threads to complete.                               */
-    /* -------------------------------------------------------------------- */
-    int iThread;
-    for(iThread = 0; iThread < 2; iThread ++)
+/* -------------------------------------------------------------------- */
+/*      Cleanup.                                                        */
+/* -------------------------------------------------------------------- */
+    for( iSlot = 0; iSlot < nDepth; iSlot++ )
     {
-        if (asThreadData[iThread].hThreadHandle)
-            CPLJoinThread(asThreadData[iThread].hThreadHandle);
+        if( pasJobs[iSlot].pTransformerArg != NULL )
+            GDALDestroyTransformer( pasJobs[iSlot].pTransformerArg );
     }
+    CPLFree( pasJobs );
 
-    CPLDestroyCond(hCond);
-    CPLDestroyMutex(hCondMutex);
+    CPLDestroyCond( sPipeline.hCond );
+    CPLDestroyMutex( sPipeline.hMutex );
 
     WipeChunkList();
 
@@ -987,7 +1157,8 @@ void GDALWarpOperation::WipeChunkList()
 /************************************************************************/
 
 CPLErr GDALWarpOperation::CollectChunkList( 
-    int nDstXOff, int nDstYOff,  int nDstXSize, int nDstYSize )
+    int nDstXOff, int nDstYOff,  int nDstXSize, int nDstYSize,
+    double dfMemoryLimit )
 
 {
 /* -------------------------------------------------------------------- */
@@ -1086,7 +1257,7 @@ CPLErr GDALWarpOperation::CollectChunkList(
                          &nBlockXSize, &nBlockYSize);
     }
     
-    if( dfTotalMemoryUse > psOptions->dfWarpMemoryLimit 
+    if( dfTotalMemoryUse > dfMemoryLimit 
         && (nDstXSize > 2 || nDstYSize > 2) )
     {
         CPLErr eErr2;
@@ -1111,10 +1282,10 @@ CPLErr GDALWarpOperation::CollectChunkList(
             int nChunk2 = nDstXSize - nChunk1;
 
             eErr = CollectChunkList( nDstXOff, nDstYOff, 
-                                     nChunk1, nDstYSize );
+                                     nChunk1, nDstYSize, dfMemoryLimit );
 
             eErr2 = CollectChunkList( nDstXOff+nChunk1, nDstYOff, 
-                                      nChunk2, nDstYSize );
+                                      nChunk2, nDstYSize, dfMemoryLimit );
         }
         else
         {
@@ -1127,10 +1298,10 @@ CPLErr GDALWarpOperation::CollectChunkList(
             int nChunk2 = nDstYSize - nChunk1;
 
             eErr = CollectChunkList( nDstXOff, nDstYOff, 
-                                     nDstXSize, nChunk1 );
+                                     nDstXSize, nChunk1, dfMemoryLimit );
 
             eErr2 = CollectChunkList( nDstXOff, nDstYOff+nChunk1, 
-                                      nDstXSize, nChunk2 );
+                                      nDstXSize, nChunk2, dfMemoryLimit );
         }
 
         if( eErr == CE_None )
@@ -1228,6 +1399,31 @@ CPLErr GDALWarpOperation::WarpRegion( int nDstXOff, int nDstYOff,
                                       int nSrcXExtraSize, int nSrcYExtraSize,
                                       double dfProgressBase,
                                       double dfProgressScale)
+{
+    return WarpRegionInternal(nDstXOff, nDstYOff, 
+                              nDstXSize, nDstYSize,
+                              nSrcXOff, nSrcYOff,
+                              nSrcXSize, nSrcYSize,
+                              nSrcXExtraSize, nSrcYExtraSize,
+                              dfProgressBase, dfProgressScale, NULL);
+}
+
+/************************************************************************/
+/*                         WarpRegionInternal()                         */
+/*                                                                      */
+/*      psJob is set when called from ChunkAndWarpMulti(), in which     */
+/*      case the IO mutex is held on entry and on exit.                 */
+/************************************************************************/
+
+CPLErr GDALWarpOperation::WarpRegionInternal( int nDstXOff, int nDstYOff, 
+                                              int nDstXSize, int nDstYSize,
+                                              int nSrcXOff, int nSrcYOff,
+                                              int nSrcXSize, int nSrcYSize,
+                                              int nSrcXExtraSize,
+                                              int nSrcYExtraSize,
+                                              double dfProgressBase,
+                                              double dfProgressScale,
+                                              GDALWarpChunkJob *psJob )
 
 {
     CPLErr eErr;
@@ -1350,11 +1546,12 @@ CPLErr GDALWarpOperation::WarpRegion( int nDstXOff, int nDstYOff,
 /* -------------------------------------------------------------------- */
 /*      Perform the warp.                                               */
 /* -------------------------------------------------------------------- */
-    eErr = WarpRegionToBuffer( nDstXOff, nDstYOff, nDstXSize, nDstYSize, 
-                               pDstBuffer, psOptions->eWorkingDataType, 
-                               nSrcXOff, nSrcYOff, nSrcXSize, nSrcYSize,
-                               nSrcXExtraSize, nSrcYExtraSize,
-                               dfProgressBase, dfProgressScale);
+    eErr = WarpRegionToBufferInternal( nDstXOff, nDstYOff,
+                                       nDstXSize, nDstYSize, 
+                                       pDstBuffer, psOptions->eWorkingDataType, 
+                                       nSrcXOff, nSrcYOff, nSrcXSize, nSrcYSize,
+                                       nSrcXExtraSize, nSrcYExtraSize,
+                                       dfProgressBase, dfProgressScale, psJob );
 
 /* -------------------------------------------------------------------- */
 /*      Write the output data back to disk if all went well.            */
@@ -1472,6 +1669,29 @@ CPLErr GDALWarpOperation::WarpRegionToBuffer(
     int nSrcXOff, int nSrcYOff, int nSrcXSize, int nSrcYSize,
     int nSrcXExtraSize, int nSrcYExtraSize,
     double dfProgressBase, double dfProgressScale)
+{
+    return WarpRegionToBufferInternal(nDstXOff, nDstYOff, nDstXSize, nDstYSize, 
+                                      pDataBuf, eBufDataType,
+                                      nSrcXOff, nSrcYOff, nSrcXSize, nSrcYSize,
+                                      nSrcXExtraSize, nSrcYExtraSize,
+                                      dfProgressBase, dfProgressScale, NULL);
+}
+
+/************************************************************************/
+/*                     WarpRegionToBufferInternal()                     */
+/*                                                                      */
+/*      When psJob is set, the IO mutex is held on entry. It is         */
+/*      released while the kernel runs, and taken again in the write    */
+/*      order of the chunk before the destination alpha is written.    */
+/************************************************************************/
+
+CPLErr GDALWarpOperation::WarpRegionToBufferInternal( 
+    int nDstXOff, int nDstYOff, int nDstXSize, int nDstYSize, 
+    void *pDataBuf, GDALDataType eBufDataType,
+    int nSrcXOff, int nSrcYOff, int nSrcXSize, int nSrcYSize,
+    int nSrcXExtraSize, int nSrcYExtraSize,
+    double dfProgressBase, double dfProgressScale,
+    GDALWarpChunkJob *psJob )
 
 {
     CPLErr eErr = CE_None;
@@ -1512,6 +1732,19 @@ CPLErr GDALWarpOperation::WarpRegionToBuffer(
     oWK.dfProgressBase = dfProgressBase;
     oWK.dfProgressScale = dfProgressScale;
 
+    /* Chunks warped concurrently use their own copy of the transformer, */
+    /* and report their progress through the pipeline. */
+    if( psJob != NULL )
+    {
+        if( psJob->pTransformerArg != NULL )
+            oWK.pTransformerArg = psJob->pTransformerArg;
+
+        oWK.pfnProgress = GDALWarpChunkProgress;
+        oWK.pProgress = psJob;
+        oWK.dfProgressBase = 0.0;
+        oWK.dfProgressScale = 1.0;
+    }
+
     oWK.papszWarpOptions = psOptions->papszWarpOptions;
     
     oWK.padfDstNoDataReal = psOptions->padfDstNoDataReal;
@@ -1805,16 +2038,24 @@ CPLErr GDALWarpOperation::WarpRegionToBuffer(
     }
         
 /* -------------------------------------------------------------------- */
-/*      Release IO Mutex, and acquire warper mutex.                     */
+/*      Release IO Mutex, and acquire warper mutex if the warp stage    */
+/*      of the chunks must be serialized.                               */
 /* -------------------------------------------------------------------- */
-    if( hIOMutex != NULL )
+    int bWarpMutexTaken = FALSE;
+    if( psJob != NULL )
     {
-        CPLReleaseMutex( hIOMutex );
-        if( !CPLAcquireMutex( hWarpMutex, 600.0 ) )
+        GDALWarpChunkReleaseIO( psJob );
+
+        if( psJob->psPipeline->bSerializeWarp )
         {
-            CPLError( CE_Failure, CPLE_AppDefined, 
-                      "Failed to acquire WarpMutex in WarpRegion()." );
-            return CE_Failure;
+            if( !CPLAcquireMutex( hWarpMutex, 600.0 ) )
+            {
+                CPLError( CE_Failure, CPLE_AppDefined, 
+                          "Failed to acquire WarpMutex in WarpRegion()." );
+                eErr = CE_Failure;
+            }
+            else
+                bWarpMutexTaken = TRUE;
         }
     }
 
@@ -1842,18 +2083,15 @@ CPLErr GDALWarpOperation::WarpRegionToBuffer(
             (void *) &oWK, psOptions->pPostWarpProcessorArg );
 
 /* -------------------------------------------------------------------- */
-/*      Release Warp Mutex, and acquire io mutex.                       */
+/*      Release Warp Mutex, and acquire io mutex once the previous      */
+/*      chunks have been written.                                       */
 /* -------------------------------------------------------------------- */
-    if( hIOMutex != NULL )
-    {
+    if( bWarpMutexTaken )
         CPLReleaseMutex( hWarpMutex );
-        if( !CPLAcquireMutex( hIOMutex, 600.0 ) )
-        {
-            CPLError( CE_Failure, CPLE_AppDefined, 
-                      "Failed to acquire IOMutex in WarpRegion()." );
-            return CE_Failure;
-        }
-    }
+
+    if( psJob != NULL && eErr == CE_None
+        && !GDALWarpChunkAcquireIO( psJob, TRUE ) )
+        eErr = CE_Failure;
         
 /* -------------------------------------------------------------------- */
 /*      Write destination alpha if available.                           */
@@ -30,6 +30,8 @@
 #include "gdal_alg_priv.h"
 #include "cpl_conv.h"
 #include "cpl_string.h"
+#include "cpl_multiproc.h"
+#include <map>
 #include <vector>
 
 CPL_CVSID("$Id$");
@@ -326,111 +328,1389 @@ static void AddEdges( GInt32 *panThisLineId, GInt32 *panLastLineId,
     }
 }
 
+/************************************************************************/
+/*                          RPolygonToGeometry()                        */
+/*                                                                      */
+/*      Coalesce the edges of a polygon into rings, and turn them       */
+/*      into an OGR polygon in georeferenced coordinates.               */
+/************************************************************************/
+
+static OGRGeometryH
+RPolygonToGeometry( RPolygon *poRPoly, double *padfGeoTransform )
+
+{
+    OGRGeometryH hPolygon;
+
+/* -------------------------------------------------------------------- */
+/*      Turn bits of lines into coherent rings.                         */
+/* -------------------------------------------------------------------- */
+    poRPoly->Coalesce();
+
+/* -------------------------------------------------------------------- */
+/*      Create the polygon geometry.                                    */
+/* -------------------------------------------------------------------- */
+    size_t iString;
+
+    hPolygon = OGR_G_CreateGeometry( wkbPolygon );
+    
+    for( iString = 0; iString < poRPoly->aanXY.size(); iString++ )
+    {
+        std::vector<int> &anString = poRPoly->aanXY[iString];
+        OGRGeometryH hRing = OGR_G_CreateGeometry( wkbLinearRing );
+
+        int iVert;
+
+        // we go last to first to ensure the linestring is allocated to 
+        // the proper size on the first try.
+        for( iVert = anString.size()/2 - 1; iVert >= 0; iVert-- )
+        {
+            double dfX, dfY;
+            int    nPixelX, nPixelY;
+            
+            nPixelX = anString[iVert*2];
+            nPixelY = anString[iVert*2+1];
+
+            dfX = padfGeoTransform[0] 
+                + nPixelX * padfGeoTransform[1]
+                + nPixelY * padfGeoTransform[2];
+            dfY = padfGeoTransform[3] 
+                + nPixelX * padfGeoTransform[4]
+                + nPixelY * padfGeoTransform[5];
+
+            OGR_G_SetPoint_2D( hRing, iVert, dfX, dfY );
+        }
+
+        OGR_G_AddGeometryDirectly( hPolygon, hRing );
+    }
+
+    return hPolygon;
+}
+
 /************************************************************************/
 /*                         EmitPolygonToLayer()                         */
 /************************************************************************/
 
-static CPLErr
-EmitPolygonToLayer( OGRLayerH hOutLayer, int iPixValField,
-                    RPolygon *poRPoly, double *padfGeoTransform )
+static CPLErr
+EmitPolygonToLayer( OGRLayerH hOutLayer, int iPixValField,
+                    RPolygon *poRPoly, double *padfGeoTransform )
+
+{
+    OGRFeatureH hFeat;
+    OGRGeometryH hPolygon;
+
+    hPolygon = RPolygonToGeometry( poRPoly, padfGeoTransform );
+
+/* -------------------------------------------------------------------- */
+/*      Create the feature object.                                      */
+/* -------------------------------------------------------------------- */
+    hFeat = OGR_F_Create( OGR_L_GetLayerDefn( hOutLayer ) );
+
+    OGR_F_SetGeometryDirectly( hFeat, hPolygon );
+
+    if( iPixValField >= 0 )
+        OGR_F_SetFieldInteger( hFeat, iPixValField, poRPoly->nPolyValue );
+
+/* -------------------------------------------------------------------- */
+/*      Write the to the layer.                                         */
+/* -------------------------------------------------------------------- */
+    CPLErr eErr = CE_None;
+
+    if( OGR_L_CreateFeature( hOutLayer, hFeat ) != OGRERR_NONE )
+        eErr = CE_Failure;
+
+    OGR_F_Destroy( hFeat );
+
+    return eErr;
+}
+
+/************************************************************************/
+/*                          GPMaskImageData()                           */
+/*                                                                      */
+/*      Mask out image pixels to a special nodata value if the mask     */
+/*      band is zero.                                                   */
+/************************************************************************/
+
+static CPLErr 
+GPMaskImageData( GDALRasterBandH hMaskBand, GByte* pabyMaskLine, int iY, int nXSize, 
+                 GInt32 *panImageLine )
+
+{
+    CPLErr eErr;
+
+    eErr = GDALRasterIO( hMaskBand, GF_Read, 0, iY, nXSize, 1, 
+                         pabyMaskLine, nXSize, 1, GDT_Byte, 0, 0 );
+    if( eErr == CE_None )
+    {
+        int i;
+        for( i = 0; i < nXSize; i++ )
+        {
+            if( pabyMaskLine[i] == 0 )
+                panImageLine[i] = GP_NODATA_MARKER;
+        }
+    }
+
+    return eErr;
+}
+
+/************************************************************************/
+/* ==================================================================== */
+/*                         GPTiledPolygonizer                           */
+/*                                                                      */
+/*      Multithreaded version of the algorithm.  The raster is split    */
+/*      in tiles of whole lines that are processed as jobs of the       */
+/*      worker thread pool, in two passes as above:                     */
+/*                                                                      */
+/*      - the polygons of each tile are enumerated on their own, and    */
+/*        the ids of the polygons touching the seam between two tiles   */
+/*        are merged by applying the rules of ProcessLine() to the      */
+/*        two lines of the seam, so the final polygons are exactly the  */
+/*        ones of the single pass enumeration.                          */
+/*      - the edges of the polygons lying within a single tile are      */
+/*        collected, and the polygons turned into geometries, by the    */
+/*        job of the tile.  The edges of the polygons spanning several  */
+/*        tiles are recorded, and added afterwards to their RPolygon    */
+/*        in the order of the sequential algorithm, so the rings are    */
+/*        identical.                                                    */
+/*                                                                      */
+/*      The raster is read, and the features are written, from the      */
+/*      calling thread only.  It writes the polygons closed by the      */
+/*      tile jobs while they are running.                               */
+/* ==================================================================== */
+/************************************************************************/
+
+struct GPInt32Traits
+{
+    typedef GInt32 DataType;
+    typedef GDALRasterPolygonEnumerator EnumType;
+
+    static GDALDataType GetType() { return GDT_Int32; }
+    static int Equals( GInt32 nA, GInt32 nB ) { return nA == nB; }
+    static GInt32 GetPolyValue( EnumType *poEnum, int iPoly )
+        { return poEnum->panPolyValue[iPoly]; }
+    static int IsNoData( GInt32 nValue )
+        { return nValue == GP_NODATA_MARKER; }
+    static void SetField( OGRFeatureH hFeat, int iField, GInt32 nValue )
+        { OGR_F_SetFieldInteger( hFeat, iField, nValue ); }
+};
+
+struct GPFloat32Traits
+{
+    typedef float DataType;
+    typedef GDALRasterFPolygonEnumerator EnumType;
+
+    static GDALDataType GetType() { return GDT_Float32; }
+    static int Equals( float fA, float fB ) { return GDALFloatEquals( fA, fB ); }
+    static float GetPolyValue( EnumType *poEnum, int iPoly )
+        { return poEnum->pafPolyValue[iPoly]; }
+    static int IsNoData( float fValue )
+        { return GDALFloatEquals( fValue, GP_NODATA_MARKER ); }
+    static void SetField( OGRFeatureH hFeat, int iField, float fValue )
+        { OGR_F_SetFieldDouble( hFeat, iField, (double) fValue ); }
+};
+
+/************************************************************************/
+/*                            GPFindRoot()                              */
+/************************************************************************/
+
+static int GPFindRoot( GInt32 *panPolyIdMap, int iPoly )
+
+{
+    while( panPolyIdMap[iPoly] != iPoly )
+    {
+        panPolyIdMap[iPoly] = panPolyIdMap[panPolyIdMap[iPoly]];
+        iPoly = panPolyIdMap[iPoly];
+    }
+
+    return iPoly;
+}
+
+/************************************************************************/
+/*                           GPMergePolygon()                           */
+/************************************************************************/
+
+static void GPMergePolygon( GInt32 *panPolyIdMap, int nSrcId, int nDstId )
+
+{
+    nSrcId = GPFindRoot( panPolyIdMap, nSrcId );
+    nDstId = GPFindRoot( panPolyIdMap, nDstId );
+
+    if( nSrcId != nDstId )
+        panPolyIdMap[nSrcId] = nDstId;
+}
+
+/************************************************************************/
+/*                            GPMergeSeam()                             */
+/*                                                                      */
+/*      Merge the polygons across the seam between the last line of     */
+/*      a tile and the first line of the next one, with the same        */
+/*      neighbour tests as ProcessLine() for the first line of a tile   */
+/*      when it is not the first line of the raster.                    */
+/************************************************************************/
+
+template<class Traits> static void
+GPMergeSeam( const typename Traits::DataType *paLastLineVal,
+             const GInt32 *panLastLineId, int nLastIdOffset,
+             const typename Traits::DataType *paThisLineVal,
+             const GInt32 *panThisLineId, int nThisIdOffset,
+             int nXSize, int nConnectedness, GInt32 *panPolyIdMap )
+
+{
+    int i;
+
+    for( i = 0; i < nXSize; i++ )
+    {
+        const int nThisId = panThisLineId[i] + nThisIdOffset;
+
+        if( i > 0 && Traits::Equals( paThisLineVal[i], paThisLineVal[i-1] ) )
+        {
+            if( Traits::Equals( paLastLineVal[i], paThisLineVal[i] ) )
+                GPMergePolygon( panPolyIdMap,
+                                panLastLineId[i] + nLastIdOffset, nThisId );
+
+            if( nConnectedness == 8
+                && paLastLineVal[i-1] == paThisLineVal[i] )
+                GPMergePolygon( panPolyIdMap,
+                                panLastLineId[i-1] + nLastIdOffset, nThisId );
+
+            if( nConnectedness == 8 && i < nXSize-1
+                && paLastLineVal[i+1] == paThisLineVal[i] )
+                GPMergePolygon( panPolyIdMap,
+                                panLastLineId[i+1] + nLastIdOffset, nThisId );
+        }
+        else if( Traits::Equals( paLastLineVal[i], paThisLineVal[i] ) )
+        {
+            GPMergePolygon( panPolyIdMap,
+                            panLastLineId[i] + nLastIdOffset, nThisId );
+        }
+        else if( i > 0 && nConnectedness == 8
+                 && Traits::Equals( paLastLineVal[i-1], paThisLineVal[i] ) )
+        {
+            GPMergePolygon( panPolyIdMap,
+                            panLastLineId[i-1] + nLastIdOffset, nThisId );
+
+            if( i < nXSize-1 && paLastLineVal[i+1] == paThisLineVal[i] )
+                GPMergePolygon( panPolyIdMap,
+                                panLastLineId[i+1] + nLastIdOffset, nThisId );
+        }
+        else if( i < nXSize-1 && nConnectedness == 8
+                 && Traits::Equals( paLastLineVal[i+1], paThisLineVal[i] ) )
+        {
+            GPMergePolygon( panPolyIdMap,
+                            panLastLineId[i+1] + nLastIdOffset, nThisId );
+        }
+    }
+}
+
+template<class DataType> struct GPPolygonGeometry
+{
+    OGRGeometryH hGeom;
+    DataType     nValue;
+};
+
+template<class Traits> class GPTiledPolygonizer;
+
+template<class Traits> class GPTile
+{
+public:
+    typedef typename Traits::DataType DataType;
+
+    GPTile() : poPolygonizer(NULL), iTile(0), nYOff(0), nLines(0),
+               paValues(NULL), panIdBuffer(NULL), poEnum(NULL),
+               nIdOffset(0), paFirstLineVal(NULL), paLastLineVal(NULL),
+               panFirstLineId(NULL), panLastLineId(NULL),
+               nLastSeamPoly(-1), panLastSeamEdges(NULL) {}
+
+    GPTiledPolygonizer<Traits> *poPolygonizer;
+    int         iTile;
+    int         nYOff;
+    int         nLines;
+
+    /* Image data of the tile, and working id lines, while processed */
+    DataType   *paValues;
+    GInt32     *panIdBuffer;
+
+    /* First pass: enumeration of the polygons of the tile, and the     */
+    /* lines on its seams.  Once the seams are merged, panLastLineId    */
+    /* holds the final ids of the last line.                            */
+    typename Traits::EnumType *poEnum;
+    int         nIdOffset;
+    DataType   *paFirstLineVal;
+    DataType   *paLastLineVal;
+    GInt32     *panFirstLineId;
+    GInt32     *panLastLineId;
+
+    /* Second pass: polygons of the tile still being collected, edges   */
+    /* of the polygons spanning several tiles, and closed polygons.     */
+    std::vector<int> anActivePolys;
+    std::map<int, std::vector<int> > oSeamEdges;
+    int         nLastSeamPoly;
+    std::vector<int> *panLastSeamEdges;
+    std::vector< GPPolygonGeometry<DataType> > aoPolygons;
+};
+
+template<class Traits> class GPTiledPolygonizer
+{
+public:
+    typedef typename Traits::DataType DataType;
+    typedef typename Traits::EnumType EnumType;
+    typedef GPTile<Traits> Tile;
+
+    struct SeamJob
+    {
+        GPTiledPolygonizer *poPolygonizer;
+        int         iJob;
+        int         nJobs;
+        int         iFirstTile;
+        int         iLastTile;
+        std::vector< GPPolygonGeometry<DataType> > aoPolygons;
+    };
+
+                GPTiledPolygonizer( GDALRasterBandH hSrcBand,
+                                    GDALRasterBandH hMaskBand,
+                                    int nConnectedness );
+               ~GPTiledPolygonizer();
+
+    CPLErr      Run( OGRLayerH hOutLayer, int iPixValField,
+                     int nThreads, int nTileHeight,
+                     GDALProgressFunc pfnProgress, void *pProgressArg );
+
+private:
+    GDALRasterBandH hSrcBand;
+    GDALRasterBandH hMaskBand;
+    int         nConnectedness;
+    int         nXSize;
+    int         nYSize;
+    double      adfGeoTransform[6];
+
+    std::vector<Tile *> apoTiles;
+
+    /* Final polygons, indexed by their id in the global id space.  */
+    /* Only the entries of root ids are meaningful.  Once the seams  */
+    /* are merged, panPolyIdMap gives the root id of any id, or      */
+    /* -2-id for the polygons spanning several tiles.                */
+    int         nPolyCount;
+    GInt32     *panPolyIdMap;
+    GInt32     *panFirstTile;
+    GInt32     *panLastTile;
+    DataType   *paPolyValue;
+    RPolygon  **papoPoly;
+
+    /* Polygons closed by the running tile jobs, not yet written */
+    void       *hMutex;
+    void       *hCond;
+    int         nRunningJobs;
+    std::vector< GPPolygonGeometry<DataType> > aoPendingPolygons;
+
+    CPLErr      ReadTile( Tile *poTile );
+    void        FreeTileData( Tile *poTile );
+    CPLErr      ProcessTiles( int bSecondPass, int nThreads,
+                              OGRLayerH hOutLayer, int iPixValField,
+                              double dfProgressStart, double dfProgressEnd,
+                              GDALProgressFunc pfnProgress,
+                              void *pProgressArg );
+    CPLErr      MergeTiles();
+    CPLErr      FinishTiles( int iFirstTile, int iLastTile, int nThreads,
+                             OGRLayerH hOutLayer, int iPixValField );
+    CPLErr      WritePendingPolygons( CPLJobGroup *psJobGroup,
+                                      OGRLayerH hOutLayer, int iPixValField );
+    static CPLErr WritePolygons(
+                    std::vector< GPPolygonGeometry<DataType> > &aoPolygons,
+                    CPLErr eErr, OGRLayerH hOutLayer, int iPixValField );
+
+    void        AddEdge( Tile *poTile, int iPoly,
+                         int x1, int y1, int x2, int y2 );
+    void        AddEdges( Tile *poTile, GInt32 *panThisLineId,
+                          GInt32 *panLastLineId, int iY );
+    void        FlushPolygons( Tile *poTile, int iY );
+    void        ClosePolygon( int iPoly,
+                    std::vector< GPPolygonGeometry<DataType> > &aoPolygons );
+
+    static void EnumerateTileFunc( void *pData );
+    static void CollectTileFunc( void *pData );
+    static void AddSeamEdgesFunc( void *pData );
+};
+
+/************************************************************************/
+/*                         GPTiledPolygonizer()                         */
+/************************************************************************/
+
+template<class Traits>
+GPTiledPolygonizer<Traits>::GPTiledPolygonizer( GDALRasterBandH hSrcBandIn,
+                                                GDALRasterBandH hMaskBandIn,
+                                                int nConnectednessIn )
+
+{
+    hSrcBand = hSrcBandIn;
+    hMaskBand = hMaskBandIn;
+    nConnectedness = nConnectednessIn;
+    nXSize = GDALGetRasterBandXSize( hSrcBand );
+    nYSize = GDALGetRasterBandYSize( hSrcBand );
+
+    adfGeoTransform[0] = 0.0;
+    adfGeoTransform[1] = 1.0;
+    adfGeoTransform[2] = 0.0;
+    adfGeoTransform[3] = 0.0;
+    adfGeoTransform[4] = 0.0;
+    adfGeoTransform[5] = 1.0;
+
+    GDALDatasetH hSrcDS = GDALGetBandDataset( hSrcBand );
+    if( hSrcDS )
+        GDALGetGeoTransform( hSrcDS, adfGeoTransform );
+
+    nPolyCount = 0;
+    panPolyIdMap = NULL;
+    panFirstTile = NULL;
+    panLastTile = NULL;
+    paPolyValue = NULL;
+    papoPoly = NULL;
+
+    hMutex = NULL;
+    hCond = CPLCreateCond();
+    if( hCond != NULL )
+    {
+        hMutex = CPLCreateMutex();
+        CPLReleaseMutex( hMutex );
+    }
+    nRunningJobs = 0;
+}
+
+/************************************************************************/
+/*                        ~GPTiledPolygonizer()                         */
+/************************************************************************/
+
+template<class Traits>
+GPTiledPolygonizer<Traits>::~GPTiledPolygonizer()
+
+{
+    size_t iTile, iPoly;
+    int i;
+
+    for( iTile = 0; iTile < apoTiles.size(); iTile++ )
+    {
+        Tile *poTile = apoTiles[iTile];
+
+        FreeTileData( poTile );
+        delete poTile->poEnum;
+        CPLFree( poTile->paFirstLineVal );
+        CPLFree( poTile->paLastLineVal );
+        CPLFree( poTile->panFirstLineId );
+        CPLFree( poTile->panLastLineId );
+        for( iPoly = 0; iPoly < poTile->aoPolygons.size(); iPoly++ )
+            OGR_G_DestroyGeometry( poTile->aoPolygons[iPoly].hGeom );
+        delete poTile;
+    }
+
+    if( papoPoly != NULL )
+    {
+        for( i = 0; i < nPolyCount; i++ )
+            delete papoPoly[i];
+    }
+
+    CPLFree( panPolyIdMap );
+    CPLFree( panFirstTile );
+    CPLFree( panLastTile );
+    CPLFree( paPolyValue );
+    CPLFree( papoPoly );
+
+    for( iPoly = 0; iPoly < aoPendingPolygons.size(); iPoly++ )
+        OGR_G_DestroyGeometry( aoPendingPolygons[iPoly].hGeom );
+    if( hCond != NULL )
+        CPLDestroyCond( hCond );
+    if( hMutex != NULL )
+        CPLDestroyMutex( hMutex );
+}
+
+/************************************************************************/
+/*                              ReadTile()                              */
+/************************************************************************/
+
+template<class Traits>
+CPLErr GPTiledPolygonizer<Traits>::ReadTile( Tile *poTile )
+
+{
+    CPLErr eErr;
+
+    poTile->paValues = (DataType *)
+        VSIMalloc3( sizeof(DataType), nXSize, poTile->nLines );
+    poTile->panIdBuffer = (GInt32 *)
+        VSIMalloc2( sizeof(GInt32) * 4, nXSize + 2 );
+    if( poTile->paValues == NULL || poTile->panIdBuffer == NULL )
+    {
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "Could not allocate enough memory for temporary buffers" );
+        return CE_Failure;
+    }
+
+    eErr = GDALRasterIO( hSrcBand, GF_Read, 0, poTile->nYOff,
+                         nXSize, poTile->nLines,
+                         poTile->paValues, nXSize, poTile->nLines,
+                         Traits::GetType(), 0, 0 );
+
+/* -------------------------------------------------------------------- */
+/*      Mask out image pixels to a special nodata value if the mask     */
+/*      band is zero.                                                   */
+/* -------------------------------------------------------------------- */
+    if( eErr == CE_None && hMaskBand != NULL )
+    {
+        GByte *pabyMask = (GByte *) VSIMalloc2( nXSize, poTile->nLines );
+        if( pabyMask == NULL )
+        {
+            CPLError( CE_Failure, CPLE_OutOfMemory,
+                      "Could not allocate enough memory for temporary buffers" );
+            return CE_Failure;
+        }
+
+        eErr = GDALRasterIO( hMaskBand, GF_Read, 0, poTile->nYOff,
+                             nXSize, poTile->nLines,
+                             pabyMask, nXSize, poTile->nLines,
+                             GDT_Byte, 0, 0 );
+        if( eErr == CE_None )
+        {
+            size_t i, nCount = (size_t) nXSize * poTile->nLines;
+            for( i = 0; i < nCount; i++ )
+            {
+                if( pabyMask[i] == 0 )
+                    poTile->paValues[i] = GP_NODATA_MARKER;
+            }
+        }
+        CPLFree( pabyMask );
+    }
+
+    return eErr;
+}
+
+/************************************************************************/
+/*                            FreeTileData()                            */
+/************************************************************************/
+
+template<class Traits>
+void GPTiledPolygonizer<Traits>::FreeTileData( Tile *poTile )
+
+{
+    CPLFree( poTile->paValues );
+    CPLFree( poTile->panIdBuffer );
+    poTile->paValues = NULL;
+    poTile->panIdBuffer = NULL;
+}
+
+/************************************************************************/
+/*                         EnumerateTileFunc()                          */
+/*                                                                      */
+/*      First pass job: enumerate the polygons of the tile, and keep    */
+/*      the values and final ids of its first and last lines.          */
+/************************************************************************/
+
+template<class Traits>
+void GPTiledPolygonizer<Traits>::EnumerateTileFunc( void *pData )
+
+{
+    Tile *poTile = (Tile *) pData;
+    const int nXSize = poTile->poPolygonizer->nXSize;
+    GInt32 *panLastLineId = poTile->panIdBuffer;
+    GInt32 *panThisLineId = poTile->panIdBuffer + nXSize;
+    int iLine, i;
+
+    poTile->poEnum =
+        new EnumType( poTile->poPolygonizer->nConnectedness );
+
+    for( iLine = 0; iLine < poTile->nLines; iLine++ )
+    {
+        DataType *paThisLineVal = poTile->paValues + (size_t) iLine * nXSize;
+
+        if( iLine == 0 )
+        {
+            poTile->poEnum->ProcessLine(
+                NULL, paThisLineVal, NULL, panThisLineId, nXSize );
+            memcpy( poTile->panFirstLineId, panThisLineId,
+                    sizeof(GInt32) * nXSize );
+        }
+        else
+            poTile->poEnum->ProcessLine(
+                paThisLineVal - nXSize, paThisLineVal,
+                panLastLineId, panThisLineId, nXSize );
+
+        GInt32 *panTmp = panThisLineId;
+        panThisLineId = panLastLineId;
+        panLastLineId = panTmp;
+    }
+
+    poTile->poEnum->CompleteMerges();
+
+    for( i = 0; i < nXSize; i++ )
+    {
+        poTile->panFirstLineId[i] =
+            poTile->poEnum->panPolyIdMap[poTile->panFirstLineId[i]];
+        poTile->panLastLineId[i] =
+            poTile->poEnum->panPolyIdMap[panLastLineId[i]];
+    }
+
+    memcpy( poTile->paFirstLineVal, poTile->paValues,
+            sizeof(DataType) * nXSize );
+    memcpy( poTile->paLastLineVal,
+            poTile->paValues + (size_t) (poTile->nLines - 1) * nXSize,
+            sizeof(DataType) * nXSize );
+}
+
+/************************************************************************/
+/*                             MergeTiles()                             */
+/*                                                                      */
+/*      Build the global polygon id space from the enumerations of      */
+/*      the tiles, merge the polygons across the seams, and find the    */
+/*      range of tiles collecting edges of each polygon.                */
+/************************************************************************/
+
+template<class Traits>
+CPLErr GPTiledPolygonizer<Traits>::MergeTiles()
+
+{
+    size_t iTile;
+    int i;
+
+    nPolyCount = 0;
+    for( iTile = 0; iTile < apoTiles.size(); iTile++ )
+    {
+        apoTiles[iTile]->nIdOffset = nPolyCount;
+        nPolyCount += apoTiles[iTile]->poEnum->nNextPolygonId;
+    }
+
+    panPolyIdMap = (GInt32 *) VSIMalloc2( sizeof(GInt32), nPolyCount );
+    panFirstTile = (GInt32 *) VSIMalloc2( sizeof(GInt32), nPolyCount );
+    panLastTile = (GInt32 *) VSIMalloc2( sizeof(GInt32), nPolyCount );
+    paPolyValue = (DataType *) VSIMalloc2( sizeof(DataType), nPolyCount );
+    papoPoly = (RPolygon **) VSICalloc( sizeof(RPolygon *), nPolyCount );
+    if( panPolyIdMap == NULL || panFirstTile == NULL || panLastTile == NULL
+        || paPolyValue == NULL || papoPoly == NULL )
+    {
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "Could not allocate enough memory for polygon maps" );
+        return CE_Failure;
+    }
+
+    for( iTile = 0; iTile < apoTiles.size(); iTile++ )
+    {
+        Tile *poTile = apoTiles[iTile];
+
+        for( i = 0; i < poTile->poEnum->nNextPolygonId; i++ )
+            panPolyIdMap[poTile->nIdOffset + i] =
+                poTile->nIdOffset + poTile->poEnum->panPolyIdMap[i];
+
+        if( iTile > 0 )
+        {
+            Tile *poPrevTile = apoTiles[iTile-1];
+
+            GPMergeSeam<Traits>( poPrevTile->paLastLineVal,
+                                 poPrevTile->panLastLineId,
+                                 poPrevTile->nIdOffset,
+                                 poTile->paFirstLineVal,
+                                 poTile->panFirstLineId,
+                                 poTile->nIdOffset,
+                                 nXSize, nConnectedness, panPolyIdMap );
+        }
+    }
+
+    for( i = 0; i < nPolyCount; i++ )
+    {
+        panPolyIdMap[i] = GPFindRoot( panPolyIdMap, i );
+        panFirstTile[i] = -1;
+        panLastTile[i] = -1;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      A polygon collects edges from the tiles it has pixels in, and   */
+/*      from the tile after its last line.                              */
+/* -------------------------------------------------------------------- */
+    for( iTile = 0; iTile < apoTiles.size(); iTile++ )
+    {
+        Tile *poTile = apoTiles[iTile];
+
+        for( i = 0; i < poTile->poEnum->nNextPolygonId; i++ )
+        {
+            if( poTile->poEnum->panPolyIdMap[i] != i )
+                continue;
+
+            const int iPoly = panPolyIdMap[poTile->nIdOffset + i];
+            if( panFirstTile[iPoly] < 0 )
+            {
+                panFirstTile[iPoly] = (int) iTile;
+                paPolyValue[iPoly] = Traits::GetPolyValue( poTile->poEnum, i );
+            }
+            panLastTile[iPoly] = (int) iTile;
+        }
+
+        for( i = 0; i < nXSize; i++ )
+        {
+            const int iPoly =
+                panPolyIdMap[poTile->nIdOffset + poTile->panLastLineId[i]];
+
+            poTile->panLastLineId[i] = iPoly;
+            if( iTile + 1 < apoTiles.size() )
+                panLastTile[iPoly] = (int) iTile + 1;
+        }
+
+        delete poTile->poEnum;
+        poTile->poEnum = NULL;
+        CPLFree( poTile->paFirstLineVal );
+        CPLFree( poTile->paLastLineVal );
+        CPLFree( poTile->panFirstLineId );
+        poTile->paFirstLineVal = NULL;
+        poTile->paLastLineVal = NULL;
+        poTile->panFirstLineId = NULL;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Flag the polygons spanning several tiles in the id map, so      */
+/*      that the tile jobs can tell them without looking up their       */
+/*      tile range.                                                     */
+/* -------------------------------------------------------------------- */
+    for( iTile = 0; iTile < apoTiles.size(); iTile++ )
+    {
+        Tile *poTile = apoTiles[iTile];
+
+        for( i = 0; i < nXSize; i++ )
+        {
+            const int iPoly = poTile->panLastLineId[i];
+
+            if( panFirstTile[iPoly] != panLastTile[iPoly] )
+                poTile->panLastLineId[i] = -2 - iPoly;
+        }
+    }
+
+    for( i = 0; i < nPolyCount; i++ )
+    {
+        const int iPoly = panPolyIdMap[i];
+
+        if( panFirstTile[iPoly] != panLastTile[iPoly] )
+            panPolyIdMap[i] = -2 - iPoly;
+    }
+
+    return CE_None;
+}
+
+/************************************************************************/
+/*                              AddEdge()                               */
+/************************************************************************/
+
+template<class Traits>
+void GPTiledPolygonizer<Traits>::AddEdge( Tile *poTile, int iPoly,
+                                          int x1, int y1, int x2, int y2 )
+
+{
+    if( iPoly >= 0 )
+    {
+        /* Only this tile knows about this polygon. */
+        if( papoPoly[iPoly] == NULL )
+        {
+            papoPoly[iPoly] = new RPolygon( 0 );
+            poTile->anActivePolys.push_back( iPoly );
+        }
+
+        papoPoly[iPoly]->AddSegment( x1, y1, x2, y2 );
+        return;
+    }
+
+    iPoly = -2 - iPoly;
+    if( iPoly != poTile->nLastSeamPoly )
+    {
+        poTile->panLastSeamEdges = &(poTile->oSeamEdges[iPoly]);
+        poTile->nLastSeamPoly = iPoly;
+    }
+
+    std::vector<int> &anEdges = *(poTile->panLastSeamEdges);
+    anEdges.push_back( x1 );
+    anEdges.push_back( y1 );
+    anEdges.push_back( x2 );
+    anEdges.push_back( y2 );
+}
+
+/************************************************************************/
+/*                              AddEdges()                              */
+/*                                                                      */
+/*      Same as the AddEdges() function above for a whole line of       */
+/*      final polygon ids (with the encoding of panPolyIdMap).          */
+/************************************************************************/
+
+template<class Traits>
+void GPTiledPolygonizer<Traits>::AddEdges( Tile *poTile,
+                                           GInt32 *panThisLineId,
+                                           GInt32 *panLastLineId, int iY )
+
+{
+    int iX;
+
+    for( iX = 0; iX < nXSize+1; iX++ )
+    {
+        int nThisId = panThisLineId[iX];
+        int nRightId = panThisLineId[iX+1];
+        int nPreviousId = panLastLineId[iX];
+        int iXReal = iX - 1;
+
+        if( nThisId != nPreviousId )
+        {
+            if( nThisId != -1 )
+                AddEdge( poTile, nThisId, iXReal, iY, iXReal+1, iY );
+            if( nPreviousId != -1 )
+                AddEdge( poTile, nPreviousId, iXReal, iY, iXReal+1, iY );
+        }
+
+        if( nThisId != nRightId )
+        {
+            if( nThisId != -1 )
+                AddEdge( poTile, nThisId, iXReal+1, iY, iXReal+1, iY+1 );
+            if( nRightId != -1 )
+                AddEdge( poTile, nRightId, iXReal+1, iY, iXReal+1, iY+1 );
+        }
+    }
+}
+
+/************************************************************************/
+/*                            ClosePolygon()                            */
+/************************************************************************/
+
+template<class Traits>
+void GPTiledPolygonizer<Traits>::ClosePolygon( int iPoly,
+                    std::vector< GPPolygonGeometry<DataType> > &aoPolygons )
+
+{
+    if( hMaskBand == NULL || !Traits::IsNoData( paPolyValue[iPoly] ) )
+    {
+        GPPolygonGeometry<DataType> sPolygon;
+
+        sPolygon.hGeom = RPolygonToGeometry( papoPoly[iPoly], adfGeoTransform );
+        sPolygon.nValue = paPolyValue[iPoly];
+        aoPolygons.push_back( sPolygon );
+    }
+
+    delete papoPoly[iPoly];
+    papoPoly[iPoly] = NULL;
+}
+
+/************************************************************************/
+/*                           FlushPolygons()                            */
+/*                                                                      */
+/*      Close the polygons of the tile not added to since the line      */
+/*      before iY, or all of them if iY is -1.                          */
+/************************************************************************/
+
+template<class Traits>
+void GPTiledPolygonizer<Traits>::FlushPolygons( Tile *poTile, int iY )
 
 {
-    OGRFeatureH hFeat;
-    OGRGeometryH hPolygon;
+    size_t i, nActive = 0;
 
-/* -------------------------------------------------------------------- */
-/*      Turn bits of lines into coherent rings.                         */
-/* -------------------------------------------------------------------- */
-    poRPoly->Coalesce();
+    for( i = 0; i < poTile->anActivePolys.size(); i++ )
+    {
+        const int iPoly = poTile->anActivePolys[i];
+
+        if( iY < 0 || papoPoly[iPoly]->nLastLineUpdated < iY-1 )
+            ClosePolygon( iPoly, poTile->aoPolygons );
+        else
+            poTile->anActivePolys[nActive++] = iPoly;
+    }
+
+    poTile->anActivePolys.resize( nActive );
 
 /* -------------------------------------------------------------------- */
-/*      Create the polygon geometry.                                    */
+/*      Hand the closed polygons over to the writing thread.            */
 /* -------------------------------------------------------------------- */
-    size_t iString;
+    if( hMutex != NULL && !poTile->aoPolygons.empty() )
+    {
+        CPLAcquireMutex( hMutex, 1000.0 );
+        aoPendingPolygons.insert( aoPendingPolygons.end(),
+                                  poTile->aoPolygons.begin(),
+                                  poTile->aoPolygons.end() );
+        CPLCondSignal( hCond );
+        CPLReleaseMutex( hMutex );
+        poTile->aoPolygons.clear();
+    }
+}
 
-    hPolygon = OGR_G_CreateGeometry( wkbPolygon );
-    
-    for( iString = 0; iString < poRPoly->aanXY.size(); iString++ )
+/************************************************************************/
+/*                          CollectTileFunc()                           */
+/*                                                                      */
+/*      Second pass job: enumerate the polygons of the tile again to    */
+/*      find the final id of each pixel, and collect the edges within   */
+/*      and above the lines of the tile (and below the last line of     */
+/*      the raster).                                                    */
+/************************************************************************/
+
+template<class Traits>
+void GPTiledPolygonizer<Traits>::CollectTileFunc( void *pData )
+
+{
+    Tile *poTile = (Tile *) pData;
+    GPTiledPolygonizer *poThis = poTile->poPolygonizer;
+    const int nXSize = poThis->nXSize;
+    GInt32 *panLastLineRawId = poTile->panIdBuffer;
+    GInt32 *panThisLineRawId = panLastLineRawId + (nXSize + 2);
+    GInt32 *panLastLineId = panThisLineRawId + (nXSize + 2);
+    GInt32 *panThisLineId = panLastLineId + (nXSize + 2);
+    EnumType oEnum( poThis->nConnectedness );
+    int iY, iX;
+
+    panThisLineId[0] = -1;
+    panThisLineId[nXSize+1] = -1;
+    panLastLineId[0] = -1;
+    panLastLineId[nXSize+1] = -1;
+
+    for( iX = 0; iX < nXSize; iX++ )
     {
-        std::vector<int> &anString = poRPoly->aanXY[iString];
-        OGRGeometryH hRing = OGR_G_CreateGeometry( wkbLinearRing );
+        if( poTile->iTile == 0 )
+            panLastLineId[iX+1] = -1;
+        else
+            panLastLineId[iX+1] =
+                poThis->apoTiles[poTile->iTile-1]->panLastLineId[iX];
+    }
 
-        int iVert;
+    int nYEnd = poTile->nYOff + poTile->nLines;
+    if( nYEnd == poThis->nYSize )
+        nYEnd ++;
 
-        // we go last to first to ensure the linestring is allocated to 
-        // the proper size on the first try.
-        for( iVert = anString.size()/2 - 1; iVert >= 0; iVert-- )
+    for( iY = poTile->nYOff; iY < nYEnd; iY++ )
+    {
+        const int iLine = iY - poTile->nYOff;
+
+        if( iY == poThis->nYSize )
         {
-            double dfX, dfY;
-            int    nPixelX, nPixelY;
-            
-            nPixelX = anString[iVert*2];
-            nPixelY = anString[iVert*2+1];
+            for( iX = 0; iX < nXSize+2; iX++ )
+                panThisLineId[iX] = -1;
+        }
+        else
+        {
+            DataType *paThisLineVal =
+                poTile->paValues + (size_t) iLine * nXSize;
+
+            if( iLine == 0 )
+                oEnum.ProcessLine( NULL, paThisLineVal,
+                                   NULL, panThisLineRawId, nXSize );
+            else
+                oEnum.ProcessLine( paThisLineVal - nXSize, paThisLineVal,
+                                   panLastLineRawId, panThisLineRawId,
+                                   nXSize );
+
+            for( iX = 0; iX < nXSize; iX++ )
+                panThisLineId[iX+1] = poThis->panPolyIdMap[
+                    poTile->nIdOffset + panThisLineRawId[iX]];
+        }
 
-            dfX = padfGeoTransform[0] 
-                + nPixelX * padfGeoTransform[1]
-                + nPixelY * padfGeoTransform[2];
-            dfY = padfGeoTransform[3] 
-                + nPixelX * padfGeoTransform[4]
-                + nPixelY * padfGeoTransform[5];
+        poThis->AddEdges( poTile, panThisLineId, panLastLineId, iY );
 
-            OGR_G_SetPoint_2D( hRing, iVert, dfX, dfY );
+        if( iY % 8 == 7 )
+            poThis->FlushPolygons( poTile, iY );
+
+        GInt32 *panTmp = panLastLineRawId;
+        panLastLineRawId = panThisLineRawId;
+        panThisLineRawId = panTmp;
+
+        panTmp = panThisLineId;
+        panThisLineId = panLastLineId;
+        panLastLineId = panTmp;
+    }
+
+    poThis->FlushPolygons( poTile, -1 );
+
+    if( poThis->hMutex != NULL )
+    {
+        CPLAcquireMutex( poThis->hMutex, 1000.0 );
+        poThis->nRunningJobs --;
+        CPLCondSignal( poThis->hCond );
+        CPLReleaseMutex( poThis->hMutex );
+    }
+}
+
+/************************************************************************/
+/*                          AddSeamEdgesFunc()                          */
+/*                                                                      */
+/*      Add the recorded edges of the polygons spanning several tiles   */
+/*      to their RPolygon, tile after tile, and close the polygons      */
+/*      whose last tile is reached.  Each job processes its own         */
+/*      subset of the polygons.                                         */
+/************************************************************************/
+
+template<class Traits>
+void GPTiledPolygonizer<Traits>::AddSeamEdgesFunc( void *pData )
+
+{
+    SeamJob *psJob = (SeamJob *) pData;
+    GPTiledPolygonizer *poThis = psJob->poPolygonizer;
+    int iTile;
+
+    for( iTile = psJob->iFirstTile; iTile < psJob->iLastTile; iTile++ )
+    {
+        std::map<int, std::vector<int> > &oSeamEdges =
+            poThis->apoTiles[iTile]->oSeamEdges;
+        std::map<int, std::vector<int> >::const_iterator oIter;
+
+        for( oIter = oSeamEdges.begin(); oIter != oSeamEdges.end(); ++oIter )
+        {
+            const int iPoly = oIter->first;
+
+            if( iPoly % psJob->nJobs != psJob->iJob )
+                continue;
+
+            if( poThis->papoPoly[iPoly] == NULL )
+                poThis->papoPoly[iPoly] = new RPolygon( 0 );
+
+            RPolygon *poRPoly = poThis->papoPoly[iPoly];
+            const std::vector<int> &anEdges = oIter->second;
+            size_t i;
+
+            for( i = 0; i < anEdges.size(); i += 4 )
+                poRPoly->AddSegment( anEdges[i], anEdges[i+1],
+                                     anEdges[i+2], anEdges[i+3] );
+
+            if( poThis->panLastTile[iPoly] == iTile )
+                poThis->ClosePolygon( iPoly, psJob->aoPolygons );
         }
+    }
+}
 
-        OGR_G_AddGeometryDirectly( hPolygon, hRing );
+/************************************************************************/
+/*                            FinishTiles()                             */
+/*                                                                      */
+/*      Complete the polygons spanning several tiles once a range of    */
+/*      tiles is collected, and write all the closed polygons.          */
+/************************************************************************/
+
+template<class Traits>
+CPLErr GPTiledPolygonizer<Traits>::FinishTiles( int iFirstTile, int iLastTile,
+                                                int nThreads,
+                                                OGRLayerH hOutLayer,
+                                                int iPixValField )
+
+{
+    std::vector<SeamJob> asJobs( nThreads );
+    std::vector< std::vector< GPPolygonGeometry<DataType> > *> apaoPolygons;
+    CPLJobGroup *psJobGroup = CPLCreateJobGroup();
+    int iJob, iTile;
+
+    for( iJob = 0; iJob < nThreads; iJob++ )
+    {
+        asJobs[iJob].poPolygonizer = this;
+        asJobs[iJob].iJob = iJob;
+        asJobs[iJob].nJobs = nThreads;
+        asJobs[iJob].iFirstTile = iFirstTile;
+        asJobs[iJob].iLastTile = iLastTile;
+        CPLSubmitJob( psJobGroup, AddSeamEdgesFunc, &(asJobs[iJob]) );
     }
-    
+    CPLWaitJobGroup( psJobGroup );
+    CPLDestroyJobGroup( psJobGroup );
+
+    for( iTile = iFirstTile; iTile < iLastTile; iTile++ )
+    {
+        apoTiles[iTile]->oSeamEdges.clear();
+        apaoPolygons.push_back( &(apoTiles[iTile]->aoPolygons) );
+    }
+    for( iJob = 0; iJob < nThreads; iJob++ )
+        apaoPolygons.push_back( &(asJobs[iJob].aoPolygons) );
+
 /* -------------------------------------------------------------------- */
-/*      Create the feature object.                                      */
+/*      Write the polygons to the layer.                                */
 /* -------------------------------------------------------------------- */
-    hFeat = OGR_F_Create( OGR_L_GetLayerDefn( hOutLayer ) );
+    CPLErr eErr = CE_None;
+    size_t iList;
 
-    OGR_F_SetGeometryDirectly( hFeat, hPolygon );
+    for( iList = 0; iList < apaoPolygons.size(); iList++ )
+        eErr = WritePolygons( *(apaoPolygons[iList]), eErr,
+                              hOutLayer, iPixValField );
 
-    if( iPixValField >= 0 )
-        OGR_F_SetFieldInteger( hFeat, iPixValField, poRPoly->nPolyValue );
+    return eErr;
+}
 
-/* -------------------------------------------------------------------- */
-/*      Write the to the layer.                                         */
-/* -------------------------------------------------------------------- */
+/************************************************************************/
+/*                           WritePolygons()                            */
+/*                                                                      */
+/*      Write a list of polygons to the layer, and empty it.  The       */
+/*      geometries are only destroyed if eErr is already an error.      */
+/************************************************************************/
+
+template<class Traits>
+CPLErr GPTiledPolygonizer<Traits>::WritePolygons(
+                    std::vector< GPPolygonGeometry<DataType> > &aoPolygons,
+                    CPLErr eErr, OGRLayerH hOutLayer, int iPixValField )
+
+{
+    size_t iPoly;
+
+    for( iPoly = 0; iPoly < aoPolygons.size(); iPoly++ )
+    {
+        if( eErr != CE_None )
+        {
+            OGR_G_DestroyGeometry( aoPolygons[iPoly].hGeom );
+            continue;
+        }
+
+        OGRFeatureH hFeat = OGR_F_Create( OGR_L_GetLayerDefn( hOutLayer ) );
+
+        OGR_F_SetGeometryDirectly( hFeat, aoPolygons[iPoly].hGeom );
+
+        if( iPixValField >= 0 )
+            Traits::SetField( hFeat, iPixValField, aoPolygons[iPoly].nValue );
+
+        if( OGR_L_CreateFeature( hOutLayer, hFeat ) != OGRERR_NONE )
+            eErr = CE_Failure;
+
+        OGR_F_Destroy( hFeat );
+    }
+
+    aoPolygons.clear();
+
+    return eErr;
+}
+
+/************************************************************************/
+/*                        WritePendingPolygons()                        */
+/*                                                                      */
+/*      Write the polygons handed over by the tile jobs of the second   */
+/*      pass as they come, until all the jobs are done.  The calling    */
+/*      thread runs the jobs not started yet rather than waiting.       */
+/************************************************************************/
+
+template<class Traits>
+CPLErr GPTiledPolygonizer<Traits>::WritePendingPolygons(
+                                            CPLJobGroup *psJobGroup,
+                                            OGRLayerH hOutLayer,
+                                            int iPixValField )
+
+{
+    std::vector< GPPolygonGeometry<DataType> > aoPolygons;
     CPLErr eErr = CE_None;
 
-    if( OGR_L_CreateFeature( hOutLayer, hFeat ) != OGRERR_NONE )
-        eErr = CE_Failure;
+    CPLAcquireMutex( hMutex, 1000.0 );
+    while( TRUE )
+    {
+        if( !aoPendingPolygons.empty() )
+        {
+            aoPolygons.swap( aoPendingPolygons );
+            CPLReleaseMutex( hMutex );
 
-    OGR_F_Destroy( hFeat );
+            eErr = WritePolygons( aoPolygons, eErr, hOutLayer, iPixValField );
+
+            CPLAcquireMutex( hMutex, 1000.0 );
+        }
+        else if( nRunningJobs == 0 )
+        {
+            break;
+        }
+        else
+        {
+            CPLReleaseMutex( hMutex );
+            const int bRanJob = CPLRunPendingJob( psJobGroup );
+            CPLAcquireMutex( hMutex, 1000.0 );
+
+            if( !bRanJob && aoPendingPolygons.empty() && nRunningJobs > 0 )
+                CPLCondWait( hCond, hMutex );
+        }
+    }
+    CPLReleaseMutex( hMutex );
 
     return eErr;
 }
 
 /************************************************************************/
-/*                          GPMaskImageData()                           */
+/*                            ProcessTiles()                            */
 /*                                                                      */
-/*      Mask out image pixels to a special nodata value if the mask     */
-/*      band is zero.                                                   */
+/*      Run one of the passes over all the tiles, by groups of          */
+/*      nThreads tiles.  The next group is read while the current       */
+/*      one is processed.                                               */
 /************************************************************************/
 
-static CPLErr 
-GPMaskImageData( GDALRasterBandH hMaskBand, GByte* pabyMaskLine, int iY, int nXSize, 
-                 GInt32 *panImageLine )
+template<class Traits>
+CPLErr GPTiledPolygonizer<Traits>::ProcessTiles( int bSecondPass, int nThreads,
+                                                 OGRLayerH hOutLayer,
+                                                 int iPixValField,
+                                                 double dfProgressStart,
+                                                 double dfProgressEnd,
+                                                 GDALProgressFunc pfnProgress,
+                                                 void *pProgressArg )
 
 {
-    CPLErr eErr;
+    const int nTiles = (int) apoTiles.size();
+    CPLJobGroup *psJobGroup = CPLCreateJobGroup();
+    CPLErr eErr = CE_None;
+    int iTile, iFirstTile = 0;
 
-    eErr = GDALRasterIO( hMaskBand, GF_Read, 0, iY, nXSize, 1, 
-                         pabyMaskLine, nXSize, 1, GDT_Byte, 0, 0 );
-    if( eErr == CE_None )
+    for( iTile = 0; eErr == CE_None && iTile < MIN(nThreads, nTiles); iTile++ )
+        eErr = ReadTile( apoTiles[iTile] );
+
+    while( eErr == CE_None && iFirstTile < nTiles )
     {
-        int i;
-        for( i = 0; i < nXSize; i++ )
+        const int iLastTile = MIN(iFirstTile + nThreads, nTiles);
+
+        const int bStreamWrites = bSecondPass && hMutex != NULL;
+
+        if( bStreamWrites )
         {
-            if( pabyMaskLine[i] == 0 )
-                panImageLine[i] = GP_NODATA_MARKER;
+            CPLAcquireMutex( hMutex, 1000.0 );
+            nRunningJobs = iLastTile - iFirstTile;
+            CPLReleaseMutex( hMutex );
+        }
+
+        for( iTile = iFirstTile; iTile < iLastTile; iTile++ )
+            CPLSubmitJob( psJobGroup,
+                          bSecondPass ? CollectTileFunc : EnumerateTileFunc,
+                          apoTiles[iTile] );
+
+        for( iTile = iLastTile;
+             eErr == CE_None && iTile < MIN(iLastTile + nThreads, nTiles);
+             iTile++ )
+            eErr = ReadTile( apoTiles[iTile] );
+
+        if( bStreamWrites )
+        {
+            CPLErr eWriteErr = WritePendingPolygons( psJobGroup, hOutLayer,
+                                                     iPixValField );
+            if( eErr == CE_None )
+                eErr = eWriteErr;
+        }
+
+        CPLWaitJobGroup( psJobGroup );
+
+        for( iTile = iFirstTile; iTile < iLastTile; iTile++ )
+            FreeTileData( apoTiles[iTile] );
+
+        if( eErr == CE_None && bSecondPass )
+            eErr = FinishTiles( iFirstTile, iLastTile, nThreads,
+                                hOutLayer, iPixValField );
+
+/* -------------------------------------------------------------------- */
+/*      Report progress, and support interrupts.                        */
+/* -------------------------------------------------------------------- */
+        const int nLinesDone = (iLastTile == nTiles) ? nYSize :
+            apoTiles[iLastTile]->nYOff;
+
+        if( eErr == CE_None
+            && !pfnProgress( dfProgressStart + (dfProgressEnd - dfProgressStart)
+                             * (nLinesDone / (double) nYSize),
+                             "", pProgressArg ) )
+        {
+            CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+            eErr = CE_Failure;
+        }
+
+        iFirstTile = iLastTile;
+    }
+
+    CPLDestroyJobGroup( psJobGroup );
+
+    for( iTile = 0; iTile < nTiles; iTile++ )
+        FreeTileData( apoTiles[iTile] );
+
+    return eErr;
+}
+
+/************************************************************************/
+/*                                Run()                                 */
+/************************************************************************/
+
+template<class Traits>
+CPLErr GPTiledPolygonizer<Traits>::Run( OGRLayerH hOutLayer, int iPixValField,
+                                        int nThreads, int nTileHeight,
+                                        GDALProgressFunc pfnProgress,
+                                        void *pProgressArg )
+
+{
+    CPLErr eErr = CE_None;
+    int iTile;
+
+/* -------------------------------------------------------------------- */
+/*      Split the raster in tiles of whole lines.  By default, each     */
+/*      tile buffer is about 8MB, with at least one tile per thread.    */
+/* -------------------------------------------------------------------- */
+    if( nTileHeight <= 0 )
+    {
+        nTileHeight = MAX( 16, (int) (8 * 1024 * 1024 /
+                                      ((GIntBig) nXSize * sizeof(DataType))) );
+        nTileHeight = MIN( nTileHeight, (nYSize + nThreads - 1) / nThreads );
+    }
+    nTileHeight = MAX( 1, MIN( nTileHeight, nYSize ) );
+
+    const int nTiles = (nYSize + nTileHeight - 1) / nTileHeight;
+
+    for( iTile = 0; iTile < nTiles; iTile++ )
+    {
+        Tile *poTile = new Tile();
+
+        poTile->poPolygonizer = this;
+        poTile->iTile = iTile;
+        poTile->nYOff = iTile * nTileHeight;
+        poTile->nLines = MIN( nTileHeight, nYSize - poTile->nYOff );
+        poTile->paFirstLineVal = (DataType *)
+            VSIMalloc2( sizeof(DataType), nXSize );
+        poTile->paLastLineVal = (DataType *)
+            VSIMalloc2( sizeof(DataType), nXSize );
+        poTile->panFirstLineId = (GInt32 *)
+            VSIMalloc2( sizeof(GInt32), nXSize );
+        poTile->panLastLineId = (GInt32 *)
+            VSIMalloc2( sizeof(GInt32), nXSize );
+        apoTiles.push_back( poTile );
+
+        if( poTile->paFirstLineVal == NULL || poTile->paLastLineVal == NULL
+            || poTile->panFirstLineId == NULL || poTile->panLastLineId == NULL )
+        {
+            CPLError( CE_Failure, CPLE_OutOfMemory,
+                      "Could not allocate enough memory for temporary buffers" );
+            return CE_Failure;
         }
     }
 
+    CPLDebug( "GDALPolygonize", "Using %d tiles of %d lines with %d threads",
+              nTiles, nTileHeight, nThreads );
+
+/* -------------------------------------------------------------------- */
+/*      First pass: enumerate the polygons of each tile.                */
+/* -------------------------------------------------------------------- */
+    eErr = ProcessTiles( FALSE, nThreads, hOutLayer, iPixValField,
+                         0.0, 0.10, pfnProgress, pProgressArg );
+
+    if( eErr == CE_None )
+        eErr = MergeTiles();
+
+/* -------------------------------------------------------------------- */
+/*      Second pass: collect the polygon edges and write the            */
+/*      polygons.                                                       */
+/* -------------------------------------------------------------------- */
+    if( eErr == CE_None )
+        eErr = ProcessTiles( TRUE, nThreads, hOutLayer, iPixValField,
+                             0.10, 1.0, pfnProgress, pProgressArg );
+
     return eErr;
 }
+
+/************************************************************************/
+/*                        GDALPolygonizeTiled()                         */
+/*                                                                      */
+/*      Multithreaded implementation of GDALPolygonize() (or of         */
+/*      GDALFPolygonize() if bFloat is set).                            */
+/************************************************************************/
+
+CPLErr GDALPolygonizeTiled( GDALRasterBandH hSrcBand,
+                            GDALRasterBandH hMaskBand,
+                            OGRLayerH hOutLayer, int iPixValField,
+                            int nConnectedness, int bFloat,
+                            int nThreads, char **papszOptions,
+                            GDALProgressFunc pfnProgress,
+                            void * pProgressArg )
+
+{
+    int nTileHeight = atoi( CSLFetchNameValueDef( papszOptions,
+                                                  "TILE_HEIGHT", "0" ) );
+
+    if( bFloat )
+    {
+        GPTiledPolygonizer<GPFloat32Traits> oPolygonizer( hSrcBand, hMaskBand,
+                                                          nConnectedness );
+        return oPolygonizer.Run( hOutLayer, iPixValField, nThreads,
+                                 nTileHeight, pfnProgress, pProgressArg );
+    }
+    else
+    {
+        GPTiledPolygonizer<GPInt32Traits> oPolygonizer( hSrcBand, hMaskBand,
+                                                        nConnectedness );
+        return oPolygonizer.Run( hOutLayer, iPixValField, nThreads,
+                                 nTileHeight, pfnProgress, pProgressArg );
+    }
+}
+
 #endif // OGR_ENABLED
 
 /************************************************************************/
@@ -483,6 +1763,11 @@ GPMaskImageData( GDALRasterBandH hMaskBand, GByte* pabyMaskLine, int iY, int nXS
  * <dl>
  * <dt>"8CONNECTED":</dt> May be set to "8" to use 8 connectedness.
  * Otherwise 4 connectedness will be applied to the algorithm
+ * <dt>"NUM_THREADS":</dt> Number of threads (or ALL_CPUS) used to process
+ * the raster by tiles of whole lines. Defaults to 1. The polygons are the
+ * same as with a single thread, but are not written in the same order.
+ * <dt>"TILE_HEIGHT":</dt> Number of lines of the tiles when several threads
+ * are used. By default, tiles of about 8MB are used.
  * </dl>
  * @param pfnProgress callback for reporting algorithm progress matching the
  * GDALProgressFunc() semantics.  May be NULL.
@@ -523,6 +1808,18 @@ GDALPolygonize( GDALRasterBandH hSrcBand,
         return CE_Failure;
     }
 
+/* -------------------------------------------------------------------- */
+/*      Use the tiled algorithm if several threads are requested.       */
+/* -------------------------------------------------------------------- */
+    int nThreads = CPLGetNumThreadsFromOption(
+        CSLFetchNameValueDef( papszOptions, "NUM_THREADS", "1" ), 1 );
+
+    if( nThreads > 1 )
+        return GDALPolygonizeTiled( hSrcBand, hMaskBand, hOutLayer,
+                                    iPixValField, nConnectedness, FALSE,
+                                    nThreads, papszOptions,
+                                    pfnProgress, pProgressArg );
+
 /* -------------------------------------------------------------------- */
 /*      Allocate working buffers.                                       */
 /* -------------------------------------------------------------------- */
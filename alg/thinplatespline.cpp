@@ -37,19 +37,20 @@
 #endif
 
 #include "thinplatespline.h"
+#include "cpl_multiproc.h"
 
 /////////////////////////////////////////////////////////////////////////////////////
 //// vizGeorefSpline2D
 /////////////////////////////////////////////////////////////////////////////////////
 
 #define A(r,c) _AA[ _nof_eqs * (r) + (c) ]
-#define Ainv(r,c) _Ainv[ _nof_eqs * (r) + (c) ]
 
 
 #define VIZ_GEOREF_SPLINE_DEBUG 0
 
 #ifndef HAVE_ARMADILLO
-static int matrixInvert( int N, double input[], double output[] );
+static int matrixSolve( int N, double A[], int nRHS, double* const rhs[],
+                        double* const sol[], int nThreads );
 #endif
 
 void VizGeorefSpline2D::grow_points()
@@ -464,6 +465,9 @@ int VizGeorefSpline2D::solve(void)
         return(3);
     }
 	
+    if ( _local_points > 0 && _nof_points > _local_points )
+        return solve_local( xmin, ymin, xmax, ymax );
+
     type = VIZ_GEOREF_SPLINE_FULL;
     // Make the necessary memory allocations
 
@@ -476,13 +480,10 @@ int VizGeorefSpline2D::solve(void)
     }
 	
     double* _AA = ( double * )VSICalloc( _nof_eqs * _nof_eqs, sizeof( double ) );
-    double* _Ainv = ( double * )VSICalloc( _nof_eqs * _nof_eqs, sizeof( double ) );
     
-    if( _AA == NULL || _Ainv == NULL )
+    if( _AA == NULL )
     {
         CPLError(CE_Failure, CPLE_AppDefined, "Out-of-memory while allocating temporary arrays. Computation aborted.");
-        VSIFree(_AA);
-        VSIFree(_Ainv);
         return 0;
     }
 	
@@ -550,31 +551,381 @@ int VizGeorefSpline2D::solve(void)
         ret = 0;
     }
 #else
-    // Invert the matrix
-    int status = matrixInvert( _nof_eqs, _AA, _Ainv );
+    // Solve the system
+    int status = matrixSolve( _nof_eqs, _AA, _nof_vars, rhs, coef,
+                              _nof_threads );
 			
     if ( !status )
     {
         CPLError(CE_Failure, CPLE_AppDefined, "There is a problem to invert the interpolation matrix.");
         ret = 0;
     }
-    else
+#endif
+
+    VSIFree(_AA);
+
+    return(ret);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+//// Local solver
+////
+//// Solving the full system costs O(n^3) time and O(n^2) memory, which is not
+//// usable beyond a few thousands of points. The local solver covers the
+//// points with a regular grid of cells, and solves a small spline (a patch)
+//// for each cell with the points found in the cell enlarged by _local_overlap
+//// on each side. The patches are blended with compactly supported weights
+//// that sum to one (partition of unity). As every patch whose weight is not
+//// zero at a point includes it, the blended surface is still exact at the
+//// points. Evaluation only involves the few patches covering the cell.
+/////////////////////////////////////////////////////////////////////////////////////
+
+void VizGeorefSpline2D::set_num_threads( int nThreads )
+{
+    _nof_threads = MAX( nThreads, 1 );
+}
+
+void VizGeorefSpline2D::set_local_solver( int nPatchPoints, double dfOverlap )
+{
+    _local_points = nPatchPoints;
+    // The enlarged cells must overlap so that each point has a patch with a
+    // non zero weight.
+    _local_overlap = MAX( dfOverlap, 1.1 );
+}
+
+void VizGeorefSpline2D::free_patches()
+{
+    for( int i = 0; i < _nof_patches; i++ )
+        delete _patches[i];
+    CPLFree( _patches );
+    CPLFree( _patch_hx );
+    CPLFree( _patch_hy );
+    CPLFree( _cell_first );
+    CPLFree( _cell_patches );
+    _nof_patches = 0;
+    _patches = NULL;
+    _patch_hx = _patch_hy = NULL;
+    _cell_first = _cell_patches = NULL;
+}
+
+/* Wendland C2 function, 1 at the patch center and 0 at its border */
+static CPL_INLINE double VizGeorefSplinePatchWeight( double t )
+{
+    if( t >= 1.0 )
+        return 0.0;
+    double s = 1.0 - t;
+    s *= s;
+    return s * s * ( 4.0 * t + 1.0 );
+}
+
+typedef struct
+{
+    VizGeorefSpline2D **papoPatches;
+    int                 nPatches;
+    int                 iStart;
+    int                 nStep;
+    int                 bSuccess;
+} VizGeorefSplinePatchJob;
+
+static void VizGeorefSplineSolvePatches( void *pData )
+{
+    VizGeorefSplinePatchJob *psJob = (VizGeorefSplinePatchJob *) pData;
+
+    for( int i = psJob->iStart; i < psJob->nPatches; i += psJob->nStep )
+    {
+        if( !psJob->papoPatches[i]->solve() )
+        {
+            psJob->bSuccess = FALSE;
+            break;
+        }
+    }
+}
+
+int VizGeorefSpline2D::solve_local( double xmin, double ymin,
+                                    double xmax, double ymax )
+{
+    int p, i, ix, iy;
+
+    free_patches();
+
+    type = VIZ_GEOREF_SPLINE_LOCAL;
+    _xmin = xmin;
+    _ymin = ymin;
+    _xmax = xmax;
+    _ymax = ymax;
+
+/* -------------------------------------------------------------------- */
+/*      Size the grid so that an enlarged cell holds about              */
+/*      _local_points points on average.                                */
+/* -------------------------------------------------------------------- */
+    double delx = xmax - xmin;
+    double dely = ymax - ymin;
+    if( !( delx > 0.0 && dely > 0.0 ) )
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "There is a problem to invert the interpolation matrix.");
+        return 0;
+    }
+
+    double dfCells = ceil( _nof_points * _local_overlap * _local_overlap
+                           / _local_points );
+
+    _cells_x = (int) MIN( 1024.0, MAX( 1.0,
+                            floor( sqrt( dfCells * delx / dely ) + 0.5 ) ) );
+    _cells_y = (int) MIN( 1024.0, MAX( 1.0, ceil( dfCells / _cells_x ) ) );
+    _cells_x0 = xmin;
+    _cells_y0 = ymin;
+    _cell_dx = delx / _cells_x;
+    _cell_dy = dely / _cells_y;
+
+    const int nCells = _cells_x * _cells_y;
+
+/* -------------------------------------------------------------------- */
+/*      Bin the points per cell.                                        */
+/* -------------------------------------------------------------------- */
+    int *panPointFirst = (int *) VSICalloc( nCells + 1, sizeof(int) );
+    int *panPoints = (int *) VSIMalloc2( _nof_points, sizeof(int) );
+    int *panPointCell = (int *) VSIMalloc2( _nof_points, sizeof(int) );
+    int *panPatchPoints = (int *) VSIMalloc2( _nof_points, sizeof(int) );
+    _patches = (VizGeorefSpline2D **)
+        VSICalloc( nCells, sizeof(VizGeorefSpline2D *) );
+    _patch_hx = (double *) VSIMalloc2( nCells, sizeof(double) );
+    _patch_hy = (double *) VSIMalloc2( nCells, sizeof(double) );
+    _cell_first = (int *) VSICalloc( nCells + 1, sizeof(int) );
+
+    if( panPointFirst == NULL || panPoints == NULL || panPointCell == NULL ||
+        panPatchPoints == NULL || _patches == NULL || _patch_hx == NULL ||
+        _patch_hy == NULL || _cell_first == NULL )
     {
-        // calc the coefs
-        for ( int v = 0; v < _nof_vars; v++ )
-            for ( r = 0; r < _nof_eqs; r++ )
+        CPLError(CE_Failure, CPLE_OutOfMemory, "Out-of-memory while allocating temporary arrays. Computation aborted.");
+        CPLFree( panPointFirst );
+        CPLFree( panPoints );
+        CPLFree( panPointCell );
+        CPLFree( panPatchPoints );
+        free_patches();
+        return 0;
+    }
+    _nof_patches = nCells;
+
+    for ( p = 0; p < _nof_points; p++ )
+    {
+        ix = MIN( (int) ( ( x[p] - _cells_x0 ) / _cell_dx ), _cells_x - 1 );
+        iy = MIN( (int) ( ( y[p] - _cells_y0 ) / _cell_dy ), _cells_y - 1 );
+        panPointCell[p] = iy * _cells_x + ix;
+        panPointFirst[panPointCell[p] + 1] ++;
+    }
+    for ( i = 0; i < nCells; i++ )
+        panPointFirst[i+1] += panPointFirst[i];
+    for ( p = 0; p < _nof_points; p++ )
+        panPoints[panPointFirst[panPointCell[p]] ++] = p;
+    for ( i = nCells; i > 0; i-- )
+        panPointFirst[i] = panPointFirst[i-1];
+    panPointFirst[0] = 0;
+
+/* -------------------------------------------------------------------- */
+/*      Build the patches. A patch with too few points for a stable     */
+/*      solution is enlarged until it has enough.                       */
+/* -------------------------------------------------------------------- */
+    const int nMinPoints = MIN( _nof_points, MAX( 10, _local_points / 4 ) );
+
+    for ( iy = 0; iy < _cells_y; iy++ )
+    {
+        for ( ix = 0; ix < _cells_x; ix++ )
+        {
+            const int iPatch = iy * _cells_x + ix;
+            const double cx = _cells_x0 + ( ix + 0.5 ) * _cell_dx;
+            const double cy = _cells_y0 + ( iy + 0.5 ) * _cell_dy;
+            double hx = 0.5 * _local_overlap * _cell_dx;
+            double hy = 0.5 * _local_overlap * _cell_dy;
+            int nPatchPoints;
+
+            while( true )
+            {
+                int ix0 = MAX( 0, (int) floor( ( cx - hx - _cells_x0 ) / _cell_dx ) );
+                int ix1 = MIN( _cells_x - 1, (int) floor( ( cx + hx - _cells_x0 ) / _cell_dx ) );
+                int iy0 = MAX( 0, (int) floor( ( cy - hy - _cells_y0 ) / _cell_dy ) );
+                int iy1 = MIN( _cells_y - 1, (int) floor( ( cy + hy - _cells_y0 ) / _cell_dy ) );
+
+                nPatchPoints = 0;
+                for ( int jy = iy0; jy <= iy1; jy++ )
+                {
+                    for ( int jx = ix0; jx <= ix1; jx++ )
+                    {
+                        const int iCell = jy * _cells_x + jx;
+                        for ( int k = panPointFirst[iCell];
+                              k < panPointFirst[iCell+1]; k++ )
+                        {
+                            p = panPoints[k];
+                            if( fabs( x[p] - cx ) <= hx &&
+                                fabs( y[p] - cy ) <= hy )
+                                panPatchPoints[nPatchPoints++] = p;
+                        }
+                    }
+                }
+
+                if( nPatchPoints >= nMinPoints )
+                    break;
+                // Grow slowly, as the points may be dense just beyond.
+                hx *= 1.2;
+                hy *= 1.2;
+            }
+
+            _patch_hx[iPatch] = hx;
+            _patch_hy[iPatch] = hy;
+            _patches[iPatch] = new VizGeorefSpline2D( _nof_vars );
+
+            for ( int k = 0; k < nPatchPoints; k++ )
             {
-                coef[v][r] = 0.0;
-                for ( c = 0; c < _nof_eqs; c++ )
-                    coef[v][r] += Ainv(r,c) * rhs[v][c];
+                double adfVars[VIZGEOREF_MAX_VARS];
+                p = panPatchPoints[k];
+                for ( int v = 0; v < _nof_vars; v++ )
+                    adfVars[v] = rhs[v][p+3];
+                _patches[iPatch]->add_point( x[p], y[p], adfVars );
             }
+        }
     }
-#endif
 
-    VSIFree(_AA);
-    VSIFree(_Ainv);
+    CPLFree( panPointFirst );
+    CPLFree( panPoints );
+    CPLFree( panPointCell );
+    CPLFree( panPatchPoints );
 
-    return(ret);
+/* -------------------------------------------------------------------- */
+/*      List the patches whose support intersects each cell.            */
+/* -------------------------------------------------------------------- */
+    for ( int nPass = 0; nPass < 2; nPass++ )
+    {
+        for ( i = 0; i < nCells; i++ )
+        {
+            const double cx = _cells_x0 + ( ( i % _cells_x ) + 0.5 ) * _cell_dx;
+            const double cy = _cells_y0 + ( ( i / _cells_x ) + 0.5 ) * _cell_dy;
+            int ix0 = MAX( 0, (int) floor( ( cx - _patch_hx[i] - _cells_x0 ) / _cell_dx ) );
+            int ix1 = MIN( _cells_x - 1, (int) floor( ( cx + _patch_hx[i] - _cells_x0 ) / _cell_dx ) );
+            int iy0 = MAX( 0, (int) floor( ( cy - _patch_hy[i] - _cells_y0 ) / _cell_dy ) );
+            int iy1 = MIN( _cells_y - 1, (int) floor( ( cy + _patch_hy[i] - _cells_y0 ) / _cell_dy ) );
+
+            for ( iy = iy0; iy <= iy1; iy++ )
+            {
+                for ( ix = ix0; ix <= ix1; ix++ )
+                {
+                    const int iCell = iy * _cells_x + ix;
+                    if( nPass == 0 )
+                        _cell_first[iCell + 1] ++;
+                    else
+                        _cell_patches[_cell_first[iCell] ++] = i;
+                }
+            }
+        }
+
+        if( nPass == 0 )
+        {
+            for ( i = 0; i < nCells; i++ )
+                _cell_first[i+1] += _cell_first[i];
+            _cell_patches = (int *)
+                VSIMalloc2( MAX( 1, _cell_first[nCells] ), sizeof(int) );
+            if( _cell_patches == NULL )
+            {
+                CPLError(CE_Failure, CPLE_OutOfMemory, "Out-of-memory while allocating temporary arrays. Computation aborted.");
+                free_patches();
+                return 0;
+            }
+        }
+        else
+        {
+            for ( i = nCells; i > 0; i-- )
+                _cell_first[i] = _cell_first[i-1];
+            _cell_first[0] = 0;
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Solve the patches, in parallel if possible.                     */
+/* -------------------------------------------------------------------- */
+    const int nJobs = MIN( _nof_threads, nCells );
+    VizGeorefSplinePatchJob *pasJobs = (VizGeorefSplinePatchJob *)
+        CPLMalloc( nJobs * sizeof(VizGeorefSplinePatchJob) );
+
+    for ( i = 0; i < nJobs; i++ )
+    {
+        pasJobs[i].papoPatches = _patches;
+        pasJobs[i].nPatches = nCells;
+        pasJobs[i].iStart = i;
+        pasJobs[i].nStep = nJobs;
+        pasJobs[i].bSuccess = TRUE;
+    }
+
+    if( nJobs == 1 )
+        VizGeorefSplineSolvePatches( pasJobs );
+    else
+    {
+        CPLJobGroup *psJobGroup = CPLCreateJobGroup();
+        for ( i = 0; i < nJobs; i++ )
+            CPLSubmitJob( psJobGroup, VizGeorefSplineSolvePatches, pasJobs + i );
+        CPLWaitJobGroup( psJobGroup );
+        CPLDestroyJobGroup( psJobGroup );
+    }
+
+    int bSuccess = TRUE;
+    for ( i = 0; i < nJobs; i++ )
+        bSuccess &= pasJobs[i].bSuccess;
+    CPLFree( pasJobs );
+
+    if( !bSuccess )
+    {
+        free_patches();
+        return 0;
+    }
+
+    CPLDebug( "TPS", "Local solver: %d points, %d x %d patches",
+              _nof_points, _cells_x, _cells_y );
+
+    return 4;
+}
+
+int VizGeorefSpline2D::get_point_local( const double Px, const double Py,
+                                        double *vars )
+{
+    double adfSum[VIZGEOREF_MAX_VARS];
+    double dfWeightSum = 0.0;
+    int v;
+
+    for ( v = 0; v < _nof_vars; v++ )
+        adfSum[v] = 0.0;
+
+    // The weights are computed for the nearest location within the extent
+    // of the points, so that extrapolation is done by the patches of the
+    // border.
+    const double Qx = MIN( MAX( Px, _xmin ), _xmax );
+    const double Qy = MIN( MAX( Py, _ymin ), _ymax );
+    const int ix = MIN( (int) ( ( Qx - _cells_x0 ) / _cell_dx ), _cells_x - 1 );
+    const int iy = MIN( (int) ( ( Qy - _cells_y0 ) / _cell_dy ), _cells_y - 1 );
+    const int iCell = iy * _cells_x + ix;
+
+    for ( int k = _cell_first[iCell]; k < _cell_first[iCell+1]; k++ )
+    {
+        const int i = _cell_patches[k];
+        const double cx = _cells_x0 + ( ( i % _cells_x ) + 0.5 ) * _cell_dx;
+        const double cy = _cells_y0 + ( ( i / _cells_x ) + 0.5 ) * _cell_dy;
+        const double dfWeight =
+            VizGeorefSplinePatchWeight( fabs( Qx - cx ) / _patch_hx[i] ) *
+            VizGeorefSplinePatchWeight( fabs( Qy - cy ) / _patch_hy[i] );
+        double adfVars[VIZGEOREF_MAX_VARS];
+
+        if( dfWeight <= 0.0 )
+            continue;
+
+        _patches[i]->get_point( Px, Py, adfVars );
+        for ( v = 0; v < _nof_vars; v++ )
+            adfSum[v] += dfWeight * adfVars[v];
+        dfWeightSum += dfWeight;
+    }
+
+    if( dfWeightSum <= 0.0 )
+        return _patches[iCell]->get_point( Px, Py, vars );
+
+    for ( v = 0; v < _nof_vars; v++ )
+        vars[v] = adfSum[v] / dfWeightSum;
+
+    return 1;
 }
 
 int VizGeorefSpline2D::get_point( const double Px, const double Py, double *vars )
@@ -651,6 +1002,8 @@ int VizGeorefSpline2D::get_point( const double Px, const double Py, double *vars
         }
         break;
     }
+	case VIZ_GEOREF_SPLINE_LOCAL :
+		return get_point_local( Px, Py, vars );
 	case VIZ_GEOREF_SPLINE_POINT_WAS_ADDED :
 		fprintf(stderr, " A point was added after the last solve\n");
 		fprintf(stderr, " NO interpolation - return values are zero\n");
@@ -673,140 +1026,165 @@ int VizGeorefSpline2D::get_point( const double Px, const double Py, double *vars
 }
 
 #ifndef HAVE_ARMADILLO
-static int matrixInvert( int N, double input[], double output[] )
+
+typedef struct
 {
-    // Receives an array of dimension NxN as input.  This is passed as a one-
-    // dimensional array of N-squared size.  It produces the inverse of the
-    // input matrix, returned as output, also of size N-squared.  The Gauss-
-    // Jordan Elimination method is used.  (Adapted from a BASIC routine in
-    // "Basic Scientific Subroutines Vol. 1", courtesy of Scott Edwards.)
-	
-    // Array elements 0...N-1 are for the first row, N...2N-1 are for the
-    // second row, etc.
-	
-    // We need to have a temporary array of size N x 2N.  We'll refer to the
-    // "left" and "right" halves of this array.
-	
-    int row, col;
-	
-#if 0
-    fprintf(stderr, "Matrix Inversion input matrix (N=%d)\n", N);
-    for ( row=0; row<N; row++ )
+    int      N;
+    int      nRHS;
+    double  *A;
+    double  *B;
+    int      k;
+    int      iRowStart;
+    int      iRowEnd;
+} MatrixEliminateJob;
+
+/* Eliminate column k from rows [iRowStart, iRowEnd[ */
+static void matrixEliminateRows( void *pData )
+{
+    MatrixEliminateJob *psJob = (MatrixEliminateJob *) pData;
+    const int N = psJob->N;
+    const int nRHS = psJob->nRHS;
+    const int k = psJob->k;
+    const double *pivotRow = psJob->A + (size_t)k * N;
+    const double *pivotRHS = psJob->B + (size_t)k * nRHS;
+
+    for ( int row = psJob->iRowStart; row < psJob->iRowEnd; row++ )
     {
-        for ( col=0; col<N; col++ )
-        {
-            fprintf(stderr, "%5.2f ", input[row*N + col ]  );
-        }
-        fprintf(stderr, "\n");
+        double *curRow = psJob->A + (size_t)row * N;
+        const double f = curRow[k] / pivotRow[k];
+        if ( f == 0.0 )
+            continue;
+        for ( int col = k + 1; col < N; col++ )
+            curRow[col] -= f * pivotRow[col];
+        curRow[k] = 0.0;
+        for ( int v = 0; v < nRHS; v++ )
+            psJob->B[(size_t)row * nRHS + v] -= f * pivotRHS[v];
     }
-#endif
-	
-    int tempSize = 2 * N * N;
-    double* temp = (double*) new double[ tempSize ];
-    double ftemp;
-	
-    if (temp == 0) {
-		
-        CPLError(CE_Failure, CPLE_AppDefined, "matrixInvert(): ERROR - memory allocation failed.");
+}
+
+static int matrixSolve( int N, double A[], int nRHS, double* const rhs[],
+                        double* const sol[], int nThreads )
+{
+    // Solves A.sol[v] = rhs[v] for the nRHS right hand sides by Gaussian
+    // elimination with partial pivoting. A is an array of dimension NxN,
+    // passed as a one-dimensional array of N-squared size, row by row, and
+    // is destroyed. This is much cheaper than inverting A: only the
+    // elimination of the left hand side is O(N^3), and it is done with
+    // nThreads threads for large systems.
+
+    int row, col, k, v;
+
+    double* B = (double*) VSIMalloc3( N, nRHS, sizeof(double) );
+    if ( B == NULL )
+    {
+        CPLError(CE_Failure, CPLE_AppDefined, "matrixSolve(): ERROR - memory allocation failed.");
         return false;
     }
-	
-    // First create a double-width matrix with the input array on the left
-    // and the identity matrix on the right.
-	
-    for ( row=0; row<N; row++ )
+    for ( row = 0; row < N; row++ )
+        for ( v = 0; v < nRHS; v++ )
+            B[(size_t)row * nRHS + v] = rhs[v][row];
+
+    // Below that size, the cost of synchronizing the threads at each
+    // column dominates.
+    if ( N < 500 )
+        nThreads = 1;
+
+    CPLJobGroup* psJobGroup = NULL;
+    MatrixEliminateJob* pasJobs = NULL;
+    if ( nThreads > 1 )
     {
-        for ( col=0; col<N; col++ )
-        {
-            // Our index into the temp array is X2 because it's twice as wide
-            // as the input matrix.
-			
-            temp[ 2*row*N + col ] = input[ row*N+col ];	// left = input matrix
-            temp[ 2*row*N + col + N ] = 0.0f;			// right = 0
-        }
-        temp[ 2*row*N + row + N ] = 1.0f;		// 1 on the diagonal of RHS
+        psJobGroup = CPLCreateJobGroup();
+        pasJobs = (MatrixEliminateJob*)
+            CPLMalloc( nThreads * sizeof(MatrixEliminateJob) );
     }
-	
-    // Now perform row-oriented operations to convert the left hand side
-    // of temp to the identity matrix.  The inverse of input will then be
-    // on the right.
-	
-    int max;
-    int k=0;
-    for (k = 0; k < N; k++)
-    {
-        if (k+1 < N)	// if not on the last row
-        {              
-            max = k;
-            for (row = k+1; row < N; row++) // find the maximum element
-            {  
-                if (fabs( temp[row*2*N + k] ) > fabs( temp[max*2*N + k] ))
-                {
-                    max = row;
-                }
-            }
-			
-            if (max != k)	// swap all the elements in the two rows
-            {        
-                for (col=k; col<2*N; col++)
-                {
-                    ftemp = temp[k*2*N + col];
-                    temp[k*2*N + col] = temp[max*2*N + col];
-                    temp[max*2*N + col] = ftemp;
-                }
-            }
+
+    int bSuccess = true;
+    for ( k = 0; k < N; k++ )
+    {
+        // Find the pivot, and swap the rows.
+        int max = k;
+        for ( row = k + 1; row < N; row++ )
+        {
+            if ( fabs( A[(size_t)row * N + k] ) > fabs( A[(size_t)max * N + k] ) )
+                max = row;
         }
-		
-        ftemp = temp[ k*2*N + k ];
-        if ( ftemp == 0.0f ) // matrix cannot be inverted
+
+        if ( A[(size_t)max * N + k] == 0.0 ) // matrix is singular
         {
-            delete[] temp;
-            return false;
+            bSuccess = false;
+            break;
         }
-		
-        for ( col=k; col<2*N; col++ )
+
+        if ( max != k )
         {
-            temp[ k*2*N + col ] /= ftemp;
+            for ( col = k; col < N; col++ )
+            {
+                double ftemp = A[(size_t)k * N + col];
+                A[(size_t)k * N + col] = A[(size_t)max * N + col];
+                A[(size_t)max * N + col] = ftemp;
+            }
+            for ( v = 0; v < nRHS; v++ )
+            {
+                double ftemp = B[(size_t)k * nRHS + v];
+                B[(size_t)k * nRHS + v] = B[(size_t)max * nRHS + v];
+                B[(size_t)max * nRHS + v] = ftemp;
+            }
         }
-		
-        int i2 = k*2*N ;
-        for ( row=0; row<N; row++ )
+
+        // Eliminate the column from the rows below.
+        const int nRows = N - k - 1;
+        if ( nThreads > 1 && nRows >= 4 * nThreads )
         {
-            if ( row != k )
+            for ( int i = 0; i < nThreads; i++ )
             {
-                int i1 = row*2*N;
-                ftemp = temp[ i1 + k ];
-                for ( col=k; col<2*N; col++ ) 
-                {
-                    temp[ i1 + col ] -= ftemp * temp[ i2 + col ];
-                }
+                pasJobs[i].N = N;
+                pasJobs[i].nRHS = nRHS;
+                pasJobs[i].A = A;
+                pasJobs[i].B = B;
+                pasJobs[i].k = k;
+                pasJobs[i].iRowStart = k + 1 + (int)((GIntBig)nRows * i / nThreads);
+                pasJobs[i].iRowEnd = k + 1 + (int)((GIntBig)nRows * (i + 1) / nThreads);
+                CPLSubmitJob( psJobGroup, matrixEliminateRows, pasJobs + i );
             }
+            CPLWaitJobGroup( psJobGroup );
         }
-    }
-	
-    // Retrieve inverse from the right side of temp
-	
-    for (row = 0; row < N; row++)
-    {
-        for (col = 0; col < N; col++)
+        else if ( nRows > 0 )
         {
-            output[row*N + col] = temp[row*2*N + col + N ];
+            MatrixEliminateJob sJob;
+            sJob.N = N;
+            sJob.nRHS = nRHS;
+            sJob.A = A;
+            sJob.B = B;
+            sJob.k = k;
+            sJob.iRowStart = k + 1;
+            sJob.iRowEnd = N;
+            matrixEliminateRows( &sJob );
         }
     }
-	
-#if 0
-    fprintf(stderr, "Matrix Inversion result matrix:\n");
-    for ( row=0; row<N; row++ )
+
+    if ( psJobGroup != NULL )
+    {
+        CPLDestroyJobGroup( psJobGroup );
+        CPLFree( pasJobs );
+    }
+
+    // Back substitution.
+    if ( bSuccess )
     {
-        for ( col=0; col<N; col++ )
+        for ( v = 0; v < nRHS; v++ )
         {
-            fprintf(stderr, "%5.2f ", output[row*N + col ]  );
+            for ( row = N - 1; row >= 0; row-- )
+            {
+                const double *curRow = A + (size_t)row * N;
+                double sum = B[(size_t)row * nRHS + v];
+                for ( col = row + 1; col < N; col++ )
+                    sum -= curRow[col] * sol[v][col];
+                sol[v][row] = sum / curRow[row];
+            }
         }
-        fprintf(stderr, "\n");
     }
-#endif
-	
-    delete [] temp;       // free memory
-    return true;
+
+    VSIFree( B );
+    return bSuccess;
 }
 #endif
@@ -40,6 +40,7 @@ typedef enum
 	VIZ_GEOREF_SPLINE_TWO_POINTS,
 	VIZ_GEOREF_SPLINE_ONE_DIMENSIONAL,
 	VIZ_GEOREF_SPLINE_FULL,
+	VIZ_GEOREF_SPLINE_LOCAL,
 	
 	VIZ_GEOREF_SPLINE_POINT_WAS_ADDED,
 	VIZ_GEOREF_SPLINE_POINT_WAS_DELETED
@@ -69,6 +70,14 @@ class VizGeorefSpline2D
         _max_nof_points = 0;
         grow_points();
         type = VIZ_GEOREF_SPLINE_ZERO_POINTS;
+
+        _local_points = 0;
+        _local_overlap = 2.0;
+        _nof_threads = 1;
+        _nof_patches = 0;
+        _patches = NULL;
+        _patch_hx = _patch_hy = NULL;
+        _cell_first = _cell_patches = NULL;
     }
 
     ~VizGeorefSpline2D(){
@@ -82,6 +91,7 @@ class VizGeorefSpline2D
             CPLFree( rhs[i] );
             CPLFree( coef[i] );
         }
+        free_patches();
     }
 
 #if 0
@@ -143,8 +153,19 @@ class VizGeorefSpline2D
 #endif
     int solve(void);
 
+    /* Number of threads used by solve() */
+    void set_num_threads( int nThreads );
+
+    /* Use local solves blended by a partition of unity instead of a */
+    /* single dense system when there are more than nPatchPoints points. */
+    void set_local_solver( int nPatchPoints, double dfOverlap );
+
   private:	
 
+    int solve_local( double xmin, double ymin, double xmax, double ymax );
+    int get_point_local( const double Px, const double Py, double *vars );
+    void free_patches();
+
     vizGeorefInterType type;
 
     int _nof_vars;
@@ -167,4 +188,20 @@ class VizGeorefSpline2D
     double *u; // [VIZ_GEOREF_SPLINE_MAX_POINTS];
     int *unused; // [VIZ_GEOREF_SPLINE_MAX_POINTS];
     int *index; // [VIZ_GEOREF_SPLINE_MAX_POINTS];
+
+    int _nof_threads;
+
+    // Local solver: one patch per cell of a regular grid over the points,
+    // each patch covering its cell enlarged by _local_overlap.
+    int _local_points;
+    double _local_overlap;
+    int _nof_patches;
+    int _cells_x, _cells_y;
+    double _cells_x0, _cells_y0, _cell_dx, _cell_dy;
+    double _xmin, _ymin, _xmax, _ymax;
+    VizGeorefSpline2D **_patches;
+    double *_patch_hx;
+    double *_patch_hy;
+    int *_cell_first;   // [_cells_x*_cells_y+1], index in _cell_patches
+    int *_cell_patches; // patches whose support intersects each cell
 };
@@ -54,6 +54,7 @@ static void Usage(const char* pszErrorMsg = NULL)
             "\n"
             "Usefull configuration variables :\n"
             "  --config USE_RRD YES : Use Erdas Imagine format (.aux) as overview format.\n"
+            "  --config GDAL_NUM_THREADS {n|ALL_CPUS} : compute the overviews with n threads.\n"
             "Below, only for external overviews in GeoTIFF format:\n"
             "  --config COMPRESS_OVERVIEW {JPEG,LZW,PACKBITS,DEFLATE} : TIFF compression\n"
             "  --config PHOTOMETRIC_OVERVIEW {RGB,YCBCR,...} : TIFF photometric interp.\n"
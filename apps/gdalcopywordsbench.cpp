@@ -0,0 +1,229 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  GDAL Utilities
+ * Purpose:  Benchmark of GDALCopyWords() data type conversions.
+ * Author:   agent <agent at local>
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, agent <agent at local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include "gdal.h"
+#include "cpl_conv.h"
+#include "cpl_string.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+CPL_CVSID("$Id$");
+
+static double GetWallTime();
+
+/************************************************************************/
+/*                               Usage()                                */
+/************************************************************************/
+
+static void Usage()
+{
+    printf( "gdalcopywordsbench [-n <word_count>] [-i <iterations>]\n"
+            "                   [-src <type>] [-dst <type>] [-packed]\n"
+            "\n"
+            "Times GDALCopyWords() for all pairs of non complex data types\n"
+            "(or the selected ones), with packed buffers and with pixel\n"
+            "strides of 3 and 4 words on each side. Throughput counts the\n"
+            "bytes read and written. The checksum column allows comparing\n"
+            "the results of runs with --config GDAL_COPYWORDS_SIMD NONE,\n"
+            "SSE2 or AVX2.\n" );
+    exit( 1 );
+}
+
+/************************************************************************/
+/*                           FillSource()                               */
+/*                                                                      */
+/*      Fill with values exercising clamping and rounding of all        */
+/*      target types.                                                   */
+/************************************************************************/
+
+static void FillSource( GByte* pabySrc, GDALDataType eType, int nCount )
+{
+    double* padfValues = (double*) CPLMalloc( sizeof(double) * nCount );
+
+    for( int i = 0; i < nCount; i++ )
+    {
+        switch( i % 8 )
+        {
+          case 0: padfValues[i] = i % 256; break;
+          case 1: padfValues[i] = (i % 1000) - 500.5; break;
+          case 2: padfValues[i] = (i % 70000) + 0.5; break;
+          case 3: padfValues[i] = -(double)(i % 70000) - 0.25; break;
+          case 4: padfValues[i] = (i % 300) * 1.49; break;
+          case 5: padfValues[i] = 1e10 * ((i & 16) ? 1 : -1); break;
+          default: padfValues[i] = (i * 7) % 65536; break;
+        }
+    }
+
+    GDALCopyWords( padfValues, GDT_Float64, 8,
+                   pabySrc, eType, GDALGetDataTypeSize(eType) / 8, nCount );
+    CPLFree( padfValues );
+}
+
+/************************************************************************/
+/*                                main()                                */
+/************************************************************************/
+
+int main( int argc, char ** argv )
+
+{
+    int nWordCount = 1024 * 1024;
+    int nIterations = 0;
+    int bPackedOnly = FALSE;
+    GDALDataType eSrcTypeSel = GDT_Unknown, eDstTypeSel = GDT_Unknown;
+
+    argc = GDALGeneralCmdLineProcessor( argc, &argv, 0 );
+    if( argc < 1 )
+        exit( -argc );
+
+    for( int iArg = 1; iArg < argc; iArg++ )
+    {
+        if( EQUAL(argv[iArg],"-n") && iArg < argc-1 )
+            nWordCount = atoi(argv[++iArg]);
+        else if( EQUAL(argv[iArg],"-i") && iArg < argc-1 )
+            nIterations = atoi(argv[++iArg]);
+        else if( EQUAL(argv[iArg],"-src") && iArg < argc-1 )
+            eSrcTypeSel = GDALGetDataTypeByName(argv[++iArg]);
+        else if( EQUAL(argv[iArg],"-dst") && iArg < argc-1 )
+            eDstTypeSel = GDALGetDataTypeByName(argv[++iArg]);
+        else if( EQUAL(argv[iArg],"-packed") )
+            bPackedOnly = TRUE;
+        else
+        {
+            printf( "Unrecognised argument: %s\n", argv[iArg] );
+            Usage();
+        }
+    }
+
+    if( nWordCount <= 0 )
+        Usage();
+
+    /* Default to about 256 MB of source data per conversion */
+    if( nIterations <= 0 )
+        nIterations = MAX(1, (int)(256.0 * 1024 * 1024 / 8 / nWordCount));
+
+    const int anStrides[][2] = { {1, 1}, {3, 1}, {4, 1}, {1, 3}, {1, 4} };
+    const int nStrideCombinations = bPackedOnly ? 1 :
+        (int)(sizeof(anStrides) / sizeof(anStrides[0]));
+
+    /* Largest type is 8 bytes, largest stride is 4 */
+    GByte* pabySrc = (GByte*) VSIMalloc( (size_t)nWordCount * 8 * 4 );
+    GByte* pabyDst = (GByte*) VSIMalloc( (size_t)nWordCount * 8 * 4 );
+    if( pabySrc == NULL || pabyDst == NULL )
+    {
+        fprintf( stderr, "Out of memory.\n" );
+        exit( 1 );
+    }
+
+    printf( "%-8s %-8s %6s %6s %10s %10s %10s\n",
+            "Src", "Dst", "SrcStr", "DstStr", "Seconds", "GB/s", "Checksum" );
+
+    for( int eSrcType = GDT_Byte; eSrcType <= GDT_Float64; eSrcType++ )
+    {
+        if( eSrcTypeSel != GDT_Unknown && eSrcType != eSrcTypeSel )
+            continue;
+
+        const int nSrcSize = GDALGetDataTypeSize((GDALDataType)eSrcType) / 8;
+
+        for( int eDstType = GDT_Byte; eDstType <= GDT_Float64; eDstType++ )
+        {
+            if( eDstTypeSel != GDT_Unknown && eDstType != eDstTypeSel )
+                continue;
+
+            const int nDstSize =
+                GDALGetDataTypeSize((GDALDataType)eDstType) / 8;
+
+            for( int iStride = 0; iStride < nStrideCombinations; iStride++ )
+            {
+                const int nSrcStride = anStrides[iStride][0] * nSrcSize;
+                const int nDstStride = anStrides[iStride][1] * nDstSize;
+
+                /* Fill the source with interleaved copies of the test */
+                /* values so that every pixel is meaningful. */
+                FillSource( pabyDst, (GDALDataType)eSrcType, nWordCount );
+                for( int k = 0; k < anStrides[iStride][0]; k++ )
+                    GDALCopyWords( pabyDst, (GDALDataType)eSrcType, nSrcSize,
+                                   pabySrc + k * nSrcSize,
+                                   (GDALDataType)eSrcType, nSrcStride,
+                                   nWordCount );
+                memset( pabyDst, 0, (size_t)nWordCount * nDstStride );
+
+                double dfStart = GetWallTime();
+                for( int iIter = 0; iIter < nIterations; iIter++ )
+                    GDALCopyWords( pabySrc, (GDALDataType)eSrcType,
+                                   nSrcStride,
+                                   pabyDst, (GDALDataType)eDstType,
+                                   nDstStride, nWordCount );
+                double dfElapsed = GetWallTime() - dfStart;
+
+                GUInt32 nChecksum = 0;
+                for( size_t i = 0; i < (size_t)nWordCount * nDstStride; i++ )
+                    nChecksum = nChecksum * 31 + pabyDst[i];
+
+                double dfBytes = (double) nWordCount * nIterations
+                    * (nSrcSize + nDstSize);
+
+                printf( "%-8s %-8s %6d %6d %10.3f %10.2f %10u\n",
+                        GDALGetDataTypeName((GDALDataType)eSrcType),
+                        GDALGetDataTypeName((GDALDataType)eDstType),
+                        anStrides[iStride][0], anStrides[iStride][1],
+                        dfElapsed,
+                        dfBytes / MAX(dfElapsed, 1e-9) / 1e9,
+                        nChecksum );
+            }
+        }
+    }
+
+    VSIFree( pabySrc );
+    VSIFree( pabyDst );
+
+    CSLDestroy( argv );
+
+    return 0;
+}
+
+/************************************************************************/
+/*                            GetWallTime()                             */
+/************************************************************************/
+
+static double GetWallTime()
+
+{
+#ifdef WIN32
+    return GetTickCount() / 1000.0;
+#else
+    struct timeval tv;
+
+    gettimeofday( &tv, NULL );
+    return tv.tv_sec + tv.tv_usec / 1e6;
+#endif
+}
@@ -51,6 +51,9 @@ GDALInfoReportMetadata( GDALMajorObjectH hObject,
                         char **papszExtraMDDomains,
                         int bIsBand );
 
+static void
+GDALInfoReportCacheStats( GDALDatasetH hDataset );
+
 /************************************************************************/
 /*                               Usage()                                */
 /************************************************************************/
@@ -60,7 +63,7 @@ void Usage(const char* pszErrorMsg)
 {
     printf( "Usage: gdalinfo [--help-general] [-mm] [-stats] [-hist] [-nogcp] [-nomd]\n"
             "                [-norat] [-noct] [-nofl] [-checksum] [-proj4]\n"
-            "                [-listmdd] [-mdd domain|`all`]*\n"
+            "                [-listmdd] [-mdd domain|`all`]* [-cachestats]\n"
             "                [-sd subdataset] [-oo NAME=VALUE]* datasetname\n" );
 
     if( pszErrorMsg != NULL )
@@ -91,6 +94,7 @@ int main( int argc, char ** argv )
     int                 bShowColorTable = TRUE, bComputeChecksum = FALSE;
     int                 bReportHistograms = FALSE;
     int                 bReportProj4 = FALSE;
+    int                 bReportCacheStats = FALSE;
     int                 nSubdataset = -1;
     const char          *pszFilename = NULL;
     char              **papszExtraMDDomains = NULL, **papszFileList;
@@ -150,6 +154,8 @@ int main( int argc, char ** argv )
             bSample = TRUE;
         else if( EQUAL(argv[i], "-checksum") )
             bComputeChecksum = TRUE;
+        else if( EQUAL(argv[i], "-cachestats") )
+            bReportCacheStats = TRUE;
         else if( EQUAL(argv[i], "-nogcp") )
             bShowGCPs = FALSE;
         else if( EQUAL(argv[i], "-nomd") )
@@ -722,6 +728,9 @@ int main( int argc, char ** argv )
         }
     }
 
+    if( bReportCacheStats )
+        GDALInfoReportCacheStats( hDataset );
+
     GDALClose( hDataset );
     
     CSLDestroy( papszExtraMDDomains );
@@ -926,3 +935,91 @@ static void GDALInfoReportMetadata( GDALMajorObjectH hObject,
     }
 
 }
+
+/************************************************************************/
+/*                      GDALInfoPrintCacheStats()                       */
+/************************************************************************/
+
+static void GDALInfoPrintCacheStats( const char *pszIndent,
+                                     const GDALCacheStats *psStats )
+
+{
+    printf( "%sHits=" CPL_FRMT_GIB ", Misses=" CPL_FRMT_GIB
+            ", Evictions=" CPL_FRMT_GIB ", DirtyFlushes=" CPL_FRMT_GIB "\n",
+            pszIndent, psStats->nHits, psStats->nMisses,
+            psStats->nEvictions, psStats->nDirtyFlushes );
+    printf( "%sBlocks=" CPL_FRMT_GIB ", DirtyBlocks=" CPL_FRMT_GIB
+            ", Bytes=" CPL_FRMT_GIB "\n",
+            pszIndent, psStats->nBlocks, psStats->nDirtyBlocks,
+            psStats->nBytes );
+}
+
+/************************************************************************/
+/*                      GDALInfoReportCacheStats()                      */
+/************************************************************************/
+
+static void GDALInfoReportCacheStats( GDALDatasetH hDataset )
+
+{
+    GDALCacheStats sStats;
+    GDALCacheDatasetUsage *pasUsage = NULL;
+    GIntBig anHisto[GDAL_READBLOCK_LATENCY_BUCKETS];
+    int i, nUsageCount, nBuckets;
+    GDALDriverH hDriver;
+
+    printf( "Block Cache Statistics:\n" );
+
+    GDALGetCacheStats( &sStats );
+    printf( "  Global: Max=" CPL_FRMT_GIB ", Used=" CPL_FRMT_GIB "\n",
+            GDALGetCacheMax64(), GDALGetCacheUsed64() );
+    GDALInfoPrintCacheStats( "    ", &sStats );
+    printf( "    LockWait=%.3f ms\n", sStats.nLockWaitMicroseconds / 1000.0 );
+
+    GDALGetDatasetCacheStats( hDataset, &sStats );
+    printf( "  Dataset:\n" );
+    GDALInfoPrintCacheStats( "    ", &sStats );
+
+    for( i = 0; i < GDALGetRasterCount( hDataset ); i++ )
+    {
+        GDALGetRasterBandCacheStats( GDALGetRasterBand( hDataset, i+1 ),
+                                     &sStats );
+        printf( "  Band %d:\n", i+1 );
+        GDALInfoPrintCacheStats( "    ", &sStats );
+    }
+
+    nUsageCount = GDALGetCacheUsageByDataset( &pasUsage );
+    if( nUsageCount > 0 )
+    {
+        printf( "  Cache Content By Dataset:\n" );
+        for( i = 0; i < nUsageCount; i++ )
+        {
+            printf( "    %s: Blocks=%d, DirtyBlocks=%d, Bytes=" CPL_FRMT_GIB "\n",
+                    pasUsage[i].hDS != NULL
+                        ? GDALGetDescription( pasUsage[i].hDS ) : "(none)",
+                    pasUsage[i].nBlocks, pasUsage[i].nDirtyBlocks,
+                    pasUsage[i].nBytes );
+        }
+    }
+    CPLFree( pasUsage );
+
+    hDriver = GDALGetDatasetDriver( hDataset );
+    if( hDriver == NULL )
+        return;
+
+    nBuckets = GDALGetDriverReadBlockLatencyHistogram(
+        hDriver, GDAL_READBLOCK_LATENCY_BUCKETS, anHisto );
+    printf( "  %s IReadBlock() Latency (us):\n",
+            GDALGetDriverShortName( hDriver ) );
+    for( i = 0; i < nBuckets; i++ )
+    {
+        if( anHisto[i] == 0 )
+            continue;
+        if( i == 0 )
+            printf( "    <2: " CPL_FRMT_GIB "\n", anHisto[i] );
+        else if( i == nBuckets - 1 )
+            printf( "    >=%d: " CPL_FRMT_GIB "\n", 1 << i, anHisto[i] );
+        else
+            printf( "    %d-%d: " CPL_FRMT_GIB "\n",
+                    1 << i, (1 << (i+1)) - 1, anHisto[i] );
+    }
+}
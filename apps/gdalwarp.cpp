@@ -185,7 +185,10 @@ nodata (unset/transparent) pixels. </dd>
 megabytes) that the warp API is allowed to use for caching.</dd>
 <dt> <b>-multi</b>:</dt><dd> Use multithreaded warping implementation.
 Multiple threads will be used to process chunks of image and perform
-input/output operation simultaneously.</dd>
+input/output operation simultaneously. The number of chunks in flight is
+set with <tt>-wo PIPELINE_DEPTH=n</tt> (2 by default), and the memory set
+with <b>-wm</b> is shared between them. Combine with
+<tt>-wo NUM_THREADS=ALL_CPUS</tt> to also split the warping of each chunk.</dd>
 <dt> <b>-q</b>:</dt><dd> Be quiet.</dd>
 <dt> <b>-of</b> <em>format</em>:</dt><dd> Select the output format. The default is GeoTIFF (GTiff). Use the short format name. </dd>
 <dt> <b>-co</b> <em>"NAME=VALUE"</em>:</dt><dd> passes a creation option to
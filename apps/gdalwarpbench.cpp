@@ -0,0 +1,421 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  GDAL Utilities
+ * Purpose:  Benchmark of the GDALWarpKernel resampling kernels.
+ * Author:   agent <agent at local>
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, agent <agent at local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include "gdal.h"
+#include "gdalwarper.h"
+#include "cpl_conv.h"
+#include "cpl_string.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+CPL_CVSID("$Id$");
+
+static double GetWallTime();
+
+/* Mask configurations, each one selecting different kernel inputs */
+static const char* const apszMaskModes[] =
+{
+    "none",         /* no mask at all */
+    "srcnodata",    /* per band validity masks */
+    "unified",      /* unified source validity mask */
+    "srcalpha",     /* unified source density */
+    "dstnodata",    /* destination validity mask */
+    "dstalpha"      /* destination density */
+};
+
+#define MASK_MODE_COUNT \
+    ((int)(sizeof(apszMaskModes) / sizeof(apszMaskModes[0])))
+
+static const char* const apszResampling[] =
+{
+    "near", "bilinear", "cubic", "cubicspline", "lanczos", "average", "mode"
+};
+
+#define RESAMPLING_COUNT \
+    ((int)(sizeof(apszResampling) / sizeof(apszResampling[0])))
+
+/************************************************************************/
+/*                               Usage()                                */
+/************************************************************************/
+
+static void Usage()
+{
+    printf( "gdalwarpbench [-s <size>] [-b <bands>] [-i <iterations>]\n"
+            "              [-t <type>]* [-r <resampling>]* [-m <mask>]*\n"
+            "              [-wo NAME=VALUE]*\n"
+            "\n"
+            "Times GDALWarpKernel::PerformWarp() on in-memory datasets, for\n"
+            "every combination of data type (Byte, Int16, UInt16, Float32\n"
+            "and Float64 by default), resampling method and mask\n"
+            "configuration (none, srcnodata, unified, srcalpha, dstnodata,\n"
+            "dstalpha), or the selected ones. The source is slightly\n"
+            "rotated and scaled. Only the time spent in the kernel is\n"
+            "counted. The checksum column allows comparing the results of\n"
+            "runs with --config GDAL_WARP_SIMD NONE or -wo\n"
+            "USE_GENERAL_CASE=YES.\n" );
+    exit( 1 );
+}
+
+/************************************************************************/
+/*                          Kernel timing.                              */
+/************************************************************************/
+
+typedef struct
+{
+    double dfStart;
+    double dfElapsed;
+} BenchTiming;
+
+static CPLErr BenchPreWarpChunk( void * /* pKern */, void *pArg )
+{
+    ((BenchTiming *) pArg)->dfStart = GetWallTime();
+    return CE_None;
+}
+
+static CPLErr BenchPostWarpChunk( void * /* pKern */, void *pArg )
+{
+    BenchTiming *psTiming = (BenchTiming *) pArg;
+    psTiming->dfElapsed += GetWallTime() - psTiming->dfStart;
+    return CE_None;
+}
+
+/************************************************************************/
+/*                           CreateSource()                             */
+/*                                                                      */
+/*      Smooth patterns with some nodata (0) pixels scattered and in    */
+/*      blocks, and an alpha band with transparent, opaque and          */
+/*      partially transparent areas.                                    */
+/************************************************************************/
+
+static GDALDatasetH CreateSource( GDALDriverH hMemDriver, int nSize,
+                                  int nBands, GDALDataType eType,
+                                  int bAlpha )
+{
+    GDALDatasetH hDS = GDALCreate( hMemDriver, "", nSize, nSize,
+                                   nBands + (bAlpha ? 1 : 0), eType, NULL );
+    double adfGeoTransform[6] = { 0.0, 1.0, 0.0, (double) nSize, 0.0, -1.0 };
+    double *padfLine = (double *) CPLMalloc( sizeof(double) * nSize );
+
+    GDALSetGeoTransform( hDS, adfGeoTransform );
+
+    for( int iBand = 0; iBand < nBands + (bAlpha ? 1 : 0); iBand++ )
+    {
+        GDALRasterBandH hBand = GDALGetRasterBand( hDS, iBand + 1 );
+        const int bIsAlpha = (iBand == nBands);
+
+        if( !bIsAlpha )
+            GDALSetRasterNoDataValue( hBand, 0.0 );
+
+        for( int iY = 0; iY < nSize; iY++ )
+        {
+            for( int iX = 0; iX < nSize; iX++ )
+            {
+                double dfValue;
+
+                if( bIsAlpha )
+                {
+                    if( (iX / 64 + iY / 64) % 3 == 0 )
+                        dfValue = 0;
+                    else if( (iX / 64 + iY / 64) % 3 == 1 )
+                        dfValue = 255;
+                    else
+                        dfValue = (iX * 7 + iY * 3) % 256;
+                }
+                else if( ((iX + iBand * 13) * 31 + iY * 17) % 97 == 0
+                         || ((iX / 48) % 5 == 2 && (iY / 48) % 4 == iBand % 4) )
+                    dfValue = 0;
+                else
+                {
+                    dfValue = 1 + ((iX * (iBand + 1) + iY * 3) % 250);
+                    if( eType == GDT_Int16 && (iY & 1) )
+                        dfValue = -dfValue * 100;
+                    else if( eType == GDT_UInt16 || eType == GDT_Int16 )
+                        dfValue *= 100;
+                    else if( eType == GDT_Float32 || eType == GDT_Float64 )
+                        dfValue += (iX % 10) * 0.125;
+                }
+                padfLine[iX] = dfValue;
+            }
+
+            GDALRasterIO( hBand, GF_Write, 0, iY, nSize, 1,
+                          padfLine, nSize, 1, GDT_Float64, 0, 0 );
+        }
+    }
+
+    CPLFree( padfLine );
+    return hDS;
+}
+
+/************************************************************************/
+/*                             RunWarp()                                */
+/************************************************************************/
+
+static double RunWarp( GDALDatasetH hSrcDS, GDALDatasetH hDstDS,
+                       int nBands, GDALDataType eType, int iResampling,
+                       int iMaskMode, char **papszExtraWarpOptions,
+                       GUInt32 *pnChecksum )
+{
+    GDALWarpOptions *psWO = GDALCreateWarpOptions();
+    BenchTiming sTiming = { 0.0, 0.0 };
+
+    psWO->hSrcDS = hSrcDS;
+    psWO->hDstDS = hDstDS;
+    psWO->eWorkingDataType = eType;
+    psWO->eResampleAlg = (GDALResampleAlg) iResampling;
+    psWO->nBandCount = nBands;
+    psWO->panSrcBands = (int *) CPLMalloc( sizeof(int) * nBands );
+    psWO->panDstBands = (int *) CPLMalloc( sizeof(int) * nBands );
+    for( int i = 0; i < nBands; i++ )
+    {
+        psWO->panSrcBands[i] = i + 1;
+        psWO->panDstBands[i] = i + 1;
+    }
+
+    if( EQUAL(apszMaskModes[iMaskMode], "srcnodata")
+        || EQUAL(apszMaskModes[iMaskMode], "unified") )
+    {
+        psWO->padfSrcNoDataReal =
+            (double *) CPLCalloc( nBands, sizeof(double) );
+        psWO->padfSrcNoDataImag =
+            (double *) CPLCalloc( nBands, sizeof(double) );
+    }
+    if( EQUAL(apszMaskModes[iMaskMode], "unified") )
+        psWO->papszWarpOptions = CSLSetNameValue( psWO->papszWarpOptions,
+                                                  "UNIFIED_SRC_NODATA", "YES" );
+    if( EQUAL(apszMaskModes[iMaskMode], "srcalpha") )
+        psWO->nSrcAlphaBand = nBands + 1;
+    if( EQUAL(apszMaskModes[iMaskMode], "dstnodata") )
+    {
+        psWO->padfDstNoDataReal =
+            (double *) CPLCalloc( nBands, sizeof(double) );
+        psWO->padfDstNoDataImag =
+            (double *) CPLCalloc( nBands, sizeof(double) );
+        psWO->papszWarpOptions = CSLSetNameValue( psWO->papszWarpOptions,
+                                                  "INIT_DEST", "NO_DATA" );
+    }
+    else
+        psWO->papszWarpOptions = CSLSetNameValue( psWO->papszWarpOptions,
+                                                  "INIT_DEST", "0" );
+    if( EQUAL(apszMaskModes[iMaskMode], "dstalpha") )
+        psWO->nDstAlphaBand = nBands + 1;
+
+    for( char **papszIter = papszExtraWarpOptions;
+         papszIter != NULL && *papszIter != NULL; papszIter++ )
+        psWO->papszWarpOptions = CSLAddString( psWO->papszWarpOptions,
+                                               *papszIter );
+
+    psWO->pfnTransformer = GDALGenImgProjTransform;
+    psWO->pTransformerArg =
+        GDALCreateGenImgProjTransformer2( hSrcDS, hDstDS, NULL );
+
+    psWO->pfnPreWarpChunkProcessor = BenchPreWarpChunk;
+    psWO->pPreWarpProcessorArg = &sTiming;
+    psWO->pfnPostWarpChunkProcessor = BenchPostWarpChunk;
+    psWO->pPostWarpProcessorArg = &sTiming;
+
+    GDALWarpOperationH hWO = GDALCreateWarpOperation( psWO );
+    if( hWO != NULL )
+    {
+        GDALChunkAndWarpImage( hWO, 0, 0, GDALGetRasterXSize(hDstDS),
+                               GDALGetRasterYSize(hDstDS) );
+        GDALDestroyWarpOperation( hWO );
+    }
+
+    GDALDestroyGenImgProjTransformer( psWO->pTransformerArg );
+    GDALDestroyWarpOptions( psWO );
+
+    GUInt32 nChecksum = 0;
+    for( int iBand = 0; iBand < GDALGetRasterCount(hDstDS); iBand++ )
+    {
+        GDALRasterBandH hBand = GDALGetRasterBand( hDstDS, iBand + 1 );
+        nChecksum = nChecksum * 31 +
+            GDALChecksumImage( hBand, 0, 0, GDALGetRasterXSize(hDstDS),
+                               GDALGetRasterYSize(hDstDS) );
+    }
+    *pnChecksum = nChecksum;
+
+    return sTiming.dfElapsed;
+}
+
+/************************************************************************/
+/*                                main()                                */
+/************************************************************************/
+
+int main( int argc, char ** argv )
+
+{
+    int nSize = 1024;
+    int nBands = 3;
+    int nIterations = 1;
+    char **papszTypes = NULL;
+    char **papszResampling = NULL;
+    char **papszMaskModes = NULL;
+    char **papszWarpOptions = NULL;
+
+    argc = GDALGeneralCmdLineProcessor( argc, &argv, 0 );
+    if( argc < 1 )
+        exit( -argc );
+
+    for( int iArg = 1; iArg < argc; iArg++ )
+    {
+        if( EQUAL(argv[iArg],"-s") && iArg < argc-1 )
+            nSize = atoi(argv[++iArg]);
+        else if( EQUAL(argv[iArg],"-b") && iArg < argc-1 )
+            nBands = atoi(argv[++iArg]);
+        else if( EQUAL(argv[iArg],"-i") && iArg < argc-1 )
+            nIterations = atoi(argv[++iArg]);
+        else if( EQUAL(argv[iArg],"-t") && iArg < argc-1 )
+            papszTypes = CSLAddString( papszTypes, argv[++iArg] );
+        else if( EQUAL(argv[iArg],"-r") && iArg < argc-1 )
+            papszResampling = CSLAddString( papszResampling, argv[++iArg] );
+        else if( EQUAL(argv[iArg],"-m") && iArg < argc-1 )
+            papszMaskModes = CSLAddString( papszMaskModes, argv[++iArg] );
+        else if( EQUAL(argv[iArg],"-wo") && iArg < argc-1 )
+            papszWarpOptions = CSLAddString( papszWarpOptions, argv[++iArg] );
+        else
+        {
+            printf( "Unrecognised argument: %s\n", argv[iArg] );
+            Usage();
+        }
+    }
+
+    if( nSize < 16 || nBands <= 0 || nIterations <= 0 )
+        Usage();
+
+    if( papszTypes == NULL )
+        papszTypes = CSLTokenizeString( "Byte Int16 UInt16 Float32 Float64" );
+
+    GDALAllRegister();
+
+    GDALDriverH hMemDriver = GDALGetDriverByName( "MEM" );
+    if( hMemDriver == NULL )
+    {
+        fprintf( stderr, "MEM driver not available.\n" );
+        exit( 1 );
+    }
+
+    /* Destination geotransform: rotated by about 1 degree, with a */
+    /* resolution close to the source one so that the bilinear and */
+    /* cubic kernels use their 4 samples formulas. */
+    const int nDstSize = nSize * 9 / 10;
+    double adfDstGeoTransform[6] =
+        { nSize * 0.04, 1.02, 0.018, nSize * 0.97, 0.018, -1.02 };
+
+    printf( "%-8s %-12s %-10s %10s %10s %10s\n",
+            "Type", "Resampling", "Mask", "Seconds", "MPix/s", "Checksum" );
+
+    for( int iType = 0; papszTypes[iType] != NULL; iType++ )
+    {
+        GDALDataType eType = GDALGetDataTypeByName( papszTypes[iType] );
+        if( eType == GDT_Unknown )
+        {
+            fprintf( stderr, "Unknown data type: %s\n", papszTypes[iType] );
+            continue;
+        }
+
+        GDALDatasetH hSrcDS = CreateSource( hMemDriver, nSize, nBands,
+                                            eType, TRUE );
+
+        for( int iResampling = 0; iResampling < RESAMPLING_COUNT;
+             iResampling++ )
+        {
+            if( papszResampling != NULL &&
+                CSLFindString( papszResampling,
+                               apszResampling[iResampling] ) < 0 )
+                continue;
+
+            for( int iMaskMode = 0; iMaskMode < MASK_MODE_COUNT; iMaskMode++ )
+            {
+                if( papszMaskModes != NULL &&
+                    CSLFindString( papszMaskModes,
+                                   apszMaskModes[iMaskMode] ) < 0 )
+                    continue;
+
+                const int bDstAlpha =
+                    EQUAL(apszMaskModes[iMaskMode], "dstalpha");
+                GDALDatasetH hDstDS =
+                    GDALCreate( hMemDriver, "", nDstSize, nDstSize,
+                                nBands + (bDstAlpha ? 1 : 0), eType, NULL );
+                GDALSetGeoTransform( hDstDS, adfDstGeoTransform );
+
+                double dfElapsed = 0.0;
+                GUInt32 nChecksum = 0;
+                for( int iIter = 0; iIter < nIterations; iIter++ )
+                    dfElapsed += RunWarp( hSrcDS, hDstDS, nBands, eType,
+                                          iResampling, iMaskMode,
+                                          papszWarpOptions, &nChecksum );
+
+                GDALClose( hDstDS );
+
+                printf( "%-8s %-12s %-10s %10.3f %10.2f %10u\n",
+                        GDALGetDataTypeName(eType),
+                        apszResampling[iResampling],
+                        apszMaskModes[iMaskMode],
+                        dfElapsed,
+                        (double) nDstSize * nDstSize * nIterations
+                            / MAX(dfElapsed, 1e-9) / 1e6,
+                        nChecksum );
+                fflush( stdout );
+            }
+        }
+
+        GDALClose( hSrcDS );
+    }
+
+    CSLDestroy( papszTypes );
+    CSLDestroy( papszResampling );
+    CSLDestroy( papszMaskModes );
+    CSLDestroy( papszWarpOptions );
+    CSLDestroy( argv );
+
+    GDALDestroyDriverManager();
+
+    return 0;
+}
+
+/************************************************************************/
+/*                            GetWallTime()                             */
+/************************************************************************/
+
+static double GetWallTime()
+
+{
+#ifdef WIN32
+    return GetTickCount() / 1000.0;
+#else
+    struct timeval tv;
+
+    gettimeofday( &tv, NULL );
+    return tv.tv_sec + tv.tv_usec / 1e6;
+#endif
+}
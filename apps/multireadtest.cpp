@@ -32,6 +32,12 @@
 #include "cpl_multiproc.h"
 #include "cpl_string.h"
 
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
 CPL_CVSID("$Id$");
 
 static int nThreadCount = 4, nIterations = 1, bLockOnOpen = TRUE;
@@ -39,10 +45,13 @@ static int nOpenIterations = 1;
 static volatile int nPendingThreads = 0;
 static const char *pszFilename = NULL;
 static int nChecksum = 0;
+static int bScale = FALSE;
 
 static void *pGlobalMutex = NULL;
 
 static void WorkerFunc( void * );
+static double RunWorkers( int nThreads );
+static double GetWallTime();
 
 /************************************************************************/
 /*                               Usage()                                */
@@ -50,9 +59,12 @@ static void WorkerFunc( void * );
 
 static void Usage()
 {
-    printf( "multireadtest [-nlo] [-t <thread#>]\n"
+    printf( "multireadtest [-nlo] [-t <thread#>] [-scale]\n"
             "              [-i <iterations>] [-oi <iterations>\n"
-            "              filename\n" );
+            "              filename\n"
+            "\n"
+            "  -scale: run with 1, 2, 4, ... up to <thread#> threads and report\n"
+            "          the read throughput for each thread count.\n" );
     exit( 1 );
 }
 
@@ -83,6 +95,8 @@ int main( int argc, char ** argv )
             nThreadCount = atoi(argv[++iArg]);
         else if( EQUAL(argv[iArg],"-nlo") )
             bLockOnOpen = FALSE;
+        else if( EQUAL(argv[iArg],"-scale") )
+            bScale = TRUE;
         else if( pszFilename == NULL )
             pszFilename = argv[iArg];
         else
@@ -106,16 +120,17 @@ int main( int argc, char ** argv )
 /*      Get the checksum of band1.                                      */
 /* -------------------------------------------------------------------- */
     GDALDatasetH hDS;
+    int nXSize, nYSize;
 
     GDALAllRegister();
     hDS = GDALOpen( pszFilename, GA_ReadOnly );
     if( hDS == NULL )
         exit( 1 );
 
+    nXSize = GDALGetRasterXSize( hDS );
+    nYSize = GDALGetRasterYSize( hDS );
     nChecksum = GDALChecksumImage( GDALGetRasterBand( hDS, 1 ), 
-                                   0, 0, 
-                                   GDALGetRasterXSize( hDS ), 
-                                   GDALGetRasterYSize( hDS ) );
+                                   0, 0, nXSize, nYSize );
     
     GDALClose( hDS );
 
@@ -125,29 +140,53 @@ int main( int argc, char ** argv )
 /* -------------------------------------------------------------------- */
 /*      Fire off worker threads.                                        */
 /* -------------------------------------------------------------------- */
-    int iThread;
-
     pGlobalMutex = CPLCreateMutex();
     CPLReleaseMutex( pGlobalMutex );
 
-    nPendingThreads = nThreadCount;
-
-    for( iThread = 0; iThread < nThreadCount; iThread++ )
+    if( !bScale )
     {
-        if( CPLCreateThread( WorkerFunc, NULL ) == -1 )
-        {
-            printf( "CPLCreateThread() failed.\n" );
+        if( RunWorkers( nThreadCount ) < 0 )
             exit( 1 );
-        }
+
+        printf( "All threads complete.\n" );
     }
 
-    while( nPendingThreads > 0 )
-        CPLSleep( 0.5 );
+/* -------------------------------------------------------------------- */
+/*      In scaling mode, run with an increasing number of threads and   */
+/*      report the throughput of each run relative to one thread.       */
+/* -------------------------------------------------------------------- */
+    else
+    {
+        double dfSingleThreadRate = 0.0;
+        double dfPixelsPerThread = (double) nXSize * nYSize
+            * nIterations * MAX(1,nOpenIterations);
 
-    CPLReleaseMutex( pGlobalMutex );
+        printf( "%8s %12s %14s %10s\n",
+                "Threads", "Seconds", "MPixels/s", "Speedup" );
+
+        for( int nThreads = 1; nThreads <= nThreadCount; )
+        {
+            double dfElapsed = RunWorkers( nThreads );
+            if( dfElapsed < 0 )
+                exit( 1 );
 
-    printf( "All threads complete.\n" );
+            double dfRate = dfPixelsPerThread * nThreads
+                / MAX(dfElapsed, 1e-6) / 1e6;
+            if( nThreads == 1 )
+                dfSingleThreadRate = dfRate;
+
+            printf( "%8d %12.3f %14.2f %10.2f\n",
+                    nThreads, dfElapsed, dfRate,
+                    dfRate / MAX(dfSingleThreadRate, 1e-12) );
+
+            if( nThreads == nThreadCount )
+                break;
+            nThreads = MIN(nThreads * 2, nThreadCount);
+        }
+    }
     
+    CPLDestroyMutex( pGlobalMutex );
+
     CSLDestroy( argv );
     
     GDALDestroyDriverManager();
@@ -156,6 +195,52 @@ int main( int argc, char ** argv )
 }
 
 
+/************************************************************************/
+/*                            GetWallTime()                             */
+/************************************************************************/
+
+static double GetWallTime()
+
+{
+#ifdef WIN32
+    return GetTickCount() / 1000.0;
+#else
+    struct timeval tv;
+
+    gettimeofday( &tv, NULL );
+    return tv.tv_sec + tv.tv_usec / 1e6;
+#endif
+}
+
+/************************************************************************/
+/*                             RunWorkers()                             */
+/*                                                                      */
+/*      Launch nThreads workers, wait for them to complete and          */
+/*      return the elapsed time in seconds, or -1 on failure.           */
+/************************************************************************/
+
+static double RunWorkers( int nThreads )
+
+{
+    double dfStart = GetWallTime();
+
+    nPendingThreads = nThreads;
+
+    for( int iThread = 0; iThread < nThreads; iThread++ )
+    {
+        if( CPLCreateThread( WorkerFunc, NULL ) == -1 )
+        {
+            printf( "CPLCreateThread() failed.\n" );
+            return -1.0;
+        }
+    }
+
+    while( nPendingThreads > 0 )
+        CPLSleep( 0.01 );
+
+    return GetWallTime() - dfStart;
+}
+
 /************************************************************************/
 /*                             WorkerFunc()                             */
 /************************************************************************/
@@ -55,6 +55,8 @@
 #include "cplkeywordparser.h"
 #include "gt_jpeg_copy.h"
 #include <set>
+#include <vector>
+#include <algorithm>
 
 #ifdef INTERNAL_LIBTIFF
 #include "tiffiop.h"
@@ -139,6 +141,22 @@ void GTIFFGetOverviewBlockSize(int* pnBlockXSize, int* pnBlockYSize)
     *pnBlockYSize = nOvrBlockSize;
 }
 
+/************************************************************************/
+/*                         GTiffGetNumThreads()                         */
+/*                                                                      */
+/*      Number of threads used to compress blocks, from the             */
+/*      NUM_THREADS creation or open option, or else from the           */
+/*      GDAL_NUM_THREADS configuration option.                          */
+/************************************************************************/
+
+static int GTiffGetNumThreads(char** papszOptions)
+{
+    const char* pszValue = CSLFetchNameValue( papszOptions, "NUM_THREADS" );
+    if( pszValue == NULL )
+        pszValue = CPLGetConfigOption( "GDAL_NUM_THREADS", "1" );
+    return CPLGetNumThreadsFromOption( pszValue, 1 );
+}
+
 enum
 {
     ENDIANNESS_NATIVE,
@@ -146,6 +164,99 @@ enum
     ENDIANNESS_BIG
 };
 
+/************************************************************************/
+/*                           GTiffBlockCodec                            */
+/*                                                                      */
+/*      Parameters needed to encode or decode a single tile or strip    */
+/*      of a directory in a private one-block in-memory TIFF file, so   */
+/*      that this can be done by a worker thread without touching the   */
+/*      TIFF handle of the dataset.                                     */
+/************************************************************************/
+
+typedef struct
+{
+    int          nTmpBlockId;     /* block id in the temporary file */
+    int          bTiled;
+    int          bBigEndian;
+
+    uint32       nWidth;          /* tile width, or raster width for strips */
+    uint32       nHeight;         /* tile height, or rows of this strip */
+    uint16       nPlanarConfig;
+    uint16       nSamplesPerPixel;
+    uint16       nBitsPerSample;
+    uint16       nSampleFormat;
+    uint16       nPhotometric;
+    uint16       nCompression;
+    uint16       nPredictor;
+    uint16       anYCbCrSubsampling[2];
+    int          nZLevel;
+    int          nLZMAPreset;
+    int          nJpegQuality;
+    int          nJpegColorMode;
+    int          nJpegTablesMode;
+
+    /* Only used for decoding.  Points to the tables of the dataset */
+    /* directory, which must remain current until the job completes. */
+    uint32       nJPEGTableSize;
+    void        *pJPEGTable;
+} GTiffBlockCodec;
+
+/************************************************************************/
+/*                         GTiffCompressionJob                          */
+/*                                                                      */
+/*      A tile or strip being compressed by a worker thread.  The       */
+/*      worker encodes the block into a private in-memory TIFF file     */
+/*      created with the same compression parameters as the target      */
+/*      directory, and the compressed bytes are then appended to the    */
+/*      target file by the thread owning the dataset, in submission     */
+/*      order.                                                          */
+/************************************************************************/
+
+typedef struct
+{
+    CPLJobGroup *psGroup;
+    CPLString    osTmpFilename;
+
+    int          nBlockId;
+    GTiffBlockCodec sCodec;
+
+    GByte       *pabyBuffer;      /* uncompressed data */
+    int          nBufferSize;
+    int          nBufferDataSize;
+
+    GByte       *pabyCompressed;
+    int          nCompressedAlloc;
+    int          nCompressedSize;
+    int          bOK;
+} GTiffCompressionJob;
+
+/************************************************************************/
+/*                        GTiffDecompressionJob                         */
+/*                                                                      */
+/*      A tile or strip whose compressed bytes have been read by the    */
+/*      thread owning the dataset, and that is decoded by a worker      */
+/*      thread.                                                         */
+/************************************************************************/
+
+typedef struct
+{
+    CPLString    osTmpFilename;
+
+    int          nBlockId;
+    int          nBlockXOff;
+    int          nBlockYOff;
+    int          nBand;           /* 0 for a pixel interleaved block */
+    GTiffBlockCodec sCodec;
+
+    vsi_l_offset nOffset;
+    GByte       *pabyCompressed;
+    int          nCompressedSize;
+
+    GByte       *pabyDecoded;
+    int          nDecodedSize;    /* bytes to decode, up to the last row */
+    int          bOK;
+} GTiffDecompressionJob;
+
 /************************************************************************/
 /* ==================================================================== */
 /*				GTiffDataset				*/
@@ -239,7 +350,9 @@ class GTiffDataset : public GDALPamDataset
     int		nGCPCount;
     GDAL_GCP	*pasGCPList;
 
-    int         IsBlockAvailable( int nBlockId );
+    int         IsBlockAvailable( int nBlockId,
+                                  vsi_l_offset* pnOffset = NULL,
+                                  vsi_l_offset* pnSize = NULL );
 
     int         bGeoTIFFInfoChanged;
     int         bForceUnsetGT;
@@ -270,6 +383,38 @@ class GTiffDataset : public GDALPamDataset
     int          WriteEncodedTile(uint32 tile, GByte* pabyData, int bPreserveDataBuffer);
     int          WriteEncodedStrip(uint32 strip, GByte* pabyData, int bPreserveDataBuffer);
 
+    /* Compression of blocks by worker threads (NUM_THREADS option) */
+    int                  nCompressionThreads;
+    int                  nCompressionJobs;
+    GTiffCompressionJob *pasCompressionJobs;
+    int                  iFirstPendingJob;
+    int                  nPendingJobs;
+
+    GTiffCompressionJob *GetCompressionJob( int nBlockId, int nBytes );
+    int          SubmitCompressionJob( GTiffCompressionJob* psJob,
+                                       int nBlockId, int nHeight );
+    static void  ThreadCompressionFunc( void* pData );
+    CPLErr       WriteFirstPendingJob();
+    CPLErr       WaitCompletionForBlock( int nBlockId );
+    CPLErr       WaitCompletionForAllJobs();
+    void         DestroyCompressionJobs();
+
+    void         GetBlockCodec( GTiffBlockCodec* psCodec,
+                                int nBlockId, int nHeight );
+    static TIFF* CreateBlockCodecTIFF( const char* pszTmpFilename,
+                                       VSILFILE* fpTmp,
+                                       const GTiffBlockCodec* psCodec,
+                                       int bForEncoding );
+
+    /* Decompression of blocks by worker threads for multi-block reads */
+    int          CanCacheMultiBlocks();
+    int          GetMultiBlockStripeHeight( int nXOff, int nXSize,
+                                            int nBandCount );
+    void         CacheMultiBlocks( int nXOff, int nYOff,
+                                   int nXSize, int nYSize,
+                                   int nBandCount, int *panBandMap );
+    static void  ThreadDecompressionFunc( void* pData );
+
     GTiffDataset* poMaskDS;
     GTiffDataset* poBaseDS;
 
@@ -340,6 +485,27 @@ class GTiffDataset : public GDALPamDataset
     CPLVirtualMem *pBaseMapping;
     int            nRefBaseMapping;
 
+    /* Memory mapping of the whole file, for GTIFF_VIRTUAL_MEM_IO */
+    int            bVirtualMemIO;
+    CPLVirtualMem *psVirtualMemIOMapping;
+    int            bHasTriedVirtualMemIOMapping;
+    CPLVirtualMem *GetVirtualMemIOMapping();
+    int            VirtualMemIO( GDALRWFlag eRWFlag,
+                                 int nXOff, int nYOff, int nXSize, int nYSize,
+                                 void * pData, int nBufXSize, int nBufYSize,
+                                 GDALDataType eBufType,
+                                 int nBandCount, int *panBandMap,
+                                 int nPixelSpace, int nLineSpace,
+                                 int nBandSpace );
+
+    /* Structural metadata written at the start of the file by */
+    /* CreateCopy() with COPY_SRC_OVERVIEWS=YES. Offset of the */
+    /* KNOWN_INCOMPATIBLE_EDITION value, or 0 if there is nothing to */
+    /* flag when the layout gets altered. */
+    vsi_l_offset   nKnownIncompatibleEditionOffset;
+    void           FlagLayoutAsEdited();
+    static void    WriteJPEGTables( TIFF* hTIFF );
+
   protected:
     virtual int         CloseDependentDatasets();
 
@@ -466,6 +632,7 @@ GTiffJPEGOverviewDS::GTiffJPEGOverviewDS(GTiffDataset* poParentDS, int nOverview
     this->poParentDS = poParentDS;
     this->nOverviewLevel = nOverviewLevel;
     poJPEGDS = NULL;
+    SetBlockIOParent( poParentDS );
     nBlockId = -1;
 
     osTmpFilenameJPEGTable.Printf("/vsimem/jpegtable_%p", this);
@@ -594,7 +761,9 @@ CPLErr GTiffJPEGOverviewBand::IReadBlock( int nBlockXOff, int nBlockYOff, void *
 
     /* Make sure it is available */
     int nDataTypeSize = GDALGetDataTypeSize(eDataType)/8;
-    if( !poGDS->poParentDS->IsBlockAvailable(nBlockId) )
+    vsi_l_offset nOffset = 0;
+    vsi_l_offset nByteCount = 0;
+    if( !poGDS->poParentDS->IsBlockAvailable(nBlockId, &nOffset, &nByteCount) )
     {
         memset(pImage, 0, nBlockXSize * nBlockYSize * nDataTypeSize );
         return CE_None;
@@ -603,30 +772,12 @@ CPLErr GTiffJPEGOverviewBand::IReadBlock( int nBlockXOff, int nBlockYOff, void *
     int nScaleFactor = 1 << poGDS->nOverviewLevel;
     if( poGDS->poJPEGDS == NULL || nBlockId != poGDS->nBlockId )
     {
-        toff_t *panByteCounts = NULL;
-        toff_t *panOffsets = NULL;
-        vsi_l_offset nOffset = 0;
-        vsi_l_offset nByteCount = 0;
-
-        /* Find offset and size of the JPEG tile/strip */
+        /* Offset and size of the JPEG tile/strip */
         TIFF* hTIFF = poGDS->poParentDS->hTIFF;
-        if( (( TIFFIsTiled( hTIFF ) 
-            && TIFFGetField( hTIFF, TIFFTAG_TILEBYTECOUNTS, &panByteCounts )
-            && TIFFGetField( hTIFF, TIFFTAG_TILEOFFSETS, &panOffsets ) )
-            || ( !TIFFIsTiled( hTIFF ) 
-            && TIFFGetField( hTIFF, TIFFTAG_STRIPBYTECOUNTS, &panByteCounts )
-            && TIFFGetField( hTIFF, TIFFTAG_STRIPOFFSETS, &panOffsets ) )) &&
-            panByteCounts != NULL && panOffsets != NULL )
-        {
-            if( panByteCounts[nBlockId] < 2 )
-                return CE_Failure;
-            nOffset = panOffsets[nBlockId] + 2; /* skip leading 0xFF 0xF8 */
-            nByteCount = panByteCounts[nBlockId] - 2;
-        }
-        else
-        {
+        if( nByteCount < 2 )
             return CE_Failure;
-        }
+        nOffset += 2; /* skip leading 0xFF 0xF8 */
+        nByteCount -= 2;
 
         /* Special case for last strip that might be smaller than other strips */
         /* In which case we must invalidate the dataset */
@@ -1522,6 +1673,172 @@ CPLVirtualMem* GTiffRasterBand::GetVirtualMemAutoInternal( GDALRWFlag eRWFlag,
     }
 }
 
+/************************************************************************/
+/*                       GetVirtualMemIOMapping()                       */
+/*                                                                      */
+/*      Read-only memory mapping of the whole file, shared by the       */
+/*      datasets (overviews, masks) using the same TIFF handle.         */
+/************************************************************************/
+
+CPLVirtualMem* GTiffDataset::GetVirtualMemIOMapping()
+{
+    if( poBaseDS != NULL && !bCloseTIFFHandle )
+        return poBaseDS->GetVirtualMemIOMapping();
+
+    if( !bHasTriedVirtualMemIOMapping )
+    {
+        bHasTriedVirtualMemIOMapping = TRUE;
+
+        VSILFILE* fp = (VSILFILE*) TIFFClientdata( hTIFF );
+        if( CPLIsVirtualMemFileMapAvailable() &&
+            VSIFGetNativeFileDescriptorL(fp) != NULL )
+        {
+            vsi_l_offset nCurOffset = VSIFTellL(fp);
+            VSIFSeekL(fp, 0, SEEK_END);
+            vsi_l_offset nFileSize = VSIFTellL(fp);
+            VSIFSeekL(fp, nCurOffset, SEEK_SET);
+
+            if( nFileSize > 0 && (size_t)nFileSize == nFileSize )
+            {
+                CPLPushErrorHandler( CPLQuietErrorHandler );
+                psVirtualMemIOMapping = CPLVirtualMemFileMapNew(
+                    fp, 0, nFileSize, VIRTUALMEM_READONLY, NULL, NULL );
+                CPLPopErrorHandler();
+            }
+        }
+        if( psVirtualMemIOMapping == NULL )
+            CPLDebug( "GTiff", "Cannot use memory mapping for RasterIO()" );
+    }
+
+    return psVirtualMemIOMapping;
+}
+
+/************************************************************************/
+/*                            VirtualMemIO()                            */
+/*                                                                      */
+/*      Serve a non-resampled read of an uncompressed, natively         */
+/*      ordered file by copying straight from the memory mapping of     */
+/*      the file, without going through the block cache.  Returns -1    */
+/*      if the request cannot be handled that way, for example if       */
+/*      some blocks are missing (sparse files) or truncated.            */
+/************************************************************************/
+
+int GTiffDataset::VirtualMemIO( GDALRWFlag eRWFlag,
+                                int nXOff, int nYOff, int nXSize, int nYSize,
+                                void * pData, int nBufXSize, int nBufYSize,
+                                GDALDataType eBufType,
+                                int nBandCount, int *panBandMap,
+                                int nPixelSpace, int nLineSpace,
+                                int nBandSpace )
+{
+    if( eRWFlag != GF_Read || eAccess != GA_ReadOnly ||
+        nXSize != nBufXSize || nYSize != nBufYSize || nBands == 0 ||
+        nCompression != COMPRESSION_NONE ||
+        bTreatAsRGBA || bTreatAsSplit || bTreatAsSplitBitmap )
+        return -1;
+
+    GDALDataType eDataType = papoBands[0]->GetRasterDataType();
+    if( (nBitsPerSample % 8) != 0 ||
+        GDALGetDataTypeSize(eDataType) != nBitsPerSample ||
+        (nBitsPerSample > 8 && TIFFIsByteSwapped( hTIFF )) )
+        return -1;
+
+    if( !SetDirectory() )
+        return -1;
+
+    CPLVirtualMem* psMapping = GetVirtualMemIOMapping();
+    if( psMapping == NULL )
+        return -1;
+
+    GByte* pabyMap = (GByte*) CPLVirtualMemGetAddr( psMapping );
+    vsi_l_offset nMapSize = CPLVirtualMemGetSize( psMapping );
+
+    int nWordBytes = nBitsPerSample / 8;
+    int nPixelStride = nWordBytes;
+    if( nPlanarConfig == PLANARCONFIG_CONTIG )
+        nPixelStride *= nBands;
+    int nBlocksPerRow = DIV_ROUND_UP(nRasterXSize, nBlockXSize);
+    int nBlockX1 = nXOff / nBlockXSize;
+    int nBlockY1 = nYOff / nBlockYSize;
+    int nBlockX2 = (nXOff + nXSize - 1) / nBlockXSize;
+    int nBlockY2 = (nYOff + nYSize - 1) / nBlockYSize;
+    int nBlockBands = (nPlanarConfig == PLANARCONFIG_CONTIG) ? 1 : nBandCount;
+
+/* -------------------------------------------------------------------- */
+/*      Check first that all the needed rows of the blocks are in       */
+/*      the file, so as to fallback before anything is copied.         */
+/* -------------------------------------------------------------------- */
+    std::vector<vsi_l_offset> anOffsets;
+    for( int nBlockYOff = nBlockY1; nBlockYOff <= nBlockY2; nBlockYOff++ )
+    {
+        int nLastRow = MIN( nYOff + nYSize,
+                            (int)((nBlockYOff + 1) * nBlockYSize) ) -
+                       nBlockYOff * nBlockYSize;
+        vsi_l_offset nNeeded =
+            (vsi_l_offset) nLastRow * nBlockXSize * nPixelStride;
+
+        for( int nBlockXOff = nBlockX1; nBlockXOff <= nBlockX2; nBlockXOff++ )
+        {
+            for( int iBlockBand = 0; iBlockBand < nBlockBands; iBlockBand++ )
+            {
+                int nBlockId = nBlockXOff + nBlockYOff * nBlocksPerRow;
+                if( nPlanarConfig == PLANARCONFIG_SEPARATE )
+                    nBlockId += (panBandMap[iBlockBand] - 1) * nBlocksPerBand;
+
+                vsi_l_offset nOffset = 0, nSize = 0;
+                if( !IsBlockAvailable( nBlockId, &nOffset, &nSize ) ||
+                    nSize < nNeeded || nOffset + nNeeded > nMapSize )
+                    return -1;
+                anOffsets.push_back( nOffset );
+            }
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Copy the intersection of the window with each block.            */
+/* -------------------------------------------------------------------- */
+    int iOffset = 0;
+    for( int nBlockYOff = nBlockY1; nBlockYOff <= nBlockY2; nBlockYOff++ )
+    {
+        int nRow1 = MAX( nYOff, (int)(nBlockYOff * nBlockYSize) );
+        int nRow2 = MIN( nYOff + nYSize, (int)((nBlockYOff + 1) * nBlockYSize) );
+
+        for( int nBlockXOff = nBlockX1; nBlockXOff <= nBlockX2; nBlockXOff++ )
+        {
+            int nCol1 = MAX( nXOff, (int)(nBlockXOff * nBlockXSize) );
+            int nCol2 = MIN( nXOff + nXSize, (int)((nBlockXOff + 1) * nBlockXSize) );
+
+            for( int iBlockBand = 0; iBlockBand < nBlockBands; iBlockBand++ )
+            {
+                GByte* pabyBlock = pabyMap + anOffsets[iOffset++];
+
+                int iFirstBand = iBlockBand;
+                int iLastBand = (nBlockBands == 1) ? nBandCount - 1 : iBlockBand;
+                for( int iBand = iFirstBand; iBand <= iLastBand; iBand++ )
+                {
+                    int nBandOffset = (nPlanarConfig == PLANARCONFIG_CONTIG) ?
+                                    (panBandMap[iBand] - 1) * nWordBytes : 0;
+                    for( int iRow = nRow1; iRow < nRow2; iRow++ )
+                    {
+                        GByte* pabySrc = pabyBlock + nBandOffset +
+                            ((GIntBig)(iRow - nBlockYOff * nBlockYSize) * nBlockXSize +
+                             (nCol1 - nBlockXOff * nBlockXSize)) * nPixelStride;
+                        GByte* pabyDst = ((GByte*) pData) +
+                            (GIntBig)iBand * nBandSpace +
+                            (GIntBig)(iRow - nYOff) * nLineSpace +
+                            (GIntBig)(nCol1 - nXOff) * nPixelSpace;
+                        GDALCopyWords( pabySrc, eDataType, nPixelStride,
+                                       pabyDst, eBufType, nPixelSpace,
+                                       nCol2 - nCol1 );
+                    }
+                }
+            }
+        }
+    }
+
+    return CE_None;
+}
+
 /************************************************************************/
 /*                            IRasterIO()                               */
 /************************************************************************/
@@ -1559,6 +1876,48 @@ CPLErr GTiffDataset::IRasterIO( GDALRWFlag eRWFlag,
         }
     }
 
+    if( bVirtualMemIO )
+    {
+        int nErr = VirtualMemIO( eRWFlag, nXOff, nYOff, nXSize, nYSize,
+                                 pData, nBufXSize, nBufYSize, eBufType,
+                                 nBandCount, panBandMap,
+                                 nPixelSpace, nLineSpace, nBandSpace );
+        if( nErr >= 0 )
+            return (CPLErr) nErr;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Decode the blocks of multi-block reads in worker threads, by    */
+/*      stripes of blocks if they would not fit in the block cache.     */
+/* -------------------------------------------------------------------- */
+    if( eRWFlag == GF_Read && nBufXSize >= nXSize && nBufYSize >= nYSize &&
+        CanCacheMultiBlocks() )
+    {
+        int nStripeHeight = GetMultiBlockStripeHeight( nXOff, nXSize,
+                                                       nBandCount );
+        int nFirstRow = (int)(nYOff / nBlockYSize) * (int)nBlockYSize;
+        if( nYOff + nYSize - nFirstRow <= nStripeHeight )
+            CacheMultiBlocks( nXOff, nYOff, nXSize, nYSize,
+                              nBandCount, panBandMap );
+        else if( nStripeHeight > 0 && nBufYSize == nYSize )
+        {
+            eErr = CE_None;
+            for( int nRow = nYOff; eErr == CE_None && nRow < nYOff + nYSize; )
+            {
+                int nRows = MIN( (int)(nRow / nBlockYSize) * (int)nBlockYSize +
+                                 nStripeHeight, nYOff + nYSize ) - nRow;
+                eErr = IRasterIO( eRWFlag, nXOff, nRow, nXSize, nRows,
+                                  ((GByte*) pData) +
+                                        (GIntBig)(nRow - nYOff) * nLineSpace,
+                                  nBufXSize, nRows, eBufType,
+                                  nBandCount, panBandMap,
+                                  nPixelSpace, nLineSpace, nBandSpace );
+                nRow += nRows;
+            }
+            return eErr;
+        }
+    }
+
     nJPEGOverviewVisibilityFlag ++;
     eErr =  GDALPamDataset::IRasterIO(
                 eRWFlag, nXOff, nYOff, nXSize, nYSize,
@@ -1583,6 +1942,15 @@ CPLErr GTiffRasterBand::IRasterIO( GDALRWFlag eRWFlag,
     //CPLDebug("GTiff", "RasterIO(%d, %d, %d, %d, %d, %d)",
     //         nXOff, nYOff, nXSize, nYSize, nBufXSize, nBufYSize);
 
+    if( poGDS->bVirtualMemIO )
+    {
+        int nErr = poGDS->VirtualMemIO( eRWFlag, nXOff, nYOff, nXSize, nYSize,
+                                        pData, nBufXSize, nBufYSize, eBufType,
+                                        1, &nBand, nPixelSpace, nLineSpace, 0 );
+        if( nErr >= 0 )
+            return (CPLErr) nErr;
+    }
+
     if (poGDS->bDirectIO)
     {
         poGDS->nJPEGOverviewVisibilityFlag ++;
@@ -1594,6 +1962,36 @@ CPLErr GTiffRasterBand::IRasterIO( GDALRWFlag eRWFlag,
             return eErr;
     }
 
+/* -------------------------------------------------------------------- */
+/*      Decode the blocks of multi-block reads in worker threads, by    */
+/*      stripes of blocks if they would not fit in the block cache.     */
+/* -------------------------------------------------------------------- */
+    if( eRWFlag == GF_Read && nBufXSize >= nXSize && nBufYSize >= nYSize &&
+        poGDS->CanCacheMultiBlocks() )
+    {
+        int nStripeHeight = poGDS->GetMultiBlockStripeHeight( nXOff, nXSize,
+                                                              1 );
+        int nFirstRow = (nYOff / nBlockYSize) * nBlockYSize;
+        if( nYOff + nYSize - nFirstRow <= nStripeHeight )
+            poGDS->CacheMultiBlocks( nXOff, nYOff, nXSize, nYSize, 1, &nBand );
+        else if( nStripeHeight > 0 && nBufYSize == nYSize )
+        {
+            eErr = CE_None;
+            for( int nRow = nYOff; eErr == CE_None && nRow < nYOff + nYSize; )
+            {
+                int nRows = MIN( (nRow / nBlockYSize) * nBlockYSize +
+                                 nStripeHeight, nYOff + nYSize ) - nRow;
+                eErr = IRasterIO( eRWFlag, nXOff, nRow, nXSize, nRows,
+                                  ((GByte*) pData) +
+                                        (GIntBig)(nRow - nYOff) * nLineSpace,
+                                  nBufXSize, nRows, eBufType,
+                                  nPixelSpace, nLineSpace );
+                nRow += nRows;
+            }
+            return eErr;
+        }
+    }
+
     if (poGDS->nBands != 1 &&
         poGDS->nPlanarConfig == PLANARCONFIG_CONTIG &&
         eRWFlag == GF_Read &&
@@ -2268,25 +2666,13 @@ const char *GTiffRasterBand::GetMetadataItem( const char * pszName,
                 nBlockId += (nBand-1) * poGDS->nBlocksPerBand;
             }
 
-            if( !poGDS->IsBlockAvailable(nBlockId) )
+            vsi_l_offset nOffset = 0;
+            if( !poGDS->IsBlockAvailable(nBlockId, &nOffset) )
             {
                 return NULL;
             }
 
-            toff_t *panOffsets = NULL;
-            TIFF* hTIFF = poGDS->hTIFF;
-            if( (( TIFFIsTiled( hTIFF ) 
-                && TIFFGetField( hTIFF, TIFFTAG_TILEOFFSETS, &panOffsets ) )
-                || ( !TIFFIsTiled( hTIFF ) 
-                && TIFFGetField( hTIFF, TIFFTAG_STRIPOFFSETS, &panOffsets ) )) &&
-                panOffsets != NULL )
-            {
-                return CPLSPrintf(CPL_FRMT_GUIB, (GUIntBig)panOffsets[nBlockId]);
-            }
-            else
-            {
-                return NULL;
-            }
+            return CPLSPrintf(CPL_FRMT_GUIB, (GUIntBig)nOffset);
         }
         else if( sscanf(pszName, "BLOCK_SIZE_%d_%d", &nBlockXOff, &nBlockYOff) == 2 )
         {
@@ -2305,25 +2691,13 @@ const char *GTiffRasterBand::GetMetadataItem( const char * pszName,
                 nBlockId += (nBand-1) * poGDS->nBlocksPerBand;
             }
 
-            if( !poGDS->IsBlockAvailable(nBlockId) )
+            vsi_l_offset nByteCount = 0;
+            if( !poGDS->IsBlockAvailable(nBlockId, NULL, &nByteCount) )
             {
                 return NULL;
             }
 
-            toff_t *panByteCounts = NULL;
-            TIFF* hTIFF = poGDS->hTIFF;
-            if( (( TIFFIsTiled( hTIFF ) 
-                && TIFFGetField( hTIFF, TIFFTAG_TILEBYTECOUNTS, &panByteCounts ) )
-                || ( !TIFFIsTiled( hTIFF ) 
-                && TIFFGetField( hTIFF, TIFFTAG_STRIPBYTECOUNTS, &panByteCounts ) )) &&
-                panByteCounts != NULL )
-            {
-                return CPLSPrintf(CPL_FRMT_GUIB, (GUIntBig)panByteCounts[nBlockId]);
-            }
-            else
-            {
-                return NULL;
-            }
+            return CPLSPrintf(CPL_FRMT_GUIB, (GUIntBig)nByteCount);
         }
     }
     return oGTiffMDMD.GetMetadataItem( pszName, pszDomain );
@@ -3993,6 +4367,12 @@ GTiffDataset::GTiffDataset()
     nTempWriteBufferSize = 0;
     pabyTempWriteBuffer = NULL;
 
+    nCompressionThreads = 1;
+    nCompressionJobs = 0;
+    pasCompressionJobs = NULL;
+    iFirstPendingJob = 0;
+    nPendingJobs = 0;
+
     poMaskDS = NULL;
     poBaseDS = NULL;
 
@@ -4026,6 +4406,10 @@ GTiffDataset::GTiffDataset()
     bScanDeferred = TRUE;
 
     bDirectIO = CSLTestBoolean(CPLGetConfigOption("GTIFF_DIRECT_IO", "NO"));
+    bVirtualMemIO = CSLTestBoolean(CPLGetConfigOption("GTIFF_VIRTUAL_MEM_IO", "NO"));
+    psVirtualMemIOMapping = NULL;
+    bHasTriedVirtualMemIOMapping = FALSE;
+    nKnownIncompatibleEditionOffset = 0;
     nSetPhotometricFromBandColorInterp = 0;
 
     pBaseMapping = NULL;
@@ -4093,6 +4477,8 @@ int GTiffDataset::Finalize()
 /* -------------------------------------------------------------------- */
     FlushCache();
 
+    DestroyCompressionJobs();
+
 /* -------------------------------------------------------------------- */
 /*      If there is still changed metadata, then presumably we want     */
 /*      to push it into PAM.                                            */
@@ -4148,6 +4534,11 @@ int GTiffDataset::Finalize()
 
     if( bBase || bCloseTIFFHandle )
     {
+        if( psVirtualMemIOMapping != NULL )
+        {
+            CPLVirtualMemFree( psVirtualMemIOMapping );
+            psVirtualMemIOMapping = NULL;
+        }
         XTIFFClose( hTIFF );
         hTIFF = NULL;
         if( fpL != NULL )
@@ -4268,63 +4659,849 @@ void GTiffDataset::FillEmptyTiles()
     toff_t *panByteCounts = NULL;
     int    nBlockCount, iBlock;
 
-    if (!SetDirectory())
+    if (!SetDirectory())
+        return;
+
+/* -------------------------------------------------------------------- */
+/*      Blocks still being compressed have a zero byte count until      */
+/*      they are written.                                               */
+/* -------------------------------------------------------------------- */
+    if( WaitCompletionForAllJobs() != CE_None )
+        return;
+
+/* -------------------------------------------------------------------- */
+/*      How many blocks are there in this file?                         */
+/* -------------------------------------------------------------------- */
+    if( nPlanarConfig == PLANARCONFIG_SEPARATE )
+        nBlockCount = nBlocksPerBand * nBands;
+    else
+        nBlockCount = nBlocksPerBand;
+
+/* -------------------------------------------------------------------- */
+/*      Fetch block maps.                                               */
+/* -------------------------------------------------------------------- */
+    if( TIFFIsTiled( hTIFF ) )
+        TIFFGetField( hTIFF, TIFFTAG_TILEBYTECOUNTS, &panByteCounts );
+    else
+        TIFFGetField( hTIFF, TIFFTAG_STRIPBYTECOUNTS, &panByteCounts );
+
+    if (panByteCounts == NULL)
+    {
+        /* Got here with libtiff 3.9.3 and tiff_write_8 test */
+        CPLError(CE_Failure, CPLE_AppDefined, "FillEmptyTiles() failed because panByteCounts == NULL");
+        return;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Prepare a blank data buffer to write for uninitialized blocks.  */
+/* -------------------------------------------------------------------- */
+    int nBlockBytes;
+
+    if( TIFFIsTiled( hTIFF ) )
+        nBlockBytes = TIFFTileSize(hTIFF);
+    else
+        nBlockBytes = TIFFStripSize(hTIFF);
+
+    GByte *pabyData = (GByte *) VSICalloc(nBlockBytes,1);
+    if (pabyData == NULL)
+    {
+        CPLError(CE_Failure, CPLE_OutOfMemory,
+                 "Cannot allocate %d bytes", nBlockBytes);
+        return;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Check all blocks, writing out data for uninitialized blocks.    */
+/* -------------------------------------------------------------------- */
+    for( iBlock = 0; iBlock < nBlockCount; iBlock++ )
+    {
+        if( panByteCounts[iBlock] == 0 )
+        {
+            if( WriteEncodedTileOrStrip( iBlock, pabyData, FALSE ) != CE_None )
+                break;
+        }
+    }
+
+    CPLFree( pabyData );
+}
+
+/************************************************************************/
+/*                         GetCompressionJob()                          */
+/*                                                                      */
+/*      Return a free job slot to compress the given block in a         */
+/*      worker thread, or NULL if the block must be written             */
+/*      synchronously, in which case all pending jobs have been         */
+/*      written first so as to preserve the order of the blocks in      */
+/*      the file.                                                       */
+/************************************************************************/
+
+GTiffCompressionJob *GTiffDataset::GetCompressionJob( int nBlockId,
+                                                      int nBytes )
+{
+    if( nCompressionThreads <= 1 || bDebugDontWriteBlocks )
+        return NULL;
+
+    if( nCompression != COMPRESSION_ADOBE_DEFLATE &&
+        nCompression != COMPRESSION_LZW &&
+        nCompression != COMPRESSION_PACKBITS &&
+        nCompression != COMPRESSION_LZMA
+#ifdef INTERNAL_LIBTIFF
+        && nCompression != COMPRESSION_JPEG
+#endif
+      )
+        return NULL;
+
+/* -------------------------------------------------------------------- */
+/*      Blocks already written are rewritten in place or moved at       */
+/*      the end of the file by libtiff, which we leave it to do.        */
+/* -------------------------------------------------------------------- */
+    if( WaitCompletionForBlock( nBlockId ) != CE_None )
+        return NULL;
+
+    toff_t *panByteCounts = NULL;
+    if( TIFFIsTiled( hTIFF ) )
+        TIFFGetField( hTIFF, TIFFTAG_TILEBYTECOUNTS, &panByteCounts );
+    else
+        TIFFGetField( hTIFF, TIFFTAG_STRIPBYTECOUNTS, &panByteCounts );
+
+    int bSynchronous = ( panByteCounts == NULL ||
+                         panByteCounts[nBlockId] != 0 );
+#ifdef INTERNAL_LIBTIFF
+/* -------------------------------------------------------------------- */
+/*      The JPEG tables are created by the first encoded block.  When   */
+/*      the codec is set up again (after a directory write), the        */
+/*      next encoded block embeds the Huffman tables, which a block     */
+/*      compressed in a fresh file would not, so that block is also     */
+/*      left to libtiff.                                                */
+/* -------------------------------------------------------------------- */
+    if( !bSynchronous && nCompression == COMPRESSION_JPEG )
+    {
+        uint32 nJPEGTableSize = 0;
+        void*  pJPEGTable = NULL;
+        bSynchronous = ( (hTIFF->tif_flags & TIFF_CODERSETUP) == 0 ||
+                         !TIFFGetField( hTIFF, TIFFTAG_JPEGTABLES,
+                                        &nJPEGTableSize, &pJPEGTable ) );
+    }
+#endif
+    if( bSynchronous )
+    {
+        WaitCompletionForAllJobs();
+        return NULL;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Allocate the job slots the first time.                          */
+/* -------------------------------------------------------------------- */
+    if( pasCompressionJobs == NULL )
+    {
+        nCompressionJobs = 2 * nCompressionThreads;
+        pasCompressionJobs = new GTiffCompressionJob[nCompressionJobs];
+        for( int i = 0; i < nCompressionJobs; i++ )
+        {
+            GTiffCompressionJob* psJob = &pasCompressionJobs[i];
+            psJob->psGroup = CPLCreateJobGroup();
+            psJob->osTmpFilename.Printf("/vsimem/gtiff/thread/job/%p",
+                                        psJob);
+            psJob->pabyBuffer = NULL;
+            psJob->nBufferSize = 0;
+            psJob->pabyCompressed = NULL;
+            psJob->nCompressedAlloc = 0;
+        }
+        iFirstPendingJob = 0;
+        nPendingJobs = 0;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      The slots are used as a ring buffer: if they are all pending,   */
+/*      write the oldest one to free it.                                */
+/* -------------------------------------------------------------------- */
+    if( nPendingJobs == nCompressionJobs &&
+        WriteFirstPendingJob() != CE_None )
+        return NULL;
+
+    GTiffCompressionJob* psJob =
+        &pasCompressionJobs[(iFirstPendingJob + nPendingJobs) % nCompressionJobs];
+
+    if( psJob->nBufferSize < nBytes )
+    {
+        GByte* pabyNew = (GByte*) VSIRealloc(psJob->pabyBuffer, nBytes);
+        if( pabyNew == NULL )
+        {
+            WaitCompletionForAllJobs();
+            return NULL;
+        }
+        psJob->pabyBuffer = pabyNew;
+        psJob->nBufferSize = nBytes;
+    }
+    psJob->nBufferDataSize = nBytes;
+
+    return psJob;
+}
+
+/************************************************************************/
+/*                           GetBlockCodec()                            */
+/*                                                                      */
+/*      Capture the encoding parameters of the current directory,       */
+/*      including the codec session parameters that are not stored      */
+/*      in the file.                                                    */
+/************************************************************************/
+
+void GTiffDataset::GetBlockCodec( GTiffBlockCodec* psCodec,
+                                  int nBlockId, int nHeight )
+{
+    /* With separate planes, use the block in the plane of the same */
+    /* sample, as the JPEG codec encodes the sample number. */
+    psCodec->nTmpBlockId = (nPlanarConfig == PLANARCONFIG_SEPARATE) ?
+                                            nBlockId / nBlocksPerBand : 0;
+    psCodec->bTiled = TIFFIsTiled( hTIFF );
+    psCodec->bBigEndian = TIFFIsBigEndian( hTIFF );
+    psCodec->nWidth = psCodec->bTiled ? nBlockXSize : (uint32) nRasterXSize;
+    psCodec->nHeight = nHeight;
+    psCodec->nPlanarConfig = nPlanarConfig;
+    psCodec->nSamplesPerPixel = nSamplesPerPixel;
+    psCodec->nBitsPerSample = nBitsPerSample;
+    psCodec->nSampleFormat = nSampleFormat;
+    psCodec->nPhotometric = nPhotometric;
+    psCodec->nCompression = nCompression;
+    psCodec->nPredictor = PREDICTOR_NONE;
+    psCodec->anYCbCrSubsampling[0] = 0;
+    psCodec->anYCbCrSubsampling[1] = 0;
+    psCodec->nZLevel = -1;
+    psCodec->nLZMAPreset = -1;
+    psCodec->nJpegQuality = -1;
+    psCodec->nJpegColorMode = -1;
+    psCodec->nJpegTablesMode = -1;
+    psCodec->nJPEGTableSize = 0;
+    psCodec->pJPEGTable = NULL;
+
+    if( nCompression == COMPRESSION_ADOBE_DEFLATE ||
+        nCompression == COMPRESSION_LZW ||
+        nCompression == COMPRESSION_LZMA )
+        TIFFGetField( hTIFF, TIFFTAG_PREDICTOR, &(psCodec->nPredictor) );
+    if( nCompression == COMPRESSION_ADOBE_DEFLATE )
+        TIFFGetField( hTIFF, TIFFTAG_ZIPQUALITY, &(psCodec->nZLevel) );
+    else if( nCompression == COMPRESSION_LZMA )
+        TIFFGetField( hTIFF, TIFFTAG_LZMAPRESET, &(psCodec->nLZMAPreset) );
+    else if( nCompression == COMPRESSION_JPEG )
+    {
+        TIFFGetField( hTIFF, TIFFTAG_JPEGQUALITY, &(psCodec->nJpegQuality) );
+        TIFFGetField( hTIFF, TIFFTAG_JPEGCOLORMODE, &(psCodec->nJpegColorMode) );
+        TIFFGetField( hTIFF, TIFFTAG_JPEGTABLESMODE,
+                      &(psCodec->nJpegTablesMode) );
+        if( nPhotometric == PHOTOMETRIC_YCBCR )
+            TIFFGetFieldDefaulted( hTIFF, TIFFTAG_YCBCRSUBSAMPLING,
+                                   &(psCodec->anYCbCrSubsampling[0]),
+                                   &(psCodec->anYCbCrSubsampling[1]) );
+        if( eAccess == GA_ReadOnly &&
+            !TIFFGetField( hTIFF, TIFFTAG_JPEGTABLES,
+                           &(psCodec->nJPEGTableSize),
+                           &(psCodec->pJPEGTable) ) )
+        {
+            psCodec->nJPEGTableSize = 0;
+            psCodec->pJPEGTable = NULL;
+        }
+    }
+}
+
+/************************************************************************/
+/*                        CreateBlockCodecTIFF()                        */
+/*                                                                      */
+/*      Create a one-block TIFF file in fpTmp with the tags of the      */
+/*      block codec.  For decoding, the session parameters that         */
+/*      only matter to the encoder are not set.                         */
+/************************************************************************/
+
+TIFF* GTiffDataset::CreateBlockCodecTIFF( const char* pszTmpFilename,
+                                          VSILFILE* fpTmp,
+                                          const GTiffBlockCodec* psCodec,
+                                          int bForEncoding )
+{
+    TIFF* hTIFFTmp = VSI_TIFFOpen( pszTmpFilename,
+                                   psCodec->bBigEndian ? "wb" : "wl", fpTmp );
+    if( hTIFFTmp == NULL )
+        return NULL;
+
+    /* The compression is set first, like when libtiff reads back a */
+    /* directory, as some codecs (LZMA) derive their defaults from the */
+    /* other tags at that time. */
+    TIFFSetField( hTIFFTmp, TIFFTAG_COMPRESSION, psCodec->nCompression );
+    TIFFSetField( hTIFFTmp, TIFFTAG_IMAGEWIDTH, psCodec->nWidth );
+    TIFFSetField( hTIFFTmp, TIFFTAG_IMAGELENGTH, psCodec->nHeight );
+    TIFFSetField( hTIFFTmp, TIFFTAG_BITSPERSAMPLE, psCodec->nBitsPerSample );
+    TIFFSetField( hTIFFTmp, TIFFTAG_SAMPLESPERPIXEL, psCodec->nSamplesPerPixel );
+    TIFFSetField( hTIFFTmp, TIFFTAG_SAMPLEFORMAT, psCodec->nSampleFormat );
+    TIFFSetField( hTIFFTmp, TIFFTAG_PLANARCONFIG, psCodec->nPlanarConfig );
+    TIFFSetField( hTIFFTmp, TIFFTAG_PHOTOMETRIC, psCodec->nPhotometric );
+    if( psCodec->bTiled )
+    {
+        TIFFSetField( hTIFFTmp, TIFFTAG_TILEWIDTH, psCodec->nWidth );
+        TIFFSetField( hTIFFTmp, TIFFTAG_TILELENGTH, psCodec->nHeight );
+    }
+    else
+        TIFFSetField( hTIFFTmp, TIFFTAG_ROWSPERSTRIP, psCodec->nHeight );
+    if( psCodec->nPredictor != PREDICTOR_NONE )
+        TIFFSetField( hTIFFTmp, TIFFTAG_PREDICTOR, psCodec->nPredictor );
+    if( psCodec->anYCbCrSubsampling[0] != 0 )
+        TIFFSetField( hTIFFTmp, TIFFTAG_YCBCRSUBSAMPLING,
+                      psCodec->anYCbCrSubsampling[0],
+                      psCodec->anYCbCrSubsampling[1] );
+    if( psCodec->nJPEGTableSize > 0 )
+        TIFFSetField( hTIFFTmp, TIFFTAG_JPEGTABLES,
+                      psCodec->nJPEGTableSize, psCodec->pJPEGTable );
+    if( !bForEncoding )
+        return hTIFFTmp;
+
+    if( psCodec->nZLevel > 0 )
+        TIFFSetField( hTIFFTmp, TIFFTAG_ZIPQUALITY, psCodec->nZLevel );
+    if( psCodec->nLZMAPreset > 0 )
+        TIFFSetField( hTIFFTmp, TIFFTAG_LZMAPRESET, psCodec->nLZMAPreset );
+    if( psCodec->nJpegQuality > 0 )
+        TIFFSetField( hTIFFTmp, TIFFTAG_JPEGQUALITY, psCodec->nJpegQuality );
+    if( psCodec->nJpegColorMode >= 0 )
+        TIFFSetField( hTIFFTmp, TIFFTAG_JPEGCOLORMODE, psCodec->nJpegColorMode );
+    if( psCodec->nJpegTablesMode >= 0 )
+        TIFFSetField( hTIFFTmp, TIFFTAG_JPEGTABLESMODE,
+                      psCodec->nJpegTablesMode );
+
+    return hTIFFTmp;
+}
+
+/************************************************************************/
+/*                        SubmitCompressionJob()                        */
+/************************************************************************/
+
+int GTiffDataset::SubmitCompressionJob( GTiffCompressionJob* psJob,
+                                        int nBlockId, int nHeight )
+{
+    psJob->nBlockId = nBlockId;
+    GetBlockCodec( &(psJob->sCodec), nBlockId, nHeight );
+    psJob->nCompressedSize = 0;
+    psJob->bOK = FALSE;
+
+    nPendingJobs ++;
+
+    if( !CPLSubmitJob( psJob->psGroup, ThreadCompressionFunc, psJob ) )
+        ThreadCompressionFunc( psJob );
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                       ThreadCompressionFunc()                        */
+/************************************************************************/
+
+void GTiffDataset::ThreadCompressionFunc( void* pData )
+{
+    GTiffCompressionJob* psJob = (GTiffCompressionJob*) pData;
+
+    VSILFILE* fpTmp = VSIFOpenL( psJob->osTmpFilename, "w+b" );
+    if( fpTmp == NULL )
+        return;
+
+    TIFF* hTIFFTmp = CreateBlockCodecTIFF( psJob->osTmpFilename, fpTmp,
+                                           &(psJob->sCodec), TRUE );
+    if( hTIFFTmp == NULL )
+    {
+        VSIFCloseL( fpTmp );
+        VSIUnlink( psJob->osTmpFilename );
+        return;
+    }
+
+    int nRet;
+    if( psJob->sCodec.bTiled )
+        nRet = TIFFWriteEncodedTile( hTIFFTmp, psJob->sCodec.nTmpBlockId,
+                                     psJob->pabyBuffer,
+                                     psJob->nBufferDataSize );
+    else
+        nRet = TIFFWriteEncodedStrip( hTIFFTmp, psJob->sCodec.nTmpBlockId,
+                                      psJob->pabyBuffer,
+                                      psJob->nBufferDataSize );
+
+/* -------------------------------------------------------------------- */
+/*      Fetch back the compressed bytes of the block.                   */
+/* -------------------------------------------------------------------- */
+    toff_t *panOffsets = NULL, *panByteCounts = NULL;
+    if( nRet >= 0 &&
+        TIFFGetField( hTIFFTmp, psJob->sCodec.bTiled ? TIFFTAG_TILEOFFSETS :
+                                  TIFFTAG_STRIPOFFSETS, &panOffsets ) &&
+        TIFFGetField( hTIFFTmp, psJob->sCodec.bTiled ? TIFFTAG_TILEBYTECOUNTS :
+                                  TIFFTAG_STRIPBYTECOUNTS, &panByteCounts ) &&
+        panByteCounts[psJob->sCodec.nTmpBlockId] < INT_MAX )
+    {
+        int nSize = (int) panByteCounts[psJob->sCodec.nTmpBlockId];
+        if( nSize > psJob->nCompressedAlloc )
+        {
+            GByte* pabyNew = (GByte*) VSIRealloc(psJob->pabyCompressed, nSize);
+            if( pabyNew != NULL )
+            {
+                psJob->pabyCompressed = pabyNew;
+                psJob->nCompressedAlloc = nSize;
+            }
+        }
+        if( nSize <= psJob->nCompressedAlloc &&
+            VSIFSeekL( fpTmp, panOffsets[psJob->sCodec.nTmpBlockId], SEEK_SET ) == 0 &&
+            (int) VSIFReadL( psJob->pabyCompressed, 1, nSize, fpTmp ) == nSize )
+        {
+            psJob->nCompressedSize = nSize;
+            psJob->bOK = TRUE;
+        }
+    }
+
+    TIFFClose( hTIFFTmp );
+    VSIFCloseL( fpTmp );
+    VSIUnlink( psJob->osTmpFilename );
+}
+
+/************************************************************************/
+/*                        WriteFirstPendingJob()                        */
+/*                                                                      */
+/*      Wait for the oldest pending job and append its compressed       */
+/*      block to the file.                                              */
+/************************************************************************/
+
+CPLErr GTiffDataset::WriteFirstPendingJob()
+{
+    GTiffCompressionJob* psJob = &pasCompressionJobs[iFirstPendingJob];
+
+    CPLWaitJobGroup( psJob->psGroup );
+
+    iFirstPendingJob = (iFirstPendingJob + 1) % nCompressionJobs;
+    nPendingJobs --;
+
+    if( !psJob->bOK )
+    {
+        CPLError( CE_Failure, CPLE_AppDefined,
+                  "Compression of block %d failed.", psJob->nBlockId );
+        bWriteErrorInFlushBlockBuf = TRUE;
+        return CE_Failure;
+    }
+
+    tmsize_t nWritten;
+    if( psJob->sCodec.bTiled )
+        nWritten = TIFFWriteRawTile( hTIFF, psJob->nBlockId,
+                                     psJob->pabyCompressed,
+                                     psJob->nCompressedSize );
+    else
+        nWritten = TIFFWriteRawStrip( hTIFF, psJob->nBlockId,
+                                      psJob->pabyCompressed,
+                                      psJob->nCompressedSize );
+    if( nWritten != psJob->nCompressedSize )
+    {
+        CPLError( CE_Failure, CPLE_AppDefined,
+                  "Writing of block %d failed.", psJob->nBlockId );
+        bWriteErrorInFlushBlockBuf = TRUE;
+        return CE_Failure;
+    }
+
+    return CE_None;
+}
+
+/************************************************************************/
+/*                       WaitCompletionForBlock()                       */
+/*                                                                      */
+/*      Make sure the given block, if being compressed, has been        */
+/*      written to the file, together with all the blocks submitted     */
+/*      before it.                                                      */
+/************************************************************************/
+
+CPLErr GTiffDataset::WaitCompletionForBlock( int nBlockId )
+{
+    for( int i = nPendingJobs - 1; i >= 0; i-- )
+    {
+        if( pasCompressionJobs[(iFirstPendingJob + i) % nCompressionJobs].nBlockId
+                                                                == nBlockId )
+        {
+            CPLErr eErr = CE_None;
+            for( ; i >= 0; i-- )
+            {
+                if( WriteFirstPendingJob() != CE_None )
+                    eErr = CE_Failure;
+            }
+            return eErr;
+        }
+    }
+    return CE_None;
+}
+
+/************************************************************************/
+/*                      WaitCompletionForAllJobs()                      */
+/************************************************************************/
+
+CPLErr GTiffDataset::WaitCompletionForAllJobs()
+{
+    CPLErr eErr = CE_None;
+    while( nPendingJobs > 0 )
+    {
+        if( WriteFirstPendingJob() != CE_None )
+            eErr = CE_Failure;
+    }
+    return eErr;
+}
+
+/************************************************************************/
+/*                       DestroyCompressionJobs()                       */
+/************************************************************************/
+
+void GTiffDataset::DestroyCompressionJobs()
+{
+    if( pasCompressionJobs == NULL )
+        return;
+
+    WaitCompletionForAllJobs();
+
+    for( int i = 0; i < nCompressionJobs; i++ )
+    {
+        CPLDestroyJobGroup( pasCompressionJobs[i].psGroup );
+        VSIFree( pasCompressionJobs[i].pabyBuffer );
+        VSIFree( pasCompressionJobs[i].pabyCompressed );
+    }
+    delete[] pasCompressionJobs;
+    pasCompressionJobs = NULL;
+    nCompressionJobs = 0;
+}
+
+/************************************************************************/
+/*                        CanCacheMultiBlocks()                         */
+/*                                                                      */
+/*      Whether the blocks of this directory can be decoded by          */
+/*      worker threads directly into the block cache of the bands,     */
+/*      in the same layout as IReadBlock() would produce.               */
+/************************************************************************/
+
+int GTiffDataset::CanCacheMultiBlocks()
+{
+    if( nCompressionThreads <= 1 || eAccess != GA_ReadOnly || nBands == 0 )
+        return FALSE;
+
+    if( nCompression != COMPRESSION_ADOBE_DEFLATE &&
+        nCompression != COMPRESSION_LZW &&
+        nCompression != COMPRESSION_PACKBITS &&
+        nCompression != COMPRESSION_LZMA &&
+        nCompression != COMPRESSION_JPEG )
+        return FALSE;
+
+    if( bTreatAsRGBA || bTreatAsSplit || bTreatAsSplitBitmap ||
+        (nPhotometric == PHOTOMETRIC_YCBCR &&
+         nCompression != COMPRESSION_JPEG) )
+        return FALSE;
+
+    /* Excludes the odd bits and the 16/24 bit floating point bands, */
+    /* which are expanded by GTiffOddBitsBand. */
+    if( (nBitsPerSample % 8) != 0 ||
+        GDALGetDataTypeSize(papoBands[0]->GetRasterDataType()) !=
+                                                        nBitsPerSample )
+        return FALSE;
+
+    return strcmp(GetDescription(), "/vsistdin/") != 0;
+}
+
+/************************************************************************/
+/*                     GetMultiBlockStripeHeight()                      */
+/*                                                                      */
+/*      Maximum number of rows, as a multiple of the block height,      */
+/*      whose blocks can be decoded at once by CacheMultiBlocks()       */
+/*      while leaving room in the block cache.  Returns 0 if not even   */
+/*      a row of blocks fits.                                           */
+/************************************************************************/
+
+int GTiffDataset::GetMultiBlockStripeHeight( int nXOff, int nXSize,
+                                             int nBandCount )
+{
+    if( !SetDirectory() )
+        return 0;
+
+    int nBlockBufSize = TIFFIsTiled( hTIFF ) ? (int) TIFFTileSize( hTIFF ) :
+                                               (int) TIFFStripSize( hTIFF );
+    int nXBlocks = (nXOff + nXSize - 1) / nBlockXSize - nXOff / nBlockXSize + 1;
+
+    /* A pixel interleaved block holds all the bands */
+    GIntBig nBlockRowMem = (GIntBig) nXBlocks * nBlockBufSize;
+    if( nPlanarConfig == PLANARCONFIG_SEPARATE )
+        nBlockRowMem *= nBandCount;
+
+    GIntBig nBlockRows = (GDALGetCacheMax64() / 2) / MAX(1, nBlockRowMem);
+    if( nBlockRows > nRasterYSize / nBlockYSize + 1 )
+        nBlockRows = nRasterYSize / nBlockYSize + 1;
+    return (int) nBlockRows * nBlockYSize;
+}
+
+/************************************************************************/
+/*                          CacheMultiBlocks()                          */
+/*                                                                      */
+/*      Load into the block cache the blocks intersecting a window,     */
+/*      that are not already cached.  The compressed bytes of all the   */
+/*      blocks are fetched at once, and each block is then decoded      */
+/*      by a worker thread in a private one-block TIFF file.  Blocks    */
+/*      that fail to decode are left to IReadBlock(), which reports     */
+/*      the errors.                                                     */
+/************************************************************************/
+
+static int GTiffDecompressionJobOffsetCmp( const GTiffDecompressionJob& a,
+                                           const GTiffDecompressionJob& b )
+{
+    return a.nOffset < b.nOffset;
+}
+
+void GTiffDataset::CacheMultiBlocks( int nXOff, int nYOff,
+                                     int nXSize, int nYSize,
+                                     int nBandCount, int *panBandMap )
+{
+    int nBlockX1 = nXOff / nBlockXSize;
+    int nBlockY1 = nYOff / nBlockYSize;
+    int nBlockX2 = (nXOff + nXSize - 1) / nBlockXSize;
+    int nBlockY2 = (nYOff + nYSize - 1) / nBlockYSize;
+
+    if( !SetDirectory() )
+        return;
+
+    int nBlockBufSize = TIFFIsTiled( hTIFF ) ? (int) TIFFTileSize( hTIFF ) :
+                                               (int) TIFFStripSize( hTIFF );
+    if( nBlockBufSize <= 0 )
+        return;
+
+    int nBlocksPerRow = DIV_ROUND_UP(nRasterXSize, nBlockXSize);
+    int nWordBytes = nBitsPerSample / 8;
+
+/* -------------------------------------------------------------------- */
+/*      Collect the blocks that are not in the cache yet.  A pixel      */
+/*      interleaved block is decoded once for all the bands.            */
+/* -------------------------------------------------------------------- */
+    std::vector<GTiffDecompressionJob> asJobs;
+    int nJobBands = (nPlanarConfig == PLANARCONFIG_SEPARATE) ? nBandCount : 1;
+
+    for( int nBlockYOff = nBlockY1; nBlockYOff <= nBlockY2; nBlockYOff++ )
+    {
+        for( int nBlockXOff = nBlockX1; nBlockXOff <= nBlockX2; nBlockXOff++ )
+        {
+            for( int iJobBand = 0; iJobBand < nJobBands; iJobBand++ )
+            {
+                int nFirstBand, nLastBand;
+                if( nPlanarConfig == PLANARCONFIG_SEPARATE )
+                    nFirstBand = nLastBand = panBandMap[iJobBand];
+                else
+                {
+                    nFirstBand = 1;
+                    nLastBand = nBands;
+                }
+
+                int bAllCached = TRUE;
+                for( int iBand = nFirstBand; bAllCached && iBand <= nLastBand;
+                     iBand++ )
+                {
+                    GDALRasterBlock* poBlock =
+                        ((GTiffRasterBand*) papoBands[iBand-1])->
+                            TryGetLockedBlockRef( nBlockXOff, nBlockYOff );
+                    if( poBlock == NULL )
+                        bAllCached = FALSE;
+                    else
+                        poBlock->DropLock();
+                }
+                if( bAllCached )
+                    continue;
+
+                int nBlockId = nBlockXOff + nBlockYOff * nBlocksPerRow;
+                if( nPlanarConfig == PLANARCONFIG_SEPARATE )
+                    nBlockId += (nFirstBand - 1) * nBlocksPerBand;
+
+                vsi_l_offset nOffset = 0, nSize = 0;
+                if( !IsBlockAvailable( nBlockId, &nOffset, &nSize ) ||
+                    nSize > (vsi_l_offset) INT_MAX )
+                    continue;
+
+                GTiffDecompressionJob sJob;
+                sJob.nBlockId = nBlockId;
+                sJob.nBlockXOff = nBlockXOff;
+                sJob.nBlockYOff = nBlockYOff;
+                sJob.nBand = (nPlanarConfig == PLANARCONFIG_SEPARATE) ?
+                                                            nFirstBand : 0;
+                sJob.nOffset = nOffset;
+                sJob.nCompressedSize = (int) nSize;
+                sJob.pabyCompressed = NULL;
+                sJob.pabyDecoded = NULL;
+                sJob.bOK = FALSE;
+
+                /* The bottom most partial blocks are sometimes only */
+                /* partially encoded, as in IReadBlock() (#1179). */
+                sJob.nDecodedSize = nBlockBufSize;
+                if( (int)((nBlockYOff+1) * nBlockYSize) > nRasterYSize )
+                    sJob.nDecodedSize = (nBlockBufSize / nBlockYSize)
+                        * (nBlockYSize - (((nBlockYOff+1) * nBlockYSize) % nRasterYSize));
+
+                asJobs.push_back( sJob );
+            }
+        }
+    }
+
+    /* There is nothing to gain from threads for a single block */
+    if( asJobs.size() < 2 )
         return;
 
 /* -------------------------------------------------------------------- */
-/*      How many blocks are there in this file?                         */
+/*      Fetch the compressed bytes in file order, with a single         */
+/*      request for the file systems that can merge ranges.             */
 /* -------------------------------------------------------------------- */
-    if( nPlanarConfig == PLANARCONFIG_SEPARATE )
-        nBlockCount = nBlocksPerBand * nBands;
-    else
-        nBlockCount = nBlocksPerBand;
+    std::sort( asJobs.begin(), asJobs.end(), GTiffDecompressionJobOffsetCmp );
 
-/* -------------------------------------------------------------------- */
-/*      Fetch block maps.                                               */
-/* -------------------------------------------------------------------- */
-    if( TIFFIsTiled( hTIFF ) )
-        TIFFGetField( hTIFF, TIFFTAG_TILEBYTECOUNTS, &panByteCounts );
-    else
-        TIFFGetField( hTIFF, TIFFTAG_STRIPBYTECOUNTS, &panByteCounts );
+    int nJobs = (int) asJobs.size();
+    std::vector<void*>        apData( nJobs );
+    std::vector<vsi_l_offset> anOffsets( nJobs );
+    std::vector<size_t>       anSizes( nJobs );
+    int bOK = TRUE;
 
-    if (panByteCounts == NULL)
+    for( int i = 0; i < nJobs; i++ )
     {
-        /* Got here with libtiff 3.9.3 and tiff_write_8 test */
-        CPLError(CE_Failure, CPLE_AppDefined, "FillEmptyTiles() failed because panByteCounts == NULL");
-        return;
+        GTiffDecompressionJob& sJob = asJobs[i];
+        sJob.pabyCompressed = (GByte*) VSIMalloc( sJob.nCompressedSize );
+        sJob.pabyDecoded = (GByte*) VSIMalloc( nBlockBufSize );
+        if( sJob.pabyCompressed == NULL || sJob.pabyDecoded == NULL )
+            bOK = FALSE;
+        apData[i] = sJob.pabyCompressed;
+        anOffsets[i] = sJob.nOffset;
+        anSizes[i] = sJob.nCompressedSize;
+    }
+
+    VSILFILE* fp = (VSILFILE*) TIFFClientdata( hTIFF );
+    if( bOK )
+    {
+        vsi_l_offset nCurOffset = VSIFTellL( fp );
+        bOK = VSIFReadMultiRangeL( nJobs, &apData[0], &anOffsets[0],
+                                   &anSizes[0], fp ) == 0;
+        VSIFSeekL( fp, nCurOffset, SEEK_SET );
     }
 
 /* -------------------------------------------------------------------- */
-/*      Prepare a blank data buffer to write for uninitialized blocks.  */
+/*      Decode the blocks in the worker threads.  The thread owning     */
+/*      the dataset takes its share of the jobs while waiting.          */
 /* -------------------------------------------------------------------- */
-    int nBlockBytes;
-
-    if( TIFFIsTiled( hTIFF ) )
-        nBlockBytes = TIFFTileSize(hTIFF);
-    else
-        nBlockBytes = TIFFStripSize(hTIFF);
-
-    GByte *pabyData = (GByte *) VSICalloc(nBlockBytes,1);
-    if (pabyData == NULL)
+    if( bOK )
     {
-        CPLError(CE_Failure, CPLE_OutOfMemory,
-                 "Cannot allocate %d bytes", nBlockBytes);
-        return;
+        CPLJobGroup* psGroup = CPLCreateJobGroup();
+        for( int i = 0; i < nJobs; i++ )
+        {
+            GTiffDecompressionJob& sJob = asJobs[i];
+            sJob.osTmpFilename.Printf( "/vsimem/gtiff/thread/decode/%p",
+                                       &sJob );
+            GetBlockCodec( &(sJob.sCodec), sJob.nBlockId,
+                           TIFFIsTiled( hTIFF ) ? nBlockYSize :
+                           MIN(nBlockYSize,
+                               nRasterYSize - sJob.nBlockYOff * nBlockYSize) );
+            if( !CPLSubmitJob( psGroup, ThreadDecompressionFunc, &sJob ) )
+                ThreadDecompressionFunc( &sJob );
+        }
+        CPLWaitJobGroup( psGroup );
+        CPLDestroyJobGroup( psGroup );
     }
 
 /* -------------------------------------------------------------------- */
-/*      Check all blocks, writing out data for uninitialized blocks.    */
+/*      Push the decoded blocks into the block cache, splitting the     */
+/*      pixel interleaved ones by band.                                 */
 /* -------------------------------------------------------------------- */
-    for( iBlock = 0; iBlock < nBlockCount; iBlock++ )
+    int nBandBlockPixels = nBlockXSize * nBlockYSize;
+    GDALDataType eDT = papoBands[0]->GetRasterDataType();
+
+    for( int i = 0; i < nJobs; i++ )
     {
-        if( panByteCounts[iBlock] == 0 )
+        GTiffDecompressionJob& sJob = asJobs[i];
+        if( bOK && sJob.bOK )
         {
-            if( WriteEncodedTileOrStrip( iBlock, pabyData, FALSE ) != CE_None )
-                break;
+            int nFirstBand = sJob.nBand ? sJob.nBand : 1;
+            int nLastBand = sJob.nBand ? sJob.nBand : nBands;
+            for( int iBand = nFirstBand; iBand <= nLastBand; iBand++ )
+            {
+                GDALRasterBlock* poBlock =
+                    ((GTiffRasterBand*) papoBands[iBand-1])->
+                        TryGetLockedBlockRef( sJob.nBlockXOff, sJob.nBlockYOff );
+                if( poBlock != NULL )
+                {
+                    poBlock->DropLock();
+                    continue;
+                }
+                poBlock = papoBands[iBand-1]->GetLockedBlockRef(
+                    sJob.nBlockXOff, sJob.nBlockYOff, TRUE );
+                if( poBlock == NULL )
+                    continue;
+                if( poBlock->GetDataRef() != NULL )
+                {
+                    if( sJob.nBand )
+                        memcpy( poBlock->GetDataRef(), sJob.pabyDecoded,
+                                nBandBlockPixels * nWordBytes );
+                    else
+                        GDALCopyWords( sJob.pabyDecoded +
+                                            (iBand - 1) * nWordBytes,
+                                       eDT, nBands * nWordBytes,
+                                       poBlock->GetDataRef(), eDT, nWordBytes,
+                                       nBandBlockPixels );
+                }
+                poBlock->DropLock();
+            }
         }
+        VSIFree( sJob.pabyCompressed );
+        VSIFree( sJob.pabyDecoded );
     }
+}
 
-    CPLFree( pabyData );
+/************************************************************************/
+/*                      ThreadDecompressionFunc()                       */
+/************************************************************************/
+
+void GTiffDataset::ThreadDecompressionFunc( void* pData )
+{
+    GTiffDecompressionJob* psJob = (GTiffDecompressionJob*) pData;
+
+    /* Errors are reported by IReadBlock() when it decodes the block again */
+    CPLPushErrorHandler( CPLQuietErrorHandler );
+
+    VSILFILE* fpTmp = VSIFOpenL( psJob->osTmpFilename, "w+b" );
+    if( fpTmp == NULL )
+    {
+        CPLPopErrorHandler();
+        return;
+    }
+
+    TIFF* hTIFFTmp = CreateBlockCodecTIFF( psJob->osTmpFilename, fpTmp,
+                                           &(psJob->sCodec), FALSE );
+    int nRet = -1;
+    if( hTIFFTmp != NULL )
+    {
+        if( psJob->sCodec.bTiled )
+            nRet = TIFFWriteRawTile( hTIFFTmp, psJob->sCodec.nTmpBlockId,
+                                     psJob->pabyCompressed,
+                                     psJob->nCompressedSize );
+        else
+            nRet = TIFFWriteRawStrip( hTIFFTmp, psJob->sCodec.nTmpBlockId,
+                                      psJob->pabyCompressed,
+                                      psJob->nCompressedSize );
+        TIFFClose( hTIFFTmp );
+        hTIFFTmp = NULL;
+    }
+
+    if( nRet == psJob->nCompressedSize )
+        hTIFFTmp = VSI_TIFFOpen( psJob->osTmpFilename, "r", fpTmp );
+    if( hTIFFTmp != NULL )
+    {
+        if( psJob->sCodec.nJpegColorMode == JPEGCOLORMODE_RGB )
+            TIFFSetField( hTIFFTmp, TIFFTAG_JPEGCOLORMODE, JPEGCOLORMODE_RGB );
+
+        int nBlockBufSize = psJob->sCodec.bTiled ?
+            (int) TIFFTileSize( hTIFFTmp ) : (int) TIFFStripSize( hTIFFTmp );
+        if( psJob->nDecodedSize < nBlockBufSize )
+            memset( psJob->pabyDecoded, 0, nBlockBufSize );
+
+        if( psJob->sCodec.bTiled )
+            nRet = TIFFReadEncodedTile( hTIFFTmp, psJob->sCodec.nTmpBlockId,
+                                        psJob->pabyDecoded,
+                                        psJob->nDecodedSize );
+        else
+            nRet = TIFFReadEncodedStrip( hTIFFTmp, psJob->sCodec.nTmpBlockId,
+                                         psJob->pabyDecoded,
+                                         psJob->nDecodedSize );
+        psJob->bOK = ( nRet != -1 );
+        TIFFClose( hTIFFTmp );
+    }
+
+    VSIFCloseL( fpTmp );
+    VSIUnlink( psJob->osTmpFilename );
+    CPLPopErrorHandler();
 }
 
 /************************************************************************/
@@ -4334,6 +5511,8 @@ void GTiffDataset::FillEmptyTiles()
 int GTiffDataset::WriteEncodedTile(uint32 tile, GByte *pabyData,
                                    int bPreserveDataBuffer)
 {
+    FlagLayoutAsEdited();
+
     int cc = TIFFTileSize( hTIFF );
     int bNeedTileFill = FALSE;
     int iRow=0, iColumn=0;
@@ -4367,8 +5546,17 @@ int GTiffDataset::WriteEncodedTile(uint32 tile, GByte *pabyData,
     ** TIFFWriteEncodedTile from altering the buffer as part of
     ** byte swapping the data on write then we will need a temporary
     ** working buffer.  If not, we can just do a direct write. 
+    ** When the tile is compressed by a worker thread, the data is
+    ** copied in the buffer of the job.
     */
-    if (bPreserveDataBuffer 
+    GTiffCompressionJob* psJob = GetCompressionJob( tile, cc );
+    if( psJob != NULL )
+    {
+        memcpy(psJob->pabyBuffer, pabyData, cc);
+
+        pabyData = psJob->pabyBuffer;
+    }
+    else if (bPreserveDataBuffer 
         && (TIFFIsByteSwapped(hTIFF) || bNeedTileFill) )
     {
         if (cc != nTempWriteBufferSize)
@@ -4421,6 +5609,9 @@ int GTiffDataset::WriteEncodedTile(uint32 tile, GByte *pabyData,
         }
     }
 
+    if( psJob != NULL )
+        return SubmitCompressionJob(psJob, tile, nBlockYSize) ? cc : -1;
+
     return TIFFWriteEncodedTile(hTIFF, tile, pabyData, cc);
 }
 
@@ -4431,6 +5622,8 @@ int GTiffDataset::WriteEncodedTile(uint32 tile, GByte *pabyData,
 int  GTiffDataset::WriteEncodedStrip(uint32 strip, GByte* pabyData,
                                      int bPreserveDataBuffer)
 {
+    FlagLayoutAsEdited();
+
     int cc = TIFFStripSize( hTIFF );
     
 /* -------------------------------------------------------------------- */
@@ -4448,6 +5641,20 @@ int  GTiffDataset::WriteEncodedStrip(uint32 strip, GByte* pabyData,
                   (int) TIFFStripSize(hTIFF), cc );
     }
 
+/* -------------------------------------------------------------------- */
+/*      Hand the strip over to a worker thread if possible.             */
+/* -------------------------------------------------------------------- */
+    GTiffCompressionJob* psJob = GetCompressionJob( strip, cc );
+    if( psJob != NULL )
+    {
+        memcpy(psJob->pabyBuffer, pabyData, cc);
+        if( !SubmitCompressionJob(psJob, strip,
+                                  MIN((int)nRowsPerStrip,
+                                      GetRasterYSize() - nStripWithinBand * (int)nRowsPerStrip)) )
+            return -1;
+        return cc;
+    }
+
 /* -------------------------------------------------------------------- */
 /*      TIFFWriteEncodedStrip can alter the passed buffer if            */
 /*      byte-swapping is necessary so we use a temporary buffer         */
@@ -4719,79 +5926,6 @@ void GTiffDataset::Crystalize()
     }
 }
 
-#ifdef INTERNAL_LIBTIFF
-
-#define IO_CACHE_PAGE_SIZE      4096
-
-static
-void GTiffCacheOffsetOrCount4(VSILFILE* fp,
-                              vsi_l_offset nBaseOffset,
-                              int nBlockId,
-                              uint32 nstrips,
-                              uint64* panVals)
-{
-    uint32 val;
-    int i, iStartBefore;
-    vsi_l_offset nOffset, nOffsetStartPage, nOffsetEndPage;
-    GByte buffer[2 * IO_CACHE_PAGE_SIZE];
-
-    nOffset = nBaseOffset + sizeof(val) * nBlockId;
-    nOffsetStartPage = (nOffset / IO_CACHE_PAGE_SIZE) * IO_CACHE_PAGE_SIZE;
-    nOffsetEndPage = nOffsetStartPage + IO_CACHE_PAGE_SIZE;
-
-    if( nOffset + sizeof(val) > nOffsetEndPage )
-        nOffsetEndPage += IO_CACHE_PAGE_SIZE;
-    VSIFSeekL(fp, nOffsetStartPage, SEEK_SET);
-    VSIFReadL(buffer, 1, (size_t)(nOffsetEndPage - nOffsetStartPage), fp);
-    iStartBefore = - (int)((nOffset - nOffsetStartPage) / sizeof(val));
-    if( nBlockId + iStartBefore < 0 )
-        iStartBefore = -nBlockId;
-    for(i=iStartBefore; (uint32)(nBlockId + i) < nstrips &&
-        (GIntBig)nOffset + (i+1) * (int)sizeof(val) <= (GIntBig)nOffsetEndPage; i++)
-    {
-        memcpy(&val,
-            buffer + (nOffset - nOffsetStartPage) + i * sizeof(val),
-            sizeof(val));
-        panVals[nBlockId + i] = val;
-    }
-}
-
-/* Same code as GTiffCacheOffsetOrCount4 except the 'val' declaration */
-static
-void GTiffCacheOffsetOrCount8(VSILFILE* fp,
-                              vsi_l_offset nBaseOffset,
-                              int nBlockId,
-                              uint32 nstrips,
-                              uint64* panVals)
-{
-    uint64 val;
-    int i, iStartBefore;
-    vsi_l_offset nOffset, nOffsetStartPage, nOffsetEndPage;
-    GByte buffer[2 * IO_CACHE_PAGE_SIZE];
-
-    nOffset = nBaseOffset + sizeof(val) * nBlockId;
-    nOffsetStartPage = (nOffset / IO_CACHE_PAGE_SIZE) * IO_CACHE_PAGE_SIZE;
-    nOffsetEndPage = nOffsetStartPage + IO_CACHE_PAGE_SIZE;
-
-    if( nOffset + sizeof(val) > nOffsetEndPage )
-        nOffsetEndPage += IO_CACHE_PAGE_SIZE;
-    VSIFSeekL(fp, nOffsetStartPage, SEEK_SET);
-    VSIFReadL(buffer, 1, (size_t)(nOffsetEndPage - nOffsetStartPage), fp);
-    iStartBefore = - (int)((nOffset - nOffsetStartPage) / sizeof(val));
-    if( nBlockId + iStartBefore < 0 )
-        iStartBefore = -nBlockId;
-    for(i=iStartBefore; (uint32)(nBlockId + i) < nstrips &&
-        (GIntBig)nOffset + (i+1) * (int)sizeof(val) <= (GIntBig)nOffsetEndPage; i++)
-    {
-        memcpy(&val,
-            buffer + (nOffset - nOffsetStartPage) + i * sizeof(val),
-            sizeof(val));
-        panVals[nBlockId + i] = val;
-    }
-}
-
-#endif
-
 /************************************************************************/
 /*                          IsBlockAvailable()                          */
 /*                                                                      */
@@ -4800,107 +5934,47 @@ void GTiffCacheOffsetOrCount8(VSILFILE* fp,
 /*      zero then the block has never been committed to disk.           */
 /************************************************************************/
 
-int GTiffDataset::IsBlockAvailable( int nBlockId )
+int GTiffDataset::IsBlockAvailable( int nBlockId,
+                                    vsi_l_offset* pnOffset,
+                                    vsi_l_offset* pnSize )
 
 {
-#ifdef INTERNAL_LIBTIFF
-
-    /* Optimization to avoid fetching the whole Strip/TileCounts and Strip/TileOffsets arrays */
-    if( eAccess == GA_ReadOnly &&
-        !(hTIFF->tif_flags & TIFF_SWAB) &&
-        hTIFF->tif_dir.td_nstrips > 2 &&
-        (hTIFF->tif_dir.td_stripoffset_entry.tdir_type == TIFF_LONG ||
-         hTIFF->tif_dir.td_stripoffset_entry.tdir_type == TIFF_LONG8) &&
-        (hTIFF->tif_dir.td_stripbytecount_entry.tdir_type == TIFF_LONG ||
-         hTIFF->tif_dir.td_stripbytecount_entry.tdir_type == TIFF_LONG8) &&
-        strcmp(GetDescription(), "/vsistdin/") != 0 )
-    {
-        if( hTIFF->tif_dir.td_stripoffset == NULL )
-        {
-            hTIFF->tif_dir.td_stripoffset =
-                (uint64*) _TIFFmalloc( sizeof(uint64) * hTIFF->tif_dir.td_nstrips );
-            hTIFF->tif_dir.td_stripbytecount =
-                (uint64*) _TIFFmalloc( sizeof(uint64) * hTIFF->tif_dir.td_nstrips );
-            if( hTIFF->tif_dir.td_stripoffset && hTIFF->tif_dir.td_stripbytecount )
-            {
-                memset(hTIFF->tif_dir.td_stripoffset, 0xFF,
-                       sizeof(uint64) * hTIFF->tif_dir.td_nstrips );
-                memset(hTIFF->tif_dir.td_stripbytecount, 0xFF,
-                       sizeof(uint64) * hTIFF->tif_dir.td_nstrips );
-            }
-            else
-            {
-                _TIFFfree(hTIFF->tif_dir.td_stripoffset);
-                hTIFF->tif_dir.td_stripoffset = NULL;
-                _TIFFfree(hTIFF->tif_dir.td_stripbytecount);
-                hTIFF->tif_dir.td_stripbytecount = NULL;
-            }
-        }
-        if( hTIFF->tif_dir.td_stripbytecount == NULL )
-            return FALSE;
-        if( ~(hTIFF->tif_dir.td_stripoffset[nBlockId]) == 0 ||
-            ~(hTIFF->tif_dir.td_stripbytecount[nBlockId]) == 0 )
-        {
-            VSILFILE* fp = (VSILFILE*)hTIFF->tif_clientdata;
-            vsi_l_offset nCurOffset = VSIFTellL(fp);
-            if( ~(hTIFF->tif_dir.td_stripoffset[nBlockId]) == 0 )
-            {
-                if( hTIFF->tif_dir.td_stripoffset_entry.tdir_type == TIFF_LONG )
-                {
-                    GTiffCacheOffsetOrCount4(fp,
-                                             hTIFF->tif_dir.td_stripoffset_entry.tdir_offset.toff_long,
-                                             nBlockId,
-                                             hTIFF->tif_dir.td_nstrips,
-                                             hTIFF->tif_dir.td_stripoffset);
-                }
-                else
-                {
-                    GTiffCacheOffsetOrCount8(fp,
-                                             hTIFF->tif_dir.td_stripoffset_entry.tdir_offset.toff_long8,
-                                             nBlockId,
-                                             hTIFF->tif_dir.td_nstrips,
-                                             hTIFF->tif_dir.td_stripoffset);
-                }
-            }
+    /* A block being compressed is not yet known by libtiff */
+    WaitCompletionForBlock( nBlockId );
 
-            if( ~(hTIFF->tif_dir.td_stripbytecount[nBlockId]) == 0 )
-            {
-                if( hTIFF->tif_dir.td_stripbytecount_entry.tdir_type == TIFF_LONG )
-                {
-                    GTiffCacheOffsetOrCount4(fp,
-                                             hTIFF->tif_dir.td_stripbytecount_entry.tdir_offset.toff_long,
-                                             nBlockId,
-                                             hTIFF->tif_dir.td_nstrips,
-                                             hTIFF->tif_dir.td_stripbytecount);
-                }
-                else
-                {
-                    GTiffCacheOffsetOrCount8(fp,
-                                             hTIFF->tif_dir.td_stripbytecount_entry.tdir_offset.toff_long8,
-                                             nBlockId,
-                                             hTIFF->tif_dir.td_nstrips,
-                                             hTIFF->tif_dir.td_stripbytecount);
-                }
-            }
-            VSIFSeekL(fp, nCurOffset, SEEK_SET);
-        }
-        return hTIFF->tif_dir.td_stripbytecount[nBlockId] != 0;
-    }
-#endif
+#ifdef INTERNAL_LIBTIFF
+    /* When opened with the 'O' flag, libtiff only loads the page of the */
+    /* Strip/TileOffsets and Strip/TileByteCounts arrays holding the block */
+    vsi_l_offset nByteCount = TIFFGetStrileByteCount( hTIFF, nBlockId );
+    if( pnOffset )
+        *pnOffset = TIFFGetStrileOffset( hTIFF, nBlockId );
+    if( pnSize )
+        *pnSize = nByteCount;
+    return nByteCount != 0;
+#else
     toff_t *panByteCounts = NULL;
+    toff_t *panOffsets = NULL;
 
     if( ( TIFFIsTiled( hTIFF ) 
-          && TIFFGetField( hTIFF, TIFFTAG_TILEBYTECOUNTS, &panByteCounts ) )
+          && TIFFGetField( hTIFF, TIFFTAG_TILEBYTECOUNTS, &panByteCounts )
+          && (pnOffset == NULL ||
+              TIFFGetField( hTIFF, TIFFTAG_TILEOFFSETS, &panOffsets )) )
         || ( !TIFFIsTiled( hTIFF ) 
-          && TIFFGetField( hTIFF, TIFFTAG_STRIPBYTECOUNTS, &panByteCounts ) ) )
+          && TIFFGetField( hTIFF, TIFFTAG_STRIPBYTECOUNTS, &panByteCounts )
+          && (pnOffset == NULL ||
+              TIFFGetField( hTIFF, TIFFTAG_STRIPOFFSETS, &panOffsets )) ) )
     {
-        if( panByteCounts == NULL )
+        if( panByteCounts == NULL || (pnOffset != NULL && panOffsets == NULL) )
             return FALSE;
-        else
-            return panByteCounts[nBlockId] != 0;
+        if( pnOffset )
+            *pnOffset = panOffsets[nBlockId];
+        if( pnSize )
+            *pnSize = panByteCounts[nBlockId];
+        return panByteCounts[nBlockId] != 0;
     }
     else
         return FALSE;
+#endif
 }
 
 /************************************************************************/
@@ -4931,6 +6005,127 @@ void GTiffDataset::FlushCache()
     FlushDirectory();
 }
 
+/************************************************************************/
+/*                         FlagLayoutAsEdited()                         */
+/*                                                                      */
+/*      Called before writing blocks or moving a directory. If the      */
+/*      file was written by CreateCopy() with COPY_SRC_OVERVIEWS=YES,   */
+/*      its structural metadata is patched so that readers no longer    */
+/*      rely on the IFDs being before the imagery.                      */
+/************************************************************************/
+
+void GTiffDataset::FlagLayoutAsEdited()
+{
+    GTiffDataset* poRootDS = this;
+    while( poRootDS->poBaseDS != NULL )
+        poRootDS = poRootDS->poBaseDS;
+
+    if( poRootDS->nKnownIncompatibleEditionOffset == 0 )
+        return;
+
+    VSILFILE* fp = (VSILFILE*) TIFFClientdata( hTIFF );
+    if( VSIFSeekL( fp, poRootDS->nKnownIncompatibleEditionOffset,
+                   SEEK_SET ) != 0 ||
+        VSIFWriteL( "YES", 1, 3, fp ) != 3 )
+    {
+        CPLError( CE_Warning, CPLE_FileIO,
+                  "Cannot update the structural metadata of %s",
+                  poRootDS->osFilename.c_str() );
+    }
+    else
+    {
+        CPLDebug( "GTiff", "%s edited: KNOWN_INCOMPATIBLE_EDITION=YES",
+                  poRootDS->osFilename.c_str() );
+    }
+    poRootDS->nKnownIncompatibleEditionOffset = 0;
+}
+
+/************************************************************************/
+/*                          WriteJPEGTables()                           */
+/*                                                                      */
+/*      Set the JPEGTables (and for YCbCr, ReferenceBlackWhite) tags    */
+/*      of the current directory before any block is written.           */
+/*      Otherwise libtiff adds them when encoding the first block, and  */
+/*      the directory is then rewritten at the end of the file, after   */
+/*      the imagery.                                                    */
+/************************************************************************/
+
+void GTiffDataset::WriteJPEGTables( TIFF* hTIFF )
+{
+    GTiffBlockCodec sCodec;
+
+    memset( &sCodec, 0, sizeof(sCodec) );
+    sCodec.bTiled = TRUE;
+    sCodec.bBigEndian = TIFFIsBigEndian( hTIFF );
+    sCodec.nWidth = 16;
+    sCodec.nHeight = 16;
+    sCodec.nCompression = COMPRESSION_JPEG;
+    TIFFGetFieldDefaulted( hTIFF, TIFFTAG_PLANARCONFIG,
+                           &(sCodec.nPlanarConfig) );
+    TIFFGetFieldDefaulted( hTIFF, TIFFTAG_SAMPLESPERPIXEL,
+                           &(sCodec.nSamplesPerPixel) );
+    TIFFGetFieldDefaulted( hTIFF, TIFFTAG_BITSPERSAMPLE,
+                           &(sCodec.nBitsPerSample) );
+    TIFFGetFieldDefaulted( hTIFF, TIFFTAG_SAMPLEFORMAT,
+                           &(sCodec.nSampleFormat) );
+    if( !TIFFGetField( hTIFF, TIFFTAG_PHOTOMETRIC, &(sCodec.nPhotometric) ) )
+        sCodec.nPhotometric = PHOTOMETRIC_MINISBLACK;
+    sCodec.nPredictor = PREDICTOR_NONE;
+    if( sCodec.nPhotometric == PHOTOMETRIC_YCBCR )
+        TIFFGetFieldDefaulted( hTIFF, TIFFTAG_YCBCRSUBSAMPLING,
+                               &(sCodec.anYCbCrSubsampling[0]),
+                               &(sCodec.anYCbCrSubsampling[1]) );
+    sCodec.nZLevel = -1;
+    sCodec.nLZMAPreset = -1;
+    TIFFGetField( hTIFF, TIFFTAG_JPEGQUALITY, &(sCodec.nJpegQuality) );
+    TIFFGetField( hTIFF, TIFFTAG_JPEGCOLORMODE, &(sCodec.nJpegColorMode) );
+    TIFFGetField( hTIFF, TIFFTAG_JPEGTABLESMODE, &(sCodec.nJpegTablesMode) );
+    if( sCodec.nJpegTablesMode == 0 )
+        return;
+
+/* -------------------------------------------------------------------- */
+/*      Encode an empty block in a scratch file, and fetch back the     */
+/*      tables libtiff has computed for it.                             */
+/* -------------------------------------------------------------------- */
+    CPLString osTmpFilename;
+    osTmpFilename.Printf( "/vsimem/gtiff/jpegtables_%p.tif", hTIFF );
+
+    VSILFILE* fpTmp = VSIFOpenL( osTmpFilename, "w+b" );
+    if( fpTmp == NULL )
+        return;
+
+    TIFF* hTIFFTmp = CreateBlockCodecTIFF( osTmpFilename, fpTmp,
+                                           &sCodec, TRUE );
+    if( hTIFFTmp != NULL )
+    {
+        int nBlockSize = TIFFTileSize( hTIFFTmp );
+        GByte* pabyZeros = (GByte*) CPLCalloc( nBlockSize, 1 );
+        uint32 nJPEGTableSize = 0;
+        void* pJPEGTable = NULL;
+        float* pafRefBW = NULL;
+
+        if( TIFFWriteEncodedTile( hTIFFTmp, 0, pabyZeros, nBlockSize ) >= 0 &&
+            TIFFGetField( hTIFFTmp, TIFFTAG_JPEGTABLES,
+                          &nJPEGTableSize, &pJPEGTable ) &&
+            nJPEGTableSize > 0 )
+        {
+            TIFFSetField( hTIFF, TIFFTAG_JPEGTABLES,
+                          nJPEGTableSize, pJPEGTable );
+            if( sCodec.nPhotometric == PHOTOMETRIC_YCBCR &&
+                !TIFFGetField( hTIFF, TIFFTAG_REFERENCEBLACKWHITE,
+                               &pafRefBW ) &&
+                TIFFGetField( hTIFFTmp, TIFFTAG_REFERENCEBLACKWHITE,
+                              &pafRefBW ) )
+                TIFFSetField( hTIFF, TIFFTAG_REFERENCEBLACKWHITE, pafRefBW );
+        }
+        CPLFree( pabyZeros );
+        XTIFFClose( hTIFFTmp );
+    }
+
+    VSIFCloseL( fpTmp );
+    VSIUnlink( osTmpFilename );
+}
+
 /************************************************************************/
 /*                           FlushDirectory()                           */
 /************************************************************************/
@@ -4940,6 +6135,10 @@ void GTiffDataset::FlushDirectory()
 {
     if( GetAccess() == GA_Update )
     {
+        /* Blocks being compressed must be written while this is still */
+        /* the current directory. */
+        WaitCompletionForAllJobs();
+
         if( bMetadataChanged )
         {
             if (!SetDirectory())
@@ -4959,6 +6158,9 @@ void GTiffDataset::FlushDirectory()
 
         if( bNeedsRewrite )
         {
+            /* The directory is going to be moved at the end of the file */
+            FlagLayoutAsEdited();
+
 #if defined(TIFFLIB_VERSION)
 #if defined(HAVE_TIFFGETSIZEPROC)
             if (!SetDirectory())
@@ -5001,6 +6203,7 @@ void GTiffDataset::FlushDirectory()
         if( nDirOffset != TIFFCurrentDirOffset( hTIFF ) )
         {
             nDirOffset = nNewDirOffset;
+            FlagLayoutAsEdited();
             CPLDebug( "GTiff", 
                       "directory moved during flush in FlushDirectory()" );
         }
@@ -5124,6 +6327,7 @@ CPLErr GTiffDataset::RegisterNewOverviewDataset(toff_t nOverviewOffset)
 {
     GTiffDataset* poODS = new GTiffDataset();
     poODS->nJpegQuality = nJpegQuality;
+    poODS->nCompressionThreads = nCompressionThreads;
     poODS->nZLevel = nZLevel;
     poODS->nLZMAPreset = nLZMAPreset;
 
@@ -5151,6 +6355,7 @@ CPLErr GTiffDataset::RegisterNewOverviewDataset(toff_t nOverviewOffset)
                         nOverviewCount * (sizeof(void*)));
         papoOverviewDS[nOverviewCount-1] = poODS;
         poODS->poBaseDS = this;
+        poODS->SetBlockIOParent( this );
         return CE_None;
     }
 }
@@ -5279,6 +6484,18 @@ CPLErr GTiffDataset::CreateOverviewsFromSrcOverviews(GDALDataset* poSrcDS)
             eErr = CE_Failure;
         else
             eErr = RegisterNewOverviewDataset(nOverviewOffset);
+
+        /* Rewrite the directory with its JPEG tables while it is still */
+        /* before the imagery */
+        if( eErr == CE_None && nCompression == COMPRESSION_JPEG )
+        {
+            GTiffDataset* poODS = papoOverviewDS[nOverviewCount-1];
+            if( poODS->SetDirectory() )
+            {
+                WriteJPEGTables( hTIFF );
+                poODS->FlushDirectory();
+            }
+        }
     }
 
     CPLFree(panExtraSampleValues);
@@ -5346,6 +6563,7 @@ CPLErr GTiffDataset::CreateInternalMaskOverviews(int nOvrBlockXSize,
                 }
 
                 poODS = new GTiffDataset();
+                poODS->nCompressionThreads = nCompressionThreads;
                 if( poODS->OpenOffset( hTIFF, ppoActiveDSRef,
                                        nOverviewOffset, FALSE,
                                        GA_Update ) != CE_None )
@@ -5357,6 +6575,7 @@ CPLErr GTiffDataset::CreateInternalMaskOverviews(int nOvrBlockXSize,
                 {
                     poODS->bPromoteTo8Bits = CSLTestBoolean(CPLGetConfigOption("GDAL_TIFF_INTERNAL_MASK_TO_8BIT", "YES"));
                     poODS->poBaseDS = this;
+                    poODS->SetBlockIOParent( this );
                     papoOverviewDS[i]->poMaskDS = poODS;
                     poMaskDS->nOverviewCount++;
                     poMaskDS->papoOverviewDS = (GTiffDataset **)
@@ -5703,8 +6922,15 @@ CPLErr GTiffDataset::IBuildOverviews(
 /* -------------------------------------------------------------------- */
 /*      Refresh old overviews that were listed.                         */
 /* -------------------------------------------------------------------- */
-    if (nCompression != COMPRESSION_NONE &&
-        nPlanarConfig == PLANARCONFIG_CONTIG &&
+
+    /* Without mask, the levels of the resamplings that cascade anyway */
+    /* are all computed in a single pass over the base bands. */
+    int bSinglePass = nOverviews > 1 && !EQUALN(pszResampling, "NEAR", 4) &&
+        (GetRasterBand( panBandList[0] )->GetMaskFlags() & GMF_ALL_VALID) != 0 &&
+        CSLTestBoolean(CPLGetConfigOption("GDAL_OVR_SINGLE_PASS", "YES"));
+
+    if (((nCompression != COMPRESSION_NONE &&
+          nPlanarConfig == PLANARCONFIG_CONTIG) || bSinglePass) &&
         GDALDataTypeIsComplex(GetRasterBand( panBandList[0] )->GetRasterDataType()) == FALSE &&
         GetRasterBand( panBandList[0] )->GetColorTable() == NULL &&
         (EQUALN(pszResampling, "NEAR", 4) || EQUAL(pszResampling, "AVERAGE") ||
@@ -6785,6 +8011,63 @@ int GTiffDataset::Identify( GDALOpenInfo * poOpenInfo )
     return TRUE;
 }
 
+/************************************************************************/
+/*                    GTiffGetStructuralMetadata()                      */
+/*                                                                      */
+/*      Parse the structural metadata that CreateCopy() writes right    */
+/*      after the TIFF header with COPY_SRC_OVERVIEWS=YES. Returns      */
+/*      TRUE if the file still has its IFDs before the imagery.         */
+/************************************************************************/
+
+static int GTiffGetStructuralMetadata( GDALOpenInfo* poOpenInfo,
+                                       vsi_l_offset* pnHeaderSize,
+                                       vsi_l_offset* pnKnownIncompatibleEditionOffset )
+{
+    static const char szPrefix[] = "GDAL_STRUCTURAL_METADATA_SIZE=";
+    const char* pszHeader = (const char*) poOpenInfo->pabyHeader;
+    int nOffset = 8;
+    if( pszHeader != NULL && poOpenInfo->nHeaderBytes >= 4 &&
+        (pszHeader[2] == 0x2B || pszHeader[3] == 0x2B) )
+        nOffset = 16;
+
+    *pnHeaderSize = 0;
+    *pnKnownIncompatibleEditionOffset = 0;
+
+    if( pszHeader == NULL ||
+        poOpenInfo->nHeaderBytes < nOffset + (int)strlen(szPrefix) + 6 ||
+        !EQUALN(pszHeader + nOffset, szPrefix, strlen(szPrefix)) )
+        return FALSE;
+
+    int nSize = atoi(pszHeader + nOffset + strlen(szPrefix));
+    const char* pszEOL = (const char*) memchr( pszHeader + nOffset, '\n',
+                                    poOpenInfo->nHeaderBytes - nOffset );
+    if( pszEOL == NULL || nSize <= 0 ||
+        nSize > poOpenInfo->nHeaderBytes - (int)(pszEOL + 1 - pszHeader) )
+        return FALSE;
+
+    CPLString osBody;
+    osBody.assign( pszEOL + 1, nSize );
+    char** papszMD = CSLTokenizeString2( osBody, "\n", 0 );
+    const char* pszLayout = CSLFetchNameValue( papszMD, "LAYOUT" );
+    const char* pszHeaderSize = CSLFetchNameValue( papszMD, "HEADER_SIZE" );
+    const char* pszEdition =
+        CSLFetchNameValue( papszMD, "KNOWN_INCOMPATIBLE_EDITION" );
+    int bRet = pszLayout != NULL && EQUAL(pszLayout, "IFDS_BEFORE_DATA") &&
+               pszEdition != NULL && EQUALN(pszEdition, "NO", 2);
+    if( bRet )
+    {
+        if( pszHeaderSize != NULL )
+            *pnHeaderSize = CPLScanUIntBig( pszHeaderSize,
+                                            (int)strlen(pszHeaderSize) );
+        *pnKnownIncompatibleEditionOffset = (pszEOL + 1 - pszHeader) +
+            osBody.find("KNOWN_INCOMPATIBLE_EDITION=") +
+            strlen("KNOWN_INCOMPATIBLE_EDITION=");
+    }
+    CSLDestroy( papszMD );
+
+    return bRet;
+}
+
 /************************************************************************/
 /*                            GTIFFErrorHandler()                       */
 /************************************************************************/
@@ -6853,10 +8136,29 @@ GDALDataset *GTiffDataset::Open( GDALOpenInfo * poOpenInfo )
             return NULL;
     }
     
+/* -------------------------------------------------------------------- */
+/*      Check whether the IFDs are known to be before the imagery.      */
+/* -------------------------------------------------------------------- */
+    vsi_l_offset nHeaderSize = 0, nKnownIncompatibleEditionOffset = 0;
+    int bLayoutIFDsBeforeData =
+        GTiffGetStructuralMetadata( poOpenInfo, &nHeaderSize,
+                                    &nKnownIncompatibleEditionOffset );
+
+    /* In read-only mode, let libtiff load the Strip/TileOffsets and */
+    /* Strip/TileByteCounts arrays on demand ('O' flag), except on */
+    /* /vsistdin/ where seeking backward is not possible. */
+    CPLString osOpenMode;
+    if( poOpenInfo->eAccess == GA_Update )
+        osOpenMode = "r+";
+    else if( strcmp(pszFilename, "/vsistdin/") == 0 )
+        osOpenMode = "r";
+    else
+        osOpenMode = "rO";
+
     /* Store errors/warnings and emit them later */
     std::vector<GTIFFErrorStruct> aoErrors;
     CPLPushErrorHandlerEx(GTIFFErrorHandler, &aoErrors);
-    hTIFF = VSI_TIFFOpen( pszFilename, ( poOpenInfo->eAccess == GA_ReadOnly ) ? "rc" : "r+c",
+    hTIFF = VSI_TIFFOpen( pszFilename, (osOpenMode + "c").c_str(),
                           poOpenInfo->fpL );
     CPLPopErrorHandler();
 #if SIZEOF_VOIDP == 4
@@ -6865,8 +8167,7 @@ GDALDataset *GTiffDataset::Open( GDALOpenInfo * poOpenInfo )
         /* Case of one-strip file where the strip size is > 2GB (#5403) */
         if( bGlobalStripIntegerOverflow )
         {
-            hTIFF = VSI_TIFFOpen( pszFilename, ( poOpenInfo->eAccess == GA_ReadOnly ) ? "r" : "r+",
-                                  poOpenInfo->fpL );
+            hTIFF = VSI_TIFFOpen( pszFilename, osOpenMode, poOpenInfo->fpL );
             bGlobalStripIntegerOverflow = FALSE;
         }
     }
@@ -6953,8 +8254,7 @@ GDALDataset *GTiffDataset::Open( GDALOpenInfo * poOpenInfo )
         {
             CPLDebug("GTiff", "Reopen with strip chop enabled");
             XTIFFClose(hTIFF);
-            hTIFF = VSI_TIFFOpen( pszFilename, ( poOpenInfo->eAccess == GA_ReadOnly ) ? "r" : "r+",
-                                  poOpenInfo->fpL );
+            hTIFF = VSI_TIFFOpen( pszFilename, osOpenMode, poOpenInfo->fpL );
             if( hTIFF == NULL )
                 return( NULL );
         }
@@ -6971,6 +8271,8 @@ GDALDataset *GTiffDataset::Open( GDALOpenInfo * poOpenInfo )
     poDS->poActiveDS = poDS;
     poDS->fpL = poOpenInfo->fpL;
     poOpenInfo->fpL = NULL;
+    poDS->nCompressionThreads =
+        GTiffGetNumThreads( poOpenInfo->papszOpenOptions );
 
     if( poDS->OpenOffset( hTIFF, &(poDS->poActiveDS),
                           TIFFCurrentDirOffset(hTIFF), TRUE,
@@ -7011,6 +8313,15 @@ GDALDataset *GTiffDataset::Open( GDALOpenInfo * poOpenInfo )
             poBand->eBandInterp = ePAMColorInterp;
     }
 
+    if( bLayoutIFDsBeforeData )
+    {
+        poDS->oGTiffMDMD.SetMetadataItem( "LAYOUT", "IFDS_BEFORE_DATA",
+                                          "IMAGE_STRUCTURE" );
+        if( poOpenInfo->eAccess == GA_Update )
+            poDS->nKnownIncompatibleEditionOffset =
+                nKnownIncompatibleEditionOffset;
+    }
+
     poDS->bColorProfileMetadataChanged = FALSE;
     poDS->bMetadataChanged = FALSE;
     poDS->bGeoTIFFInfoChanged = FALSE;
@@ -7355,7 +8666,7 @@ GDALDataset *GTiffDataset::OpenDir( GDALOpenInfo * poOpenInfo )
     VSILFILE* fpL = VSIFOpenL(pszFilename, "r");
     if( fpL == NULL )
         return NULL;
-    hTIFF = VSI_TIFFOpen( pszFilename, "r", fpL );
+    hTIFF = VSI_TIFFOpen( pszFilename, "rO", fpL );
     if( hTIFF == NULL )
     {
         VSIFCloseL(fpL);
@@ -8587,6 +9898,7 @@ void GTiffDataset::ScanDirectories()
             GTiffDataset	*poODS;
                 
             poODS = new GTiffDataset();
+            poODS->nCompressionThreads = nCompressionThreads;
             if( poODS->OpenOffset( hTIFF, ppoActiveDSRef, nThisDir, FALSE, 
                                    eAccess ) != CE_None 
                 || poODS->GetRasterCount() != GetRasterCount() )
@@ -8603,6 +9915,7 @@ void GTiffDataset::ScanDirectories()
                                nOverviewCount * (sizeof(void*)));
                 papoOverviewDS[nOverviewCount-1] = poODS;
                 poODS->poBaseDS = this;
+                poODS->SetBlockIOParent( this );
             }
         }
             
@@ -8612,6 +9925,7 @@ void GTiffDataset::ScanDirectories()
                  poMaskDS == NULL )
         {
             poMaskDS = new GTiffDataset();
+            poMaskDS->nCompressionThreads = nCompressionThreads;
                 
             /* The TIFF6 specification - page 37 - only allows 1 SamplesPerPixel and 1 BitsPerSample
                Here we support either 1 or 8 bit per sample
@@ -8637,6 +9951,7 @@ void GTiffDataset::ScanDirectories()
             {
                 CPLDebug( "GTiff", "Opened band mask.\n");
                 poMaskDS->poBaseDS = this;
+                poMaskDS->SetBlockIOParent( this );
                     
                 poMaskDS->bPromoteTo8Bits = CSLTestBoolean(CPLGetConfigOption("GDAL_TIFF_INTERNAL_MASK_TO_8BIT", "YES"));
             }
@@ -8670,6 +9985,7 @@ void GTiffDataset::ScanDirectories()
                         ((GTiffDataset*)papoOverviewDS[i])->poMaskDS = poDS;
                         poDS->bPromoteTo8Bits = CSLTestBoolean(CPLGetConfigOption("GDAL_TIFF_INTERNAL_MASK_TO_8BIT", "YES"));
                         poDS->poBaseDS = this;
+                        poDS->SetBlockIOParent( this );
                         break;
                     }
                 }
@@ -9511,6 +10827,7 @@ GDALDataset *GTiffDataset::Create( const char * pszFilename,
     poDS->nZLevel = GTiffGetZLevel(papszParmList);
     poDS->nLZMAPreset = GTiffGetLZMAPreset(papszParmList);
     poDS->nJpegQuality = GTiffGetJpegQuality(papszParmList);
+    poDS->nCompressionThreads = GTiffGetNumThreads(papszParmList);
 
 #if !defined(BIGTIFF_SUPPORT)
 /* -------------------------------------------------------------------- */
@@ -9717,9 +11034,10 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
     }
 
     int nSrcOverviews = poSrcDS->GetRasterBand(1)->GetOverviewCount();
+    int bCopySrcOverviews =
+        CSLFetchBoolean(papszOptions, "COPY_SRC_OVERVIEWS", FALSE);
     double dfExtraSpaceForOverviews = 0;
-    if (nSrcOverviews != 0 &&
-        CSLFetchBoolean(papszOptions, "COPY_SRC_OVERVIEWS", FALSE))
+    if (nSrcOverviews != 0 && bCopySrcOverviews)
     {
         for(int j=1;j<=nBands;j++)
         {
@@ -9808,6 +11126,64 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
     if( hTIFF == NULL )
         return NULL;
 
+/* -------------------------------------------------------------------- */
+/*      When copying the source overviews, the file is laid out for     */
+/*      range requests: the IFDs and their offset arrays first, then    */
+/*      the imagery from the smallest overview to the full resolution,  */
+/*      each level being written in row-major block order, with its     */
+/*      mask before its imagery. This is advertised in a structural     */
+/*      metadata area, written right after the TIFF header so that      */
+/*      readers find it in the first bytes of the file.                 */
+/* -------------------------------------------------------------------- */
+    vsi_l_offset nHeaderSizeOffset = 0;
+    vsi_l_offset nKnownIncompatibleEditionOffset = 0;
+    if( bCopySrcOverviews )
+    {
+        int nMaskFlags = poSrcDS->GetRasterBand(1)->GetMaskFlags();
+        int bHasMask = !(nMaskFlags & (GMF_ALL_VALID|GMF_ALPHA|GMF_NODATA)) &&
+                       (nMaskFlags & GMF_PER_DATASET) &&
+                       CSLTestBoolean(CPLGetConfigOption(
+                                        "GDAL_TIFF_INTERNAL_MASK", "NO"));
+
+        CPLString osBody;
+        osBody += "LAYOUT=IFDS_BEFORE_DATA\n";
+        osBody += "BLOCK_ORDER=ROW_MAJOR\n";
+        if( bHasMask )
+            osBody += "MASK_BEFORE_IMAGERY=YES\n";
+        size_t nHeaderSizePos = osBody.size() + strlen("HEADER_SIZE=");
+        osBody += "HEADER_SIZE=000000000000000\n";
+        /* The trailing space leaves room for patching the value to YES */
+        size_t nEditionPos =
+            osBody.size() + strlen("KNOWN_INCOMPATIBLE_EDITION=");
+        osBody += "KNOWN_INCOMPATIBLE_EDITION=NO \n";
+
+        CPLString osGhost;
+        osGhost.Printf( "GDAL_STRUCTURAL_METADATA_SIZE=%06d bytes\n",
+                        (int) osBody.size() );
+        nHeaderSizePos += osGhost.size();
+        nEditionPos += osGhost.size();
+        osGhost += osBody;
+
+        if( VSIFSeekL( fpL, 0, SEEK_END ) != 0 )
+            eErr = CE_Failure;
+        vsi_l_offset nGhostOffset = VSIFTellL( fpL );
+        if( eErr == CE_None &&
+            VSIFWriteL( osGhost.c_str(), 1, osGhost.size(), fpL ) !=
+                                                            osGhost.size() )
+            eErr = CE_Failure;
+        if( eErr != CE_None )
+        {
+            CPLError( CE_Failure, CPLE_FileIO,
+                      "Cannot write structural metadata to %s", pszFilename );
+            XTIFFClose( hTIFF );
+            VSIFCloseL( fpL );
+            VSIUnlink( pszFilename );
+            return NULL;
+        }
+        nHeaderSizeOffset = nGhostOffset + nHeaderSizePos;
+        nKnownIncompatibleEditionOffset = nGhostOffset + nEditionPos;
+    }
+
     TIFFGetField( hTIFF, TIFFTAG_PLANARCONFIG, &nPlanarConfig );
     TIFFGetField(hTIFF, TIFFTAG_BITSPERSAMPLE, &nBitsPerSample );
 
@@ -10197,6 +11573,11 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
 /*      Cleanup                                                         */
 /* -------------------------------------------------------------------- */
     
+    /* Make sure the directory stays in front of the imagery */
+    if( bCopySrcOverviews && nCompression == COMPRESSION_JPEG &&
+        !bDontReloadFirstBlock )
+        WriteJPEGTables( hTIFF );
+
     TIFFWriteCheck( hTIFF, TIFFIsTiled(hTIFF), "GTiffCreateCopy()");
     TIFFWriteDirectory( hTIFF );
     TIFFFlush( hTIFF );
@@ -10310,6 +11691,7 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
     poDS->nZLevel = GTiffGetZLevel(papszOptions);
     poDS->nLZMAPreset = GTiffGetLZMAPreset(papszOptions);
     poDS->nJpegQuality = GTiffGetJpegQuality(papszOptions);
+    poDS->nCompressionThreads = GTiffGetNumThreads(papszOptions);
 
     if (nCompression == COMPRESSION_ADOBE_DEFLATE)
     {
@@ -10355,9 +11737,7 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
     double dfTotalPixels = ((double)nXSize) * nYSize;
     double dfCurPixels = 0;
 
-    if (eErr == CE_None &&
-        nSrcOverviews != 0 &&
-        CSLFetchBoolean(papszOptions, "COPY_SRC_OVERVIEWS", FALSE))
+    if (eErr == CE_None && nSrcOverviews != 0 && bCopySrcOverviews)
     {
         eErr = poDS->CreateOverviewsFromSrcOverviews(poSrcDS);
 
@@ -10368,7 +11748,30 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
                      poDS->nOverviewCount, nSrcOverviews);
             eErr = CE_Failure;
         }
+    }
+
+    /* All the IFDs are written: the imagery starts at the end of file */
+    if (eErr == CE_None && nHeaderSizeOffset != 0 && poDS->SetDirectory())
+    {
+        poDS->FlushDirectory();
+
+        VSILFILE* fp = (VSILFILE*) TIFFClientdata( hTIFF );
+        CPLString osHeaderSize;
+        if( VSIFSeekL( fp, 0, SEEK_END ) == 0 )
+        {
+            osHeaderSize.Printf( "%015" CPL_FRMT_GB_WITHOUT_PREFIX "u",
+                                 (GUIntBig) VSIFTellL( fp ) );
+            if( VSIFSeekL( fp, nHeaderSizeOffset, SEEK_SET ) != 0 ||
+                VSIFWriteL( osHeaderSize.c_str(), 1, osHeaderSize.size(),
+                            fp ) != osHeaderSize.size() )
+                eErr = CE_Failure;
+        }
+        else
+            eErr = CE_Failure;
+    }
 
+    if (eErr == CE_None && nSrcOverviews != 0 && bCopySrcOverviews)
+    {
         int i;
         for(i=0;i<nSrcOverviews;i++)
         {
@@ -10386,12 +11789,24 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
             /* Begin with the smallest overview */
             int iOvrLevel = nSrcOverviews-1-i;
             
+            GDALRasterBand* poOvrBand =
+                    poSrcDS->GetRasterBand(1)->GetOverview(iOvrLevel);
+
+            /* Copy mask of the overview */
+            if (poDS->poMaskDS != NULL)
+            {
+                eErr = GDALRasterBandCopyWholeRaster( poOvrBand->GetMaskBand(),
+                                                    poDS->papoOverviewDS[iOvrLevel]->poMaskDS->GetRasterBand(1),
+                                                    papszCopyWholeRasterOptions,
+                                                    GDALDummyProgress, NULL);
+                poDS->papoOverviewDS[iOvrLevel]->poMaskDS->FlushCache();
+                if (eErr != CE_None)
+                    break;
+            }
+
             /* Create a fake dataset with the source overview level so that */
             /* GDALDatasetCopyWholeRaster can cope with it */
             GDALDataset* poSrcOvrDS = GDALCreateOverviewDataset(poSrcDS, iOvrLevel, TRUE, FALSE);
-            
-            GDALRasterBand* poOvrBand =
-                    poSrcDS->GetRasterBand(1)->GetOverview(iOvrLevel);
             double dfNextCurPixels = dfCurPixels +
                     ((double)poOvrBand->GetXSize()) * poOvrBand->GetYSize();
 
@@ -10409,19 +11824,26 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
 
             delete poSrcOvrDS;
             poDS->papoOverviewDS[iOvrLevel]->FlushCache();
-
-            /* Copy mask of the overview */
-            if (eErr == CE_None && poDS->poMaskDS != NULL)
-            {
-                eErr = GDALRasterBandCopyWholeRaster( poOvrBand->GetMaskBand(),
-                                                    poDS->papoOverviewDS[iOvrLevel]->poMaskDS->GetRasterBand(1),
-                                                    papszCopyWholeRasterOptions,
-                                                    GDALDummyProgress, NULL);
-                poDS->papoOverviewDS[iOvrLevel]->poMaskDS->FlushCache();
-            }
         }
     }
 
+/* -------------------------------------------------------------------- */
+/*      With COPY_SRC_OVERVIEWS, the mask goes before the imagery, as   */
+/*      for the overview levels.                                        */
+/* -------------------------------------------------------------------- */
+    int bMaskCopied = FALSE;
+    if (eErr == CE_None && bCopySrcOverviews && poDS->poMaskDS != NULL)
+    {
+        const char* papszMaskOptions[2] = { "COMPRESSED=YES", NULL };
+        eErr = GDALRasterBandCopyWholeRaster(
+                                poSrcDS->GetRasterBand(1)->GetMaskBand(),
+                                poDS->GetRasterBand(1)->GetMaskBand(),
+                                (char**)papszMaskOptions,
+                                GDALDummyProgress, NULL);
+        poDS->poMaskDS->FlushCache();
+        bMaskCopied = TRUE;
+    }
+
 /* -------------------------------------------------------------------- */
 /*      Copy actual imagery.                                            */
 /* -------------------------------------------------------------------- */
@@ -10545,9 +11967,13 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
     }
     else if (bTryCopy && eErr == CE_None)
     {
-        char* papszCopyWholeRasterOptions[2] = { NULL, NULL };
+        char* papszCopyWholeRasterOptions[3] = { NULL, NULL, NULL };
+        int iOpt = 0;
         if (nCompression != COMPRESSION_NONE)
-            papszCopyWholeRasterOptions[0] = (char*) "COMPRESSED=YES";
+            papszCopyWholeRasterOptions[iOpt++] = (char*) "COMPRESSED=YES";
+        /* Read the source while compressing and writing the previous swath */
+        if( CSLFetchBoolean(papszOptions, "COPY_PIPELINE", FALSE) )
+            papszCopyWholeRasterOptions[iOpt++] = (char*) "PIPELINE=YES";
         eErr = GDALDatasetCopyWholeRaster( (GDALDatasetH) poSrcDS,
                                             (GDALDatasetH) poDS,
                                             papszCopyWholeRasterOptions,
@@ -10556,7 +11982,7 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
     
     GDALDestroyScaledProgress(pScaledData);
 
-    if (eErr == CE_None)
+    if (eErr == CE_None && !bMaskCopied)
     {
         if (poDS->poMaskDS)
         {
@@ -10571,6 +11997,14 @@ GTiffDataset::CreateCopy( const char * pszFilename, GDALDataset *poSrcDS,
             eErr = GDALDriver::DefaultCopyMasks( poSrcDS, poDS, bStrict );
     }
 
+    /* From now on, edits by the caller break the advertised layout */
+    if( eErr == CE_None && nKnownIncompatibleEditionOffset != 0 )
+    {
+        poDS->FlushCache();
+        poDS->nKnownIncompatibleEditionOffset =
+            nKnownIncompatibleEditionOffset;
+    }
+
     if( eErr == CE_Failure )
     {
         delete poDS;
@@ -11250,6 +12684,7 @@ CPLErr GTiffDataset::CreateMaskBand(int nFlags)
             return CE_Failure;
 
         poMaskDS = new GTiffDataset();
+        poMaskDS->nCompressionThreads = nCompressionThreads;
         poMaskDS->bPromoteTo8Bits = CSLTestBoolean(CPLGetConfigOption("GDAL_TIFF_INTERNAL_MASK_TO_8BIT", "YES"));
         if( poMaskDS->OpenOffset( hTIFF, ppoActiveDSRef, nOffset, 
                                   FALSE, GA_Update ) != CE_None)
@@ -11661,6 +13096,7 @@ void GDALRegister_GTiff()
 "       <Value>ITULAB</Value>"
 "   </Option>"
 "   <Option name='SPARSE_OK' type='boolean' description='Can newly created files have missing blocks?' default='FALSE'/>"
+"   <Option name='NUM_THREADS' type='string' description='Number of worker threads for compression. Can be set to ALL_CPUS. Defaults to the GDAL_NUM_THREADS configuration option, or 1'/>"
 "   <Option name='ALPHA' type='string-select' description='Mark first extrasample as being alpha'>"
 "       <Value>NON-PREMULTIPLIED</Value>"
 "       <Value>PREMULTIPLIED</Value>"
@@ -11692,6 +13128,7 @@ void GDALRegister_GTiff()
 "       <Value>BIG</Value>"
 "   </Option>"
 "   <Option name='COPY_SRC_OVERVIEWS' type='boolean' default='NO' description='Force copy of overviews of source dataset (CreateCopy())'/>"
+"   <Option name='COPY_PIPELINE' type='boolean' default='NO' description='Read the source from a separate thread while writing (CreateCopy())'/>"
 "   <Option name='SOURCE_ICC_PROFILE' type='string' description='ICC profile'/>"
 "   <Option name='SOURCE_PRIMARIES_RED' type='string' description='x,y,1.0 (xyY) red chromaticity'/>"
 "   <Option name='SOURCE_PRIMARIES_GREEN' type='string' description='x,y,1.0 (xyY) green chromaticity'/>"
@@ -11718,6 +13155,10 @@ void GDALRegister_GTiff()
                                    "Float64 CInt16 CInt32 CFloat32 CFloat64" );
         poDriver->SetMetadataItem( GDAL_DMD_CREATIONOPTIONLIST, 
                                    szCreateOptions );
+        poDriver->SetMetadataItem( GDAL_DMD_OPENOPTIONLIST, 
+"<OpenOptionList>"
+"   <Option name='NUM_THREADS' type='string' description='Number of worker threads for decompression of multi-block reads, and for compression in update mode. Can be set to ALL_CPUS. Defaults to the GDAL_NUM_THREADS configuration option, or 1'/>"
+"</OpenOptionList>" );
         poDriver->SetMetadataItem( GDAL_DMD_SUBDATASETS, "YES" );
         poDriver->SetMetadataItem( GDAL_DCAP_VIRTUALIO, "YES" );
 
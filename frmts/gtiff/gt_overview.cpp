@@ -30,6 +30,7 @@
  ****************************************************************************/
 
 #include "gdal_priv.h"
+#include "cpl_multiproc.h"
 #define CPL_SERV_H_INCLUDED
 
 #include "tifvsi.h"
@@ -711,8 +712,20 @@ GTIFFBuildOverviews( const char * pszFilename,
 /*      Loop writing overview data.                                     */
 /* -------------------------------------------------------------------- */
 
-    if (nCompression != COMPRESSION_NONE &&
-        nPlanarConfig == PLANARCONFIG_CONTIG &&
+    /* With several threads, the block by block generation is also the */
+    /* one that parallelizes best, as all bands of a block are computed */
+    /* concurrently. */
+    int bMultiThreaded = CPLGetNumThreadsFromOption(
+        CPLGetConfigOption("GDAL_NUM_THREADS", "1"), 1) > 1;
+
+    /* Without mask, the levels of the resamplings that cascade anyway */
+    /* are all computed in a single pass over the source bands. */
+    int bSinglePass = nOverviews > 1 && !EQUALN(pszResampling, "NEAR", 4) &&
+        (papoBandList[0]->GetMaskFlags() & GMF_ALL_VALID) != 0 &&
+        CSLTestBoolean(CPLGetConfigOption("GDAL_OVR_SINGLE_PASS", "YES"));
+
+    if ((((nCompression != COMPRESSION_NONE || (bMultiThreaded && nBands > 1)) &&
+          nPlanarConfig == PLANARCONFIG_CONTIG) || bSinglePass) &&
         GDALDataTypeIsComplex(papoBandList[0]->GetRasterDataType()) == FALSE &&
         papoBandList[0]->GetColorTable() == NULL &&
         (EQUALN(pszResampling, "NEAR", 4) || EQUAL(pszResampling, "AVERAGE") ||
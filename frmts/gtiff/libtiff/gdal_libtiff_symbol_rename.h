@@ -341,6 +341,7 @@
 #define TIFFFieldWriteCount gdal_TIFFFieldWriteCount
 #define TIFFFileName gdal_TIFFFileName
 #define TIFFFileno gdal_TIFFFileno
+#define _TIFFFillStrile gdal__TIFFFillStrile
 #define _TIFFFillStriles gdal__TIFFFillStriles
 #define TIFFFillStrip gdal_TIFFFillStrip
 #define TIFFFillStripPartial gdal_TIFFFillStripPartial
@@ -368,6 +369,8 @@
 #define TIFFGetReadProc gdal_TIFFGetReadProc
 #define TIFFGetSeekProc gdal_TIFFGetSeekProc
 #define TIFFGetSizeProc gdal_TIFFGetSizeProc
+#define TIFFGetStrileByteCount gdal_TIFFGetStrileByteCount
+#define TIFFGetStrileOffset gdal_TIFFGetStrileOffset
 #define TIFFGetTagListCount gdal_TIFFGetTagListCount
 #define TIFFGetTagListEntry gdal_TIFFGetTagListEntry
 #define TIFFGetUnmapFileProc gdal_TIFFGetUnmapFileProc
@@ -1200,6 +1200,7 @@ TIFFFreeDirectory(TIFF* tif)
 #if defined(DEFER_STRILE_LOAD)
         _TIFFmemset( &(td->td_stripoffset_entry), 0, sizeof(TIFFDirEntry));
         _TIFFmemset( &(td->td_stripbytecount_entry), 0, sizeof(TIFFDirEntry));
+        CleanupField(td_strilepageloaded);
 #endif        
 }
 #undef CleanupField
@@ -101,6 +101,7 @@ typedef struct {
 #if defined(DEFER_STRILE_LOAD)
         TIFFDirEntry td_stripoffset_entry;    /* for deferred loading */
         TIFFDirEntry td_stripbytecount_entry; /* for deferred loading */
+        uint8*  td_strilepageloaded;  /* for on-demand loading, per page */
 #endif
 	uint16  td_nsubifd;
 	uint64* td_subifd;
@@ -259,6 +260,7 @@ extern void _TIFFSetupFields(TIFF* tif, const TIFFFieldArray* infoarray);
 extern void _TIFFPrintFieldInfo(TIFF*, FILE*);
 
 extern int _TIFFFillStriles(TIFF*);        
+extern int _TIFFFillStrile(TIFF*, uint32);
 
 typedef enum {
 	tfiatImage,
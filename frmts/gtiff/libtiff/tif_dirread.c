@@ -5561,12 +5561,23 @@ int _TIFFFillStriles( TIFF *tif )
         register TIFFDirectory *td = &tif->tif_dir;
         int return_value = 1;
 
-        if( td->td_stripoffset != NULL )
+        if( td->td_stripoffset != NULL && td->td_strilepageloaded == NULL )
                 return 1;
 
         if( td->td_stripoffset_entry.tdir_count == 0 )
                 return 0;
 
+        /* Drop the pages loaded on demand so far */
+        if( td->td_strilepageloaded != NULL )
+        {
+                _TIFFfree( td->td_stripoffset );
+                _TIFFfree( td->td_stripbytecount );
+                _TIFFfree( td->td_strilepageloaded );
+                td->td_stripoffset = NULL;
+                td->td_stripbytecount = NULL;
+                td->td_strilepageloaded = NULL;
+        }
+
         if (!TIFFFetchStripThing(tif,&(td->td_stripoffset_entry),
                                  td->td_nstrips,&td->td_stripoffset))
         {
@@ -5602,6 +5613,230 @@ int _TIFFFillStriles( TIFF *tif )
 #endif 
 }
 
+#if defined(DEFER_STRILE_LOAD)
+
+/*
+ * With the 'O' open flag, the strip/tile offsets and bytecounts arrays
+ * are allocated at their full size when first needed, but only the pages
+ * of STRILE_PAGE_SIZE entries holding the requested striles are read
+ * from the file.
+ */
+#define STRILE_PAGE_SIZE 1024
+
+/*
+ * Return the size of the elements of a strile array that can be read
+ * page by page, or 0 if it must be loaded at once.
+ */
+static uint32
+TIFFStrileThingPageTypeSize(TIFF* tif, TIFFDirEntry* dir)
+{
+	uint32 typesize;
+
+	switch (dir->tdir_type) {
+		case TIFF_SHORT:
+			typesize = 2;
+			break;
+		case TIFF_LONG:
+		case TIFF_IFD:
+			typesize = 4;
+			break;
+		case TIFF_LONG8:
+		case TIFF_IFD8:
+			typesize = 8;
+			break;
+		default:
+			return 0;
+	}
+	/* Arrays stored in the directory entry itself are not worth it */
+	if (dir->tdir_count * typesize <= ((tif->tif_flags&TIFF_BIGTIFF) ? 8 : 4))
+		return 0;
+	return typesize;
+}
+
+/*
+ * Read count entries, from first on, of a strile array. Entries beyond
+ * the array end are set to zero, as TIFFFetchStripThing() does.
+ */
+static int
+TIFFFetchStrileThingPage(TIFF* tif, TIFFDirEntry* dir, uint32 typesize,
+			 uint32 first, uint32 count, uint64* dest)
+{
+	static const char module[] = "TIFFFetchStrileThingPage";
+	enum TIFFReadDirEntryErr err;
+	uint64 dataoffset;
+	uint32 avail, i;
+	uint8* data;
+
+	_TIFFmemset(dest, 0, count * sizeof(uint64));
+	if ((uint64) first >= dir->tdir_count)
+		return 1;
+	avail = count;
+	if ((uint64) first + avail > dir->tdir_count)
+		avail = (uint32) (dir->tdir_count - first);
+
+	if (!(tif->tif_flags&TIFF_BIGTIFF)) {
+		uint32 offset = dir->tdir_offset.toff_long;
+		if (tif->tif_flags&TIFF_SWAB)
+			TIFFSwabLong(&offset);
+		dataoffset = offset;
+	} else {
+		dataoffset = dir->tdir_offset.toff_long8;
+		if (tif->tif_flags&TIFF_SWAB)
+			TIFFSwabLong8(&dataoffset);
+	}
+
+	data = (uint8*) _TIFFCheckMalloc(tif, avail, typesize,
+					 "for strile array page");
+	if (data == NULL)
+		return 0;
+	err = TIFFReadDirEntryData(tif, dataoffset + (uint64) first * typesize,
+				   (tmsize_t) avail * typesize, data);
+	if (err != TIFFReadDirEntryErrOk) {
+		const TIFFField* fip = TIFFFieldWithTag(tif, dir->tdir_tag);
+		TIFFReadDirEntryOutputErr(tif, err, module,
+					  fip ? fip->field_name : "unknown tagname", 0);
+		_TIFFfree(data);
+		return 0;
+	}
+	for (i = 0; i < avail; i++) {
+		switch (typesize) {
+			case 2: {
+				uint16 v;
+				_TIFFmemcpy(&v, data + i * 2, 2);
+				if (tif->tif_flags&TIFF_SWAB)
+					TIFFSwabShort(&v);
+				dest[i] = v;
+				break;
+			}
+			case 4: {
+				uint32 v;
+				_TIFFmemcpy(&v, data + i * 4, 4);
+				if (tif->tif_flags&TIFF_SWAB)
+					TIFFSwabLong(&v);
+				dest[i] = v;
+				break;
+			}
+			default: {
+				uint64 v;
+				_TIFFmemcpy(&v, data + i * 8, 8);
+				if (tif->tif_flags&TIFF_SWAB)
+					TIFFSwabLong8(&v);
+				dest[i] = v;
+				break;
+			}
+		}
+	}
+	_TIFFfree(data);
+	return 1;
+}
+
+#endif /* defined(DEFER_STRILE_LOAD) */
+
+/*
+ * Make sure the offset and bytecount of a strile are loaded. Without
+ * the 'O' open flag, this loads the whole arrays, as _TIFFFillStriles().
+ */
+int _TIFFFillStrile( TIFF *tif, uint32 strile )
+{
+#if defined(DEFER_STRILE_LOAD)
+        register TIFFDirectory *td = &tif->tif_dir;
+        uint32 offsettypesize, bytecounttypesize, page, first, count;
+
+        if( !(tif->tif_flags & TIFF_LAZYSTRILELOAD) ||
+            (td->td_stripoffset != NULL && td->td_strilepageloaded == NULL) )
+                return _TIFFFillStriles( tif );
+
+        if( td->td_stripoffset_entry.tdir_count == 0 ||
+            td->td_stripbytecount_entry.tdir_count == 0 )
+                return _TIFFFillStriles( tif );
+
+        offsettypesize =
+            TIFFStrileThingPageTypeSize( tif, &(td->td_stripoffset_entry) );
+        bytecounttypesize =
+            TIFFStrileThingPageTypeSize( tif, &(td->td_stripbytecount_entry) );
+        if( offsettypesize == 0 || bytecounttypesize == 0 ||
+            td->td_nstrips <= STRILE_PAGE_SIZE )
+                return _TIFFFillStriles( tif );
+
+        if( td->td_strilepageloaded == NULL )
+        {
+                uint32 npages = td->td_nstrips / STRILE_PAGE_SIZE + 1;
+
+                td->td_stripoffset = (uint64*)
+                    _TIFFCheckMalloc( tif, td->td_nstrips, sizeof(uint64),
+                                      "for strip/tile offsets array" );
+                td->td_stripbytecount = (uint64*)
+                    _TIFFCheckMalloc( tif, td->td_nstrips, sizeof(uint64),
+                                      "for strip/tile bytecounts array" );
+                td->td_strilepageloaded = (uint8*) _TIFFmalloc( npages );
+                if( td->td_stripoffset == NULL ||
+                    td->td_stripbytecount == NULL ||
+                    td->td_strilepageloaded == NULL )
+                {
+                        _TIFFfree( td->td_stripoffset );
+                        _TIFFfree( td->td_stripbytecount );
+                        _TIFFfree( td->td_strilepageloaded );
+                        td->td_stripoffset = NULL;
+                        td->td_stripbytecount = NULL;
+                        td->td_strilepageloaded = NULL;
+                        return 0;
+                }
+                _TIFFmemset( td->td_strilepageloaded, 0, npages );
+                /* Not known without reading all the offsets */
+                td->td_stripbytecountsorted = 0;
+        }
+
+        if( strile >= td->td_nstrips )
+                return 1;
+        page = strile / STRILE_PAGE_SIZE;
+        if( td->td_strilepageloaded[page] )
+                return 1;
+
+        first = page * STRILE_PAGE_SIZE;
+        count = td->td_nstrips - first;
+        if( count > STRILE_PAGE_SIZE )
+                count = STRILE_PAGE_SIZE;
+        if( !TIFFFetchStrileThingPage( tif, &(td->td_stripoffset_entry),
+                                       offsettypesize, first, count,
+                                       td->td_stripoffset + first ) ||
+            !TIFFFetchStrileThingPage( tif, &(td->td_stripbytecount_entry),
+                                       bytecounttypesize, first, count,
+                                       td->td_stripbytecount + first ) )
+                return 0;
+        td->td_strilepageloaded[page] = 1;
+        return 1;
+#else /* !defined(DEFER_STRILE_LOAD) */
+        (void) strile;
+        return _TIFFFillStriles( tif );
+#endif
+}
+
+/*
+ * Return the file offset of a strip or tile, or 0 if it is not known.
+ */
+uint64 TIFFGetStrileOffset( TIFF *tif, uint32 strile )
+{
+        TIFFDirectory *td = &tif->tif_dir;
+
+        if( !_TIFFFillStrile( tif, strile ) || td->td_stripoffset == NULL ||
+            strile >= td->td_nstrips )
+                return 0;
+        return td->td_stripoffset[strile];
+}
+
+/*
+ * Return the size in bytes of a strip or tile, or 0 if it is not known.
+ */
+uint64 TIFFGetStrileByteCount( TIFF *tif, uint32 strile )
+{
+        TIFFDirectory *td = &tif->tif_dir;
+
+        if( !_TIFFFillStrile( tif, strile ) || td->td_stripbytecount == NULL ||
+            strile >= td->td_nstrips )
+                return 0;
+        return td->td_stripbytecount[strile];
+}
+
 
 /* vim: set ts=8 sts=8 sw=8 noet: */
 /*
@@ -726,7 +726,7 @@ JPEGFixupTagsSubsampling(TIFF* tif)
 	static const char module[] = "JPEGFixupTagsSubsampling";
 	struct JPEGFixupTagsSubsamplingData m;
 
-        _TIFFFillStriles( tif );
+        _TIFFFillStrile( tif, 0 );
         
         if( tif->tif_dir.td_stripbytecount == NULL
             || tif->tif_dir.td_stripoffset == NULL
@@ -1956,7 +1956,7 @@ OJPEGReadBufferFill(OJPEGState* sp)
 			case osibsJpegInterchangeFormat:
 				sp->in_buffer_source=osibsStrile;
 			case osibsStrile:
-				if (!_TIFFFillStriles( sp->tif ) 
+				if (!_TIFFFillStrile( sp->tif, sp->in_buffer_next_strile ) 
 				    || sp->tif->tif_dir.td_stripoffset == NULL
 				    || sp->tif->tif_dir.td_stripbytecount == NULL)
 					return 0;
@@ -181,6 +181,8 @@ TIFFClientOpen(
 	 * 'C' enable strip chopping support when reading
 	 * 'c' disable strip chopping support
 	 * 'h' read TIFF header only, do not load the first IFD
+	 * 'O' load the strip/tile offsets and bytecounts on demand, when
+	 *     reading (only when the library is built with DEFER_STRILE_LOAD)
 	 * '4' ClassicTIFF for creating a file (default)
 	 * '8' BigTIFF for creating a file
 	 *
@@ -260,6 +262,10 @@ TIFFClientOpen(
 			case 'h':
 				tif->tif_flags |= TIFF_HEADERONLY;
 				break;
+			case 'O':
+				if (m == O_RDONLY)
+					tif->tif_flags |= TIFF_LAZYSTRILELOAD;
+				break;
 			case '8':
 				if (m&O_CREAT)
 					tif->tif_flags |= TIFF_BIGTIFF;
@@ -52,7 +52,7 @@ TIFFFillStripPartial( TIFF *tif, int strip, tmsize_t read_ahead, int restart )
         tmsize_t cc, to_read;
         /* tmsize_t bytecountm; */
         
-        if (!_TIFFFillStriles( tif ) || !tif->tif_dir.td_stripbytecount)
+        if (!_TIFFFillStrile( tif, strip ) || !tif->tif_dir.td_stripbytecount)
             return 0;
         
         /*
@@ -204,7 +204,7 @@ TIFFSeek(TIFF* tif, uint32 row, uint16 sample )
          * read it a few lines at a time?
          */
 #if defined(CHUNKY_STRIP_READ_SUPPORT)
-        if (!_TIFFFillStriles( tif ) || !tif->tif_dir.td_stripbytecount)
+        if (!_TIFFFillStrile( tif, strip ) || !tif->tif_dir.td_stripbytecount)
             return 0;
         whole_strip = tif->tif_dir.td_stripbytecount[strip] < 10
                 || isMapped(tif);
@@ -366,7 +366,7 @@ TIFFReadRawStrip1(TIFF* tif, uint32 strip, void* buf, tmsize_t size,
 {
 	TIFFDirectory *td = &tif->tif_dir;
 
-    if (!_TIFFFillStriles( tif ))
+    if (!_TIFFFillStrile( tif, strip ))
         return ((tmsize_t)(-1));
         
 	assert((tif->tif_flags&TIFF_NOREADRAW)==0);
@@ -457,6 +457,8 @@ TIFFReadRawStrip(TIFF* tif, uint32 strip, void* buf, tmsize_t size)
 		    "Compression scheme does not support access to raw uncompressed data");
 		return ((tmsize_t)(-1));
 	}
+	if (!_TIFFFillStrile(tif, strip))
+		return ((tmsize_t)(-1));
 	bytecount = td->td_stripbytecount[strip];
 	if (bytecount <= 0) {
 #if defined(__WIN32__) && (defined(_MSC_VER) || defined(__MINGW32__))
@@ -492,7 +494,7 @@ TIFFFillStrip(TIFF* tif, uint32 strip)
 	static const char module[] = "TIFFFillStrip";
 	TIFFDirectory *td = &tif->tif_dir;
 
-    if (!_TIFFFillStriles( tif ) || !tif->tif_dir.td_stripbytecount)
+    if (!_TIFFFillStrile( tif, strip ) || !tif->tif_dir.td_stripbytecount)
         return 0;
         
 	if ((tif->tif_flags&TIFF_NOREADRAW)==0)
@@ -678,7 +680,7 @@ TIFFReadRawTile1(TIFF* tif, uint32 tile, void* buf, tmsize_t size, const char* m
 {
 	TIFFDirectory *td = &tif->tif_dir;
 
-    if (!_TIFFFillStriles( tif ))
+    if (!_TIFFFillStrile( tif, tile ))
         return ((tmsize_t)(-1));
 
 	assert((tif->tif_flags&TIFF_NOREADRAW)==0);
@@ -773,6 +775,8 @@ TIFFReadRawTile(TIFF* tif, uint32 tile, void* buf, tmsize_t size)
 		"Compression scheme does not support access to raw uncompressed data");
 		return ((tmsize_t)(-1));
 	}
+	if (!_TIFFFillStrile(tif, tile))
+		return ((tmsize_t)(-1));
 	bytecount64 = td->td_stripbytecount[tile];
 	if (size != (tmsize_t)(-1) && (uint64)size < bytecount64)
 		bytecount64 = (uint64)size;
@@ -795,7 +799,7 @@ TIFFFillTile(TIFF* tif, uint32 tile)
 	static const char module[] = "TIFFFillTile";
 	TIFFDirectory *td = &tif->tif_dir;
 
-    if (!_TIFFFillStriles( tif ) || !tif->tif_dir.td_stripbytecount)
+    if (!_TIFFFillStrile( tif, tile ) || !tif->tif_dir.td_stripbytecount)
         return 0;
         
 	if ((tif->tif_flags&TIFF_NOREADRAW)==0)
@@ -954,7 +958,7 @@ TIFFStartStrip(TIFF* tif, uint32 strip)
 {
 	TIFFDirectory *td = &tif->tif_dir;
 
-    if (!_TIFFFillStriles( tif ) || !tif->tif_dir.td_stripbytecount)
+    if (!_TIFFFillStrile( tif, strip ) || !tif->tif_dir.td_stripbytecount)
         return 0;
 
 	if ((tif->tif_flags & TIFF_CODERSETUP) == 0) {
@@ -989,7 +993,7 @@ TIFFStartTile(TIFF* tif, uint32 tile)
 {
 	TIFFDirectory *td = &tif->tif_dir;
 
-    if (!_TIFFFillStriles( tif ) || !tif->tif_dir.td_stripbytecount)
+    if (!_TIFFFillStrile( tif, tile ) || !tif->tif_dir.td_stripbytecount)
         return 0;
 
 	if ((tif->tif_flags & TIFF_CODERSETUP) == 0) {
@@ -150,7 +150,11 @@ TIFFRawStripSize64(TIFF* tif, uint32 strip)
 {
 	static const char module[] = "TIFFRawStripSize64";
 	TIFFDirectory* td = &tif->tif_dir;
-	uint64 bytecount = td->td_stripbytecount[strip];
+	uint64 bytecount;
+
+	if (!_TIFFFillStrile(tif, strip))
+		return ((uint64)(-1));
+	bytecount = td->td_stripbytecount[strip];
 
 	if (bytecount == 0)
 	{
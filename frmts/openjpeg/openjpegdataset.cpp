@@ -380,15 +380,8 @@ int JP2OpenJPEGDataset::GetNumThreads()
     if( nThreads >= 1 )
         return nThreads;
 
-    const char* pszThreads = CPLGetConfigOption("GDAL_NUM_THREADS", "ALL_CPUS");
-    if (EQUAL(pszThreads, "ALL_CPUS"))
-        nThreads = CPLGetNumCPUs();
-    else
-        nThreads = atoi(pszThreads);
-    if (nThreads > 128)
-        nThreads = 128;
-    if (nThreads <= 0)
-        nThreads = 1;
+    nThreads = CPLGetNumThreadsFromOption(
+        CPLGetConfigOption("GDAL_NUM_THREADS", "ALL_CPUS"), 1);
     return nThreads;
 }
 
@@ -491,7 +484,6 @@ int JP2OpenJPEGDataset::PreloadBlocks(JP2OpenJPEGRasterBand* poBand,
         if( nBlocksToLoad > 1 )
         {
             int nThreads = MIN(nBlocksToLoad, nMaxThreads);
-            void** pahThreads = (void**) CPLMalloc( sizeof(void*) * nThreads );
             int i;
 
             CPLDebug("OPENJPEG", "%d blocks to load", nBlocksToLoad);
@@ -521,11 +513,11 @@ int JP2OpenJPEGDataset::PreloadBlocks(JP2OpenJPEGRasterBand* poBand,
                 }
             }
 
+            /* Each job decodes blocks until none is left */
+            CPLJobGroup* psJobGroup = CPLCreateJobGroup();
             for(i=0;i<nThreads;i++)
-                pahThreads[i] = CPLCreateJoinableThread(JP2OpenJPEGReadBlockInThread, &oJob);
-            for(i=0;i<nThreads;i++)
-                CPLJoinThread( pahThreads[i] );
-            CPLFree(pahThreads);
+                CPLSubmitJob(psJobGroup, JP2OpenJPEGReadBlockInThread, &oJob);
+            CPLDestroyJobGroup(psJobGroup);
         }
     }
 
@@ -155,6 +155,9 @@ void RawRasterBand::Initialize()
 
     bDirty = FALSE;
 
+    psVirtualMemIOMapping = NULL;
+    bHasTriedVirtualMemIOMapping = FALSE;
+
 /* -------------------------------------------------------------------- */
 /*      Allocate working scanline.                                      */
 /* -------------------------------------------------------------------- */
@@ -195,6 +198,9 @@ RawRasterBand::~RawRasterBand()
     CSLDestroy( papszCategoryNames );
 
     FlushCache();
+
+    if( psVirtualMemIOMapping != NULL )
+        CPLVirtualMemFree( psVirtualMemIOMapping );
     
     if (bOwnsFP)
     {
@@ -615,6 +621,51 @@ int RawRasterBand::CanUseDirectIO(CPL_UNUSED int nXOff,
         return CSLTestBoolean(pszGDAL_ONE_BIG_READ);
 }
 
+/************************************************************************/
+/*                         CanUseVirtualMemIO()                         */
+/*                                                                      */
+/*      When GDAL_VIRTUAL_MEM_IO is enabled, non-resampled reads of     */
+/*      a natively ordered band stored in a regular file are served     */
+/*      straight from a memory mapping of the file, without going       */
+/*      through the block cache.                                        */
+/************************************************************************/
+
+int RawRasterBand::CanUseVirtualMemIO( GDALRWFlag eRWFlag,
+                                       int nXSize, int nYSize,
+                                       int nBufXSize, int nBufYSize )
+{
+    if( eRWFlag != GF_Read || eAccess != GA_ReadOnly ||
+        nXSize != nBufXSize || nYSize != nBufYSize ||
+        !bIsVSIL || nPixelOffset <= 0 || nLineOffset <= 0 ||
+        (eDataType != GDT_Byte && !bNativeOrder) ||
+        !CSLTestBoolean(CPLGetConfigOption( "GDAL_VIRTUAL_MEM_IO", "NO" )) )
+        return FALSE;
+
+    if( !bHasTriedVirtualMemIOMapping )
+    {
+        bHasTriedVirtualMemIOMapping = TRUE;
+
+        vsi_l_offset nSize = (vsi_l_offset)(nRasterYSize - 1) * nLineOffset +
+            (nRasterXSize - 1) * nPixelOffset + GDALGetDataTypeSize(eDataType) / 8;
+
+        if( CPLIsVirtualMemFileMapAvailable() &&
+            VSIFGetNativeFileDescriptorL(fpRawL) != NULL &&
+            (size_t)nSize == nSize )
+        {
+            /* The mapping fails if the file is truncated, in which case */
+            /* the regular code path reports the read errors. */
+            CPLPushErrorHandler( CPLQuietErrorHandler );
+            psVirtualMemIOMapping = CPLVirtualMemFileMapNew(
+                fpRawL, nImgOffset, nSize, VIRTUALMEM_READONLY, NULL, NULL );
+            CPLPopErrorHandler();
+        }
+        if( psVirtualMemIOMapping == NULL )
+            CPLDebug( "RAW", "Cannot use memory mapping for RasterIO()" );
+    }
+
+    return psVirtualMemIOMapping != NULL;
+}
+
 /************************************************************************/
 /*                             IRasterIO()                              */
 /************************************************************************/
@@ -630,6 +681,24 @@ CPLErr RawRasterBand::IRasterIO( GDALRWFlag eRWFlag,
     int         nBufDataSize = GDALGetDataTypeSize( eBufType ) / 8;
     int         nBytesToRW = nPixelOffset * nXSize;
 
+/* -------------------------------------------------------------------- */
+/*      Copy directly from the memory mapping of the file.              */
+/* -------------------------------------------------------------------- */
+    if( CanUseVirtualMemIO( eRWFlag, nXSize, nYSize, nBufXSize, nBufYSize ) )
+    {
+        GByte* pabyMap = (GByte*) CPLVirtualMemGetAddr( psVirtualMemIOMapping );
+
+        for( int iLine = 0; iLine < nYSize; iLine++ )
+        {
+            GDALCopyWords( pabyMap + (vsi_l_offset)(nYOff + iLine) * nLineOffset
+                                   + (vsi_l_offset)nXOff * nPixelOffset,
+                           eDataType, nPixelOffset,
+                           (GByte *)pData + (vsi_l_offset)iLine * nLineSpace,
+                           eBufType, nPixelSpace, nXSize );
+        }
+        return CE_None;
+    }
+
     if( !CanUseDirectIO(nXOff, nYOff, nXSize, nYSize, eBufType ) )
     {
         return GDALRasterBand::IRasterIO( eRWFlag, nXOff, nYOff,
@@ -1175,7 +1244,9 @@ CPLErr RawDataset::IRasterIO( GDALRWFlag eRWFlag,
         for(iBandIndex = 0; iBandIndex < nBandCount; iBandIndex ++ )
         {
             RawRasterBand* poBand = (RawRasterBand*) GetRasterBand(panBandMap[iBandIndex]);
-            if( !poBand->CanUseDirectIO(nXOff, nYOff, nXSize, nYSize, eBufType ) )
+            if( !poBand->CanUseDirectIO(nXOff, nYOff, nXSize, nYSize, eBufType ) &&
+                !poBand->CanUseVirtualMemIO(eRWFlag, nXSize, nYSize,
+                                            nBufXSize, nBufYSize) )
             {
                 break;
             }
@@ -97,6 +97,9 @@ protected:
     
     int         bOwnsFP;
 
+    CPLVirtualMem *psVirtualMemIOMapping;
+    int         bHasTriedVirtualMemIOMapping;
+
     int         Seek( vsi_l_offset, int );
     size_t      Read( void *, size_t, size_t );
     size_t      Write( void *, size_t, size_t );
@@ -112,6 +115,8 @@ protected:
 
     int         CanUseDirectIO(int nXOff, int nYOff, int nXSize, int nYSize,
                                GDALDataType eBufType);
+    int         CanUseVirtualMemIO(GDALRWFlag eRWFlag, int nXSize, int nYSize,
+                                   int nBufXSize, int nBufYSize);
 
 public:
 
@@ -916,6 +916,14 @@ CPLErr VRTDataset::AddBand( GDALDataType eType, char **papszOptions )
             if (pszFuncName != NULL)
                 poDerivedBand->SetPixelFunctionName(pszFuncName);
 
+            const char* pszExpression =
+                CSLFetchNameValue(papszOptions, "PixelExpression");
+            if (pszExpression != NULL &&
+                poDerivedBand->SetPixelExpression(pszExpression) != CE_None) {
+                delete poDerivedBand;
+                return CE_Failure;
+            }
+
             const char* pszTransferTypeName =
                 CSLFetchNameValue(papszOptions, "SourceTransferType");
             if (pszTransferTypeName != NULL) {
@@ -1308,8 +1316,15 @@ CPLErr VRTDataset::IRasterIO( GDALRWFlag eRWFlag,
         /* Use the last band, because when sources reference a GDALProxyDataset, they */
         /* don't necessary instanciate all underlying rasterbands */
         VRTSourcedRasterBand* poBand = (VRTSourcedRasterBand* )papoBands[nBands - 1];
-        for(int iSource = 0; eErr == CE_None && iSource < poBand->nSources; iSource++)
+        std::vector<int> anSourceIdx;
+        int bUseSourceIdx = poBand->GetSourcesInWindow( nXOff, nYOff,
+                                                        nXSize, nYSize,
+                                                        anSourceIdx );
+        int nSourcesToVisit =
+            bUseSourceIdx ? (int) anSourceIdx.size() : poBand->nSources;
+        for(int i = 0; eErr == CE_None && i < nSourcesToVisit; i++)
         {
+            int iSource = bUseSourceIdx ? anSourceIdx[i] : i;
             VRTSimpleSource* poSource = (VRTSimpleSource* )poBand->papoSources[iSource];
             eErr = poSource->DatasetRasterIO( nXOff, nYOff, nXSize, nYSize,
                                               pData, nBufXSize, nBufYSize,
@@ -35,6 +35,7 @@
 #include "gdal_pam.h"
 #include "gdal_vrt.h"
 #include "cpl_hash_set.h"
+#include "cpl_quad_tree.h"
 
 int VRTApplyMetadata( CPLXMLNode *, GDALMajorObject * );
 CPLXMLNode *VRTSerializeMetadata( GDALMajorObject * );
@@ -365,10 +366,17 @@ class CPL_DLL VRTSourcedRasterBand : public VRTRasterBand
     CPLString      osLastLocationInfo;
     char         **papszSourceList;
 
+    /* Lazily built spatial index of the destination windows of the sources */
+    CPLQuadTree   *hSourceIndex;
+    int            nIndexedSources;
+    std::vector<int> anUnindexedSources;
+
     void           Initialize( int nXSize, int nYSize );
 
     int            CanUseSourcesMinMaxImplementations();
 
+    void           InvalidateSourceIndex();
+
   public:
     int            nSources;
     VRTSource    **papoSources;
@@ -399,6 +407,10 @@ class CPL_DLL VRTSourcedRasterBand : public VRTRasterBand
     virtual CPLErr         XMLInit( CPLXMLNode *, const char * );
     virtual CPLXMLNode *   SerializeToXML( const char *pszVRTPath );
 
+    int            GetSourcesInWindow( int nXOff, int nYOff,
+                                       int nXSize, int nYSize,
+                                       std::vector<int>& anSourceIdx );
+
     virtual double GetMinimum( int *pbSuccess = NULL );
     virtual double GetMaximum(int *pbSuccess = NULL );
     virtual CPLErr ComputeRasterMinMax( int bApproxOK, double* adfMinMax );
@@ -477,12 +489,53 @@ class CPL_DLL VRTWarpedRasterBand : public VRTRasterBand
     virtual GDALRasterBand *GetOverview(int);
 };
 
+/************************************************************************/
+/*                            VRTExpression                             */
+/************************************************************************/
+
+typedef struct
+{
+    int             eOp;
+    int             nSource;    /* 0-based, for source references */
+    double          dfValue;    /* for constants */
+} VRTExprOp;
+
+class CPL_DLL VRTExpression
+{
+    CPLString              osExpression;
+    std::vector<VRTExprOp> aoOps;
+    int                    nMaxDepth;
+    int                    nMaxSource;
+
+  public:
+                   VRTExpression();
+
+    int            Compile( const char *pszExpression );
+
+    const char    *GetExpression() const { return osExpression.c_str(); }
+    int            GetStackDepth() const { return nMaxDepth; }
+    int            GetMaxSourceIndex() const { return nMaxSource; }
+    int            IsSourceReferenced( int iSource ) const;
+
+    const double  *EvaluateRow( const double * const *papadfSources,
+                                int nCount, double dfNoDataValue,
+                                double *padfWork,
+                                const double **papadfStack ) const;
+};
+
 /************************************************************************/
 /*                         VRTDerivedRasterBand                         */
 /************************************************************************/
 
 class CPL_DLL VRTDerivedRasterBand : public VRTSourcedRasterBand
 {
+    VRTExpression *poExpression;
+
+    CPLErr         ExpressionRasterIO( int nXOff, int nYOff,
+                                       int nXSize, int nYSize,
+                                       void *pData, int nBufXSize,
+                                       int nBufYSize, GDALDataType eBufType,
+                                       int nPixelSpace, int nLineSpace );
 
  public:
     char *pszFuncName;
@@ -503,6 +556,7 @@ class CPL_DLL VRTDerivedRasterBand : public VRTSourcedRasterBand
 
     void SetPixelFunctionName(const char *pszFuncName);
     void SetSourceTransferType(GDALDataType eDataType);
+    CPLErr SetPixelExpression(const char *pszExpression);
 
     virtual CPLErr         XMLInit( CPLXMLNode *, const char * );
     virtual CPLXMLNode *   SerializeToXML( const char *pszVRTPath );
@@ -611,6 +665,7 @@ public:
     void           SetSrcMaskBand( GDALRasterBand * );
     void           SetSrcWindow( int, int, int, int );
     void           SetDstWindow( int, int, int, int );
+    int            GetDstWindow( int *, int *, int *, int * );
     void           SetNoDataValue( double dfNoDataValue );
 
     int            GetSrcDstWindow( int, int, int, int, int, int, 
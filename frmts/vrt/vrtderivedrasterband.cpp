@@ -51,6 +51,7 @@ VRTDerivedRasterBand::VRTDerivedRasterBand(GDALDataset *poDS, int nBand)
 {
     this->pszFuncName = NULL;
     this->eSourceTransferType = GDT_Unknown;
+    this->poExpression = NULL;
 }
 
 /************************************************************************/
@@ -65,6 +66,7 @@ VRTDerivedRasterBand::VRTDerivedRasterBand(GDALDataset *poDS, int nBand,
 {
     this->pszFuncName = NULL;
     this->eSourceTransferType = GDT_Unknown;
+    this->poExpression = NULL;
 }
 
 /************************************************************************/
@@ -78,6 +80,7 @@ VRTDerivedRasterBand::~VRTDerivedRasterBand()
         CPLFree(this->pszFuncName);
         this->pszFuncName = NULL;
     }
+    delete poExpression;
 }
 
 /************************************************************************/
@@ -200,6 +203,199 @@ void VRTDerivedRasterBand::SetSourceTransferType(GDALDataType eDataType)
     this->eSourceTransferType = eDataType;
 }
 
+/************************************************************************/
+/*                         SetPixelExpression()                         */
+/************************************************************************/
+
+/**
+ * Set the expression evaluated by this derived band, in place of a
+ * pixel function.
+ *
+ * The sources are referenced as B1, B2, ... in their order in the band.
+ * The expression may use the + - * / arithmetic operators, the == != < <=
+ * > >= comparisons, the && || ! logical operators, the cond ? a : b
+ * conditional, the abs(), sqrt(), floor(), ceil(), exp(), log(), log10(),
+ * pow(), min() and max() functions and the 'nodata' identifier, that
+ * evaluates to the nodata value of the band. Comparisons and logical
+ * operators return 1 or 0.
+ *
+ * Computations are done in double precision, independently of the
+ * source transfer type. When the band has a nodata value, output pixels
+ * for which one of the referenced sources is at nodata, or for which the
+ * expression does not evaluate to a finite number, are set to nodata.
+ *
+ * @param pszExpression the expression, e.g. "(B2-B1)/(B2+B1)", or NULL
+ * to go back to the pixel function.
+ *
+ * @return CE_None on success, or CE_Failure if the expression is invalid.
+ */
+CPLErr VRTDerivedRasterBand::SetPixelExpression(const char *pszExpression)
+{
+    delete poExpression;
+    poExpression = NULL;
+
+    if( pszExpression == NULL )
+        return CE_None;
+
+    poExpression = new VRTExpression();
+    if( !poExpression->Compile( pszExpression ) )
+    {
+        delete poExpression;
+        poExpression = NULL;
+        return CE_Failure;
+    }
+
+    return CE_None;
+}
+
+/************************************************************************/
+/*                         ExpressionRasterIO()                         */
+/*                                                                      */
+/*      Read the referenced sources as Float64 and evaluate the pixel   */
+/*      expression on them, one row of the buffer at a time.           */
+/************************************************************************/
+
+CPLErr VRTDerivedRasterBand::ExpressionRasterIO( int nXOff, int nYOff,
+                                                 int nXSize, int nYSize,
+                                                 void * pData,
+                                                 int nBufXSize, int nBufYSize,
+                                                 GDALDataType eBufType,
+                                                 int nPixelSpace,
+                                                 int nLineSpace )
+{
+    CPLErr eErr = CE_None;
+    int iSource, iLine, i;
+
+/* -------------------------------------------------------------------- */
+/*      Do we have overviews that would be appropriate to satisfy       */
+/*      this request?                                                   */
+/* -------------------------------------------------------------------- */
+    if( (nBufXSize < nXSize || nBufYSize < nYSize)
+        && GetOverviewCount() > 0 )
+    {
+        if( OverviewRasterIO( GF_Read, nXOff, nYOff, nXSize, nYSize, 
+                              pData, nBufXSize, nBufYSize, 
+                              eBufType, nPixelSpace, nLineSpace ) == CE_None )
+            return CE_None;
+    }
+
+    if( poExpression->GetMaxSourceIndex() >= nSources )
+    {
+        CPLError( CE_Failure, CPLE_AppDefined,
+                  "Pixel expression '%s' references B%d, but the band "
+                  "has only %d source(s).",
+                  poExpression->GetExpression(),
+                  poExpression->GetMaxSourceIndex() + 1, nSources );
+        return CE_Failure;
+    }
+
+    const double dfExprNoData = bNoDataValueSet ? dfNoDataValue
+                                                : CPLAtof("nan");
+    const int nDepth = poExpression->GetStackDepth();
+
+    double **papadfSrcBuffers =
+        (double **) CPLCalloc(sizeof(double *), nSources);
+    const double **papadfSrcRows =
+        (const double **) CPLCalloc(sizeof(double *), nSources);
+    const double **papadfStack =
+        (const double **) CPLMalloc(sizeof(double *) * nDepth);
+    double *padfWork = (double *)
+        VSIMalloc3(nDepth + 1, nBufXSize, sizeof(double));
+    double *padfRow = padfWork ? padfWork + (size_t)nDepth * nBufXSize : NULL;
+
+    if( padfWork == NULL )
+    {
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "VRTDerivedRasterBand::IRasterIO: Out of memory." );
+        eErr = CE_Failure;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Load the referenced sources into packed Float64 buffers,        */
+/*      initialized to nodata so that the areas they do not cover       */
+/*      are considered as such.                                         */
+/* -------------------------------------------------------------------- */
+    for( iSource = 0; eErr == CE_None && iSource < nSources; iSource++ )
+    {
+        if( !poExpression->IsSourceReferenced( iSource ) )
+            continue;
+
+        papadfSrcBuffers[iSource] = (double *)
+            VSIMalloc3(nBufXSize, nBufYSize, sizeof(double));
+        if( papadfSrcBuffers[iSource] == NULL )
+        {
+            CPLError( CE_Failure, CPLE_OutOfMemory,
+                      "VRTDerivedRasterBand::IRasterIO: "
+                      "Out of memory allocating %d x %d values.",
+                      nBufXSize, nBufYSize );
+            eErr = CE_Failure;
+            break;
+        }
+
+        double dfInit = bNoDataValueSet ? dfNoDataValue : 0.0;
+        GDALCopyWords( &dfInit, GDT_Float64, 0,
+                       papadfSrcBuffers[iSource], GDT_Float64, sizeof(double),
+                       nBufXSize * nBufYSize );
+
+        eErr = papoSources[iSource]->RasterIO(
+            nXOff, nYOff, nXSize, nYSize,
+            papadfSrcBuffers[iSource], nBufXSize, nBufYSize,
+            GDT_Float64, sizeof(double), sizeof(double) * nBufXSize );
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Evaluate the expression row by row.                             */
+/* -------------------------------------------------------------------- */
+    for( iLine = 0; eErr == CE_None && iLine < nBufYSize; iLine++ )
+    {
+        for( iSource = 0; iSource < nSources; iSource++ )
+        {
+            if( papadfSrcBuffers[iSource] != NULL )
+                papadfSrcRows[iSource] = papadfSrcBuffers[iSource]
+                                        + (size_t)iLine * nBufXSize;
+        }
+
+        const double *padfResult =
+            poExpression->EvaluateRow( papadfSrcRows, nBufXSize,
+                                       dfExprNoData, padfWork, papadfStack );
+
+        /* ---- Nodata propagation ---- */
+        if( bNoDataValueSet )
+        {
+            for( i = 0; i < nBufXSize; i++ )
+                padfRow[i] = CPLIsFinite(padfResult[i]) ? padfResult[i]
+                                                         : dfNoDataValue;
+
+            for( iSource = 0; iSource < nSources; iSource++ )
+            {
+                const double *padfSrc = papadfSrcRows[iSource];
+                if( padfSrc == NULL )
+                    continue;
+                for( i = 0; i < nBufXSize; i++ )
+                {
+                    if( padfSrc[i] == dfNoDataValue || CPLIsNan(padfSrc[i]) )
+                        padfRow[i] = dfNoDataValue;
+                }
+            }
+
+            padfResult = padfRow;
+        }
+
+        GDALCopyWords( (void *) padfResult, GDT_Float64, sizeof(double),
+                       ((GByte *) pData) + (GIntBig)iLine * nLineSpace,
+                       eBufType, nPixelSpace, nBufXSize );
+    }
+
+    for( iSource = 0; iSource < nSources; iSource++ )
+        VSIFree( papadfSrcBuffers[iSource] );
+    CPLFree( papadfSrcBuffers );
+    CPLFree( papadfSrcRows );
+    CPLFree( papadfStack );
+    VSIFree( padfWork );
+
+    return eErr;
+}
+
 /************************************************************************/
 /*                             IRasterIO()                              */
 /************************************************************************/
@@ -276,6 +472,12 @@ CPLErr VRTDerivedRasterBand::IRasterIO(GDALRWFlag eRWFlag,
         return CE_Failure;
     }
 
+    /* ---- Pixel expressions have their own evaluation path ---- */
+    if( poExpression != NULL )
+        return ExpressionRasterIO( nXOff, nYOff, nXSize, nYSize,
+                                   pData, nBufXSize, nBufYSize,
+                                   eBufType, nPixelSpace, nLineSpace );
+
     typesize = GDALGetDataTypeSize(eBufType) / 8;
     if (GDALGetDataTypeSize(eBufType) % 8 > 0) typesize++;
     eSrcType = this->eSourceTransferType;
@@ -417,6 +619,13 @@ CPLErr VRTDerivedRasterBand::XMLInit(CPLXMLNode *psTree,
     this->SetPixelFunctionName
 	(CPLGetXMLValue(psTree, "PixelFunctionType", NULL));
 
+    /* ---- Read optional pixel expression ---- */
+    const char *pszExpression = CPLGetXMLValue(psTree, "PixelExpression", NULL);
+    if (pszExpression != NULL &&
+        this->SetPixelExpression(pszExpression) != CE_None) {
+        return CE_Failure;
+    }
+
     /* ---- Read optional source transfer data type ---- */
     pszTypeName = CPLGetXMLValue(psTree, "SourceTransferType", NULL);
     if (pszTypeName != NULL) {
@@ -446,6 +655,9 @@ CPLXMLNode *VRTDerivedRasterBand::SerializeToXML(const char *pszVRTPath)
     /* ---- Encode DerivedBand-specific fields ---- */
     if( pszFuncName != NULL && strlen(pszFuncName) > 0 )
         CPLSetXMLValue(psTree, "PixelFunctionType", this->pszFuncName);
+    if( poExpression != NULL )
+        CPLSetXMLValue(psTree, "PixelExpression",
+                       poExpression->GetExpression());
     if( this->eSourceTransferType != GDT_Unknown)
         CPLSetXMLValue(psTree, "SourceTransferType", 
 		       GDALGetDataTypeName(this->eSourceTransferType));
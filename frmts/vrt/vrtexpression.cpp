@@ -0,0 +1,921 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  Virtual GDAL Datasets
+ * Purpose:  Implementation of the pixel expressions of derived bands.
+ * Author:   agent <agent at local>
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, agent <agent at local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include "vrtdataset.h"
+#include "cpl_string.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+
+/* We restrict to 64bit processors because they are guaranteed to have SSE2 */
+#if defined(__x86_64) || defined(_M_X64)
+#define HAVE_SSE2_EXPR
+#include <emmintrin.h>
+#endif
+
+CPL_CVSID("$Id$");
+
+/*
+** An expression is compiled once into a postfix program. Evaluation then
+** runs each instruction over a whole row of pixels at a time, so that the
+** cost of interpreting the program is amortized over the row, and the
+** inner loops are simple enough to be done with SSE2 for the arithmetic,
+** comparison and logical operators.
+*/
+
+typedef enum
+{
+    VRT_EXPR_CONSTANT,
+    VRT_EXPR_SOURCE,
+    VRT_EXPR_NODATA,
+    /* unary */
+    VRT_EXPR_NEG,
+    VRT_EXPR_NOT,
+    VRT_EXPR_ABS,
+    VRT_EXPR_SQRT,
+    VRT_EXPR_FLOOR,
+    VRT_EXPR_CEIL,
+    VRT_EXPR_EXP,
+    VRT_EXPR_LOG,
+    VRT_EXPR_LOG10,
+    /* binary */
+    VRT_EXPR_ADD,
+    VRT_EXPR_SUB,
+    VRT_EXPR_MUL,
+    VRT_EXPR_DIV,
+    VRT_EXPR_POW,
+    VRT_EXPR_MIN,
+    VRT_EXPR_MAX,
+    VRT_EXPR_EQ,
+    VRT_EXPR_NE,
+    VRT_EXPR_LT,
+    VRT_EXPR_LE,
+    VRT_EXPR_GT,
+    VRT_EXPR_GE,
+    VRT_EXPR_AND,
+    VRT_EXPR_OR,
+    /* ternary */
+    VRT_EXPR_COND
+} VRTExprOpType;
+
+/************************************************************************/
+/*                           VRTExprArity()                             */
+/************************************************************************/
+
+static int VRTExprArity( int eOp )
+{
+    if( eOp <= VRT_EXPR_NODATA )
+        return 0;
+    if( eOp <= VRT_EXPR_LOG10 )
+        return 1;
+    if( eOp <= VRT_EXPR_OR )
+        return 2;
+    return 3;
+}
+
+/************************************************************************/
+/* ==================================================================== */
+/*                        Expression parser                             */
+/* ==================================================================== */
+/************************************************************************/
+
+/*
+** Grammar, from the lowest to the highest precedence :
+**
+**   expr    := or [ '?' expr ':' expr ]
+**   or      := and { '||' and }
+**   and     := cmp { '&&' cmp }
+**   cmp     := add [ ( '==' | '!=' | '<' | '<=' | '>' | '>=' ) add ]
+**   add     := mul { ( '+' | '-' ) mul }
+**   mul     := unary { ( '*' | '/' ) unary }
+**   unary   := ( '-' | '+' | '!' ) unary | primary
+**   primary := number | 'B' index | 'nodata' | func '(' expr {',' expr} ')'
+**            | '(' expr ')'
+*/
+
+/* Maximum nesting of sub-expressions and unary operators, to bound the */
+/* recursion of the parser */
+#define VRT_EXPR_MAX_NESTING 256
+
+class VRTExprParser
+{
+    const char              *pszExpr;
+    const char              *pszCur;
+    std::vector<VRTExprOp>  &aoOps;
+    int                      bError;
+    int                      nNesting;
+
+    void        SkipBlanks();
+    int         Accept( const char *pszToken );
+    void        Error( const char *pszMsg );
+    void        Emit( int eOp, int nSource = 0, double dfValue = 0.0 );
+    int         EnterNesting();
+
+    void        ParseExpr();
+    void        ParseOr();
+    void        ParseAnd();
+    void        ParseCmp();
+    void        ParseAdd();
+    void        ParseMul();
+    void        ParseUnary();
+    void        ParsePrimary();
+
+  public:
+                VRTExprParser( const char *pszExprIn,
+                               std::vector<VRTExprOp> &aoOpsIn ) :
+                    pszExpr(pszExprIn), pszCur(pszExprIn), aoOps(aoOpsIn),
+                    bError(FALSE), nNesting(0) {}
+
+    int         Parse();
+};
+
+/************************************************************************/
+/*                             SkipBlanks()                             */
+/************************************************************************/
+
+void VRTExprParser::SkipBlanks()
+{
+    while( *pszCur == ' ' || *pszCur == '\t' ||
+           *pszCur == '\n' || *pszCur == '\r' )
+        pszCur++;
+}
+
+/************************************************************************/
+/*                               Accept()                               */
+/*                                                                      */
+/*      Consume pszToken if it comes next. Single character tokens      */
+/*      that are the prefix of a two character operator are not        */
+/*      matched by the prefix ('<' does not match "<=").                */
+/************************************************************************/
+
+int VRTExprParser::Accept( const char *pszToken )
+{
+    SkipBlanks();
+
+    size_t nLen = strlen(pszToken);
+    if( strncmp(pszCur, pszToken, nLen) != 0 )
+        return FALSE;
+
+    if( nLen == 1 && pszCur[1] == '=' &&
+        (pszToken[0] == '<' || pszToken[0] == '>' ||
+         pszToken[0] == '!' || pszToken[0] == '=') )
+        return FALSE;
+
+    pszCur += nLen;
+    return TRUE;
+}
+
+/************************************************************************/
+/*                               Error()                                */
+/************************************************************************/
+
+void VRTExprParser::Error( const char *pszMsg )
+{
+    if( bError )
+        return;
+    bError = TRUE;
+    CPLError( CE_Failure, CPLE_AppDefined,
+              "Invalid pixel expression '%s': %s at offset %d.",
+              pszExpr, pszMsg, (int)(pszCur - pszExpr) );
+}
+
+/************************************************************************/
+/*                                Emit()                                */
+/************************************************************************/
+
+void VRTExprParser::Emit( int eOp, int nSource, double dfValue )
+{
+    VRTExprOp sOp;
+    sOp.eOp = eOp;
+    sOp.nSource = nSource;
+    sOp.dfValue = dfValue;
+    aoOps.push_back( sOp );
+}
+
+/************************************************************************/
+/*                            EnterNesting()                            */
+/*                                                                      */
+/*      Count one more level of nesting, and fail if it is too deep.    */
+/*      The caller decrements nNesting when it returns.                 */
+/************************************************************************/
+
+int VRTExprParser::EnterNesting()
+{
+    if( ++nNesting > VRT_EXPR_MAX_NESTING )
+    {
+        Error( "expression too deeply nested" );
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/************************************************************************/
+/*                               Parse()                                */
+/************************************************************************/
+
+int VRTExprParser::Parse()
+{
+    ParseExpr();
+    SkipBlanks();
+    if( !bError && *pszCur != '\0' )
+        Error( "unexpected character" );
+    return !bError;
+}
+
+/************************************************************************/
+/*                             ParseExpr()                              */
+/************************************************************************/
+
+void VRTExprParser::ParseExpr()
+{
+    if( !EnterNesting() )
+    {
+        nNesting--;
+        return;
+    }
+
+    ParseOr();
+    if( !bError && Accept("?") )
+    {
+        ParseExpr();
+        if( !bError && !Accept(":") )
+            Error( "':' expected" );
+        if( !bError )
+            ParseExpr();
+        Emit( VRT_EXPR_COND );
+    }
+    nNesting--;
+}
+
+/************************************************************************/
+/*                              ParseOr()                               */
+/************************************************************************/
+
+void VRTExprParser::ParseOr()
+{
+    ParseAnd();
+    while( !bError && Accept("||") )
+    {
+        ParseAnd();
+        Emit( VRT_EXPR_OR );
+    }
+}
+
+/************************************************************************/
+/*                              ParseAnd()                              */
+/************************************************************************/
+
+void VRTExprParser::ParseAnd()
+{
+    ParseCmp();
+    while( !bError && Accept("&&") )
+    {
+        ParseCmp();
+        Emit( VRT_EXPR_AND );
+    }
+}
+
+/************************************************************************/
+/*                              ParseCmp()                              */
+/************************************************************************/
+
+void VRTExprParser::ParseCmp()
+{
+    static const struct { const char *pszToken; int eOp; } asCmpOps[] =
+    {
+        { "==", VRT_EXPR_EQ }, { "!=", VRT_EXPR_NE },
+        { "<=", VRT_EXPR_LE }, { ">=", VRT_EXPR_GE },
+        { "<", VRT_EXPR_LT },  { ">", VRT_EXPR_GT }
+    };
+
+    ParseAdd();
+    if( bError )
+        return;
+
+    for( size_t i = 0; i < sizeof(asCmpOps) / sizeof(asCmpOps[0]); i++ )
+    {
+        if( Accept(asCmpOps[i].pszToken) )
+        {
+            ParseAdd();
+            Emit( asCmpOps[i].eOp );
+            break;
+        }
+    }
+}
+
+/************************************************************************/
+/*                              ParseAdd()                              */
+/************************************************************************/
+
+void VRTExprParser::ParseAdd()
+{
+    ParseMul();
+    while( !bError )
+    {
+        if( Accept("+") )
+        {
+            ParseMul();
+            Emit( VRT_EXPR_ADD );
+        }
+        else if( Accept("-") )
+        {
+            ParseMul();
+            Emit( VRT_EXPR_SUB );
+        }
+        else
+            break;
+    }
+}
+
+/************************************************************************/
+/*                              ParseMul()                              */
+/************************************************************************/
+
+void VRTExprParser::ParseMul()
+{
+    ParseUnary();
+    while( !bError )
+    {
+        if( Accept("*") )
+        {
+            ParseUnary();
+            Emit( VRT_EXPR_MUL );
+        }
+        else if( Accept("/") )
+        {
+            ParseUnary();
+            Emit( VRT_EXPR_DIV );
+        }
+        else
+            break;
+    }
+}
+
+/************************************************************************/
+/*                             ParseUnary()                             */
+/************************************************************************/
+
+void VRTExprParser::ParseUnary()
+{
+    if( !EnterNesting() )
+    {
+        nNesting--;
+        return;
+    }
+
+    if( Accept("-") )
+    {
+        ParseUnary();
+        Emit( VRT_EXPR_NEG );
+    }
+    else if( Accept("+") )
+        ParseUnary();
+    else if( Accept("!") )
+    {
+        ParseUnary();
+        Emit( VRT_EXPR_NOT );
+    }
+    else
+        ParsePrimary();
+    nNesting--;
+}
+
+/************************************************************************/
+/*                            ParsePrimary()                            */
+/************************************************************************/
+
+void VRTExprParser::ParsePrimary()
+{
+    static const struct { const char *pszName; int eOp; } asFuncs[] =
+    {
+        { "abs", VRT_EXPR_ABS }, { "sqrt", VRT_EXPR_SQRT },
+        { "floor", VRT_EXPR_FLOOR }, { "ceil", VRT_EXPR_CEIL },
+        { "exp", VRT_EXPR_EXP }, { "log", VRT_EXPR_LOG },
+        { "log10", VRT_EXPR_LOG10 }, { "pow", VRT_EXPR_POW },
+        { "min", VRT_EXPR_MIN }, { "max", VRT_EXPR_MAX }
+    };
+
+    SkipBlanks();
+
+/* -------------------------------------------------------------------- */
+/*      Parenthesized sub-expression.                                   */
+/* -------------------------------------------------------------------- */
+    if( Accept("(") )
+    {
+        ParseExpr();
+        if( !bError && !Accept(")") )
+            Error( "')' expected" );
+        return;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Numeric constant.                                               */
+/* -------------------------------------------------------------------- */
+    if( (*pszCur >= '0' && *pszCur <= '9') || *pszCur == '.' )
+    {
+        char *pszEnd = NULL;
+        double dfValue = CPLStrtod( pszCur, &pszEnd );
+        if( pszEnd == pszCur )
+        {
+            Error( "invalid number" );
+            return;
+        }
+        pszCur = pszEnd;
+        Emit( VRT_EXPR_CONSTANT, 0, dfValue );
+        return;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Identifier : source reference, nodata or function call.         */
+/* -------------------------------------------------------------------- */
+    const char *pszStart = pszCur;
+    while( (*pszCur >= 'a' && *pszCur <= 'z') ||
+           (*pszCur >= 'A' && *pszCur <= 'Z') ||
+           (*pszCur >= '0' && *pszCur <= '9') || *pszCur == '_' )
+        pszCur++;
+
+    CPLString osIdent( std::string( pszStart, pszCur - pszStart ) );
+    if( osIdent.size() == 0 )
+    {
+        Error( "operand expected" );
+        return;
+    }
+
+    if( (osIdent[0] == 'B' || osIdent[0] == 'b') && osIdent.size() > 1 &&
+        osIdent.find_first_not_of("0123456789", 1) == std::string::npos )
+    {
+        errno = 0;
+        long nSource = strtol( osIdent.c_str() + 1, NULL, 10 );
+        if( nSource < 1 )
+        {
+            pszCur = pszStart;
+            Error( "source numbering starts at B1" );
+            return;
+        }
+        if( errno == ERANGE || nSource > INT_MAX )
+        {
+            pszCur = pszStart;
+            Error( "source index out of range" );
+            return;
+        }
+        Emit( VRT_EXPR_SOURCE, (int) nSource - 1 );
+        return;
+    }
+
+    if( EQUAL(osIdent, "nodata") )
+    {
+        Emit( VRT_EXPR_NODATA );
+        return;
+    }
+
+    for( size_t i = 0; i < sizeof(asFuncs) / sizeof(asFuncs[0]); i++ )
+    {
+        if( !EQUAL(osIdent, asFuncs[i].pszName) )
+            continue;
+
+        int eOp = asFuncs[i].eOp;
+        int nArgs = 0;
+
+        if( !Accept("(") )
+        {
+            Error( "'(' expected" );
+            return;
+        }
+        do
+        {
+            ParseExpr();
+            nArgs++;
+            /* min() and max() take any number of arguments */
+            if( !bError && nArgs > 1 &&
+                (eOp == VRT_EXPR_MIN || eOp == VRT_EXPR_MAX) )
+                Emit( eOp );
+        } while( !bError && Accept(",") );
+
+        if( bError )
+            return;
+        if( !Accept(")") )
+        {
+            Error( "')' expected" );
+            return;
+        }
+
+        if( eOp == VRT_EXPR_MIN || eOp == VRT_EXPR_MAX )
+        {
+            if( nArgs < 2 )
+                Error( "at least 2 arguments expected" );
+        }
+        else if( nArgs != VRTExprArity(eOp) )
+        {
+            Error( "wrong number of arguments" );
+        }
+        else
+            Emit( eOp );
+        return;
+    }
+
+    pszCur = pszStart;
+    Error( CPLSPrintf("unknown identifier '%s'", osIdent.c_str()) );
+}
+
+/************************************************************************/
+/* ==================================================================== */
+/*                           Row kernels                                */
+/* ==================================================================== */
+/************************************************************************/
+
+/*
+** Each functor provides the scalar operation and, when SSE2 is available,
+** the same operation on 2 doubles. Both must give identical results,
+** NaN handling included, so that the tail of a row, processed with the
+** scalar version, is consistent with its body.
+*/
+
+#ifdef HAVE_SSE2_EXPR
+#define VRT_EXPR_SSE_ONE   _mm_set1_pd(1.0)
+#define VRT_EXPR_SSE_ZERO  _mm_setzero_pd()
+#define VRT_EXPR_SSE_SIGN  _mm_set1_pd(-0.0)
+#endif
+
+#ifdef HAVE_SSE2_EXPR
+#define VRT_EXPR_BINARY(name, scalar_expr, vector_expr)                     \
+struct name                                                                 \
+{                                                                           \
+    static inline double Scalar( double a, double b ) { return scalar_expr; } \
+    static inline __m128d Vector( __m128d a, __m128d b ) { return vector_expr; } \
+};
+#define VRT_EXPR_UNARY(name, scalar_expr, vector_expr)                      \
+struct name                                                                 \
+{                                                                           \
+    static inline double Scalar( double a ) { return scalar_expr; }        \
+    static inline __m128d Vector( __m128d a ) { return vector_expr; }      \
+};
+#else
+#define VRT_EXPR_BINARY(name, scalar_expr, vector_expr)                     \
+struct name                                                                 \
+{                                                                           \
+    static inline double Scalar( double a, double b ) { return scalar_expr; } \
+};
+#define VRT_EXPR_UNARY(name, scalar_expr, vector_expr)                      \
+struct name                                                                 \
+{                                                                           \
+    static inline double Scalar( double a ) { return scalar_expr; }        \
+};
+#endif
+
+VRT_EXPR_BINARY(VRTExprAdd, a + b, _mm_add_pd(a, b))
+VRT_EXPR_BINARY(VRTExprSub, a - b, _mm_sub_pd(a, b))
+VRT_EXPR_BINARY(VRTExprMul, a * b, _mm_mul_pd(a, b))
+VRT_EXPR_BINARY(VRTExprDiv, a / b, _mm_div_pd(a, b))
+/* minpd/maxpd return their second operand when one of them is NaN */
+VRT_EXPR_BINARY(VRTExprMin, a < b ? a : b, _mm_min_pd(a, b))
+VRT_EXPR_BINARY(VRTExprMax, a > b ? a : b, _mm_max_pd(a, b))
+VRT_EXPR_BINARY(VRTExprEq, a == b ? 1.0 : 0.0,
+                _mm_and_pd(_mm_cmpeq_pd(a, b), VRT_EXPR_SSE_ONE))
+VRT_EXPR_BINARY(VRTExprNe, a != b ? 1.0 : 0.0,
+                _mm_and_pd(_mm_cmpneq_pd(a, b), VRT_EXPR_SSE_ONE))
+VRT_EXPR_BINARY(VRTExprLt, a < b ? 1.0 : 0.0,
+                _mm_and_pd(_mm_cmplt_pd(a, b), VRT_EXPR_SSE_ONE))
+VRT_EXPR_BINARY(VRTExprLe, a <= b ? 1.0 : 0.0,
+                _mm_and_pd(_mm_cmple_pd(a, b), VRT_EXPR_SSE_ONE))
+VRT_EXPR_BINARY(VRTExprGt, a > b ? 1.0 : 0.0,
+                _mm_and_pd(_mm_cmpgt_pd(a, b), VRT_EXPR_SSE_ONE))
+VRT_EXPR_BINARY(VRTExprGe, a >= b ? 1.0 : 0.0,
+                _mm_and_pd(_mm_cmpge_pd(a, b), VRT_EXPR_SSE_ONE))
+VRT_EXPR_BINARY(VRTExprAnd, (a != 0.0 && b != 0.0) ? 1.0 : 0.0,
+                _mm_and_pd(_mm_and_pd(_mm_cmpneq_pd(a, VRT_EXPR_SSE_ZERO),
+                                      _mm_cmpneq_pd(b, VRT_EXPR_SSE_ZERO)),
+                           VRT_EXPR_SSE_ONE))
+VRT_EXPR_BINARY(VRTExprOr, (a != 0.0 || b != 0.0) ? 1.0 : 0.0,
+                _mm_and_pd(_mm_or_pd(_mm_cmpneq_pd(a, VRT_EXPR_SSE_ZERO),
+                                     _mm_cmpneq_pd(b, VRT_EXPR_SSE_ZERO)),
+                           VRT_EXPR_SSE_ONE))
+
+VRT_EXPR_UNARY(VRTExprNeg, -a, _mm_xor_pd(a, VRT_EXPR_SSE_SIGN))
+VRT_EXPR_UNARY(VRTExprNot, a == 0.0 ? 1.0 : 0.0,
+               _mm_and_pd(_mm_cmpeq_pd(a, VRT_EXPR_SSE_ZERO),
+                          VRT_EXPR_SSE_ONE))
+VRT_EXPR_UNARY(VRTExprAbs, fabs(a), _mm_andnot_pd(VRT_EXPR_SSE_SIGN, a))
+VRT_EXPR_UNARY(VRTExprSqrt, sqrt(a), _mm_sqrt_pd(a))
+
+/************************************************************************/
+/*                          VRTExprBinaryRow()                          */
+/************************************************************************/
+
+template<class OP> static void VRTExprBinaryRow( const double *padfA,
+                                                 const double *padfB,
+                                                 double *padfOut, int nCount )
+{
+    int i = 0;
+#ifdef HAVE_SSE2_EXPR
+    for( ; i + 3 < nCount; i += 4 )
+    {
+        __m128d xmmLow = OP::Vector( _mm_loadu_pd(padfA + i),
+                                     _mm_loadu_pd(padfB + i) );
+        __m128d xmmHigh = OP::Vector( _mm_loadu_pd(padfA + i + 2),
+                                      _mm_loadu_pd(padfB + i + 2) );
+        _mm_storeu_pd( padfOut + i, xmmLow );
+        _mm_storeu_pd( padfOut + i + 2, xmmHigh );
+    }
+#endif
+    for( ; i < nCount; i++ )
+        padfOut[i] = OP::Scalar( padfA[i], padfB[i] );
+}
+
+/************************************************************************/
+/*                          VRTExprUnaryRow()                           */
+/************************************************************************/
+
+template<class OP> static void VRTExprUnaryRow( const double *padfA,
+                                                double *padfOut, int nCount )
+{
+    int i = 0;
+#ifdef HAVE_SSE2_EXPR
+    for( ; i + 3 < nCount; i += 4 )
+    {
+        __m128d xmmLow = OP::Vector( _mm_loadu_pd(padfA + i) );
+        __m128d xmmHigh = OP::Vector( _mm_loadu_pd(padfA + i + 2) );
+        _mm_storeu_pd( padfOut + i, xmmLow );
+        _mm_storeu_pd( padfOut + i + 2, xmmHigh );
+    }
+#endif
+    for( ; i < nCount; i++ )
+        padfOut[i] = OP::Scalar( padfA[i] );
+}
+
+/************************************************************************/
+/*                           VRTExprCondRow()                           */
+/************************************************************************/
+
+static void VRTExprCondRow( const double *padfCond, const double *padfA,
+                            const double *padfB, double *padfOut, int nCount )
+{
+    int i = 0;
+#ifdef HAVE_SSE2_EXPR
+    for( ; i + 1 < nCount; i += 2 )
+    {
+        __m128d xmmMask = _mm_cmpneq_pd( _mm_loadu_pd(padfCond + i),
+                                         VRT_EXPR_SSE_ZERO );
+        _mm_storeu_pd( padfOut + i,
+                       _mm_or_pd( _mm_and_pd(xmmMask, _mm_loadu_pd(padfA + i)),
+                                  _mm_andnot_pd(xmmMask,
+                                                _mm_loadu_pd(padfB + i)) ) );
+    }
+#endif
+    for( ; i < nCount; i++ )
+        padfOut[i] = padfCond[i] != 0.0 ? padfA[i] : padfB[i];
+}
+
+/************************************************************************/
+/* ==================================================================== */
+/*                            VRTExpression                             */
+/* ==================================================================== */
+/************************************************************************/
+
+/************************************************************************/
+/*                           VRTExpression()                            */
+/************************************************************************/
+
+VRTExpression::VRTExpression() : nMaxDepth(0), nMaxSource(-1)
+
+{
+}
+
+/************************************************************************/
+/*                              Compile()                               */
+/************************************************************************/
+
+/**
+ * Compile an expression.
+ *
+ * Sources are referenced as B1, B2, ... in the order of the sources of the
+ * derived band. An error is emitted if the expression is invalid.
+ *
+ * @param pszExpression the expression, e.g. "(B2-B1)/(B2+B1)".
+ *
+ * @return TRUE on success.
+ */
+
+int VRTExpression::Compile( const char *pszExpression )
+
+{
+    aoOps.clear();
+    nMaxDepth = 0;
+    nMaxSource = -1;
+    osExpression = pszExpression;
+
+    VRTExprParser oParser( pszExpression, aoOps );
+    if( !oParser.Parse() )
+    {
+        aoOps.clear();
+        return FALSE;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Compute the depth of the evaluation stack.                      */
+/* -------------------------------------------------------------------- */
+    int nDepth = 0;
+    for( size_t i = 0; i < aoOps.size(); i++ )
+    {
+        nDepth += 1 - VRTExprArity( aoOps[i].eOp );
+        nMaxDepth = MAX(nMaxDepth, nDepth);
+        if( aoOps[i].eOp == VRT_EXPR_SOURCE )
+            nMaxSource = MAX(nMaxSource, aoOps[i].nSource);
+    }
+    CPLAssert( nDepth == 1 );
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                         IsSourceReferenced()                         */
+/************************************************************************/
+
+int VRTExpression::IsSourceReferenced( int iSource ) const
+
+{
+    for( size_t i = 0; i < aoOps.size(); i++ )
+    {
+        if( aoOps[i].eOp == VRT_EXPR_SOURCE && aoOps[i].nSource == iSource )
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/************************************************************************/
+/*                            EvaluateRow()                             */
+/************************************************************************/
+
+/**
+ * Evaluate the expression over a row of pixels.
+ *
+ * @param papadfSources one row of nCount values per source. Entries of
+ * sources that are not referenced by the expression may be NULL.
+ * @param nCount number of pixels in the row.
+ * @param dfNoDataValue value of the 'nodata' identifier.
+ * @param padfWork work buffer of GetStackDepth() * nCount values.
+ * @param papadfStack work array of GetStackDepth() pointers.
+ *
+ * @return a pointer to the nCount result values, that is either in
+ * padfWork or one of the source rows.
+ */
+
+const double *VRTExpression::EvaluateRow( const double * const *papadfSources,
+                                          int nCount, double dfNoDataValue,
+                                          double *padfWork,
+                                          const double **papadfStack ) const
+
+{
+    int nSP = 0;
+
+    for( size_t iOp = 0; iOp < aoOps.size(); iOp++ )
+    {
+        const VRTExprOp &sOp = aoOps[iOp];
+        int nArity = VRTExprArity( sOp.eOp );
+
+        /* The result of the instruction goes at the slot of its first */
+        /* operand, which never overlaps with the other operands. */
+        double *padfOut = padfWork + (size_t)(nSP - nArity) * nCount;
+        const double *padfA = nArity >= 1 ? papadfStack[nSP - nArity] : NULL;
+        const double *padfB = nArity >= 2 ? papadfStack[nSP - nArity + 1] : NULL;
+        const double *padfC = nArity >= 3 ? papadfStack[nSP - 1] : NULL;
+        int i;
+
+        switch( sOp.eOp )
+        {
+          case VRT_EXPR_SOURCE:
+            papadfStack[nSP++] = papadfSources[sOp.nSource];
+            continue;
+
+          case VRT_EXPR_CONSTANT:
+          case VRT_EXPR_NODATA:
+          {
+            double dfValue = sOp.eOp == VRT_EXPR_CONSTANT ?
+                                        sOp.dfValue : dfNoDataValue;
+            for( i = 0; i < nCount; i++ )
+                padfOut[i] = dfValue;
+            papadfStack[nSP++] = padfOut;
+            continue;
+          }
+
+          case VRT_EXPR_NEG:
+            VRTExprUnaryRow<VRTExprNeg>( padfA, padfOut, nCount );
+            break;
+          case VRT_EXPR_NOT:
+            VRTExprUnaryRow<VRTExprNot>( padfA, padfOut, nCount );
+            break;
+          case VRT_EXPR_ABS:
+            VRTExprUnaryRow<VRTExprAbs>( padfA, padfOut, nCount );
+            break;
+          case VRT_EXPR_SQRT:
+            VRTExprUnaryRow<VRTExprSqrt>( padfA, padfOut, nCount );
+            break;
+          case VRT_EXPR_FLOOR:
+            for( i = 0; i < nCount; i++ )
+                padfOut[i] = floor( padfA[i] );
+            break;
+          case VRT_EXPR_CEIL:
+            for( i = 0; i < nCount; i++ )
+                padfOut[i] = ceil( padfA[i] );
+            break;
+          case VRT_EXPR_EXP:
+            for( i = 0; i < nCount; i++ )
+                padfOut[i] = exp( padfA[i] );
+            break;
+          case VRT_EXPR_LOG:
+            for( i = 0; i < nCount; i++ )
+                padfOut[i] = log( padfA[i] );
+            break;
+          case VRT_EXPR_LOG10:
+            for( i = 0; i < nCount; i++ )
+                padfOut[i] = log10( padfA[i] );
+            break;
+
+          case VRT_EXPR_ADD:
+            VRTExprBinaryRow<VRTExprAdd>( padfA, padfB, padfOut, nCount );
+            break;
+          case VRT_EXPR_SUB:
+            VRTExprBinaryRow<VRTExprSub>( padfA, padfB, padfOut, nCount );
+            break;
+          case VRT_EXPR_MUL:
+            VRTExprBinaryRow<VRTExprMul>( padfA, padfB, padfOut, nCount );
+            break;
+          case VRT_EXPR_DIV:
+            VRTExprBinaryRow<VRTExprDiv>( padfA, padfB, padfOut, nCount );
+            break;
+          case VRT_EXPR_POW:
+            for( i = 0; i < nCount; i++ )
+                padfOut[i] = pow( padfA[i], padfB[i] );
+            break;
+          case VRT_EXPR_MIN:
+            VRTExprBinaryRow<VRTExprMin>( padfA, padfB, padfOut, nCount );
+            break;
+          case VRT_EXPR_MAX:
+            VRTExprBinaryRow<VRTExprMax>( padfA, padfB, padfOut, nCount );
+            break;
+          case VRT_EXPR_EQ:
+            VRTExprBinaryRow<VRTExprEq>( padfA, padfB, padfOut, nCount );
+            break;
+          case VRT_EXPR_NE:
+            VRTExprBinaryRow<VRTExprNe>( padfA, padfB, padfOut, nCount );
+            break;
+          case VRT_EXPR_LT:
+            VRTExprBinaryRow<VRTExprLt>( padfA, padfB, padfOut, nCount );
+            break;
+          case VRT_EXPR_LE:
+            VRTExprBinaryRow<VRTExprLe>( padfA, padfB, padfOut, nCount );
+            break;
+          case VRT_EXPR_GT:
+            VRTExprBinaryRow<VRTExprGt>( padfA, padfB, padfOut, nCount );
+            break;
+          case VRT_EXPR_GE:
+            VRTExprBinaryRow<VRTExprGe>( padfA, padfB, padfOut, nCount );
+            break;
+          case VRT_EXPR_AND:
+            VRTExprBinaryRow<VRTExprAnd>( padfA, padfB, padfOut, nCount );
+            break;
+          case VRT_EXPR_OR:
+            VRTExprBinaryRow<VRTExprOr>( padfA, padfB, padfOut, nCount );
+            break;
+
+          case VRT_EXPR_COND:
+            VRTExprCondRow( padfA, padfB, padfC, padfOut, nCount );
+            break;
+
+          default:
+            CPLAssert( FALSE );
+            break;
+        }
+
+        nSP -= nArity - 1;
+        papadfStack[nSP - 1] = padfOut;
+    }
+
+    return papadfStack[0];
+}
@@ -31,9 +31,13 @@
 #include "vrtdataset.h"
 #include "cpl_minixml.h"
 #include "cpl_string.h"
+#include <algorithm>
 
 CPL_CVSID("$Id$");
 
+/* Below that number of sources, a linear scan is cheap enough */
+#define VRT_SOURCE_INDEX_MIN_SOURCES  64
+
 /************************************************************************/
 /* ==================================================================== */
 /*                          VRTSourcedRasterBand                        */
@@ -97,6 +101,8 @@ void VRTSourcedRasterBand::Initialize( int nXSize, int nYSize )
     bEqualAreas = FALSE;
     nRecursionCounter = 0;
     papszSourceList = NULL;
+    hSourceIndex = NULL;
+    nIndexedSources = 0;
 }
 
 /************************************************************************/
@@ -108,6 +114,131 @@ VRTSourcedRasterBand::~VRTSourcedRasterBand()
 {
     CloseDependentDatasets();
     CSLDestroy(papszSourceList);
+    InvalidateSourceIndex();
+}
+
+/************************************************************************/
+/*                       InvalidateSourceIndex()                        */
+/************************************************************************/
+
+void VRTSourcedRasterBand::InvalidateSourceIndex()
+
+{
+    if( hSourceIndex != NULL )
+        CPLQuadTreeDestroy( hSourceIndex );
+    hSourceIndex = NULL;
+    nIndexedSources = 0;
+    anUnindexedSources.clear();
+}
+
+/************************************************************************/
+/*                         GetSourcesInWindow()                         */
+/*                                                                      */
+/*      Collect, in their declaration order, the index of the sources   */
+/*      that may contribute to the passed window. Returns FALSE when    */
+/*      all the sources must be visited, which is the case for bands    */
+/*      with few sources. Otherwise a quad tree over the destination    */
+/*      windows of the simple sources is built on first use, so that    */
+/*      requests on large mosaics only visit the sources they hit.      */
+/*      Sources that are not simple ones, or that have no destination   */
+/*      window, are always returned.                                    */
+/************************************************************************/
+
+int VRTSourcedRasterBand::GetSourcesInWindow( int nXOff, int nYOff,
+                                              int nXSize, int nYSize,
+                                              std::vector<int>& anSourceIdx )
+
+{
+    int iSource;
+
+    anSourceIdx.resize(0);
+
+    if( nSources < VRT_SOURCE_INDEX_MIN_SOURCES )
+        return FALSE;
+
+/* -------------------------------------------------------------------- */
+/*      (Re)build the index if needed. Callers are allowed to play      */
+/*      with nSources, so check that it is still the one we indexed.    */
+/* -------------------------------------------------------------------- */
+    if( hSourceIndex == NULL || nIndexedSources != nSources )
+    {
+        InvalidateSourceIndex();
+
+        CPLRectObj sGlobalBounds;
+        sGlobalBounds.minx = 0;
+        sGlobalBounds.miny = 0;
+        sGlobalBounds.maxx = nRasterXSize;
+        sGlobalBounds.maxy = nRasterYSize;
+
+        std::vector<CPLRectObj> asBounds;
+        std::vector<int> anIndexed;
+        for( iSource = 0; iSource < nSources; iSource++ )
+        {
+            int nDstXOff, nDstYOff, nDstXSize, nDstYSize;
+
+            if( !papoSources[iSource]->IsSimpleSource() ||
+                !((VRTSimpleSource *) papoSources[iSource])->GetDstWindow(
+                    &nDstXOff, &nDstYOff, &nDstXSize, &nDstYSize ) )
+            {
+                anUnindexedSources.push_back( iSource );
+                continue;
+            }
+
+            CPLRectObj sRect;
+            sRect.minx = nDstXOff;
+            sRect.miny = nDstYOff;
+            sRect.maxx = (double) nDstXOff + nDstXSize;
+            sRect.maxy = (double) nDstYOff + nDstYSize;
+            asBounds.push_back( sRect );
+            anIndexed.push_back( iSource );
+
+            sGlobalBounds.minx = MIN(sGlobalBounds.minx, sRect.minx);
+            sGlobalBounds.miny = MIN(sGlobalBounds.miny, sRect.miny);
+            sGlobalBounds.maxx = MAX(sGlobalBounds.maxx, sRect.maxx);
+            sGlobalBounds.maxy = MAX(sGlobalBounds.maxy, sRect.maxy);
+        }
+
+        hSourceIndex = CPLQuadTreeCreate( &sGlobalBounds, NULL );
+        CPLQuadTreeSetMaxDepth( hSourceIndex,
+                CPLQuadTreeGetAdvisedMaxDepth( (int) anIndexed.size() ) );
+        for( size_t i = 0; i < anIndexed.size(); i++ )
+        {
+            CPLQuadTreeInsertWithBounds( hSourceIndex,
+                                         (void *) (size_t) anIndexed[i],
+                                         &asBounds[i] );
+        }
+        nIndexedSources = nSources;
+
+        CPLDebug( "VRT", "Built spatial index over %d sources of band %d.",
+                  nSources, nBand );
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Query it. The rectangles overlap test is inclusive, which is    */
+/*      a superset of what the sources themselves accept.               */
+/* -------------------------------------------------------------------- */
+    CPLRectObj sAoi;
+    sAoi.minx = nXOff;
+    sAoi.miny = nYOff;
+    sAoi.maxx = (double) nXOff + nXSize;
+    sAoi.maxy = (double) nYOff + nYSize;
+
+    int nFeatureCount = 0;
+    void **pahFeatures = CPLQuadTreeSearch( hSourceIndex, &sAoi,
+                                            &nFeatureCount );
+
+    anSourceIdx.reserve( nFeatureCount + anUnindexedSources.size() );
+    for( int i = 0; i < nFeatureCount; i++ )
+        anSourceIdx.push_back( (int) (size_t) pahFeatures[i] );
+    CPLFree( pahFeatures );
+
+    anSourceIdx.insert( anSourceIdx.end(), anUnindexedSources.begin(),
+                        anUnindexedSources.end() );
+
+    /* Sources are composited in order, later ones on top */
+    std::sort( anSourceIdx.begin(), anSourceIdx.end() );
+
+    return TRUE;
 }
 
 /************************************************************************/
@@ -198,8 +329,14 @@ CPLErr VRTSourcedRasterBand::IRasterIO( GDALRWFlag eRWFlag,
 /* -------------------------------------------------------------------- */
 /*      Overlay each source in turn over top this.                      */
 /* -------------------------------------------------------------------- */
-    for( iSource = 0; eErr == CE_None && iSource < nSources; iSource++ )
+    std::vector<int> anSourceIdx;
+    int bUseSourceIdx = GetSourcesInWindow( nXOff, nYOff, nXSize, nYSize,
+                                            anSourceIdx );
+    int nSourcesToVisit = bUseSourceIdx ? (int) anSourceIdx.size() : nSources;
+
+    for( int i = 0; eErr == CE_None && i < nSourcesToVisit; i++ )
     {
+        iSource = bUseSourceIdx ? anSourceIdx[i] : i;
         eErr = 
             papoSources[iSource]->RasterIO( nXOff, nYOff, nXSize, nYSize, 
                                             pData, nBufXSize, nBufYSize, 
@@ -650,6 +787,8 @@ CPLErr VRTSourcedRasterBand::AddSource( VRTSource *poNewSource )
         CPLRealloc(papoSources, sizeof(void*) * nSources);
     papoSources[nSources-1] = poNewSource;
 
+    InvalidateSourceIndex();
+
     ((VRTDataset *)poDS)->SetNeedsFlush();
 
     return CE_None;
@@ -1272,6 +1411,7 @@ CPLErr VRTSourcedRasterBand::SetMetadataItem( const char *pszName,
         {
             delete papoSources[iSource];
             papoSources[iSource] = poSource;
+            InvalidateSourceIndex();
             ((VRTDataset *)poDS)->SetNeedsFlush();
             return CE_None;
         }
@@ -1304,6 +1444,7 @@ CPLErr VRTSourcedRasterBand::SetMetadata( char **papszNewMD, const char *pszDoma
             CPLFree( papoSources );
             papoSources = NULL;
             nSources = 0;
+            InvalidateSourceIndex();
         }
 
         for( i = 0; i < CSLCount(papszNewMD); i++ )
@@ -1367,5 +1508,7 @@ int VRTSourcedRasterBand::CloseDependentDatasets()
     papoSources = NULL;
     nSources = 0;
 
+    InvalidateSourceIndex();
+
     return TRUE;
 }
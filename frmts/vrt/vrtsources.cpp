@@ -162,6 +162,29 @@ void VRTSimpleSource::SetDstWindow( int nNewXOff, int nNewYOff,
     nDstYSize = nNewYSize;
 }
 
+/************************************************************************/
+/*                            GetDstWindow()                            */
+/*                                                                      */
+/*      Returns FALSE if no destination window is set, in which case    */
+/*      the source covers the whole band.                               */
+/************************************************************************/
+
+int VRTSimpleSource::GetDstWindow( int *pnXOff, int *pnYOff,
+                                   int *pnXSize, int *pnYSize )
+
+{
+    if( nDstXOff == -1 && nDstXSize == -1
+        && nDstYOff == -1 && nDstYSize == -1 )
+        return FALSE;
+
+    *pnXOff = nDstXOff;
+    *pnYOff = nDstYOff;
+    *pnXSize = nDstXSize;
+    *pnYSize = nDstYSize;
+
+    return TRUE;
+}
+
 /************************************************************************/
 /*                           SetNoDataValue()                           */
 /************************************************************************/
@@ -485,6 +485,15 @@ GDALRasterIO( GDALRasterBandH hRBand, GDALRWFlag eRWFlag,
               int nDSXOff, int nDSYOff, int nDSXSize, int nDSYSize,
               void * pBuffer, int nBXSize, int nBYSize,GDALDataType eBDataType,
               int nPixelSpace, int nLineSpace );
+CPLErr CPL_DLL CPL_STDCALL 
+GDALRasterIOResampled( GDALRasterBandH hRBand,
+                       double dfXOff, double dfYOff,
+                       double dfXSize, double dfYSize,
+                       void * pBuffer, int nBXSize, int nBYSize,
+                       GDALDataType eBDataType,
+                       int nPixelSpace, int nLineSpace,
+                       const char *pszResampling,
+                       GDALProgressFunc pfnProgress, void *pProgressData );
 CPLErr CPL_DLL CPL_STDCALL GDALReadBlock( GDALRasterBandH, int, int, void * );
 CPLErr CPL_DLL CPL_STDCALL GDALWriteBlock( GDALRasterBandH, int, int, void * );
 int CPL_DLL CPL_STDCALL GDALGetRasterBandXSize( GDALRasterBandH );
@@ -824,6 +833,83 @@ GIntBig CPL_DLL CPL_STDCALL GDALGetCacheUsed64(void);
 
 int CPL_DLL CPL_STDCALL GDALFlushCacheBlock(void);
 
+/** Block cache statistics, see GDALGetCacheStats() */
+typedef struct
+{
+    /** Number of block requests served from the cache */
+    GIntBig nHits;
+    /** Number of block requests that required a new cache block */
+    GIntBig nMisses;
+    /** Number of blocks evicted from the cache to respect its maximum size */
+    GIntBig nEvictions;
+    /** Number of dirty blocks written to the driver */
+    GIntBig nDirtyFlushes;
+    /** Number of blocks currently in the cache */
+    GIntBig nBlocks;
+    /** Number of dirty blocks currently in the cache */
+    GIntBig nDirtyBlocks;
+    /** Number of bytes currently used by cached blocks */
+    GIntBig nBytes;
+    /** Time spent waiting for the block cache mutexes, in microseconds
+        (only reported by GDALGetCacheStats()) */
+    GIntBig nLockWaitMicroseconds;
+} GDALCacheStats;
+
+/** Cache use of one dataset, see GDALGetCacheUsageByDataset() */
+typedef struct
+{
+    /** Dataset, or NULL for the bands that do not belong to a dataset */
+    GDALDatasetH hDS;
+    /** Number of blocks in the cache */
+    int          nBlocks;
+    /** Number of dirty blocks in the cache */
+    int          nDirtyBlocks;
+    /** Number of bytes used by the blocks */
+    GIntBig      nBytes;
+} GDALCacheDatasetUsage;
+
+/** Number of buckets of the IReadBlock() latency histograms. Bucket i
+    counts the reads that took between 2^i and 2^(i+1) microseconds, the
+    first one also counting the faster reads and the last one the slower
+    reads. */
+#define GDAL_READBLOCK_LATENCY_BUCKETS 24
+
+void CPL_DLL CPL_STDCALL GDALGetCacheStats( GDALCacheStats *psStats );
+void CPL_DLL CPL_STDCALL GDALGetDatasetCacheStats( GDALDatasetH hDS,
+                                                   GDALCacheStats *psStats );
+void CPL_DLL CPL_STDCALL GDALGetRasterBandCacheStats( GDALRasterBandH hBand,
+                                                      GDALCacheStats *psStats );
+void CPL_DLL CPL_STDCALL GDALResetCacheStats( void );
+int CPL_DLL CPL_STDCALL GDALGetCacheUsageByDataset(
+                                    GDALCacheDatasetUsage **ppasUsage );
+int CPL_DLL CPL_STDCALL GDALGetDriverReadBlockLatencyHistogram(
+                                    GDALDriverH hDriver, int nBuckets,
+                                    GIntBig *panCounts );
+void CPL_DLL CPL_STDCALL GDALResetDriverReadBlockLatencyHistogram(
+                                    GDALDriverH hDriver );
+
+/** Block cache priority classes, see GDALSetRasterCachePriority() */
+typedef enum
+{
+    /*! Blocks are recycled before any other (streaming access) */ GCPRI_Low = 0,
+    /*! Default least recently used eviction */                   GCPRI_Normal = 1,
+    /*! Blocks are evicted only if no other block can be */        GCPRI_High = 2
+} GDALCachePriority;
+
+void CPL_DLL CPL_STDCALL GDALSetRasterCachePriority( GDALRasterBandH hBand,
+                                                     GDALCachePriority ePriority );
+GDALCachePriority CPL_DLL CPL_STDCALL
+                         GDALGetRasterCachePriority( GDALRasterBandH hBand );
+void CPL_DLL CPL_STDCALL GDALSetDatasetCachePriority( GDALDatasetH hDS,
+                                                      GDALCachePriority ePriority );
+void CPL_DLL CPL_STDCALL GDALSetDatasetCacheQuota( GDALDatasetH hDS,
+                                                   GIntBig nQuotaInBytes );
+GIntBig CPL_DLL CPL_STDCALL GDALGetDatasetCacheQuota( GDALDatasetH hDS );
+CPLErr CPL_DLL CPL_STDCALL GDALPinBlock( GDALRasterBandH hBand,
+                                         int nXBlockOff, int nYBlockOff );
+CPLErr CPL_DLL CPL_STDCALL GDALUnpinBlock( GDALRasterBandH hBand,
+                                           int nXBlockOff, int nYBlockOff );
+
 /* ==================================================================== */
 /*      GDAL virtual memory                                             */
 /* ==================================================================== */
@@ -313,6 +313,8 @@ class CPL_DLL GDALDataset : public GDALMajorObject
                                int nBandCount, int *panBandMap);
 
     virtual int         CloseDependentDatasets();
+
+    void                SetBlockIOParent( GDALDataset *poParent );
     
     int                 ValidateLayerCreationOptions( const char* const* papszLCO );
     
@@ -330,6 +332,13 @@ class CPL_DLL GDALDataset : public GDALMajorObject
 
     virtual void FlushCache(void);
 
+    void        GetCacheStats( GDALCacheStats *psStats );
+    void        ResetCacheStats();
+
+    void        SetCachePriority( GDALCachePriority ePriority );
+    void        SetCacheQuota( GIntBig nQuotaInBytes );
+    GIntBig     GetCacheQuota();
+
     virtual const char *GetProjectionRef(void);
     virtual CPLErr SetProjection( const char * );
 
@@ -391,6 +400,26 @@ class CPL_DLL GDALDataset : public GDALMajorObject
 private:
     void        *m_hMutex;
 
+    void        *m_hBlockIOMutex;
+    void        *m_hBlockIOCond;
+    GIntBig      m_nBlockIOOwner;
+    int          m_nBlockIORecursion;
+    GDALDataset *m_poBlockIOParent;
+
+    GIntBig      m_nCacheQuota;
+    GIntBig      m_nCacheUsed;
+    void        *m_hCacheUsedMutex;
+
+    void        AddCacheUsed( GIntBig nBytes );
+    GIntBig     GetCacheUsed();
+
+    int          EnterBlockIO( int bTryOnly );
+    void         LeaveBlockIO();
+    int          IsBlockIOOwnedByCurrentThread();
+
+    friend class GDALRasterBlock;
+    friend class GDALBlockIOHolder;
+
     OGRLayer*       BuildLayerFromSelectInfo(void* psSelectInfo,
                                              OGRGeometry *poSpatialFilter,
                                              const char *pszDialect);
@@ -473,6 +502,13 @@ class CPL_DLL GDALRasterBlock
     GDALRasterBlock     *poNext;
     GDALRasterBlock     *poPrevious;
 
+    int                 nShard;
+    volatile int        nTouchTick;
+
+    int                 bPinned;
+
+    static int  GetShardCount();
+
   public:
                 GDALRasterBlock( GDALRasterBand *, int, int );
     virtual     ~GDALRasterBlock();
@@ -494,6 +530,8 @@ class CPL_DLL GDALRasterBlock
     int         GetYSize() { return nYSize; }
     int         GetDirty() { return bDirty; }
     int         GetLockCount() { return nLockCount; }
+    int         IsPinned() { return bPinned; }
+    void        SetPinned( int bPinnedIn );
 
     void        *GetDataRef( void ) { return pData; }
 
@@ -502,12 +540,54 @@ class CPL_DLL GDALRasterBlock
     GDALRasterBand *GetBand() { return poBand; }
 
     static int  FlushCacheBlock();
+    static int  FlushDatasetCacheBlock( GDALDataset *poDS );
     static void Verify();
 
     static int  SafeLockBlock( GDALRasterBlock ** );
+    static int  SafeLockBlock( GDALRasterBlock **, GDALRasterBand *, int, int,
+                               int bCountAsHit = FALSE );
+
+    static int  GetShardIndex( GDALRasterBand *, int, int );
+
+    static int  IsWriteBackEnabled();
+
+    static void GetCacheStats( GDALDataset *poDS, GDALRasterBand *poBand,
+                               GDALCacheStats *psStats );
+    static int  GetCacheUsageByDataset( GDALCacheDatasetUsage **ppasUsage );
+    static void ResetCacheStats();
     
     /* Should only be called by GDALDestroyDriverManager() */
     static void DestroyRBMutex();
+
+  private:
+    static int  SelectEvictionTarget( int iShard, int bDirtyAllowed,
+                                      int bHighPriorityAllowed,
+                                      GDALDataset *poDSFilter,
+                                      GDALRasterBand **ppoBand,
+                                      int *pnXOff, int *pnYOff,
+                                      GDALDataset **ppoLockedDS );
+    static void FlushEvictedBlock( GDALRasterBand *poBand,
+                                   int nXOff, int nYOff,
+                                   GDALDataset *poLockedDS );
+    static int  WriteBackOldestDirtyBlock();
+    static void WriteBackThread( void * );
+    static void WakeUpWriteBack();
+};
+
+/* ******************************************************************** */
+/*                          GDALBlockIOHolder                           */
+/* ******************************************************************** */
+
+//! Serializes the block I/O done on a dataset with the write-back threads.
+
+class CPL_DLL GDALBlockIOHolder
+{
+    GDALDataset *poDS;
+    int          bExplicit;
+
+  public:
+                GDALBlockIOHolder( GDALDataset *poDSIn, int bAlways = FALSE );
+                ~GDALBlockIOHolder();
 };
 
 /* ******************************************************************** */
@@ -551,6 +631,20 @@ class CPL_DLL GDALRasterBand : public GDALMajorObject
 
     void           SetFlushBlockErr( CPLErr eErr );
 
+    /* block cache statistics, updated atomically, as the blocks of a */
+    /* band are spread over several cache shards                       */
+    volatile int nCacheHits;
+    volatile int nCacheMisses;
+    volatile int nCacheEvictions;
+    volatile int nCacheDirtyFlushes;
+
+    GDALCachePriority eCachePriority;
+
+    /* set while RasterIOResampled() falls back on RasterIO() */
+    int         bInResampledRasterIO;
+
+    CPLErr         IReadBlockTimed( int, int, void * );
+
     friend class GDALRasterBlock;
 
   protected:
@@ -619,6 +713,11 @@ class CPL_DLL GDALRasterBand : public GDALMajorObject
     CPLErr      RasterIO( GDALRWFlag, int, int, int, int,
                           void *, int, int, GDALDataType,
                           int, int );
+    CPLErr      RasterIOResampled( double, double, double, double,
+                                   void *, int, int, GDALDataType,
+                                   int, int, const char *pszResampling,
+                                   GDALProgressFunc pfnProgress = NULL,
+                                   void *pProgressData = NULL );
     CPLErr      ReadBlock( int, int, void * );
 
     CPLErr      WriteBlock( int, int, void * );
@@ -627,6 +726,14 @@ class CPL_DLL GDALRasterBand : public GDALMajorObject
                                         int bJustInitialize = FALSE );
     CPLErr      FlushBlock( int = -1, int = -1, int bWriteDirtyBlock = TRUE );
 
+    void        GetCacheStats( GDALCacheStats *psStats );
+    void        ResetCacheStats();
+
+    void        SetCachePriority( GDALCachePriority ePriority );
+    GDALCachePriority GetCachePriority() { return eCachePriority; }
+    CPLErr      PinBlock( int nXBlockOff, int nYBlockOff );
+    CPLErr      UnpinBlock( int nXBlockOff, int nYBlockOff );
+
     unsigned char*  GetIndexColorTranslationTo(/* const */ GDALRasterBand* poReferenceBand,
                                                unsigned char* pTranslationTable = NULL,
                                                int* pApproximateMatching = NULL);
@@ -878,6 +985,17 @@ class CPL_DLL GDALDriver : public GDALMajorObject
                                        const char * pszOldName );
     CPLErr              DefaultCopyFiles( const char * pszNewName,
                                           const char * pszOldName );
+
+/* -------------------------------------------------------------------- */
+/*      IReadBlock() latency histogram.                                 */
+/* -------------------------------------------------------------------- */
+    void                RecordReadBlockLatency( GIntBig nMicroseconds );
+    int                 GetReadBlockLatencyHistogram( int nBuckets,
+                                                      GIntBig *panCounts );
+    void                ResetReadBlockLatencyHistogram();
+
+  private:
+    volatile int        anReadBlockLatencyHisto[GDAL_READBLOCK_LATENCY_BUCKETS];
 };
 
 /* ******************************************************************** */
@@ -1064,6 +1182,7 @@ void GDALNullifyProxyPoolSingleton();
 GDALDriver* GDALGetAPIPROXYDriver();
 void GDALSetResponsiblePIDForCurrentThread(GIntBig responsiblePID);
 GIntBig GDALGetResponsiblePIDForCurrentThread();
+GIntBig GDALGetMicroSecondCounter();
 
 CPLString GDALFindAssociatedFile( const char *pszBasename, const char *pszExt,
                                   char **papszSiblingFiles, int nFlags );
@@ -209,7 +209,7 @@ class CPL_DLL GDALProxyPoolDataset : public GDALProxyDataset
         CPLHashSet      *metadataSet;
         CPLHashSet      *metadataItemSet;
 
-        GDALProxyPoolCacheEntry* cacheEntry;
+        GDALProxyPoolCacheEntry* cacheEntry; /* unused, kept for ABI compatibility */
 
     protected:
         virtual GDALDataset *RefUnderlyingDataset();
@@ -312,8 +312,11 @@ class GDALProxyPoolOverviewRasterBand : public GDALProxyPoolRasterBand
         GDALProxyPoolRasterBand *poMainBand;
         int                      nOverviewBand;
 
-        GDALRasterBand          *poUnderlyingMainRasterBand;
-        int                      nRefCountUnderlyingMainRasterBand;
+        /* Underlying main band (and reference count) of each underlying */
+        /* band currently referenced, as several threads may be using     */
+        /* distinct underlying datasets */
+        void                    *hMainBandMutex;
+        std::map<GDALRasterBand*, std::pair<GDALRasterBand*, int> > oMapUnderlyingMainRasterBand;
 
     protected:
         virtual GDALRasterBand* RefUnderlyingRasterBand();
@@ -336,8 +339,11 @@ class GDALProxyPoolMaskBand : public GDALProxyPoolRasterBand
     private:
         GDALProxyPoolRasterBand *poMainBand;
 
-        GDALRasterBand          *poUnderlyingMainRasterBand;
-        int                      nRefCountUnderlyingMainRasterBand;
+        /* Underlying main band (and reference count) of each underlying */
+        /* band currently referenced, as several threads may be using     */
+        /* distinct underlying datasets */
+        void                    *hMainBandMutex;
+        std::map<GDALRasterBand*, std::pair<GDALRasterBand*, int> > oMapUnderlyingMainRasterBand;
 
     protected:
         virtual GDALRasterBand* RefUnderlyingRasterBand();
@@ -197,6 +197,16 @@ GDALDataset::GDALDataset()
     
     m_poStyleTable = NULL;
     m_hMutex = NULL;
+
+    m_hBlockIOMutex = NULL;
+    m_hBlockIOCond = NULL;
+    m_nBlockIOOwner = 0;
+    m_nBlockIORecursion = 0;
+    m_poBlockIOParent = NULL;
+
+    m_nCacheQuota = 0;
+    m_nCacheUsed = 0;
+    m_hCacheUsedMutex = NULL;
 }
 
 
@@ -303,9 +313,124 @@ GDALDataset::~GDALDataset()
     if( m_hMutex != NULL )
         CPLDestroyMutex( m_hMutex );
 
+    if( m_hBlockIOCond != NULL )
+        CPLDestroyCond( m_hBlockIOCond );
+    if( m_hBlockIOMutex != NULL )
+        CPLDestroyMutex( m_hBlockIOMutex );
+    if( m_hCacheUsedMutex != NULL )
+        CPLDestroyMutex( m_hCacheUsedMutex );
+
     CSLDestroy( papszOpenOptions );
 }
 
+/************************************************************************/
+/*                          SetBlockIOParent()                          */
+/************************************************************************/
+
+/**
+ * \brief Share the block I/O serialization of another dataset.
+ *
+ * Drivers whose overview or mask datasets share the underlying file handle
+ * of their parent dataset must call this on them, so that the block cache
+ * write-back threads (see GDAL_CACHE_WRITEBACK_THREADS) never write a block
+ * of one of them while another thread does I/O on the parent, or the
+ * reverse.  The parent must outlive this dataset.
+ *
+ * @param poParent the dataset whose serialization is shared, or NULL.
+ *
+ * @since GDAL 2.0
+ */
+
+void GDALDataset::SetBlockIOParent( GDALDataset *poParent )
+
+{
+    m_poBlockIOParent = poParent;
+}
+
+/************************************************************************/
+/*                            EnterBlockIO()                            */
+/*                                                                      */
+/*      Acquire the (recursive) right to do block I/O on this dataset.  */
+/*      This is only used when the block cache write-back threads are   */
+/*      enabled, to prevent them from writing dirty blocks while        */
+/*      another thread uses the dataset.  Returns FALSE if bTryOnly is  */
+/*      set and another thread already holds it.                        */
+/************************************************************************/
+
+int GDALDataset::EnterBlockIO( int bTryOnly )
+
+{
+    if( m_poBlockIOParent != NULL )
+        return m_poBlockIOParent->EnterBlockIO( bTryOnly );
+
+    const GIntBig nThisThread = CPLGetPID();
+
+    CPLCreateOrAcquireMutex( &m_hBlockIOMutex, 1000.0 );
+
+    while( m_nBlockIORecursion > 0 && m_nBlockIOOwner != nThisThread )
+    {
+        if( bTryOnly )
+        {
+            CPLReleaseMutex( m_hBlockIOMutex );
+            return FALSE;
+        }
+
+        if( m_hBlockIOCond == NULL )
+            m_hBlockIOCond = CPLCreateCond();
+        CPLCondWait( m_hBlockIOCond, m_hBlockIOMutex );
+    }
+
+    m_nBlockIOOwner = nThisThread;
+    m_nBlockIORecursion++;
+
+    CPLReleaseMutex( m_hBlockIOMutex );
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                            LeaveBlockIO()                            */
+/************************************************************************/
+
+void GDALDataset::LeaveBlockIO()
+
+{
+    if( m_poBlockIOParent != NULL )
+    {
+        m_poBlockIOParent->LeaveBlockIO();
+        return;
+    }
+
+    CPLAcquireMutex( m_hBlockIOMutex, 1000.0 );
+
+    CPLAssert( m_nBlockIORecursion > 0 && m_nBlockIOOwner == CPLGetPID() );
+
+    m_nBlockIORecursion--;
+    if( m_nBlockIORecursion == 0 && m_hBlockIOCond != NULL )
+        CPLCondBroadcast( m_hBlockIOCond );
+
+    CPLReleaseMutex( m_hBlockIOMutex );
+}
+
+/************************************************************************/
+/*                   IsBlockIOOwnedByCurrentThread()                    */
+/************************************************************************/
+
+int GDALDataset::IsBlockIOOwnedByCurrentThread()
+
+{
+    if( m_poBlockIOParent != NULL )
+        return m_poBlockIOParent->IsBlockIOOwnedByCurrentThread();
+
+    CPLCreateOrAcquireMutex( &m_hBlockIOMutex, 1000.0 );
+
+    int bRet = m_nBlockIORecursion > 0 && m_nBlockIOOwner == CPLGetPID();
+
+    CPLReleaseMutex( m_hBlockIOMutex );
+
+    return bRet;
+}
+
 /************************************************************************/
 /*                             FlushCache()                             */
 /************************************************************************/
@@ -326,6 +451,11 @@ GDALDataset::~GDALDataset()
  * to properly close a dataset and ensure that important data not addressed
  * by FlushCache() is written in the file.
  *
+ * When the block cache write-back threads are enabled (see the
+ * GDAL_CACHE_WRITEBACK_THREADS configuration option), this method waits for
+ * the write of a block of this dataset that might be in progress in one of
+ * those threads.
+ *
  * This method is the same as the C function GDALFlushCache().
  */
 
@@ -333,6 +463,7 @@ void GDALDataset::FlushCache()
 
 {
     int         i;
+    GDALBlockIOHolder oBlockIOHolder( this );
 
     // This sometimes happens if a dataset is destroyed before completely
     // built. 
@@ -380,6 +511,267 @@ void CPL_STDCALL GDALFlushCache( GDALDatasetH hDS )
     ((GDALDataset *) hDS)->FlushCache();
 }
 
+/************************************************************************/
+/*                           GetCacheStats()                            */
+/************************************************************************/
+
+/**
+ * \brief Fetch the block cache statistics of this dataset.
+ *
+ * The counters are the sums of the counters of the bands of the dataset
+ * (see GDALRasterBand::GetCacheStats()), and the nBlocks, nDirtyBlocks
+ * and nBytes fields describe the blocks of the bands of the dataset
+ * currently in the cache.  The overview and mask bands that belong to
+ * other datasets are not accounted for.
+ *
+ * This method is the same as the C function GDALGetDatasetCacheStats().
+ *
+ * @param psStats the structure to fill.
+ *
+ * @since GDAL 2.0
+ */
+
+void GDALDataset::GetCacheStats( GDALCacheStats *psStats )
+
+{
+    GDALRasterBlock::GetCacheStats( this, NULL, psStats );
+
+    for( int i = 0; i < nBands; i++ )
+    {
+        if( papoBands[i] == NULL )
+            continue;
+
+        psStats->nHits += (GUInt32) papoBands[i]->nCacheHits;
+        psStats->nMisses += (GUInt32) papoBands[i]->nCacheMisses;
+        psStats->nEvictions += (GUInt32) papoBands[i]->nCacheEvictions;
+        psStats->nDirtyFlushes += (GUInt32) papoBands[i]->nCacheDirtyFlushes;
+    }
+}
+
+/************************************************************************/
+/*                      GDALGetDatasetCacheStats()                      */
+/************************************************************************/
+
+/**
+ * \brief Fetch the block cache statistics of a dataset.
+ *
+ * @see GDALDataset::GetCacheStats()
+ *
+ * @since GDAL 2.0
+ */
+
+void CPL_STDCALL GDALGetDatasetCacheStats( GDALDatasetH hDS,
+                                           GDALCacheStats *psStats )
+
+{
+    VALIDATE_POINTER0( hDS, "GDALGetDatasetCacheStats" );
+    VALIDATE_POINTER0( psStats, "GDALGetDatasetCacheStats" );
+
+    ((GDALDataset *) hDS)->GetCacheStats( psStats );
+}
+
+/************************************************************************/
+/*                          ResetCacheStats()                           */
+/************************************************************************/
+
+/**
+ * \brief Reset the block cache counters of the bands of this dataset.
+ *
+ * @since GDAL 2.0
+ */
+
+void GDALDataset::ResetCacheStats()
+
+{
+    for( int i = 0; i < nBands; i++ )
+    {
+        if( papoBands[i] != NULL )
+            papoBands[i]->ResetCacheStats();
+    }
+}
+
+/************************************************************************/
+/*                          SetCachePriority()                          */
+/************************************************************************/
+
+/**
+ * \brief Set the block cache priority of the bands of this dataset.
+ *
+ * The priority is set on all the bands of the dataset and on their
+ * overviews.  See GDALRasterBand::SetCachePriority().
+ *
+ * This method is the same as the C function GDALSetDatasetCachePriority().
+ *
+ * @param ePriority the new priority.
+ *
+ * @since GDAL 2.0
+ */
+
+void GDALDataset::SetCachePriority( GDALCachePriority ePriority )
+
+{
+    for( int i = 0; i < nBands; i++ )
+    {
+        GDALRasterBand *poBand = papoBands[i];
+        if( poBand == NULL )
+            continue;
+
+        poBand->SetCachePriority( ePriority );
+        for( int iOvr = 0; iOvr < poBand->GetOverviewCount(); iOvr++ )
+        {
+            GDALRasterBand *poOvrBand = poBand->GetOverview( iOvr );
+            if( poOvrBand != NULL )
+                poOvrBand->SetCachePriority( ePriority );
+        }
+    }
+}
+
+/************************************************************************/
+/*                    GDALSetDatasetCachePriority()                     */
+/************************************************************************/
+
+/**
+ * \brief Set the block cache priority of the bands of a dataset.
+ *
+ * @see GDALDataset::SetCachePriority()
+ *
+ * @since GDAL 2.0
+ */
+
+void CPL_STDCALL GDALSetDatasetCachePriority( GDALDatasetH hDS,
+                                              GDALCachePriority ePriority )
+
+{
+    VALIDATE_POINTER0( hDS, "GDALSetDatasetCachePriority" );
+
+    ((GDALDataset *) hDS)->SetCachePriority( ePriority );
+}
+
+/************************************************************************/
+/*                           SetCacheQuota()                            */
+/************************************************************************/
+
+/**
+ * \brief Limit the block cache memory used by this dataset.
+ *
+ * Once the blocks of the bands of the dataset use more than the quota,
+ * the oldest of them are flushed (dirty blocks being written) when a new
+ * block of the dataset is added to the cache, independently of the global
+ * cache limit (GDALSetCacheMax()).  The blocks of overviews or masks that
+ * are held by other datasets are not accounted for.  Pinned blocks are
+ * never flushed, so the quota may be exceeded if they do not fit.
+ *
+ * Lowering the quota below the current use of the dataset flushes blocks
+ * immediately.
+ *
+ * This method is the same as the C function GDALSetDatasetCacheQuota().
+ *
+ * @param nQuotaInBytes the maximum number of bytes for the blocks of the
+ * dataset, or 0 for no quota (the default).
+ *
+ * @since GDAL 2.0
+ */
+
+void GDALDataset::SetCacheQuota( GIntBig nQuotaInBytes )
+
+{
+    m_nCacheQuota = MAX(0, nQuotaInBytes);
+
+    if( m_nCacheQuota == 0 )
+        return;
+
+    GDALBlockIOHolder oBlockIOHolder( this );
+
+    while( GetCacheUsed() > m_nCacheQuota
+           && GDALRasterBlock::FlushDatasetCacheBlock( this ) ) {}
+}
+
+/************************************************************************/
+/*                      GDALSetDatasetCacheQuota()                      */
+/************************************************************************/
+
+/**
+ * \brief Limit the block cache memory used by a dataset.
+ *
+ * @see GDALDataset::SetCacheQuota()
+ *
+ * @since GDAL 2.0
+ */
+
+void CPL_STDCALL GDALSetDatasetCacheQuota( GDALDatasetH hDS,
+                                           GIntBig nQuotaInBytes )
+
+{
+    VALIDATE_POINTER0( hDS, "GDALSetDatasetCacheQuota" );
+
+    ((GDALDataset *) hDS)->SetCacheQuota( nQuotaInBytes );
+}
+
+/************************************************************************/
+/*                           GetCacheQuota()                            */
+/************************************************************************/
+
+/**
+ * \brief Fetch the block cache quota of this dataset.
+ *
+ * This method is the same as the C function GDALGetDatasetCacheQuota().
+ *
+ * @return the quota in bytes, or 0 if the dataset has no quota.
+ *
+ * @since GDAL 2.0
+ */
+
+GIntBig GDALDataset::GetCacheQuota()
+
+{
+    return m_nCacheQuota;
+}
+
+/************************************************************************/
+/*                      GDALGetDatasetCacheQuota()                      */
+/************************************************************************/
+
+/**
+ * \brief Fetch the block cache quota of a dataset.
+ *
+ * @see GDALDataset::GetCacheQuota()
+ *
+ * @since GDAL 2.0
+ */
+
+GIntBig CPL_STDCALL GDALGetDatasetCacheQuota( GDALDatasetH hDS )
+
+{
+    VALIDATE_POINTER1( hDS, "GDALGetDatasetCacheQuota", 0 );
+
+    return ((GDALDataset *) hDS)->GetCacheQuota();
+}
+
+/************************************************************************/
+/*                            AddCacheUsed()                            */
+/*                                                                      */
+/*      Account for the blocks of the dataset added to, or removed      */
+/*      from, the block cache.  Called by GDALRasterBlock.              */
+/************************************************************************/
+
+void GDALDataset::AddCacheUsed( GIntBig nBytes )
+
+{
+    CPLMutexHolderD( &m_hCacheUsedMutex );
+    m_nCacheUsed += nBytes;
+}
+
+/************************************************************************/
+/*                            GetCacheUsed()                            */
+/************************************************************************/
+
+GIntBig GDALDataset::GetCacheUsed()
+
+{
+    CPLMutexHolderD( &m_hCacheUsedMutex );
+    return m_nCacheUsed;
+}
+
 /************************************************************************/
 /*                        BlockBasedFlushCache()                        */
 /*                                                                      */
@@ -1673,6 +2065,7 @@ CPLErr GDALDataset::RasterIO( GDALRWFlag eRWFlag,
     int i = 0;
     int bNeedToFreeBandMap = FALSE;
     CPLErr eErr = CE_None;
+    GDALBlockIOHolder oBlockIOHolder( this );
 
     if( NULL == pData )
     {
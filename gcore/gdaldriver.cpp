@@ -29,6 +29,7 @@
  ****************************************************************************/
 
 #include "gdal_priv.h"
+#include "cpl_atomic_ops.h"
 #include "ogrsf_frmts.h"
 
 CPL_CVSID("$Id$");
@@ -56,6 +57,9 @@ GDALDriver::GDALDriver()
     pfnOpenWithDriverArg = NULL;
     pfnCreateVectorOnly = NULL;
     pfnDeleteDataSource = NULL;
+
+    memset( (void *) anReadBlockLatencyHisto, 0,
+            sizeof(anReadBlockLatencyHisto) );
 }
 
 /************************************************************************/
@@ -393,6 +397,15 @@ GDALDataset *GDALDriver::DefaultCreateCopy( const char * pszFilename,
 /* -------------------------------------------------------------------- */
     char **papszCreateOptions = CSLDuplicate( papszOptions );
     int  iOptItem;
+
+    /* COPY_PIPELINE is handled here and is not a creation option of the driver */
+    int bCopyPipeline = CSLFetchBoolean( papszOptions, "COPY_PIPELINE", FALSE );
+    int iIdxCopyPipeline =
+        CSLPartialFindString( papszCreateOptions, "COPY_PIPELINE=" );
+    if( iIdxCopyPipeline >= 0 )
+        papszCreateOptions = CSLRemoveStrings( papszCreateOptions,
+                                               iIdxCopyPipeline, 1, NULL );
+
     static const char *apszOptItems[] = {
         "NBITS", "IMAGE_STRUCTURE",
         "PIXELTYPE", "IMAGE_STRUCTURE", 
@@ -568,9 +581,16 @@ GDALDataset *GDALDriver::DefaultCreateCopy( const char * pszFilename,
 /*      Copy image data.                                                */
 /* -------------------------------------------------------------------- */
     if( eErr == CE_None && nBands > 0 )
+    {
+        /* Overlap reading and writing if explicitly requested */
+        char* papszCopyWholeRasterOptions[2] = { NULL, NULL };
+        if( bCopyPipeline )
+            papszCopyWholeRasterOptions[0] = (char*) "PIPELINE=YES";
         eErr = GDALDatasetCopyWholeRaster( (GDALDatasetH) poSrcDS, 
                                            (GDALDatasetH) poDstDS, 
-                                           NULL, pfnProgress, pProgressData );
+                                           papszCopyWholeRasterOptions,
+                                           pfnProgress, pProgressData );
+    }
 
 /* -------------------------------------------------------------------- */
 /*      Should we copy some masks over?                                 */
@@ -640,6 +660,10 @@ GDALDataset *GDALDriver::DefaultCreateCopy( const char * pszFilename,
  * with the GDALValidateCreationOptions() method. This check can be disabled
  * by defining the configuration option GDAL_VALIDATE_CREATION_OPTIONS=NO.
  *
+ * When the default CreateCopy() mechanism is used, the COPY_PIPELINE=YES
+ * option can be passed to read the source from a separate thread while the
+ * previously read data is written. It is not passed to Create().
+ *
  * After you have finished working with the returned dataset, it is <b>required</b>
  * to close it with GDALClose(). This does not only close the file handle, but
  * also ensures that all the data and metadata has been written to the dataset
@@ -725,8 +749,23 @@ GDALDataset *GDALDriver::CreateCopy( const char * pszFilename,
 /* -------------------------------------------------------------------- */
 /*      Validate creation options.                                      */
 /* -------------------------------------------------------------------- */
+    int bUseDefaultCreateCopy = ( pfnCreateCopy == NULL ||
+        CSLTestBoolean(CPLGetConfigOption("GDAL_DEFAULT_CREATE_COPY", "NO")) );
     if (CSLTestBoolean(CPLGetConfigOption("GDAL_VALIDATE_CREATION_OPTIONS", "YES")))
-        GDALValidateCreationOptions( this, papszOptions);
+    {
+        /* COPY_PIPELINE is understood by DefaultCreateCopy() for all drivers */
+        int iIdxCopyPipeline = bUseDefaultCreateCopy ?
+            CSLPartialFindString(papszOptions, "COPY_PIPELINE=") : -1;
+        if( iIdxCopyPipeline >= 0 )
+        {
+            char** papszOptionsToValidate = CSLRemoveStrings(
+                CSLDuplicate(papszOptions), iIdxCopyPipeline, 1, NULL);
+            GDALValidateCreationOptions( this, papszOptionsToValidate);
+            CSLDestroy(papszOptionsToValidate);
+        }
+        else
+            GDALValidateCreationOptions( this, papszOptions);
+    }
 
 /* -------------------------------------------------------------------- */
 /*      If the format provides a CreateCopy() method use that,          */
@@ -734,7 +773,7 @@ GDALDataset *GDALDriver::CreateCopy( const char * pszFilename,
 /*      Create() method.                                                */
 /* -------------------------------------------------------------------- */
     GDALDataset *poDstDS;
-    if( pfnCreateCopy != NULL && !CSLTestBoolean(CPLGetConfigOption("GDAL_DEFAULT_CREATE_COPY", "NO")) )
+    if( !bUseDefaultCreateCopy )
     {
         poDstDS = pfnCreateCopy( pszFilename, poSrcDS, bStrict, papszOptions,
                                  pfnProgress, pProgressData );
@@ -1757,3 +1796,130 @@ CPLErr GDALDriver::SetMetadataItem( const char * pszName,
     }
     return GDALMajorObject::SetMetadataItem(pszName, pszValue, pszDomain);
 }
+
+/************************************************************************/
+/*                       RecordReadBlockLatency()                       */
+/************************************************************************/
+
+/**
+ * \brief Record the duration of an IReadBlock() call.
+ *
+ * This is called by GDALRasterBand for each block read through the
+ * driver, and may be called from several threads at once.
+ *
+ * @param nMicroseconds the duration of the call, in microseconds.
+ *
+ * @since GDAL 2.0
+ */
+
+void GDALDriver::RecordReadBlockLatency( GIntBig nMicroseconds )
+
+{
+    int iBucket = 0;
+
+    while( nMicroseconds >= 2 && iBucket < GDAL_READBLOCK_LATENCY_BUCKETS - 1 )
+    {
+        nMicroseconds >>= 1;
+        iBucket++;
+    }
+
+    CPLAtomicInc( &(anReadBlockLatencyHisto[iBucket]) );
+}
+
+/************************************************************************/
+/*                    GetReadBlockLatencyHistogram()                    */
+/************************************************************************/
+
+/**
+ * \brief Fetch the IReadBlock() latency histogram of the driver.
+ *
+ * Bucket i of the histogram counts the blocks whose reading took between
+ * 2^i and 2^(i+1) microseconds, the first bucket also counting the faster
+ * reads and the last one (GDAL_READBLOCK_LATENCY_BUCKETS - 1) the slower
+ * reads.  Only the reads done by the generic block cache code are
+ * recorded, since the last call to ResetReadBlockLatencyHistogram().
+ *
+ * This method is the same as the C function
+ * GDALGetDriverReadBlockLatencyHistogram().
+ *
+ * @param nBuckets the number of elements of panCounts.
+ * @param panCounts array where to return the counts.
+ *
+ * @return the number of buckets set, i.e. the minimum of nBuckets and
+ * GDAL_READBLOCK_LATENCY_BUCKETS.
+ *
+ * @since GDAL 2.0
+ */
+
+int GDALDriver::GetReadBlockLatencyHistogram( int nBuckets,
+                                              GIntBig *panCounts )
+
+{
+    nBuckets = MAX(0, MIN(nBuckets, GDAL_READBLOCK_LATENCY_BUCKETS));
+
+    for( int i = 0; i < nBuckets; i++ )
+        panCounts[i] = (GIntBig) (unsigned int) anReadBlockLatencyHisto[i];
+
+    return nBuckets;
+}
+
+/************************************************************************/
+/*               GDALGetDriverReadBlockLatencyHistogram()               */
+/************************************************************************/
+
+/**
+ * \brief Fetch the IReadBlock() latency histogram of a driver.
+ *
+ * @see GDALDriver::GetReadBlockLatencyHistogram()
+ *
+ * @since GDAL 2.0
+ */
+
+int CPL_STDCALL GDALGetDriverReadBlockLatencyHistogram( GDALDriverH hDriver,
+                                                        int nBuckets,
+                                                        GIntBig *panCounts )
+
+{
+    VALIDATE_POINTER1( hDriver, "GDALGetDriverReadBlockLatencyHistogram", 0 );
+    VALIDATE_POINTER1( panCounts, "GDALGetDriverReadBlockLatencyHistogram", 0 );
+
+    return ((GDALDriver *) hDriver)->GetReadBlockLatencyHistogram( nBuckets,
+                                                                 panCounts );
+}
+
+/************************************************************************/
+/*                   ResetReadBlockLatencyHistogram()                   */
+/************************************************************************/
+
+/**
+ * \brief Reset the IReadBlock() latency histogram of the driver.
+ *
+ * @since GDAL 2.0
+ */
+
+void GDALDriver::ResetReadBlockLatencyHistogram()
+
+{
+    for( int i = 0; i < GDAL_READBLOCK_LATENCY_BUCKETS; i++ )
+        anReadBlockLatencyHisto[i] = 0;
+}
+
+/************************************************************************/
+/*              GDALResetDriverReadBlockLatencyHistogram()              */
+/************************************************************************/
+
+/**
+ * \brief Reset the IReadBlock() latency histogram of a driver.
+ *
+ * @see GDALDriver::ResetReadBlockLatencyHistogram()
+ *
+ * @since GDAL 2.0
+ */
+
+void CPL_STDCALL GDALResetDriverReadBlockLatencyHistogram( GDALDriverH hDriver )
+
+{
+    VALIDATE_POINTER0( hDriver, "GDALResetDriverReadBlockLatencyHistogram" );
+
+    ((GDALDriver *) hDriver)->ResetReadBlockLatencyHistogram();
+}
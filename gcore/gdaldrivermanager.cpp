@@ -219,6 +219,12 @@ GDALDriverManager::~GDALDriverManager()
 /* -------------------------------------------------------------------- */
     PamCleanProxyDB();
 
+/* -------------------------------------------------------------------- */
+/*      Stop the worker threads, before the configuration options       */
+/*      and mutexes they may use go away.                               */
+/* -------------------------------------------------------------------- */
+    CPLCleanupThreadPool();
+
 /* -------------------------------------------------------------------- */
 /*      Blow away all the finder hints paths.  We really shouldn't      */
 /*      be doing all of them, but it is currently hard to keep track    */
@@ -33,10 +33,13 @@
 
 CPL_CVSID("$Id$");
 
-/* We *must* share the same mutex as the gdaldataset.cpp file, as we are */
-/* doing GDALOpen() calls that can indirectly call GDALOpenShared() on */
-/* an auxiliary dataset ... */
-/* Then we could get dead-locks in multi-threaded use case */
+/* The pool has its own mutex, that is only held for the bookkeeping of */
+/* the entries (hash lookups and LRU list updates). Underlying datasets */
+/* are opened and closed without holding it : they can indirectly call */
+/* GDALOpenShared() on an auxiliary dataset, or create/destroy proxy */
+/* datasets themselves, so holding a lock during those calls would */
+/* serialize all the threads doing I/O through the pool and expose us */
+/* to dead-locks with the mutex of gdaldataset.cpp */
 
 /* ******************************************************************** */
 /*                         GDALDatasetPool                              */
@@ -45,6 +48,11 @@ CPL_CVSID("$Id$");
 /* This class is a singleton that maintains a pool of opened datasets */
 /* The cache uses a LRU strategy */
 
+/* Several handles can be opened on the same file (for the same responsible */
+/* PID), so that threads doing I/O at the same time through the same */
+/* proxy dataset don't use the same underlying dataset. Their number is */
+/* capped by GDAL_MAX_DATASET_POOL_HANDLES_PER_FILE */
+
 class GDALDatasetPool;
 static GDALDatasetPool* singleton = NULL;
 
@@ -59,10 +67,68 @@ struct _GDALProxyPoolCacheEntry
     /* Ref count of the cached dataset */
     int           refCount;
 
+    /* Thread that took the first of the current references */
+    GIntBig       ownerTID;
+
+    /* Rank of the handle among the ones opened on the same file */
+    int           nSlot;
+
+    /* FALSE while the dataset is being opened by ownerTID */
+    int           bReady;
+
     GDALProxyPoolCacheEntry* prev;
     GDALProxyPoolCacheEntry* next;
 };
 
+/************************************************************************/
+/*                   GDALDatasetPoolNestingCounter()                    */
+/*                                                                      */
+/*      Number of pool-triggered opening or closing of datasets in      */
+/*      progress in the current thread.                                 */
+/************************************************************************/
+
+static int* GDALDatasetPoolNestingCounter()
+{
+    int* pnCounter = (int*) CPLGetTLS(CTLS_GDALDATASETPOOL);
+    if (pnCounter == NULL)
+    {
+        pnCounter = (int*) CPLCalloc(1, sizeof(int));
+        CPLSetTLS(CTLS_GDALDATASETPOOL, pnCounter, TRUE);
+    }
+    return pnCounter;
+}
+
+/************************************************************************/
+/*                     Hash set callbacks                               */
+/************************************************************************/
+
+static unsigned long GDALDatasetPoolHashEntry(const void* elt)
+{
+    const GDALProxyPoolCacheEntry* entry = (const GDALProxyPoolCacheEntry*) elt;
+    return CPLHashSetHashStr(entry->pszFileName) ^
+           (unsigned long)(entry->responsiblePID * 31 + entry->nSlot);
+}
+
+static int GDALDatasetPoolEqualEntry(const void* elt1, const void* elt2)
+{
+    const GDALProxyPoolCacheEntry* entry1 = (const GDALProxyPoolCacheEntry*) elt1;
+    const GDALProxyPoolCacheEntry* entry2 = (const GDALProxyPoolCacheEntry*) elt2;
+    return entry1->responsiblePID == entry2->responsiblePID &&
+           entry1->nSlot == entry2->nSlot &&
+           strcmp(entry1->pszFileName, entry2->pszFileName) == 0;
+}
+
+static unsigned long GDALDatasetPoolHashDS(const void* elt)
+{
+    return CPLHashSetHashPointer(((const GDALProxyPoolCacheEntry*) elt)->poDS);
+}
+
+static int GDALDatasetPoolEqualDS(const void* elt1, const void* elt2)
+{
+    return ((const GDALProxyPoolCacheEntry*) elt1)->poDS ==
+           ((const GDALProxyPoolCacheEntry*) elt2)->poDS;
+}
+
 class GDALDatasetPool
 {
     private:
@@ -73,13 +139,24 @@ class GDALDatasetPool
         int refCount;
 
         int maxSize;
+        int maxHandlesPerFile;
         int currentSize;
         GDALProxyPoolCacheEntry* firstEntry;
         GDALProxyPoolCacheEntry* lastEntry;
 
-        /* This variable prevents a dataset that is going to be opened in GDALDatasetPool::_RefDataset */
-        /* from increasing refCount if, during its opening, it creates a GDALProxyPoolDataset */
-        /* We increment it before opening or closing a cached dataset and decrement it afterwards */
+        /* Entries indexed by (filename, responsible PID, slot) and by */
+        /* underlying dataset */
+        CPLHashSet* hSetEntries;
+        CPLHashSet* hSetDatasets;
+
+        void* hMutex;
+
+        /* This variable prevents GDALProxyPoolDataset objects from taking */
+        /* or dropping references on the pool while the driver manager is */
+        /* being destroyed. */
+        /* The same is done, per thread, with GDALDatasetPoolNestingCounter() */
+        /* for a dataset that is going to be opened or closed by the pool */
+        /* if, during its opening, it creates a GDALProxyPoolDataset */
         /* The typical use case is a VRT made of simple sources that are VRT */
         /* We don't want the "inner" VRT to take a reference on the pool, otherwise there is */
         /* a high chance that this reference will not be dropped and the pool remain ghost */
@@ -87,11 +164,16 @@ class GDALDatasetPool
 
         /* Caution : to be sure that we don't run out of entries, size must be at */
         /* least greater or equal than the maximum number of threads */
-        GDALDatasetPool(int maxSize);
+        GDALDatasetPool(int maxSize, int maxHandlesPerFile);
         ~GDALDatasetPool();
         GDALProxyPoolCacheEntry* _RefDataset(const char* pszFileName,
                                              GDALAccess eAccess,
                                              char** papszOpenOptions);
+        void _UnrefDataset(GDALDataset* poDS);
+
+        void MoveToFront(GDALProxyPoolCacheEntry* cur);
+        void Unlink(GDALProxyPoolCacheEntry* cur);
+        static void CloseDataset(GDALProxyPoolCacheEntry* cur);
 
         void ShowContent();
         void CheckLinks();
@@ -103,6 +185,7 @@ class GDALDatasetPool
                                                    GDALAccess eAccess,
                                                    char** papszOpenOptions);
         static void UnrefDataset(GDALProxyPoolCacheEntry* cacheEntry);
+        static void UnrefDataset(GDALDataset* poDS);
 
         static void PreventDestroy();
         static void ForceDestroy();
@@ -113,14 +196,21 @@ class GDALDatasetPool
 /*                         GDALDatasetPool()                            */
 /************************************************************************/
 
-GDALDatasetPool::GDALDatasetPool(int maxSize)
+GDALDatasetPool::GDALDatasetPool(int maxSize, int maxHandlesPerFile)
 {
     this->maxSize = maxSize;
+    this->maxHandlesPerFile = maxHandlesPerFile;
     currentSize = 0;
     firstEntry = NULL;
     lastEntry = NULL;
     refCount = 0;
     refCountOfDisableRefCount = 0;
+    hSetEntries = CPLHashSetNew(GDALDatasetPoolHashEntry,
+                                GDALDatasetPoolEqualEntry, NULL);
+    hSetDatasets = CPLHashSetNew(GDALDatasetPoolHashDS,
+                                 GDALDatasetPoolEqualDS, NULL);
+    hMutex = CPLCreateMutex();
+    CPLReleaseMutex(hMutex);
 }
 
 /************************************************************************/
@@ -130,21 +220,18 @@ GDALDatasetPool::GDALDatasetPool(int maxSize)
 GDALDatasetPool::~GDALDatasetPool()
 {
     GDALProxyPoolCacheEntry* cur = firstEntry;
-    GIntBig responsiblePID = GDALGetResponsiblePIDForCurrentThread();
     while(cur)
     {
         GDALProxyPoolCacheEntry* next = cur->next;
-        CPLFree(cur->pszFileName);
         CPLAssert(cur->refCount == 0);
-        if (cur->poDS)
-        {
-            GDALSetResponsiblePIDForCurrentThread(cur->responsiblePID);
-            GDALClose(cur->poDS);
-        }
+        CloseDataset(cur);
+        CPLFree(cur->pszFileName);
         CPLFree(cur);
         cur = next;
     }
-    GDALSetResponsiblePIDForCurrentThread(responsiblePID);
+    CPLHashSetDestroy(hSetEntries);
+    CPLHashSetDestroy(hSetDatasets);
+    CPLDestroyMutex(hMutex);
 }
 
 /************************************************************************/
@@ -157,8 +244,8 @@ void GDALDatasetPool::ShowContent()
     int i = 0;
     while(cur)
     {
-        printf("[%d] pszFileName=%s, refCount=%d, responsiblePID=%d\n",
-               i, cur->pszFileName, cur->refCount, (int)cur->responsiblePID);
+        printf("[%d] pszFileName=%s, slot=%d, refCount=%d, responsiblePID=%d\n",
+               i, cur->pszFileName, cur->nSlot, cur->refCount, (int)cur->responsiblePID);
         i++;
         cur = cur->next;
     }
@@ -183,6 +270,70 @@ void GDALDatasetPool::CheckLinks()
     CPLAssert(i == currentSize);
 }
 
+/************************************************************************/
+/*                              Unlink()                                */
+/************************************************************************/
+
+void GDALDatasetPool::Unlink(GDALProxyPoolCacheEntry* cur)
+{
+    if (cur->prev)
+        cur->prev->next = cur->next;
+    else
+        firstEntry = cur->next;
+    if (cur->next)
+        cur->next->prev = cur->prev;
+    else
+        lastEntry = cur->prev;
+    cur->prev = NULL;
+    cur->next = NULL;
+}
+
+/************************************************************************/
+/*                            MoveToFront()                             */
+/************************************************************************/
+
+void GDALDatasetPool::MoveToFront(GDALProxyPoolCacheEntry* cur)
+{
+    if (cur == firstEntry)
+        return;
+    if (cur->prev != NULL || cur->next != NULL || cur == lastEntry)
+        Unlink(cur);
+    cur->next = firstEntry;
+    if (firstEntry)
+        firstEntry->prev = cur;
+    firstEntry = cur;
+    if (lastEntry == NULL)
+        lastEntry = cur;
+#ifdef DEBUG_PROXY_POOL
+    CheckLinks();
+#endif
+}
+
+/************************************************************************/
+/*                           CloseDataset()                             */
+/*                                                                      */
+/*      Must be called without holding the pool mutex.                 */
+/************************************************************************/
+
+void GDALDatasetPool::CloseDataset(GDALProxyPoolCacheEntry* cur)
+{
+    if (cur->poDS == NULL)
+        return;
+
+    /* Close by pretending we are the thread that GDALOpen'ed this */
+    /* dataset */
+    GIntBig responsiblePID = GDALGetResponsiblePIDForCurrentThread();
+    GDALSetResponsiblePIDForCurrentThread(cur->responsiblePID);
+
+    int* pnNesting = GDALDatasetPoolNestingCounter();
+    (*pnNesting) ++;
+    GDALClose(cur->poDS);
+    (*pnNesting) --;
+
+    cur->poDS = NULL;
+    GDALSetResponsiblePIDForCurrentThread(responsiblePID);
+}
+
 /************************************************************************/
 /*                            _RefDataset()                             */
 /************************************************************************/
@@ -191,49 +342,87 @@ GDALProxyPoolCacheEntry* GDALDatasetPool::_RefDataset(const char* pszFileName,
                                                       GDALAccess eAccess,
                                                       char** papszOpenOptions)
 {
-    GDALProxyPoolCacheEntry* cur = firstEntry;
     GIntBig responsiblePID = GDALGetResponsiblePIDForCurrentThread();
-    GDALProxyPoolCacheEntry* lastEntryWithZeroRefCount = NULL;
+    GIntBig nTID = CPLGetPID();
 
-    while(cur)
-    {
-        GDALProxyPoolCacheEntry* next = cur->next;
+    CPLAcquireMutex(hMutex, 1000.0);
 
-        if (strcmp(cur->pszFileName, pszFileName) == 0 &&
-            cur->responsiblePID == responsiblePID)
-        {
-            if (cur != firstEntry)
-            {
-                /* Move to begin */
-                if (cur->next)
-                    cur->next->prev = cur->prev;
-                else
-                    lastEntry = cur->prev;
-                cur->prev->next = cur->next;
-                cur->prev = NULL;
-                firstEntry->prev = cur;
-                cur->next = firstEntry;
-                firstEntry = cur;
+/* -------------------------------------------------------------------- */
+/*      Look for the handles already opened on that file : one that     */
+/*      the current thread already uses, then an idle one.              */
+/* -------------------------------------------------------------------- */
+    GDALProxyPoolCacheEntry sKey;
+    sKey.pszFileName = (char*) pszFileName;
+    sKey.responsiblePID = responsiblePID;
 
-#ifdef DEBUG_PROXY_POOL
-                CheckLinks();
-#endif
-            }
+    GDALProxyPoolCacheEntry* mine = NULL;
+    GDALProxyPoolCacheEntry* idle = NULL;
+    GDALProxyPoolCacheEntry* busy = NULL;
+    int nFreeSlot = -1;
 
-            cur->refCount ++;
-            return cur;
+    for( sKey.nSlot = 0; ; sKey.nSlot ++ )
+    {
+        GDALProxyPoolCacheEntry* cur = (GDALProxyPoolCacheEntry*)
+            CPLHashSetLookup(hSetEntries, &sKey);
+        if (cur == NULL)
+        {
+            if (nFreeSlot < 0)
+                nFreeSlot = sKey.nSlot;
+            if (sKey.nSlot + 1 >= maxHandlesPerFile)
+                break;
+            continue;
         }
 
+        if (cur->refCount > 0 && cur->ownerTID == nTID)
+        {
+            mine = cur;
+            break;
+        }
         if (cur->refCount == 0)
-            lastEntryWithZeroRefCount = cur;
+        {
+            if (idle == NULL)
+                idle = cur;
+        }
+        else if (cur->bReady &&
+                 (busy == NULL || cur->refCount < busy->refCount))
+            busy = cur;
+    }
 
-        cur = next;
+    GDALProxyPoolCacheEntry* cur = mine ? mine : idle;
+
+    /* All the allowed handles are in use by other threads : share the */
+    /* least used one */
+    if (cur == NULL && nFreeSlot >= maxHandlesPerFile)
+        cur = busy;
+
+    if (cur != NULL)
+    {
+        if (cur->refCount == 0)
+            cur->ownerTID = nTID;
+        cur->refCount ++;
+        MoveToFront(cur);
+        CPLReleaseMutex(hMutex);
+        return cur;
     }
 
+/* -------------------------------------------------------------------- */
+/*      We need a new handle. Recycle the least recently used idle      */
+/*      entry if the pool is full.                                      */
+/* -------------------------------------------------------------------- */
+    GDALProxyPoolCacheEntry sRecycled;
+    sRecycled.poDS = NULL;
+    sRecycled.pszFileName = NULL;
+
     if (currentSize == maxSize)
     {
-        if (lastEntryWithZeroRefCount == NULL)
+        for( cur = lastEntry; cur != NULL; cur = cur->prev )
         {
+            if (cur->refCount == 0)
+                break;
+        }
+        if (cur == NULL)
+        {
+            CPLReleaseMutex(hMutex);
             CPLError(CE_Failure, CPLE_AppDefined,
                      "Too many threads are running for the current value of the dataset pool size (%d).\n"
                      "or too many proxy datasets are opened in a cascaded way.\n"
@@ -241,75 +430,78 @@ GDALProxyPoolCacheEntry* GDALDatasetPool::_RefDataset(const char* pszFileName,
             return NULL;
         }
 
-        CPLFree(lastEntryWithZeroRefCount->pszFileName);
-        lastEntryWithZeroRefCount->pszFileName = NULL;
-        if (lastEntryWithZeroRefCount->poDS)
-        {
-            /* Close by pretending we are the thread that GDALOpen'ed this */
-            /* dataset */
-            GDALSetResponsiblePIDForCurrentThread(lastEntryWithZeroRefCount->responsiblePID);
-
-            refCountOfDisableRefCount ++;
-            GDALClose(lastEntryWithZeroRefCount->poDS);
-            refCountOfDisableRefCount --;
-
-            lastEntryWithZeroRefCount->poDS = NULL;
-            GDALSetResponsiblePIDForCurrentThread(responsiblePID);
-        }
+        Unlink(cur);
+        CPLHashSetRemove(hSetEntries, cur);
+        if (cur->poDS)
+            CPLHashSetRemove(hSetDatasets, cur);
 
-        /* Recycle this entry for the to-be-openeded dataset and */
-        /* moves it to the top of the list */
-        if (lastEntryWithZeroRefCount->prev)
-            lastEntryWithZeroRefCount->prev->next = lastEntryWithZeroRefCount->next;
-        else {
-            CPLAssert(0);
-        }
-        if (lastEntryWithZeroRefCount->next)
-            lastEntryWithZeroRefCount->next->prev = lastEntryWithZeroRefCount->prev;
-        else
-        {
-            CPLAssert(lastEntryWithZeroRefCount == lastEntry);
-            lastEntry->prev->next = NULL;
-            lastEntry = lastEntry->prev;
-        }
-        lastEntryWithZeroRefCount->prev = NULL;
-        lastEntryWithZeroRefCount->next = firstEntry;
-        firstEntry->prev = lastEntryWithZeroRefCount;
-        cur = firstEntry = lastEntryWithZeroRefCount;
-#ifdef DEBUG_PROXY_POOL
-        CheckLinks();
-#endif
+        /* Closed below, once the mutex is released */
+        sRecycled = *cur;
     }
     else
     {
-        /* Prepend */
         cur = (GDALProxyPoolCacheEntry*) CPLMalloc(sizeof(GDALProxyPoolCacheEntry));
-        if (lastEntry == NULL)
-            lastEntry = cur;
         cur->prev = NULL;
-        cur->next = firstEntry;
-        if (firstEntry)
-            firstEntry->prev = cur;
-        firstEntry = cur;
+        cur->next = NULL;
         currentSize ++;
-#ifdef DEBUG_PROXY_POOL
-        CheckLinks();
-#endif
     }
 
     cur->pszFileName = CPLStrdup(pszFileName);
     cur->responsiblePID = responsiblePID;
+    cur->nSlot = nFreeSlot;
+    cur->poDS = NULL;
     cur->refCount = 1;
+    cur->ownerTID = nTID;
+    cur->bReady = FALSE;
+    MoveToFront(cur);
+    CPLHashSetInsert(hSetEntries, cur);
+
+    CPLReleaseMutex(hMutex);
+
+    if (sRecycled.pszFileName != NULL)
+    {
+        CloseDataset(&sRecycled);
+        CPLFree(sRecycled.pszFileName);
+    }
 
-    refCountOfDisableRefCount ++;
+/* -------------------------------------------------------------------- */
+/*      Open the dataset. Other threads don't use this entry while it   */
+/*      is not ready.                                                   */
+/* -------------------------------------------------------------------- */
+    int* pnNesting = GDALDatasetPoolNestingCounter();
+    (*pnNesting) ++;
     int nFlag = ((eAccess == GA_Update) ? GDAL_OF_UPDATE : GDAL_OF_READONLY) | GDAL_OF_RASTER | GDAL_OF_VERBOSE_ERROR;
-    cur->poDS = (GDALDataset*) GDALOpenEx( pszFileName, nFlag, NULL,
+    GDALDataset* poDS = (GDALDataset*) GDALOpenEx( pszFileName, nFlag, NULL,
                            (const char* const* )papszOpenOptions, NULL );
-    refCountOfDisableRefCount --;
+    (*pnNesting) --;
+
+    CPLAcquireMutex(hMutex, 1000.0);
+    cur->poDS = poDS;
+    cur->bReady = TRUE;
+    if (poDS)
+        CPLHashSetInsert(hSetDatasets, cur);
+    CPLReleaseMutex(hMutex);
 
     return cur;
 }
 
+/************************************************************************/
+/*                           _UnrefDataset()                            */
+/************************************************************************/
+
+void GDALDatasetPool::_UnrefDataset(GDALDataset* poDS)
+{
+    GDALProxyPoolCacheEntry sKey;
+    sKey.poDS = poDS;
+
+    CPLMutexHolderD( &hMutex );
+    GDALProxyPoolCacheEntry* cur = (GDALProxyPoolCacheEntry*)
+        CPLHashSetLookup(hSetDatasets, &sKey);
+    CPLAssert(cur != NULL && cur->refCount > 0);
+    if (cur != NULL)
+        cur->refCount --;
+}
+
 /************************************************************************/
 /*                                 Ref()                                */
 /************************************************************************/
@@ -322,9 +514,14 @@ void GDALDatasetPool::Ref()
         int maxSize = atoi(CPLGetConfigOption("GDAL_MAX_DATASET_POOL_SIZE", "100"));
         if (maxSize < 2 || maxSize > 1000)
             maxSize = 100;
-        singleton = new GDALDatasetPool(maxSize);
+        int maxHandlesPerFile = atoi(CPLGetConfigOption(
+                            "GDAL_MAX_DATASET_POOL_HANDLES_PER_FILE", "8"));
+        if (maxHandlesPerFile < 1)
+            maxHandlesPerFile = 1;
+        singleton = new GDALDatasetPool(maxSize, maxHandlesPerFile);
     }
-    if (singleton->refCountOfDisableRefCount == 0)
+    if (singleton->refCountOfDisableRefCount == 0 &&
+        *GDALDatasetPoolNestingCounter() == 0)
       singleton->refCount++;
 }
 
@@ -356,12 +553,16 @@ void GDALDatasetPool::Unref()
         CPLAssert(0);
         return;
     }
-    if (singleton->refCountOfDisableRefCount == 0)
+    if (singleton->refCountOfDisableRefCount == 0 &&
+        *GDALDatasetPoolNestingCounter() == 0)
     {
       singleton->refCount--;
       if (singleton->refCount == 0)
       {
+          int* pnNesting = GDALDatasetPoolNestingCounter();
+          (*pnNesting) ++;
           delete singleton;
+          (*pnNesting) --;
           singleton = NULL;
       }
     }
@@ -376,7 +577,10 @@ void GDALDatasetPool::ForceDestroy()
     singleton->refCountOfDisableRefCount --;
     CPLAssert(singleton->refCountOfDisableRefCount == 0);
     singleton->refCount = 0;
+    int* pnNesting = GDALDatasetPoolNestingCounter();
+    (*pnNesting) ++;
     delete singleton;
+    (*pnNesting) --;
     singleton = NULL;
 }
 
@@ -394,7 +598,7 @@ GDALProxyPoolCacheEntry* GDALDatasetPool::RefDataset(const char* pszFileName,
                                                      GDALAccess eAccess,
                                                      char** papszOpenOptions)
 {
-    CPLMutexHolderD( GDALGetphDLMutex() );
+    /* The singleton cannot go away while a proxy dataset is alive */
     return singleton->_RefDataset(pszFileName, eAccess, papszOpenOptions);
 }
 
@@ -404,10 +608,15 @@ GDALProxyPoolCacheEntry* GDALDatasetPool::RefDataset(const char* pszFileName,
 
 void GDALDatasetPool::UnrefDataset(GDALProxyPoolCacheEntry* cacheEntry)
 {
-    CPLMutexHolderD( GDALGetphDLMutex() );
+    CPLMutexHolderD( &(singleton->hMutex) );
     cacheEntry->refCount --;
 }
 
+void GDALDatasetPool::UnrefDataset(GDALDataset* poDS)
+{
+    singleton->_UnrefDataset(poDS);
+}
+
 CPL_C_START
 
 typedef struct
@@ -605,7 +814,8 @@ GDALDataset* GDALProxyPoolDataset::RefUnderlyingDataset()
     /* a VRT of GeoTIFFs that have associated .aux files */
     GIntBig curResponsiblePID = GDALGetResponsiblePIDForCurrentThread();
     GDALSetResponsiblePIDForCurrentThread(responsiblePID);
-    cacheEntry = GDALDatasetPool::RefDataset(GetDescription(), eAccess, papszOpenOptions);
+    GDALProxyPoolCacheEntry* cacheEntry =
+        GDALDatasetPool::RefDataset(GetDescription(), eAccess, papszOpenOptions);
     GDALSetResponsiblePIDForCurrentThread(curResponsiblePID);
     if (cacheEntry != NULL)
     {
@@ -621,14 +831,12 @@ GDALDataset* GDALProxyPoolDataset::RefUnderlyingDataset()
 /*                    UnrefUnderlyingDataset()                        */
 /************************************************************************/
 
-void GDALProxyPoolDataset::UnrefUnderlyingDataset(CPL_UNUSED GDALDataset* poUnderlyingDataset)
+void GDALProxyPoolDataset::UnrefUnderlyingDataset(GDALDataset* poUnderlyingDataset)
 {
-    if (cacheEntry != NULL)
-    {
-        CPLAssert(cacheEntry->poDS == poUnderlyingDataset);
-        if (cacheEntry->poDS != NULL)
-            GDALDatasetPool::UnrefDataset(cacheEntry);
-    }
+    /* Several threads may be doing I/O through this object with */
+    /* different underlying datasets, so find the entry from the dataset */
+    if (poUnderlyingDataset != NULL)
+        GDALDatasetPool::UnrefDataset(poUnderlyingDataset);
 }
 
 /************************************************************************/
@@ -1175,8 +1383,7 @@ GDALProxyPoolOverviewRasterBand::GDALProxyPoolOverviewRasterBand(GDALProxyPoolDa
     this->poMainBand = poMainBand;
     this->nOverviewBand = nOverviewBand;
 
-    poUnderlyingMainRasterBand = NULL;
-    nRefCountUnderlyingMainRasterBand = 0;
+    hMainBandMutex = NULL;
 }
 
 /* ******************************************************************** */
@@ -1185,7 +1392,9 @@ GDALProxyPoolOverviewRasterBand::GDALProxyPoolOverviewRasterBand(GDALProxyPoolDa
 
 GDALProxyPoolOverviewRasterBand::~GDALProxyPoolOverviewRasterBand()
 {
-    CPLAssert(nRefCountUnderlyingMainRasterBand == 0);
+    CPLAssert(oMapUnderlyingMainRasterBand.empty());
+    if (hMainBandMutex != NULL)
+        CPLDestroyMutex(hMainBandMutex);
 }
 
 /* ******************************************************************** */
@@ -1194,22 +1403,53 @@ GDALProxyPoolOverviewRasterBand::~GDALProxyPoolOverviewRasterBand()
 
 GDALRasterBand* GDALProxyPoolOverviewRasterBand::RefUnderlyingRasterBand()
 {
-    poUnderlyingMainRasterBand = poMainBand->RefUnderlyingRasterBand();
+    GDALRasterBand* poUnderlyingMainRasterBand = poMainBand->RefUnderlyingRasterBand();
     if (poUnderlyingMainRasterBand == NULL)
         return NULL;
 
-    nRefCountUnderlyingMainRasterBand ++;
-    return poUnderlyingMainRasterBand->GetOverview(nOverviewBand);
+    GDALRasterBand* poUnderlyingRasterBand = poUnderlyingMainRasterBand->GetOverview(nOverviewBand);
+    if (poUnderlyingRasterBand == NULL)
+    {
+        poMainBand->UnrefUnderlyingRasterBand(poUnderlyingMainRasterBand);
+        return NULL;
+    }
+
+    /* Remember the main band, which depends on the underlying dataset */
+    /* handle that was given to this thread */
+    CPLMutexHolderD(&hMainBandMutex);
+    std::pair<GDALRasterBand*, int>& oEntry =
+        oMapUnderlyingMainRasterBand[poUnderlyingRasterBand];
+    oEntry.first = poUnderlyingMainRasterBand;
+    oEntry.second ++;
+
+    return poUnderlyingRasterBand;
 }
 
 /* ******************************************************************** */
 /*                  UnrefUnderlyingRasterBand()                         */
 /* ******************************************************************** */
 
-void GDALProxyPoolOverviewRasterBand::UnrefUnderlyingRasterBand(CPL_UNUSED GDALRasterBand* poUnderlyingRasterBand)
+void GDALProxyPoolOverviewRasterBand::UnrefUnderlyingRasterBand(GDALRasterBand* poUnderlyingRasterBand)
 {
+    if (poUnderlyingRasterBand == NULL)
+        return;
+
+    GDALRasterBand* poUnderlyingMainRasterBand;
+    {
+        CPLMutexHolderD(&hMainBandMutex);
+        std::map<GDALRasterBand*, std::pair<GDALRasterBand*, int> >::iterator oIter =
+            oMapUnderlyingMainRasterBand.find(poUnderlyingRasterBand);
+        if (oIter == oMapUnderlyingMainRasterBand.end())
+        {
+            CPLAssert(FALSE);
+            return;
+        }
+        poUnderlyingMainRasterBand = oIter->second.first;
+        if (--oIter->second.second == 0)
+            oMapUnderlyingMainRasterBand.erase(oIter);
+    }
+
     poMainBand->UnrefUnderlyingRasterBand(poUnderlyingMainRasterBand);
-    nRefCountUnderlyingMainRasterBand --;
 }
 
 
@@ -1224,8 +1464,7 @@ GDALProxyPoolMaskBand::GDALProxyPoolMaskBand(GDALProxyPoolDataset* poDS,
 {
     this->poMainBand = poMainBand;
 
-    poUnderlyingMainRasterBand = NULL;
-    nRefCountUnderlyingMainRasterBand = 0;
+    hMainBandMutex = NULL;
 }
 
 /* ******************************************************************** */
@@ -1240,8 +1479,7 @@ GDALProxyPoolMaskBand::GDALProxyPoolMaskBand(GDALProxyPoolDataset* poDS,
 {
     this->poMainBand = poMainBand;
 
-    poUnderlyingMainRasterBand = NULL;
-    nRefCountUnderlyingMainRasterBand = 0;
+    hMainBandMutex = NULL;
 }
 
 /* ******************************************************************** */
@@ -1250,7 +1488,9 @@ GDALProxyPoolMaskBand::GDALProxyPoolMaskBand(GDALProxyPoolDataset* poDS,
 
 GDALProxyPoolMaskBand::~GDALProxyPoolMaskBand()
 {
-    CPLAssert(nRefCountUnderlyingMainRasterBand == 0);
+    CPLAssert(oMapUnderlyingMainRasterBand.empty());
+    if (hMainBandMutex != NULL)
+        CPLDestroyMutex(hMainBandMutex);
 }
 
 /* ******************************************************************** */
@@ -1259,20 +1499,51 @@ GDALProxyPoolMaskBand::~GDALProxyPoolMaskBand()
 
 GDALRasterBand* GDALProxyPoolMaskBand::RefUnderlyingRasterBand()
 {
-    poUnderlyingMainRasterBand = poMainBand->RefUnderlyingRasterBand();
+    GDALRasterBand* poUnderlyingMainRasterBand = poMainBand->RefUnderlyingRasterBand();
     if (poUnderlyingMainRasterBand == NULL)
         return NULL;
 
-    nRefCountUnderlyingMainRasterBand ++;
-    return poUnderlyingMainRasterBand->GetMaskBand();
+    GDALRasterBand* poUnderlyingRasterBand = poUnderlyingMainRasterBand->GetMaskBand();
+    if (poUnderlyingRasterBand == NULL)
+    {
+        poMainBand->UnrefUnderlyingRasterBand(poUnderlyingMainRasterBand);
+        return NULL;
+    }
+
+    /* Remember the main band, which depends on the underlying dataset */
+    /* handle that was given to this thread */
+    CPLMutexHolderD(&hMainBandMutex);
+    std::pair<GDALRasterBand*, int>& oEntry =
+        oMapUnderlyingMainRasterBand[poUnderlyingRasterBand];
+    oEntry.first = poUnderlyingMainRasterBand;
+    oEntry.second ++;
+
+    return poUnderlyingRasterBand;
 }
 
 /* ******************************************************************** */
 /*                  UnrefUnderlyingRasterBand()                         */
 /* ******************************************************************** */
 
-void GDALProxyPoolMaskBand::UnrefUnderlyingRasterBand(CPL_UNUSED GDALRasterBand* poUnderlyingRasterBand)
+void GDALProxyPoolMaskBand::UnrefUnderlyingRasterBand(GDALRasterBand* poUnderlyingRasterBand)
 {
+    if (poUnderlyingRasterBand == NULL)
+        return;
+
+    GDALRasterBand* poUnderlyingMainRasterBand;
+    {
+        CPLMutexHolderD(&hMainBandMutex);
+        std::map<GDALRasterBand*, std::pair<GDALRasterBand*, int> >::iterator oIter =
+            oMapUnderlyingMainRasterBand.find(poUnderlyingRasterBand);
+        if (oIter == oMapUnderlyingMainRasterBand.end())
+        {
+            CPLAssert(FALSE);
+            return;
+        }
+        poUnderlyingMainRasterBand = oIter->second.first;
+        if (--oIter->second.second == 0)
+            oMapUnderlyingMainRasterBand.erase(oIter);
+    }
+
     poMainBand->UnrefUnderlyingRasterBand(poUnderlyingMainRasterBand);
-    nRefCountUnderlyingMainRasterBand --;
 }
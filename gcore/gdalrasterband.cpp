@@ -71,6 +71,15 @@ GDALRasterBand::GDALRasterBand()
         CPLGetConfigOption( "GDAL_FORCE_CACHING", "NO") );
 
     eFlushBlockErr = CE_None;
+
+    nCacheHits = 0;
+    nCacheMisses = 0;
+    nCacheEvictions = 0;
+    nCacheDirtyFlushes = 0;
+
+    eCachePriority = GCPRI_Normal;
+
+    bInResampledRasterIO = FALSE;
 }
 
 /************************************************************************/
@@ -175,6 +184,7 @@ CPLErr GDALRasterBand::RasterIO( GDALRWFlag eRWFlag,
                                  int nLineSpace )
 
 {
+    GDALBlockIOHolder oBlockIOHolder( poDS );
 
     if( NULL == pData )
     {
@@ -378,6 +388,8 @@ CPLErr GDALRasterBand::ReadBlock( int nXBlockOff, int nYBlockOff,
                                    void * pImage )
 
 {
+    GDALBlockIOHolder oBlockIOHolder( poDS );
+
 /* -------------------------------------------------------------------- */
 /*      Validate arguments.                                             */
 /* -------------------------------------------------------------------- */
@@ -409,7 +421,30 @@ CPLErr GDALRasterBand::ReadBlock( int nXBlockOff, int nYBlockOff,
 /* -------------------------------------------------------------------- */
 /*      Invoke underlying implementation method.                        */
 /* -------------------------------------------------------------------- */
-    return( IReadBlock( nXBlockOff, nYBlockOff, pImage ) );
+    return( IReadBlockTimed( nXBlockOff, nYBlockOff, pImage ) );
+}
+
+/************************************************************************/
+/*                          IReadBlockTimed()                           */
+/*                                                                      */
+/*      Call IReadBlock(), recording its duration in the latency        */
+/*      histogram of the driver.                                        */
+/************************************************************************/
+
+CPLErr GDALRasterBand::IReadBlockTimed( int nXBlockOff, int nYBlockOff,
+                                        void *pImage )
+
+{
+    GDALDriver *poDriver = (poDS != NULL) ? poDS->GetDriver() : NULL;
+
+    if( poDriver == NULL )
+        return IReadBlock( nXBlockOff, nYBlockOff, pImage );
+
+    GIntBig nStart = GDALGetMicroSecondCounter();
+    CPLErr eErr = IReadBlock( nXBlockOff, nYBlockOff, pImage );
+    poDriver->RecordReadBlockLatency( GDALGetMicroSecondCounter() - nStart );
+
+    return eErr;
 }
 
 /************************************************************************/
@@ -481,6 +516,8 @@ CPLErr GDALRasterBand::WriteBlock( int nXBlockOff, int nYBlockOff,
                                    void * pImage )
 
 {
+    GDALBlockIOHolder oBlockIOHolder( poDS );
+
 /* -------------------------------------------------------------------- */
 /*      Validate arguments.                                             */
 /* -------------------------------------------------------------------- */
@@ -850,6 +887,7 @@ CPLErr GDALRasterBand::AdoptBlock( int nXBlockOff, int nYBlockOff,
 CPLErr GDALRasterBand::FlushCache()
 
 {
+    GDALBlockIOHolder oBlockIOHolder( poDS );
     CPLErr eGlobalErr = eFlushBlockErr;
 
     if (eFlushBlockErr != CE_None)
@@ -996,7 +1034,8 @@ CPLErr GDALRasterBand::FlushBlock( int nXBlockOff, int nYBlockOff, int bWriteDir
     {
         nBlockIndex = nXBlockOff + nYBlockOff * nBlocksPerRow;
 
-        GDALRasterBlock::SafeLockBlock( papoBlocks + nBlockIndex );
+        GDALRasterBlock::SafeLockBlock( papoBlocks + nBlockIndex, this,
+                                        nXBlockOff, nYBlockOff );
 
         poBlock = papoBlocks[nBlockIndex];
         papoBlocks[nBlockIndex] = NULL;
@@ -1022,7 +1061,8 @@ CPLErr GDALRasterBand::FlushBlock( int nXBlockOff, int nYBlockOff, int bWriteDir
         int nBlockInSubBlock = WITHIN_SUBBLOCK(nXBlockOff)
             + WITHIN_SUBBLOCK(nYBlockOff) * SUBBLOCK_SIZE;
         
-        GDALRasterBlock::SafeLockBlock( papoSubBlockGrid + nBlockInSubBlock );
+        GDALRasterBlock::SafeLockBlock( papoSubBlockGrid + nBlockInSubBlock,
+                                        this, nXBlockOff, nYBlockOff );
 
         poBlock = papoSubBlockGrid[nBlockInSubBlock];
         papoSubBlockGrid[nBlockInSubBlock] = NULL;
@@ -1113,7 +1153,8 @@ GDALRasterBlock *GDALRasterBand::TryGetLockedBlockRef( int nXBlockOff,
     {
         nBlockIndex = nXBlockOff + nYBlockOff * nBlocksPerRow;
         
-        GDALRasterBlock::SafeLockBlock( papoBlocks + nBlockIndex );
+        GDALRasterBlock::SafeLockBlock( papoBlocks + nBlockIndex, this,
+                                        nXBlockOff, nYBlockOff, TRUE );
 
         return papoBlocks[nBlockIndex];
     }
@@ -1136,7 +1177,8 @@ GDALRasterBlock *GDALRasterBand::TryGetLockedBlockRef( int nXBlockOff,
     int nBlockInSubBlock = WITHIN_SUBBLOCK(nXBlockOff)
         + WITHIN_SUBBLOCK(nYBlockOff) * SUBBLOCK_SIZE;
 
-    GDALRasterBlock::SafeLockBlock( papoSubBlockGrid + nBlockInSubBlock );
+    GDALRasterBlock::SafeLockBlock( papoSubBlockGrid + nBlockInSubBlock,
+                                    this, nXBlockOff, nYBlockOff, TRUE );
 
     return papoSubBlockGrid[nBlockInSubBlock];
 }
@@ -1194,6 +1236,8 @@ GDALRasterBlock * GDALRasterBand::GetLockedBlockRef( int nXBlockOff,
 /* -------------------------------------------------------------------- */
     if( poBlock == NULL )
     {
+        GDALBlockIOHolder oBlockIOHolder( poDS );
+
         if( !InitBlockInfo() )
             return( NULL );
 
@@ -1240,7 +1284,7 @@ GDALRasterBlock * GDALRasterBand::GetLockedBlockRef( int nXBlockOff,
         }
 
         if( !bJustInitialize
-         && IReadBlock(nXBlockOff,nYBlockOff,poBlock->GetDataRef()) != CE_None)
+         && IReadBlockTimed(nXBlockOff,nYBlockOff,poBlock->GetDataRef()) != CE_None)
         {
             poBlock->DropLock();
             FlushBlock( nXBlockOff, nYBlockOff );
@@ -2658,446 +2702,6 @@ GDALDatasetH CPL_STDCALL GDALGetBandDataset( GDALRasterBandH hBand )
     return (GDALDatasetH) poBand->GetDataset();
 }
 
-/************************************************************************/
-/*                            GetHistogram()                            */
-/************************************************************************/
-
-/**
- * \brief Compute raster histogram. 
- *
- * Note that the bucket size is (dfMax-dfMin) / nBuckets.  
- *
- * For example to compute a simple 256 entry histogram of eight bit data, 
- * the following would be suitable.  The unusual bounds are to ensure that
- * bucket boundaries don't fall right on integer values causing possible errors
- * due to rounding after scaling. 
-<pre>
-    int anHistogram[256];
-
-    poBand->GetHistogram( -0.5, 255.5, 256, anHistogram, FALSE, FALSE, 
-                          GDALDummyProgress, NULL );
-</pre>
- *
- * Note that setting bApproxOK will generally result in a subsampling of the
- * file, and will utilize overviews if available.  It should generally 
- * produce a representative histogram for the data that is suitable for use
- * in generating histogram based luts for instance.  Generally bApproxOK is
- * much faster than an exactly computed histogram.
- *
- * This method is the same as the C function GDALGetRasterHistogram().
- *
- * @param dfMin the lower bound of the histogram.
- * @param dfMax the upper bound of the histogram.
- * @param nBuckets the number of buckets in panHistogram.
- * @param panHistogram array into which the histogram totals are placed.
- * @param bIncludeOutOfRange if TRUE values below the histogram range will
- * mapped into panHistogram[0], and values above will be mapped into 
- * panHistogram[nBuckets-1] otherwise out of range values are discarded.
- * @param bApproxOK TRUE if an approximate, or incomplete histogram OK.
- * @param pfnProgress function to report progress to completion. 
- * @param pProgressData application data to pass to pfnProgress. 
- *
- * @return CE_None on success, or CE_Failure if something goes wrong. 
- */
-
-CPLErr GDALRasterBand::GetHistogram( double dfMin, double dfMax, 
-                                     int nBuckets, int *panHistogram, 
-                                     int bIncludeOutOfRange, int bApproxOK,
-                                     GDALProgressFunc pfnProgress, 
-                                     void *pProgressData )
-
-{
-    CPLAssert( NULL != panHistogram );
-
-    if( pfnProgress == NULL )
-        pfnProgress = GDALDummyProgress;
-
-/* -------------------------------------------------------------------- */
-/*      If we have overviews, use them for the histogram.               */
-/* -------------------------------------------------------------------- */
-    if( bApproxOK && GetOverviewCount() > 0 && !HasArbitraryOverviews() )
-    {
-        // FIXME: should we use the most reduced overview here or use some
-        // minimum number of samples like GDALRasterBand::ComputeStatistics()
-        // does?
-        GDALRasterBand *poBestOverview = GetRasterSampleOverview( 0 );
-        
-        if( poBestOverview != this )
-        {
-            return poBestOverview->GetHistogram( dfMin, dfMax, nBuckets,
-                                                 panHistogram,
-                                                 bIncludeOutOfRange, bApproxOK,
-                                                 pfnProgress, pProgressData );
-        }
-    }
-
-/* -------------------------------------------------------------------- */
-/*      Read actual data and build histogram.                           */
-/* -------------------------------------------------------------------- */
-    double      dfScale;
-
-    if( !pfnProgress( 0.0, "Compute Histogram", pProgressData ) )
-    {
-        ReportError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
-        return CE_Failure;
-    }
-
-    dfScale = nBuckets / (dfMax - dfMin);
-    memset( panHistogram, 0, sizeof(int) * nBuckets );
-
-    double dfNoDataValue;
-    int bGotNoDataValue;
-    dfNoDataValue = GetNoDataValue( &bGotNoDataValue );
-    bGotNoDataValue = bGotNoDataValue && !CPLIsNan(dfNoDataValue);
-    /* Not advertized. May be removed at any time. Just as a provision if the */
-    /* old behaviour made sense somethimes... */
-    bGotNoDataValue = bGotNoDataValue &&
-        !CSLTestBoolean(CPLGetConfigOption("GDAL_NODATA_IN_HISTOGRAM", "NO"));
-
-    const char* pszPixelType = GetMetadataItem("PIXELTYPE", "IMAGE_STRUCTURE");
-    int bSignedByte = (pszPixelType != NULL && EQUAL(pszPixelType, "SIGNEDBYTE"));
-
-    if ( bApproxOK && HasArbitraryOverviews() )
-    {
-/* -------------------------------------------------------------------- */
-/*      Figure out how much the image should be reduced to get an       */
-/*      approximate value.                                              */
-/* -------------------------------------------------------------------- */
-        void    *pData;
-        int     nXReduced, nYReduced;
-        double  dfReduction = sqrt(
-            (double)nRasterXSize * nRasterYSize / GDALSTAT_APPROX_NUMSAMPLES );
-
-        if ( dfReduction > 1.0 )
-        {
-            nXReduced = (int)( nRasterXSize / dfReduction );
-            nYReduced = (int)( nRasterYSize / dfReduction );
-
-            // Catch the case of huge resizing ratios here
-            if ( nXReduced == 0 )
-                nXReduced = 1;
-            if ( nYReduced == 0 )
-                nYReduced = 1;
-        }
-        else
-        {
-            nXReduced = nRasterXSize;
-            nYReduced = nRasterYSize;
-        }
-
-        pData =
-            CPLMalloc(GDALGetDataTypeSize(eDataType)/8 * nXReduced * nYReduced);
-
-        CPLErr eErr = IRasterIO( GF_Read, 0, 0, nRasterXSize, nRasterYSize, pData,
-                   nXReduced, nYReduced, eDataType, 0, 0 );
-        if ( eErr != CE_None )
-        {
-            CPLFree(pData);
-            return eErr;
-        }
-        
-        /* this isn't the fastest way to do this, but is easier for now */
-        for( int iY = 0; iY < nYReduced; iY++ )
-        {
-            for( int iX = 0; iX < nXReduced; iX++ )
-            {
-                int    iOffset = iX + iY * nXReduced;
-                int    nIndex;
-                double dfValue = 0.0;
-
-                switch( eDataType )
-                {
-                  case GDT_Byte:
-                  {
-                    if (bSignedByte)
-                        dfValue = ((signed char *)pData)[iOffset];
-                    else
-                        dfValue = ((GByte *)pData)[iOffset];
-                    break;
-                  }
-                  case GDT_UInt16:
-                    dfValue = ((GUInt16 *)pData)[iOffset];
-                    break;
-                  case GDT_Int16:
-                    dfValue = ((GInt16 *)pData)[iOffset];
-                    break;
-                  case GDT_UInt32:
-                    dfValue = ((GUInt32 *)pData)[iOffset];
-                    break;
-                  case GDT_Int32:
-                    dfValue = ((GInt32 *)pData)[iOffset];
-                    break;
-                  case GDT_Float32:
-                    dfValue = ((float *)pData)[iOffset];
-                    if (CPLIsNan(dfValue))
-                        continue;
-                    break;
-                  case GDT_Float64:
-                    dfValue = ((double *)pData)[iOffset];
-                    if (CPLIsNan(dfValue))
-                        continue;
-                    break;
-                  case GDT_CInt16:
-                    {
-                        double dfReal = ((GInt16 *)pData)[iOffset*2];
-                        double dfImag = ((GInt16 *)pData)[iOffset*2+1];
-                        if ( CPLIsNan(dfReal) || CPLIsNan(dfImag) )
-                            continue;
-                        dfValue = sqrt( dfReal * dfReal + dfImag * dfImag );
-                    }
-                    break;
-                  case GDT_CInt32:
-                    {
-                        double dfReal = ((GInt32 *)pData)[iOffset*2];
-                        double dfImag = ((GInt32 *)pData)[iOffset*2+1];
-                        if ( CPLIsNan(dfReal) || CPLIsNan(dfImag) )
-                            continue;
-                        dfValue = sqrt( dfReal * dfReal + dfImag * dfImag );
-                    }
-                    break;
-                  case GDT_CFloat32:
-                    {
-                        double dfReal = ((float *)pData)[iOffset*2];
-                        double dfImag = ((float *)pData)[iOffset*2+1];
-                        if ( CPLIsNan(dfReal) || CPLIsNan(dfImag) )
-                            continue;
-                        dfValue = sqrt( dfReal * dfReal + dfImag * dfImag );
-                    }
-                    break;
-                  case GDT_CFloat64:
-                    {
-                        double dfReal = ((double *)pData)[iOffset*2];
-                        double dfImag = ((double *)pData)[iOffset*2+1];
-                        if ( CPLIsNan(dfReal) || CPLIsNan(dfImag) )
-                            continue;
-                        dfValue = sqrt( dfReal * dfReal + dfImag * dfImag );
-                    }
-                    break;
-                  default:
-                    CPLAssert( FALSE );
-                }
-
-                if( bGotNoDataValue && ARE_REAL_EQUAL(dfValue, dfNoDataValue) )
-                    continue;
-
-                nIndex = (int) floor((dfValue - dfMin) * dfScale);
-                
-                if( nIndex < 0 )
-                {
-                    if( bIncludeOutOfRange )
-                        panHistogram[0]++;
-                }
-                else if( nIndex >= nBuckets )
-                {
-                    if( bIncludeOutOfRange )
-                        panHistogram[nBuckets-1]++;
-                }
-                else
-                {
-                    panHistogram[nIndex]++;
-                }
-            }
-        }
-
-        CPLFree( pData );
-    }
-
-    else    // No arbitrary overviews
-    {
-        int         nSampleRate;
-
-        if( !InitBlockInfo() )
-            return CE_Failure;
-    
-/* -------------------------------------------------------------------- */
-/*      Figure out the ratio of blocks we will read to get an           */
-/*      approximate value.                                              */
-/* -------------------------------------------------------------------- */
-
-        if ( bApproxOK )
-        {
-            nSampleRate = 
-                (int) MAX(1,sqrt((double) nBlocksPerRow * nBlocksPerColumn));
-        }
-        else
-            nSampleRate = 1;
-    
-/* -------------------------------------------------------------------- */
-/*      Read the blocks, and add to histogram.                          */
-/* -------------------------------------------------------------------- */
-        for( int iSampleBlock = 0; 
-             iSampleBlock < nBlocksPerRow * nBlocksPerColumn;
-             iSampleBlock += nSampleRate )
-        {
-            int  iXBlock, iYBlock, nXCheck, nYCheck;
-            GDALRasterBlock *poBlock;
-            void* pData;
-
-            if( !pfnProgress( iSampleBlock
-                              / ((double)nBlocksPerRow * nBlocksPerColumn),
-                              "Compute Histogram", pProgressData ) )
-                return CE_Failure;
-
-            iYBlock = iSampleBlock / nBlocksPerRow;
-            iXBlock = iSampleBlock - nBlocksPerRow * iYBlock;
-            
-            poBlock = GetLockedBlockRef( iXBlock, iYBlock );
-            if( poBlock == NULL )
-                return CE_Failure;
-            if( poBlock->GetDataRef() == NULL )
-            {
-                poBlock->DropLock();
-                return CE_Failure;
-            }
-            
-            pData = poBlock->GetDataRef();
-            
-            if( (iXBlock+1) * nBlockXSize > GetXSize() )
-                nXCheck = GetXSize() - iXBlock * nBlockXSize;
-            else
-                nXCheck = nBlockXSize;
-
-            if( (iYBlock+1) * nBlockYSize > GetYSize() )
-                nYCheck = GetYSize() - iYBlock * nBlockYSize;
-            else
-                nYCheck = nBlockYSize;
-
-            /* this is a special case for a common situation */
-            if( eDataType == GDT_Byte && !bSignedByte
-                && dfScale == 1.0 && (dfMin >= -0.5 && dfMin <= 0.5)
-                && nYCheck == nBlockYSize && nXCheck == nBlockXSize
-                && nBuckets == 256 )
-            {
-                int    nPixels = nXCheck * nYCheck;
-                GByte  *pabyData = (GByte *) pData;
-                
-                for( int i = 0; i < nPixels; i++ )
-                    if (! (bGotNoDataValue && (pabyData[i] == (GByte)dfNoDataValue)))
-                    {
-                        panHistogram[pabyData[i]]++;
-                    }
-
-                poBlock->DropLock();
-                continue; /* to next sample block */
-            }
-
-            /* this isn't the fastest way to do this, but is easier for now */
-            for( int iY = 0; iY < nYCheck; iY++ )
-            {
-                for( int iX = 0; iX < nXCheck; iX++ )
-                {
-                    int    iOffset = iX + iY * nBlockXSize;
-                    int    nIndex;
-                    double dfValue = 0.0;
-
-                    switch( eDataType )
-                    {
-                      case GDT_Byte:
-                      {
-                        if (bSignedByte)
-                            dfValue = ((signed char *) pData)[iOffset];
-                        else
-                            dfValue = ((GByte *) pData)[iOffset];
-                        break;
-                      }
-                      case GDT_UInt16:
-                        dfValue = ((GUInt16 *) pData)[iOffset];
-                        break;
-                      case GDT_Int16:
-                        dfValue = ((GInt16 *) pData)[iOffset];
-                        break;
-                      case GDT_UInt32:
-                        dfValue = ((GUInt32 *) pData)[iOffset];
-                        break;
-                      case GDT_Int32:
-                        dfValue = ((GInt32 *) pData)[iOffset];
-                        break;
-                      case GDT_Float32:
-                        dfValue = ((float *) pData)[iOffset];
-                        if (CPLIsNan(dfValue))
-                            continue;
-                        break;
-                      case GDT_Float64:
-                        dfValue = ((double *) pData)[iOffset];
-                        if (CPLIsNan(dfValue))
-                            continue;
-                        break;
-                      case GDT_CInt16:
-                        {
-                            double  dfReal =
-                                ((GInt16 *) pData)[iOffset*2];
-                            double  dfImag =
-                                ((GInt16 *) pData)[iOffset*2+1];
-                            dfValue = sqrt( dfReal * dfReal + dfImag * dfImag );
-                        }
-                        break;
-                      case GDT_CInt32:
-                        {
-                            double  dfReal =
-                                ((GInt32 *) pData)[iOffset*2];
-                            double  dfImag =
-                                ((GInt32 *) pData)[iOffset*2+1];
-                            dfValue = sqrt( dfReal * dfReal + dfImag * dfImag );
-                        }
-                        break;
-                      case GDT_CFloat32:
-                        {
-                            double  dfReal =
-                                ((float *) pData)[iOffset*2];
-                            double  dfImag =
-                                ((float *) pData)[iOffset*2+1];
-                            if ( CPLIsNan(dfReal) || CPLIsNan(dfImag) )
-                                continue;
-                            dfValue = sqrt( dfReal * dfReal + dfImag * dfImag );
-                        }
-                        break;
-                      case GDT_CFloat64:
-                        {
-                            double  dfReal =
-                                ((double *) pData)[iOffset*2];
-                            double  dfImag =
-                                ((double *) pData)[iOffset*2+1];
-                            if ( CPLIsNan(dfReal) || CPLIsNan(dfImag) )
-                                continue;
-                            dfValue = sqrt( dfReal * dfReal + dfImag * dfImag );
-                        }
-                        break;
-                      default:
-                        CPLAssert( FALSE );
-                        return CE_Failure;
-                    }
-                    
-                    if( bGotNoDataValue && ARE_REAL_EQUAL(dfValue, dfNoDataValue) )
-                        continue;
-
-                    nIndex = (int) floor((dfValue - dfMin) * dfScale);
-
-                    if( nIndex < 0 )
-                    {
-                        if( bIncludeOutOfRange )
-                            panHistogram[0]++;
-                    }
-                    else if( nIndex >= nBuckets )
-                    {
-                        if( bIncludeOutOfRange )
-                            panHistogram[nBuckets-1]++;
-                    }
-                    else
-                    {
-                        panHistogram[nIndex]++;
-                    }
-                }
-            }
-
-            poBlock->DropLock();
-        }
-    }
-
-    pfnProgress( 1.0, "Compute Histogram", pProgressData );
-
-    return CE_None;
-}
-
 /************************************************************************/
 /*                       GDALGetRasterHistogram()                       */
 /************************************************************************/
@@ -3437,466 +3041,72 @@ CPLErr CPL_STDCALL GDALGetRasterStatistics(
 }
 
 /************************************************************************/
-/*                         ComputeStatistics()                          */
+/*                    GDALComputeRasterStatistics()                     */
 /************************************************************************/
 
 /**
- * \brief Compute image statistics. 
- *
- * Returns the minimum, maximum, mean and standard deviation of all
- * pixel values in this band.  If approximate statistics are sufficient,
- * the bApproxOK flag can be set to true in which case overviews, or a
- * subset of image tiles may be used in computing the statistics.  
+  * \brief Compute image statistics. 
+  *
+  * @see GDALRasterBand::ComputeStatistics()
+  */
+
+CPLErr CPL_STDCALL GDALComputeRasterStatistics( 
+        GDALRasterBandH hBand, int bApproxOK, 
+        double *pdfMin, double *pdfMax, double *pdfMean, double *pdfStdDev,
+        GDALProgressFunc pfnProgress, void *pProgressData )
+
+{
+    VALIDATE_POINTER1( hBand, "GDALComputeRasterStatistics", CE_Failure );
+
+    GDALRasterBand *poBand = static_cast<GDALRasterBand*>(hBand);
+
+    return poBand->ComputeStatistics( 
+        bApproxOK, pdfMin, pdfMax, pdfMean, pdfStdDev,
+        pfnProgress, pProgressData );
+}
+
+/************************************************************************/
+/*                           SetStatistics()                            */
+/************************************************************************/
+
+/**
+ * \brief Set statistics on band.
  *
- * Once computed, the statistics will generally be "set" back on the 
- * raster band using SetStatistics(). 
+ * This method can be used to store min/max/mean/standard deviation
+ * statistics on a raster band.  
  *
- * This method is the same as the C function GDALComputeRasterStatistics().
+ * The default implementation stores them as metadata, and will only work 
+ * on formats that can save arbitrary metadata.  This method cannot detect
+ * whether metadata will be properly saved and so may return CE_None even
+ * if the statistics will never be saved.
  *
- * @param bApproxOK If TRUE statistics may be computed based on overviews
- * or a subset of all tiles. 
+ * This method is the same as the C function GDALSetRasterStatistics().
  * 
- * @param pdfMin Location into which to load image minimum (may be NULL).
- *
- * @param pdfMax Location into which to load image maximum (may be NULL).-
- *
- * @param pdfMean Location into which to load image mean (may be NULL).
- *
- * @param pdfStdDev Location into which to load image standard deviation 
- * (may be NULL).
+ * @param dfMin minimum pixel value.
+ * 
+ * @param dfMax maximum pixel value.
  *
- * @param pfnProgress a function to call to report progress, or NULL.
+ * @param dfMean mean (average) of all pixel values.		
  *
- * @param pProgressData application data to pass to the progress function.
+ * @param dfStdDev Standard deviation of all pixel values.
  *
- * @return CE_None on success, or CE_Failure if an error occurs or processing
- * is terminated by the user.
+ * @return CE_None on success or CE_Failure on failure. 
  */
 
-CPLErr 
-GDALRasterBand::ComputeStatistics( int bApproxOK,
-                                   double *pdfMin, double *pdfMax, 
-                                   double *pdfMean, double *pdfStdDev,
-                                   GDALProgressFunc pfnProgress, 
-                                   void *pProgressData )
+CPLErr GDALRasterBand::SetStatistics( double dfMin, double dfMax, 
+                                      double dfMean, double dfStdDev )
 
 {
-    if( pfnProgress == NULL )
-        pfnProgress = GDALDummyProgress;
+    char szValue[128] = { 0 };
 
-/* -------------------------------------------------------------------- */
-/*      If we have overview bands, use them for statistics.             */
-/* -------------------------------------------------------------------- */
-    if( bApproxOK && GetOverviewCount() > 0 && !HasArbitraryOverviews() )
-    {
-        GDALRasterBand *poBand;
+    sprintf( szValue, "%.14g", dfMin );
+    SetMetadataItem( "STATISTICS_MINIMUM", szValue );
 
-        poBand = GetRasterSampleOverview( GDALSTAT_APPROX_NUMSAMPLES );
+    sprintf( szValue, "%.14g", dfMax );
+    SetMetadataItem( "STATISTICS_MAXIMUM", szValue );
 
-        if( poBand != this )
-            return poBand->ComputeStatistics( FALSE,  
-                                              pdfMin, pdfMax, 
-                                              pdfMean, pdfStdDev,
-                                              pfnProgress, pProgressData );
-    }
-
-/* -------------------------------------------------------------------- */
-/*      Read actual data and compute statistics.                        */
-/* -------------------------------------------------------------------- */
-    double      dfMin = 0.0, dfMax = 0.0;
-    int         bGotNoDataValue, bFirstValue = TRUE;
-    /* Using Welford algorithm ( http://en.wikipedia.org/wiki/Algorithms_for_calculating_variance ) */
-    /* to compute standard deviation in a more numerically robust way than */
-    /* the difference of the sum of square values with the square of the sum */
-    /* dfMean and dfM2 are updated at each sample */
-    /* dfM2 is the sum of square of differences to the current mean */
-    double      dfNoDataValue, dfMean = 0.0, dfM2 = 0.0;
-    GIntBig     nSampleCount = 0;
-
-    if( !pfnProgress( 0.0, "Compute Statistics", pProgressData ) )
-    {
-        ReportError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
-        return CE_Failure;
-    }
-
-    dfNoDataValue = GetNoDataValue( &bGotNoDataValue );
-    bGotNoDataValue = bGotNoDataValue && !CPLIsNan(dfNoDataValue);
-
-    const char* pszPixelType = GetMetadataItem("PIXELTYPE", "IMAGE_STRUCTURE");
-    int bSignedByte = (pszPixelType != NULL && EQUAL(pszPixelType, "SIGNEDBYTE"));
-    
-    if ( bApproxOK && HasArbitraryOverviews() )
-    {
-/* -------------------------------------------------------------------- */
-/*      Figure out how much the image should be reduced to get an       */
-/*      approximate value.                                              */
-/* -------------------------------------------------------------------- */
-        void    *pData;
-        int     nXReduced, nYReduced;
-        double  dfReduction = sqrt(
-            (double)nRasterXSize * nRasterYSize / GDALSTAT_APPROX_NUMSAMPLES );
-
-        if ( dfReduction > 1.0 )
-        {
-            nXReduced = (int)( nRasterXSize / dfReduction );
-            nYReduced = (int)( nRasterYSize / dfReduction );
-
-            // Catch the case of huge resizing ratios here
-            if ( nXReduced == 0 )
-                nXReduced = 1;
-            if ( nYReduced == 0 )
-                nYReduced = 1;
-        }
-        else
-        {
-            nXReduced = nRasterXSize;
-            nYReduced = nRasterYSize;
-        }
-
-        pData =
-            CPLMalloc(GDALGetDataTypeSize(eDataType)/8 * nXReduced * nYReduced);
-
-        CPLErr eErr = IRasterIO( GF_Read, 0, 0, nRasterXSize, nRasterYSize, pData,
-                   nXReduced, nYReduced, eDataType, 0, 0 );
-        if ( eErr != CE_None )
-        {
-            CPLFree(pData);
-            return eErr;
-        }
-
-        /* this isn't the fastest way to do this, but is easier for now */
-        for( int iY = 0; iY < nYReduced; iY++ )
-        {
-            for( int iX = 0; iX < nXReduced; iX++ )
-            {
-                int    iOffset = iX + iY * nXReduced;
-                double dfValue = 0.0;
-
-                switch( eDataType )
-                {
-                  case GDT_Byte:
-                  {
-                    if (bSignedByte)
-                        dfValue = ((signed char *)pData)[iOffset];
-                    else
-                        dfValue = ((GByte *)pData)[iOffset];
-                    break;
-                  }
-                  case GDT_UInt16:
-                    dfValue = ((GUInt16 *)pData)[iOffset];
-                    break;
-                  case GDT_Int16:
-                    dfValue = ((GInt16 *)pData)[iOffset];
-                    break;
-                  case GDT_UInt32:
-                    dfValue = ((GUInt32 *)pData)[iOffset];
-                    break;
-                  case GDT_Int32:
-                    dfValue = ((GInt32 *)pData)[iOffset];
-                    break;
-                  case GDT_Float32:
-                    dfValue = ((float *)pData)[iOffset];
-                    if (CPLIsNan(dfValue))
-                        continue;
-                    break;
-                  case GDT_Float64:
-                    dfValue = ((double *)pData)[iOffset];
-                    if (CPLIsNan(dfValue))
-                        continue;
-                    break;
-                  case GDT_CInt16:
-                    dfValue = ((GInt16 *)pData)[iOffset*2];
-                    break;
-                  case GDT_CInt32:
-                    dfValue = ((GInt32 *)pData)[iOffset*2];
-                    break;
-                  case GDT_CFloat32:
-                    dfValue = ((float *)pData)[iOffset*2];
-                    if( CPLIsNan(dfValue) )
-                        continue;
-                    break;
-                  case GDT_CFloat64:
-                    dfValue = ((double *)pData)[iOffset*2];
-                    if( CPLIsNan(dfValue) )
-                        continue;
-                    break;
-                  default:
-                    CPLAssert( FALSE );
-                }
-                
-                if( bGotNoDataValue && ARE_REAL_EQUAL(dfValue, dfNoDataValue) )
-                    continue;
-
-                if( bFirstValue )
-                {
-                    dfMin = dfMax = dfValue;
-                    bFirstValue = FALSE;
-                }
-                else
-                {
-                    dfMin = MIN(dfMin,dfValue);
-                    dfMax = MAX(dfMax,dfValue);
-                }
-
-                nSampleCount++;
-                double dfDelta = dfValue - dfMean;
-                dfMean += dfDelta / nSampleCount;
-                dfM2 += dfDelta * (dfValue - dfMean);
-            }
-        }
-
-        CPLFree( pData );
-    }
-
-    else    // No arbitrary overviews
-    {
-        int     nSampleRate;
-        
-        if( !InitBlockInfo() )
-            return CE_Failure;
-
-/* -------------------------------------------------------------------- */
-/*      Figure out the ratio of blocks we will read to get an           */
-/*      approximate value.                                              */
-/* -------------------------------------------------------------------- */
-        if ( bApproxOK )
-        {
-            nSampleRate = 
-                (int)MAX( 1, sqrt((double)nBlocksPerRow * nBlocksPerColumn) );
-        }
-        else
-            nSampleRate = 1;
-
-        for( int iSampleBlock = 0; 
-             iSampleBlock < nBlocksPerRow * nBlocksPerColumn;
-             iSampleBlock += nSampleRate )
-        {
-            int  iXBlock, iYBlock, nXCheck, nYCheck;
-            GDALRasterBlock *poBlock;
-            void* pData;
-
-            iYBlock = iSampleBlock / nBlocksPerRow;
-            iXBlock = iSampleBlock - nBlocksPerRow * iYBlock;
-            
-            poBlock = GetLockedBlockRef( iXBlock, iYBlock );
-            if( poBlock == NULL )
-                continue;
-            if( poBlock->GetDataRef() == NULL )
-            {
-                poBlock->DropLock();
-                continue;
-            }
-            
-            pData = poBlock->GetDataRef();
-            
-            if( (iXBlock+1) * nBlockXSize > GetXSize() )
-                nXCheck = GetXSize() - iXBlock * nBlockXSize;
-            else
-                nXCheck = nBlockXSize;
-
-            if( (iYBlock+1) * nBlockYSize > GetYSize() )
-                nYCheck = GetYSize() - iYBlock * nBlockYSize;
-            else
-                nYCheck = nBlockYSize;
-
-            /* this isn't the fastest way to do this, but is easier for now */
-            for( int iY = 0; iY < nYCheck; iY++ )
-            {
-                for( int iX = 0; iX < nXCheck; iX++ )
-                {
-                    int    iOffset = iX + iY * nBlockXSize;
-                    double dfValue = 0.0;
-
-                    switch( eDataType )
-                    {
-                      case GDT_Byte:
-                      {
-                        if (bSignedByte)
-                            dfValue = ((signed char *)pData)[iOffset];
-                        else
-                            dfValue = ((GByte *)pData)[iOffset];
-                        break;
-                      }
-                      case GDT_UInt16:
-                        dfValue = ((GUInt16 *)pData)[iOffset];
-                        break;
-                      case GDT_Int16:
-                        dfValue = ((GInt16 *)pData)[iOffset];
-                        break;
-                      case GDT_UInt32:
-                        dfValue = ((GUInt32 *)pData)[iOffset];
-                        break;
-                      case GDT_Int32:
-                        dfValue = ((GInt32 *)pData)[iOffset];
-                        break;
-                      case GDT_Float32:
-                        dfValue = ((float *)pData)[iOffset];
-                        if (CPLIsNan(dfValue))
-                            continue;
-                        break;
-                      case GDT_Float64:
-                        dfValue = ((double *)pData)[iOffset];
-                        if (CPLIsNan(dfValue))
-                            continue;
-                        break;
-                      case GDT_CInt16:
-                        dfValue = ((GInt16 *)pData)[iOffset*2];
-                        break;
-                      case GDT_CInt32:
-                        dfValue = ((GInt32 *)pData)[iOffset*2];
-                        break;
-                      case GDT_CFloat32:
-                        dfValue = ((float *)pData)[iOffset*2];
-                        if( CPLIsNan(dfValue) )
-                            continue;
-                        break;
-                      case GDT_CFloat64:
-                        dfValue = ((double *)pData)[iOffset*2];
-                        if( CPLIsNan(dfValue) )
-                            continue;
-                        break;
-                      default:
-                        CPLAssert( FALSE );
-                    }
-
-                    if( bGotNoDataValue && ARE_REAL_EQUAL(dfValue, dfNoDataValue) )
-                        continue;
-
-                    if( bFirstValue )
-                    {
-                        dfMin = dfMax = dfValue;
-                        bFirstValue = FALSE;
-                    }
-                    else
-                    {
-                        dfMin = MIN(dfMin,dfValue);
-                        dfMax = MAX(dfMax,dfValue);
-                    }
-
-                    nSampleCount++;
-                    double dfDelta = dfValue - dfMean;
-                    dfMean += dfDelta / nSampleCount;
-                    dfM2 += dfDelta * (dfValue - dfMean);
-                }
-            }
-
-            poBlock->DropLock();
-
-            if ( !pfnProgress(iSampleBlock
-                              / ((double)(nBlocksPerRow*nBlocksPerColumn)),
-                              "Compute Statistics", pProgressData) )
-            {
-                ReportError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
-                return CE_Failure;
-            }
-        }
-    }
-
-    if( !pfnProgress( 1.0, "Compute Statistics", pProgressData ) )
-    {
-        ReportError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
-        return CE_Failure;
-    }
-
-/* -------------------------------------------------------------------- */
-/*      Save computed information.                                      */
-/* -------------------------------------------------------------------- */
-    double dfStdDev = sqrt(dfM2 / nSampleCount);
-
-    if( nSampleCount > 0 )
-        SetStatistics( dfMin, dfMax, dfMean, dfStdDev );
-
-/* -------------------------------------------------------------------- */
-/*      Record results.                                                 */
-/* -------------------------------------------------------------------- */
-    if( pdfMin != NULL )
-        *pdfMin = dfMin;
-    if( pdfMax != NULL )
-        *pdfMax = dfMax;
-
-    if( pdfMean != NULL )
-        *pdfMean = dfMean;
-
-    if( pdfStdDev != NULL )
-        *pdfStdDev = dfStdDev;
-
-    if( nSampleCount > 0 )
-        return CE_None;
-    else
-    {
-        ReportError( CE_Failure, CPLE_AppDefined,
-        "Failed to compute statistics, no valid pixels found in sampling." );
-        return CE_Failure;
-    }
-}
-
-/************************************************************************/
-/*                    GDALComputeRasterStatistics()                     */
-/************************************************************************/
-
-/**
-  * \brief Compute image statistics. 
-  *
-  * @see GDALRasterBand::ComputeStatistics()
-  */
-
-CPLErr CPL_STDCALL GDALComputeRasterStatistics( 
-        GDALRasterBandH hBand, int bApproxOK, 
-        double *pdfMin, double *pdfMax, double *pdfMean, double *pdfStdDev,
-        GDALProgressFunc pfnProgress, void *pProgressData )
-
-{
-    VALIDATE_POINTER1( hBand, "GDALComputeRasterStatistics", CE_Failure );
-
-    GDALRasterBand *poBand = static_cast<GDALRasterBand*>(hBand);
-
-    return poBand->ComputeStatistics( 
-        bApproxOK, pdfMin, pdfMax, pdfMean, pdfStdDev,
-        pfnProgress, pProgressData );
-}
-
-/************************************************************************/
-/*                           SetStatistics()                            */
-/************************************************************************/
-
-/**
- * \brief Set statistics on band.
- *
- * This method can be used to store min/max/mean/standard deviation
- * statistics on a raster band.  
- *
- * The default implementation stores them as metadata, and will only work 
- * on formats that can save arbitrary metadata.  This method cannot detect
- * whether metadata will be properly saved and so may return CE_None even
- * if the statistics will never be saved.
- *
- * This method is the same as the C function GDALSetRasterStatistics().
- * 
- * @param dfMin minimum pixel value.
- * 
- * @param dfMax maximum pixel value.
- *
- * @param dfMean mean (average) of all pixel values.		
- *
- * @param dfStdDev Standard deviation of all pixel values.
- *
- * @return CE_None on success or CE_Failure on failure. 
- */
-
-CPLErr GDALRasterBand::SetStatistics( double dfMin, double dfMax, 
-                                      double dfMean, double dfStdDev )
-
-{
-    char szValue[128] = { 0 };
-
-    sprintf( szValue, "%.14g", dfMin );
-    SetMetadataItem( "STATISTICS_MINIMUM", szValue );
-
-    sprintf( szValue, "%.14g", dfMax );
-    SetMetadataItem( "STATISTICS_MAXIMUM", szValue );
-
-    sprintf( szValue, "%.14g", dfMean );
-    SetMetadataItem( "STATISTICS_MEAN", szValue );
+    sprintf( szValue, "%.14g", dfMean );
+    SetMetadataItem( "STATISTICS_MEAN", szValue );
 
     sprintf( szValue, "%.14g", dfStdDev );
     SetMetadataItem( "STATISTICS_STDDEV", szValue );
@@ -3925,345 +3135,6 @@ CPLErr CPL_STDCALL GDALSetRasterStatistics(
     return poBand->SetStatistics( dfMin, dfMax, dfMean, dfStdDev );
 }
 
-/************************************************************************/
-/*                        ComputeRasterMinMax()                         */
-/************************************************************************/
-
-/**
- * \brief Compute the min/max values for a band.
- * 
- * If approximate is OK, then the band's GetMinimum()/GetMaximum() will
- * be trusted.  If it doesn't work, a subsample of blocks will be read to
- * get an approximate min/max.  If the band has a nodata value it will
- * be excluded from the minimum and maximum.
- *
- * If bApprox is FALSE, then all pixels will be read and used to compute
- * an exact range.
- *
- * This method is the same as the C function GDALComputeRasterMinMax().
- * 
- * @param bApproxOK TRUE if an approximate (faster) answer is OK, otherwise
- * FALSE.
- * @param adfMinMax the array in which the minimum (adfMinMax[0]) and the
- * maximum (adfMinMax[1]) are returned.
- *
- * @return CE_None on success or CE_Failure on failure.
- */
-
-
-CPLErr GDALRasterBand::ComputeRasterMinMax( int bApproxOK,
-                                            double adfMinMax[2] )
-{
-    double  dfMin = 0.0;
-    double  dfMax = 0.0;
-
-/* -------------------------------------------------------------------- */
-/*      Does the driver already know the min/max?                       */
-/* -------------------------------------------------------------------- */
-    if( bApproxOK )
-    {
-        int          bSuccessMin, bSuccessMax;
-
-        dfMin = GetMinimum( &bSuccessMin );
-        dfMax = GetMaximum( &bSuccessMax );
-
-        if( bSuccessMin && bSuccessMax )
-        {
-            adfMinMax[0] = dfMin;
-            adfMinMax[1] = dfMax;
-            return CE_None;
-        }
-    }
-    
-/* -------------------------------------------------------------------- */
-/*      If we have overview bands, use them for min/max.                */
-/* -------------------------------------------------------------------- */
-    if ( bApproxOK && GetOverviewCount() > 0 && !HasArbitraryOverviews() )
-    {
-        GDALRasterBand *poBand;
-
-        poBand = GetRasterSampleOverview( GDALSTAT_APPROX_NUMSAMPLES );
-
-        if ( poBand != this )
-            return poBand->ComputeRasterMinMax( FALSE, adfMinMax );
-    }
-    
-/* -------------------------------------------------------------------- */
-/*      Read actual data and compute minimum and maximum.               */
-/* -------------------------------------------------------------------- */
-    int     bGotNoDataValue, bFirstValue = TRUE;
-    double  dfNoDataValue;
-
-    dfNoDataValue = GetNoDataValue( &bGotNoDataValue );
-    bGotNoDataValue = bGotNoDataValue && !CPLIsNan(dfNoDataValue);
-
-    const char* pszPixelType = GetMetadataItem("PIXELTYPE", "IMAGE_STRUCTURE");
-    int bSignedByte = (pszPixelType != NULL && EQUAL(pszPixelType, "SIGNEDBYTE"));
-    
-    if ( bApproxOK && HasArbitraryOverviews() )
-    {
-/* -------------------------------------------------------------------- */
-/*      Figure out how much the image should be reduced to get an       */
-/*      approximate value.                                              */
-/* -------------------------------------------------------------------- */
-        void    *pData;
-        int     nXReduced, nYReduced;
-        double  dfReduction = sqrt(
-            (double)nRasterXSize * nRasterYSize / GDALSTAT_APPROX_NUMSAMPLES );
-
-        if ( dfReduction > 1.0 )
-        {
-            nXReduced = (int)( nRasterXSize / dfReduction );
-            nYReduced = (int)( nRasterYSize / dfReduction );
-
-            // Catch the case of huge resizing ratios here
-            if ( nXReduced == 0 )
-                nXReduced = 1;
-            if ( nYReduced == 0 )
-                nYReduced = 1;
-        }
-        else
-        {
-            nXReduced = nRasterXSize;
-            nYReduced = nRasterYSize;
-        }
-
-        pData =
-            CPLMalloc(GDALGetDataTypeSize(eDataType)/8 * nXReduced * nYReduced);
-
-        CPLErr eErr = IRasterIO( GF_Read, 0, 0, nRasterXSize, nRasterYSize, pData,
-                   nXReduced, nYReduced, eDataType, 0, 0 );
-        if ( eErr != CE_None )
-        {
-            CPLFree(pData);
-            return eErr;
-        }
-        
-        /* this isn't the fastest way to do this, but is easier for now */
-        for( int iY = 0; iY < nYReduced; iY++ )
-        {
-            for( int iX = 0; iX < nXReduced; iX++ )
-            {
-                int    iOffset = iX + iY * nXReduced;
-                double dfValue = 0.0;
-
-                switch( eDataType )
-                {
-                  case GDT_Byte:
-                  {
-                    if (bSignedByte)
-                        dfValue = ((signed char *)pData)[iOffset];
-                    else
-                        dfValue = ((GByte *)pData)[iOffset];
-                    break;
-                  }
-                  case GDT_UInt16:
-                    dfValue = ((GUInt16 *)pData)[iOffset];
-                    break;
-                  case GDT_Int16:
-                    dfValue = ((GInt16 *)pData)[iOffset];
-                    break;
-                  case GDT_UInt32:
-                    dfValue = ((GUInt32 *)pData)[iOffset];
-                    break;
-                  case GDT_Int32:
-                    dfValue = ((GInt32 *)pData)[iOffset];
-                    break;
-                  case GDT_Float32:
-                    dfValue = ((float *)pData)[iOffset];
-                    if (CPLIsNan(dfValue))
-                        continue;
-                    break;
-                  case GDT_Float64:
-                    dfValue = ((double *)pData)[iOffset];
-                    if (CPLIsNan(dfValue))
-                        continue;
-                    break;
-                  case GDT_CInt16:
-                    dfValue = ((GInt16 *)pData)[iOffset*2];
-                    break;
-                  case GDT_CInt32:
-                    dfValue = ((GInt32 *)pData)[iOffset*2];
-                    break;
-                  case GDT_CFloat32:
-                    dfValue = ((float *)pData)[iOffset*2];
-                    if( CPLIsNan(dfValue) )
-                        continue;
-                    break;
-                  case GDT_CFloat64:
-                    dfValue = ((double *)pData)[iOffset*2];
-                    if( CPLIsNan(dfValue) )
-                        continue;
-                    break;
-                  default:
-                    CPLAssert( FALSE );
-                }
-                
-                if( bGotNoDataValue && ARE_REAL_EQUAL(dfValue, dfNoDataValue) )
-                    continue;
-
-                if( bFirstValue )
-                {
-                    dfMin = dfMax = dfValue;
-                    bFirstValue = FALSE;
-                }
-                else
-                {
-                    dfMin = MIN(dfMin,dfValue);
-                    dfMax = MAX(dfMax,dfValue);
-                }
-            }
-        }
-
-        CPLFree( pData );
-    }
-
-    else    // No arbitrary overviews
-    {
-        int     nSampleRate;
-
-        if( !InitBlockInfo() )
-            return CE_Failure;
-
-/* -------------------------------------------------------------------- */
-/*      Figure out the ratio of blocks we will read to get an           */
-/*      approximate value.                                              */
-/* -------------------------------------------------------------------- */
-        if ( bApproxOK )
-        {
-            nSampleRate = 
-                (int) MAX(1,sqrt((double) nBlocksPerRow * nBlocksPerColumn));
-        }
-        else
-            nSampleRate = 1;
-        
-        for( int iSampleBlock = 0; 
-             iSampleBlock < nBlocksPerRow * nBlocksPerColumn;
-             iSampleBlock += nSampleRate )
-        {
-            int  iXBlock, iYBlock, nXCheck, nYCheck;
-            GDALRasterBlock *poBlock;
-            void* pData;
-
-            iYBlock = iSampleBlock / nBlocksPerRow;
-            iXBlock = iSampleBlock - nBlocksPerRow * iYBlock;
-            
-            poBlock = GetLockedBlockRef( iXBlock, iYBlock );
-            if( poBlock == NULL )
-                continue;
-            if( poBlock->GetDataRef() == NULL )
-            {
-                poBlock->DropLock();
-                continue;
-            }
-            
-            pData = poBlock->GetDataRef();
-            
-            if( (iXBlock+1) * nBlockXSize > GetXSize() )
-                nXCheck = GetXSize() - iXBlock * nBlockXSize;
-            else
-                nXCheck = nBlockXSize;
-
-            if( (iYBlock+1) * nBlockYSize > GetYSize() )
-                nYCheck = GetYSize() - iYBlock * nBlockYSize;
-            else
-                nYCheck = nBlockYSize;
-                
-            /* this isn't the fastest way to do this, but is easier for now */
-            for( int iY = 0; iY < nYCheck; iY++ )
-            {
-                for( int iX = 0; iX < nXCheck; iX++ )
-                {
-                    int    iOffset = iX + iY * nBlockXSize;
-                    double dfValue = 0.0;
-
-                    switch( eDataType )
-                    {
-                      case GDT_Byte:
-                      {
-                        if (bSignedByte)
-                            dfValue = ((signed char *) pData)[iOffset];
-                        else
-                            dfValue = ((GByte *) pData)[iOffset];
-                        break;
-                      }
-                      case GDT_UInt16:
-                        dfValue = ((GUInt16 *) pData)[iOffset];
-                        break;
-                      case GDT_Int16:
-                        dfValue = ((GInt16 *) pData)[iOffset];
-                        break;
-                      case GDT_UInt32:
-                        dfValue = ((GUInt32 *) pData)[iOffset];
-                        break;
-                      case GDT_Int32:
-                        dfValue = ((GInt32 *) pData)[iOffset];
-                        break;
-                      case GDT_Float32:
-                        dfValue = ((float *) pData)[iOffset];
-                        if( CPLIsNan(dfValue) )
-                            continue;
-                        break;
-                      case GDT_Float64:
-                        dfValue = ((double *) pData)[iOffset];
-                        if( CPLIsNan(dfValue) )
-                            continue;
-                        break;
-                      case GDT_CInt16:
-                        dfValue = ((GInt16 *) pData)[iOffset*2];
-                        break;
-                      case GDT_CInt32:
-                        dfValue = ((GInt32 *) pData)[iOffset*2];
-                        break;
-                      case GDT_CFloat32:
-                        dfValue = ((float *) pData)[iOffset*2];
-                        if( CPLIsNan(dfValue) )
-                            continue;
-                        break;
-                      case GDT_CFloat64:
-                        dfValue = ((double *) pData)[iOffset*2];
-                        if( CPLIsNan(dfValue) )
-                            continue;
-                        break;
-                      default:
-                        CPLAssert( FALSE );
-                    }
-                    
-                    if( bGotNoDataValue && ARE_REAL_EQUAL(dfValue, dfNoDataValue) )
-                        continue;
-
-                    if( bFirstValue )
-                    {
-                        dfMin = dfMax = dfValue;
-                        bFirstValue = FALSE;
-                    }
-                    else
-                    {
-                        dfMin = MIN(dfMin,dfValue);
-                        dfMax = MAX(dfMax,dfValue);
-                    }
-                }
-            }
-
-            poBlock->DropLock();
-        }
-    }
-
-    adfMinMax[0] = dfMin;
-    adfMinMax[1] = dfMax;
-
-    if (bFirstValue)
-    {
-        ReportError( CE_Failure, CPLE_AppDefined,
-            "Failed to compute min/max, no valid pixels found in sampling." );
-        return CE_Failure;
-    }
-    else
-    {
-        return CE_None;
-    }
-}
-
 /************************************************************************/
 /*                      GDALComputeRasterMinMax()                       */
 /************************************************************************/
@@ -5085,3 +3956,276 @@ CPLVirtualMem * GDALGetVirtualMemAuto( GDALRasterBandH hBand,
     return poBand->GetVirtualMemAuto(eRWFlag, pnPixelSpace,
                                      pnLineSpace, papszOptions);
 }
+
+/************************************************************************/
+/*                           GetCacheStats()                            */
+/************************************************************************/
+
+/**
+ * \brief Fetch the block cache statistics of this band.
+ *
+ * The hits, misses, evictions and dirty flushes counters are cumulated
+ * since the creation of the band or the last call to ResetCacheStats().
+ * They are updated without synchronization between the cache shards, and
+ * may thus be slightly inaccurate when the blocks of the band are used by
+ * several threads at once.  The nBlocks, nDirtyBlocks and nBytes fields
+ * describe the current content of the cache.  nLockWaitMicroseconds is
+ * not tracked per band and is set to zero.
+ *
+ * This method is the same as the C function GDALGetRasterBandCacheStats().
+ *
+ * @param psStats the structure to fill.
+ *
+ * @since GDAL 2.0
+ */
+
+void GDALRasterBand::GetCacheStats( GDALCacheStats *psStats )
+
+{
+    GDALRasterBlock::GetCacheStats( NULL, this, psStats );
+
+    psStats->nHits = (GUInt32) nCacheHits;
+    psStats->nMisses = (GUInt32) nCacheMisses;
+    psStats->nEvictions = (GUInt32) nCacheEvictions;
+    psStats->nDirtyFlushes = (GUInt32) nCacheDirtyFlushes;
+}
+
+/************************************************************************/
+/*                    GDALGetRasterBandCacheStats()                     */
+/************************************************************************/
+
+/**
+ * \brief Fetch the block cache statistics of a band.
+ *
+ * @see GDALRasterBand::GetCacheStats()
+ *
+ * @since GDAL 2.0
+ */
+
+void CPL_STDCALL GDALGetRasterBandCacheStats( GDALRasterBandH hBand,
+                                              GDALCacheStats *psStats )
+
+{
+    VALIDATE_POINTER0( hBand, "GDALGetRasterBandCacheStats" );
+    VALIDATE_POINTER0( psStats, "GDALGetRasterBandCacheStats" );
+
+    ((GDALRasterBand *) hBand)->GetCacheStats( psStats );
+}
+
+/************************************************************************/
+/*                          ResetCacheStats()                           */
+/************************************************************************/
+
+/**
+ * \brief Reset the block cache counters of this band.
+ *
+ * @since GDAL 2.0
+ */
+
+void GDALRasterBand::ResetCacheStats()
+
+{
+    nCacheHits = 0;
+    nCacheMisses = 0;
+    nCacheEvictions = 0;
+    nCacheDirtyFlushes = 0;
+}
+
+/************************************************************************/
+/*                          SetCachePriority()                          */
+/************************************************************************/
+
+/**
+ * \brief Set the block cache priority of this band.
+ *
+ * The blocks of a band with the GCPRI_Low priority are recycled before any
+ * other block, which is appropriate for bands that are read or written
+ * once in a streaming manner and should not evict the blocks of other
+ * datasets.  The blocks of a band with the GCPRI_High priority are only
+ * evicted when no block of lower priority can be, which may be used for
+ * the overviews used for interactive display.  The default, GCPRI_Normal,
+ * is plain least recently used eviction.
+ *
+ * The new priority applies to the blocks as they are used.
+ *
+ * This method is the same as the C function GDALSetRasterCachePriority().
+ *
+ * @param ePriority the new priority.
+ *
+ * @since GDAL 2.0
+ */
+
+void GDALRasterBand::SetCachePriority( GDALCachePriority ePriority )
+
+{
+    eCachePriority = ePriority;
+}
+
+/************************************************************************/
+/*                     GDALSetRasterCachePriority()                     */
+/************************************************************************/
+
+/**
+ * \brief Set the block cache priority of a band.
+ *
+ * @see GDALRasterBand::SetCachePriority()
+ *
+ * @since GDAL 2.0
+ */
+
+void CPL_STDCALL GDALSetRasterCachePriority( GDALRasterBandH hBand,
+                                             GDALCachePriority ePriority )
+
+{
+    VALIDATE_POINTER0( hBand, "GDALSetRasterCachePriority" );
+
+    ((GDALRasterBand *) hBand)->SetCachePriority( ePriority );
+}
+
+/************************************************************************/
+/*                     GDALGetRasterCachePriority()                     */
+/************************************************************************/
+
+/**
+ * \brief Fetch the block cache priority of a band.
+ *
+ * @see GDALRasterBand::GetCachePriority()
+ *
+ * @since GDAL 2.0
+ */
+
+GDALCachePriority CPL_STDCALL GDALGetRasterCachePriority( GDALRasterBandH hBand )
+
+{
+    VALIDATE_POINTER1( hBand, "GDALGetRasterCachePriority", GCPRI_Normal );
+
+    return ((GDALRasterBand *) hBand)->GetCachePriority();
+}
+
+/************************************************************************/
+/*                              PinBlock()                              */
+/************************************************************************/
+
+/**
+ * \brief Keep a block resident in the block cache.
+ *
+ * The block is read if it is not already cached, and is then never evicted
+ * to make room for other blocks, until UnpinBlock() is called.  Pinned
+ * blocks are still accounted for in the cache size, and are discarded
+ * (and thus unpinned) by FlushBlock() and FlushCache(), in particular when
+ * the dataset is closed.
+ *
+ * This method is the same as the C function GDALPinBlock().
+ *
+ * @param nXBlockOff the horizontal block offset, with zero indicating
+ * the left most block, 1 the next block and so forth. 
+ * @param nYBlockOff the vertical block offset, with zero indicating
+ * the top most block, 1 the next block and so forth.
+ *
+ * @return CE_None on success or CE_Failure if the block cannot be read.
+ *
+ * @since GDAL 2.0
+ */
+
+CPLErr GDALRasterBand::PinBlock( int nXBlockOff, int nYBlockOff )
+
+{
+    GDALRasterBlock *poBlock = GetLockedBlockRef( nXBlockOff, nYBlockOff );
+
+    if( poBlock == NULL )
+        return CE_Failure;
+
+    poBlock->SetPinned( TRUE );
+    poBlock->DropLock();
+
+    return CE_None;
+}
+
+/************************************************************************/
+/*                            GDALPinBlock()                            */
+/************************************************************************/
+
+/**
+ * \brief Keep a block resident in the block cache.
+ *
+ * @see GDALRasterBand::PinBlock()
+ *
+ * @since GDAL 2.0
+ */
+
+CPLErr CPL_STDCALL GDALPinBlock( GDALRasterBandH hBand,
+                                 int nXBlockOff, int nYBlockOff )
+
+{
+    VALIDATE_POINTER1( hBand, "GDALPinBlock", CE_Failure );
+
+    return ((GDALRasterBand *) hBand)->PinBlock( nXBlockOff, nYBlockOff );
+}
+
+/************************************************************************/
+/*                             UnpinBlock()                             */
+/************************************************************************/
+
+/**
+ * \brief Allow a block pinned with PinBlock() to be evicted again.
+ *
+ * Nothing is done if the block is not in the cache.
+ *
+ * This method is the same as the C function GDALUnpinBlock().
+ *
+ * @param nXBlockOff the horizontal block offset.
+ * @param nYBlockOff the vertical block offset.
+ *
+ * @return CE_None on success or CE_Failure if the block offsets are
+ * invalid.
+ *
+ * @since GDAL 2.0
+ */
+
+CPLErr GDALRasterBand::UnpinBlock( int nXBlockOff, int nYBlockOff )
+
+{
+    if( !InitBlockInfo() )
+        return CE_Failure;
+
+    if( nXBlockOff < 0 || nXBlockOff >= nBlocksPerRow
+        || nYBlockOff < 0 || nYBlockOff >= nBlocksPerColumn )
+    {
+        ReportError( CE_Failure, CPLE_IllegalArg,
+                     "Illegal block offsets (%d,%d) in "
+                     "GDALRasterBand::UnpinBlock()",
+                     nXBlockOff, nYBlockOff );
+        return CE_Failure;
+    }
+
+    GDALRasterBlock *poBlock = TryGetLockedBlockRef( nXBlockOff, nYBlockOff );
+
+    if( poBlock != NULL )
+    {
+        poBlock->SetPinned( FALSE );
+        poBlock->DropLock();
+    }
+
+    return CE_None;
+}
+
+/************************************************************************/
+/*                           GDALUnpinBlock()                           */
+/************************************************************************/
+
+/**
+ * \brief Allow a pinned block to be evicted again.
+ *
+ * @see GDALRasterBand::UnpinBlock()
+ *
+ * @since GDAL 2.0
+ */
+
+CPLErr CPL_STDCALL GDALUnpinBlock( GDALRasterBandH hBand,
+                                   int nXBlockOff, int nYBlockOff )
+
+{
+    VALIDATE_POINTER1( hBand, "GDALUnpinBlock", CE_Failure );
+
+    return ((GDALRasterBand *) hBand)->UnpinBlock( nXBlockOff, nYBlockOff );
+}
@@ -31,17 +31,150 @@
 
 #include "gdal_priv.h"
 #include "cpl_multiproc.h"
+#include "cpl_atomic_ops.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+#include <map>
+#include <algorithm>
 
 CPL_CVSID("$Id$");
 
 static int bCacheMaxInitialized = FALSE;
 static GIntBig nCacheMax = 40 * 1024*1024;
-static volatile GIntBig nCacheUsed = 0;
 
-static volatile GDALRasterBlock *poOldest = NULL;    /* tail */
-static volatile GDALRasterBlock *poNewest = NULL;    /* head */
+/* -------------------------------------------------------------------- */
+/*      The block cache is split into a number of shards, each with     */
+/*      its own mutex and its own LRU list.  A block is assigned to     */
+/*      a shard by hashing its band and block offsets, so that          */
+/*      threads working on different bands or datasets seldom compete   */
+/*      for the same lock.  The GDAL_CACHEMAX budget remains global:    */
+/*      when it is exceeded, the shard whose least recently used block  */
+/*      is the oldest (according to a global touch counter) is chosen   */
+/*      for eviction, which approximates a single global LRU.           */
+/* -------------------------------------------------------------------- */
+
+#define GDAL_RB_MAX_SHARDS      256
+#define GDAL_RB_DEFAULT_SHARDS  32
+
+typedef struct
+{
+    void                     *hMutex;
+    GDALRasterBlock          *poOldest;    /* tail */
+    GDALRasterBlock          *poNewest;    /* head */
+    volatile GIntBig          nCacheUsed;
+    volatile int              nOldestTick;
+    /* Statistics, see GDALGetCacheStats() */
+    GIntBig                   nHits;
+    GIntBig                   nMisses;
+    GIntBig                   nEvictions;
+    GIntBig                   nDirtyFlushes;
+    GIntBig                   nLockWaitMicros;
+    /* Keep shards on distinct cache lines to avoid false sharing */
+    char                      abyPadding[64];
+} GDALRasterBlockShard;
+
+static GDALRasterBlockShard asShards[GDAL_RB_MAX_SHARDS];
+static int nShardCount = 0;
+
+static volatile int nTouchTickCounter = 0;
+static volatile int nFlushStartShard = 0;
+
+/* -------------------------------------------------------------------- */
+/*      Blocks of bands with the GCPRI_Low cache priority are kept at   */
+/*      the old end of the LRU lists, with a touch tick made older      */
+/*      by this offset so that their shard is chosen first for          */
+/*      eviction.  Blocks of GCPRI_High bands and pinned blocks are     */
+/*      skipped by the eviction as long as other blocks can be found.   */
+/* -------------------------------------------------------------------- */
+
+#define GDAL_RB_LOW_PRIORITY_TICK_OFFSET  (1 << 30)
+
+/* -------------------------------------------------------------------- */
+/*      Optional write-back of dirty blocks.  When enabled with the     */
+/*      GDAL_CACHE_WRITEBACK_THREADS configuration option, background   */
+/*      threads write the oldest dirty blocks (leaving them in the      */
+/*      cache, clean) as soon as the cache use exceeds a fraction of    */
+/*      its maximum, so that threads that need to evict blocks find     */
+/*      clean ones instead of having to compress and write the blocks   */
+/*      dirtied by other threads.  The blocks of a dataset are written  */
+/*      one at a time, and never while another thread is doing I/O on   */
+/*      the dataset (see GDALBlockIOHolder).  Write errors are          */
+/*      reported by the band as for blocks flushed on eviction.         */
+/* -------------------------------------------------------------------- */
+
+#define GDAL_RB_WRITEBACK_THRESHOLD_PCT  75
+
+static int nWriteBackThreads = -1;
+static void *hWBMutex = NULL;
+static void *hWBCond = NULL;
+static void **pahWBThreads = NULL;
+static volatile int nWBGeneration = 0;
+static volatile int nWBIdleThreads = 0;
+static int bWBStop = FALSE;
+
+/* Number of block I/O rights explicitly held while write-back is disabled */
+static volatile int nExplicitBlockIOHolds = 0;
+
+/************************************************************************/
+/*                     GDALGetMicroSecondCounter()                      */
+/*                                                                      */
+/*      Return a time stamp in microseconds, to measure short           */
+/*      durations.                                                      */
+/************************************************************************/
+
+GIntBig GDALGetMicroSecondCounter()
+
+{
+#ifdef WIN32
+    static LARGE_INTEGER liFrequency = { { 0, 0 } };
+    LARGE_INTEGER liCounter;
+
+    if( liFrequency.QuadPart == 0 )
+        QueryPerformanceFrequency( &liFrequency );
+    QueryPerformanceCounter( &liCounter );
+    if( liFrequency.QuadPart == 0 )
+        return 0;
+    return (GIntBig) (liCounter.QuadPart / (double) liFrequency.QuadPart
+                      * 1e6);
+#else
+    struct timeval tv;
+
+    gettimeofday( &tv, NULL );
+    return (GIntBig) tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+/************************************************************************/
+/*                          GDALRBShardHolder                           */
+/*                                                                      */
+/*      Hold the mutex of a cache shard for the lifetime of the         */
+/*      object, accumulating the time spent waiting for it.             */
+/************************************************************************/
+
+class GDALRBShardHolder
+{
+    int iShard;
+
+  public:
+    GDALRBShardHolder( int iShardIn ) : iShard(iShardIn)
+    {
+        GIntBig nStart = GDALGetMicroSecondCounter();
+        CPLCreateOrAcquireMutex( &(asShards[iShard].hMutex), 1000.0 );
+        GIntBig nWait = GDALGetMicroSecondCounter() - nStart;
+        if( nWait > 0 )
+            asShards[iShard].nLockWaitMicros += nWait;
+    }
 
-static void *hRBMutex = NULL;
+    ~GDALRBShardHolder()
+    {
+        CPLReleaseMutex( asShards[iShard].hMutex );
+    }
+};
 
 /************************************************************************/
 /*                          GDALSetCacheMax()                           */
@@ -96,12 +229,14 @@ void CPL_STDCALL GDALSetCacheMax64( GIntBig nNewSizeInBytes )
 /*      Flush blocks till we are under the new limit or till we         */
 /*      can't seem to flush anymore.                                    */
 /* -------------------------------------------------------------------- */
+    GIntBig nCacheUsed = GDALGetCacheUsed64();
     while( nCacheUsed > nCacheMax )
     {
         GIntBig nOldCacheUsed = nCacheUsed;
 
         GDALFlushCacheBlock();
 
+        nCacheUsed = GDALGetCacheUsed64();
         if( nCacheUsed == nOldCacheUsed )
             break;
     }
@@ -201,6 +336,7 @@ GIntBig CPL_STDCALL GDALGetCacheMax64()
 
 int CPL_STDCALL GDALGetCacheUsed()
 {
+    GIntBig nCacheUsed = GDALGetCacheUsed64();
     if (nCacheUsed > INT_MAX)
     {
         static int bHasWarned = FALSE;
@@ -231,6 +367,11 @@ int CPL_STDCALL GDALGetCacheUsed()
 
 GIntBig CPL_STDCALL GDALGetCacheUsed64()
 {
+    GIntBig nCacheUsed = 0;
+
+    for( int iShard = 0; iShard < nShardCount; iShard++ )
+        nCacheUsed += asShards[iShard].nCacheUsed;
+
     return nCacheUsed;
 }
 
@@ -285,6 +426,65 @@ int CPL_STDCALL GDALFlushCacheBlock()
  * common.
  */
 
+/************************************************************************/
+/*                        GDALRBFindOldestShard()                       */
+/*                                                                      */
+/*      Find the shard whose tail is the least recently touched.  The   */
+/*      values are read without locking, so this is only a hint: the    */
+/*      candidates are re-checked under the shard mutex by the          */
+/*      callers.  Starting from a rotating shard spreads concurrent     */
+/*      flushers.                                                       */
+/************************************************************************/
+
+static int GDALRBFindOldestShard()
+
+{
+    const int nShards = nShardCount;
+    int iShard, iBestShard = -1;
+
+    if( nShards == 0 )
+        return -1;
+
+    const int iStartShard =
+        ((unsigned int) CPLAtomicInc(&nFlushStartShard)) % nShards;
+
+    for( int i = 0; i < nShards; i++ )
+    {
+        iShard = (iStartShard + i) % nShards;
+        if( asShards[iShard].poOldest == NULL )
+            continue;
+        if( iBestShard < 0 ||
+            asShards[iShard].nOldestTick -
+                asShards[iBestShard].nOldestTick < 0 )
+            iBestShard = iShard;
+    }
+
+    return iBestShard;
+}
+
+/************************************************************************/
+/*                         FlushEvictedBlock()                          */
+/*                                                                      */
+/*      Flush a block detached by SelectEvictionTarget(), saving the    */
+/*      error for later reporting by the band.                          */
+/************************************************************************/
+
+void GDALRasterBlock::FlushEvictedBlock( GDALRasterBand *poBand,
+                                         int nXOff, int nYOff,
+                                         GDALDataset *poLockedDS )
+
+{
+    CPLErr eErr = poBand->FlushBlock( nXOff, nYOff );
+    if (eErr != CE_None)
+    {
+        /* Save the error for later reporting */
+        poBand->SetFlushBlockErr(eErr);
+    }
+
+    if( poLockedDS != NULL )
+        poLockedDS->LeaveBlockIO();
+}
+
 /************************************************************************/
 /*                          FlushCacheBlock()                           */
 /*                                                                      */
@@ -310,36 +510,400 @@ int CPL_STDCALL GDALFlushCacheBlock()
 int GDALRasterBlock::FlushCacheBlock()
 
 {
-    int nXOff, nYOff;
-    GDALRasterBand *poBand;
+    int nXOff = 0, nYOff = 0;
+    GDALRasterBand *poBand = NULL;
+    GDALDataset *poLockedDS = NULL;
+    const int nShards = nShardCount;
+
+    const int iBestShard = GDALRBFindOldestShard();
+    if( iBestShard < 0 )
+        return FALSE;
+
+/* -------------------------------------------------------------------- */
+/*      Detach the oldest unlocked block of that shard, falling back    */
+/*      on the following shards if all its blocks are locked.  With     */
+/*      write-back enabled, a first pass only considers clean blocks    */
+/*      and the dirty blocks of datasets this thread is working on, so  */
+/*      that the dirty blocks of other threads are left to the          */
+/*      write-back threads.                                             */
+/* -------------------------------------------------------------------- */
+    const int nPasses = IsWriteBackEnabled() ? 2 : 1;
 
+/* -------------------------------------------------------------------- */
+/*      Blocks of high priority bands are only considered once all      */
+/*      the other blocks have been found locked or pinned.              */
+/* -------------------------------------------------------------------- */
+    for( int bHigh = FALSE; bHigh <= TRUE && poBand == NULL; bHigh++ )
     {
-        CPLMutexHolderD( &hRBMutex );
-        GDALRasterBlock *poTarget = (GDALRasterBlock *) poOldest;
+        for( int iPass = 0; iPass < nPasses && poBand == NULL; iPass++ )
+        {
+            if( iPass == 1 )
+                WakeUpWriteBack();
 
-        while( poTarget != NULL && poTarget->GetLockCount() > 0 ) 
-            poTarget = poTarget->poPrevious;
-        
-        if( poTarget == NULL )
-            return FALSE;
+            for( int i = 0; i < nShards && poBand == NULL; i++ )
+            {
+                SelectEvictionTarget( (iBestShard + i) % nShards,
+                                      iPass == nPasses - 1, bHigh, NULL,
+                                      &poBand, &nXOff, &nYOff, &poLockedDS );
+            }
+        }
+    }
+
+    if( poBand == NULL )
+        return FALSE;
+
+    FlushEvictedBlock( poBand, nXOff, nYOff, poLockedDS );
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                       FlushDatasetCacheBlock()                       */
+/************************************************************************/
+
+/**
+ * \brief Try to flush one cached raster block of a dataset.
+ *
+ * This is used to keep the cache use of a dataset within its quota (see
+ * GDALDataset::SetCacheQuota()).  The oldest unlocked and unpinned block
+ * of the shard with the oldest block is preferred, but the cache priority
+ * of the bands is ignored.  Dirty blocks are written.
+ *
+ * @param poDS the dataset whose block must be flushed.
+ *
+ * @return TRUE if successful or FALSE if no flushable block is found.
+ *
+ * @since GDAL 2.0
+ */
+
+int GDALRasterBlock::FlushDatasetCacheBlock( GDALDataset *poDS )
 
-        poTarget->Detach();
+{
+    int nXOff = 0, nYOff = 0;
+    GDALRasterBand *poBand = NULL;
+    GDALDataset *poLockedDS = NULL;
+    const int nShards = nShardCount;
+
+    const int iBestShard = GDALRBFindOldestShard();
+    if( iBestShard < 0 )
+        return FALSE;
 
-        nXOff = poTarget->GetXOff();
-        nYOff = poTarget->GetYOff();
-        poBand = poTarget->GetBand();
+    for( int i = 0; i < nShards && poBand == NULL; i++ )
+    {
+        SelectEvictionTarget( (iBestShard + i) % nShards, TRUE, TRUE, poDS,
+                              &poBand, &nXOff, &nYOff, &poLockedDS );
     }
 
-    CPLErr eErr = poBand->FlushBlock( nXOff, nYOff );
-    if (eErr != CE_None)
+    if( poBand == NULL )
+        return FALSE;
+
+    FlushEvictedBlock( poBand, nXOff, nYOff, poLockedDS );
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                        SelectEvictionTarget()                        */
+/*                                                                      */
+/*      Detach the oldest block of a shard that can be evicted.  When   */
+/*      write-back is enabled, a dirty block is only selected if        */
+/*      bDirtyAllowed is set or if the current thread is doing I/O on   */
+/*      its dataset, and the right to do I/O on the dataset is then     */
+/*      acquired (*ppoLockedDS), to be released once it is flushed.     */
+/*      Without write-back, this right is only acquired while some      */
+/*      GDALBlockIOHolder explicitly holds one.                         */
+/*      Pinned blocks are never selected, blocks of high priority       */
+/*      bands only if bHighPriorityAllowed is set, and only blocks of   */
+/*      poDSFilter if it is not NULL.                                   */
+/************************************************************************/
+
+int GDALRasterBlock::SelectEvictionTarget( int iShard, int bDirtyAllowed,
+                                           int bHighPriorityAllowed,
+                                           GDALDataset *poDSFilter,
+                                           GDALRasterBand **ppoBand,
+                                           int *pnXOff, int *pnYOff,
+                                           GDALDataset **ppoLockedDS )
+
+{
+    const int bWriteBack = IsWriteBackEnabled();
+
+    GDALRBShardHolder oShardHolder( iShard );
+
+    GDALRasterBlock *poTarget = asShards[iShard].poOldest;
+
+    for( ; poTarget != NULL; poTarget = poTarget->poPrevious )
     {
-        /* Save the error for later reporting */
-        poBand->SetFlushBlockErr(eErr);
+        if( poTarget->GetLockCount() > 0 || poTarget->bPinned )
+            continue;
+
+        if( !bHighPriorityAllowed
+            && poTarget->poBand->eCachePriority == GCPRI_High )
+            continue;
+
+        GDALDataset *poDS = poTarget->poBand->GetDataset();
+        if( poDSFilter != NULL && poDS != poDSFilter )
+            continue;
+
+        if( !poTarget->GetDirty() || poDS == NULL )
+            break;
+
+        /* Without write-back, the right to do block I/O is only held   */
+        /* explicitly (see GDALBlockIOHolder), and a dirty block of a   */
+        /* dataset written by another thread must not be flushed here. */
+        if( !bWriteBack && CPLAtomicAdd( &nExplicitBlockIOHolds, 0 ) == 0 )
+            break;
+
+        if( (!bWriteBack || bDirtyAllowed
+             || poDS->IsBlockIOOwnedByCurrentThread())
+            && poDS->EnterBlockIO( TRUE ) )
+        {
+            *ppoLockedDS = poDS;
+            break;
+        }
     }
 
+    if( poTarget == NULL )
+        return FALSE;
+
+    poTarget->Detach();
+
+    asShards[iShard].nEvictions++;
+    CPLAtomicInc( &(poTarget->poBand->nCacheEvictions) );
+
+    *pnXOff = poTarget->GetXOff();
+    *pnYOff = poTarget->GetYOff();
+    *ppoBand = poTarget->GetBand();
+
     return TRUE;
 }
 
+/************************************************************************/
+/*                         IsWriteBackEnabled()                         */
+/************************************************************************/
+
+/**
+ * Return whether dirty blocks are written by background threads.
+ *
+ * The number of write-back threads is fetched from the
+ * GDAL_CACHE_WRITEBACK_THREADS configuration option (a number of threads
+ * or ALL_CPUS, 0 by default, i.e. disabled) the first time this is called,
+ * and then kept until DestroyRBMutex() is called.
+ *
+ * @since GDAL 2.0
+ */
+
+int GDALRasterBlock::IsWriteBackEnabled()
+
+{
+    if( nWriteBackThreads < 0 )
+    {
+        const char *pszThreads =
+            CPLGetConfigOption( "GDAL_CACHE_WRITEBACK_THREADS", "0" );
+        if( EQUAL(pszThreads, "ALL_CPUS") || atoi(pszThreads) > 0 )
+            nWriteBackThreads = CPLGetNumThreadsFromOption( pszThreads, 1 );
+        else
+            nWriteBackThreads = 0;
+    }
+
+    return nWriteBackThreads > 0;
+}
+
+/************************************************************************/
+/*                          WakeUpWriteBack()                           */
+/*                                                                      */
+/*      Start the write-back threads if needed, and wake them up.       */
+/************************************************************************/
+
+void GDALRasterBlock::WakeUpWriteBack()
+
+{
+    /* Nothing to do if the threads are already all busy */
+    if( pahWBThreads != NULL && nWBIdleThreads == 0 )
+        return;
+
+    CPLMutexHolderD( &hWBMutex );
+
+    if( pahWBThreads == NULL && !bWBStop )
+    {
+        hWBCond = CPLCreateCond();
+        pahWBThreads = (void **) CPLCalloc( sizeof(void*), nWriteBackThreads );
+        for( int i = 0; i < nWriteBackThreads; i++ )
+        {
+            pahWBThreads[i] = CPLCreateJoinableThread( WriteBackThread, NULL );
+            if( pahWBThreads[i] == NULL )
+                CPLError( CE_Warning, CPLE_AppDefined,
+                          "Cannot start block cache write-back thread" );
+        }
+        CPLDebug( "GDAL", "Started %d block cache write-back thread(s)",
+                  nWriteBackThreads );
+    }
+
+    nWBGeneration++;
+    CPLCondBroadcast( hWBCond );
+}
+
+/************************************************************************/
+/*                          WriteBackThread()                           */
+/************************************************************************/
+
+void GDALRasterBlock::WriteBackThread( void * )
+
+{
+    int nLastGeneration = 0;
+
+    CPLAcquireMutex( hWBMutex, 1000.0 );
+
+    while( !bWBStop )
+    {
+        if( nLastGeneration == nWBGeneration )
+        {
+            nWBIdleThreads++;
+            CPLCondWait( hWBCond, hWBMutex );
+            nWBIdleThreads--;
+            continue;
+        }
+        nLastGeneration = nWBGeneration;
+
+        CPLReleaseMutex( hWBMutex );
+
+        while( !bWBStop
+               && GDALGetCacheUsed64() > GDALGetCacheMax64() / 100
+                                         * GDAL_RB_WRITEBACK_THRESHOLD_PCT
+               && WriteBackOldestDirtyBlock() ) {}
+
+        CPLAcquireMutex( hWBMutex, 1000.0 );
+    }
+
+    CPLReleaseMutex( hWBMutex );
+}
+
+/************************************************************************/
+/*                     WriteBackOldestDirtyBlock()                      */
+/*                                                                      */
+/*      Write the oldest unlocked dirty block of a dataset no other     */
+/*      thread is doing I/O on.  The block stays in the cache, clean.   */
+/*      Returns FALSE if no such block could be found.                  */
+/************************************************************************/
+
+int GDALRasterBlock::WriteBackOldestDirtyBlock()
+
+{
+    const int nShards = nShardCount;
+    const int iBestShard = GDALRBFindOldestShard();
+
+    if( iBestShard < 0 )
+        return FALSE;
+
+    for( int i = 0; i < nShards; i++ )
+    {
+        const int iShard = (iBestShard + i) % nShards;
+        GDALRasterBlock *poTarget = NULL;
+        GDALDataset *poDS = NULL;
+
+        {
+            GDALRBShardHolder oShardHolder( iShard );
+
+            for( poTarget = asShards[iShard].poOldest;
+                 poTarget != NULL;
+                 poTarget = poTarget->poPrevious )
+            {
+                if( !poTarget->GetDirty() || poTarget->GetLockCount() > 0 )
+                    continue;
+
+                poDS = poTarget->poBand->GetDataset();
+                if( poDS != NULL && poDS->EnterBlockIO( TRUE ) )
+                    break;
+            }
+
+            if( poTarget == NULL )
+                continue;
+
+            poTarget->AddLock();
+        }
+
+        CPLErr eErr = poTarget->Write();
+        if( eErr != CE_None )
+            poTarget->poBand->SetFlushBlockErr( eErr );
+
+        {
+            GDALRBShardHolder oShardHolder( iShard );
+            poTarget->DropLock();
+        }
+
+        poDS->LeaveBlockIO();
+
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/************************************************************************/
+/*                           GetShardCount()                            */
+/************************************************************************/
+
+/**
+ * Return the number of block cache shards.
+ *
+ * The value is fetched from the GDAL_CACHE_SHARDS configuration option
+ * the first time a block is created, rounded down to a power of two and
+ * then kept until DestroyRBMutex() is called.  Setting it to 1 restores
+ * a single, strictly ordered, LRU list.
+ */
+
+int GDALRasterBlock::GetShardCount()
+
+{
+    if( nShardCount == 0 )
+    {
+        int nShards = atoi( CPLGetConfigOption( "GDAL_CACHE_SHARDS",
+                                CPLSPrintf("%d", GDAL_RB_DEFAULT_SHARDS) ) );
+        if( nShards < 1 )
+            nShards = 1;
+        else if( nShards > GDAL_RB_MAX_SHARDS )
+            nShards = GDAL_RB_MAX_SHARDS;
+
+        int nPow2 = 1;
+        while( nPow2 * 2 <= nShards )
+            nPow2 *= 2;
+
+        nShardCount = nPow2;
+    }
+
+    return nShardCount;
+}
+
+/************************************************************************/
+/*                           GetShardIndex()                            */
+/************************************************************************/
+
+/**
+ * Return the index of the cache shard holding a given block.
+ *
+ * @param poBand the band owning the block.
+ * @param nXOff the horizontal block offset.
+ * @param nYOff the vertical block offset.
+ *
+ * @return a shard index between 0 and the shard count minus one.
+ */
+
+int GDALRasterBlock::GetShardIndex( GDALRasterBand *poBand,
+                                    int nXOff, int nYOff )
+
+{
+    const int nShards = GetShardCount();
+    if( nShards == 1 )
+        return 0;
+
+    GUIntBig nHash = (GUIntBig) (size_t) poBand;
+    nHash = (nHash >> 4) * 0x9E3779B97F4A7C15ULL;
+    nHash ^= ((GUIntBig) (unsigned int) nXOff) * 0xC2B2AE3D27D4EB4FULL;
+    nHash ^= ((GUIntBig) (unsigned int) nYOff) * 0x165667B19E3779F9ULL;
+    nHash ^= nHash >> 29;
+
+    return (int) (nHash & (GUIntBig) (nShards - 1));
+}
+
 /************************************************************************/
 /*                          GDALRasterBlock()                           */
 /************************************************************************/
@@ -377,6 +941,11 @@ GDALRasterBlock::GDALRasterBlock( GDALRasterBand *poBandIn,
 
     nXOff = nXOffIn;
     nYOff = nYOffIn;
+
+    nShard = GetShardIndex( poBand, nXOff, nYOff );
+    nTouchTick = 0;
+
+    bPinned = FALSE;
 }
 
 /************************************************************************/
@@ -403,9 +972,12 @@ GDALRasterBlock::~GDALRasterBlock()
         nSizeInBytes = nXSize * nYSize * (GDALGetDataTypeSize(eType) / 8);
 
         {
-            CPLMutexHolderD( &hRBMutex );
-            nCacheUsed -= nSizeInBytes;
+            GDALRBShardHolder oShardHolder( nShard );
+            asShards[nShard].nCacheUsed -= nSizeInBytes;
         }
+
+        if( poBand->GetDataset() != NULL )
+            poBand->GetDataset()->AddCacheUsed( -nSizeInBytes );
     }
 
     CPLAssert( nLockCount == 0 );
@@ -431,14 +1003,20 @@ GDALRasterBlock::~GDALRasterBlock()
 void GDALRasterBlock::Detach()
 
 {
-    CPLMutexHolderD( &hRBMutex );
+    GDALRasterBlockShard &sShard = asShards[nShard];
 
-    if( poOldest == this )
-        poOldest = poPrevious;
+    GDALRBShardHolder oShardHolder( nShard );
+
+    if( sShard.poOldest == this )
+    {
+        sShard.poOldest = poPrevious;
+        if( poPrevious != NULL )
+            sShard.nOldestTick = poPrevious->nTouchTick;
+    }
 
-    if( poNewest == this )
+    if( sShard.poNewest == this )
     {
-        poNewest = poNext;
+        sShard.poNewest = poNext;
     }
 
     if( poPrevious != NULL )
@@ -463,28 +1041,35 @@ void GDALRasterBlock::Detach()
 void GDALRasterBlock::Verify()
 
 {
-    CPLMutexHolderD( &hRBMutex );
+    for( int iShard = 0; iShard < nShardCount; iShard++ )
+    {
+        GDALRasterBlockShard &sShard = asShards[iShard];
 
-    CPLAssert( (poNewest == NULL && poOldest == NULL)
-               || (poNewest != NULL && poOldest != NULL) );
+        GDALRBShardHolder oShardHolder( iShard );
 
-    if( poNewest != NULL )
-    {
-        CPLAssert( poNewest->poPrevious == NULL );
-        CPLAssert( poOldest->poNext == NULL );
-        
-        for( GDALRasterBlock *poBlock = (GDALRasterBlock *) poNewest; 
-             poBlock != NULL;
-             poBlock = poBlock->poNext )
+        CPLAssert( (sShard.poNewest == NULL && sShard.poOldest == NULL)
+                   || (sShard.poNewest != NULL && sShard.poOldest != NULL) );
+
+        if( sShard.poNewest != NULL )
         {
-            if( poBlock->poPrevious )
-            {
-                CPLAssert( poBlock->poPrevious->poNext == poBlock );
-            }
+            CPLAssert( sShard.poNewest->poPrevious == NULL );
+            CPLAssert( sShard.poOldest->poNext == NULL );
 
-            if( poBlock->poNext )
+            for( GDALRasterBlock *poBlock = sShard.poNewest;
+                 poBlock != NULL;
+                 poBlock = poBlock->poNext )
             {
-                CPLAssert( poBlock->poNext->poPrevious == poBlock );
+                CPLAssert( poBlock->nShard == iShard );
+
+                if( poBlock->poPrevious )
+                {
+                    CPLAssert( poBlock->poPrevious->poNext == poBlock );
+                }
+
+                if( poBlock->poNext )
+                {
+                    CPLAssert( poBlock->poNext->poPrevious == poBlock );
+                }
             }
         }
     }
@@ -515,6 +1100,12 @@ CPLErr GDALRasterBlock::Write()
 
     MarkClean();
 
+    {
+        GDALRBShardHolder oShardHolder( nShard );
+        asShards[nShard].nDirtyFlushes++;
+        CPLAtomicInc( &(poBand->nCacheDirtyFlushes) );
+    }
+
     if (poBand->eFlushBlockErr == CE_None)
         return poBand->IWriteBlock( nXOff, nYOff, pData );
     else
@@ -535,13 +1126,59 @@ CPLErr GDALRasterBlock::Write()
 void GDALRasterBlock::Touch()
 
 {
-    CPLMutexHolderD( &hRBMutex );
+    GDALRasterBlockShard &sShard = asShards[nShard];
+
+    GDALRBShardHolder oShardHolder( nShard );
+
+    nTouchTick = CPLAtomicInc( &nTouchTickCounter );
+
+/* -------------------------------------------------------------------- */
+/*      Low priority blocks go to the old end of the list instead.      */
+/* -------------------------------------------------------------------- */
+    if( poBand->eCachePriority == GCPRI_Low )
+    {
+        nTouchTick -= GDAL_RB_LOW_PRIORITY_TICK_OFFSET;
+
+        if( sShard.poOldest != this )
+        {
+            if( sShard.poNewest == this )
+                sShard.poNewest = poNext;
+
+            if( poPrevious != NULL )
+                poPrevious->poNext = poNext;
 
-    if( poNewest == this )
+            if( poNext != NULL )
+                poNext->poPrevious = poPrevious;
+
+            poNext = NULL;
+            poPrevious = sShard.poOldest;
+
+            if( sShard.poOldest != NULL )
+            {
+                CPLAssert( sShard.poOldest->poNext == NULL );
+                sShard.poOldest->poNext = this;
+            }
+            sShard.poOldest = this;
+
+            if( sShard.poNewest == NULL )
+                sShard.poNewest = this;
+        }
+        sShard.nOldestTick = nTouchTick;
+        return;
+    }
+
+    if( sShard.poNewest == this )
+    {
+        if( sShard.poOldest == this )
+            sShard.nOldestTick = nTouchTick;
         return;
+    }
 
-    if( poOldest == this )
-        poOldest = this->poPrevious;
+    if( sShard.poOldest == this )
+    {
+        sShard.poOldest = this->poPrevious;
+        sShard.nOldestTick = sShard.poOldest->nTouchTick;
+    }
     
     if( poPrevious != NULL )
         poPrevious->poNext = poNext;
@@ -550,19 +1187,20 @@ void GDALRasterBlock::Touch()
         poNext->poPrevious = poPrevious;
 
     poPrevious = NULL;
-    poNext = (GDALRasterBlock *) poNewest;
+    poNext = sShard.poNewest;
 
-    if( poNewest != NULL )
+    if( sShard.poNewest != NULL )
     {
-        CPLAssert( poNewest->poPrevious == NULL );
-        poNewest->poPrevious = this;
+        CPLAssert( sShard.poNewest->poPrevious == NULL );
+        sShard.poNewest->poPrevious = this;
     }
-    poNewest = this;
+    sShard.poNewest = this;
     
-    if( poOldest == NULL )
+    if( sShard.poOldest == NULL )
     {
         CPLAssert( poPrevious == NULL && poNext == NULL );
-        poOldest = this;
+        sShard.poOldest = this;
+        sShard.nOldestTick = nTouchTick;
     }
 #ifdef ENABLE_DEBUG
     Verify();
@@ -587,7 +1225,6 @@ void GDALRasterBlock::Touch()
 CPLErr GDALRasterBlock::Internalize()
 
 {
-    CPLMutexHolderD( &hRBMutex );
     void        *pNewData;
     int         nSizeInBytes;
     GIntBig     nCurCacheMax = GDALGetCacheMax64();
@@ -611,20 +1248,52 @@ CPLErr GDALRasterBlock::Internalize()
 
 /* -------------------------------------------------------------------- */
 /*      Flush old blocks if we are nearing our memory limit.            */
+/*                                                                      */
+/*      The shard mutex is not held while flushing, as evicting a       */
+/*      block of another shard must not require holding two shard       */
+/*      locks at once.                                                  */
 /* -------------------------------------------------------------------- */
     AddLock(); /* don't flush this block! */
 
-    nCacheUsed += nSizeInBytes;
+    {
+        GDALRBShardHolder oShardHolder( nShard );
+        asShards[nShard].nCacheUsed += nSizeInBytes;
+        asShards[nShard].nMisses++;
+        CPLAtomicInc( &(poBand->nCacheMisses) );
+    }
+
+    GDALDataset *poDS = poBand->GetDataset();
+    if( poDS != NULL )
+        poDS->AddCacheUsed( nSizeInBytes );
+
+    GIntBig nCacheUsed = GDALGetCacheUsed64();
+
+    if( IsWriteBackEnabled()
+        && nCacheUsed > nCurCacheMax / 100 * GDAL_RB_WRITEBACK_THRESHOLD_PCT )
+        WakeUpWriteBack();
+
     while( nCacheUsed > nCurCacheMax )
     {
         GIntBig nOldCacheUsed = nCacheUsed;
 
         GDALFlushCacheBlock();
 
+        nCacheUsed = GDALGetCacheUsed64();
         if( nCacheUsed == nOldCacheUsed )
             break;
     }
 
+/* -------------------------------------------------------------------- */
+/*      Keep the dataset within its own quota, if it has one.           */
+/* -------------------------------------------------------------------- */
+    if( poDS != NULL )
+    {
+        const GIntBig nQuota = poDS->GetCacheQuota();
+
+        while( nQuota > 0 && poDS->GetCacheUsed() > nQuota
+               && FlushDatasetCacheBlock( poDS ) ) {}
+    }
+
 /* -------------------------------------------------------------------- */
 /*      Add this block to the list.                                     */
 /* -------------------------------------------------------------------- */
@@ -669,6 +1338,31 @@ void GDALRasterBlock::MarkClean()
     bDirty = FALSE;
 }
 
+/************************************************************************/
+/*                             SetPinned()                              */
+/************************************************************************/
+
+/**
+ * Pin or unpin the block.
+ *
+ * A pinned block is never evicted from the cache to make room for other
+ * blocks, but is still discarded by GDALRasterBand::FlushBlock() and
+ * GDALRasterBand::FlushCache().  Normally called from
+ * GDALRasterBand::PinBlock() and GDALRasterBand::UnpinBlock().
+ *
+ * @param bPinnedIn TRUE to pin the block, FALSE to unpin it.
+ *
+ * @since GDAL 2.0
+ */
+
+void GDALRasterBlock::SetPinned( int bPinnedIn )
+
+{
+    GDALRBShardHolder oShardHolder( nShard );
+
+    bPinned = bPinnedIn;
+}
+
 /************************************************************************/
 /*                           SafeLockBlock()                            */
 /************************************************************************/
@@ -677,11 +1371,16 @@ void GDALRasterBlock::MarkClean()
  * \brief Safely lock block.
  *
  * This method locks a GDALRasterBlock (and touches it) in a thread-safe
- * manner.  The global block cache mutex is held while locking the block,
+ * manner.  The block cache mutexes are held while locking the block,
  * in order to avoid race conditions with other threads that might be
  * trying to expire the block at the same time.  The block pointer may be
  * safely NULL, in which case this method does nothing. 
  *
+ * As the shard of the block cannot be known without dereferencing the
+ * block pointer, this version has to acquire the mutexes of all the cache
+ * shards.  The version taking the band and block offsets should be
+ * preferred.
+ *
  * @param ppBlock Pointer to the block pointer to try and lock/touch.
  */
  
@@ -690,12 +1389,76 @@ int GDALRasterBlock::SafeLockBlock( GDALRasterBlock ** ppBlock )
 {
     CPLAssert( NULL != ppBlock );
 
-    CPLMutexHolderD( &hRBMutex );
+    const int nShards = GetShardCount();
+    int iShard;
+
+    for( iShard = 0; iShard < nShards; iShard++ )
+    {
+        GIntBig nStart = GDALGetMicroSecondCounter();
+        CPLCreateOrAcquireMutex( &(asShards[iShard].hMutex), 1000.0 );
+        GIntBig nWait = GDALGetMicroSecondCounter() - nStart;
+        if( nWait > 0 )
+            asShards[iShard].nLockWaitMicros += nWait;
+    }
+
+    int bRet = FALSE;
+    if( *ppBlock != NULL )
+    {
+        (*ppBlock)->AddLock();
+        (*ppBlock)->Touch();
+        
+        bRet = TRUE;
+    }
+
+    for( iShard = nShards - 1; iShard >= 0; iShard-- )
+        CPLReleaseMutex( asShards[iShard].hMutex );
+
+    return bRet;
+}
+
+/**
+ * \brief Safely lock block.
+ *
+ * This method locks a GDALRasterBlock (and touches it) in a thread-safe
+ * manner.  The mutex of the block cache shard to which the block belongs
+ * is held while locking the block, in order to avoid race conditions with
+ * other threads that might be trying to expire the block at the same time.
+ * The block pointer may be safely NULL, in which case this method does
+ * nothing. 
+ *
+ * @param ppBlock Pointer to the block pointer to try and lock/touch.
+ * @param poBand the band owning the block.
+ * @param nXOff the horizontal block offset.
+ * @param nYOff the vertical block offset.
+ * @param bCountAsHit whether a successful lock must be counted as a cache
+ * hit in the block cache statistics.
+ *
+ * @since GDAL 2.0
+ */
+
+int GDALRasterBlock::SafeLockBlock( GDALRasterBlock ** ppBlock,
+                                    GDALRasterBand *poBand,
+                                    int nXOff, int nYOff, int bCountAsHit )
+
+{
+    CPLAssert( NULL != ppBlock );
+
+    const int iShard = GetShardIndex( poBand, nXOff, nYOff );
+
+    GDALRBShardHolder oShardHolder( iShard );
 
     if( *ppBlock != NULL )
     {
+        CPLAssert( (*ppBlock)->nShard == iShard );
+
         (*ppBlock)->AddLock();
         (*ppBlock)->Touch();
+
+        if( bCountAsHit )
+        {
+            asShards[iShard].nHits++;
+            CPLAtomicInc( &(poBand->nCacheHits) );
+        }
         
         return TRUE;
     }
@@ -709,7 +1472,332 @@ int GDALRasterBlock::SafeLockBlock( GDALRasterBlock ** ppBlock )
 
 void GDALRasterBlock::DestroyRBMutex()
 {
-    if( hRBMutex != NULL )
-        CPLDestroyMutex(hRBMutex);
-    hRBMutex = NULL;
+    if( hWBMutex != NULL )
+    {
+        CPLAcquireMutex( hWBMutex, 1000.0 );
+        bWBStop = TRUE;
+        if( hWBCond != NULL )
+            CPLCondBroadcast( hWBCond );
+        CPLReleaseMutex( hWBMutex );
+
+        for( int i = 0; pahWBThreads != NULL && i < nWriteBackThreads; i++ )
+        {
+            if( pahWBThreads[i] != NULL )
+                CPLJoinThread( pahWBThreads[i] );
+        }
+        CPLFree( pahWBThreads );
+        pahWBThreads = NULL;
+
+        if( hWBCond != NULL )
+            CPLDestroyCond( hWBCond );
+        hWBCond = NULL;
+        CPLDestroyMutex( hWBMutex );
+        hWBMutex = NULL;
+        bWBStop = FALSE;
+    }
+    nWriteBackThreads = -1;
+
+    for( int iShard = 0; iShard < GDAL_RB_MAX_SHARDS; iShard++ )
+    {
+        if( asShards[iShard].hMutex != NULL )
+            CPLDestroyMutex( asShards[iShard].hMutex );
+        asShards[iShard].hMutex = NULL;
+    }
+    nShardCount = 0;
+}
+
+/************************************************************************/
+/*                           GetCacheStats()                            */
+/************************************************************************/
+
+/**
+ * Collect block cache statistics.
+ *
+ * When poDS and poBand are both NULL, all the fields of psStats are set
+ * from the global counters and the whole cache content.  Otherwise only
+ * the nBlocks, nDirtyBlocks and nBytes fields are set, from the blocks
+ * of poBand if it is not NULL, or else from the blocks of the bands of
+ * poDS, and the other fields are set to zero.
+ *
+ * @param poDS the dataset whose blocks must be counted, or NULL.
+ * @param poBand the band whose blocks must be counted, or NULL.
+ * @param psStats the structure to fill.
+ *
+ * @since GDAL 2.0
+ */
+
+void GDALRasterBlock::GetCacheStats( GDALDataset *poDS, GDALRasterBand *poBand,
+                                     GDALCacheStats *psStats )
+
+{
+    const int bGlobal = (poDS == NULL && poBand == NULL);
+
+    memset( psStats, 0, sizeof(GDALCacheStats) );
+
+    for( int iShard = 0; iShard < nShardCount; iShard++ )
+    {
+        GDALRBShardHolder oShardHolder( iShard );
+        GDALRasterBlockShard &sShard = asShards[iShard];
+
+        if( bGlobal )
+        {
+            psStats->nHits += sShard.nHits;
+            psStats->nMisses += sShard.nMisses;
+            psStats->nEvictions += sShard.nEvictions;
+            psStats->nDirtyFlushes += sShard.nDirtyFlushes;
+            psStats->nLockWaitMicroseconds += sShard.nLockWaitMicros;
+        }
+
+        for( GDALRasterBlock *poBlock = sShard.poNewest;
+             poBlock != NULL;
+             poBlock = poBlock->poNext )
+        {
+            if( poBand != NULL && poBlock->poBand != poBand )
+                continue;
+            if( poBand == NULL && poDS != NULL
+                && poBlock->poBand->GetDataset() != poDS )
+                continue;
+
+            psStats->nBlocks++;
+            if( poBlock->bDirty )
+                psStats->nDirtyBlocks++;
+            psStats->nBytes += (GIntBig) poBlock->nXSize * poBlock->nYSize
+                * (GDALGetDataTypeSize(poBlock->eType) / 8);
+        }
+    }
+}
+
+/************************************************************************/
+/*                       GetCacheUsageByDataset()                       */
+/************************************************************************/
+
+/**
+ * Break down the block cache content by dataset.
+ *
+ * @param ppasUsage location where to return an array, to be freed with
+ * CPLFree(), of one entry per dataset having blocks in the cache, sorted
+ * by decreasing number of bytes.  Set to NULL if the cache is empty.
+ *
+ * @return the number of entries of the array.
+ *
+ * @since GDAL 2.0
+ */
+
+static bool GDALRBCompareUsage( const GDALCacheDatasetUsage &sA,
+                                const GDALCacheDatasetUsage &sB )
+{
+    return sA.nBytes > sB.nBytes;
+}
+
+int GDALRasterBlock::GetCacheUsageByDataset( GDALCacheDatasetUsage **ppasUsage )
+
+{
+    std::map<GDALDataset*, GDALCacheDatasetUsage> oMapUsage;
+
+    for( int iShard = 0; iShard < nShardCount; iShard++ )
+    {
+        GDALRBShardHolder oShardHolder( iShard );
+
+        for( GDALRasterBlock *poBlock = asShards[iShard].poNewest;
+             poBlock != NULL;
+             poBlock = poBlock->poNext )
+        {
+            GDALDataset *poDS = poBlock->poBand->GetDataset();
+            std::map<GDALDataset*, GDALCacheDatasetUsage>::iterator oIter =
+                oMapUsage.find( poDS );
+
+            if( oIter == oMapUsage.end() )
+            {
+                GDALCacheDatasetUsage sUsage;
+
+                sUsage.hDS = (GDALDatasetH) poDS;
+                sUsage.nBlocks = 0;
+                sUsage.nDirtyBlocks = 0;
+                sUsage.nBytes = 0;
+                oIter = oMapUsage.insert(
+                    std::pair<GDALDataset*, GDALCacheDatasetUsage>(
+                        poDS, sUsage ) ).first;
+            }
+
+            oIter->second.nBlocks++;
+            if( poBlock->bDirty )
+                oIter->second.nDirtyBlocks++;
+            oIter->second.nBytes += (GIntBig) poBlock->nXSize * poBlock->nYSize
+                * (GDALGetDataTypeSize(poBlock->eType) / 8);
+        }
+    }
+
+    std::vector<GDALCacheDatasetUsage> asUsage;
+    std::map<GDALDataset*, GDALCacheDatasetUsage>::iterator oIter;
+
+    for( oIter = oMapUsage.begin(); oIter != oMapUsage.end(); ++oIter )
+        asUsage.push_back( oIter->second );
+    std::sort( asUsage.begin(), asUsage.end(), GDALRBCompareUsage );
+
+    *ppasUsage = NULL;
+    if( asUsage.empty() )
+        return 0;
+
+    *ppasUsage = (GDALCacheDatasetUsage *)
+        CPLMalloc( sizeof(GDALCacheDatasetUsage) * asUsage.size() );
+    memcpy( *ppasUsage, &asUsage[0],
+            sizeof(GDALCacheDatasetUsage) * asUsage.size() );
+
+    return (int) asUsage.size();
+}
+
+/************************************************************************/
+/*                          ResetCacheStats()                           */
+/************************************************************************/
+
+/**
+ * Reset the global block cache counters.
+ *
+ * The counters of the bands are not affected, see GDALResetCacheStats().
+ *
+ * @since GDAL 2.0
+ */
+
+void GDALRasterBlock::ResetCacheStats()
+
+{
+    for( int iShard = 0; iShard < nShardCount; iShard++ )
+    {
+        GDALRBShardHolder oShardHolder( iShard );
+        GDALRasterBlockShard &sShard = asShards[iShard];
+
+        sShard.nHits = 0;
+        sShard.nMisses = 0;
+        sShard.nEvictions = 0;
+        sShard.nDirtyFlushes = 0;
+        sShard.nLockWaitMicros = 0;
+    }
+}
+
+/************************************************************************/
+/*                         GDALGetCacheStats()                          */
+/************************************************************************/
+
+/**
+ * \brief Fetch the global block cache statistics.
+ *
+ * The counters (hits, misses, evictions, dirty flushes and time spent
+ * waiting for the cache mutexes) are cumulated since the first use of the
+ * cache or the last call to GDALResetCacheStats().  The other fields
+ * describe the current content of the cache.  Fetching the statistics
+ * requires walking the whole cache and should not be done in performance
+ * critical loops.
+ *
+ * @param psStats the structure to fill.
+ *
+ * @since GDAL 2.0
+ */
+
+void CPL_STDCALL GDALGetCacheStats( GDALCacheStats *psStats )
+
+{
+    VALIDATE_POINTER0( psStats, "GDALGetCacheStats" );
+
+    GDALRasterBlock::GetCacheStats( NULL, NULL, psStats );
+}
+
+/************************************************************************/
+/*                        GDALResetCacheStats()                         */
+/************************************************************************/
+
+/**
+ * \brief Reset the block cache statistics.
+ *
+ * The global counters, the counters of the bands of all the open datasets
+ * and the IReadBlock() latency histograms of all the drivers are reset.
+ *
+ * @since GDAL 2.0
+ */
+
+void CPL_STDCALL GDALResetCacheStats()
+
+{
+    GDALRasterBlock::ResetCacheStats();
+
+    int nDSCount = 0;
+    GDALDataset **papoDS = GDALDataset::GetOpenDatasets( &nDSCount );
+    for( int iDS = 0; iDS < nDSCount; iDS++ )
+        papoDS[iDS]->ResetCacheStats();
+
+    GDALDriverManager *poDM = GetGDALDriverManager();
+    for( int iDriver = 0; iDriver < poDM->GetDriverCount(); iDriver++ )
+        poDM->GetDriver( iDriver )->ResetReadBlockLatencyHistogram();
+}
+
+/************************************************************************/
+/*                     GDALGetCacheUsageByDataset()                     */
+/************************************************************************/
+
+/**
+ * \brief Break down the block cache content by dataset.
+ *
+ * This is a snapshot of the blocks currently in the cache, grouped by the
+ * dataset owning their band.
+ *
+ * @param ppasUsage location where to return an array, to be freed with
+ * CPLFree(), of one entry per dataset having blocks in the cache, sorted
+ * by decreasing number of bytes.  Set to NULL if the cache is empty.
+ *
+ * @return the number of entries of the array.
+ *
+ * @since GDAL 2.0
+ */
+
+int CPL_STDCALL GDALGetCacheUsageByDataset( GDALCacheDatasetUsage **ppasUsage )
+
+{
+    VALIDATE_POINTER1( ppasUsage, "GDALGetCacheUsageByDataset", 0 );
+
+    return GDALRasterBlock::GetCacheUsageByDataset( ppasUsage );
+}
+
+/************************************************************************/
+/* ==================================================================== */
+/*                          GDALBlockIOHolder                           */
+/* ==================================================================== */
+/************************************************************************/
+
+/**
+ * \class GDALBlockIOHolder "gdal_priv.h"
+ *
+ * Scoped right to do block I/O on a dataset.  When the block cache
+ * write-back threads are enabled, it is held by the RasterIO(), ReadBlock(),
+ * WriteBlock() and FlushCache() entry points, so that the write-back
+ * threads never write a dirty block of the dataset while another thread
+ * uses it.  It is recursive, and does nothing when write-back is disabled
+ * (unless bAlways is set) or if the dataset is NULL.
+ *
+ * Holding it with bAlways set also prevents the other threads from
+ * evicting (and writing) the dirty blocks of the dataset when they need
+ * room in the block cache.  Eviction is unchanged when no such hold
+ * exists.
+ */
+
+GDALBlockIOHolder::GDALBlockIOHolder( GDALDataset *poDSIn, int bAlways )
+
+{
+    poDS = NULL;
+    bExplicit = FALSE;
+    if( poDSIn != NULL && (bAlways || GDALRasterBlock::IsWriteBackEnabled()) )
+    {
+        poDS = poDSIn;
+        bExplicit = !GDALRasterBlock::IsWriteBackEnabled();
+        if( bExplicit )
+            CPLAtomicInc( &nExplicitBlockIOHolds );
+        poDS->EnterBlockIO( FALSE );
+    }
+}
+
+GDALBlockIOHolder::~GDALBlockIOHolder()
+
+{
+    if( poDS != NULL )
+        poDS->LeaveBlockIO();
+    if( bExplicit )
+        CPLAtomicDec( &nExplicitBlockIOHolds );
 }
@@ -0,0 +1,1699 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  GDAL Core
+ * Purpose:  Computation of statistics, min/max and histograms of raster
+ *           bands (GDALRasterBand::ComputeStatistics(), ComputeRasterMinMax()
+ *           and GetHistogram()).
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 1998, Frank Warmerdam
+ * Copyright (c) 2007-2014, Even Rouault <even dot rouault at mines-paris dot org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include "gdal_priv.h"
+#include "cpl_multiproc.h"
+
+#include <vector>
+
+CPL_CVSID("$Id$");
+
+/************************************************************************/
+/* ==================================================================== */
+/*                      Statistics computation engine                   */
+/*                                                                      */
+/*      The pixels to analyze are cut into chunks of about              */
+/*      GDAL_STATS_CHUNK_PIXELS pixels (pieces of one or several        */
+/*      blocks).  Each chunk produces a partial result (count, min,     */
+/*      max, mean and sum of squared deviations, or a histogram), and   */
+/*      the partial results are merged in chunk order with the          */
+/*      pairwise update of Chan et al., so that the mean and standard   */
+/*      deviation are as robust as with the Welford algorithm.          */
+/*                                                                      */
+/*      When GDAL_NUM_THREADS is greater than one, the chunks are       */
+/*      processed by jobs of the CPL thread pool.  The calling thread   */
+/*      does all the I/O (block and mask reads), as drivers are not     */
+/*      thread-safe, and keeps the blocks of the chunks in flight       */
+/*      locked until their job has completed.  The chunking does not    */
+/*      depend on the number of threads, so the results are identical   */
+/*      whatever the value of GDAL_NUM_THREADS.                         */
+/*                                                                      */
+/*      If the GDAL_STATS_USE_MASK configuration option is set to YES   */
+/*      (NO by default), the pixels masked by a mask band that is not   */
+/*      derived from the nodata value (alpha band, per-dataset or .msk  */
+/*      mask) are also ignored.                                         */
+/* ==================================================================== */
+/************************************************************************/
+
+#define GDAL_STATS_CHUNK_PIXELS     (256 * 1024)
+
+#define GDAL_STATS_MINMAX           0
+#define GDAL_STATS_MOMENTS          1
+#define GDAL_STATS_HISTOGRAM        2
+
+#if defined(__x86_64) || defined(_M_X64)
+#define HAVE_SSE2_STATS
+#include <emmintrin.h>
+#endif
+
+typedef struct
+{
+    GIntBig     nCount;
+    double      dfMin;
+    double      dfMax;
+    double      dfMean;
+    double      dfM2;       /* sum of squared differences to the mean */
+} GDALStatsAccumulator;
+
+typedef struct
+{
+    int             nMode;
+    GDALDataType    eDataType;
+    int             bSignedByte;
+    int             bGotNoData;
+    double          dfNoData;
+
+    /* Histogram mode only */
+    double          dfHistMin;
+    double          dfScale;
+    int             nBuckets;
+    int             bIncludeOutOfRange;
+    const int      *panLUT;     /* value to bucket (or -1) for 8/16 bit data */
+} GDALStatsRequest;
+
+typedef struct
+{
+    const GByte    *pabyData;
+    int             nLineStride;    /* in pixels */
+    int             nXSize;
+    int             nYSize;
+    const GByte    *pabyExtMask;    /* mask provided by the caller, or NULL */
+    int             nMaskOffset;    /* offset in abyMask of the chunk, or -1 */
+} GDALStatsPiece;
+
+typedef struct
+{
+    const GDALStatsRequest     *psReq;
+    std::vector<GDALStatsPiece> asPieces;
+    std::vector<GByte>          abyMask;
+    std::vector<double>         adfScratch;
+    int                         nPixels;
+    GDALStatsAccumulator        sAcc;
+    int                        *panHistogram;
+} GDALStatsChunk;
+
+/************************************************************************/
+/*                       GDALStatsMergeAccumulator()                    */
+/************************************************************************/
+
+static void GDALStatsMergeAccumulator( GDALStatsAccumulator *psDst,
+                                       const GDALStatsAccumulator *psSrc )
+{
+    if( psSrc->nCount == 0 )
+        return;
+    if( psDst->nCount == 0 )
+    {
+        *psDst = *psSrc;
+        return;
+    }
+
+    const double dfCount = (double) (psDst->nCount + psSrc->nCount);
+    const double dfDelta = psSrc->dfMean - psDst->dfMean;
+
+    psDst->dfMean += dfDelta * psSrc->nCount / dfCount;
+    psDst->dfM2 += psSrc->dfM2
+        + dfDelta * dfDelta * ((double) psDst->nCount * psSrc->nCount) / dfCount;
+    psDst->nCount += psSrc->nCount;
+    psDst->dfMin = MIN(psDst->dfMin, psSrc->dfMin);
+    psDst->dfMax = MAX(psDst->dfMax, psSrc->dfMax);
+}
+
+/************************************************************************/
+/*                        GDALStatsAddShiftedSums()                     */
+/*                                                                      */
+/*      Merge the result of a run of nCount values whose minimum and    */
+/*      maximum are known, and whose sum and sum of squares have been   */
+/*      computed on the values minus dfShift.                           */
+/************************************************************************/
+
+static void GDALStatsAddShiftedSums( GDALStatsAccumulator *psAcc,
+                                     GIntBig nCount,
+                                     double dfMin, double dfMax,
+                                     double dfShift,
+                                     double dfSum, double dfSum2 )
+{
+    if( nCount == 0 )
+        return;
+
+    GDALStatsAccumulator sRun;
+
+    sRun.nCount = nCount;
+    sRun.dfMin = dfMin;
+    sRun.dfMax = dfMax;
+    sRun.dfMean = dfShift + dfSum / nCount;
+    sRun.dfM2 = MAX(0.0, dfSum2 - dfSum * dfSum / nCount);
+
+    GDALStatsMergeAccumulator( psAcc, &sRun );
+}
+
+/************************************************************************/
+/*                          GDALStatsIsSkipped()                        */
+/*                                                                      */
+/*      Whether a value must be ignored because it is nodata or NaN.    */
+/*      For integer types, the nodata value has been rounded to an      */
+/*      integer by the caller, or discarded if it cannot match.         */
+/************************************************************************/
+
+template<class T>
+static inline int GDALStatsIsSkipped( T nValue, const GDALStatsRequest *psReq )
+{
+    return psReq->bGotNoData && (double) nValue == psReq->dfNoData;
+}
+
+static inline int GDALStatsIsSkipped( float fValue,
+                                      const GDALStatsRequest *psReq )
+{
+    const double dfValue = fValue;
+    return CPLIsNan(dfValue)
+        || (psReq->bGotNoData && ARE_REAL_EQUAL(dfValue, psReq->dfNoData));
+}
+
+static inline int GDALStatsIsSkipped( double dfValue,
+                                      const GDALStatsRequest *psReq )
+{
+    return CPLIsNan(dfValue)
+        || (psReq->bGotNoData && ARE_REAL_EQUAL(dfValue, psReq->dfNoData));
+}
+
+/************************************************************************/
+/*                           GDALStatsGenericRow()                      */
+/*                                                                      */
+/*      Min/max (and moments if bMoments) of a row, honouring nodata,   */
+/*      NaN and mask.  Sums are computed on the values minus the first  */
+/*      valid value of the row to limit the loss of precision.          */
+/************************************************************************/
+
+template<class T, int bMoments>
+static void GDALStatsGenericRow( const GDALStatsRequest *psReq,
+                                 const T *pData, const GByte *pabyMask,
+                                 int nCount, GDALStatsAccumulator *psAcc )
+{
+    GIntBig nValid = 0;
+    double dfMin = 0.0, dfMax = 0.0, dfShift = 0.0;
+    double dfSum = 0.0, dfSum2 = 0.0;
+
+    for( int i = 0; i < nCount; i++ )
+    {
+        if( pabyMask != NULL && pabyMask[i] == 0 )
+            continue;
+        if( GDALStatsIsSkipped( pData[i], psReq ) )
+            continue;
+
+        const double dfValue = (double) pData[i];
+
+        if( nValid == 0 )
+            dfMin = dfMax = dfShift = dfValue;
+        else if( dfValue < dfMin )
+            dfMin = dfValue;
+        else if( dfValue > dfMax )
+            dfMax = dfValue;
+        nValid++;
+
+        if( bMoments )
+        {
+            const double dfDelta = dfValue - dfShift;
+            dfSum += dfDelta;
+            dfSum2 += dfDelta * dfDelta;
+        }
+    }
+
+    GDALStatsAddShiftedSums( psAcc, nValid, dfMin, dfMax, dfShift,
+                             dfSum, dfSum2 );
+}
+
+/************************************************************************/
+/*                          GDALStatsIntegerRun()                       */
+/*                                                                      */
+/*      Fast path for 8 and 16 bit integer data without nodata nor      */
+/*      mask: exact integer sums, that the compiler can vectorize.      */
+/************************************************************************/
+
+template<class T>
+static void GDALStatsIntegerRun( const T *pData, int nCount,
+                                 GIntBig &nSum, GIntBig &nSum2,
+                                 int &nMin, int &nMax )
+{
+    int nLocalMin = nMin, nLocalMax = nMax;
+
+    for( int i = 0; i < nCount; i++ )
+    {
+        const int nValue = pData[i];
+        nSum += nValue;
+        nSum2 += nValue * (GIntBig) nValue;
+        if( nValue < nLocalMin )
+            nLocalMin = nValue;
+        if( nValue > nLocalMax )
+            nLocalMax = nValue;
+    }
+
+    nMin = nLocalMin;
+    nMax = nLocalMax;
+}
+
+#ifdef HAVE_SSE2_STATS
+
+/************************************************************************/
+/*                       GDALStatsIntegerRun<GByte>                     */
+/************************************************************************/
+
+template<>
+void GDALStatsIntegerRun<GByte>( const GByte *pabyData, int nCount,
+                                 GIntBig &nSum, GIntBig &nSum2,
+                                 int &nMin, int &nMax )
+{
+    const __m128i xmm_zero = _mm_setzero_si128();
+    __m128i xmm_sum = _mm_setzero_si128();
+    __m128i xmm_min = _mm_set1_epi8( (char) MIN(nMin, 255) );
+    __m128i xmm_max = _mm_set1_epi8( (char) MAX(nMax, 0) );
+    int i = 0;
+
+    while( i + 16 <= nCount )
+    {
+        /* 32 bit sums of squares: 4096 iterations add at most */
+        /* 4096 * 4 * 255^2 < 2^31 to each lane. */
+        const int nIters = MIN(4096, (nCount - i) / 16);
+        __m128i xmm_sum2 = _mm_setzero_si128();
+
+        for( int iIter = 0; iIter < nIters; iIter++, i += 16 )
+        {
+            const __m128i xmm_v =
+                _mm_loadu_si128( (const __m128i *) (pabyData + i) );
+            const __m128i xmm_lo = _mm_unpacklo_epi8( xmm_v, xmm_zero );
+            const __m128i xmm_hi = _mm_unpackhi_epi8( xmm_v, xmm_zero );
+
+            xmm_min = _mm_min_epu8( xmm_min, xmm_v );
+            xmm_max = _mm_max_epu8( xmm_max, xmm_v );
+            xmm_sum = _mm_add_epi64( xmm_sum, _mm_sad_epu8( xmm_v, xmm_zero ) );
+            xmm_sum2 = _mm_add_epi32( xmm_sum2,
+                                      _mm_madd_epi16( xmm_lo, xmm_lo ) );
+            xmm_sum2 = _mm_add_epi32( xmm_sum2,
+                                      _mm_madd_epi16( xmm_hi, xmm_hi ) );
+        }
+
+        GUInt32 anSum2[4];
+        _mm_storeu_si128( (__m128i *) anSum2, xmm_sum2 );
+        nSum2 += (GIntBig) anSum2[0] + anSum2[1] + anSum2[2] + anSum2[3];
+    }
+
+    GIntBig anSum[2];
+    GByte abyMin[16], abyMax[16];
+
+    _mm_storeu_si128( (__m128i *) anSum, xmm_sum );
+    _mm_storeu_si128( (__m128i *) abyMin, xmm_min );
+    _mm_storeu_si128( (__m128i *) abyMax, xmm_max );
+
+    nSum += anSum[0] + anSum[1];
+    if( nCount >= 16 )
+    {
+        for( int j = 0; j < 16; j++ )
+        {
+            nMin = MIN(nMin, abyMin[j]);
+            nMax = MAX(nMax, abyMax[j]);
+        }
+    }
+
+    for( ; i < nCount; i++ )
+    {
+        const int nValue = pabyData[i];
+        nSum += nValue;
+        nSum2 += nValue * nValue;
+        nMin = MIN(nMin, nValue);
+        nMax = MAX(nMax, nValue);
+    }
+}
+
+/************************************************************************/
+/*                        GDALStatsFloat32RunSSE2()                     */
+/*                                                                      */
+/*      Float32 data without nodata nor mask.  NaN are replaced by      */
+/*      the shift value, so that they do not contribute to the sums    */
+/*      nor to the min/max, and are not counted.                        */
+/************************************************************************/
+
+static void GDALStatsFloat32RunSSE2( const float *pafData, int nCount,
+                                     int bMoments,
+                                     GDALStatsAccumulator *psAcc )
+{
+    static const int anBitCount[16] =
+        { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+    int i = 0;
+
+    while( i < nCount && CPLIsNan(pafData[i]) )
+        i++;
+    if( i == nCount )
+        return;
+
+    const float fShift = pafData[i];
+    const __m128 xmm_shift_ps = _mm_set1_ps( fShift );
+    const __m128d xmm_shift = _mm_set1_pd( fShift );
+    __m128 xmm_min = xmm_shift_ps;
+    __m128 xmm_max = xmm_shift_ps;
+    __m128d xmm_sum = _mm_setzero_pd();
+    __m128d xmm_sum2 = _mm_setzero_pd();
+    GIntBig nValid = 0;
+
+    for( ; i + 4 <= nCount; i += 4 )
+    {
+        __m128 xmm_v = _mm_loadu_ps( pafData + i );
+        const __m128 xmm_ord = _mm_cmpord_ps( xmm_v, xmm_v );
+        const int nOrdMask = _mm_movemask_ps( xmm_ord );
+
+        if( nOrdMask == 0 )
+            continue;
+        if( nOrdMask != 0xf )
+            xmm_v = _mm_or_ps( _mm_and_ps( xmm_ord, xmm_v ),
+                               _mm_andnot_ps( xmm_ord, xmm_shift_ps ) );
+        nValid += anBitCount[nOrdMask];
+
+        xmm_min = _mm_min_ps( xmm_min, xmm_v );
+        xmm_max = _mm_max_ps( xmm_max, xmm_v );
+
+        if( bMoments )
+        {
+            const __m128d xmm_lo =
+                _mm_sub_pd( _mm_cvtps_pd( xmm_v ), xmm_shift );
+            const __m128d xmm_hi =
+                _mm_sub_pd( _mm_cvtps_pd( _mm_movehl_ps( xmm_v, xmm_v ) ),
+                            xmm_shift );
+            xmm_sum = _mm_add_pd( xmm_sum, _mm_add_pd( xmm_lo, xmm_hi ) );
+            xmm_sum2 = _mm_add_pd( xmm_sum2,
+                                   _mm_add_pd( _mm_mul_pd( xmm_lo, xmm_lo ),
+                                               _mm_mul_pd( xmm_hi, xmm_hi ) ) );
+        }
+    }
+
+    float afMin[4], afMax[4];
+    double adfSum[2], adfSum2[2];
+
+    _mm_storeu_ps( afMin, xmm_min );
+    _mm_storeu_ps( afMax, xmm_max );
+    _mm_storeu_pd( adfSum, xmm_sum );
+    _mm_storeu_pd( adfSum2, xmm_sum2 );
+
+    double dfMin = MIN(MIN(afMin[0], afMin[1]), MIN(afMin[2], afMin[3]));
+    double dfMax = MAX(MAX(afMax[0], afMax[1]), MAX(afMax[2], afMax[3]));
+    double dfSum = adfSum[0] + adfSum[1];
+    double dfSum2 = adfSum2[0] + adfSum2[1];
+
+    for( ; i < nCount; i++ )
+    {
+        const double dfValue = pafData[i];
+        if( CPLIsNan(dfValue) )
+            continue;
+        dfMin = MIN(dfMin, dfValue);
+        dfMax = MAX(dfMax, dfValue);
+        nValid++;
+        const double dfDelta = dfValue - fShift;
+        dfSum += dfDelta;
+        dfSum2 += dfDelta * dfDelta;
+    }
+
+    if( !bMoments )
+        dfSum = dfSum2 = 0.0;
+
+    GDALStatsAddShiftedSums( psAcc, nValid, dfMin, dfMax, fShift,
+                             dfSum, dfSum2 );
+}
+
+#endif /* HAVE_SSE2_STATS */
+
+/************************************************************************/
+/*                         GDALStatsIntegerPiece()                      */
+/************************************************************************/
+
+template<class T>
+static void GDALStatsIntegerPiece( const GDALStatsPiece *psPiece,
+                                   GDALStatsAccumulator *psAcc )
+{
+    const T *pData = (const T *) psPiece->pabyData;
+    GIntBig nSum = 0, nSum2 = 0;
+    int nMin = INT_MAX, nMax = INT_MIN;
+
+    if( psPiece->nLineStride == psPiece->nXSize )
+        GDALStatsIntegerRun( pData, psPiece->nXSize * psPiece->nYSize,
+                             nSum, nSum2, nMin, nMax );
+    else
+    {
+        for( int iY = 0; iY < psPiece->nYSize; iY++ )
+            GDALStatsIntegerRun( pData + (size_t) iY * psPiece->nLineStride,
+                                 psPiece->nXSize, nSum, nSum2, nMin, nMax );
+    }
+
+    const GIntBig nCount = (GIntBig) psPiece->nXSize * psPiece->nYSize;
+
+    GDALStatsAddShiftedSums( psAcc, nCount, nMin, nMax, 0.0,
+                             (double) nSum, (double) nSum2 );
+}
+
+/************************************************************************/
+/*                         GDALStatsGenericPiece()                      */
+/************************************************************************/
+
+template<class T>
+static void GDALStatsGenericPiece( const GDALStatsRequest *psReq,
+                                   const GDALStatsPiece *psPiece,
+                                   const GByte *pabyMask,
+                                   GDALStatsAccumulator *psAcc )
+{
+    const T *pData = (const T *) psPiece->pabyData;
+
+    for( int iY = 0; iY < psPiece->nYSize; iY++ )
+    {
+        const T *pRow = pData + (size_t) iY * psPiece->nLineStride;
+        const GByte *pabyMaskRow = pabyMask != NULL ?
+            pabyMask + (size_t) iY * psPiece->nXSize : NULL;
+
+        if( psReq->nMode == GDAL_STATS_MOMENTS )
+            GDALStatsGenericRow<T, TRUE>( psReq, pRow, pabyMaskRow,
+                                          psPiece->nXSize, psAcc );
+        else
+            GDALStatsGenericRow<T, FALSE>( psReq, pRow, pabyMaskRow,
+                                           psPiece->nXSize, psAcc );
+    }
+}
+
+/************************************************************************/
+/*                       GDALStatsHistogramPiece()                      */
+/************************************************************************/
+
+template<class T>
+static void GDALStatsHistogramPiece( const GDALStatsRequest *psReq,
+                                     const GDALStatsPiece *psPiece,
+                                     const GByte *pabyMask,
+                                     int *panHistogram )
+{
+    const T *pData = (const T *) psPiece->pabyData;
+    const int nBuckets = psReq->nBuckets;
+
+    for( int iY = 0; iY < psPiece->nYSize; iY++ )
+    {
+        const T *pRow = pData + (size_t) iY * psPiece->nLineStride;
+        const GByte *pabyMaskRow = pabyMask != NULL ?
+            pabyMask + (size_t) iY * psPiece->nXSize : NULL;
+
+        for( int iX = 0; iX < psPiece->nXSize; iX++ )
+        {
+            if( pabyMaskRow != NULL && pabyMaskRow[iX] == 0 )
+                continue;
+            if( GDALStatsIsSkipped( pRow[iX], psReq ) )
+                continue;
+
+            const int nIndex = (int)
+                floor(((double) pRow[iX] - psReq->dfHistMin) * psReq->dfScale);
+
+            if( nIndex < 0 )
+            {
+                if( psReq->bIncludeOutOfRange )
+                    panHistogram[0]++;
+            }
+            else if( nIndex >= nBuckets )
+            {
+                if( psReq->bIncludeOutOfRange )
+                    panHistogram[nBuckets-1]++;
+            }
+            else
+            {
+                panHistogram[nIndex]++;
+            }
+        }
+    }
+}
+
+/************************************************************************/
+/*                     GDALStatsHistogramLUTPiece()                     */
+/*                                                                      */
+/*      8 and 16 bit data: the bucket of each possible value (or -1     */
+/*      if the value must be ignored) is precomputed in panLUT.         */
+/************************************************************************/
+
+template<class T>
+static void GDALStatsHistogramLUTPiece( const int *panLUT,
+                                        const GDALStatsPiece *psPiece,
+                                        const GByte *pabyMask,
+                                        int *panHistogram )
+{
+    const T *pData = (const T *) psPiece->pabyData;
+
+    for( int iY = 0; iY < psPiece->nYSize; iY++ )
+    {
+        const T *pRow = pData + (size_t) iY * psPiece->nLineStride;
+
+        if( pabyMask == NULL )
+        {
+            for( int iX = 0; iX < psPiece->nXSize; iX++ )
+            {
+                const int nIndex = panLUT[pRow[iX]];
+                if( nIndex >= 0 )
+                    panHistogram[nIndex]++;
+            }
+        }
+        else
+        {
+            const GByte *pabyMaskRow = pabyMask + (size_t) iY * psPiece->nXSize;
+
+            for( int iX = 0; iX < psPiece->nXSize; iX++ )
+            {
+                const int nIndex = panLUT[pRow[iX]];
+                if( nIndex >= 0 && pabyMaskRow[iX] != 0 )
+                    panHistogram[nIndex]++;
+            }
+        }
+    }
+}
+
+/************************************************************************/
+/*                        GDALStatsComplexPiece()                       */
+/*                                                                      */
+/*      Complex data is converted, one row at a time, to the real       */
+/*      part (statistics) or the magnitude (histogram), with NaN for    */
+/*      values to ignore, and processed as Float64.                     */
+/************************************************************************/
+
+template<class T>
+static void GDALStatsComplexPiece( const GDALStatsRequest *psReq,
+                                   const GDALStatsPiece *psPiece,
+                                   const GByte *pabyMask,
+                                   GDALStatsChunk *psChunk )
+{
+    const T *pData = (const T *) psPiece->pabyData;
+    const int nXSize = psPiece->nXSize;
+
+    if( (int) psChunk->adfScratch.size() < nXSize )
+        psChunk->adfScratch.resize( nXSize );
+    double *padfRow = &(psChunk->adfScratch[0]);
+
+    GDALStatsPiece sRowPiece;
+    sRowPiece.pabyData = (const GByte *) padfRow;
+    sRowPiece.nLineStride = nXSize;
+    sRowPiece.nXSize = nXSize;
+    sRowPiece.nYSize = 1;
+    sRowPiece.pabyExtMask = NULL;
+    sRowPiece.nMaskOffset = -1;
+
+    for( int iY = 0; iY < psPiece->nYSize; iY++ )
+    {
+        const T *pRow = pData + (size_t) iY * psPiece->nLineStride * 2;
+        const GByte *pabyMaskRow = pabyMask != NULL ?
+            pabyMask + (size_t) iY * nXSize : NULL;
+
+        for( int iX = 0; iX < nXSize; iX++ )
+        {
+            const double dfReal = pRow[iX*2];
+            const double dfImag = pRow[iX*2+1];
+
+            if( psReq->nMode != GDAL_STATS_HISTOGRAM )
+                padfRow[iX] = dfReal;
+            else if( CPLIsNan(dfReal) || CPLIsNan(dfImag) )
+                padfRow[iX] = dfReal + dfImag; /* NaN */
+            else
+                padfRow[iX] = sqrt( dfReal * dfReal + dfImag * dfImag );
+        }
+
+        if( psReq->nMode == GDAL_STATS_HISTOGRAM )
+            GDALStatsHistogramPiece<double>( psReq, &sRowPiece, pabyMaskRow,
+                                             psChunk->panHistogram );
+        else
+            GDALStatsGenericPiece<double>( psReq, &sRowPiece, pabyMaskRow,
+                                           &psChunk->sAcc );
+    }
+}
+
+/************************************************************************/
+/*                         GDALStatsProcessPiece()                      */
+/************************************************************************/
+
+template<class T>
+static void GDALStatsProcessRealPiece( const GDALStatsRequest *psReq,
+                                       const GDALStatsPiece *psPiece,
+                                       const GByte *pabyMask,
+                                       GDALStatsChunk *psChunk )
+{
+    if( psReq->nMode == GDAL_STATS_HISTOGRAM )
+        GDALStatsHistogramPiece<T>( psReq, psPiece, pabyMask,
+                                    psChunk->panHistogram );
+    else
+        GDALStatsGenericPiece<T>( psReq, psPiece, pabyMask, &psChunk->sAcc );
+}
+
+template<class T>
+static void GDALStatsProcessSmallIntPiece( const GDALStatsRequest *psReq,
+                                           const GDALStatsPiece *psPiece,
+                                           const GByte *pabyMask,
+                                           GDALStatsChunk *psChunk )
+{
+    if( psReq->nMode == GDAL_STATS_HISTOGRAM )
+        GDALStatsHistogramLUTPiece<T>( psReq->panLUT, psPiece, pabyMask,
+                                       psChunk->panHistogram );
+    else if( pabyMask == NULL && !psReq->bGotNoData )
+        GDALStatsIntegerPiece<T>( psPiece, &psChunk->sAcc );
+    else
+        GDALStatsGenericPiece<T>( psReq, psPiece, pabyMask, &psChunk->sAcc );
+}
+
+static void GDALStatsProcessPiece( const GDALStatsRequest *psReq,
+                                   const GDALStatsPiece *psPiece,
+                                   const GByte *pabyMask,
+                                   GDALStatsChunk *psChunk )
+{
+    switch( psReq->eDataType )
+    {
+      case GDT_Byte:
+        if( psReq->bSignedByte )
+            GDALStatsProcessSmallIntPiece<signed char>( psReq, psPiece,
+                                                        pabyMask, psChunk );
+        else
+            GDALStatsProcessSmallIntPiece<GByte>( psReq, psPiece,
+                                                  pabyMask, psChunk );
+        break;
+
+      case GDT_UInt16:
+        GDALStatsProcessSmallIntPiece<GUInt16>( psReq, psPiece,
+                                                pabyMask, psChunk );
+        break;
+
+      case GDT_Int16:
+        GDALStatsProcessSmallIntPiece<GInt16>( psReq, psPiece,
+                                               pabyMask, psChunk );
+        break;
+
+      case GDT_UInt32:
+        GDALStatsProcessRealPiece<GUInt32>( psReq, psPiece,
+                                            pabyMask, psChunk );
+        break;
+
+      case GDT_Int32:
+        GDALStatsProcessRealPiece<GInt32>( psReq, psPiece,
+                                           pabyMask, psChunk );
+        break;
+
+      case GDT_Float32:
+#ifdef HAVE_SSE2_STATS
+        if( psReq->nMode != GDAL_STATS_HISTOGRAM
+            && pabyMask == NULL && !psReq->bGotNoData )
+        {
+            const float *pafData = (const float *) psPiece->pabyData;
+            const int bMoments = psReq->nMode == GDAL_STATS_MOMENTS;
+
+            if( psPiece->nLineStride == psPiece->nXSize )
+                GDALStatsFloat32RunSSE2( pafData,
+                                         psPiece->nXSize * psPiece->nYSize,
+                                         bMoments, &psChunk->sAcc );
+            else
+            {
+                for( int iY = 0; iY < psPiece->nYSize; iY++ )
+                    GDALStatsFloat32RunSSE2(
+                        pafData + (size_t) iY * psPiece->nLineStride,
+                        psPiece->nXSize, bMoments, &psChunk->sAcc );
+            }
+            break;
+        }
+#endif
+        GDALStatsProcessRealPiece<float>( psReq, psPiece, pabyMask, psChunk );
+        break;
+
+      case GDT_Float64:
+        GDALStatsProcessRealPiece<double>( psReq, psPiece, pabyMask, psChunk );
+        break;
+
+      case GDT_CInt16:
+        GDALStatsComplexPiece<GInt16>( psReq, psPiece, pabyMask, psChunk );
+        break;
+
+      case GDT_CInt32:
+        GDALStatsComplexPiece<GInt32>( psReq, psPiece, pabyMask, psChunk );
+        break;
+
+      case GDT_CFloat32:
+        GDALStatsComplexPiece<float>( psReq, psPiece, pabyMask, psChunk );
+        break;
+
+      case GDT_CFloat64:
+        GDALStatsComplexPiece<double>( psReq, psPiece, pabyMask, psChunk );
+        break;
+
+      default:
+        CPLAssert( FALSE );
+        break;
+    }
+}
+
+/************************************************************************/
+/*                           GDALStatsChunkRun()                        */
+/************************************************************************/
+
+static void GDALStatsChunkRun( void *pData )
+{
+    GDALStatsChunk *psChunk = (GDALStatsChunk *) pData;
+
+    for( size_t iPiece = 0; iPiece < psChunk->asPieces.size(); iPiece++ )
+    {
+        const GDALStatsPiece *psPiece = &(psChunk->asPieces[iPiece]);
+        const GByte *pabyMask = psPiece->pabyExtMask;
+
+        if( psPiece->nMaskOffset >= 0 )
+            pabyMask = &(psChunk->abyMask[psPiece->nMaskOffset]);
+
+        GDALStatsProcessPiece( psChunk->psReq, psPiece, pabyMask, psChunk );
+    }
+}
+
+/************************************************************************/
+/* ==================================================================== */
+/*                           GDALStatsComputer                          */
+/* ==================================================================== */
+/************************************************************************/
+
+class GDALStatsComputer
+{
+    GDALRasterBand     *poBand;
+    GDALRasterBand     *poMaskBand;
+    GDALStatsRequest    sReq;
+    int                *panLUT;
+    int                *panHistogram;
+
+    int                 nMaxChunks;
+    CPLJobGroup        *psJobGroup;
+    std::vector<GDALStatsChunk *> apsChunks;
+    int                 nChunks;        /* chunks submitted in this wave */
+    std::vector<GDALRasterBlock *> apoLockedBlocks;
+
+    GDALStatsAccumulator sAcc;
+
+    GDALStatsChunk     *GetCurrentChunk();
+    void                CloseChunk( GDALRasterBlock *poKeepLocked );
+    void                FlushWave( GDALRasterBlock *poKeepLocked );
+    CPLErr              AddRegion( GDALRasterBlock *poBlock,
+                                   const GByte *pabyData,
+                                   int nXOff, int nYOff,
+                                   int nXSize, int nYSize, int nLineStride,
+                                   const GByte *pabyMask );
+    void                Finish();
+
+  public:
+                        GDALStatsComputer( GDALRasterBand *poBand, int nMode,
+                                           double dfHistMin = 0.0,
+                                           double dfHistMax = 0.0,
+                                           int nBuckets = 0,
+                                           int *panHistogram = NULL,
+                                           int bIncludeOutOfRange = FALSE );
+                       ~GDALStatsComputer();
+
+    CPLErr              ProcessBlocks( int nSampleRate, int bSkipFailedBlocks,
+                                       const char *pszMessage,
+                                       GDALProgressFunc pfnProgress,
+                                       void *pProgressData );
+    CPLErr              ProcessReducedImage();
+
+    const GDALStatsAccumulator *GetResult() const { return &sAcc; }
+};
+
+/************************************************************************/
+/*                          GDALStatsComputer()                         */
+/************************************************************************/
+
+GDALStatsComputer::GDALStatsComputer( GDALRasterBand *poBandIn, int nMode,
+                                      double dfHistMin, double dfHistMax,
+                                      int nBuckets, int *panHistogramIn,
+                                      int bIncludeOutOfRange ) :
+    poBand(poBandIn), poMaskBand(NULL), panLUT(NULL),
+    panHistogram(panHistogramIn), nMaxChunks(1), psJobGroup(NULL), nChunks(0)
+
+{
+    memset( &sAcc, 0, sizeof(sAcc) );
+    memset( &sReq, 0, sizeof(sReq) );
+
+    sReq.nMode = nMode;
+    sReq.eDataType = poBand->GetRasterDataType();
+
+    const char* pszPixelType =
+        poBand->GetMetadataItem("PIXELTYPE", "IMAGE_STRUCTURE");
+    sReq.bSignedByte =
+        (pszPixelType != NULL && EQUAL(pszPixelType, "SIGNEDBYTE"));
+
+/* -------------------------------------------------------------------- */
+/*      Nodata value.  For integer types, round it to the integer it    */
+/*      matches, if any, so that the kernels can compare exactly.       */
+/* -------------------------------------------------------------------- */
+    sReq.dfNoData = poBand->GetNoDataValue( &sReq.bGotNoData );
+    sReq.bGotNoData = sReq.bGotNoData && !CPLIsNan(sReq.dfNoData);
+    if( nMode == GDAL_STATS_HISTOGRAM )
+    {
+        /* Not advertized. May be removed at any time. Just as a provision if the */
+        /* old behaviour made sense somethimes... */
+        sReq.bGotNoData = sReq.bGotNoData &&
+            !CSLTestBoolean(CPLGetConfigOption("GDAL_NODATA_IN_HISTOGRAM", "NO"));
+    }
+
+    if( sReq.bGotNoData && !GDALDataTypeIsComplex(sReq.eDataType)
+        && sReq.eDataType != GDT_Float32 && sReq.eDataType != GDT_Float64 )
+    {
+        const double dfRounded = floor(sReq.dfNoData + 0.5);
+        if( ARE_REAL_EQUAL(dfRounded, sReq.dfNoData) )
+            sReq.dfNoData = dfRounded;
+        else
+            sReq.bGotNoData = FALSE;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Mask band, unless it is derived from the nodata value.          */
+/* -------------------------------------------------------------------- */
+    if( CSLTestBoolean(CPLGetConfigOption("GDAL_STATS_USE_MASK", "NO")) )
+    {
+        const int nMaskFlags = poBand->GetMaskFlags();
+        if( (nMaskFlags & (GMF_ALL_VALID | GMF_NODATA)) == 0 )
+            poMaskBand = poBand->GetMaskBand();
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Histogram: precompute the bucket of each value of 8 and 16      */
+/*      bit data types.                                                 */
+/* -------------------------------------------------------------------- */
+    if( nMode == GDAL_STATS_HISTOGRAM )
+    {
+        sReq.dfHistMin = dfHistMin;
+        sReq.dfScale = nBuckets / (dfHistMax - dfHistMin);
+        sReq.nBuckets = nBuckets;
+        sReq.bIncludeOutOfRange = bIncludeOutOfRange;
+
+        int nLUTMin = 0, nLUTMax = -1;
+        if( sReq.eDataType == GDT_Byte && sReq.bSignedByte )
+            nLUTMin = -128, nLUTMax = 127;
+        else if( sReq.eDataType == GDT_Byte )
+            nLUTMin = 0, nLUTMax = 255;
+        else if( sReq.eDataType == GDT_UInt16 )
+            nLUTMin = 0, nLUTMax = 65535;
+        else if( sReq.eDataType == GDT_Int16 )
+            nLUTMin = -32768, nLUTMax = 32767;
+
+        if( nLUTMax >= nLUTMin )
+        {
+            panLUT = (int *) CPLMalloc( sizeof(int) * (nLUTMax - nLUTMin + 1) );
+            for( int nValue = nLUTMin; nValue <= nLUTMax; nValue++ )
+            {
+                int nIndex = (int) floor((nValue - dfHistMin) * sReq.dfScale);
+
+                if( sReq.bGotNoData && nValue == sReq.dfNoData )
+                    nIndex = -1;
+                else if( nIndex < 0 )
+                    nIndex = bIncludeOutOfRange ? 0 : -1;
+                else if( nIndex >= nBuckets )
+                    nIndex = bIncludeOutOfRange ? nBuckets - 1 : -1;
+
+                panLUT[nValue - nLUTMin] = nIndex;
+            }
+            sReq.panLUT = panLUT - nLUTMin;
+        }
+
+        memset( panHistogram, 0, sizeof(int) * nBuckets );
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Number of chunks in flight.  Bound the memory of the locked     */
+/*      blocks to a quarter of the block cache.                         */
+/* -------------------------------------------------------------------- */
+    const int nThreads = CPLGetNumThreadsFromOption(
+        CPLGetConfigOption("GDAL_NUM_THREADS", "1"), 1 );
+
+    if( nThreads > 1 )
+    {
+        const GIntBig nChunkBytes = (GIntBig) GDAL_STATS_CHUNK_PIXELS
+            * (GDALGetDataTypeSize(sReq.eDataType) / 8);
+        const GIntBig nMaxChunksForCache =
+            GDALGetCacheMax64() / 4 / MAX(1, nChunkBytes);
+
+        nMaxChunks = (int) MIN( (GIntBig) nThreads * 2, nMaxChunksForCache );
+        if( nMaxChunks > 1 )
+            psJobGroup = CPLCreateJobGroup();
+        else
+            nMaxChunks = 1;
+    }
+}
+
+/************************************************************************/
+/*                         ~GDALStatsComputer()                         */
+/************************************************************************/
+
+GDALStatsComputer::~GDALStatsComputer()
+
+{
+    /* Only needed on error paths: wait for the jobs and release the */
+    /* block locks. */
+    FlushWave( NULL );
+
+    if( psJobGroup != NULL )
+        CPLDestroyJobGroup( psJobGroup );
+
+    for( size_t i = 0; i < apsChunks.size(); i++ )
+    {
+        CPLFree( apsChunks[i]->panHistogram );
+        delete apsChunks[i];
+    }
+
+    CPLFree( panLUT );
+}
+
+/************************************************************************/
+/*                           GetCurrentChunk()                          */
+/************************************************************************/
+
+GDALStatsChunk *GDALStatsComputer::GetCurrentChunk()
+
+{
+    if( nChunks == (int) apsChunks.size() )
+    {
+        GDALStatsChunk *psChunk = new GDALStatsChunk;
+
+        psChunk->psReq = &sReq;
+        psChunk->nPixels = 0;
+        memset( &psChunk->sAcc, 0, sizeof(psChunk->sAcc) );
+        psChunk->panHistogram = NULL;
+        if( sReq.nMode == GDAL_STATS_HISTOGRAM )
+            psChunk->panHistogram =
+                (int *) CPLCalloc( sizeof(int), sReq.nBuckets );
+
+        apsChunks.push_back( psChunk );
+    }
+
+    return apsChunks[nChunks];
+}
+
+/************************************************************************/
+/*                             CloseChunk()                             */
+/*                                                                      */
+/*      Submit (or run) the current chunk.  If the wave is full, wait   */
+/*      for its completion.  poKeepLocked is a block still needed by    */
+/*      the next chunks.                                                */
+/************************************************************************/
+
+void GDALStatsComputer::CloseChunk( GDALRasterBlock *poKeepLocked )
+
+{
+    GDALStatsChunk *psChunk = GetCurrentChunk();
+
+    if( psChunk->asPieces.empty() )
+        return;
+
+    if( psJobGroup != NULL )
+        CPLSubmitJob( psJobGroup, GDALStatsChunkRun, psChunk );
+    else
+        GDALStatsChunkRun( psChunk );
+
+    nChunks++;
+    if( nChunks == nMaxChunks )
+        FlushWave( poKeepLocked );
+}
+
+/************************************************************************/
+/*                              FlushWave()                             */
+/*                                                                      */
+/*      Wait for the submitted chunks, merge their results in chunk     */
+/*      order and release the locks on their blocks.                    */
+/************************************************************************/
+
+void GDALStatsComputer::FlushWave( GDALRasterBlock *poKeepLocked )
+
+{
+    if( psJobGroup != NULL )
+        CPLWaitJobGroup( psJobGroup );
+
+    for( int iChunk = 0; iChunk < (int) apsChunks.size(); iChunk++ )
+    {
+        GDALStatsChunk *psChunk = apsChunks[iChunk];
+
+        if( iChunk < nChunks )
+        {
+            GDALStatsMergeAccumulator( &sAcc, &psChunk->sAcc );
+            if( psChunk->panHistogram != NULL )
+            {
+                for( int i = 0; i < sReq.nBuckets; i++ )
+                    panHistogram[i] += psChunk->panHistogram[i];
+            }
+        }
+
+        psChunk->asPieces.resize( 0 );
+        psChunk->abyMask.resize( 0 );
+        psChunk->nPixels = 0;
+        memset( &psChunk->sAcc, 0, sizeof(psChunk->sAcc) );
+        if( psChunk->panHistogram != NULL )
+            memset( psChunk->panHistogram, 0, sizeof(int) * sReq.nBuckets );
+    }
+    nChunks = 0;
+
+    if( poKeepLocked != NULL )
+        poKeepLocked->AddLock();
+    for( size_t i = 0; i < apoLockedBlocks.size(); i++ )
+        apoLockedBlocks[i]->DropLock();
+    apoLockedBlocks.resize( 0 );
+    if( poKeepLocked != NULL )
+        apoLockedBlocks.push_back( poKeepLocked );
+}
+
+/************************************************************************/
+/*                              AddRegion()                             */
+/*                                                                      */
+/*      Cut a region of nXSize * nYSize pixels at (nXOff,nYOff) in      */
+/*      pieces of at most GDAL_STATS_CHUNK_PIXELS pixels and add them   */
+/*      to the chunks.  If poBlock is not NULL, the region is its data  */
+/*      and the lock of the caller on it is taken over.  If there is    */
+/*      a mask band, the mask of each piece is read unless pabyMask     */
+/*      (nXSize values per line) is provided.                           */
+/************************************************************************/
+
+CPLErr GDALStatsComputer::AddRegion( GDALRasterBlock *poBlock,
+                                     const GByte *pabyData,
+                                     int nXOff, int nYOff,
+                                     int nXSize, int nYSize, int nLineStride,
+                                     const GByte *pabyMask )
+
+{
+    const int nPixelSize = GDALGetDataTypeSize(sReq.eDataType) / 8;
+    const int nRowsPerPiece = MAX(1, GDAL_STATS_CHUNK_PIXELS / nXSize);
+
+    if( poBlock != NULL )
+        apoLockedBlocks.push_back( poBlock );
+
+    for( int iRow = 0; iRow < nYSize; iRow += nRowsPerPiece )
+    {
+        GDALStatsChunk *psChunk = GetCurrentChunk();
+        GDALStatsPiece sPiece;
+
+        sPiece.pabyData = pabyData + (size_t) iRow * nLineStride * nPixelSize;
+        sPiece.nLineStride = nLineStride;
+        sPiece.nXSize = nXSize;
+        sPiece.nYSize = MIN(nRowsPerPiece, nYSize - iRow);
+        sPiece.pabyExtMask = NULL;
+        sPiece.nMaskOffset = -1;
+
+        if( pabyMask != NULL )
+        {
+            sPiece.pabyExtMask = pabyMask + (size_t) iRow * nXSize;
+        }
+        else if( poMaskBand != NULL )
+        {
+            sPiece.nMaskOffset = (int) psChunk->abyMask.size();
+            psChunk->abyMask.resize( sPiece.nMaskOffset
+                                     + (size_t) nXSize * sPiece.nYSize );
+
+            if( poMaskBand->RasterIO( GF_Read, nXOff, nYOff + iRow,
+                                      nXSize, sPiece.nYSize,
+                                      &(psChunk->abyMask[sPiece.nMaskOffset]),
+                                      nXSize, sPiece.nYSize, GDT_Byte,
+                                      0, 0 ) != CE_None )
+                return CE_Failure;
+        }
+
+        psChunk->asPieces.push_back( sPiece );
+        psChunk->nPixels += nXSize * sPiece.nYSize;
+
+        if( psChunk->nPixels >= GDAL_STATS_CHUNK_PIXELS )
+            CloseChunk( iRow + nRowsPerPiece < nYSize ? poBlock : NULL );
+    }
+
+    return CE_None;
+}
+
+/************************************************************************/
+/*                                Finish()                              */
+/************************************************************************/
+
+void GDALStatsComputer::Finish()
+
+{
+    CloseChunk( NULL );
+    FlushWave( NULL );
+}
+
+/************************************************************************/
+/*                            ProcessBlocks()                           */
+/*                                                                      */
+/*      Process one block every nSampleRate blocks.  Blocks that        */
+/*      cannot be read are ignored if bSkipFailedBlocks is TRUE.        */
+/************************************************************************/
+
+CPLErr GDALStatsComputer::ProcessBlocks( int nSampleRate,
+                                         int bSkipFailedBlocks,
+                                         const char *pszMessage,
+                                         GDALProgressFunc pfnProgress,
+                                         void *pProgressData )
+
+{
+    const int nXSize = poBand->GetXSize();
+    const int nYSize = poBand->GetYSize();
+    int nBlockXSize, nBlockYSize;
+
+    poBand->GetBlockSize( &nBlockXSize, &nBlockYSize );
+
+    const int nBlocksPerRow = (nXSize + nBlockXSize - 1) / nBlockXSize;
+    const int nBlocksPerColumn = (nYSize + nBlockYSize - 1) / nBlockYSize;
+    for( int iSampleBlock = 0;
+         iSampleBlock < nBlocksPerRow * nBlocksPerColumn;
+         iSampleBlock += nSampleRate )
+    {
+        if( !pfnProgress( iSampleBlock
+                          / ((double)nBlocksPerRow * nBlocksPerColumn),
+                          pszMessage, pProgressData ) )
+        {
+            poBand->ReportError( CE_Failure, CPLE_UserInterrupt,
+                                 "User terminated" );
+            return CE_Failure;
+        }
+
+        const int iYBlock = iSampleBlock / nBlocksPerRow;
+        const int iXBlock = iSampleBlock - nBlocksPerRow * iYBlock;
+
+        GDALRasterBlock *poBlock = poBand->GetLockedBlockRef( iXBlock, iYBlock );
+        if( poBlock == NULL )
+        {
+            if( bSkipFailedBlocks )
+                continue;
+            return CE_Failure;
+        }
+        if( poBlock->GetDataRef() == NULL )
+        {
+            poBlock->DropLock();
+            if( bSkipFailedBlocks )
+                continue;
+            return CE_Failure;
+        }
+
+        const int nXCheck =
+            MIN(nBlockXSize, nXSize - iXBlock * nBlockXSize);
+        const int nYCheck =
+            MIN(nBlockYSize, nYSize - iYBlock * nBlockYSize);
+
+        if( AddRegion( poBlock, (const GByte *) poBlock->GetDataRef(),
+                       iXBlock * nBlockXSize, iYBlock * nBlockYSize,
+                       nXCheck, nYCheck, nBlockXSize, NULL ) != CE_None )
+            return CE_Failure;
+    }
+
+    Finish();
+
+    return CE_None;
+}
+
+/************************************************************************/
+/*                         ProcessReducedImage()                        */
+/*                                                                      */
+/*      Used for bands with arbitrary overviews: read the whole band    */
+/*      at a reduced resolution of about GDALSTAT_APPROX_NUMSAMPLES     */
+/*      pixels and process it.                                          */
+/************************************************************************/
+
+CPLErr GDALStatsComputer::ProcessReducedImage()
+
+{
+/* -------------------------------------------------------------------- */
+/*      Figure out how much the image should be reduced to get an       */
+/*      approximate value.                                              */
+/* -------------------------------------------------------------------- */
+    const int nXSize = poBand->GetXSize();
+    const int nYSize = poBand->GetYSize();
+    int     nXReduced, nYReduced;
+    double  dfReduction = sqrt(
+        (double)nXSize * nYSize / GDALSTAT_APPROX_NUMSAMPLES );
+
+    if ( dfReduction > 1.0 )
+    {
+        nXReduced = (int)( nXSize / dfReduction );
+        nYReduced = (int)( nYSize / dfReduction );
+
+        // Catch the case of huge resizing ratios here
+        if ( nXReduced == 0 )
+            nXReduced = 1;
+        if ( nYReduced == 0 )
+            nYReduced = 1;
+    }
+    else
+    {
+        nXReduced = nXSize;
+        nYReduced = nYSize;
+    }
+
+    void *pData =
+        CPLMalloc(GDALGetDataTypeSize(sReq.eDataType)/8 * nXReduced * nYReduced);
+
+    CPLErr eErr = poBand->RasterIO( GF_Read, 0, 0, nXSize, nYSize, pData,
+                                    nXReduced, nYReduced, sReq.eDataType, 0, 0 );
+
+    GByte *pabyMask = NULL;
+    if( eErr == CE_None && poMaskBand != NULL )
+    {
+        pabyMask = (GByte *) CPLMalloc( nXReduced * nYReduced );
+        eErr = poMaskBand->RasterIO( GF_Read, 0, 0, nXSize, nYSize, pabyMask,
+                                     nXReduced, nYReduced, GDT_Byte, 0, 0 );
+    }
+
+    if( eErr == CE_None )
+    {
+        poMaskBand = NULL;
+        eErr = AddRegion( NULL, (const GByte *) pData, 0, 0,
+                          nXReduced, nYReduced, nXReduced, pabyMask );
+        Finish();
+    }
+
+    CPLFree( pabyMask );
+    CPLFree( pData );
+
+    return eErr;
+}
+
+/************************************************************************/
+/*                            GetHistogram()                            */
+/************************************************************************/
+
+/**
+ * \brief Compute raster histogram.
+ *
+ * Note that the bucket size is (dfMax-dfMin) / nBuckets.
+ *
+ * For example to compute a simple 256 entry histogram of eight bit data,
+ * the following would be suitable.  The unusual bounds are to ensure that
+ * bucket boundaries don't fall right on integer values causing possible errors
+ * due to rounding after scaling.
+<pre>
+    int anHistogram[256];
+
+    poBand->GetHistogram( -0.5, 255.5, 256, anHistogram, FALSE, FALSE,
+                          GDALDummyProgress, NULL );
+</pre>
+ *
+ * Note that setting bApproxOK will generally result in a subsampling of the
+ * file, and will utilize overviews if available.  It should generally
+ * produce a representative histogram for the data that is suitable for use
+ * in generating histogram based luts for instance.  Generally bApproxOK is
+ * much faster than an exactly computed histogram.
+ *
+ * Nodata pixels are ignored, as well as the pixels masked by a mask band
+ * that is not derived from the nodata value if the GDAL_STATS_USE_MASK
+ * configuration option is set to YES.  The blocks are processed by
+ * several threads if the GDAL_NUM_THREADS configuration option is set.
+ *
+ * This method is the same as the C function GDALGetRasterHistogram().
+ *
+ * @param dfMin the lower bound of the histogram.
+ * @param dfMax the upper bound of the histogram.
+ * @param nBuckets the number of buckets in panHistogram.
+ * @param panHistogram array into which the histogram totals are placed.
+ * @param bIncludeOutOfRange if TRUE values below the histogram range will
+ * mapped into panHistogram[0], and values above will be mapped into
+ * panHistogram[nBuckets-1] otherwise out of range values are discarded.
+ * @param bApproxOK TRUE if an approximate, or incomplete histogram OK.
+ * @param pfnProgress function to report progress to completion.
+ * @param pProgressData application data to pass to pfnProgress.
+ *
+ * @return CE_None on success, or CE_Failure if something goes wrong.
+ */
+
+CPLErr GDALRasterBand::GetHistogram( double dfMin, double dfMax,
+                                     int nBuckets, int *panHistogram,
+                                     int bIncludeOutOfRange, int bApproxOK,
+                                     GDALProgressFunc pfnProgress,
+                                     void *pProgressData )
+
+{
+    CPLAssert( NULL != panHistogram );
+
+    if( pfnProgress == NULL )
+        pfnProgress = GDALDummyProgress;
+
+/* -------------------------------------------------------------------- */
+/*      If we have overviews, use them for the histogram.               */
+/* -------------------------------------------------------------------- */
+    if( bApproxOK && GetOverviewCount() > 0 && !HasArbitraryOverviews() )
+    {
+        // FIXME: should we use the most reduced overview here or use some
+        // minimum number of samples like GDALRasterBand::ComputeStatistics()
+        // does?
+        GDALRasterBand *poBestOverview = GetRasterSampleOverview( 0 );
+
+        if( poBestOverview != this )
+        {
+            return poBestOverview->GetHistogram( dfMin, dfMax, nBuckets,
+                                                 panHistogram,
+                                                 bIncludeOutOfRange, bApproxOK,
+                                                 pfnProgress, pProgressData );
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Read actual data and build histogram.                           */
+/* -------------------------------------------------------------------- */
+    if( !pfnProgress( 0.0, "Compute Histogram", pProgressData ) )
+    {
+        ReportError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+        return CE_Failure;
+    }
+
+    GDALStatsComputer oComputer( this, GDAL_STATS_HISTOGRAM,
+                                 dfMin, dfMax, nBuckets, panHistogram,
+                                 bIncludeOutOfRange );
+    CPLErr eErr;
+
+    if ( bApproxOK && HasArbitraryOverviews() )
+    {
+        eErr = oComputer.ProcessReducedImage();
+    }
+    else    // No arbitrary overviews
+    {
+        int         nSampleRate;
+
+        if( !InitBlockInfo() )
+            return CE_Failure;
+
+/* -------------------------------------------------------------------- */
+/*      Figure out the ratio of blocks we will read to get an           */
+/*      approximate value.                                              */
+/* -------------------------------------------------------------------- */
+        if ( bApproxOK )
+        {
+            nSampleRate =
+                (int) MAX(1,sqrt((double) nBlocksPerRow * nBlocksPerColumn));
+        }
+        else
+            nSampleRate = 1;
+
+        eErr = oComputer.ProcessBlocks( nSampleRate, FALSE,
+                                        "Compute Histogram",
+                                        pfnProgress, pProgressData );
+    }
+
+    if( eErr != CE_None )
+        return eErr;
+
+    pfnProgress( 1.0, "Compute Histogram", pProgressData );
+
+    return CE_None;
+}
+
+/************************************************************************/
+/*                         ComputeStatistics()                          */
+/************************************************************************/
+
+/**
+ * \brief Compute image statistics.
+ *
+ * Returns the minimum, maximum, mean and standard deviation of all
+ * pixel values in this band.  If approximate statistics are sufficient,
+ * the bApproxOK flag can be set to true in which case overviews, or a
+ * subset of image tiles may be used in computing the statistics.
+ *
+ * Nodata pixels are ignored, as well as the pixels masked by a mask band
+ * that is not derived from the nodata value if the GDAL_STATS_USE_MASK
+ * configuration option is set to YES.  The blocks are processed by
+ * several threads if the GDAL_NUM_THREADS configuration option is set.
+ *
+ * Once computed, the statistics will generally be "set" back on the
+ * raster band using SetStatistics().
+ *
+ * This method is the same as the C function GDALComputeRasterStatistics().
+ *
+ * @param bApproxOK If TRUE statistics may be computed based on overviews
+ * or a subset of all tiles.
+ *
+ * @param pdfMin Location into which to load image minimum (may be NULL).
+ *
+ * @param pdfMax Location into which to load image maximum (may be NULL).-
+ *
+ * @param pdfMean Location into which to load image mean (may be NULL).
+ *
+ * @param pdfStdDev Location into which to load image standard deviation
+ * (may be NULL).
+ *
+ * @param pfnProgress a function to call to report progress, or NULL.
+ *
+ * @param pProgressData application data to pass to the progress function.
+ *
+ * @return CE_None on success, or CE_Failure if an error occurs or processing
+ * is terminated by the user.
+ */
+
+CPLErr
+GDALRasterBand::ComputeStatistics( int bApproxOK,
+                                   double *pdfMin, double *pdfMax,
+                                   double *pdfMean, double *pdfStdDev,
+                                   GDALProgressFunc pfnProgress,
+                                   void *pProgressData )
+
+{
+    if( pfnProgress == NULL )
+        pfnProgress = GDALDummyProgress;
+
+/* -------------------------------------------------------------------- */
+/*      If we have overview bands, use them for statistics.             */
+/* -------------------------------------------------------------------- */
+    if( bApproxOK && GetOverviewCount() > 0 && !HasArbitraryOverviews() )
+    {
+        GDALRasterBand *poBand;
+
+        poBand = GetRasterSampleOverview( GDALSTAT_APPROX_NUMSAMPLES );
+
+        if( poBand != this )
+            return poBand->ComputeStatistics( FALSE,
+                                              pdfMin, pdfMax,
+                                              pdfMean, pdfStdDev,
+                                              pfnProgress, pProgressData );
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Read actual data and compute statistics.                        */
+/* -------------------------------------------------------------------- */
+    if( !pfnProgress( 0.0, "Compute Statistics", pProgressData ) )
+    {
+        ReportError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+        return CE_Failure;
+    }
+
+    GDALStatsComputer oComputer( this, GDAL_STATS_MOMENTS );
+    CPLErr eErr;
+
+    if ( bApproxOK && HasArbitraryOverviews() )
+    {
+        eErr = oComputer.ProcessReducedImage();
+    }
+    else    // No arbitrary overviews
+    {
+        int     nSampleRate;
+
+        if( !InitBlockInfo() )
+            return CE_Failure;
+
+/* -------------------------------------------------------------------- */
+/*      Figure out the ratio of blocks we will read to get an           */
+/*      approximate value.                                              */
+/* -------------------------------------------------------------------- */
+        if ( bApproxOK )
+        {
+            nSampleRate =
+                (int)MAX( 1, sqrt((double)nBlocksPerRow * nBlocksPerColumn) );
+        }
+        else
+            nSampleRate = 1;
+
+        eErr = oComputer.ProcessBlocks( nSampleRate, TRUE,
+                                        "Compute Statistics",
+                                        pfnProgress, pProgressData );
+    }
+
+    if( eErr != CE_None )
+        return eErr;
+
+    if( !pfnProgress( 1.0, "Compute Statistics", pProgressData ) )
+    {
+        ReportError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+        return CE_Failure;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Save computed information.                                      */
+/* -------------------------------------------------------------------- */
+    const GDALStatsAccumulator *psResult = oComputer.GetResult();
+    const GIntBig nSampleCount = psResult->nCount;
+    double dfMin = 0.0, dfMax = 0.0, dfMean = 0.0, dfStdDev = 0.0;
+
+    if( nSampleCount > 0 )
+    {
+        dfMin = psResult->dfMin;
+        dfMax = psResult->dfMax;
+        dfMean = psResult->dfMean;
+        dfStdDev = sqrt(psResult->dfM2 / nSampleCount);
+
+        SetStatistics( dfMin, dfMax, dfMean, dfStdDev );
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Record results.                                                 */
+/* -------------------------------------------------------------------- */
+    if( pdfMin != NULL )
+        *pdfMin = dfMin;
+    if( pdfMax != NULL )
+        *pdfMax = dfMax;
+
+    if( pdfMean != NULL )
+        *pdfMean = dfMean;
+
+    if( pdfStdDev != NULL )
+        *pdfStdDev = dfStdDev;
+
+    if( nSampleCount > 0 )
+        return CE_None;
+    else
+    {
+        ReportError( CE_Failure, CPLE_AppDefined,
+        "Failed to compute statistics, no valid pixels found in sampling." );
+        return CE_Failure;
+    }
+}
+
+/************************************************************************/
+/*                        ComputeRasterMinMax()                         */
+/************************************************************************/
+
+/**
+ * \brief Compute the min/max values for a band.
+ *
+ * If approximate is OK, then the band's GetMinimum()/GetMaximum() will
+ * be trusted.  If it doesn't work, a subsample of blocks will be read to
+ * get an approximate min/max.  If the band has a nodata value it will
+ * be excluded from the minimum and maximum.  Pixels masked by a mask band
+ * that is not derived from the nodata value are also excluded if the
+ * GDAL_STATS_USE_MASK configuration option is set to YES.
+ *
+ * If bApprox is FALSE, then all pixels will be read and used to compute
+ * an exact range.
+ *
+ * This method is the same as the C function GDALComputeRasterMinMax().
+ *
+ * @param bApproxOK TRUE if an approximate (faster) answer is OK, otherwise
+ * FALSE.
+ * @param adfMinMax the array in which the minimum (adfMinMax[0]) and the
+ * maximum (adfMinMax[1]) are returned.
+ *
+ * @return CE_None on success or CE_Failure on failure.
+ */
+
+
+CPLErr GDALRasterBand::ComputeRasterMinMax( int bApproxOK,
+                                            double adfMinMax[2] )
+{
+    double  dfMin = 0.0;
+    double  dfMax = 0.0;
+
+/* -------------------------------------------------------------------- */
+/*      Does the driver already know the min/max?                       */
+/* -------------------------------------------------------------------- */
+    if( bApproxOK )
+    {
+        int          bSuccessMin, bSuccessMax;
+
+        dfMin = GetMinimum( &bSuccessMin );
+        dfMax = GetMaximum( &bSuccessMax );
+
+        if( bSuccessMin && bSuccessMax )
+        {
+            adfMinMax[0] = dfMin;
+            adfMinMax[1] = dfMax;
+            return CE_None;
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      If we have overview bands, use them for min/max.                */
+/* -------------------------------------------------------------------- */
+    if ( bApproxOK && GetOverviewCount() > 0 && !HasArbitraryOverviews() )
+    {
+        GDALRasterBand *poBand;
+
+        poBand = GetRasterSampleOverview( GDALSTAT_APPROX_NUMSAMPLES );
+
+        if ( poBand != this )
+            return poBand->ComputeRasterMinMax( FALSE, adfMinMax );
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Read actual data and compute minimum and maximum.               */
+/* -------------------------------------------------------------------- */
+    GDALStatsComputer oComputer( this, GDAL_STATS_MINMAX );
+    CPLErr eErr;
+
+    if ( bApproxOK && HasArbitraryOverviews() )
+    {
+        eErr = oComputer.ProcessReducedImage();
+    }
+    else    // No arbitrary overviews
+    {
+        int     nSampleRate;
+
+        if( !InitBlockInfo() )
+            return CE_Failure;
+
+/* -------------------------------------------------------------------- */
+/*      Figure out the ratio of blocks we will read to get an           */
+/*      approximate value.                                              */
+/* -------------------------------------------------------------------- */
+        if ( bApproxOK )
+        {
+            nSampleRate =
+                (int) MAX(1,sqrt((double) nBlocksPerRow * nBlocksPerColumn));
+        }
+        else
+            nSampleRate = 1;
+
+        eErr = oComputer.ProcessBlocks( nSampleRate, TRUE, "",
+                                        GDALDummyProgress, NULL );
+    }
+
+    if( eErr != CE_None )
+        return eErr;
+
+    const GDALStatsAccumulator *psResult = oComputer.GetResult();
+
+    if( psResult->nCount > 0 )
+    {
+        dfMin = psResult->dfMin;
+        dfMax = psResult->dfMax;
+    }
+
+    adfMinMax[0] = dfMin;
+    adfMinMax[1] = dfMax;
+
+    if( psResult->nCount == 0 )
+    {
+        ReportError( CE_Failure, CPLE_AppDefined,
+            "Failed to compute min/max, no valid pixels found in sampling." );
+        return CE_Failure;
+    }
+    else
+    {
+        return CE_None;
+    }
+}
@@ -29,6 +29,7 @@
  ****************************************************************************/
 
 #include "gdal_priv.h"
+#include "cpl_multiproc.h"
 
 CPL_CVSID("$Id$");
 
@@ -1614,6 +1615,497 @@ static GDALDataType GDALGetOvrWorkDataType(const char* pszResampling,
         return GDT_Float32;
 }
 
+/************************************************************************/
+/*                      GDALPromoteBit2Grayscale()                      */
+/*                                                                      */
+/*      Special case to promote 1bit data to 8bit 0/255 values for      */
+/*      the AVERAGE_BIT2GRAYSCALE(_MINISWHITE) resampling methods.      */
+/************************************************************************/
+
+static void GDALPromoteBit2Grayscale( const char *pszResampling,
+                                      GDALDataType eType, void *pChunk,
+                                      int nCount )
+{
+    int i;
+
+    if( EQUAL(pszResampling,"AVERAGE_BIT2GRAYSCALE") )
+    {
+        if (eType == GDT_Float32)
+        {
+            float* pafChunk = (float*)pChunk;
+            for( i = nCount - 1; i >= 0; i-- )
+            {
+                if( pafChunk[i] == 1.0 )
+                    pafChunk[i] = 255.0;
+            }
+        }
+        else if (eType == GDT_Byte)
+        {
+            GByte* pabyChunk = (GByte*)pChunk;
+            for( i = nCount - 1; i >= 0; i-- )
+            {
+                if( pabyChunk[i] == 1 )
+                    pabyChunk[i] = 255;
+            }
+        }
+        else {
+            CPLAssert(0);
+        }
+    }
+    else if( EQUAL(pszResampling,"AVERAGE_BIT2GRAYSCALE_MINISWHITE") )
+    {
+        if (eType == GDT_Float32)
+        {
+            float* pafChunk = (float*)pChunk;
+            for( i = nCount - 1; i >= 0; i-- )
+            {
+                if( pafChunk[i] == 1.0 )
+                    pafChunk[i] = 0.0;
+                else if( pafChunk[i] == 0.0 )
+                    pafChunk[i] = 255.0;
+            }
+        }
+        else if (eType == GDT_Byte)
+        {
+            GByte* pabyChunk = (GByte*)pChunk;
+            for( i = nCount - 1; i >= 0; i-- )
+            {
+                if( pabyChunk[i] == 1 )
+                    pabyChunk[i] = 0;
+                else if( pabyChunk[i] == 0 )
+                    pabyChunk[i] = 255;
+            }
+        }
+        else {
+            CPLAssert(0);
+        }
+    }
+}
+
+/************************************************************************/
+/* ==================================================================== */
+/*                Multi-threaded overview computation                   */
+/*                                                                      */
+/*      When the GDAL_NUM_THREADS configuration option is set to more   */
+/*      than one thread, the downsampling of the chunks is done by      */
+/*      jobs of the CPL thread pool.  Each job downsamples one source   */
+/*      chunk (of one band) for one overview into a buffer, through a   */
+/*      GDALResampleBufferBand.  The calling thread does all the I/O:   */
+/*      it reads the next chunks while the jobs run, and writes the     */
+/*      computed buffers to the overviews in the same order as the      */
+/*      single-threaded code, so that the output is identical.  Reads   */
+/*      and writes cannot be moved to another thread, as the source     */
+/*      and overview bands often belong to the same dataset (internal   */
+/*      TIFF overviews) that is not thread-safe.                        */
+/*                                                                      */
+/*      At most nThreads + 1 chunks are in flight, which bounds the     */
+/*      memory used.                                                    */
+/* ==================================================================== */
+/************************************************************************/
+
+typedef struct
+{
+    GDALDownsampleFunction pfnDownsampleFn; /* NULL for complex types */
+    int             nSrcWidth;
+    int             nSrcHeight;
+    GDALDataType    eWrkDataType;
+    void           *pChunk;
+    GByte          *pabyChunkNodataMask;
+    int             nChunkXOff;
+    int             nChunkXSize;
+    int             nChunkYOff;
+    int             nChunkYSize;
+    int             nDstXOff;
+    int             nDstXOff2;
+    int             nDstYOff;
+    int             nDstYOff2;
+    GDALRasterBand *poOverview;
+    const char     *pszResampling;
+    int             bHasNoData;
+    float           fNoDataValue;
+    GDALColorTable *poColorTable;
+    GDALDataType    eSrcDataType;
+
+    void           *pDstBuffer;     /* in the data type of poOverview */
+    CPLErr          eErr;
+} GDALOvrDownsampleJob;
+
+/************************************************************************/
+/*                     GDALGetOverviewThreadCount()                     */
+/************************************************************************/
+
+static int GDALGetOverviewThreadCount()
+{
+    return CPLGetNumThreadsFromOption(
+        CPLGetConfigOption("GDAL_NUM_THREADS", "1"), 1 );
+}
+
+/* Defined after GDALResampleBufferBand, which it uses. */
+static void GDALOvrDownsampleJobRun( void *pData );
+
+/************************************************************************/
+/*                     GDALOvrDownsampleJobWrite()                      */
+/*                                                                      */
+/*      Write the result of a completed job to the overview band.       */
+/************************************************************************/
+
+static CPLErr GDALOvrDownsampleJobWrite( GDALOvrDownsampleJob *psJob )
+{
+    if( psJob->eErr != CE_None )
+        return psJob->eErr;
+
+    int nDstXSize = psJob->nDstXOff2 - psJob->nDstXOff;
+    int nDstYSize = psJob->nDstYOff2 - psJob->nDstYOff;
+    if( nDstXSize <= 0 || nDstYSize <= 0 )
+        return CE_None;
+
+    return psJob->poOverview->RasterIO( GF_Write,
+                                        psJob->nDstXOff, psJob->nDstYOff,
+                                        nDstXSize, nDstYSize,
+                                        psJob->pDstBuffer,
+                                        nDstXSize, nDstYSize,
+                                        psJob->poOverview->GetRasterDataType(),
+                                        0, 0 );
+}
+
+/************************************************************************/
+/*                          GDALOvrChunkSlot                            */
+/*                                                                      */
+/*      Buffers and jobs of one chunk in flight.                        */
+/************************************************************************/
+
+typedef struct
+{
+    CPLJobGroup          *psJobGroup;
+    void                **papChunk;     /* one per band */
+    GByte                *pabyChunkNodataMask;
+    int                   nJobs;
+    GDALOvrDownsampleJob *pasJobs;
+    void                **papDstBuffers; /* one per job */
+    int                   bInUse;
+} GDALOvrChunkSlot;
+
+/************************************************************************/
+/*                       GDALOvrFreeChunkSlots()                        */
+/************************************************************************/
+
+static void GDALOvrFreeChunkSlots( GDALOvrChunkSlot *pasSlots, int nSlots,
+                                   int nBands )
+{
+    if( pasSlots == NULL )
+        return;
+
+    for( int iSlot = 0; iSlot < nSlots; iSlot++ )
+    {
+        GDALOvrChunkSlot *psSlot = pasSlots + iSlot;
+
+        if( psSlot->psJobGroup != NULL )
+            CPLDestroyJobGroup( psSlot->psJobGroup );
+        if( psSlot->papChunk != NULL )
+        {
+            for( int iBand = 0; iBand < nBands; iBand++ )
+                VSIFree( psSlot->papChunk[iBand] );
+            CPLFree( psSlot->papChunk );
+        }
+        VSIFree( psSlot->pabyChunkNodataMask );
+        if( psSlot->papDstBuffers != NULL )
+        {
+            for( int iJob = 0; iJob < psSlot->nJobs; iJob++ )
+                VSIFree( psSlot->papDstBuffers[iJob] );
+            CPLFree( psSlot->papDstBuffers );
+        }
+        CPLFree( psSlot->pasJobs );
+    }
+    CPLFree( pasSlots );
+}
+
+/************************************************************************/
+/*                      GDALOvrAllocChunkSlots()                        */
+/*                                                                      */
+/*      Allocate nSlots slots, each with one chunk buffer of            */
+/*      nChunkBytes per band, an optional mask buffer of nMaskBytes,    */
+/*      and nJobs output buffers of panDstBytes[iJob] bytes.            */
+/************************************************************************/
+
+static GDALOvrChunkSlot *GDALOvrAllocChunkSlots( int nSlots, int nBands,
+                                                 size_t nChunkBytes,
+                                                 size_t nMaskBytes,
+                                                 int nJobs,
+                                                 const size_t *panDstBytes )
+{
+    GDALOvrChunkSlot *pasSlots = (GDALOvrChunkSlot *)
+        CPLCalloc( sizeof(GDALOvrChunkSlot), nSlots );
+    int bOK = TRUE;
+
+    for( int iSlot = 0; iSlot < nSlots && bOK; iSlot++ )
+    {
+        GDALOvrChunkSlot *psSlot = pasSlots + iSlot;
+
+        psSlot->psJobGroup = CPLCreateJobGroup();
+        psSlot->nJobs = nJobs;
+        psSlot->pasJobs = (GDALOvrDownsampleJob *)
+            CPLCalloc( sizeof(GDALOvrDownsampleJob), nJobs );
+        psSlot->papDstBuffers = (void **) CPLCalloc( sizeof(void*), nJobs );
+        psSlot->papChunk = (void **) CPLCalloc( sizeof(void*), nBands );
+
+        for( int iBand = 0; iBand < nBands && bOK; iBand++ )
+        {
+            psSlot->papChunk[iBand] = VSIMalloc( nChunkBytes );
+            bOK = psSlot->papChunk[iBand] != NULL;
+        }
+        if( bOK && nMaskBytes > 0 )
+        {
+            psSlot->pabyChunkNodataMask = (GByte *) VSIMalloc( nMaskBytes );
+            bOK = psSlot->pabyChunkNodataMask != NULL;
+        }
+        for( int iJob = 0; iJob < nJobs && bOK; iJob++ )
+        {
+            psSlot->papDstBuffers[iJob] = VSIMalloc( MAX(1, panDstBytes[iJob]) );
+            bOK = psSlot->papDstBuffers[iJob] != NULL;
+        }
+    }
+
+    if( !bOK )
+    {
+        GDALOvrFreeChunkSlots( pasSlots, nSlots, nBands );
+        CPLError( CE_Failure, CPLE_OutOfMemory,
+                  "Out of memory in overview computation." );
+        return NULL;
+    }
+
+    return pasSlots;
+}
+
+/************************************************************************/
+/*                      GDALOvrCompleteChunkSlot()                      */
+/*                                                                      */
+/*      Wait for the jobs of a slot and write their results.            */
+/************************************************************************/
+
+static CPLErr GDALOvrCompleteChunkSlot( GDALOvrChunkSlot *psSlot,
+                                        CPLErr eErr )
+{
+    if( !psSlot->bInUse )
+        return eErr;
+
+    CPLWaitJobGroup( psSlot->psJobGroup );
+    psSlot->bInUse = FALSE;
+
+    for( int iJob = 0; iJob < psSlot->nJobs && eErr == CE_None; iJob++ )
+    {
+        if( psSlot->pasJobs[iJob].poOverview != NULL )
+            eErr = GDALOvrDownsampleJobWrite( psSlot->pasJobs + iJob );
+    }
+
+    return eErr;
+}
+
+/************************************************************************/
+/*                   GDALRegenerateOverviewsThreaded()                  */
+/*                                                                      */
+/*      Multi-threaded version of the chunk loop of                     */
+/*      GDALRegenerateOverviews().                                      */
+/************************************************************************/
+
+static CPLErr
+GDALRegenerateOverviewsThreaded( GDALRasterBand *poSrcBand,
+                                 int nOverviewCount,
+                                 GDALRasterBand **papoOvrBands,
+                                 const char *pszResampling,
+                                 GDALDownsampleFunction pfnDownsampleFn,
+                                 GDALDataType eType,
+                                 GDALRasterBand *poMaskBand,
+                                 int bUseNoDataMask,
+                                 int nFullResYChunk,
+                                 int nKernelRadius, int nMaxOvrFactor,
+                                 int bHasNoData, float fNoDataValue,
+                                 GDALColorTable *poColorTable,
+                                 int nThreads,
+                                 GDALProgressFunc pfnProgress,
+                                 void *pProgressData )
+{
+    int nWidth = poSrcBand->GetXSize();
+    int nHeight = poSrcBand->GetYSize();
+    int nMaxChunkYSizeQueried = nFullResYChunk + 2 * nKernelRadius * nMaxOvrFactor;
+    int iOverview;
+
+/* -------------------------------------------------------------------- */
+/*      Output buffers: the largest number of overview lines a chunk    */
+/*      can produce.                                                    */
+/* -------------------------------------------------------------------- */
+    size_t *panDstBytes = (size_t *) CPLMalloc( sizeof(size_t) * nOverviewCount );
+    for( iOverview = 0; iOverview < nOverviewCount; iOverview++ )
+    {
+        GDALRasterBand *poOvr = papoOvrBands[iOverview];
+        int nMaxDstLines = 2 + (int)
+            (((double) nFullResYChunk * poOvr->GetYSize()) / nHeight);
+        panDstBytes[iOverview] = (size_t) nMaxDstLines * poOvr->GetXSize()
+            * (GDALGetDataTypeSize(poOvr->GetRasterDataType()) / 8);
+    }
+
+    int nSlots = nThreads + 1;
+    GDALOvrChunkSlot *pasSlots = GDALOvrAllocChunkSlots(
+        nSlots, 1,
+        (size_t) (GDALGetDataTypeSize(eType) / 8) * nMaxChunkYSizeQueried * nWidth,
+        bUseNoDataMask ? (size_t) nMaxChunkYSizeQueried * nWidth : 0,
+        nOverviewCount, panDstBytes );
+    CPLFree( panDstBytes );
+    if( pasSlots == NULL )
+        return CE_Failure;
+
+    CPLDebug( "GDAL", "Computing overviews of %s with %d threads.",
+              poSrcBand->GetDataset() ? poSrcBand->GetDataset()->GetDescription() : "",
+              nThreads );
+
+/* -------------------------------------------------------------------- */
+/*      Loop over image operating on chunks.                            */
+/* -------------------------------------------------------------------- */
+    CPLErr eErr = CE_None;
+    int iChunk = 0;
+
+    for( int nChunkYOff = 0;
+         nChunkYOff < nHeight && eErr == CE_None;
+         nChunkYOff += nFullResYChunk, iChunk++ )
+    {
+        GDALOvrChunkSlot *psSlot = pasSlots + (iChunk % nSlots);
+
+        if( !pfnProgress( nChunkYOff / (double) nHeight,
+                          NULL, pProgressData ) )
+        {
+            CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+            eErr = CE_Failure;
+            break;
+        }
+
+        /* Recycle the slot of the oldest chunk in flight */
+        eErr = GDALOvrCompleteChunkSlot( psSlot, eErr );
+        if( eErr != CE_None )
+            break;
+
+        if( nFullResYChunk + nChunkYOff > nHeight )
+            nFullResYChunk = nHeight - nChunkYOff;
+
+        int nChunkYOffQueried = nChunkYOff - nKernelRadius * nMaxOvrFactor;
+        int nChunkYSizeQueried = nFullResYChunk + 2 * nKernelRadius * nMaxOvrFactor;
+        if( nChunkYOffQueried < 0 )
+        {
+            nChunkYSizeQueried += nChunkYOffQueried;
+            nChunkYOffQueried = 0;
+        }
+        if( nChunkYOffQueried + nChunkYSizeQueried > nHeight )
+            nChunkYSizeQueried = nHeight - nChunkYOffQueried;
+
+        /* read chunk */
+        void *pChunk = psSlot->papChunk[0];
+        eErr = poSrcBand->RasterIO( GF_Read, 0, nChunkYOffQueried, nWidth, nChunkYSizeQueried,
+                                    pChunk, nWidth, nChunkYSizeQueried, eType,
+                                    0, 0 );
+        if (eErr == CE_None && bUseNoDataMask)
+            eErr = poMaskBand->RasterIO( GF_Read, 0, nChunkYOffQueried, nWidth, nChunkYSizeQueried,
+                                         psSlot->pabyChunkNodataMask, nWidth, nChunkYSizeQueried, GDT_Byte,
+                                         0, 0 );
+        if( eErr != CE_None )
+            break;
+
+        /* special case to promote 1bit data to 8bit 0/255 values */
+        GDALPromoteBit2Grayscale( pszResampling, eType, pChunk,
+                                  nChunkYSizeQueried*nWidth );
+
+/* -------------------------------------------------------------------- */
+/*      Queue one job per overview.                                     */
+/* -------------------------------------------------------------------- */
+        for( iOverview = 0; iOverview < nOverviewCount; iOverview++ )
+        {
+            GDALOvrDownsampleJob *psJob = psSlot->pasJobs + iOverview;
+            int nDstWidth = papoOvrBands[iOverview]->GetXSize();
+            int nDstHeight = papoOvrBands[iOverview]->GetYSize();
+
+            int nDstYOff = (int) (0.5 + (nChunkYOff/(double)nHeight) * nDstHeight);
+            int nDstYOff2 = (int)
+                (0.5 + ((nChunkYOff+nFullResYChunk)/(double)nHeight) * nDstHeight);
+
+            if( nChunkYOff + nFullResYChunk == nHeight )
+                nDstYOff2 = nDstHeight;
+
+            psJob->pfnDownsampleFn =
+                ( eType == GDT_Byte || eType == GDT_Float32 ) ? pfnDownsampleFn : NULL;
+            psJob->nSrcWidth = nWidth;
+            psJob->nSrcHeight = nHeight;
+            psJob->eWrkDataType = eType;
+            psJob->pChunk = pChunk;
+            psJob->pabyChunkNodataMask = psSlot->pabyChunkNodataMask;
+            psJob->nChunkXOff = 0;
+            psJob->nChunkXSize = nWidth;
+            psJob->nChunkYOff = nChunkYOffQueried;
+            psJob->nChunkYSize = nChunkYSizeQueried;
+            psJob->nDstXOff = 0;
+            psJob->nDstXOff2 = nDstWidth;
+            psJob->nDstYOff = nDstYOff;
+            psJob->nDstYOff2 = nDstYOff2;
+            psJob->poOverview = papoOvrBands[iOverview];
+            psJob->pszResampling = pszResampling;
+            psJob->bHasNoData = bHasNoData;
+            psJob->fNoDataValue = fNoDataValue;
+            psJob->poColorTable = poColorTable;
+            psJob->eSrcDataType = poSrcBand->GetRasterDataType();
+            psJob->pDstBuffer = psSlot->papDstBuffers[iOverview];
+            psJob->eErr = CE_None;
+
+            CPLSubmitJob( psSlot->psJobGroup, GDALOvrDownsampleJobRun, psJob );
+        }
+        psSlot->bInUse = TRUE;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Complete the chunks still in flight, in order.                  */
+/* -------------------------------------------------------------------- */
+    for( int i = 0; i < nSlots; i++ )
+        eErr = GDALOvrCompleteChunkSlot( pasSlots + ((iChunk + i) % nSlots), eErr );
+
+    GDALOvrFreeChunkSlots( pasSlots, nSlots, 1 );
+
+    return eErr;
+}
+
+/************************************************************************/
+/*                  GDALRegenerateOverviewsFinalize()                   */
+/************************************************************************/
+
+static CPLErr
+GDALRegenerateOverviewsFinalize( GDALRasterBand *poSrcBand,
+                                 int nOverviewCount,
+                                 GDALRasterBand **papoOvrBands,
+                                 const char *pszResampling, CPLErr eErr,
+                                 GDALProgressFunc pfnProgress,
+                                 void *pProgressData )
+{
+/* -------------------------------------------------------------------- */
+/*      Renormalized overview mean / stddev if needed.                  */
+/* -------------------------------------------------------------------- */
+    if( eErr == CE_None && EQUAL(pszResampling,"AVERAGE_MP") )
+    {
+        GDALOverviewMagnitudeCorrection( (GDALRasterBandH) poSrcBand, 
+                                         nOverviewCount, 
+                                         (GDALRasterBandH *) papoOvrBands,
+                                         GDALDummyProgress, NULL );
+    }
+
+/* -------------------------------------------------------------------- */
+/*      It can be important to flush out data to overviews.             */
+/* -------------------------------------------------------------------- */
+    for( int iOverview = 0; 
+         eErr == CE_None && iOverview < nOverviewCount; 
+         iOverview++ )
+    {
+        eErr = papoOvrBands[iOverview]->FlushCache();
+    }
+
+    if (eErr == CE_None)
+        pfnProgress( 1.0, NULL, pProgressData );
+
+    return eErr;
+}
+
 /************************************************************************/
 /*                      GDALRegenerateOverviews()                       */
 /************************************************************************/
@@ -1784,6 +2276,24 @@ GDALRegenerateOverviews( GDALRasterBandH hSrcBand,
     }
     int nMaxChunkYSizeQueried = nFullResYChunk + 2 * nKernelRadius * nMaxOvrFactor;
 
+    fNoDataValue = (float) poSrcBand->GetNoDataValue(&bHasNoData);
+
+    int nThreads = GDALGetOverviewThreadCount();
+    if( nThreads > 1 )
+    {
+        CPLErr eErr = GDALRegenerateOverviewsThreaded(
+            poSrcBand, nOverviewCount, papoOvrBands, pszResampling,
+            pfnDownsampleFn, eType, poMaskBand, bUseNoDataMask,
+            nFullResYChunk, nKernelRadius, nMaxOvrFactor,
+            bHasNoData, fNoDataValue, poColorTable, nThreads,
+            pfnProgress, pProgressData );
+
+        return GDALRegenerateOverviewsFinalize( poSrcBand, nOverviewCount,
+                                                papoOvrBands, pszResampling,
+                                                eErr,
+                                                pfnProgress, pProgressData );
+    }
+
     pChunk = 
         VSIMalloc3((GDALGetDataTypeSize(eType)/8), nMaxChunkYSizeQueried, nWidth );
     if (bUseNoDataMask)
@@ -1802,8 +2312,6 @@ GDALRegenerateOverviews( GDALRasterBandH hSrcBand,
         return CE_Failure;
     }
 
-    fNoDataValue = (float) poSrcBand->GetNoDataValue(&bHasNoData);
-
 /* -------------------------------------------------------------------- */
 /*      Loop over image operating on chunks.                            */
 /* -------------------------------------------------------------------- */
@@ -1845,62 +2353,8 @@ GDALRegenerateOverviews( GDALRasterBandH hSrcBand,
                                 0, 0 );
 
         /* special case to promote 1bit data to 8bit 0/255 values */
-        if( EQUAL(pszResampling,"AVERAGE_BIT2GRAYSCALE") )
-        {
-            int i;
-
-            if (eType == GDT_Float32)
-            {
-                float* pafChunk = (float*)pChunk;
-                for( i = nChunkYSizeQueried*nWidth - 1; i >= 0; i-- )
-                {
-                    if( pafChunk[i] == 1.0 )
-                        pafChunk[i] = 255.0;
-                }
-            }
-            else if (eType == GDT_Byte)
-            {
-                GByte* pabyChunk = (GByte*)pChunk;
-                for( i = nChunkYSizeQueried*nWidth - 1; i >= 0; i-- )
-                {
-                    if( pabyChunk[i] == 1 )
-                        pabyChunk[i] = 255;
-                }
-            }
-            else {
-                CPLAssert(0);
-            }
-        }
-        else if( EQUAL(pszResampling,"AVERAGE_BIT2GRAYSCALE_MINISWHITE") )
-        {
-            int i;
-
-            if (eType == GDT_Float32)
-            {
-                float* pafChunk = (float*)pChunk;
-                for( i = nChunkYSizeQueried*nWidth - 1; i >= 0; i-- )
-                {
-                    if( pafChunk[i] == 1.0 )
-                        pafChunk[i] = 0.0;
-                    else if( pafChunk[i] == 0.0 )
-                        pafChunk[i] = 255.0;
-                }
-            }
-            else if (eType == GDT_Byte)
-            {
-                GByte* pabyChunk = (GByte*)pChunk;
-                for( i = nChunkYSizeQueried*nWidth - 1; i >= 0; i-- )
-                {
-                    if( pabyChunk[i] == 1 )
-                        pabyChunk[i] = 0;
-                    else if( pabyChunk[i] == 0 )
-                        pabyChunk[i] = 255;
-                }
-            }
-            else {
-                CPLAssert(0);
-            }
-        }
+        GDALPromoteBit2Grayscale( pszResampling, eType, pChunk,
+                                  nChunkYSizeQueried*nWidth );
 
         for( int iOverview = 0; iOverview < nOverviewCount && eErr == CE_None; iOverview++ )
         {
@@ -1941,38 +2395,737 @@ GDALRegenerateOverviews( GDALRasterBandH hSrcBand,
         }
     }
 
-    VSIFree( pChunk );
-    VSIFree( pabyChunkNodataMask );
-    
+    VSIFree( pChunk );
+    VSIFree( pabyChunkNodataMask );
+
+    return GDALRegenerateOverviewsFinalize( poSrcBand, nOverviewCount,
+                                            papoOvrBands, pszResampling, eErr,
+                                            pfnProgress, pProgressData );
+}
+
+
+
+/************************************************************************/
+/*            GDALRegenerateOverviewsMultiBandLevelThreaded()           */
+/*                                                                      */
+/*      Multi-threaded version of the block loop of                     */
+/*      GDALRegenerateOverviewsMultiBand(), for one overview level.     */
+/************************************************************************/
+
+static CPLErr
+GDALRegenerateOverviewsMultiBandLevelThreaded(
+    int nBands, GDALRasterBand **papoLevelSrcBands,
+    GDALRasterBand **papoLevelOvrBands,
+    const char *pszResampling, GDALDownsampleFunction pfnDownsampleFn,
+    GDALDataType eWrkDataType, GDALDataType eDataType,
+    int bUseNoDataMask, int nKernelRadius, int nOvrFactor,
+    int nFullResXChunkQueried, int nFullResYChunkQueried,
+    const int *pabHasNoData, const float *pafNoDataValue,
+    int nThreads,
+    double *pdfCurPixelCount, double dfTotalPixelCount,
+    GDALProgressFunc pfnProgress, void *pProgressData )
+{
+    int nSrcWidth = papoLevelSrcBands[0]->GetXSize();
+    int nSrcHeight = papoLevelSrcBands[0]->GetYSize();
+    int nDstWidth = papoLevelOvrBands[0]->GetXSize();
+    int nDstHeight = papoLevelOvrBands[0]->GetYSize();
+    int nDstBlockXSize, nDstBlockYSize;
+    int iBand;
+
+    papoLevelOvrBands[0]->GetBlockSize(&nDstBlockXSize, &nDstBlockYSize);
+
+    size_t *panDstBytes = (size_t *) CPLMalloc( sizeof(size_t) * nBands );
+    for( iBand = 0; iBand < nBands; iBand++ )
+        panDstBytes[iBand] = (size_t) nDstBlockXSize * nDstBlockYSize
+            * (GDALGetDataTypeSize(eDataType) / 8);
+
+    int nSlots = nThreads + 1;
+    GDALOvrChunkSlot *pasSlots = GDALOvrAllocChunkSlots(
+        nSlots, nBands,
+        (size_t) nFullResXChunkQueried * nFullResYChunkQueried
+            * (GDALGetDataTypeSize(eWrkDataType) / 8),
+        bUseNoDataMask ? (size_t) nFullResXChunkQueried * nFullResYChunkQueried : 0,
+        nBands, panDstBytes );
+    CPLFree( panDstBytes );
+    if( pasSlots == NULL )
+        return CE_Failure;
+
+    CPLErr eErr = CE_None;
+    int iChunk = 0;
+
+    /* Iterate on destination overview, block by block */
+    for( int nDstYOff = 0; nDstYOff < nDstHeight && eErr == CE_None; nDstYOff += nDstBlockYSize )
+    {
+        int nDstYCount;
+        if  (nDstYOff + nDstBlockYSize <= nDstHeight)
+            nDstYCount = nDstBlockYSize;
+        else
+            nDstYCount = nDstHeight - nDstYOff;
+
+        int nChunkYOff = (int) (0.5 + nDstYOff / (double)nDstHeight * nSrcHeight);
+        int nChunkYOff2 = (int) (0.5 + (nDstYOff + nDstBlockYSize) / (double)nDstHeight * nSrcHeight);
+        if( nChunkYOff2 > nSrcHeight || nDstYOff + nDstBlockYSize == nDstHeight)
+            nChunkYOff2 = nSrcHeight;
+        int nYCount = nChunkYOff2 - nChunkYOff;
+
+        int nChunkYOffQueried = nChunkYOff - nKernelRadius * nOvrFactor;
+        int nChunkYSizeQueried = nYCount + 2 * nKernelRadius * nOvrFactor;
+        if( nChunkYOffQueried < 0 )
+        {
+            nChunkYSizeQueried += nChunkYOffQueried;
+            nChunkYOffQueried = 0;
+        }
+        if( nChunkYSizeQueried + nChunkYOffQueried > nSrcHeight )
+            nChunkYSizeQueried = nSrcHeight - nChunkYOffQueried;
+
+        if( !pfnProgress( *pdfCurPixelCount / dfTotalPixelCount,
+                          NULL, pProgressData ) )
+        {
+            CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+            eErr = CE_Failure;
+        }
+
+        /* Iterate on destination overview, block by block */
+        for( int nDstXOff = 0; nDstXOff < nDstWidth && eErr == CE_None;
+             nDstXOff += nDstBlockXSize, iChunk++ )
+        {
+            GDALOvrChunkSlot *psSlot = pasSlots + (iChunk % nSlots);
+
+            /* Recycle the slot of the oldest block in flight */
+            eErr = GDALOvrCompleteChunkSlot( psSlot, eErr );
+            if( eErr != CE_None )
+                break;
+
+            int nDstXCount;
+            if  (nDstXOff + nDstBlockXSize <= nDstWidth)
+                nDstXCount = nDstBlockXSize;
+            else
+                nDstXCount = nDstWidth - nDstXOff;
+
+            int nChunkXOff = (int) (0.5 + nDstXOff / (double)nDstWidth * nSrcWidth);
+            int nChunkXOff2 = (int) (0.5 + (nDstXOff + nDstBlockXSize) / (double)nDstWidth * nSrcWidth);
+            if( nChunkXOff2 > nSrcWidth || nDstXOff + nDstBlockXSize == nDstWidth)
+                nChunkXOff2 = nSrcWidth;
+            int nXCount = nChunkXOff2 - nChunkXOff;
+
+            int nChunkXOffQueried = nChunkXOff - nKernelRadius * nOvrFactor;
+            int nChunkXSizeQueried = nXCount + 2 * nKernelRadius * nOvrFactor;
+            if( nChunkXOffQueried < 0 )
+            {
+                nChunkXSizeQueried += nChunkXOffQueried;
+                nChunkXOffQueried = 0;
+            }
+            if( nChunkXSizeQueried + nChunkXOffQueried > nSrcWidth )
+                nChunkXSizeQueried = nSrcWidth - nChunkXOffQueried;
+
+            /* Read the source buffers for all the bands */
+            for(iBand=0;iBand<nBands && eErr == CE_None;iBand++)
+            {
+                eErr = papoLevelSrcBands[iBand]->RasterIO( GF_Read,
+                                            nChunkXOffQueried, nChunkYOffQueried,
+                                            nChunkXSizeQueried, nChunkYSizeQueried,
+                                            psSlot->papChunk[iBand],
+                                            nChunkXSizeQueried, nChunkYSizeQueried,
+                                            eWrkDataType, 0, 0 );
+            }
+
+            if (bUseNoDataMask && eErr == CE_None)
+            {
+                eErr = papoLevelSrcBands[0]->GetMaskBand()->RasterIO( GF_Read,
+                                            nChunkXOffQueried, nChunkYOffQueried,
+                                            nChunkXSizeQueried, nChunkYSizeQueried,
+                                            psSlot->pabyChunkNodataMask,
+                                            nChunkXSizeQueried, nChunkYSizeQueried,
+                                            GDT_Byte, 0, 0 );
+            }
+            if( eErr != CE_None )
+                break;
+
+            /* Queue the computation of the overview block of each band */
+            for(iBand=0;iBand<nBands;iBand++)
+            {
+                GDALOvrDownsampleJob *psJob = psSlot->pasJobs + iBand;
+
+                psJob->pfnDownsampleFn = pfnDownsampleFn;
+                psJob->nSrcWidth = nSrcWidth;
+                psJob->nSrcHeight = nSrcHeight;
+                psJob->eWrkDataType = eWrkDataType;
+                psJob->pChunk = psSlot->papChunk[iBand];
+                psJob->pabyChunkNodataMask = psSlot->pabyChunkNodataMask;
+                psJob->nChunkXOff = nChunkXOffQueried;
+                psJob->nChunkXSize = nChunkXSizeQueried;
+                psJob->nChunkYOff = nChunkYOffQueried;
+                psJob->nChunkYSize = nChunkYSizeQueried;
+                psJob->nDstXOff = nDstXOff;
+                psJob->nDstXOff2 = nDstXOff + nDstXCount;
+                psJob->nDstYOff = nDstYOff;
+                psJob->nDstYOff2 = nDstYOff + nDstYCount;
+                psJob->poOverview = papoLevelOvrBands[iBand];
+                psJob->pszResampling = pszResampling;
+                psJob->bHasNoData = pabHasNoData[iBand];
+                psJob->fNoDataValue = pafNoDataValue[iBand];
+                psJob->poColorTable = NULL;
+                psJob->eSrcDataType = eDataType;
+                psJob->pDstBuffer = psSlot->papDstBuffers[iBand];
+                psJob->eErr = CE_None;
+
+                CPLSubmitJob( psSlot->psJobGroup, GDALOvrDownsampleJobRun, psJob );
+            }
+            psSlot->bInUse = TRUE;
+        }
+
+        *pdfCurPixelCount += (double)nYCount * nSrcWidth;
+    }
+
+    /* Complete the blocks still in flight, in order */
+    for( int i = 0; i < nSlots; i++ )
+        eErr = GDALOvrCompleteChunkSlot( pasSlots + ((iChunk + i) % nSlots), eErr );
+
+    GDALOvrFreeChunkSlots( pasSlots, nSlots, nBands );
+
+    return eErr;
+}
+
+/************************************************************************/
+/*                         GDALOvrStreamBuffer                          */
+/*                                                                      */
+/*      Rolling window of full width lines of one pyramid level, in     */
+/*      the working data type, from which the next level is computed.   */
+/************************************************************************/
+
+typedef struct
+{
+    int     nXSize;
+    int     nYSize;
+    int     nYOff;          /* first line held */
+    int     nLines;         /* number of lines held */
+    int     nMaxLines;
+    void  **papData;        /* one per band */
+} GDALOvrStreamBuffer;
+
+/************************************************************************/
+/*                          GDALOvrStreamLevel                          */
+/*                                                                      */
+/*      State of the computation of one overview level.                 */
+/************************************************************************/
+
+typedef struct
+{
+    GDALRasterBand     **papoOvrBands;  /* one per band */
+    int                  nDstBlockXSize;
+    int                  nDstBlockYSize;
+    int                  nOvrFactor;
+    int                  nFullResXChunkQueried;
+    int                  nFullResYChunkQueried;
+    int                  nNextDstYOff;
+    int                  nSlots;
+    GDALOvrChunkSlot    *pasSlots;
+    GDALOvrStreamBuffer *psSrc;     /* lines this level is computed from */
+    GDALOvrStreamBuffer *psDst;     /* lines kept for the next level, or NULL */
+} GDALOvrStreamLevel;
+
+typedef struct
+{
+    int                     nBands;
+    int                     nLevels;
+    GDALOvrStreamLevel     *pasLevels;
+    GDALDownsampleFunction  pfnDownsampleFn;
+    const char             *pszResampling;
+    GDALDataType            eWrkDataType;
+    GDALDataType            eDataType;
+    int                     nKernelRadius;
+    const int              *pabHasNoData;
+    const float            *pafNoDataValue;
+    int                     nThreads;
+} GDALOvrStreamContext;
+
+/************************************************************************/
+/*                     GDALOvrStreamBufferDiscard()                     */
+/*                                                                      */
+/*      Drop the lines before nYOff.                                    */
+/************************************************************************/
+
+static void GDALOvrStreamBufferDiscard( GDALOvrStreamBuffer *psBuf,
+                                        int nYOff, int nBands,
+                                        int nPixelSize )
+{
+    int nEnd = psBuf->nYOff + psBuf->nLines;
+    if( nYOff > nEnd )
+        nYOff = nEnd;
+    int nDiscarded = nYOff - psBuf->nYOff;
+    if( nDiscarded <= 0 )
+        return;
+
+    size_t nLineBytes = (size_t) psBuf->nXSize * nPixelSize;
+    for( int iBand = 0; iBand < nBands; iBand++ )
+    {
+        GByte *pabyData = (GByte *) psBuf->papData[iBand];
+        memmove( pabyData, pabyData + nDiscarded * nLineBytes,
+                 (psBuf->nLines - nDiscarded) * nLineBytes );
+    }
+    psBuf->nYOff = nYOff;
+    psBuf->nLines -= nDiscarded;
+}
+
+/************************************************************************/
+/*                     GDALOvrStreamGetSrcWindow()                      */
+/*                                                                      */
+/*      Source lines needed to compute the block row of a level         */
+/*      starting at nDstYOff, computed as in                            */
+/*      GDALRegenerateOverviewsMultiBand().                             */
+/************************************************************************/
+
+static void GDALOvrStreamGetSrcWindow( const GDALOvrStreamLevel *psLevel,
+                                       int nKernelRadius, int nDstYOff,
+                                       int *pnChunkYOffQueried,
+                                       int *pnChunkYSizeQueried )
+{
+    int nSrcHeight = psLevel->psSrc->nYSize;
+    int nDstHeight = psLevel->papoOvrBands[0]->GetYSize();
+    int nDstBlockYSize = psLevel->nDstBlockYSize;
+
+    int nChunkYOff = (int) (0.5 + nDstYOff / (double)nDstHeight * nSrcHeight);
+    int nChunkYOff2 = (int) (0.5 + (nDstYOff + nDstBlockYSize) / (double)nDstHeight * nSrcHeight);
+    if( nChunkYOff2 > nSrcHeight || nDstYOff + nDstBlockYSize >= nDstHeight )
+        nChunkYOff2 = nSrcHeight;
+    int nYCount = nChunkYOff2 - nChunkYOff;
+
+    int nChunkYOffQueried = nChunkYOff - nKernelRadius * psLevel->nOvrFactor;
+    int nChunkYSizeQueried = nYCount + 2 * nKernelRadius * psLevel->nOvrFactor;
+    if( nChunkYOffQueried < 0 )
+    {
+        nChunkYSizeQueried += nChunkYOffQueried;
+        nChunkYOffQueried = 0;
+    }
+    if( nChunkYSizeQueried + nChunkYOffQueried > nSrcHeight )
+        nChunkYSizeQueried = nSrcHeight - nChunkYOffQueried;
+
+    *pnChunkYOffQueried = nChunkYOffQueried;
+    *pnChunkYSizeQueried = nChunkYSizeQueried;
+}
+
+/************************************************************************/
+/*                     GDALOvrStreamCompleteSlot()                      */
+/*                                                                      */
+/*      Wait for the jobs of a slot, write their results to the         */
+/*      overview bands and keep them for the next level.                */
+/************************************************************************/
+
+static CPLErr GDALOvrStreamCompleteSlot( GDALOvrStreamContext *psCtxt,
+                                         GDALOvrStreamLevel *psLevel,
+                                         GDALOvrChunkSlot *psSlot,
+                                         CPLErr eErr )
+{
+    if( !psSlot->bInUse )
+        return eErr;
+
+    CPLWaitJobGroup( psSlot->psJobGroup );
+    psSlot->bInUse = FALSE;
+
+    GDALOvrStreamBuffer *psDst = psLevel->psDst;
+    int nTypeSize = GDALGetDataTypeSize(psCtxt->eDataType) / 8;
+    int nWrkTypeSize = GDALGetDataTypeSize(psCtxt->eWrkDataType) / 8;
+
+    for( int iJob = 0; iJob < psSlot->nJobs && eErr == CE_None; iJob++ )
+    {
+        GDALOvrDownsampleJob *psJob = psSlot->pasJobs + iJob;
+
+        eErr = GDALOvrDownsampleJobWrite( psJob );
+        if( eErr != CE_None || psDst == NULL )
+            continue;
+
+        /* The next level sees the values as stored in the overview */
+        int nDstXSize = psJob->nDstXOff2 - psJob->nDstXOff;
+        for( int iLine = psJob->nDstYOff; iLine < psJob->nDstYOff2; iLine++ )
+        {
+            GDALCopyWords( ((GByte *) psJob->pDstBuffer)
+                               + (size_t)(iLine - psJob->nDstYOff)
+                                   * nDstXSize * nTypeSize,
+                           psCtxt->eDataType, nTypeSize,
+                           ((GByte *) psDst->papData[iJob])
+                               + ((size_t)(iLine - psDst->nYOff) * psDst->nXSize
+                                  + psJob->nDstXOff) * nWrkTypeSize,
+                           psCtxt->eWrkDataType, nWrkTypeSize,
+                           nDstXSize );
+        }
+    }
+
+    return eErr;
+}
+
+/************************************************************************/
+/*                     GDALOvrStreamComputeLevel()                      */
+/*                                                                      */
+/*      Compute the block rows of a level, and recursively of the       */
+/*      following ones, that the source lines available allow.          */
+/************************************************************************/
+
+static CPLErr GDALOvrStreamComputeLevel( GDALOvrStreamContext *psCtxt,
+                                         int iLevel )
+{
+    GDALOvrStreamLevel *psLevel = psCtxt->pasLevels + iLevel;
+    GDALOvrStreamBuffer *psSrc = psLevel->psSrc;
+    GDALOvrStreamBuffer *psDst = psLevel->psDst;
+    int nBands = psCtxt->nBands;
+    int nWrkTypeSize = GDALGetDataTypeSize(psCtxt->eWrkDataType) / 8;
+    int nSrcWidth = psSrc->nXSize;
+    int nSrcHeight = psSrc->nYSize;
+    int nDstWidth = psLevel->papoOvrBands[0]->GetXSize();
+    int nDstHeight = psLevel->papoOvrBands[0]->GetYSize();
+    int nKernelRadius = psCtxt->nKernelRadius;
+    CPLErr eErr = CE_None;
+
+    while( eErr == CE_None && psLevel->nNextDstYOff < nDstHeight )
+    {
+        int nDstYOff = psLevel->nNextDstYOff;
+        int nDstYCount = MIN(psLevel->nDstBlockYSize, nDstHeight - nDstYOff);
+        int nChunkYOffQueried, nChunkYSizeQueried;
+
+        GDALOvrStreamGetSrcWindow( psLevel, nKernelRadius, nDstYOff,
+                                   &nChunkYOffQueried, &nChunkYSizeQueried );
+        if( nChunkYOffQueried + nChunkYSizeQueried > psSrc->nYOff + psSrc->nLines )
+            break;
+        CPLAssert( nChunkYOffQueried >= psSrc->nYOff );
+
+/* -------------------------------------------------------------------- */
+/*      Make room for the new lines in the buffer of the next level.    */
+/* -------------------------------------------------------------------- */
+        if( psDst != NULL )
+        {
+            GDALOvrStreamLevel *psNextLevel = psLevel + 1;
+            int nNextYOff, nNextYSize;
+
+            GDALOvrStreamGetSrcWindow( psNextLevel, nKernelRadius,
+                                       psNextLevel->nNextDstYOff,
+                                       &nNextYOff, &nNextYSize );
+            GDALOvrStreamBufferDiscard( psDst, nNextYOff, nBands,
+                                        nWrkTypeSize );
+            if( psDst->nLines == 0 )
+                psDst->nYOff = nDstYOff;
+            if( psDst->nYOff + psDst->nLines != nDstYOff ||
+                psDst->nLines + nDstYCount > psDst->nMaxLines )
+            {
+                CPLError( CE_Failure, CPLE_AppDefined,
+                          "GDALOvrStreamComputeLevel(): inconsistent line "
+                          "buffer state." );
+                return CE_Failure;
+            }
+        }
+
+/* -------------------------------------------------------------------- */
+/*      Queue the computation of each block of the row.                 */
+/* -------------------------------------------------------------------- */
+        int iChunk = 0;
+        for( int nDstXOff = 0; nDstXOff < nDstWidth && eErr == CE_None;
+             nDstXOff += psLevel->nDstBlockXSize, iChunk++ )
+        {
+            GDALOvrChunkSlot *psSlot =
+                psLevel->pasSlots + (iChunk % psLevel->nSlots);
+
+            /* Recycle the slot of the oldest block in flight */
+            eErr = GDALOvrStreamCompleteSlot( psCtxt, psLevel, psSlot, eErr );
+            if( eErr != CE_None )
+                break;
+
+            int nDstXCount = MIN(psLevel->nDstBlockXSize, nDstWidth - nDstXOff);
+
+            int nChunkXOff = (int) (0.5 + nDstXOff / (double)nDstWidth * nSrcWidth);
+            int nChunkXOff2 = (int) (0.5 + (nDstXOff + psLevel->nDstBlockXSize) / (double)nDstWidth * nSrcWidth);
+            if( nChunkXOff2 > nSrcWidth || nDstXOff + psLevel->nDstBlockXSize >= nDstWidth )
+                nChunkXOff2 = nSrcWidth;
+            int nXCount = nChunkXOff2 - nChunkXOff;
+
+            int nChunkXOffQueried = nChunkXOff - nKernelRadius * psLevel->nOvrFactor;
+            int nChunkXSizeQueried = nXCount + 2 * nKernelRadius * psLevel->nOvrFactor;
+            if( nChunkXOffQueried < 0 )
+            {
+                nChunkXSizeQueried += nChunkXOffQueried;
+                nChunkXOffQueried = 0;
+            }
+            if( nChunkXSizeQueried + nChunkXOffQueried > nSrcWidth )
+                nChunkXSizeQueried = nSrcWidth - nChunkXOffQueried;
+
+            for( int iBand = 0; iBand < nBands; iBand++ )
+            {
+                /* Extract the source window of the block */
+                GByte *pabySrc = ((GByte *) psSrc->papData[iBand])
+                    + ((size_t)(nChunkYOffQueried - psSrc->nYOff) * nSrcWidth
+                       + nChunkXOffQueried) * nWrkTypeSize;
+                GByte *pabyChunk = (GByte *) psSlot->papChunk[iBand];
+                for( int iLine = 0; iLine < nChunkYSizeQueried; iLine++ )
+                {
+                    memcpy( pabyChunk + (size_t)iLine * nChunkXSizeQueried * nWrkTypeSize,
+                            pabySrc + (size_t)iLine * nSrcWidth * nWrkTypeSize,
+                            (size_t)nChunkXSizeQueried * nWrkTypeSize );
+                }
+
+                GDALOvrDownsampleJob *psJob = psSlot->pasJobs + iBand;
+
+                psJob->pfnDownsampleFn = psCtxt->pfnDownsampleFn;
+                psJob->nSrcWidth = nSrcWidth;
+                psJob->nSrcHeight = nSrcHeight;
+                psJob->eWrkDataType = psCtxt->eWrkDataType;
+                psJob->pChunk = pabyChunk;
+                psJob->pabyChunkNodataMask = NULL;
+                psJob->nChunkXOff = nChunkXOffQueried;
+                psJob->nChunkXSize = nChunkXSizeQueried;
+                psJob->nChunkYOff = nChunkYOffQueried;
+                psJob->nChunkYSize = nChunkYSizeQueried;
+                psJob->nDstXOff = nDstXOff;
+                psJob->nDstXOff2 = nDstXOff + nDstXCount;
+                psJob->nDstYOff = nDstYOff;
+                psJob->nDstYOff2 = nDstYOff + nDstYCount;
+                psJob->poOverview = psLevel->papoOvrBands[iBand];
+                psJob->pszResampling = psCtxt->pszResampling;
+                psJob->bHasNoData = psCtxt->pabHasNoData[iBand];
+                psJob->fNoDataValue = psCtxt->pafNoDataValue[iBand];
+                psJob->poColorTable = NULL;
+                psJob->eSrcDataType = psCtxt->eDataType;
+                psJob->pDstBuffer = psSlot->papDstBuffers[iBand];
+                psJob->eErr = CE_None;
+
+                if( psCtxt->nThreads > 1 )
+                    CPLSubmitJob( psSlot->psJobGroup, GDALOvrDownsampleJobRun, psJob );
+                else
+                    GDALOvrDownsampleJobRun( psJob );
+            }
+            psSlot->bInUse = TRUE;
+        }
+
+        /* The whole row must be done before the next level can use it */
+        for( int i = 0; i < psLevel->nSlots; i++ )
+            eErr = GDALOvrStreamCompleteSlot(
+                psCtxt, psLevel,
+                psLevel->pasSlots + ((iChunk + i) % psLevel->nSlots), eErr );
+        if( eErr != CE_None )
+            break;
+
+        if( psDst != NULL )
+            psDst->nLines += nDstYCount;
+        psLevel->nNextDstYOff += psLevel->nDstBlockYSize;
+
+        if( iLevel + 1 < psCtxt->nLevels )
+            eErr = GDALOvrStreamComputeLevel( psCtxt, iLevel + 1 );
+    }
+
+    return eErr;
+}
+
+/************************************************************************/
+/*               GDALRegenerateOverviewsMultiBandStreamed()             */
+/*                                                                      */
+/*      Compute all the overview levels in a single pass over the       */
+/*      source bands, each level being computed from the in-memory      */
+/*      lines of the previous one.  The source is read once, by rows    */
+/*      of blocks, and the overviews are never read back.               */
+/************************************************************************/
+
+static CPLErr
+GDALRegenerateOverviewsMultiBandStreamed(
+    int nBands, GDALRasterBand **papoSrcBands,
+    int nOverviews, GDALRasterBand ***papapoOverviewBands,
+    const char *pszResampling, GDALDownsampleFunction pfnDownsampleFn,
+    GDALDataType eWrkDataType, GDALDataType eDataType,
+    int nKernelRadius,
+    const int *pabHasNoData, const float *pafNoDataValue,
+    int nThreads,
+    GDALProgressFunc pfnProgress, void *pProgressData )
+{
+    int nWrkTypeSize = GDALGetDataTypeSize(eWrkDataType) / 8;
+    int nSrcWidth = papoSrcBands[0]->GetXSize();
+    int nSrcHeight = papoSrcBands[0]->GetYSize();
+    int iLevel, iBand;
+    CPLErr eErr = CE_None;
+
+    GDALOvrStreamContext sCtxt;
+    sCtxt.nBands = nBands;
+    sCtxt.nLevels = nOverviews;
+    sCtxt.pfnDownsampleFn = pfnDownsampleFn;
+    sCtxt.pszResampling = pszResampling;
+    sCtxt.eWrkDataType = eWrkDataType;
+    sCtxt.eDataType = eDataType;
+    sCtxt.nKernelRadius = nKernelRadius;
+    sCtxt.pabHasNoData = pabHasNoData;
+    sCtxt.pafNoDataValue = pafNoDataValue;
+    sCtxt.nThreads = nThreads;
+    sCtxt.pasLevels = (GDALOvrStreamLevel *)
+        CPLCalloc( sizeof(GDALOvrStreamLevel), nOverviews );
+
+    /* Buffer 0 holds source lines, buffer i the lines of overview i-1 */
+    GDALOvrStreamBuffer *pasBuffers = (GDALOvrStreamBuffer *)
+        CPLCalloc( sizeof(GDALOvrStreamBuffer), nOverviews );
+
+/* -------------------------------------------------------------------- */
+/*      Set up the levels.                                              */
+/* -------------------------------------------------------------------- */
+    for( iLevel = 0; iLevel < nOverviews; iLevel++ )
+    {
+        GDALOvrStreamLevel *psLevel = sCtxt.pasLevels + iLevel;
+        GDALOvrStreamBuffer *psSrc = pasBuffers + iLevel;
+
+        psLevel->papoOvrBands = (GDALRasterBand **)
+            CPLMalloc( sizeof(GDALRasterBand*) * nBands );
+        for( iBand = 0; iBand < nBands; iBand++ )
+            psLevel->papoOvrBands[iBand] = papapoOverviewBands[iBand][iLevel];
+
+        if( iLevel == 0 )
+        {
+            psSrc->nXSize = nSrcWidth;
+            psSrc->nYSize = nSrcHeight;
+        }
+        else
+        {
+            psSrc->nXSize = papapoOverviewBands[0][iLevel-1]->GetXSize();
+            psSrc->nYSize = papapoOverviewBands[0][iLevel-1]->GetYSize();
+            sCtxt.pasLevels[iLevel-1].psDst = psSrc;
+        }
+        psLevel->psSrc = psSrc;
+
+        int nDstWidth = psLevel->papoOvrBands[0]->GetXSize();
+        int nDstHeight = psLevel->papoOvrBands[0]->GetYSize();
+        psLevel->papoOvrBands[0]->GetBlockSize( &psLevel->nDstBlockXSize,
+                                                &psLevel->nDstBlockYSize );
+
+        int nFullResXChunk = 1 + (int)(((double)psLevel->nDstBlockXSize * psSrc->nXSize) / nDstWidth);
+        int nFullResYChunk = 1 + (int)(((double)psLevel->nDstBlockYSize * psSrc->nYSize) / nDstHeight);
+        psLevel->nOvrFactor = MAX( (int)(0.5 + (double)psSrc->nXSize / nDstWidth),
+                                   (int)(0.5 + (double)psSrc->nYSize / nDstHeight) );
+        psLevel->nFullResXChunkQueried = nFullResXChunk + 2 * nKernelRadius * psLevel->nOvrFactor;
+        psLevel->nFullResYChunkQueried = nFullResYChunk + 2 * nKernelRadius * psLevel->nOvrFactor;
+
+        psLevel->nSlots = ( nThreads > 1 ) ? nThreads + 1 : 1;
+        size_t *panDstBytes = (size_t *) CPLMalloc( sizeof(size_t) * nBands );
+        for( iBand = 0; iBand < nBands; iBand++ )
+            panDstBytes[iBand] = (size_t) psLevel->nDstBlockXSize
+                * psLevel->nDstBlockYSize * (GDALGetDataTypeSize(eDataType) / 8);
+        psLevel->pasSlots = GDALOvrAllocChunkSlots(
+            psLevel->nSlots, nBands,
+            (size_t) psLevel->nFullResXChunkQueried
+                * psLevel->nFullResYChunkQueried * nWrkTypeSize,
+            0, nBands, panDstBytes );
+        CPLFree( panDstBytes );
+        if( psLevel->pasSlots == NULL )
+            eErr = CE_Failure;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      The source is read by rows of its blocks.  Each buffer must     */
+/*      hold the lines a block row of its level needs, plus the lines   */
+/*      appended at once.                                               */
+/* -------------------------------------------------------------------- */
+    int nSrcBlockXSize, nSrcBlockYSize;
+    papoSrcBands[0]->GetBlockSize( &nSrcBlockXSize, &nSrcBlockYSize );
+    GDALOvrStreamLevel *psFirstLevel = sCtxt.pasLevels;
+    int nFullResYChunk0 = psFirstLevel->nFullResYChunkQueried
+                          - 2 * nKernelRadius * psFirstLevel->nOvrFactor;
+    int nSrcLines = DIV_ROUND_UP(nFullResYChunk0, nSrcBlockYSize) * nSrcBlockYSize;
+    nSrcLines = MIN(nSrcLines, nSrcHeight);
+
+    for( iLevel = 0; iLevel < nOverviews && eErr == CE_None; iLevel++ )
+    {
+        GDALOvrStreamBuffer *psBuf = pasBuffers + iLevel;
+
+        psBuf->nMaxLines = sCtxt.pasLevels[iLevel].nFullResYChunkQueried
+            + ( iLevel == 0 ? nSrcLines
+                            : sCtxt.pasLevels[iLevel-1].nDstBlockYSize );
+        psBuf->nMaxLines = MIN(psBuf->nMaxLines, psBuf->nYSize);
+        psBuf->papData = (void **) CPLCalloc( sizeof(void*), nBands );
+        for( iBand = 0; iBand < nBands && eErr == CE_None; iBand++ )
+        {
+            psBuf->papData[iBand] = VSIMalloc3( psBuf->nXSize, psBuf->nMaxLines,
+                                                nWrkTypeSize );
+            if( psBuf->papData[iBand] == NULL )
+            {
+                CPLError( CE_Failure, CPLE_OutOfMemory,
+                          "GDALRegenerateOverviewsMultiBand: Out of memory." );
+                eErr = CE_Failure;
+            }
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Read the source, and compute after each read all the blocks     */
+/*      rows of all the levels that can be.                             */
+/* -------------------------------------------------------------------- */
+    GDALOvrStreamBuffer *psSrcBuf = pasBuffers;
+
+    while( eErr == CE_None )
+    {
+        eErr = GDALOvrStreamComputeLevel( &sCtxt, 0 );
+        if( eErr != CE_None )
+            break;
+
+        int nSrcYOff = psSrcBuf->nYOff + psSrcBuf->nLines;
+        if( nSrcYOff >= nSrcHeight )
+            break;
+
+        if( !pfnProgress( nSrcYOff / (double) nSrcHeight,
+                          NULL, pProgressData ) )
+        {
+            CPLError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+            eErr = CE_Failure;
+            break;
+        }
+
+        int nYOffQueried, nYSizeQueried;
+        GDALOvrStreamGetSrcWindow( psFirstLevel, nKernelRadius,
+                                   psFirstLevel->nNextDstYOff,
+                                   &nYOffQueried, &nYSizeQueried );
+        GDALOvrStreamBufferDiscard( psSrcBuf, nYOffQueried, nBands,
+                                    nWrkTypeSize );
+        if( psSrcBuf->nLines == 0 )
+            psSrcBuf->nYOff = nSrcYOff;
+
+        int nYCount = MIN(nSrcLines, nSrcHeight - nSrcYOff);
+        if( psSrcBuf->nLines + nYCount > psSrcBuf->nMaxLines )
+        {
+            CPLError( CE_Failure, CPLE_AppDefined,
+                      "GDALRegenerateOverviewsMultiBand: inconsistent line "
+                      "buffer state." );
+            eErr = CE_Failure;
+            break;
+        }
+
+        for( iBand = 0; iBand < nBands && eErr == CE_None; iBand++ )
+        {
+            eErr = papoSrcBands[iBand]->RasterIO( GF_Read,
+                0, nSrcYOff, nSrcWidth, nYCount,
+                ((GByte *) psSrcBuf->papData[iBand])
+                    + (size_t) psSrcBuf->nLines * nSrcWidth * nWrkTypeSize,
+                nSrcWidth, nYCount, eWrkDataType, 0, 0 );
+        }
+        psSrcBuf->nLines += nYCount;
+    }
+
 /* -------------------------------------------------------------------- */
-/*      Renormalized overview mean / stddev if needed.                  */
+/*      Cleanup.                                                        */
 /* -------------------------------------------------------------------- */
-    if( eErr == CE_None && EQUAL(pszResampling,"AVERAGE_MP") )
+    for( iLevel = 0; iLevel < nOverviews; iLevel++ )
     {
-        GDALOverviewMagnitudeCorrection( (GDALRasterBandH) poSrcBand, 
-                                         nOverviewCount, 
-                                         (GDALRasterBandH *) papoOvrBands,
-                                         GDALDummyProgress, NULL );
-    }
+        GDALOvrStreamLevel *psLevel = sCtxt.pasLevels + iLevel;
+        GDALOvrStreamBuffer *psBuf = pasBuffers + iLevel;
 
-/* -------------------------------------------------------------------- */
-/*      It can be important to flush out data to overviews.             */
-/* -------------------------------------------------------------------- */
-    for( int iOverview = 0; 
-         eErr == CE_None && iOverview < nOverviewCount; 
-         iOverview++ )
-    {
-        eErr = papoOvrBands[iOverview]->FlushCache();
-    }
+        if( psLevel->papoOvrBands != NULL )
+        {
+            for( iBand = 0; iBand < nBands; iBand++ )
+                psLevel->papoOvrBands[iBand]->FlushCache();
+            CPLFree( psLevel->papoOvrBands );
+        }
+        GDALOvrFreeChunkSlots( psLevel->pasSlots, psLevel->nSlots, nBands );
 
-    if (eErr == CE_None)
-        pfnProgress( 1.0, NULL, pProgressData );
+        if( psBuf->papData != NULL )
+        {
+            for( iBand = 0; iBand < nBands; iBand++ )
+                VSIFree( psBuf->papData[iBand] );
+            CPLFree( psBuf->papData );
+        }
+    }
+    CPLFree( sCtxt.pasLevels );
+    CPLFree( pasBuffers );
 
     return eErr;
 }
 
-
-
 /************************************************************************/
 /*            GDALRegenerateOverviewsMultiBand()                        */
 /************************************************************************/
@@ -2000,6 +3153,13 @@ GDALRegenerateOverviews( GDALRasterBandH hSrcBand,
  *               read the source data of size deltax * deltay for all the bands
  *               generate the corresponding overview block for all the bands
  *
+ * When there are several overviews, each one smaller than the previous one,
+ * and no mask is involved, they are instead all computed in a single pass
+ * over the source, read by rows of blocks: each overview is computed from the
+ * lines of the previous one kept in memory, rather than read back from the
+ * overview band. The GDAL_OVR_SINGLE_PASS configuration option can be set to
+ * NO to disable this.
+ *
  * This function will honour properly NODATA_VALUES tuples (special dataset metadata) so
  * that only a given RGB triplet (in case of a RGB image) will be considered as the
  * nodata value and not each value of the triplet independantly per band.
@@ -2131,6 +3291,41 @@ GDALRegenerateOverviewsMultiBand(int nBands, GDALRasterBand** papoSrcBands,
         pafNoDataValue[iBand] = (float) papoSrcBands[iBand]->GetNoDataValue(&pabHasNoData[iBand]);
     }
 
+    int nThreads = GDALGetOverviewThreadCount();
+    if( nThreads > 1 )
+        CPLDebug( "GDAL", "Computing overviews with %d threads.", nThreads );
+
+    /* When each level can be computed from the previous one, compute them */
+    /* all in a single pass over the source. Masks are not handled there. */
+    int bSinglePass = nOverviews > 1 && !bUseNoDataMask &&
+        CSLTestBoolean(CPLGetConfigOption("GDAL_OVR_SINGLE_PASS", "YES"));
+    for(iOverview=1;iOverview<nOverviews && bSinglePass;iOverview++)
+    {
+        if( papapoOverviewBands[0][iOverview]->GetXSize() >=
+                papapoOverviewBands[0][iOverview-1]->GetXSize() ||
+            papapoOverviewBands[0][iOverview]->GetYSize() >
+                papapoOverviewBands[0][iOverview-1]->GetYSize() )
+            bSinglePass = FALSE;
+    }
+    if( bSinglePass )
+    {
+        CPLDebug( "GDAL", "Computing %d overview levels in a single pass.",
+                  nOverviews );
+        eErr = GDALRegenerateOverviewsMultiBandStreamed(
+            nBands, papoSrcBands, nOverviews, papapoOverviewBands,
+            pszResampling, pfnDownsampleFn, eWrkDataType, eDataType,
+            nKernelRadius, pabHasNoData, pafNoDataValue, nThreads,
+            pfnProgress, pProgressData );
+
+        CPLFree(pabHasNoData);
+        CPLFree(pafNoDataValue);
+
+        if (eErr == CE_None)
+            pfnProgress( 1.0, NULL, pProgressData );
+
+        return eErr;
+    }
+
     /* Second pass to do the real job ! */
     double dfCurPixelCount = 0;
     for(iOverview=0;iOverview<nOverviews && eErr == CE_None;iOverview++)
@@ -2162,6 +3357,39 @@ GDALRegenerateOverviewsMultiBand(int nBands, GDALRasterBand** papoSrcBands,
         int nFullResXChunkQueried = nFullResXChunk + 2 * nKernelRadius * nOvrFactor;
         int nFullResYChunkQueried = nFullResYChunk + 2 * nKernelRadius * nOvrFactor;
 
+        if( nThreads > 1 )
+        {
+            GDALRasterBand** papoLevelSrcBands =
+                (GDALRasterBand**) CPLMalloc(nBands * sizeof(GDALRasterBand*));
+            GDALRasterBand** papoLevelOvrBands =
+                (GDALRasterBand**) CPLMalloc(nBands * sizeof(GDALRasterBand*));
+            for(iBand=0;iBand<nBands;iBand++)
+            {
+                if (iSrcOverview == -1)
+                    papoLevelSrcBands[iBand] = papoSrcBands[iBand];
+                else
+                    papoLevelSrcBands[iBand] = papapoOverviewBands[iBand][iSrcOverview];
+                papoLevelOvrBands[iBand] = papapoOverviewBands[iBand][iOverview];
+            }
+
+            eErr = GDALRegenerateOverviewsMultiBandLevelThreaded(
+                nBands, papoLevelSrcBands, papoLevelOvrBands,
+                pszResampling, pfnDownsampleFn, eWrkDataType, eDataType,
+                bUseNoDataMask, nKernelRadius, nOvrFactor,
+                nFullResXChunkQueried, nFullResYChunkQueried,
+                pabHasNoData, pafNoDataValue, nThreads,
+                &dfCurPixelCount, dfTotalPixelCount,
+                pfnProgress, pProgressData );
+
+            /* Flush the data to overviews */
+            for(iBand=0;iBand<nBands;iBand++)
+                papoLevelOvrBands[iBand]->FlushCache();
+
+            CPLFree(papoLevelSrcBands);
+            CPLFree(papoLevelOvrBands);
+            continue;
+        }
+
         void** papaChunk = (void**) CPLMalloc(nBands * sizeof(void*));
         GByte* pabyChunkNoDataMask = NULL;
         for(iBand=0;iBand<nBands;iBand++)
@@ -2593,3 +3821,574 @@ GDALOverviewMagnitudeCorrection( GDALRasterBandH hBaseBand,
 
     return CE_None;
 }
+
+/************************************************************************/
+/* ==================================================================== */
+/*                        GDALResampleBufferBand                        */
+/*                                                                      */
+/*      Pseudo band exposing a caller buffer as the output of the       */
+/*      downsampling functions above, which write their result line     */
+/*      by line with RasterIO() on the overview band.  The pseudo band  */
+/*      may be larger than the buffer, when the requested source        */
+/*      window is not pixel aligned, in which case the buffer starts    */
+/*      at (nXShift,nYShift) in the pseudo band.                        */
+/* ==================================================================== */
+/************************************************************************/
+
+class GDALResampleBufferBand : public GDALRasterBand
+{
+    GByte       *pabyBuffer;
+    int          nXShift;
+    int          nYShift;
+    int          nBufXSize;
+    int          nBufYSize;
+    GDALDataType eBufType;
+    int          nBufPixelSpace;
+    int          nBufLineSpace;
+
+  protected:
+    virtual CPLErr IReadBlock( int, int, void * );
+    virtual CPLErr IRasterIO( GDALRWFlag, int, int, int, int,
+                              void *, int, int, GDALDataType,
+                              int, int );
+
+  public:
+                 GDALResampleBufferBand( int nVirtXSize, int nVirtYSize,
+                                         int nXShiftIn, int nYShiftIn,
+                                         void *pData,
+                                         int nBufXSizeIn, int nBufYSizeIn,
+                                         GDALDataType eBufTypeIn,
+                                         int nPixelSpace, int nLineSpace );
+};
+
+/************************************************************************/
+/*                       GDALResampleBufferBand()                       */
+/************************************************************************/
+
+GDALResampleBufferBand::GDALResampleBufferBand( int nVirtXSize, int nVirtYSize,
+                                                int nXShiftIn, int nYShiftIn,
+                                                void *pData,
+                                                int nBufXSizeIn,
+                                                int nBufYSizeIn,
+                                                GDALDataType eBufTypeIn,
+                                                int nPixelSpace,
+                                                int nLineSpace )
+
+{
+    nRasterXSize = nVirtXSize;
+    nRasterYSize = nVirtYSize;
+    nBlockXSize = nVirtXSize;
+    nBlockYSize = 1;
+    eDataType = eBufTypeIn;
+    eAccess = GA_Update;
+
+    pabyBuffer = (GByte *) pData;
+    nXShift = nXShiftIn;
+    nYShift = nYShiftIn;
+    nBufXSize = nBufXSizeIn;
+    nBufYSize = nBufYSizeIn;
+    eBufType = eBufTypeIn;
+    nBufPixelSpace = nPixelSpace;
+    nBufLineSpace = nLineSpace;
+}
+
+/************************************************************************/
+/*                             IReadBlock()                             */
+/************************************************************************/
+
+CPLErr GDALResampleBufferBand::IReadBlock( CPL_UNUSED int nBlockXOff,
+                                           CPL_UNUSED int nBlockYOff,
+                                           CPL_UNUSED void *pImage )
+
+{
+    CPLError( CE_Failure, CPLE_NotSupported,
+              "GDALResampleBufferBand::IReadBlock() not supported." );
+    return CE_Failure;
+}
+
+/************************************************************************/
+/*                             IRasterIO()                              */
+/************************************************************************/
+
+CPLErr GDALResampleBufferBand::IRasterIO( GDALRWFlag eRWFlag,
+                                          int nXOff, int nYOff,
+                                          int nXSize, int nYSize,
+                                          void *pData,
+                                          int nSrcBufXSize, int nSrcBufYSize,
+                                          GDALDataType eSrcType,
+                                          int nPixelSpace, int nLineSpace )
+
+{
+    if( eRWFlag != GF_Write || nSrcBufXSize != nXSize ||
+        nSrcBufYSize != nYSize )
+    {
+        CPLError( CE_Failure, CPLE_NotSupported,
+                  "GDALResampleBufferBand::IRasterIO() only supports "
+                  "unscaled writing." );
+        return CE_Failure;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Clip the written region to the part covered by the buffer.      */
+/* -------------------------------------------------------------------- */
+    int nSrcXStart = MAX(0, nXShift - nXOff);
+    int nSrcXEnd = MIN(nXSize, nXShift + nBufXSize - nXOff);
+
+    if( nSrcXEnd <= nSrcXStart )
+        return CE_None;
+
+    for( int iLine = 0; iLine < nYSize; iLine++ )
+    {
+        int iBufLine = nYOff + iLine - nYShift;
+        if( iBufLine < 0 || iBufLine >= nBufYSize )
+            continue;
+
+        GDALCopyWords( ((GByte *) pData) + (size_t)iLine * nLineSpace
+                           + (size_t)nSrcXStart * nPixelSpace,
+                       eSrcType, nPixelSpace,
+                       pabyBuffer + (size_t)iBufLine * nBufLineSpace
+                           + (size_t)(nXOff + nSrcXStart - nXShift)
+                               * nBufPixelSpace,
+                       eBufType, nBufPixelSpace,
+                       nSrcXEnd - nSrcXStart );
+    }
+
+    return CE_None;
+}
+
+/************************************************************************/
+/*                      GDALOvrDownsampleJobRun()                       */
+/*                                                                      */
+/*      Job of the multi-threaded overview computation: downsample      */
+/*      one chunk into the output buffer of the job.                    */
+/************************************************************************/
+
+static void GDALOvrDownsampleJobRun( void *pData )
+{
+    GDALOvrDownsampleJob *psJob = (GDALOvrDownsampleJob *) pData;
+    GDALDataType eOvrType = psJob->poOverview->GetRasterDataType();
+    int nOvrTypeSize = GDALGetDataTypeSize(eOvrType) / 8;
+    int nDstXSize = psJob->nDstXOff2 - psJob->nDstXOff;
+
+    GDALResampleBufferBand oDstBand( psJob->poOverview->GetXSize(),
+                                     psJob->poOverview->GetYSize(),
+                                     psJob->nDstXOff, psJob->nDstYOff,
+                                     psJob->pDstBuffer,
+                                     nDstXSize,
+                                     psJob->nDstYOff2 - psJob->nDstYOff,
+                                     eOvrType, nOvrTypeSize,
+                                     nOvrTypeSize * nDstXSize );
+
+    if( psJob->pfnDownsampleFn != NULL )
+        psJob->eErr = psJob->pfnDownsampleFn(
+            psJob->nSrcWidth, psJob->nSrcHeight, psJob->eWrkDataType,
+            psJob->pChunk, psJob->pabyChunkNodataMask,
+            psJob->nChunkXOff, psJob->nChunkXSize,
+            psJob->nChunkYOff, psJob->nChunkYSize,
+            psJob->nDstXOff, psJob->nDstXOff2,
+            psJob->nDstYOff, psJob->nDstYOff2,
+            &oDstBand, psJob->pszResampling,
+            psJob->bHasNoData, psJob->fNoDataValue, psJob->poColorTable,
+            psJob->eSrcDataType );
+    else
+        psJob->eErr = GDALDownsampleChunkC32R(
+            psJob->nSrcWidth, psJob->nSrcHeight, (float *) psJob->pChunk,
+            psJob->nChunkYOff, psJob->nChunkYSize,
+            psJob->nDstYOff, psJob->nDstYOff2,
+            &oDstBand, psJob->pszResampling );
+}
+
+/************************************************************************/
+/*                     GDALComputeResampledAxis()                       */
+/*                                                                      */
+/*      Compute, for one axis, the pixel aligned source window          */
+/*      enclosing the requested (possibly fractional) window, and the   */
+/*      geometry of the pseudo output band covering that window at      */
+/*      the requested resolution.                                       */
+/************************************************************************/
+
+static void GDALComputeResampledAxis( double dfOff, double dfSize,
+                                      int nRasterSize, int nBufSize,
+                                      int *pnWinOff, int *pnWinSize,
+                                      int *pnVirtSize, int *pnShift )
+
+{
+    int nWinOff = (int) floor( dfOff + 1e-10 );
+    int nWinEnd = (int) ceil( dfOff + dfSize - 1e-10 );
+
+    nWinOff = MAX(0, nWinOff);
+    nWinEnd = MIN(nRasterSize, MAX(nWinOff + 1, nWinEnd));
+
+    double dfScale = nBufSize / dfSize;
+    int nShift = (int) (0.5 + (dfOff - nWinOff) * dfScale);
+    int nVirtSize = (int) (0.5 + (nWinEnd - nWinOff) * dfScale);
+
+    if( nVirtSize < nShift + nBufSize )
+        nVirtSize = nShift + nBufSize;
+
+    *pnWinOff = nWinOff;
+    *pnWinSize = nWinEnd - nWinOff;
+    *pnVirtSize = nVirtSize;
+    *pnShift = nShift;
+}
+
+/************************************************************************/
+/*                         RasterIOResampled()                          */
+/************************************************************************/
+
+/**
+ * \brief Read a region of image data with a resampling kernel.
+ *
+ * This method is similar to RasterIO() in read mode, except that when the
+ * buffer is smaller than the source window, the pixels are computed with
+ * one of the resampling algorithms of GDALRegenerateOverviews() instead of
+ * nearest neighbour decimation. The source window is processed in
+ * horizontal swaths, so that the full resolution window never needs to
+ * be held in memory. The window may have fractional offsets and sizes.
+ *
+ * Nodata values and mask bands are taken into account in the same way as
+ * when computing overviews.
+ *
+ * Requests upsampling on either axis, complex data types and the NEAREST
+ * method are serviced with nearest neighbour sampling of the window
+ * rounded to whole pixels.
+ *
+ * This method is the same as the C function GDALRasterIOResampled().
+ *
+ * The generic RasterIO() implementation also uses this method for
+ * downsampling reads when the GDAL_RASTERIO_RESAMPLING configuration option
+ * is set to a method other than NEAREST.
+ *
+ * @param dfXOff the pixel offset to the top left corner of the region
+ * of the band to be accessed.
+ * @param dfYOff the line offset to the top left corner of the region
+ * of the band to be accessed.
+ * @param dfXSize the width of the region of the band to be accessed in pixels.
+ * @param dfYSize the height of the region of the band to be accessed in lines.
+ * @param pData the buffer into which the data should be read.
+ * @param nBufXSize the width of the buffer image.
+ * @param nBufYSize the height of the buffer image.
+ * @param eBufType the type of the pixel values in the pData data buffer.
+ * @param nPixelSpace the byte offset from the start of one pixel value in
+ * pData to the start of the next pixel value within a scanline. If defaulted
+ * (0) the size of the datatype eBufType is used.
+ * @param nLineSpace the byte offset from the start of one scanline in
+ * pData to the start of the next. If defaulted (0) the size of the datatype
+ * eBufType * nBufXSize is used.
+ * @param pszResampling Resampling algorithm ("NEAREST", "AVERAGE", "GAUSS",
+ * "CUBIC", "MODE" or "AVERAGE_BIT2GRAYSCALE").
+ * @param pfnProgress progress report function, or NULL.
+ * @param pProgressData progress function callback data.
+ *
+ * @return CE_None on success or CE_Failure on failure.
+ *
+ * @since GDAL 2.0
+ */
+
+CPLErr GDALRasterBand::RasterIOResampled( double dfXOff, double dfYOff,
+                                          double dfXSize, double dfYSize,
+                                          void *pData,
+                                          int nBufXSize, int nBufYSize,
+                                          GDALDataType eBufType,
+                                          int nPixelSpace, int nLineSpace,
+                                          const char *pszResampling,
+                                          GDALProgressFunc pfnProgress,
+                                          void *pProgressData )
+
+{
+    if( pfnProgress == NULL )
+        pfnProgress = GDALDummyProgress;
+
+    if( pszResampling == NULL )
+        pszResampling = "NEAREST";
+
+    if( NULL == pData )
+    {
+        ReportError( CE_Failure, CPLE_AppDefined,
+                  "The buffer into which the data should be read is null" );
+        return CE_Failure;
+    }
+
+    if( dfXSize <= 0 || dfYSize <= 0 || nBufXSize < 1 || nBufYSize < 1 )
+    {
+        CPLDebug( "GDAL", 
+                  "RasterIOResampled() skipped for odd window or buffer size." );
+        return CE_None;
+    }
+
+    if( dfXOff < 0 || dfXOff + dfXSize > nRasterXSize + 1e-10
+        || dfYOff < 0 || dfYOff + dfYSize > nRasterYSize + 1e-10 )
+    {
+        ReportError( CE_Failure, CPLE_IllegalArg,
+                  "Access window out of range in RasterIOResampled().  "
+                  "Requested (%.3f,%.3f) of size %.3fx%.3f on raster of %dx%d.",
+                  dfXOff, dfYOff, dfXSize, dfYSize,
+                  nRasterXSize, nRasterYSize );
+        return CE_Failure;
+    }
+
+    if( nPixelSpace == 0 )
+        nPixelSpace = GDALGetDataTypeSize( eBufType ) / 8;
+    if( nLineSpace == 0 )
+    {
+        if (nPixelSpace > INT_MAX / nBufXSize)
+        {
+            ReportError( CE_Failure, CPLE_AppDefined,
+                      "Int overflow : %d x %d", nPixelSpace, nBufXSize );
+            return CE_Failure;
+        }
+        nLineSpace = nPixelSpace * nBufXSize;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Compute the pixel aligned source window and the geometry of     */
+/*      the pseudo output band.                                         */
+/* -------------------------------------------------------------------- */
+    int nWinXOff, nWinXSize, nVirtXSize, nXShift;
+    int nWinYOff, nWinYSize, nVirtYSize, nYShift;
+
+    GDALComputeResampledAxis( dfXOff, dfXSize, nRasterXSize, nBufXSize,
+                              &nWinXOff, &nWinXSize, &nVirtXSize, &nXShift );
+    GDALComputeResampledAxis( dfYOff, dfYSize, nRasterYSize, nBufYSize,
+                              &nWinYOff, &nWinYSize, &nVirtYSize, &nYShift );
+
+/* -------------------------------------------------------------------- */
+/*      Reject unknown methods, even when they would not be used.       */
+/* -------------------------------------------------------------------- */
+    CPLPushErrorHandler( CPLQuietErrorHandler );
+    GDALDownsampleFunction pfnDownsampleFn =
+        GDALGetDownsampleFunction(pszResampling);
+    CPLPopErrorHandler();
+
+    if( pfnDownsampleFn == NULL )
+    {
+        ReportError( CE_Failure, CPLE_NotSupported,
+                     "Unsupported resampling method '%s' in "
+                     "RasterIOResampled().", pszResampling );
+        return CE_Failure;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Cases the downsampling functions don't handle are serviced by   */
+/*      a regular (nearest neighbour) RasterIO().  The generic          */
+/*      IRasterIO() must then not come back here, whatever the          */
+/*      GDAL_RASTERIO_RESAMPLING configuration option.                  */
+/* -------------------------------------------------------------------- */
+    if( EQUALN(pszResampling,"NEAR",4)
+        || nBufXSize > dfXSize || nBufYSize > dfYSize
+        || GDALDataTypeIsComplex( eDataType ) )
+    {
+        int nNearXOff = MIN( (int) (dfXOff + 0.5), nRasterXSize - 1 );
+        int nNearYOff = MIN( (int) (dfYOff + 0.5), nRasterYSize - 1 );
+        int nNearXSize = MAX( 1, MIN( (int) (dfXSize + 0.5),
+                                      nRasterXSize - nNearXOff ) );
+        int nNearYSize = MAX( 1, MIN( (int) (dfYSize + 0.5),
+                                      nRasterYSize - nNearYOff ) );
+
+        const int bWasInResampledRasterIO = bInResampledRasterIO;
+        bInResampledRasterIO = TRUE;
+
+        CPLErr eErr = RasterIO( GF_Read,
+                                nNearXOff, nNearYOff, nNearXSize, nNearYSize,
+                                pData, nBufXSize, nBufYSize, eBufType,
+                                nPixelSpace, nLineSpace );
+
+        bInResampledRasterIO = bWasInResampledRasterIO;
+        if( eErr == CE_None )
+            pfnProgress( 1.0, NULL, pProgressData );
+        return eErr;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Color table and mask handling, as in GDALRegenerateOverviews(). */
+/* -------------------------------------------------------------------- */
+    GDALColorTable* poColorTable = NULL;
+
+    if( (EQUALN(pszResampling,"AVER",4)
+         || EQUALN(pszResampling,"MODE",4)
+         || EQUALN(pszResampling,"GAUSS",5)) &&
+        GetColorInterpretation() == GCI_PaletteIndex )
+    {
+        poColorTable = GetColorTable();
+        if( poColorTable != NULL &&
+            poColorTable->GetPaletteInterpretation() != GPI_RGB )
+            poColorTable = NULL;
+    }
+
+    GDALRasterBand* poMaskBand = NULL;
+    int nMaskFlags;
+
+    if( GetColorInterpretation() == GCI_AlphaBand )
+    {
+        poMaskBand = this;
+        nMaskFlags = GMF_ALPHA | GMF_PER_DATASET;
+    }
+    else
+    {
+        poMaskBand = GetMaskBand();
+        nMaskFlags = GetMaskFlags();
+    }
+
+    int bUseNoDataMask = ((nMaskFlags & GMF_ALL_VALID) == 0);
+
+    int bHasNoData;
+    float fNoDataValue = (float) GetNoDataValue(&bHasNoData);
+
+    int nKernelRadius = 0;
+    if( EQUAL(pszResampling,"CUBIC") )
+        nKernelRadius = 2;
+
+/* -------------------------------------------------------------------- */
+/*      Allocate one horizontal swath of the source window.             */
+/* -------------------------------------------------------------------- */
+    int nFRXBlockSize, nFRYBlockSize, nFullResYChunk;
+
+    GetBlockSize( &nFRXBlockSize, &nFRYBlockSize );
+    if( nFRYBlockSize < 16 || nFRYBlockSize > 256 )
+        nFullResYChunk = 64;
+    else
+        nFullResYChunk = nFRYBlockSize;
+
+    GDALDataType eWrkType = GDALGetOvrWorkDataType(pszResampling, eDataType);
+
+    int nMaxOvrFactor = MAX( (int)((double)nWinXSize / nVirtXSize + 0.5),
+                             (int)((double)nWinYSize / nVirtYSize + 0.5) );
+    int nMaxChunkYSizeQueried =
+        nFullResYChunk + 2 * nKernelRadius * nMaxOvrFactor;
+
+    void *pChunk = VSIMalloc3( (GDALGetDataTypeSize(eWrkType)/8),
+                               nMaxChunkYSizeQueried, nWinXSize );
+    GByte *pabyChunkNodataMask = NULL;
+    if( bUseNoDataMask )
+        pabyChunkNodataMask = (GByte *)
+            VSIMalloc2( nMaxChunkYSizeQueried, nWinXSize );
+
+    if( pChunk == NULL || (bUseNoDataMask && pabyChunkNodataMask == NULL) )
+    {
+        CPLFree(pChunk);
+        CPLFree(pabyChunkNodataMask);
+        ReportError( CE_Failure, CPLE_OutOfMemory, 
+                  "Out of memory in RasterIOResampled()." );
+        return CE_Failure;
+    }
+
+    GDALResampleBufferBand oBufferBand( nVirtXSize, nVirtYSize,
+                                        nXShift, nYShift,
+                                        pData, nBufXSize, nBufYSize, eBufType,
+                                        nPixelSpace, nLineSpace );
+
+/* -------------------------------------------------------------------- */
+/*      Loop over the source window operating on swaths.  The           */
+/*      coordinates passed to the downsampling function are relative    */
+/*      to the source window.                                           */
+/* -------------------------------------------------------------------- */
+    CPLErr eErr = CE_None;
+
+    for( int nChunkYOff = 0; 
+         nChunkYOff < nWinYSize && eErr == CE_None; 
+         nChunkYOff += nFullResYChunk )
+    {
+        if( !pfnProgress( nChunkYOff / (double) nWinYSize, 
+                          NULL, pProgressData ) )
+        {
+            ReportError( CE_Failure, CPLE_UserInterrupt, "User terminated" );
+            eErr = CE_Failure;
+            break;
+        }
+
+        int nChunkYSize = MIN(nFullResYChunk, nWinYSize - nChunkYOff);
+
+        int nDstYOff = (int) (0.5 + (nChunkYOff/(double)nWinYSize) * nVirtYSize);
+        int nDstYOff2 = (int)
+            (0.5 + ((nChunkYOff+nChunkYSize)/(double)nWinYSize) * nVirtYSize);
+        if( nChunkYOff + nChunkYSize == nWinYSize )
+            nDstYOff2 = nVirtYSize;
+
+        /* Skip swaths that only contribute to lines outside the buffer */
+        nDstYOff = MAX(nDstYOff, nYShift);
+        nDstYOff2 = MIN(nDstYOff2, nYShift + nBufYSize);
+        if( nDstYOff2 <= nDstYOff )
+            continue;
+
+        int nChunkYOffQueried = nChunkYOff - nKernelRadius * nMaxOvrFactor;
+        int nChunkYSizeQueried = nChunkYSize + 2 * nKernelRadius * nMaxOvrFactor;
+        if( nChunkYOffQueried < 0 )
+        {
+            nChunkYSizeQueried += nChunkYOffQueried;
+            nChunkYOffQueried = 0;
+        }
+        if( nChunkYOffQueried + nChunkYSizeQueried > nWinYSize )
+            nChunkYSizeQueried = nWinYSize - nChunkYOffQueried;
+
+        eErr = RasterIO( GF_Read, nWinXOff, nWinYOff + nChunkYOffQueried,
+                         nWinXSize, nChunkYSizeQueried,
+                         pChunk, nWinXSize, nChunkYSizeQueried, eWrkType,
+                         0, 0 );
+        if( eErr == CE_None && bUseNoDataMask )
+            eErr = poMaskBand->RasterIO( GF_Read, nWinXOff,
+                                         nWinYOff + nChunkYOffQueried,
+                                         nWinXSize, nChunkYSizeQueried,
+                                         pabyChunkNodataMask,
+                                         nWinXSize, nChunkYSizeQueried,
+                                         GDT_Byte, 0, 0 );
+        if( eErr != CE_None )
+            break;
+
+        GDALPromoteBit2Grayscale( pszResampling, eWrkType, pChunk,
+                                  nChunkYSizeQueried * nWinXSize );
+
+        eErr = pfnDownsampleFn( nWinXSize, nWinYSize,
+                                eWrkType,
+                                pChunk,
+                                pabyChunkNodataMask,
+                                0, nWinXSize,
+                                nChunkYOffQueried, nChunkYSizeQueried,
+                                nXShift, nXShift + nBufXSize,
+                                nDstYOff, nDstYOff2,
+                                &oBufferBand, pszResampling,
+                                bHasNoData, fNoDataValue, poColorTable,
+                                eDataType );
+    }
+
+    VSIFree( pChunk );
+    VSIFree( pabyChunkNodataMask );
+
+    if( eErr == CE_None )
+        pfnProgress( 1.0, NULL, pProgressData );
+
+    return eErr;
+}
+
+/************************************************************************/
+/*                       GDALRasterIOResampled()                        */
+/************************************************************************/
+
+/**
+ * \brief Read a region of image data with a resampling kernel.
+ *
+ * @see GDALRasterBand::RasterIOResampled()
+ *
+ * @since GDAL 2.0
+ */
+
+CPLErr CPL_STDCALL
+GDALRasterIOResampled( GDALRasterBandH hBand,
+                       double dfXOff, double dfYOff,
+                       double dfXSize, double dfYSize,
+                       void *pData, int nBufXSize, int nBufYSize,
+                       GDALDataType eBufType,
+                       int nPixelSpace, int nLineSpace,
+                       const char *pszResampling,
+                       GDALProgressFunc pfnProgress, void *pProgressData )
+
+{
+    VALIDATE_POINTER1( hBand, "GDALRasterIOResampled", CE_Failure );
+
+    GDALRasterBand *poBand = static_cast<GDALRasterBand*>(hBand);
+
+    return poBand->RasterIOResampled( dfXOff, dfYOff, dfXSize, dfYSize,
+                                      pData, nBufXSize, nBufYSize, eBufType,
+                                      nPixelSpace, nLineSpace,
+                                      pszResampling,
+                                      pfnProgress, pProgressData );
+}
@@ -30,6 +30,7 @@
  ****************************************************************************/
 
 #include "gdal_priv.h"
+#include "cpl_multiproc.h"
 
 // Define a list of "C++" compilers that have broken template support or
 // broken scoping so we can fall back on the legacy implementation of
@@ -205,6 +206,25 @@ CPLErr GDALRasterBand::IRasterIO( GDALRWFlag eRWFlag,
         return CE_None;
     }
 
+/* ==================================================================== */
+/*      Use a resampling kernel rather than decimation if requested.    */
+/*      Only pure downsampling of non complex data is handled by        */
+/*      RasterIOResampled(), which otherwise comes back here.           */
+/* ==================================================================== */
+    if( eRWFlag == GF_Read && !bInResampledRasterIO
+        && nBufXSize <= nXSize && nBufYSize <= nYSize
+        && (nBufXSize < nXSize || nBufYSize < nYSize)
+        && !GDALDataTypeIsComplex( eDataType ) )
+    {
+        const char* pszResampling =
+            CPLGetConfigOption("GDAL_RASTERIO_RESAMPLING", NULL);
+        if( pszResampling != NULL && !EQUALN(pszResampling, "NEAR", 4) )
+            return RasterIOResampled( nXOff, nYOff, nXSize, nYSize,
+                                      pData, nBufXSize, nBufYSize, eBufType,
+                                      nPixelSpace, nLineSpace,
+                                      pszResampling );
+    }
+
 
 /* ==================================================================== */
 /*      The second case when we don't need subsample data but likely    */
@@ -1091,6 +1111,490 @@ inline void GDALCopyWordsFromT(const T* const pSrcData, int nSrcPixelStride, boo
 } // end anonymous namespace
 #endif
 
+/* ==================================================================== */
+/*      Vectorized GDALCopyWords() kernels.                             */
+/*                                                                      */
+/*      SSE2 is always available on x86_64, so those kernels are used   */
+/*      unconditionally there.  AVX2 kernels are compiled with a        */
+/*      function level target attribute (no special compiler flag is   */
+/*      needed) and are only selected if the CPU supports them.  The    */
+/*      GDAL_COPYWORDS_SIMD configuration option (NONE, SSE2 or AVX2)   */
+/*      can be used to restrict the instruction set, e.g. to compare    */
+/*      the code paths with the gdalcopywordsbench utility.             */
+/*                                                                      */
+/*      All kernels only process packed buffers, and only a multiple    */
+/*      of their vector width: the remaining words are handled by the   */
+/*      generic code.  Rounding and clamping match CopyWord().          */
+/* ==================================================================== */
+
+#if defined(__x86_64) || defined(_M_X64)
+#define HAVE_SSE2_COPYWORDS
+#include <emmintrin.h>
+
+#if defined(__GNUC__) && !defined(__clang__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define HAVE_AVX2_COPYWORDS
+#define GDAL_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && _MSC_VER >= 1800
+#define HAVE_AVX2_COPYWORDS
+#define GDAL_AVX2_TARGET
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+#endif /* defined(__x86_64) || defined(_M_X64) */
+
+#define GDAL_COPYWORDS_SIMD_NONE    0
+#define GDAL_COPYWORDS_SIMD_SSE2    1
+#define GDAL_COPYWORDS_SIMD_AVX2    2
+
+#ifdef HAVE_SSE2_COPYWORDS
+
+/************************************************************************/
+/*                      GDALHaveRuntimeAVX2()                           */
+/************************************************************************/
+
+static int GDALHaveRuntimeAVX2()
+{
+#if defined(HAVE_AVX2_COPYWORDS) && defined(__GNUC__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#elif defined(HAVE_AVX2_COPYWORDS) && defined(_MSC_VER)
+    int anCPUInfo[4];
+
+    /* Check OSXSAVE and AVX, and that the OS saves the YMM registers */
+    __cpuid(anCPUInfo, 1);
+    if( (anCPUInfo[2] & (1 << 27)) == 0 || (anCPUInfo[2] & (1 << 28)) == 0 )
+        return FALSE;
+    if( (_xgetbv(0) & 6) != 6 )
+        return FALSE;
+
+    __cpuidex(anCPUInfo, 7, 0);
+    return (anCPUInfo[1] & (1 << 5)) != 0;
+#else
+    return FALSE;
+#endif
+}
+
+/************************************************************************/
+/*                    GDALGetCopyWordsSIMDLevel()                       */
+/************************************************************************/
+
+static int GDALGetCopyWordsSIMDLevel()
+{
+    static int nSIMDLevel = -1;
+
+    if( nSIMDLevel < 0 )
+    {
+        int nMaxLevel = GDALHaveRuntimeAVX2() ? GDAL_COPYWORDS_SIMD_AVX2
+                                              : GDAL_COPYWORDS_SIMD_SSE2;
+        int nLevel = nMaxLevel;
+        const char* pszSIMD = CPLGetConfigOption("GDAL_COPYWORDS_SIMD", NULL);
+
+        if( pszSIMD != NULL )
+        {
+            if( EQUAL(pszSIMD, "NONE") || EQUAL(pszSIMD, "NO") )
+                nLevel = GDAL_COPYWORDS_SIMD_NONE;
+            else if( EQUAL(pszSIMD, "SSE2") )
+                nLevel = GDAL_COPYWORDS_SIMD_SSE2;
+        }
+
+        nLevel = MIN(nLevel, nMaxLevel);
+        CPLDebug( "GDAL", "GDALCopyWords() uses %s kernels.",
+                  nLevel == GDAL_COPYWORDS_SIMD_AVX2 ? "AVX2" :
+                  nLevel == GDAL_COPYWORDS_SIMD_SSE2 ? "SSE2" : "scalar" );
+        nSIMDLevel = nLevel;
+    }
+
+    return nSIMDLevel;
+}
+
+/************************************************************************/
+/*                         SSE2 kernels                                 */
+/************************************************************************/
+
+static int GDALCopyByteToUInt16_SSE2( const GByte* pSrc, GUInt16* pDst,
+                                      int nWordCount )
+{
+    const __m128i xmm_zero = _mm_setzero_si128();
+    int i = 0;
+    for( ; i + 16 <= nWordCount; i += 16 )
+    {
+        __m128i xmm = _mm_loadu_si128((const __m128i*)(pSrc + i));
+        _mm_storeu_si128((__m128i*)(pDst + i),
+                         _mm_unpacklo_epi8(xmm, xmm_zero));
+        _mm_storeu_si128((__m128i*)(pDst + i + 8),
+                         _mm_unpackhi_epi8(xmm, xmm_zero));
+    }
+    return i;
+}
+
+static int GDALCopyByteToFloat32_SSE2( const GByte* pSrc, float* pDst,
+                                       int nWordCount )
+{
+    const __m128i xmm_zero = _mm_setzero_si128();
+    int i = 0;
+    for( ; i + 16 <= nWordCount; i += 16 )
+    {
+        __m128i xmm = _mm_loadu_si128((const __m128i*)(pSrc + i));
+        __m128i xmm_lo = _mm_unpacklo_epi8(xmm, xmm_zero);
+        __m128i xmm_hi = _mm_unpackhi_epi8(xmm, xmm_zero);
+        _mm_storeu_ps(pDst + i,
+            _mm_cvtepi32_ps(_mm_unpacklo_epi16(xmm_lo, xmm_zero)));
+        _mm_storeu_ps(pDst + i + 4,
+            _mm_cvtepi32_ps(_mm_unpackhi_epi16(xmm_lo, xmm_zero)));
+        _mm_storeu_ps(pDst + i + 8,
+            _mm_cvtepi32_ps(_mm_unpacklo_epi16(xmm_hi, xmm_zero)));
+        _mm_storeu_ps(pDst + i + 12,
+            _mm_cvtepi32_ps(_mm_unpackhi_epi16(xmm_hi, xmm_zero)));
+    }
+    return i;
+}
+
+static int GDALCopyUInt16ToFloat32_SSE2( const GUInt16* pSrc, float* pDst,
+                                         int nWordCount )
+{
+    const __m128i xmm_zero = _mm_setzero_si128();
+    int i = 0;
+    for( ; i + 8 <= nWordCount; i += 8 )
+    {
+        __m128i xmm = _mm_loadu_si128((const __m128i*)(pSrc + i));
+        _mm_storeu_ps(pDst + i,
+            _mm_cvtepi32_ps(_mm_unpacklo_epi16(xmm, xmm_zero)));
+        _mm_storeu_ps(pDst + i + 4,
+            _mm_cvtepi32_ps(_mm_unpackhi_epi16(xmm, xmm_zero)));
+    }
+    return i;
+}
+
+static int GDALCopyInt16ToFloat32_SSE2( const GInt16* pSrc, float* pDst,
+                                        int nWordCount )
+{
+    int i = 0;
+    for( ; i + 8 <= nWordCount; i += 8 )
+    {
+        __m128i xmm = _mm_loadu_si128((const __m128i*)(pSrc + i));
+        /* Sign extension: place the value in the high half and shift */
+        _mm_storeu_ps(pDst + i, _mm_cvtepi32_ps(
+            _mm_srai_epi32(_mm_unpacklo_epi16(xmm, xmm), 16)));
+        _mm_storeu_ps(pDst + i + 4, _mm_cvtepi32_ps(
+            _mm_srai_epi32(_mm_unpackhi_epi16(xmm, xmm), 16)));
+    }
+    return i;
+}
+
+static int GDALCopyUInt16ToByte_SSE2( const GUInt16* pSrc, GByte* pDst,
+                                      int nWordCount )
+{
+    const __m128i xmm_255 = _mm_set1_epi16(255);
+    int i = 0;
+    for( ; i + 16 <= nWordCount; i += 16 )
+    {
+        __m128i xmm0 = _mm_loadu_si128((const __m128i*)(pSrc + i));
+        __m128i xmm1 = _mm_loadu_si128((const __m128i*)(pSrc + i + 8));
+        /* min(x, 255) = x - max(x - 255, 0) with unsigned arithmetics */
+        xmm0 = _mm_sub_epi16(xmm0, _mm_subs_epu16(xmm0, xmm_255));
+        xmm1 = _mm_sub_epi16(xmm1, _mm_subs_epu16(xmm1, xmm_255));
+        _mm_storeu_si128((__m128i*)(pDst + i), _mm_packus_epi16(xmm0, xmm1));
+    }
+    return i;
+}
+
+static int GDALCopyInt16ToByte_SSE2( const GInt16* pSrc, GByte* pDst,
+                                     int nWordCount )
+{
+    int i = 0;
+    for( ; i + 16 <= nWordCount; i += 16 )
+    {
+        __m128i xmm0 = _mm_loadu_si128((const __m128i*)(pSrc + i));
+        __m128i xmm1 = _mm_loadu_si128((const __m128i*)(pSrc + i + 8));
+        _mm_storeu_si128((__m128i*)(pDst + i), _mm_packus_epi16(xmm0, xmm1));
+    }
+    return i;
+}
+
+static inline __m128i GDALRoundClampFloat32_SSE2( const float* pSrc,
+                                                  __m128 xmm_max )
+{
+    /* max() first so that NaN becomes 0 */
+    __m128 xmm = _mm_add_ps(_mm_loadu_ps(pSrc), _mm_set1_ps(0.5f));
+    xmm = _mm_min_ps(_mm_max_ps(xmm, _mm_setzero_ps()), xmm_max);
+    return _mm_cvttps_epi32(xmm);
+}
+
+static int GDALCopyFloat32ToByte_SSE2( const float* pSrc, GByte* pDst,
+                                       int nWordCount )
+{
+    const __m128 xmm_max = _mm_set1_ps(255.0f);
+    int i = 0;
+    for( ; i + 16 <= nWordCount; i += 16 )
+    {
+        __m128i xmm0 = GDALRoundClampFloat32_SSE2(pSrc + i, xmm_max);
+        __m128i xmm1 = GDALRoundClampFloat32_SSE2(pSrc + i + 4, xmm_max);
+        __m128i xmm2 = GDALRoundClampFloat32_SSE2(pSrc + i + 8, xmm_max);
+        __m128i xmm3 = GDALRoundClampFloat32_SSE2(pSrc + i + 12, xmm_max);
+        _mm_storeu_si128((__m128i*)(pDst + i),
+            _mm_packus_epi16(_mm_packs_epi32(xmm0, xmm1),
+                             _mm_packs_epi32(xmm2, xmm3)));
+    }
+    return i;
+}
+
+static int GDALCopyFloat32ToUInt16_SSE2( const float* pSrc, GUInt16* pDst,
+                                         int nWordCount )
+{
+    const __m128 xmm_max = _mm_set1_ps(65535.0f);
+    const __m128i xmm_32768_32 = _mm_set1_epi32(32768);
+    const __m128i xmm_32768_16 = _mm_set1_epi16(-32768);
+    int i = 0;
+    for( ; i + 8 <= nWordCount; i += 8 )
+    {
+        /* SSE2 has no unsigned 32 -> 16 bit pack: shift to the signed */
+        /* range, pack with signed saturation and shift back. */
+        __m128i xmm0 = _mm_sub_epi32(
+            GDALRoundClampFloat32_SSE2(pSrc + i, xmm_max), xmm_32768_32);
+        __m128i xmm1 = _mm_sub_epi32(
+            GDALRoundClampFloat32_SSE2(pSrc + i + 4, xmm_max), xmm_32768_32);
+        _mm_storeu_si128((__m128i*)(pDst + i),
+            _mm_xor_si128(_mm_packs_epi32(xmm0, xmm1), xmm_32768_16));
+    }
+    return i;
+}
+
+/* Copy one band of a pixel interleaved buffer into a packed buffer. */
+/* The last pixel is left to the generic code, as the 16 byte loads  */
+/* extend 3 bytes past it. */
+static int GDALCopyByteStride4ToByte_SSE2( const GByte* pSrc, GByte* pDst,
+                                           int nWordCount )
+{
+    const __m128i xmm_mask = _mm_set1_epi32(0xFF);
+    int i = 0;
+    for( ; i + 16 < nWordCount; i += 16 )
+    {
+        __m128i xmm0 = _mm_and_si128(xmm_mask,
+            _mm_loadu_si128((const __m128i*)(pSrc + 4 * i)));
+        __m128i xmm1 = _mm_and_si128(xmm_mask,
+            _mm_loadu_si128((const __m128i*)(pSrc + 4 * i + 16)));
+        __m128i xmm2 = _mm_and_si128(xmm_mask,
+            _mm_loadu_si128((const __m128i*)(pSrc + 4 * i + 32)));
+        __m128i xmm3 = _mm_and_si128(xmm_mask,
+            _mm_loadu_si128((const __m128i*)(pSrc + 4 * i + 48)));
+        _mm_storeu_si128((__m128i*)(pDst + i),
+            _mm_packus_epi16(_mm_packs_epi32(xmm0, xmm1),
+                             _mm_packs_epi32(xmm2, xmm3)));
+    }
+    return i;
+}
+
+#ifdef HAVE_AVX2_COPYWORDS
+
+/************************************************************************/
+/*                         AVX2 kernels                                 */
+/************************************************************************/
+
+GDAL_AVX2_TARGET
+static int GDALCopyByteToUInt16_AVX2( const GByte* pSrc, GUInt16* pDst,
+                                      int nWordCount )
+{
+    int i = 0;
+    for( ; i + 16 <= nWordCount; i += 16 )
+    {
+        __m128i xmm = _mm_loadu_si128((const __m128i*)(pSrc + i));
+        _mm256_storeu_si256((__m256i*)(pDst + i), _mm256_cvtepu8_epi16(xmm));
+    }
+    return i;
+}
+
+GDAL_AVX2_TARGET
+static int GDALCopyByteToFloat32_AVX2( const GByte* pSrc, float* pDst,
+                                       int nWordCount )
+{
+    int i = 0;
+    for( ; i + 16 <= nWordCount; i += 16 )
+    {
+        __m128i xmm = _mm_loadu_si128((const __m128i*)(pSrc + i));
+        _mm256_storeu_ps(pDst + i,
+            _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(xmm)));
+        _mm256_storeu_ps(pDst + i + 8,
+            _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(xmm, 8))));
+    }
+    return i;
+}
+
+GDAL_AVX2_TARGET
+static int GDALCopyUInt16ToFloat32_AVX2( const GUInt16* pSrc, float* pDst,
+                                         int nWordCount )
+{
+    int i = 0;
+    for( ; i + 8 <= nWordCount; i += 8 )
+    {
+        __m128i xmm = _mm_loadu_si128((const __m128i*)(pSrc + i));
+        _mm256_storeu_ps(pDst + i,
+            _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(xmm)));
+    }
+    return i;
+}
+
+GDAL_AVX2_TARGET
+static int GDALCopyInt16ToFloat32_AVX2( const GInt16* pSrc, float* pDst,
+                                        int nWordCount )
+{
+    int i = 0;
+    for( ; i + 8 <= nWordCount; i += 8 )
+    {
+        __m128i xmm = _mm_loadu_si128((const __m128i*)(pSrc + i));
+        _mm256_storeu_ps(pDst + i,
+            _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(xmm)));
+    }
+    return i;
+}
+
+GDAL_AVX2_TARGET
+static inline __m256i GDALRoundClampFloat32_AVX2( const float* pSrc,
+                                                  __m256 ymm_max )
+{
+    /* max() first so that NaN becomes 0 */
+    __m256 ymm = _mm256_add_ps(_mm256_loadu_ps(pSrc), _mm256_set1_ps(0.5f));
+    ymm = _mm256_min_ps(_mm256_max_ps(ymm, _mm256_setzero_ps()), ymm_max);
+    return _mm256_cvttps_epi32(ymm);
+}
+
+GDAL_AVX2_TARGET
+static int GDALCopyFloat32ToByte_AVX2( const float* pSrc, GByte* pDst,
+                                       int nWordCount )
+{
+    const __m256 ymm_max = _mm256_set1_ps(255.0f);
+    /* The packs operate on 128 bit lanes: restore the word order */
+    const __m256i ymm_perm = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    int i = 0;
+    for( ; i + 32 <= nWordCount; i += 32 )
+    {
+        __m256i ymm0 = GDALRoundClampFloat32_AVX2(pSrc + i, ymm_max);
+        __m256i ymm1 = GDALRoundClampFloat32_AVX2(pSrc + i + 8, ymm_max);
+        __m256i ymm2 = GDALRoundClampFloat32_AVX2(pSrc + i + 16, ymm_max);
+        __m256i ymm3 = GDALRoundClampFloat32_AVX2(pSrc + i + 24, ymm_max);
+        __m256i ymm = _mm256_packus_epi16(_mm256_packs_epi32(ymm0, ymm1),
+                                          _mm256_packs_epi32(ymm2, ymm3));
+        _mm256_storeu_si256((__m256i*)(pDst + i),
+                            _mm256_permutevar8x32_epi32(ymm, ymm_perm));
+    }
+    return i;
+}
+
+GDAL_AVX2_TARGET
+static int GDALCopyFloat32ToUInt16_AVX2( const float* pSrc, GUInt16* pDst,
+                                         int nWordCount )
+{
+    const __m256 ymm_max = _mm256_set1_ps(65535.0f);
+    int i = 0;
+    for( ; i + 16 <= nWordCount; i += 16 )
+    {
+        __m256i ymm0 = GDALRoundClampFloat32_AVX2(pSrc + i, ymm_max);
+        __m256i ymm1 = GDALRoundClampFloat32_AVX2(pSrc + i + 8, ymm_max);
+        __m256i ymm = _mm256_packus_epi32(ymm0, ymm1);
+        _mm256_storeu_si256((__m256i*)(pDst + i),
+                            _mm256_permute4x64_epi64(ymm, 0xD8));
+    }
+    return i;
+}
+
+#endif /* HAVE_AVX2_COPYWORDS */
+
+/************************************************************************/
+/*                       GDALCopyWordsSIMD()                            */
+/*                                                                      */
+/*      Run the vectorized kernel matching the conversion, if any.      */
+/*      Returns the number of words processed.                          */
+/************************************************************************/
+
+static int GDALCopyWordsSIMD( const void * pSrcData, GDALDataType eSrcType,
+                              int nSrcPixelStride,
+                              void * pDstData, GDALDataType eDstType,
+                              int nDstPixelStride,
+                              int nWordCount )
+{
+    const int nSIMDLevel = GDALGetCopyWordsSIMDLevel();
+    if( nSIMDLevel == GDAL_COPYWORDS_SIMD_NONE )
+        return 0;
+
+/* -------------------------------------------------------------------- */
+/*      Extraction of one Byte band of a pixel interleaved buffer.      */
+/*      The insertion is left to the generic code, which only writes    */
+/*      the bytes of the band: the other bands of the buffer may be     */
+/*      written concurrently.                                           */
+/* -------------------------------------------------------------------- */
+    if( eSrcType == GDT_Byte && eDstType == GDT_Byte )
+    {
+        if( nSrcPixelStride == 4 && nDstPixelStride == 1 )
+            return GDALCopyByteStride4ToByte_SSE2(
+                (const GByte*)pSrcData, (GByte*)pDstData, nWordCount );
+        return 0;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Conversions between packed buffers.                             */
+/* -------------------------------------------------------------------- */
+    if( nSrcPixelStride != GDALGetDataTypeSize(eSrcType) / 8 ||
+        nDstPixelStride != GDALGetDataTypeSize(eDstType) / 8 )
+        return 0;
+
+#ifdef HAVE_AVX2_COPYWORDS
+    if( nSIMDLevel >= GDAL_COPYWORDS_SIMD_AVX2 )
+    {
+        if( eSrcType == GDT_Byte &&
+            (eDstType == GDT_UInt16 || eDstType == GDT_Int16) )
+            return GDALCopyByteToUInt16_AVX2(
+                (const GByte*)pSrcData, (GUInt16*)pDstData, nWordCount );
+        if( eSrcType == GDT_Byte && eDstType == GDT_Float32 )
+            return GDALCopyByteToFloat32_AVX2(
+                (const GByte*)pSrcData, (float*)pDstData, nWordCount );
+        if( eSrcType == GDT_UInt16 && eDstType == GDT_Float32 )
+            return GDALCopyUInt16ToFloat32_AVX2(
+                (const GUInt16*)pSrcData, (float*)pDstData, nWordCount );
+        if( eSrcType == GDT_Int16 && eDstType == GDT_Float32 )
+            return GDALCopyInt16ToFloat32_AVX2(
+                (const GInt16*)pSrcData, (float*)pDstData, nWordCount );
+        if( eSrcType == GDT_Float32 && eDstType == GDT_Byte )
+            return GDALCopyFloat32ToByte_AVX2(
+                (const float*)pSrcData, (GByte*)pDstData, nWordCount );
+        if( eSrcType == GDT_Float32 && eDstType == GDT_UInt16 )
+            return GDALCopyFloat32ToUInt16_AVX2(
+                (const float*)pSrcData, (GUInt16*)pDstData, nWordCount );
+    }
+#endif
+
+    if( eSrcType == GDT_Byte &&
+        (eDstType == GDT_UInt16 || eDstType == GDT_Int16) )
+        return GDALCopyByteToUInt16_SSE2(
+            (const GByte*)pSrcData, (GUInt16*)pDstData, nWordCount );
+    if( eSrcType == GDT_Byte && eDstType == GDT_Float32 )
+        return GDALCopyByteToFloat32_SSE2(
+            (const GByte*)pSrcData, (float*)pDstData, nWordCount );
+    if( eSrcType == GDT_UInt16 && eDstType == GDT_Byte )
+        return GDALCopyUInt16ToByte_SSE2(
+            (const GUInt16*)pSrcData, (GByte*)pDstData, nWordCount );
+    if( eSrcType == GDT_Int16 && eDstType == GDT_Byte )
+        return GDALCopyInt16ToByte_SSE2(
+            (const GInt16*)pSrcData, (GByte*)pDstData, nWordCount );
+    if( eSrcType == GDT_UInt16 && eDstType == GDT_Float32 )
+        return GDALCopyUInt16ToFloat32_SSE2(
+            (const GUInt16*)pSrcData, (float*)pDstData, nWordCount );
+    if( eSrcType == GDT_Int16 && eDstType == GDT_Float32 )
+        return GDALCopyInt16ToFloat32_SSE2(
+            (const GInt16*)pSrcData, (float*)pDstData, nWordCount );
+    if( eSrcType == GDT_Float32 && eDstType == GDT_Byte )
+        return GDALCopyFloat32ToByte_SSE2(
+            (const float*)pSrcData, (GByte*)pDstData, nWordCount );
+    if( eSrcType == GDT_Float32 && eDstType == GDT_UInt16 )
+        return GDALCopyFloat32ToUInt16_SSE2(
+            (const float*)pSrcData, (GUInt16*)pDstData, nWordCount );
+
+    return 0;
+}
+
+#endif /* HAVE_SSE2_COPYWORDS */
+
 /************************************************************************/
 /*                          GDALReplicateWord()                         */
 /************************************************************************/
@@ -1238,6 +1742,22 @@ GDALCopyWords( void * pSrcData, GDALDataType eSrcType, int nSrcPixelStride,
         return;
     }
 
+#ifdef HAVE_SSE2_COPYWORDS
+    // Process what we can with vectorized kernels, and let the generic
+    // code handle the remaining words.
+    if (nWordCount >= 16 && nSrcPixelStride != 0)
+    {
+        int nDone = GDALCopyWordsSIMD(pSrcData, eSrcType, nSrcPixelStride,
+                                      pDstData, eDstType, nDstPixelStride,
+                                      nWordCount);
+        if (nDone == nWordCount)
+            return;
+        pSrcData = ((GByte *) pSrcData) + (size_t)nDone * nSrcPixelStride;
+        pDstData = ((GByte *) pDstData) + (size_t)nDone * nDstPixelStride;
+        nWordCount -= nDone;
+    }
+#endif
+
 #ifdef USE_NEW_COPYWORDS
 
     int nSrcDataTypeSize = GDALGetDataTypeSize(eSrcType) / 8;
@@ -2812,6 +3332,386 @@ static void GDALCopyWholeRasterGetSwathSize(GDALRasterBand *poSrcPrototypeBand,
     *pnSwathLines = nSwathLines;
 }
 
+/************************************************************************/
+/* ==================================================================== */
+/*                       Pipelined swath copying                        */
+/*                                                                      */
+/*      With the PIPELINE=YES option, a reader thread fills up to       */
+/*      PIPELINE_DEPTH swath buffers from the source while the calling  */
+/*      thread writes the previously read swaths to the destination,    */
+/*      so that reading (and decompressing) the source overlaps with    */
+/*      writing (and compressing) the destination.  Swaths are written  */
+/*      in the same order as in the sequential case.                    */
+/*                                                                      */
+/*      The source is only accessed by the reader thread and the        */
+/*      destination only by the calling thread.  The calling thread     */
+/*      holds the block I/O right of the destination dataset while it   */
+/*      writes and flushes a swath, so that the reader thread skips     */
+/*      the dirty destination blocks when it needs room in the block    */
+/*      cache, rather than writing them itself.  The pipeline is only   */
+/*      used if the free part of the cache can hold all the swath       */
+/*      buffers and the one being written.                              */
+/* ==================================================================== */
+/************************************************************************/
+
+typedef struct
+{
+    int     nBand;          /* 0 for all the bands (interleaved case) */
+    int     nXOff;
+    int     nYOff;
+    int     nXSize;
+    int     nYSize;
+    double  dfProgress;     /* progress once the swath is written */
+} GDALCopySwath;
+
+typedef struct
+{
+    GDALDataset    *poSrcDS;
+    GDALDataset    *poDstDS;
+    GDALRasterBand *poSrcBand;  /* only set for band copies */
+    GDALRasterBand *poDstBand;
+    int             nBandCount;
+    GDALDataType    eDT;
+    std::vector<GDALCopySwath> asSwaths;
+
+    /* Pipeline state, protected by hMutex */
+    int             nDepth;
+    void          **papBuffers;
+    void           *hMutex;
+    void           *hCond;
+    int             nSwathsRead;
+    int             nSwathsWritten;
+    int             bReaderDone;
+    int             bStop;
+    CPLErr          eReadErr;
+} GDALCopyWholeRasterContext;
+
+/************************************************************************/
+/*                   GDALCopyWholeRasterInitContext()                   */
+/************************************************************************/
+
+static void GDALCopyWholeRasterInitContext( GDALCopyWholeRasterContext *psCtxt )
+{
+    psCtxt->poSrcDS = NULL;
+    psCtxt->poDstDS = NULL;
+    psCtxt->poSrcBand = NULL;
+    psCtxt->poDstBand = NULL;
+    psCtxt->nBandCount = 0;
+    psCtxt->eDT = GDT_Unknown;
+    psCtxt->nDepth = 0;
+    psCtxt->papBuffers = NULL;
+    psCtxt->hMutex = NULL;
+    psCtxt->hCond = NULL;
+    psCtxt->nSwathsRead = 0;
+    psCtxt->nSwathsWritten = 0;
+    psCtxt->bReaderDone = FALSE;
+    psCtxt->bStop = FALSE;
+    psCtxt->eReadErr = CE_None;
+}
+
+/************************************************************************/
+/*                          GDALCopySwathIO()                           */
+/************************************************************************/
+
+static CPLErr GDALCopySwathIO( GDALCopyWholeRasterContext *psCtxt,
+                               GDALRWFlag eRWFlag,
+                               const GDALCopySwath &sSwath,
+                               void *pBuffer )
+{
+    if( psCtxt->poSrcBand != NULL )
+    {
+        GDALRasterBand *poBand = (eRWFlag == GF_Read) ? psCtxt->poSrcBand
+                                                      : psCtxt->poDstBand;
+        return poBand->RasterIO( eRWFlag,
+                                 sSwath.nXOff, sSwath.nYOff,
+                                 sSwath.nXSize, sSwath.nYSize,
+                                 pBuffer, sSwath.nXSize, sSwath.nYSize,
+                                 psCtxt->eDT, 0, 0 );
+    }
+
+    GDALDataset *poDS = (eRWFlag == GF_Read) ? psCtxt->poSrcDS
+                                             : psCtxt->poDstDS;
+    int nBand = sSwath.nBand;
+
+    return poDS->RasterIO( eRWFlag,
+                           sSwath.nXOff, sSwath.nYOff,
+                           sSwath.nXSize, sSwath.nYSize,
+                           pBuffer, sSwath.nXSize, sSwath.nYSize,
+                           psCtxt->eDT,
+                           (nBand == 0) ? psCtxt->nBandCount : 1,
+                           (nBand == 0) ? NULL : &nBand,
+                           0, 0, 0 );
+}
+
+/************************************************************************/
+/*                        GDALCopySwathFlush()                          */
+/*                                                                      */
+/*      Flush the destination blocks touched by a swath.                */
+/************************************************************************/
+
+static CPLErr GDALCopySwathFlush( GDALCopyWholeRasterContext *psCtxt,
+                                  const GDALCopySwath &sSwath )
+{
+    if( psCtxt->poDstBand != NULL )
+        return psCtxt->poDstBand->FlushCache();
+
+    if( sSwath.nBand != 0 )
+        return psCtxt->poDstDS->GetRasterBand(sSwath.nBand)->FlushCache();
+
+    CPLErr eErr = CE_None;
+    for( int iBand = 0; iBand < psCtxt->nBandCount && eErr == CE_None; iBand++ )
+        eErr = psCtxt->poDstDS->GetRasterBand(iBand+1)->FlushCache();
+    return eErr;
+}
+
+/************************************************************************/
+/*                   GDALCopyWholeRasterReaderThread()                  */
+/************************************************************************/
+
+static void GDALCopyWholeRasterReaderThread( void *pData )
+
+{
+    GDALCopyWholeRasterContext *psCtxt = (GDALCopyWholeRasterContext *) pData;
+    const int nSwaths = (int) psCtxt->asSwaths.size();
+
+    for( int iSwath = 0; iSwath < nSwaths; iSwath++ )
+    {
+/* -------------------------------------------------------------------- */
+/*      Wait for the writer to release the buffer of this swath.        */
+/* -------------------------------------------------------------------- */
+        CPLAcquireMutex( psCtxt->hMutex, 1000.0 );
+        while( !psCtxt->bStop
+               && iSwath - psCtxt->nSwathsWritten >= psCtxt->nDepth )
+            CPLCondWait( psCtxt->hCond, psCtxt->hMutex );
+        int bStop = psCtxt->bStop;
+        CPLReleaseMutex( psCtxt->hMutex );
+
+        if( bStop )
+            break;
+
+        CPLErr eErr = GDALCopySwathIO(
+            psCtxt, GF_Read, psCtxt->asSwaths[iSwath],
+            psCtxt->papBuffers[iSwath % psCtxt->nDepth] );
+
+        CPLAcquireMutex( psCtxt->hMutex, 1000.0 );
+        if( eErr == CE_None )
+            psCtxt->nSwathsRead = iSwath + 1;
+        else
+            psCtxt->eReadErr = eErr;
+        CPLCondBroadcast( psCtxt->hCond );
+        CPLReleaseMutex( psCtxt->hMutex );
+
+        if( eErr != CE_None )
+            break;
+    }
+
+    CPLAcquireMutex( psCtxt->hMutex, 1000.0 );
+    psCtxt->bReaderDone = TRUE;
+    CPLCondBroadcast( psCtxt->hCond );
+    CPLReleaseMutex( psCtxt->hMutex );
+}
+
+/************************************************************************/
+/*                     GDALCopyWholeRasterSwaths()                      */
+/*                                                                      */
+/*      Copy the swaths of the context, either sequentially through     */
+/*      pSwathBuf, or pipelined if requested by the options.            */
+/************************************************************************/
+
+static CPLErr GDALCopyWholeRasterSwaths( GDALCopyWholeRasterContext *psCtxt,
+                                         void *pSwathBuf,
+                                         GIntBig nSwathBufSize,
+                                         char **papszOptions,
+                                         GDALProgressFunc pfnProgress,
+                                         void *pProgressData )
+
+{
+    const int nSwaths = (int) psCtxt->asSwaths.size();
+    CPLErr eErr = CE_None;
+
+/* -------------------------------------------------------------------- */
+/*      Do we want to, and can we, pipeline the copy?  The free part    */
+/*      of the block cache must be able to hold the swaths read ahead   */
+/*      and the one being written, and the source and destination       */
+/*      must be distinct datasets.                                      */
+/* -------------------------------------------------------------------- */
+    int bPipeline = CSLFetchBoolean( papszOptions, "PIPELINE", FALSE );
+    int nDepth = 2;
+    const char *pszDepth = CSLFetchNameValue( papszOptions, "PIPELINE_DEPTH" );
+    if( pszDepth != NULL )
+        nDepth = MAX(2, MIN(16, atoi(pszDepth)));
+
+    if( bPipeline && nSwaths < 2 )
+        bPipeline = FALSE;
+
+    GDALDataset *poSrcDS = psCtxt->poSrcDS;
+    GDALDataset *poDstDS = psCtxt->poDstDS;
+    if( psCtxt->poSrcBand != NULL )
+    {
+        poSrcDS = psCtxt->poSrcBand->GetDataset();
+        poDstDS = psCtxt->poDstBand->GetDataset();
+    }
+
+    if( bPipeline )
+    {
+        if( poDstDS == NULL )
+        {
+            CPLDebug( "GDAL", "Destination band without dataset, "
+                      "not pipelining the copy." );
+            bPipeline = FALSE;
+        }
+        else if( poSrcDS == poDstDS )
+        {
+            CPLDebug( "GDAL", "Source and destination share the same dataset, "
+                      "not pipelining the copy." );
+            bPipeline = FALSE;
+        }
+        else if( (nDepth + 1) * nSwathBufSize
+                 > GDALGetCacheMax64() - GDALGetCacheUsed64() )
+        {
+            CPLDebug( "GDAL", "Block cache too small to pipeline the copy." );
+            bPipeline = FALSE;
+        }
+    }
+
+    if( bPipeline )
+    {
+        psCtxt->papBuffers = (void **) CPLCalloc( sizeof(void*), nDepth );
+        psCtxt->papBuffers[0] = pSwathBuf;
+        for( int i = 1; i < nDepth; i++ )
+        {
+            psCtxt->papBuffers[i] = VSIMalloc( (size_t) nSwathBufSize );
+            if( psCtxt->papBuffers[i] == NULL )
+            {
+                /* Go on with the buffers we could get */
+                nDepth = i;
+                break;
+            }
+        }
+        if( nDepth < 2 )
+        {
+            CPLFree( psCtxt->papBuffers );
+            psCtxt->papBuffers = NULL;
+            bPipeline = FALSE;
+        }
+    }
+
+/* ==================================================================== */
+/*      Sequential case.                                                */
+/* ==================================================================== */
+    if( !bPipeline )
+    {
+        for( int iSwath = 0; iSwath < nSwaths && eErr == CE_None; iSwath++ )
+        {
+            const GDALCopySwath &sSwath = psCtxt->asSwaths[iSwath];
+
+            eErr = GDALCopySwathIO( psCtxt, GF_Read, sSwath, pSwathBuf );
+
+            if( eErr == CE_None )
+                eErr = GDALCopySwathIO( psCtxt, GF_Write, sSwath, pSwathBuf );
+
+            if( eErr == CE_None
+                && !pfnProgress( sSwath.dfProgress, NULL, pProgressData ) )
+            {
+                eErr = CE_Failure;
+                CPLError( CE_Failure, CPLE_UserInterrupt,
+                          "User terminated CreateCopy()" );
+            }
+        }
+
+        return eErr;
+    }
+
+/* ==================================================================== */
+/*      Pipelined case.                                                 */
+/* ==================================================================== */
+    CPLDebug( "GDAL", "Pipelining the copy of %d swaths with %d buffers.",
+              nSwaths, nDepth );
+
+    psCtxt->nDepth = nDepth;
+    psCtxt->nSwathsRead = 0;
+    psCtxt->nSwathsWritten = 0;
+    psCtxt->bReaderDone = FALSE;
+    psCtxt->bStop = FALSE;
+    psCtxt->eReadErr = CE_None;
+    psCtxt->hMutex = CPLCreateMutex();
+    CPLReleaseMutex( psCtxt->hMutex );
+    psCtxt->hCond = CPLCreateCond();
+
+    void *hThread = CPLCreateJoinableThread( GDALCopyWholeRasterReaderThread,
+                                             psCtxt );
+    if( hThread == NULL )
+    {
+        CPLError( CE_Failure, CPLE_AppDefined,
+                  "CPLCreateJoinableThread() failed in "
+                  "GDALCopyWholeRasterSwaths()" );
+        eErr = CE_Failure;
+    }
+
+    for( int iSwath = 0; iSwath < nSwaths && eErr == CE_None; iSwath++ )
+    {
+        const GDALCopySwath &sSwath = psCtxt->asSwaths[iSwath];
+
+        CPLAcquireMutex( psCtxt->hMutex, 1000.0 );
+        while( psCtxt->nSwathsRead <= iSwath && !psCtxt->bReaderDone )
+            CPLCondWait( psCtxt->hCond, psCtxt->hMutex );
+        if( psCtxt->nSwathsRead <= iSwath )
+            eErr = (psCtxt->eReadErr != CE_None) ? psCtxt->eReadErr
+                                                 : CE_Failure;
+        CPLReleaseMutex( psCtxt->hMutex );
+
+        if( eErr != CE_None )
+            break;
+
+        {
+            GDALBlockIOHolder oBlockIOHolder( poDstDS, TRUE );
+
+            eErr = GDALCopySwathIO( psCtxt, GF_Write, sSwath,
+                                    psCtxt->papBuffers[iSwath % nDepth] );
+
+            if( eErr == CE_None )
+                eErr = GDALCopySwathFlush( psCtxt, sSwath );
+        }
+
+        CPLAcquireMutex( psCtxt->hMutex, 1000.0 );
+        psCtxt->nSwathsWritten = iSwath + 1;
+        CPLCondBroadcast( psCtxt->hCond );
+        CPLReleaseMutex( psCtxt->hMutex );
+
+        if( eErr == CE_None
+            && !pfnProgress( sSwath.dfProgress, NULL, pProgressData ) )
+        {
+            eErr = CE_Failure;
+            CPLError( CE_Failure, CPLE_UserInterrupt,
+                      "User terminated CreateCopy()" );
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Stop the reader thread, and cleanup.                            */
+/* -------------------------------------------------------------------- */
+    if( hThread != NULL )
+    {
+        CPLAcquireMutex( psCtxt->hMutex, 1000.0 );
+        psCtxt->bStop = TRUE;
+        CPLCondBroadcast( psCtxt->hCond );
+        CPLReleaseMutex( psCtxt->hMutex );
+
+        CPLJoinThread( hThread );
+    }
+
+    CPLDestroyCond( psCtxt->hCond );
+    CPLDestroyMutex( psCtxt->hMutex );
+
+    /* The first buffer belongs to the caller */
+    for( int i = 1; i < nDepth; i++ )
+        CPLFree( psCtxt->papBuffers[i] );
+    CPLFree( psCtxt->papBuffers );
+    psCtxt->papBuffers = NULL;
+
+    return eErr;
+}
+
 /************************************************************************/
 /*                     GDALDatasetCopyWholeRaster()                     */
 /************************************************************************/
@@ -2834,6 +3734,14 @@ static void GDALCopyWholeRasterGetSwathSize(GDALRasterBand *poSrcPrototypeBand,
  * on target dataset block sizes to achieve best compression.  More options may be supported in
  * the future.  
  *
+ * Starting with GDAL 2.0, "PIPELINE=YES" can be passed so that the swaths
+ * are read from the source by a separate thread while the previously read
+ * swaths are written to the destination, and "PIPELINE_DEPTH=n" sets the
+ * number of swath buffers used by the pipeline (2 by default).  The source
+ * and destination datasets must then not share any underlying resource, as
+ * they are accessed from different threads.  The pipeline is not used if
+ * the free part of the block cache cannot hold n+1 swaths.
+ *
  * @param hSrcDS the source dataset
  * @param hDstDS the destination dataset
  * @param papszOptions transfer hints in "StringList" Name=Value format.
@@ -2954,105 +3862,51 @@ CPLErr CPL_STDCALL GDALDatasetCopyWholeRaster(
             "GDALDatasetCopyWholeRaster(): %d*%d swaths, bInterleave=%d", 
             nSwathCols, nSwathLines, bInterleave );
 
-/* ==================================================================== */
-/*      Band oriented (uninterleaved) case.                             */
-/* ==================================================================== */
-    if( !bInterleave )
-    {
-        int iBand, iX, iY;
-
-        for( iBand = 0; iBand < nBandCount && eErr == CE_None; iBand++ )
-        {
-            int nBand = iBand+1;
-
-            for( iY = 0; iY < nYSize && eErr == CE_None; iY += nSwathLines )
-            {
-                int nThisLines = nSwathLines;
-
-                if( iY + nThisLines > nYSize )
-                    nThisLines = nYSize - iY;
+/* -------------------------------------------------------------------- */
+/*      Build the list of swaths to copy: band by band in the           */
+/*      uninterleaved case, all the bands at once otherwise.            */
+/* -------------------------------------------------------------------- */
+    GDALCopyWholeRasterContext sCtxt;
+    GDALCopyWholeRasterInitContext( &sCtxt );
+    sCtxt.poSrcDS = poSrcDS;
+    sCtxt.poDstDS = poDstDS;
+    sCtxt.nBandCount = nBandCount;
+    sCtxt.eDT = eDT;
 
-                for( iX = 0; iX < nXSize && eErr == CE_None; iX += nSwathCols )
-                {
-                    int nThisCols = nSwathCols;
-
-                    if( iX + nThisCols > nXSize )
-                        nThisCols = nXSize - iX;
-
-                    eErr = poSrcDS->RasterIO( GF_Read, 
-                                            iX, iY, nThisCols, nThisLines,
-                                            pSwathBuf, nThisCols, nThisLines, 
-                                            eDT, 1, &nBand, 
-                                            0, 0, 0 );
-
-                    if( eErr == CE_None )
-                        eErr = poDstDS->RasterIO( GF_Write, 
-                                                iX, iY, nThisCols, nThisLines,
-                                                pSwathBuf, nThisCols, nThisLines, 
-                                                eDT, 1, &nBand,
-                                                0, 0, 0 );
-
-                    if( eErr == CE_None 
-                        && !pfnProgress( 
-                            iBand / (float)nBandCount
-                            + (iY+nThisLines) / (float) (nYSize*nBandCount),
-                            NULL, pProgressData ) )
-                    {
-                        eErr = CE_Failure;
-                        CPLError( CE_Failure, CPLE_UserInterrupt, 
-                                "User terminated CreateCopy()" );
-                    }
-                }
-            }
-        }
-    }
+    int iBand, iX, iY;
+    const int nBandPasses = bInterleave ? 1 : nBandCount;
 
-/* ==================================================================== */
-/*      Pixel interleaved case.                                         */
-/* ==================================================================== */
-    else /* if( bInterleave ) */
+    for( iBand = 0; iBand < nBandPasses; iBand++ )
     {
-        int iY, iX;
-
-        for( iY = 0; iY < nYSize && eErr == CE_None; iY += nSwathLines )
+        for( iY = 0; iY < nYSize; iY += nSwathLines )
         {
             int nThisLines = nSwathLines;
 
             if( iY + nThisLines > nYSize )
                 nThisLines = nYSize - iY;
 
-            for( iX = 0; iX < nXSize && eErr == CE_None; iX += nSwathCols )
+            for( iX = 0; iX < nXSize; iX += nSwathCols )
             {
-                int nThisCols = nSwathCols;
-
-                if( iX + nThisCols > nXSize )
-                    nThisCols = nXSize - iX;
-
-                eErr = poSrcDS->RasterIO( GF_Read, 
-                                        iX, iY, nThisCols, nThisLines,
-                                        pSwathBuf, nThisCols, nThisLines, 
-                                        eDT, nBandCount, NULL, 
-                                        0, 0, 0 );
-
-                if( eErr == CE_None )
-                    eErr = poDstDS->RasterIO( GF_Write, 
-                                            iX, iY, nThisCols, nThisLines,
-                                            pSwathBuf, nThisCols, nThisLines, 
-                                            eDT, nBandCount, NULL, 
-                                            0, 0, 0 );
-
-                if( eErr == CE_None 
-                    && !pfnProgress( (iY+nThisLines) / (float) nYSize,
-                                    NULL, pProgressData ) )
-                {
-                    eErr = CE_Failure;
-                    CPLError( CE_Failure, CPLE_UserInterrupt, 
-                            "User terminated CreateCopy()" );
-                }
+                GDALCopySwath sSwath;
+
+                sSwath.nBand = bInterleave ? 0 : iBand + 1;
+                sSwath.nXOff = iX;
+                sSwath.nYOff = iY;
+                sSwath.nXSize = MIN(nSwathCols, nXSize - iX);
+                sSwath.nYSize = nThisLines;
+                sSwath.dfProgress = iBand / (float)nBandPasses
+                    + (iY+nThisLines) / (float) (nYSize*nBandPasses);
+                sCtxt.asSwaths.push_back( sSwath );
             }
         }
     }
 
+    eErr = GDALCopyWholeRasterSwaths( &sCtxt, pSwathBuf,
+                                      (GIntBig)nSwathCols * nSwathLines
+                                                          * nPixelSize,
+                                      papszOptions,
+                                      pfnProgress, pProgressData );
+
 /* -------------------------------------------------------------------- */
 /*      Cleanup                                                         */
 /* -------------------------------------------------------------------- */
@@ -3077,8 +3931,10 @@ CPLErr CPL_STDCALL GDALDatasetCopyWholeRaster(
  * It implements efficient copying, in particular "chunking" the copy in
  * substantial blocks.
  *
- * Currently the only papszOptions value supported is : "COMPRESSED=YES" to
- * force alignment on target dataset block sizes to achieve best compression.
+ * Currently the only papszOptions value supported are : "COMPRESSED=YES" to
+ * force alignment on target dataset block sizes to achieve best compression,
+ * and "PIPELINE=YES" / "PIPELINE_DEPTH=n" to read and write the swaths
+ * from two threads as in GDALDatasetCopyWholeRaster().
  * More options may be supported in the future.
  *
  * @param hSrcBand the source band
@@ -3166,49 +4022,45 @@ CPLErr CPL_STDCALL GDALRasterBandCopyWholeRaster(
             "GDALRasterBandCopyWholeRaster(): %d*%d swaths",
             nSwathCols, nSwathLines );
 
-/* ==================================================================== */
-/*      Band oriented (uninterleaved) case.                             */
-/* ==================================================================== */
+/* -------------------------------------------------------------------- */
+/*      Build the list of swaths to copy.                               */
+/* -------------------------------------------------------------------- */
+    GDALCopyWholeRasterContext sCtxt;
+    GDALCopyWholeRasterInitContext( &sCtxt );
+    sCtxt.poSrcBand = poSrcBand;
+    sCtxt.poDstBand = poDstBand;
+    sCtxt.nBandCount = 1;
+    sCtxt.eDT = eDT;
 
     int iX, iY;
 
-    for( iY = 0; iY < nYSize && eErr == CE_None; iY += nSwathLines )
+    for( iY = 0; iY < nYSize; iY += nSwathLines )
     {
         int nThisLines = nSwathLines;
 
         if( iY + nThisLines > nYSize )
             nThisLines = nYSize - iY;
 
-        for( iX = 0; iX < nXSize && eErr == CE_None; iX += nSwathCols )
+        for( iX = 0; iX < nXSize; iX += nSwathCols )
         {
-            int nThisCols = nSwathCols;
-
-            if( iX + nThisCols > nXSize )
-                nThisCols = nXSize - iX;
-
-            eErr = poSrcBand->RasterIO( GF_Read,
-                                    iX, iY, nThisCols, nThisLines,
-                                    pSwathBuf, nThisCols, nThisLines,
-                                    eDT, 0, 0 );
-
-            if( eErr == CE_None )
-                eErr = poDstBand->RasterIO( GF_Write,
-                                        iX, iY, nThisCols, nThisLines,
-                                        pSwathBuf, nThisCols, nThisLines,
-                                        eDT, 0, 0 );
-
-            if( eErr == CE_None
-                && !pfnProgress(
-                    (iY+nThisLines) / (float) (nYSize),
-                    NULL, pProgressData ) )
-            {
-                eErr = CE_Failure;
-                CPLError( CE_Failure, CPLE_UserInterrupt,
-                        "User terminated CreateCopy()" );
-            }
+            GDALCopySwath sSwath;
+
+            sSwath.nBand = 1;
+            sSwath.nXOff = iX;
+            sSwath.nYOff = iY;
+            sSwath.nXSize = MIN(nSwathCols, nXSize - iX);
+            sSwath.nYSize = nThisLines;
+            sSwath.dfProgress = (iY+nThisLines) / (float) (nYSize);
+            sCtxt.asSwaths.push_back( sSwath );
         }
     }
 
+    eErr = GDALCopyWholeRasterSwaths( &sCtxt, pSwathBuf,
+                                      (GIntBig)nSwathCols * nSwathLines
+                                                          * nPixelSize,
+                                      papszOptions,
+                                      pfnProgress, pProgressData );
+
 /* -------------------------------------------------------------------- */
 /*      Cleanup                                                         */
 /* -------------------------------------------------------------------- */
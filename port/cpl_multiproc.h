@@ -82,6 +82,21 @@ const char CPL_DLL *CPLGetThreadingModel( void );
 
 int CPL_DLL CPLGetNumCPUs( void );
 
+/* -------------------------------------------------------------------- */
+/*      Process-wide worker thread pool (cpl_worker_thread_pool.cpp)    */
+/* -------------------------------------------------------------------- */
+typedef struct _CPLJobGroup CPLJobGroup;
+
+int   CPL_DLL CPLGetNumThreadsFromOption( const char *pszValue, int nDefault );
+int   CPL_DLL CPLGetThreadPoolSize( void );
+CPLJobGroup CPL_DLL *CPLCreateJobGroup( void );
+int   CPL_DLL CPLSubmitJob( CPLJobGroup *psGroup,
+                            CPLThreadFunc pfnFunc, void *pData );
+int   CPL_DLL CPLRunPendingJob( CPLJobGroup *psGroup );
+void  CPL_DLL CPLWaitJobGroup( CPLJobGroup *psGroup );
+void  CPL_DLL CPLDestroyJobGroup( CPLJobGroup *psGroup );
+void  CPL_DLL CPLCleanupThreadPool( void );
+
 CPL_C_END
 
 #ifdef __cplusplus
@@ -128,8 +143,8 @@ class CPL_DLL CPLMutexHolder
 #define CTLS_ERRORCONTEXT               5         /* cpl_error.cpp */
 #define CTLS_GDALDATASET_REC_PROTECT_MAP 6        /* gdaldataset.cpp */
 #define CTLS_PATHBUF                    7         /* cpl_path.cpp */
-#define CTLS_UNUSED3                    8
-#define CTLS_UNUSED4                    9
+#define CTLS_WORKERTHREADPOOL           8         /* cpl_worker_thread_pool.cpp */
+#define CTLS_GDALDATASETPOOL            9         /* gdalproxypool.cpp */
 #define CTLS_CPLSPRINTF                10         /* cpl_string.h */
 #define CTLS_RESPONSIBLEPID            11         /* gdaldataset.cpp */
 #define CTLS_VERSIONINFO               12         /* gdal_misc.cpp */
@@ -0,0 +1,556 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  CPL - Common Portability Library
+ * Purpose:  Process-wide pool of worker threads executing job groups.
+ * Author:   agent <agent at local>
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, agent <agent at local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ****************************************************************************/
+
+#include "cpl_multiproc.h"
+#include "cpl_atomic_ops.h"
+#include "cpl_conv.h"
+#include "cpl_string.h"
+
+#include <deque>
+
+CPL_CVSID("$Id$");
+
+/*
+** All parallel processing done by GDAL (warping, gridding, TPS solving,
+** JPEG2000 decoding, ...) is executed by a single pool of worker threads,
+** so that concurrent operations in the same process share one thread
+** budget instead of each one spawning its own threads.
+**
+** The pool size is controlled by the GDAL_THREAD_POOL_SIZE configuration
+** option (number or ALL_CPUS, the default).  It is read once, when the
+** first job is submitted.
+**
+** Each worker owns a job queue. Jobs submitted from outside the pool are
+** distributed round-robin over the queues, jobs submitted from a worker go
+** to its own queue.  Idle workers steal jobs from the other queues.  The
+** total number of queued jobs is bounded: beyond that limit, the submitting
+** thread runs the job itself.
+**
+** Jobs are grouped in job groups that can be waited on.  A thread waiting
+** for a group runs the queued jobs of that group itself, so waiting from
+** within a job (nested parallelism) cannot starve the pool.  It never runs
+** jobs of other groups, which might need locks it holds.
+*/
+
+#define CPL_MAX_QUEUED_JOBS_PER_WORKER  64
+
+typedef struct
+{
+    CPLThreadFunc   pfnFunc;
+    void           *pData;
+    CPLJobGroup    *psGroup;
+} CPLJob;
+
+struct _CPLJobGroup
+{
+    void           *hMutex;
+    void           *hCond;
+    volatile int    nPendingJobs;
+};
+
+typedef struct
+{
+    void               *hMutex;
+    std::deque<CPLJob>  oJobs;
+    volatile int        nJobCount; /* size of oJobs, readable without lock */
+} CPLWorkerQueue;
+
+static void            *hPoolMutex = NULL;
+static volatile int     bPoolInitialized = FALSE;
+static volatile int     bPoolStop = FALSE;
+static int              nWorkers = 0;
+static int              nWorkerThreads = 0;
+static CPLWorkerQueue  *pasQueues = NULL;
+static void           **pahWorkerThreads = NULL;
+static void            *hSleepMutex = NULL;
+static void            *hSleepCond = NULL;
+static volatile int     nQueuedJobs = 0;
+static volatile int     nSubmitCounter = 0;
+
+/************************************************************************/
+/*                     CPLGetNumThreadsFromOption()                     */
+/************************************************************************/
+
+/**
+ * Parse a NUM_THREADS like value.
+ *
+ * @param pszValue a number of threads, or ALL_CPUS. May be NULL.
+ * @param nDefault the value to return if pszValue is NULL.
+ *
+ * @return the number of threads, between 1 and 128 (or nDefault).
+ */
+
+int CPLGetNumThreadsFromOption( const char *pszValue, int nDefault )
+
+{
+    int nThreads;
+
+    if( pszValue == NULL )
+        return nDefault;
+
+    if( EQUAL(pszValue, "ALL_CPUS") )
+        nThreads = CPLGetNumCPUs();
+    else
+        nThreads = atoi(pszValue);
+
+    if( nThreads > 128 )
+        nThreads = 128;
+    if( nThreads < 1 )
+        nThreads = 1;
+
+    return nThreads;
+}
+
+/************************************************************************/
+/*                            CPLRunJob()                               */
+/************************************************************************/
+
+static void CPLRunJob( const CPLJob *psJob )
+
+{
+    psJob->pfnFunc( psJob->pData );
+
+    CPLJobGroup *psGroup = psJob->psGroup;
+    CPLAcquireMutex( psGroup->hMutex, 1000.0 );
+    psGroup->nPendingJobs --;
+    if( psGroup->nPendingJobs == 0 )
+        CPLCondBroadcast( psGroup->hCond );
+    CPLReleaseMutex( psGroup->hMutex );
+}
+
+/************************************************************************/
+/*                            CPLTakeJob()                              */
+/*                                                                      */
+/*      Dequeue a job, starting with the queue of worker iWorker (if    */
+/*      not negative) and stealing from the other queues. If psGroup    */
+/*      is not NULL, only jobs of this group are considered.            */
+/************************************************************************/
+
+static int CPLTakeJob( int iWorker, CPLJobGroup *psGroup, CPLJob *psJob )
+
+{
+    int iStart = (iWorker >= 0) ? iWorker : 0;
+
+    for( int i = 0; i < nWorkers; i++ )
+    {
+        CPLWorkerQueue *psQueue = pasQueues + (iStart + i) % nWorkers;
+        int bFound = FALSE;
+
+        /* Unsynchronized peek: jobs queued meanwhile will be seen by */
+        /* the next call. */
+        if( psQueue->nJobCount == 0 )
+            continue;
+
+        CPLAcquireMutex( psQueue->hMutex, 1000.0 );
+        if( psGroup != NULL )
+        {
+            std::deque<CPLJob>::iterator oIter = psQueue->oJobs.begin();
+            for( ; oIter != psQueue->oJobs.end(); ++oIter )
+            {
+                if( oIter->psGroup == psGroup )
+                {
+                    *psJob = *oIter;
+                    psQueue->oJobs.erase( oIter );
+                    bFound = TRUE;
+                    break;
+                }
+            }
+        }
+        else if( !psQueue->oJobs.empty() )
+        {
+            /* The owner takes the oldest job, thieves the newest one */
+            if( i == 0 && iWorker >= 0 )
+            {
+                *psJob = psQueue->oJobs.front();
+                psQueue->oJobs.pop_front();
+            }
+            else
+            {
+                *psJob = psQueue->oJobs.back();
+                psQueue->oJobs.pop_back();
+            }
+            bFound = TRUE;
+        }
+
+        if( bFound )
+        {
+            psQueue->nJobCount --;
+            CPLReleaseMutex( psQueue->hMutex );
+            CPLAtomicDec( &nQueuedJobs );
+            return TRUE;
+        }
+        CPLReleaseMutex( psQueue->hMutex );
+    }
+
+    return FALSE;
+}
+
+/************************************************************************/
+/*                        CPLWorkerThreadMain()                         */
+/************************************************************************/
+
+static void CPLWorkerThreadMain( void *pData )
+
+{
+    int iWorker = (int)(size_t) pData;
+    CPLJob sJob;
+
+    CPLSetTLS( CTLS_WORKERTHREADPOOL, (void*)(size_t)(iWorker + 1), FALSE );
+
+    while( TRUE )
+    {
+        if( CPLTakeJob( iWorker, NULL, &sJob ) )
+        {
+            CPLRunJob( &sJob );
+            continue;
+        }
+
+        CPLAcquireMutex( hSleepMutex, 1000.0 );
+        while( nQueuedJobs <= 0 && !bPoolStop )
+            CPLCondWait( hSleepCond, hSleepMutex );
+        int bStop = bPoolStop && nQueuedJobs <= 0;
+        CPLReleaseMutex( hSleepMutex );
+
+        if( bStop )
+            break;
+    }
+}
+
+/************************************************************************/
+/*                     CPLIsThreadPoolInitialized()                     */
+/*                                                                      */
+/*      Read bPoolInitialized with a memory barrier, so that the pool   */
+/*      state set up before it was raised is visible to this thread.    */
+/************************************************************************/
+
+static int CPLIsThreadPoolInitialized()
+
+{
+    return CPLAtomicAdd( &bPoolInitialized, 0 ) != 0;
+}
+
+/************************************************************************/
+/*                         CPLInitThreadPool()                          */
+/************************************************************************/
+
+static int CPLInitThreadPool()
+
+{
+    if( CPLIsThreadPoolInitialized() )
+        return nWorkerThreads > 0;
+
+    CPLMutexHolderD( &hPoolMutex );
+
+    if( CPLIsThreadPoolInitialized() )
+        return nWorkerThreads > 0;
+
+    int nSize = CPLGetNumThreadsFromOption(
+        CPLGetConfigOption("GDAL_THREAD_POOL_SIZE", NULL), CPLGetNumCPUs() );
+
+    hSleepCond = CPLCreateCond();
+    if( hSleepCond != NULL && nSize > 0 )
+    {
+        hSleepMutex = CPLCreateMutex();
+        CPLReleaseMutex( hSleepMutex );
+
+        pasQueues = new CPLWorkerQueue[nSize];
+        for( int i = 0; i < nSize; i++ )
+        {
+            pasQueues[i].nJobCount = 0;
+            pasQueues[i].hMutex = CPLCreateMutex();
+            CPLReleaseMutex( pasQueues[i].hMutex );
+        }
+
+        /* Queues of workers that failed to start will be emptied */
+        /* by the other workers. */
+        nWorkers = nSize;
+        bPoolStop = FALSE;
+        pahWorkerThreads = (void**) CPLCalloc( sizeof(void*), nSize );
+        for( int i = 0; i < nSize; i++ )
+        {
+            pahWorkerThreads[i] =
+                CPLCreateJoinableThread( CPLWorkerThreadMain,
+                                         (void*)(size_t) i );
+            if( pahWorkerThreads[i] == NULL )
+                break;
+            nWorkerThreads ++;
+        }
+
+        CPLDebug( "CPL", "Thread pool started with %d worker threads.",
+                  nWorkerThreads );
+    }
+
+    /* Publish the pool state set up above */
+    CPLAtomicInc( &bPoolInitialized );
+
+    return nWorkerThreads > 0;
+}
+
+/************************************************************************/
+/*                        CPLGetThreadPoolSize()                        */
+/************************************************************************/
+
+/**
+ * Return the number of worker threads of the process-wide thread pool.
+ *
+ * The pool is started if needed. Returns 0 if threads are not available,
+ * in which case submitted jobs are run synchronously.
+ */
+
+int CPLGetThreadPoolSize()
+
+{
+    CPLInitThreadPool();
+    return nWorkerThreads;
+}
+
+/************************************************************************/
+/*                         CPLCreateJobGroup()                          */
+/************************************************************************/
+
+/**
+ * Create a job group.
+ *
+ * Jobs are submitted to a group with CPLSubmitJob(), and the completion of
+ * all the jobs of a group is waited for with CPLWaitJobGroup().
+ *
+ * @return a new job group, to destroy with CPLDestroyJobGroup().
+ */
+
+CPLJobGroup *CPLCreateJobGroup()
+
+{
+    CPLJobGroup *psGroup = (CPLJobGroup *) CPLCalloc( sizeof(CPLJobGroup), 1 );
+
+    psGroup->hCond = CPLCreateCond();
+    psGroup->hMutex = CPLCreateMutex();
+    CPLReleaseMutex( psGroup->hMutex );
+
+    return psGroup;
+}
+
+/************************************************************************/
+/*                            CPLSubmitJob()                            */
+/************************************************************************/
+
+/**
+ * Queue a job for execution by the thread pool.
+ *
+ * If the pool cannot be used (no thread support) or too many jobs are
+ * already queued, the job is run immediately in the calling thread.
+ *
+ * @param psGroup the job group.
+ * @param pfnFunc the function to run.
+ * @param pData the argument passed to pfnFunc.
+ *
+ * @return TRUE on success.
+ */
+
+int CPLSubmitJob( CPLJobGroup *psGroup, CPLThreadFunc pfnFunc, void *pData )
+
+{
+    if( psGroup == NULL || pfnFunc == NULL )
+        return FALSE;
+
+    if( psGroup->hCond == NULL || !CPLInitThreadPool() ||
+        nQueuedJobs >= nWorkers * CPL_MAX_QUEUED_JOBS_PER_WORKER )
+    {
+        pfnFunc( pData );
+        return TRUE;
+    }
+
+    CPLJob sJob;
+    sJob.pfnFunc = pfnFunc;
+    sJob.pData = pData;
+    sJob.psGroup = psGroup;
+
+    CPLAcquireMutex( psGroup->hMutex, 1000.0 );
+    psGroup->nPendingJobs ++;
+    CPLReleaseMutex( psGroup->hMutex );
+
+/* -------------------------------------------------------------------- */
+/*      Workers push to their own queue, other threads distribute       */
+/*      the jobs over the queues.                                       */
+/* -------------------------------------------------------------------- */
+    int iQueue = (int)(size_t) CPLGetTLS( CTLS_WORKERTHREADPOOL ) - 1;
+    if( iQueue < 0 )
+        iQueue = (int)((unsigned int) CPLAtomicInc( &nSubmitCounter )
+                       % (unsigned int) nWorkers);
+
+    CPLWorkerQueue *psQueue = pasQueues + iQueue;
+    CPLAcquireMutex( psQueue->hMutex, 1000.0 );
+    psQueue->oJobs.push_back( sJob );
+    psQueue->nJobCount ++;
+    CPLReleaseMutex( psQueue->hMutex );
+
+    CPLAcquireMutex( hSleepMutex, 1000.0 );
+    CPLAtomicInc( &nQueuedJobs );
+    CPLCondSignal( hSleepCond );
+    CPLReleaseMutex( hSleepMutex );
+
+    return TRUE;
+}
+
+/************************************************************************/
+/*                          CPLRunPendingJob()                          */
+/************************************************************************/
+
+/**
+ * Run in the calling thread a job of the group not yet started.
+ *
+ * This allows a thread waiting for the completion of a group (for example
+ * to report progress) to take part in the processing.
+ *
+ * @param psGroup the job group.
+ *
+ * @return TRUE if a job was run, FALSE if no job of the group is queued.
+ */
+
+int CPLRunPendingJob( CPLJobGroup *psGroup )
+
+{
+    CPLJob sJob;
+
+    if( psGroup == NULL || !CPLIsThreadPoolInitialized()
+        || nWorkerThreads == 0 )
+        return FALSE;
+
+    int iWorker = (int)(size_t) CPLGetTLS( CTLS_WORKERTHREADPOOL ) - 1;
+    if( !CPLTakeJob( iWorker, psGroup, &sJob ) )
+        return FALSE;
+
+    CPLRunJob( &sJob );
+    return TRUE;
+}
+
+/************************************************************************/
+/*                          CPLWaitJobGroup()                           */
+/************************************************************************/
+
+/**
+ * Wait for the completion of all the jobs submitted to a group.
+ *
+ * The calling thread runs the queued jobs of the group while waiting.
+ *
+ * @param psGroup the job group.
+ */
+
+void CPLWaitJobGroup( CPLJobGroup *psGroup )
+
+{
+    if( psGroup == NULL || psGroup->hCond == NULL )
+        return;
+
+    while( CPLRunPendingJob( psGroup ) ) {}
+
+    CPLAcquireMutex( psGroup->hMutex, 1000.0 );
+    while( psGroup->nPendingJobs > 0 )
+        CPLCondWait( psGroup->hCond, psGroup->hMutex );
+    CPLReleaseMutex( psGroup->hMutex );
+}
+
+/************************************************************************/
+/*                         CPLDestroyJobGroup()                         */
+/************************************************************************/
+
+/**
+ * Destroy a job group, after waiting for its jobs to complete.
+ *
+ * @param psGroup the job group.
+ */
+
+void CPLDestroyJobGroup( CPLJobGroup *psGroup )
+
+{
+    if( psGroup == NULL )
+        return;
+
+    CPLWaitJobGroup( psGroup );
+
+    if( psGroup->hCond != NULL )
+        CPLDestroyCond( psGroup->hCond );
+    CPLDestroyMutex( psGroup->hMutex );
+    CPLFree( psGroup );
+}
+
+/************************************************************************/
+/*                        CPLCleanupThreadPool()                        */
+/************************************************************************/
+
+/**
+ * Stop the worker threads of the pool, once queued jobs are completed.
+ *
+ * This is called by GDALDestroyDriverManager(). The pool is restarted
+ * if jobs are submitted afterwards.
+ */
+
+void CPLCleanupThreadPool()
+
+{
+    if( !CPLIsThreadPoolInitialized() )
+        return;
+
+    if( hSleepMutex != NULL )
+    {
+        CPLAcquireMutex( hSleepMutex, 1000.0 );
+        bPoolStop = TRUE;
+        CPLCondBroadcast( hSleepCond );
+        CPLReleaseMutex( hSleepMutex );
+
+        for( int i = 0; i < nWorkerThreads; i++ )
+            CPLJoinThread( pahWorkerThreads[i] );
+
+        for( int i = 0; i < nWorkers; i++ )
+            CPLDestroyMutex( pasQueues[i].hMutex );
+        delete[] pasQueues;
+        pasQueues = NULL;
+        CPLFree( pahWorkerThreads );
+        pahWorkerThreads = NULL;
+
+        CPLDestroyMutex( hSleepMutex );
+        hSleepMutex = NULL;
+    }
+
+    if( hSleepCond != NULL )
+    {
+        CPLDestroyCond( hSleepCond );
+        hSleepCond = NULL;
+    }
+
+    nWorkers = 0;
+    nWorkerThreads = 0;
+    nQueuedJobs = 0;
+    CPLAtomicDec( &bPoolInitialized );
+
+    if( hPoolMutex != NULL )
+    {
+        CPLDestroyMutex( hPoolMutex );
+        hPoolMutex = NULL;
+    }
+}